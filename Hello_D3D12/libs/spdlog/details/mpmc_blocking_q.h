@@ -7,11 +7,14 @@
 // enqueue(..) - will block until room found to put the new message.
 // enqueue_nowait(..) - will return immediately with false if no room left in
 // the queue.
+// enqueue_if_have_room(..) - will return immediately and drop the new message
+// if no room left in the queue.
 // dequeue_for(..) - will block until the queue is not empty or timeout have
 // passed.
 
 #include <spdlog/details/circular_q.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 
@@ -49,6 +52,29 @@ public:
         push_cv_.notify_one();
     }
 
+    // enqueue immediately. discard the new message if no room left.
+    void enqueue_if_have_room(T &&item)
+    {
+        bool pushed = false;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            if (!q_.full())
+            {
+                q_.push_back(std::move(item));
+                pushed = true;
+            }
+        }
+
+        if (pushed)
+        {
+            push_cv_.notify_one();
+        }
+        else
+        {
+            ++discard_counter_;
+        }
+    }
+
     // dequeue with a timeout.
     // Return true, if succeeded dequeue item, false otherwise
     bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
@@ -99,6 +125,21 @@ public:
         push_cv_.notify_one();
     }
 
+    // enqueue immediately. discard the new message if no room left.
+    void enqueue_if_have_room(T &&item)
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        if (!q_.full())
+        {
+            q_.push_back(std::move(item));
+            push_cv_.notify_one();
+        }
+        else
+        {
+            ++discard_counter_;
+        }
+    }
+
     // dequeue with a timeout.
     // Return true, if succeeded dequeue item, false otherwise
     bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
@@ -132,6 +173,11 @@ public:
         return q_.overrun_counter();
     }
 
+    size_t discard_counter()
+    {
+        return discard_counter_.load(std::memory_order_relaxed);
+    }
+
     size_t size()
     {
         std::unique_lock<std::mutex> lock(queue_mutex_);
@@ -144,11 +190,17 @@ public:
         q_.reset_overrun_counter();
     }
 
+    void reset_discard_counter()
+    {
+        discard_counter_.store(0, std::memory_order_relaxed);
+    }
+
 private:
     std::mutex queue_mutex_;
     std::condition_variable push_cv_;
     std::condition_variable pop_cv_;
     spdlog::details::circular_q<T> q_;
+    std::atomic<size_t> discard_counter_{0};
 };
 } // namespace details
 } // namespace spdlog
@@ -0,0 +1,307 @@
+// Copyright(c) 2015-present, Gabi Melman & spdlog contributors.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+
+#pragma once
+
+// bounded lock-free ring queue, drop-in replacement for mpmc_blocking_queue
+// (enable with SPDLOG_USE_MPSC_QUEUE in tweakme.h).
+// producers claim a slot with a single CAS and publish it with a sequence
+// number per slot (D. Vyukov's bounded queue), no mutex on the fast path.
+// meant for many producers and the single thread pool thread, the dequeue side
+// claims slots with a CAS too so it stays correct with more pool threads and
+// lets producers pop the oldest message themselves for overrun_oldest.
+// the mutex and condition variables are only used to put an idle consumer or
+// a producer facing a full queue (block policy) to sleep.
+//
+// enqueue(..) - will block until room found to put the new message.
+// enqueue_nowait(..) - will overrun the oldest message if no room left.
+// enqueue_if_have_room(..) - will drop the new message if no room left.
+// dequeue_for(..) - will block until the queue is not empty or timeout have
+// passed.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace spdlog {
+namespace details {
+
+template<typename T>
+class mpsc_ring_queue
+{
+public:
+    using item_type = T;
+    explicit mpsc_ring_queue(size_t max_items)
+        : capacity_(round_up_pow2_(max_items))
+        , mask_(capacity_ - 1)
+        , cells_(new cell[capacity_])
+    {
+        for (size_t i = 0; i < capacity_; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_ring_queue(const mpsc_ring_queue &) = delete;
+    mpsc_ring_queue &operator=(const mpsc_ring_queue &) = delete;
+
+    // try to enqueue and block if no room left
+    void enqueue(T &&item)
+    {
+        for (int spin = 0; !try_enqueue_(item); spin++)
+        {
+            if (spin < spin_count)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            producers_waiting_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!has_room_())
+            {
+                pop_cv_.wait_for(lock, sleep_duration);
+            }
+            producers_waiting_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        wake_consumer_();
+    }
+
+    // enqueue immediately. overrun oldest message in the queue if no room left.
+    void enqueue_nowait(T &&item)
+    {
+        while (!try_enqueue_(item))
+        {
+            T oldest;
+            if (try_dequeue_(oldest))
+            {
+                overrun_counter_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        wake_consumer_();
+    }
+
+    // enqueue immediately. discard the new message if no room left.
+    void enqueue_if_have_room(T &&item)
+    {
+        if (try_enqueue_(item))
+        {
+            wake_consumer_();
+        }
+        else
+        {
+            discard_counter_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // dequeue with a timeout.
+    // Return true, if succeeded dequeue item, false otherwise
+    bool dequeue_for(T &popped_item, std::chrono::milliseconds wait_duration)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + wait_duration;
+        for (int spin = 0; !try_dequeue_(popped_item); spin++)
+        {
+            if (spin < spin_count)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if (std::chrono::steady_clock::now() >= deadline)
+            {
+                return false;
+            }
+
+            std::unique_lock<std::mutex> lock(wait_mutex_);
+            consumers_waiting_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!has_item_())
+            {
+                push_cv_.wait_until(lock, deadline);
+            }
+            consumers_waiting_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        wake_producers_();
+        return true;
+    }
+
+    // blocking dequeue without a timeout.
+    void dequeue(T &popped_item)
+    {
+        while (!dequeue_for(popped_item, std::chrono::milliseconds(sleep_duration))) {}
+    }
+
+    size_t overrun_counter()
+    {
+        return overrun_counter_.load(std::memory_order_relaxed);
+    }
+
+    size_t discard_counter()
+    {
+        return discard_counter_.load(std::memory_order_relaxed);
+    }
+
+    // approximate while producers or consumers are active
+    size_t size()
+    {
+        const size_t dequeued = dequeue_pos_.load(std::memory_order_acquire);
+        const size_t enqueued = enqueue_pos_.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    void reset_overrun_counter()
+    {
+        overrun_counter_.store(0, std::memory_order_relaxed);
+    }
+
+    void reset_discard_counter()
+    {
+        discard_counter_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int spin_count = 16;
+    static constexpr std::chrono::milliseconds sleep_duration{10};
+    static constexpr size_t cache_line = 64;
+
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static size_t round_up_pow2_(size_t n)
+    {
+        size_t capacity = 2;
+        while (capacity < n)
+        {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    // moves from item only on success
+    bool try_enqueue_(T &item)
+    {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        cell *target;
+        for (;;)
+        {
+            target = &cells_[pos & mask_];
+            const size_t seq = target->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        target->data = std::move(item);
+        target->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_dequeue_(T &popped_item)
+    {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        cell *target;
+        for (;;)
+        {
+            target = &cells_[pos & mask_];
+            const size_t seq = target->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        popped_item = std::move(target->data);
+        target->sequence.store(pos + capacity_, std::memory_order_release);
+        return true;
+    }
+
+    bool has_room_() const
+    {
+        const size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].sequence.load(std::memory_order_acquire) == pos;
+    }
+
+    bool has_item_() const
+    {
+        const size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    // the fence pairs with the one on the sleeping side, either the sleeper
+    // sees the new item (or free slot) or we see the sleeper
+    void wake_consumer_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumers_waiting_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            push_cv_.notify_one();
+        }
+    }
+
+    void wake_producers_()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (producers_waiting_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+            pop_cv_.notify_all();
+        }
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<cell[]> cells_;
+
+    char pad0_[cache_line];
+    std::atomic<size_t> enqueue_pos_{0};
+    char pad1_[cache_line - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_pos_{0};
+    char pad2_[cache_line - sizeof(std::atomic<size_t>)];
+
+    std::atomic<size_t> overrun_counter_{0};
+    std::atomic<size_t> discard_counter_{0};
+    std::atomic<int> consumers_waiting_{0};
+    std::atomic<int> producers_waiting_{0};
+    std::mutex wait_mutex_;
+    std::condition_variable push_cv_;
+    std::condition_variable pop_cv_;
+};
+
+template<typename T>
+constexpr std::chrono::milliseconds mpsc_ring_queue<T>::sleep_duration;
+
+} // namespace details
+} // namespace spdlog
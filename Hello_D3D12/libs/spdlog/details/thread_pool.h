@@ -4,7 +4,11 @@
 #pragma once
 
 #include <spdlog/details/log_msg_buffer.h>
-#include <spdlog/details/mpmc_blocking_q.h>
+#ifdef SPDLOG_USE_MPSC_QUEUE
+#    include <spdlog/details/mpsc_ring_q.h>
+#else
+#    include <spdlog/details/mpmc_blocking_q.h>
+#endif
 #include <spdlog/details/os.h>
 
 #include <chrono>
@@ -82,7 +86,11 @@ class SPDLOG_API thread_pool
 {
 public:
     using item_type = async_msg;
+#ifdef SPDLOG_USE_MPSC_QUEUE
+    using q_type = details::mpsc_ring_queue<item_type>;
+#else
     using q_type = details::mpmc_blocking_queue<item_type>;
+#endif
 
     thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start, std::function<void()> on_thread_stop);
     thread_pool(size_t q_max_items, size_t threads_n, std::function<void()> on_thread_start);
@@ -98,6 +106,8 @@ public:
     void post_flush(async_logger_ptr &&worker_ptr, async_overflow_policy overflow_policy);
     size_t overrun_counter();
     void reset_overrun_counter();
+    size_t discard_counter();
+    void reset_discard_counter();
     size_t queue_size();
 
 private:
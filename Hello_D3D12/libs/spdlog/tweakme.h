@@ -112,6 +112,15 @@
 // #define SPDLOG_SHORT_LEVEL_NAMES { "T", "D", "I", "W", "E", "C", "O" }
 ///////////////////////////////////////////////////////////////////////////////
 
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to back the async thread pool with a lock-free bounded ring
+// (details/mpsc_ring_q.h) instead of the mutex based mpmc_blocking_queue.
+// Cheaper when many threads log at once. The queue size is rounded up to a
+// power of two.
+//
+// #define SPDLOG_USE_MPSC_QUEUE
+///////////////////////////////////////////////////////////////////////////////
+
 ///////////////////////////////////////////////////////////////////////////////
 // Uncomment to disable default logger creation.
 // This might save some (very) small initialization time if no default logger is needed.
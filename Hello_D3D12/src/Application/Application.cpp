@@ -2,17 +2,28 @@
 #include <SDL.h>
 #include <Windows.h>
 #include <spdlog/spdlog.h>
+#include <cmath>
+#include "../Core/Profiler.h"
+#include "../Core/Log.h"
+#include "../Core/BinaryLog.h"
 
 int Application::windowWidth;
 int Application::windowHeight;
 
 Application::Application() {
+	// Console output happens on the logging thread from here on
+	Log::Initialize();
+	// LOG_BINARY_* calls get formatted on their own thread and end up in the same logger
+	BinaryLog::Initialize(spdlog::default_logger());
+
 	isRunning = false;
 	spdlog::info("Application Constructor Called");
 }
 
 Application::~Application() {
 	spdlog::info("Application Destructor Called");
+	BinaryLog::Shutdown();
+	Log::Shutdown();
 }
 
 void Application::Initialize() {
@@ -42,9 +53,16 @@ void Application::Initialize() {
 	HWND activeWindowHandle = GetActiveWindow();
 	windowHandle = activeWindowHandle;
 
-	d3d12_imp = std::make_unique<D3D12Implementation>(windowHandle, windowWidth, windowHeight);
+	// This thread is the job system's main thread, one worker for every other core
+	const unsigned int coreCount = std::thread::hardware_concurrency();
+	jobSystem.Initialize(coreCount > 1 ? coreCount - 1 : 1);
+	Profiler::Get().SetThreadName("Main");
+
+	d3d12_imp = std::make_unique<D3D12Implementation>(windowHandle, &jobSystem, windowWidth, windowHeight);
 	d3d12_imp->Initialize();
 
+	framePacer.Initialize(&pacerClock, uncappedFrameRate ? 0.0 : TARGET_FPS);
+
 	isRunning = true;
 }
 
@@ -66,6 +84,26 @@ void Application::ProcessInput() {
 			isRunning = false;
 			break;
 
+		case SDL_KEYDOWN:
+			// F9 starts a capture, F9 again writes it out for chrome://tracing / Perfetto
+			if (sdlEvent.key.keysym.sym == SDLK_F9 && !sdlEvent.key.repeat) {
+				Profiler& profiler = Profiler::Get();
+				if (!profiler.IsCapturing()) {
+					profiler.BeginCapture();
+					spdlog::info("Profiler capture started");
+				}
+				else {
+					profiler.EndCapture();
+					if (profiler.ExportChromeTrace(TRACE_FILE_NAME)) {
+						spdlog::info("Profiler capture written to {}", TRACE_FILE_NAME);
+					}
+					else {
+						spdlog::error("Couldn't write the profiler capture to {}", TRACE_FILE_NAME);
+					}
+				}
+			}
+			break;
+
 		default:
 			break;
 		}
@@ -75,13 +113,15 @@ void Application::ProcessInput() {
 
 void Application::Update() {
 	
-	if (!uncappedFrameRate) {
-		int timeToWait = TARGET_MILLISECONDS_PER_FRAME - (SDL_GetTicks() - millisecondsPreviousFrame);
-
-		// Release control to OS
-		if (timeToWait > 0 && timeToWait <= millisecondsPreviousFrame) {
-			SDL_Delay(timeToWait);
-		}
+	// Sleeps most of the way to the next frame and spins the rest, does nothing when uncapped
+	framePacer.WaitForNextFrame();
+	Log::SetFrame(framePacer.GetStats().frameCount);
+
+	const FramePacerStats& stats = framePacer.GetStats();
+	if (stats.frameCount > 0 && stats.frameCount % (TARGET_FPS * 10) == 0) {
+		spdlog::info("Frame time {:.3f} ms avg, {:.3f} ms std dev, {:.3f} - {:.3f} ms, {} missed",
+			stats.meanFrameTime * 1000.0, std::sqrt(stats.frameTimeVariance) * 1000.0,
+			stats.minFrameTime * 1000.0, stats.maxFrameTime * 1000.0, stats.missedFrames);
 	}
 
 	d3d12_imp->Update();
@@ -94,6 +134,7 @@ void Application::Render() {
 
 void Application::Destroy() {
 	d3d12_imp->Shutdown();
+	jobSystem.Shutdown();
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 }
\ No newline at end of file
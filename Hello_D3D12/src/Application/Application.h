@@ -2,20 +2,24 @@
 #include <SDL.h>
 #include <Windows.h>
 #include <memory>
+#include "../Core/JobSystem.h"
+#include "../Core/FramePacer.h"
 #include "../Graphics/D3D12Implementation.h"
 
 const int TARGET_FPS = 120;
-const int TARGET_MILLISECONDS_PER_FRAME = 1000 / TARGET_FPS;
+const char* const TRACE_FILE_NAME = "frame_trace.json";
 
 class Application {
 	private:
 		
 		bool uncappedFrameRate = false;
-		int millisecondsPreviousFrame = 0;
+		SteadyPacerClock pacerClock;
+		FramePacer framePacer;
 
 		bool isRunning;
 		SDL_Window* window = nullptr;
 		HWND windowHandle = nullptr;
+		JobSystem jobSystem;
 		std::unique_ptr<D3D12Implementation> d3d12_imp;
 
 	public:
@@ -0,0 +1,208 @@
+#include "BinaryLog.h"
+#include "BinaryLogDecoder.h"
+#include <fstream>
+#include <unordered_map>
+
+std::mutex BinaryLog::s_ringsMutex;
+std::vector<std::unique_ptr<BinaryLogRing>> BinaryLog::s_rings;
+uint64_t BinaryLog::s_ringSize = BinaryLog::DefaultRingSize;
+std::atomic<bool> BinaryLog::s_running{ false };
+std::atomic<uint64_t> BinaryLog::s_dropped{ 0 };
+std::atomic<uint64_t> BinaryLog::s_droppedInactive{ 0 };
+std::atomic<uint32_t> BinaryLog::s_generation{ 0 };
+std::thread BinaryLog::s_backend;
+
+BinaryLogRing::BinaryLogRing(uint64_t capacity, uint32_t threadIndex)
+	: m_data(new uint8_t[capacity]), m_capacity(capacity), m_threadIndex(threadIndex), m_writePosition(0), m_readPosition(0) {
+}
+
+uint8_t* BinaryLogRing::Reserve(uint32_t size) {
+	const uint64_t write = m_writePosition.load(std::memory_order_relaxed);
+	const uint64_t read = m_readPosition.load(std::memory_order_acquire);
+	const uint64_t offset = write % m_capacity;
+
+	// Doesn't fit before the end, skip to the start
+	const uint64_t skip = offset + size > m_capacity ? m_capacity - offset : 0;
+	if (write + skip + size - read > m_capacity)
+	{
+		return nullptr;
+	}
+
+	if (skip > 0)
+	{
+		BinaryLogRecordHeader* padding = reinterpret_cast<BinaryLogRecordHeader*>(m_data.get() + offset);
+		padding->size = static_cast<uint32_t>(skip);
+		padding->argCount = PaddingRecord;
+		m_writePosition.store(write + skip, std::memory_order_release);
+		return m_data.get();
+	}
+	return m_data.get() + offset;
+}
+
+void BinaryLogRing::Commit(uint32_t size) {
+	m_writePosition.store(m_writePosition.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+BinaryLogRing* BinaryLog::CreateThreadRing() {
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+	s_rings.emplace_back(new BinaryLogRing(s_ringSize, static_cast<uint32_t>(s_rings.size())));
+	return s_rings.back().get();
+}
+
+void BinaryLog::Initialize(std::shared_ptr<spdlog::logger> logger, uint64_t ringSize) {
+	s_ringSize = ringSize & ~static_cast<uint64_t>(BinaryLogRing::RecordAlignment - 1);
+	s_running.store(true);
+	s_backend = std::thread(&BinaryLog::BackendLoop, logger, std::string());
+}
+
+void BinaryLog::Initialize(const std::string& path, uint64_t ringSize) {
+	s_ringSize = ringSize & ~static_cast<uint64_t>(BinaryLogRing::RecordAlignment - 1);
+	s_running.store(true);
+	s_backend = std::thread(&BinaryLog::BackendLoop, nullptr, path);
+}
+
+void BinaryLog::Shutdown() {
+	if (!s_running.exchange(false))
+	{
+		return;
+	}
+
+	s_backend.join();
+
+	{
+		std::lock_guard<std::mutex> lock(s_ringsMutex);
+		s_rings.clear();
+	}
+	s_generation.fetch_add(1, std::memory_order_relaxed);
+
+	const uint64_t dropped = s_dropped.load();
+	if (dropped > 0)
+	{
+		spdlog::warn("{} binary log records were dropped on a full ring", dropped);
+	}
+	const uint64_t droppedInactive = s_droppedInactive.load();
+	if (droppedInactive > 0)
+	{
+		spdlog::warn("{} binary log records were dropped for being logged before the binary log started", droppedInactive);
+	}
+}
+
+void BinaryLog::BackendLoop(std::shared_ptr<spdlog::logger> logger, std::string path) {
+	std::ofstream file;
+	std::unordered_map<const BinaryLogSite*, uint32_t> siteIds;
+	if (!path.empty())
+	{
+		file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			spdlog::error("Couldn't open {} for the binary log, its records will be dropped", path);
+		}
+		else
+		{
+			file.write(BinaryLogFormat::Magic, sizeof(BinaryLogFormat::Magic));
+		}
+	}
+
+	const auto writeString = [&](const char* text) {
+		const uint32_t length = static_cast<uint32_t>(strlen(text));
+		file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		file.write(text, length);
+	};
+
+	std::string message;
+	std::vector<BinaryLogRing*> rings;
+	uint32_t currentThread = 0;
+	uint64_t unwritten = 0;
+	const auto process = [&](const BinaryLogRecordHeader& header) {
+		const uint8_t* args = reinterpret_cast<const uint8_t*>(&header + 1);
+		const size_t argsSize = header.size - sizeof(BinaryLogRecordHeader);
+
+		if (logger)
+		{
+			FormatBinaryLogArgs(header.site->format, args, argsSize, header.argCount, message);
+			const spdlog::log_clock::time_point time(std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(header.time)));
+			logger->log(time, spdlog::source_loc(header.site->file, header.site->line, ""), header.site->level,
+				fmt::format("[frame {}] {}", header.frame, message));
+			return;
+		}
+
+		// The rings still get drained so the threads logging don't fill up, the records just go nowhere
+		if (!file)
+		{
+			unwritten++;
+			return;
+		}
+
+		// New call site, its description goes out first
+		auto site = siteIds.find(header.site);
+		if (site == siteIds.end())
+		{
+			site = siteIds.emplace(header.site, static_cast<uint32_t>(siteIds.size())).first;
+			const uint8_t level = static_cast<uint8_t>(header.site->level);
+			const int32_t line = header.site->line;
+			file.put(static_cast<char>(BinaryLogFormat::SiteTag));
+			file.write(reinterpret_cast<const char*>(&site->second), sizeof(site->second));
+			file.write(reinterpret_cast<const char*>(&level), sizeof(level));
+			file.write(reinterpret_cast<const char*>(&line), sizeof(line));
+			writeString(header.site->format);
+			writeString(header.site->file);
+		}
+
+		const uint32_t size = static_cast<uint32_t>(argsSize);
+		file.put(static_cast<char>(BinaryLogFormat::RecordTag));
+		file.write(reinterpret_cast<const char*>(&site->second), sizeof(site->second));
+		file.write(reinterpret_cast<const char*>(&currentThread), sizeof(currentThread));
+		file.write(reinterpret_cast<const char*>(&header.time), sizeof(header.time));
+		file.write(reinterpret_cast<const char*>(&header.frame), sizeof(header.frame));
+		file.write(reinterpret_cast<const char*>(&header.argCount), sizeof(header.argCount));
+		file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+		file.write(reinterpret_cast<const char*>(args), size);
+	};
+
+	// Records from different threads are only in order per thread, good enough for a log
+	const auto drain = [&]() {
+		{
+			std::lock_guard<std::mutex> lock(s_ringsMutex);
+			rings.clear();
+			for (const std::unique_ptr<BinaryLogRing>& ring : s_rings)
+			{
+				rings.push_back(ring.get());
+			}
+		}
+
+		uint32_t count = 0;
+		for (BinaryLogRing* ring : rings)
+		{
+			currentThread = ring->GetThreadIndex();
+			count += ring->Drain(process);
+		}
+		return count;
+	};
+
+	while (s_running.load(std::memory_order_acquire))
+	{
+		if (drain() == 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	// Whatever was logged before Shutdown was called
+	drain();
+	if (logger)
+	{
+		logger->flush();
+	}
+	else if (file.is_open())
+	{
+		file.flush();
+		if (!file)
+		{
+			spdlog::error("Writing the binary log to {} failed", path);
+		}
+	}
+	if (unwritten > 0)
+	{
+		spdlog::error("{} binary log records couldn't be written to {}", unwritten, path);
+	}
+}
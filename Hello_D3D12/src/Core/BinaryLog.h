@@ -0,0 +1,317 @@
+#pragma once
+#include "Log.h"
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// One per LOG_BINARY call site, constant initialized so the hot path never touches a guard
+struct BinaryLogSite
+{
+	spdlog::level::level_enum level;
+	const char* format;
+	const char* file;
+	int line;
+};
+
+// How each argument is stored, every integer is widened so the decoder only deals with a handful of types
+enum class BinaryArgType : uint8_t
+{
+	Int64,
+	UInt64,
+	Double,
+	Bool,
+	Char,
+	String,		// uint32 length then the bytes, no terminator
+	Pointer
+};
+
+// In front of every record in a thread's ring, the arguments follow as (type, value) pairs
+struct BinaryLogRecordHeader
+{
+	uint32_t size;			// Whole record, padded to RecordAlignment
+	uint32_t argCount;		// PaddingRecord for the filler at the end of the ring
+	const BinaryLogSite* site;
+	int64_t time;			// spdlog's log_clock, nanoseconds since the epoch
+	uint64_t frame;
+};
+
+// Encoding of one argument, specialized per kind of type
+template<typename T, typename Enable = void>
+struct BinaryArg;
+
+template<typename T>
+struct BinaryArg<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && !std::is_same<T, char>::value>::type>
+{
+	static size_t Size(T) { return 1 + sizeof(int64_t); }
+	static uint8_t* Write(uint8_t* out, T value)
+	{
+		const int64_t wide = value;
+		*out = static_cast<uint8_t>(BinaryArgType::Int64);
+		memcpy(out + 1, &wide, sizeof(wide));
+		return out + 1 + sizeof(wide);
+	}
+};
+
+template<typename T>
+struct BinaryArg<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>::type>
+{
+	static size_t Size(T) { return 1 + sizeof(uint64_t); }
+	static uint8_t* Write(uint8_t* out, T value)
+	{
+		const uint64_t wide = value;
+		*out = static_cast<uint8_t>(BinaryArgType::UInt64);
+		memcpy(out + 1, &wide, sizeof(wide));
+		return out + 1 + sizeof(wide);
+	}
+};
+
+template<typename T>
+struct BinaryArg<T, typename std::enable_if<std::is_enum<T>::value>::type>
+{
+	typedef typename std::underlying_type<T>::type Underlying;
+	static size_t Size(T value) { return BinaryArg<Underlying>::Size(static_cast<Underlying>(value)); }
+	static uint8_t* Write(uint8_t* out, T value) { return BinaryArg<Underlying>::Write(out, static_cast<Underlying>(value)); }
+};
+
+template<typename T>
+struct BinaryArg<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+	static size_t Size(T) { return 1 + sizeof(double); }
+	static uint8_t* Write(uint8_t* out, T value)
+	{
+		const double wide = value;
+		*out = static_cast<uint8_t>(BinaryArgType::Double);
+		memcpy(out + 1, &wide, sizeof(wide));
+		return out + 1 + sizeof(wide);
+	}
+};
+
+template<>
+struct BinaryArg<bool>
+{
+	static size_t Size(bool) { return 2; }
+	static uint8_t* Write(uint8_t* out, bool value)
+	{
+		out[0] = static_cast<uint8_t>(BinaryArgType::Bool);
+		out[1] = value ? 1 : 0;
+		return out + 2;
+	}
+};
+
+template<>
+struct BinaryArg<char>
+{
+	static size_t Size(char) { return 2; }
+	static uint8_t* Write(uint8_t* out, char value)
+	{
+		out[0] = static_cast<uint8_t>(BinaryArgType::Char);
+		out[1] = static_cast<uint8_t>(value);
+		return out + 2;
+	}
+};
+
+// Strings are the one thing copied by value, the pointer may be gone by the time the record is formatted
+struct BinaryStringArg
+{
+	static const uint32_t MaxLength = 1024;		// Longer strings are cut
+
+	static uint32_t Length(size_t length) { return static_cast<uint32_t>(length < MaxLength ? length : MaxLength); }
+	static size_t Size(size_t length) { return 1 + sizeof(uint32_t) + Length(length); }
+	static uint8_t* Write(uint8_t* out, const char* value, size_t length)
+	{
+		const uint32_t stored = Length(length);
+		*out = static_cast<uint8_t>(BinaryArgType::String);
+		memcpy(out + 1, &stored, sizeof(stored));
+		memcpy(out + 1 + sizeof(stored), value, stored);
+		return out + 1 + sizeof(stored) + stored;
+	}
+};
+
+template<>
+struct BinaryArg<const char*>
+{
+	static size_t Size(const char* value) { return BinaryStringArg::Size(value ? strlen(value) : 0); }
+	static uint8_t* Write(uint8_t* out, const char* value) { return BinaryStringArg::Write(out, value, value ? strlen(value) : 0); }
+};
+
+template<>
+struct BinaryArg<char*> : BinaryArg<const char*> {};
+
+template<>
+struct BinaryArg<std::string>
+{
+	static size_t Size(const std::string& value) { return BinaryStringArg::Size(value.size()); }
+	static uint8_t* Write(uint8_t* out, const std::string& value) { return BinaryStringArg::Write(out, value.data(), value.size()); }
+};
+
+template<typename T>
+struct BinaryArg<T*, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type>
+{
+	static size_t Size(const T*) { return 1 + sizeof(uint64_t); }
+	static uint8_t* Write(uint8_t* out, const T* value)
+	{
+		const uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+		*out = static_cast<uint8_t>(BinaryArgType::Pointer);
+		memcpy(out + 1, &address, sizeof(address));
+		return out + 1 + sizeof(address);
+	}
+};
+
+// Single producer (the owning thread), single consumer (the backend thread) byte ring of records. Records never
+// wrap, the tail end of the ring is skipped with a padding record instead.
+class BinaryLogRing {
+	public:
+		static const uint32_t RecordAlignment = 8;
+		static const uint32_t PaddingRecord = 0xFFFFFFFF;
+
+	private:
+		std::unique_ptr<uint8_t[]> m_data;
+		uint64_t m_capacity;
+		uint32_t m_threadIndex;
+		std::atomic<uint64_t> m_writePosition;
+		char m_padding[64];
+		std::atomic<uint64_t> m_readPosition;
+
+	public:
+		BinaryLogRing(uint64_t capacity, uint32_t threadIndex);
+
+		// Producer side. Null when the ring is full, nothing has to be undone then.
+		uint8_t* Reserve(uint32_t size);
+		void Commit(uint32_t size);
+
+		// Consumer side, calls process(header) for every committed record. Returns how many there were.
+		template<typename Function>
+		uint32_t Drain(Function process);
+
+		uint32_t GetThreadIndex() const { return m_threadIndex; }
+};
+
+// Logging where the calling thread only copies the call site pointer and the raw argument bytes into its own
+// ring, formatting happens later on a backend thread. That thread either formats into an spdlog logger or
+// writes the records out as they are, for BinaryLogReader to format offline. Full rings drop the record.
+class BinaryLog {
+	public:
+		static const uint64_t DefaultRingSize = 256 * 1024;
+
+	private:
+		static std::mutex s_ringsMutex;
+		static std::vector<std::unique_ptr<BinaryLogRing>> s_rings;
+		static uint64_t s_ringSize;
+		static std::atomic<bool> s_running;
+		static std::atomic<uint64_t> s_dropped;
+		static std::atomic<uint64_t> s_droppedInactive;
+		static std::atomic<uint32_t> s_generation;
+		static std::thread s_backend;
+
+		static BinaryLogRing* CreateThreadRing();
+		static BinaryLogRing* GetThreadRing()
+		{
+			// Shutdown frees the rings, a thread still holding one from before gets a new one
+			static thread_local BinaryLogRing* ring = nullptr;
+			static thread_local uint32_t ringGeneration = 0;
+			const uint32_t generation = s_generation.load(std::memory_order_relaxed);
+			if (!ring || ringGeneration != generation)
+			{
+				ring = CreateThreadRing();
+				ringGeneration = generation;
+			}
+			return ring;
+		}
+
+		static void BackendLoop(std::shared_ptr<spdlog::logger> logger, std::string path);
+		static size_t ArgsSize() { return 0; }
+		template<typename T, typename... Args>
+		static size_t ArgsSize(const T& value, const Args&... args)
+		{
+			return BinaryArg<typename std::decay<T>::type>::Size(value) + ArgsSize(args...);
+		}
+		static uint8_t* WriteArgs(uint8_t* out) { return out; }
+		template<typename T, typename... Args>
+		static uint8_t* WriteArgs(uint8_t* out, const T& value, const Args&... args)
+		{
+			return WriteArgs(BinaryArg<typename std::decay<T>::type>::Write(out, value), args...);
+		}
+
+	public:
+		// Formats every record into logger on the backend thread
+		static void Initialize(std::shared_ptr<spdlog::logger> logger, uint64_t ringSize = DefaultRingSize);
+		// Writes the records to path unformatted, read them back with BinaryLogReader
+		static void Initialize(const std::string& path, uint64_t ringSize = DefaultRingSize);
+		// Drains every ring, stops the backend thread and frees the rings, nothing else may be logging
+		static void Shutdown();
+
+		template<typename... Args>
+		static void Write(const BinaryLogSite* site, const Args&... args);
+
+		// Records lost to a full ring
+		static uint64_t GetDroppedCount() { return s_dropped.load(std::memory_order_relaxed); }
+		// Records logged before Initialize or after Shutdown
+		static uint64_t GetInactiveDroppedCount() { return s_droppedInactive.load(std::memory_order_relaxed); }
+};
+
+template<typename Function>
+uint32_t BinaryLogRing::Drain(Function process) {
+	const uint64_t write = m_writePosition.load(std::memory_order_acquire);
+	uint64_t read = m_readPosition.load(std::memory_order_relaxed);
+
+	uint32_t count = 0;
+	while (read < write)
+	{
+		const BinaryLogRecordHeader* header = reinterpret_cast<const BinaryLogRecordHeader*>(m_data.get() + read % m_capacity);
+		if (header->argCount != PaddingRecord)
+		{
+			process(*header);
+			count++;
+		}
+		read += header->size;
+	}
+
+	m_readPosition.store(read, std::memory_order_release);
+	return count;
+}
+
+template<typename... Args>
+void BinaryLog::Write(const BinaryLogSite* site, const Args&... args) {
+	if (!s_running.load(std::memory_order_relaxed))
+	{
+		s_droppedInactive.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	const size_t unpadded = sizeof(BinaryLogRecordHeader) + ArgsSize(args...);
+	const uint32_t size = static_cast<uint32_t>((unpadded + BinaryLogRing::RecordAlignment - 1) & ~static_cast<size_t>(BinaryLogRing::RecordAlignment - 1));
+
+	BinaryLogRing* ring = GetThreadRing();
+	uint8_t* record = ring->Reserve(size);
+	if (!record)
+	{
+		s_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	BinaryLogRecordHeader* header = reinterpret_cast<BinaryLogRecordHeader*>(record);
+	header->size = size;
+	header->argCount = static_cast<uint32_t>(sizeof...(Args));
+	header->site = site;
+	header->time = std::chrono::duration_cast<std::chrono::nanoseconds>(spdlog::log_clock::now().time_since_epoch()).count();
+	header->frame = Log::GetFrame();
+	WriteArgs(record + sizeof(BinaryLogRecordHeader), args...);
+
+	ring->Commit(size);
+}
+
+// Same as LOG_FRAME, but the formatting happens on the backend thread. The format string has to be a literal.
+#define LOG_BINARY(level, format, ...) do { \
+		static const BinaryLogSite binaryLogSite = { level, format, __FILE__, __LINE__ }; \
+		BinaryLog::Write(&binaryLogSite, ##__VA_ARGS__); \
+	} while (false)
+#define LOG_BINARY_INFO(format, ...) LOG_BINARY(spdlog::level::info, format, ##__VA_ARGS__)
+#define LOG_BINARY_WARN(format, ...) LOG_BINARY(spdlog::level::warn, format, ##__VA_ARGS__)
+#define LOG_BINARY_ERROR(format, ...) LOG_BINARY(spdlog::level::err, format, ##__VA_ARGS__)
@@ -0,0 +1,197 @@
+#include "BinaryLogDecoder.h"
+#include "BinaryLog.h"
+#include <spdlog/fmt/bundled/args.h>
+#include <spdlog/fmt/chrono.h>
+#include <cstring>
+#include <ctime>
+
+const char BinaryLogFormat::Magic[8] = { 'H', 'D', 'B', 'L', 'O', 'G', '0', '1' };
+
+bool FormatBinaryLogArgs(const char* format, const uint8_t* args, size_t argsSize, uint32_t argCount, std::string& out) {
+	fmt::dynamic_format_arg_store<fmt::format_context> store;
+	// Every argument takes at least a byte, don't let a bad count reserve more than that
+	store.reserve(argCount < argsSize ? argCount : argsSize, 0);
+
+	const uint8_t* end = args + argsSize;
+	const auto read = [&](void* value, size_t size) {
+		if (static_cast<size_t>(end - args) < size)
+		{
+			return false;
+		}
+		memcpy(value, args, size);
+		args += size;
+		return true;
+	};
+
+	for (uint32_t i{ 0 }; i < argCount; i++)
+	{
+		uint8_t type = 0;
+		if (!read(&type, sizeof(type)))
+		{
+			out = "<truncated binary log record>";
+			return false;
+		}
+
+		bool valid = true;
+		switch (static_cast<BinaryArgType>(type))
+		{
+			case BinaryArgType::Int64: { int64_t value = 0; valid = read(&value, sizeof(value)); store.push_back(value); break; }
+			case BinaryArgType::UInt64: { uint64_t value = 0; valid = read(&value, sizeof(value)); store.push_back(value); break; }
+			case BinaryArgType::Double: { double value = 0.0; valid = read(&value, sizeof(value)); store.push_back(value); break; }
+			case BinaryArgType::Bool: { uint8_t value = 0; valid = read(&value, sizeof(value)); store.push_back(value != 0); break; }
+			case BinaryArgType::Char: { char value = 0; valid = read(&value, sizeof(value)); store.push_back(value); break; }
+			case BinaryArgType::Pointer:
+			{
+				uint64_t value = 0;
+				valid = read(&value, sizeof(value));
+				store.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(value)));
+				break;
+			}
+			case BinaryArgType::String:
+			{
+				// The bytes stay where they are until formatting is done, no copy
+				uint32_t length = 0;
+				valid = read(&length, sizeof(length)) && static_cast<size_t>(end - args) >= length;
+				if (valid)
+				{
+					store.push_back(fmt::string_view(reinterpret_cast<const char*>(args), length));
+					args += length;
+				}
+				break;
+			}
+			default:
+				valid = false;
+				break;
+		}
+
+		if (!valid)
+		{
+			out = "<malformed binary log record>";
+			return false;
+		}
+	}
+
+	try
+	{
+		out = fmt::vformat(format, store);
+	}
+	catch (const fmt::format_error& error)
+	{
+		out = fmt::format("<format error '{}' in \"{}\">", error.what(), format);
+	}
+	return true;
+}
+
+bool BinaryLogReader::Open(const std::string& path) {
+	m_file.open(path, std::ios::in | std::ios::binary);
+	m_sites.clear();
+	m_corrupt = false;
+
+	m_file.seekg(0, std::ios::end);
+	m_size = static_cast<uint64_t>(m_file.tellg());
+	m_file.seekg(0, std::ios::beg);
+
+	char magic[sizeof(BinaryLogFormat::Magic)];
+	if (!m_file.read(magic, sizeof(magic)) || memcmp(magic, BinaryLogFormat::Magic, sizeof(magic)) != 0)
+	{
+		m_file.close();
+		return false;
+	}
+	return true;
+}
+
+uint64_t BinaryLogReader::GetRemaining() {
+	const std::streamoff position = m_file.tellg();
+	return position < 0 || static_cast<uint64_t>(position) > m_size ? 0 : m_size - static_cast<uint64_t>(position);
+}
+
+bool BinaryLogReader::ReadSite() {
+	uint32_t id = 0;
+	uint8_t level = 0;
+	int32_t line = 0;
+	uint32_t formatLength = 0;
+	uint32_t fileLength = 0;
+	Site site;
+
+	if (!m_file.read(reinterpret_cast<char*>(&id), sizeof(id)) || id != m_sites.size() ||
+		!m_file.read(reinterpret_cast<char*>(&level), sizeof(level)) || level >= spdlog::level::n_levels ||
+		!m_file.read(reinterpret_cast<char*>(&line), sizeof(line)) ||
+		!m_file.read(reinterpret_cast<char*>(&formatLength), sizeof(formatLength)) || formatLength > GetRemaining())
+	{
+		return false;
+	}
+	site.format.resize(formatLength);
+	if (!m_file.read(&site.format[0], formatLength) || !m_file.read(reinterpret_cast<char*>(&fileLength), sizeof(fileLength)) ||
+		fileLength > GetRemaining())
+	{
+		return false;
+	}
+	site.file.resize(fileLength);
+	if (!m_file.read(&site.file[0], fileLength))
+	{
+		return false;
+	}
+
+	site.level = static_cast<spdlog::level::level_enum>(level);
+	site.line = line;
+	m_sites.push_back(std::move(site));
+	return true;
+}
+
+bool BinaryLogReader::Next(BinaryLogEntry& entry) {
+	for (;;)
+	{
+		const int tag = m_file.get();
+		if (tag == std::char_traits<char>::eof())
+		{
+			return false;
+		}
+
+		if (tag == BinaryLogFormat::SiteTag)
+		{
+			if (!ReadSite())
+			{
+				m_corrupt = true;
+				return false;
+			}
+			continue;
+		}
+
+		uint32_t siteId = 0;
+		uint32_t argCount = 0;
+		uint32_t argsSize = 0;
+		if (tag != BinaryLogFormat::RecordTag ||
+			!m_file.read(reinterpret_cast<char*>(&siteId), sizeof(siteId)) || siteId >= m_sites.size() ||
+			!m_file.read(reinterpret_cast<char*>(&entry.thread), sizeof(entry.thread)) ||
+			!m_file.read(reinterpret_cast<char*>(&entry.time), sizeof(entry.time)) ||
+			!m_file.read(reinterpret_cast<char*>(&entry.frame), sizeof(entry.frame)) ||
+			!m_file.read(reinterpret_cast<char*>(&argCount), sizeof(argCount)) ||
+			!m_file.read(reinterpret_cast<char*>(&argsSize), sizeof(argsSize)) || argsSize > GetRemaining())
+		{
+			m_corrupt = true;
+			return false;
+		}
+
+		m_args.resize(argsSize);
+		if (argsSize > 0 && !m_file.read(reinterpret_cast<char*>(m_args.data()), argsSize))
+		{
+			m_corrupt = true;
+			return false;
+		}
+
+		const Site& site = m_sites[siteId];
+		entry.level = site.level;
+		entry.file = site.file.c_str();
+		entry.line = site.line;
+		FormatBinaryLogArgs(site.format.c_str(), m_args.data(), m_args.size(), argCount, entry.message);
+		return true;
+	}
+}
+
+std::string BinaryLogReader::FormatLine(const BinaryLogEntry& entry) {
+	const std::time_t seconds = static_cast<std::time_t>(entry.time / 1000000000);
+	const int64_t milliseconds = (entry.time / 1000000) % 1000;
+	const spdlog::string_view_t level = spdlog::level::to_string_view(entry.level);
+	return fmt::format("[{:%Y-%m-%d %H:%M:%S}.{:03}] [{}] [frame {}] [thread {}] {}", fmt::localtime(seconds), milliseconds,
+		fmt::string_view(level.data(), level.size()), entry.frame, entry.thread, entry.message);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <spdlog/spdlog.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Formats the (type, value) argument bytes of one binary log record with its format string. Errors in the
+// record or the format string end up in out instead of throwing. Returns false on a malformed record.
+bool FormatBinaryLogArgs(const char* format, const uint8_t* args, size_t argsSize, uint32_t argCount, std::string& out);
+
+// What's in a binary log file:
+//  "HDBLOG01"
+//  'S' site:   uint32 id, uint8 level, int32 line, uint32 length + format, uint32 length + file
+//  'R' record: uint32 site id, uint32 thread, int64 time, uint64 frame, uint32 arg count, uint32 size + args
+// Sites come before the first record that uses them. Everything little endian, as written.
+struct BinaryLogFormat
+{
+	static const char Magic[8];
+	static const uint8_t SiteTag = 'S';
+	static const uint8_t RecordTag = 'R';
+};
+
+struct BinaryLogEntry
+{
+	spdlog::level::level_enum level;
+	const char* file;		// Valid until the reader goes away
+	int line;
+	uint32_t thread;
+	int64_t time;			// Nanoseconds since the epoch
+	uint64_t frame;
+	std::string message;
+};
+
+// Reads a binary log file back and formats it, record by record
+class BinaryLogReader {
+	private:
+		struct Site
+		{
+			spdlog::level::level_enum level;
+			int line;
+			std::string format;
+			std::string file;
+		};
+
+		std::ifstream m_file;
+		uint64_t m_size = 0;
+		std::vector<Site> m_sites;
+		std::vector<uint8_t> m_args;
+		bool m_corrupt = false;
+
+		// Bytes left after the read position, no length in the file can be more than that
+		uint64_t GetRemaining();
+		bool ReadSite();
+
+	public:
+		bool Open(const std::string& path);
+		// False at the end of the file or at the first thing that doesn't parse. Nothing in the file is trusted,
+		// a corrupt or truncated one stops the reader instead of crashing it.
+		bool Next(BinaryLogEntry& entry);
+		bool IsCorrupt() const { return m_corrupt; }
+
+		// Same layout as the console logger: [time] [level] [frame N] [thread N] message
+		static std::string FormatLine(const BinaryLogEntry& entry);
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Bit scans that compile on MSVC and GCC/Clang. Results are undefined for a zero input.
+
+inline uint32_t FindLowestSetBit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+inline uint32_t FindHighestSetBit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+inline uint32_t CountSetBits(uint64_t value)
+{
+#ifdef _MSC_VER
+	return static_cast<uint32_t>(__popcnt64(value));
+#else
+	return static_cast<uint32_t>(__builtin_popcountll(value));
+#endif
+}
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
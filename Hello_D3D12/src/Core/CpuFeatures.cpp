@@ -0,0 +1,112 @@
+#include "CpuFeatures.h"
+#include <atomic>
+#include <cstdint>
+
+#ifdef CPU_FEATURES_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef CPU_FEATURES_X86
+
+static void Cpuid(int leaf, int subleaf, uint32_t registers[4]) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	int values[4];
+	__cpuidex(values, leaf, subleaf);
+	for (int i{ 0 }; i < 4; i++)
+	{
+		registers[i] = static_cast<uint32_t>(values[i]);
+	}
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// Which register files the OS saves on a context switch, wider registers are useless without it
+static uint64_t ReadXcr0() {
+#if defined(_MSC_VER) && !defined(__clang__)
+	return _xgetbv(0);
+#else
+	uint32_t low, high;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+
+static SimdLevel DetectSimdLevel() {
+	uint32_t registers[4];
+	Cpuid(0, 0, registers);
+	const uint32_t maxLeaf = registers[0];
+
+	Cpuid(1, 0, registers);
+	const bool sse2 = (registers[3] & (1u << 26)) != 0;
+	const bool fma = (registers[2] & (1u << 12)) != 0;
+	const bool osxsave = (registers[2] & (1u << 27)) != 0;
+	const bool avx = (registers[2] & (1u << 28)) != 0;
+	const bool f16c = (registers[2] & (1u << 29)) != 0;
+	if (!sse2)
+	{
+		return SimdLevel::Scalar;
+	}
+	if (!osxsave || !avx || !fma || !f16c || maxLeaf < 7)
+	{
+		return SimdLevel::SSE2;
+	}
+
+	const uint64_t xcr0 = ReadXcr0();
+	const bool ymmSaved = (xcr0 & 0x6) == 0x6;
+	const bool zmmSaved = (xcr0 & 0xE6) == 0xE6;
+
+	Cpuid(7, 0, registers);
+	const bool avx2 = (registers[1] & (1u << 5)) != 0;
+	const bool avx512f = (registers[1] & (1u << 16)) != 0;
+
+	if (avx2 && avx512f && zmmSaved)
+	{
+		return SimdLevel::AVX512;
+	}
+	if (avx2 && ymmSaved)
+	{
+		return SimdLevel::AVX2;
+	}
+	return SimdLevel::SSE2;
+}
+
+#else
+
+static SimdLevel DetectSimdLevel() {
+	return SimdLevel::Scalar;
+}
+
+#endif
+
+SimdLevel GetCpuSimdLevel() {
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+// Relaxed is enough, SetSimdLevel isn't allowed to race the kernels anyway
+static std::atomic<SimdLevel> s_simdLevelCap{ SimdLevel::AVX512 };
+
+SimdLevel GetSimdLevel() {
+	const SimdLevel cap = s_simdLevelCap.load(std::memory_order_relaxed);
+	const SimdLevel supported = GetCpuSimdLevel();
+	return cap < supported ? cap : supported;
+}
+
+void SetSimdLevel(SimdLevel level) {
+	s_simdLevelCap.store(level, std::memory_order_relaxed);
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+	switch (level)
+	{
+		case SimdLevel::SSE2: return "SSE2";
+		case SimdLevel::AVX2: return "AVX2";
+		case SimdLevel::AVX512: return "AVX-512";
+		default: return "Scalar";
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86
+#endif
+
+// Widest vector instruction set the CPU and the OS both support, in increasing order
+enum class SimdLevel
+{
+	Scalar,
+	SSE2,
+	AVX2,		// Includes FMA and F16C, every AVX2 CPU has both
+	AVX512		// AVX-512F
+};
+
+// Detected once on first use
+SimdLevel GetCpuSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
+// What every SIMD kernel table (transforms, frustum culling, procedural textures, mip chains, block compression)
+// picks its kernels for: the CPU's level, unless SetSimdLevel capped it lower.
+SimdLevel GetSimdLevel();
+// Caps GetSimdLevel, anything above what the CPU has is clamped. Lets the tests and benchmarks run every path
+// against the scalar one on the same machine. The tables switch on their next call.
+void SetSimdLevel(SimdLevel level);
+
+// A kernel table for every level, built once by the first caller (a function local static of these is thread
+// safe) and picked by GetSimdLevel on each Get, so SetSimdLevel never rewrites a table someone else is using.
+// make only fills in function pointers, it's called for levels the CPU doesn't have too.
+template<typename Table>
+class SimdKernelTables {
+	private:
+		Table m_tables[static_cast<int>(SimdLevel::AVX512) + 1];
+
+	public:
+		explicit SimdKernelTables(Table (*make)(SimdLevel)) {
+			for (int level{ 0 }; level <= static_cast<int>(SimdLevel::AVX512); level++)
+			{
+				m_tables[level] = make(static_cast<SimdLevel>(level));
+			}
+		}
+
+		const Table& Get() const { return m_tables[static_cast<int>(GetSimdLevel())]; }
+};
+
+// Functions built for a wider instruction set than the rest of the program, only call them after checking
+// GetCpuSimdLevel. MSVC lets any function use any intrinsic, GCC and Clang need to be told per function.
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma,f16c")))
+#endif
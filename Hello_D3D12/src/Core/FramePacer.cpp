@@ -0,0 +1,226 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+// std::min and std::max below
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace
+{
+	const int64_t NanosecondsPerSecond = 1000000000;
+	// Never sleep closer than this to a deadline, whatever the measured overshoot says
+	const int64_t MinimumSpinTime = 200000;
+	// Sleeps are chopped up so a single late wake can't take us far past the deadline
+	const int64_t MaximumSleepChunk = 2000000;
+	// Spin at most this part of a period, 1 / n
+	const int64_t MaximumSpinDivisor = 4;
+	// How fast the overshoot estimate comes back down, 1 / n of the way per sleep or per frame without one
+	const int64_t OvershootDecayDivisor = 16;
+}
+
+#ifdef _WIN32
+
+SteadyPacerClock::SteadyPacerClock() {
+	m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!m_timer)
+	{
+		m_raisedTimerPeriod = timeBeginPeriod(1) == TIMERR_NOERROR;
+	}
+}
+
+SteadyPacerClock::~SteadyPacerClock() {
+	if (m_timer)
+	{
+		CloseHandle(m_timer);
+	}
+	if (m_raisedTimerPeriod)
+	{
+		timeEndPeriod(1);
+	}
+}
+
+void SteadyPacerClock::SleepFor(int64_t nanoseconds) {
+	if (!m_timer)
+	{
+		std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+		return;
+	}
+
+	// Negative is relative, in 100ns ticks
+	LARGE_INTEGER dueTime;
+	dueTime.QuadPart = -std::max<int64_t>(1, nanoseconds / 100);
+	if (SetWaitableTimerEx(m_timer, &dueTime, 0, nullptr, nullptr, nullptr, 0))
+	{
+		WaitForSingleObject(m_timer, INFINITE);
+	}
+}
+
+#else
+
+SteadyPacerClock::SteadyPacerClock() {
+}
+
+SteadyPacerClock::~SteadyPacerClock() {
+}
+
+void SteadyPacerClock::SleepFor(int64_t nanoseconds) {
+	std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+}
+
+#endif
+
+int64_t SteadyPacerClock::Now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SteadyPacerClock::Spin() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+// std::min takes it by reference
+const uint32_t FramePacer::HistorySize;
+
+FramePacer::FramePacer() {
+	std::fill(m_history, m_history + HistorySize, 0.0);
+}
+
+void FramePacer::Initialize(PacerClock* clock, double targetFrameRate) {
+	m_clock = clock;
+	m_started = false;
+	m_sleepOvershoot = 0;
+	m_historyCount = 0;
+	m_historyNext = 0;
+	m_stats = FramePacerStats();
+	SetTargetFrameRate(targetFrameRate);
+}
+
+void FramePacer::SetTargetFrameRate(double targetFrameRate) {
+	m_period = targetFrameRate > 0.0 ? static_cast<int64_t>(NanosecondsPerSecond / targetFrameRate) : 0;
+	// New rate, new schedule
+	if (m_started)
+	{
+		m_nextDeadline = m_clock->Now() + m_period;
+	}
+}
+
+void FramePacer::WaitUntil(int64_t deadline) {
+	int64_t now = m_clock->Now();
+
+	// Sleep while there's clearly more time left than a sleep could overshoot by. Never spin most of a frame away,
+	// a sleep that once woke a whole frame late says little about the next one.
+	const int64_t maximumSpinTime = std::max(MinimumSpinTime, m_period / MaximumSpinDivisor);
+	const int64_t spinTime = std::min(std::max(MinimumSpinTime, m_sleepOvershoot), maximumSpinTime);
+	if (deadline - now <= spinTime)
+	{
+		// No sleep to measure, let the estimate come down anyway so a frame that's always close to its deadline
+		// doesn't keep it high
+		m_sleepOvershoot -= m_sleepOvershoot / OvershootDecayDivisor;
+	}
+	while (deadline - now > spinTime)
+	{
+		const int64_t sleep = std::min(deadline - now - spinTime, MaximumSleepChunk);
+		m_clock->SleepFor(sleep);
+
+		const int64_t woke = m_clock->Now();
+		const int64_t overshoot = std::max<int64_t>(0, (woke - now) - sleep);
+		// Jump up to a bad wake straight away, come back down slowly
+		m_sleepOvershoot = overshoot > m_sleepOvershoot ? overshoot : m_sleepOvershoot - (m_sleepOvershoot - overshoot) / OvershootDecayDivisor;
+		now = woke;
+	}
+
+	while (now < deadline)
+	{
+		m_clock->Spin();
+		now = m_clock->Now();
+	}
+}
+
+void FramePacer::Record(double frameTime) {
+	m_history[m_historyNext] = frameTime;
+	m_historyNext = (m_historyNext + 1) % HistorySize;
+	m_historyCount = std::min(m_historyCount + 1, HistorySize);
+
+	// Two passes over a small window, not worth a running sum that drifts
+	double sum = 0.0;
+	double minFrameTime = m_history[0];
+	double maxFrameTime = m_history[0];
+	for (uint32_t i{ 0 }; i < m_historyCount; i++)
+	{
+		sum += m_history[i];
+		minFrameTime = std::min(minFrameTime, m_history[i]);
+		maxFrameTime = std::max(maxFrameTime, m_history[i]);
+	}
+	const double mean = sum / m_historyCount;
+
+	double squares = 0.0;
+	for (uint32_t i{ 0 }; i < m_historyCount; i++)
+	{
+		squares += (m_history[i] - mean) * (m_history[i] - mean);
+	}
+
+	m_stats.frameTime = frameTime;
+	m_stats.smoothedFrameTime = m_stats.frameCount == 0 ? frameTime : m_stats.smoothedFrameTime + (frameTime - m_stats.smoothedFrameTime) * m_smoothing;
+	m_stats.meanFrameTime = mean;
+	m_stats.frameTimeVariance = squares / m_historyCount;
+	m_stats.minFrameTime = minFrameTime;
+	m_stats.maxFrameTime = maxFrameTime;
+	m_stats.sleepOvershoot = static_cast<double>(m_sleepOvershoot) / NanosecondsPerSecond;
+	m_stats.frameCount++;
+}
+
+double FramePacer::WaitForNextFrame() {
+	if (!m_started)
+	{
+		// First frame has nothing to measure against
+		m_started = true;
+		m_lastFrameStart = m_clock->Now();
+		m_nextDeadline = m_lastFrameStart + m_period;
+		return 0.0;
+	}
+
+	if (m_period > 0)
+	{
+		WaitUntil(m_nextDeadline);
+	}
+
+	const int64_t frameStart = m_clock->Now();
+	if (m_period > 0)
+	{
+		// More than a whole period late, drop the missed deadlines instead of rushing frames out to catch up
+		if (frameStart - m_nextDeadline >= m_period)
+		{
+			m_stats.missedFrames++;
+			m_nextDeadline = frameStart + m_period;
+		}
+		else
+		{
+			m_nextDeadline += m_period;
+		}
+	}
+
+	const double frameTime = static_cast<double>(frameStart - m_lastFrameStart) / NanosecondsPerSecond;
+	m_lastFrameStart = frameStart;
+	Record(frameTime);
+	return frameTime;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+
+// Where the pacer gets its time from, nanoseconds on a monotonic clock
+class PacerClock {
+	public:
+		virtual ~PacerClock() = default;
+		virtual int64_t Now() = 0;
+		// May come back late, never early
+		virtual void SleepFor(int64_t nanoseconds) = 0;
+		// One iteration of a busy wait
+		virtual void Spin() = 0;
+};
+
+// steady_clock, QueryPerformanceCounter underneath on Windows. Sleeps on Windows go through a high resolution
+// waitable timer, or with the 1ms timer period raised where there's none (before Windows 10 1803), the default
+// 15.6ms tick would oversleep most of a frame.
+class SteadyPacerClock : public PacerClock {
+	private:
+#ifdef _WIN32
+		void* m_timer = nullptr;
+		bool m_raisedTimerPeriod = false;
+#endif
+
+	public:
+		SteadyPacerClock();
+		~SteadyPacerClock();
+		SteadyPacerClock(const SteadyPacerClock&) = delete;
+		SteadyPacerClock& operator=(const SteadyPacerClock&) = delete;
+
+		int64_t Now() override;
+		void SleepFor(int64_t nanoseconds) override;
+		void Spin() override;
+};
+
+// Time only moves when the pacer sleeps or spins, so waits are exact and repeatable
+class FakePacerClock : public PacerClock {
+	private:
+		int64_t m_now = 0;
+		int64_t m_oversleep = 0;
+		int64_t m_spinStep = 1000;
+
+	public:
+		int64_t Now() override { return m_now; }
+		void SleepFor(int64_t nanoseconds) override { m_now += nanoseconds + m_oversleep; }
+		void Spin() override { m_now += m_spinStep; }
+
+		void Advance(int64_t nanoseconds) { m_now += nanoseconds; }
+		// How late every sleep wakes up, like an OS timer with coarse granularity
+		void SetOversleep(int64_t nanoseconds) { m_oversleep = nanoseconds; }
+		void SetSpinStep(int64_t nanoseconds) { m_spinStep = nanoseconds; }
+};
+
+struct FramePacerStats
+{
+	double frameTime = 0.0;				// Seconds, last frame start to this one
+	double smoothedFrameTime = 0.0;		// Exponential moving average
+	double meanFrameTime = 0.0;			// Over the last HistorySize frames
+	double frameTimeVariance = 0.0;		// Seconds squared, same window
+	double minFrameTime = 0.0;
+	double maxFrameTime = 0.0;
+	double sleepOvershoot = 0.0;		// Seconds, how late sleeps are waking up, what the spin has to cover
+	uint64_t frameCount = 0;
+	uint64_t missedFrames = 0;			// Frames that started later than a whole period past their deadline
+};
+
+// Holds each frame to a target rate. Sleeps until it is close to the deadline, then spins the rest, so the frame
+// starts within a spin step of the deadline rather than within the OS timer's granularity. How close it dares to
+// sleep follows how late sleeps have actually been waking up, capped to a quarter period so one terrible wake
+// can't turn it into a busy loop. Deadlines advance by whole periods, a frame that
+// runs long is caught up on once and the schedule restarts rather than rushing several frames out.
+class FramePacer {
+	public:
+		static const uint32_t HistorySize = 120;
+
+	private:
+		PacerClock* m_clock = nullptr;
+		int64_t m_period = 0;				// Zero when uncapped
+		int64_t m_nextDeadline = 0;
+		int64_t m_lastFrameStart = 0;
+		bool m_started = false;
+
+		int64_t m_sleepOvershoot = 0;		// Worst recent overshoot, decays slowly, also on frames that don't sleep
+		double m_smoothing = 0.1;
+
+		double m_history[HistorySize];
+		uint32_t m_historyCount = 0;
+		uint32_t m_historyNext = 0;
+		FramePacerStats m_stats;
+
+		void WaitUntil(int64_t deadline);
+		void Record(double frameTime);
+
+	public:
+		FramePacer();
+
+		// Zero or a negative rate is uncapped
+		void Initialize(PacerClock* clock, double targetFrameRate);
+		void SetTargetFrameRate(double targetFrameRate);
+		bool IsUncapped() const { return m_period == 0; }
+
+		// Call once at the start of every frame. Blocks until it's time for the frame, returns the seconds since
+		// the last frame started.
+		double WaitForNextFrame();
+
+		// smoothing is the weight of the newest frame in smoothedFrameTime
+		void SetSmoothing(double smoothing) { m_smoothing = smoothing; }
+		const FramePacerStats& GetStats() const { return m_stats; }
+};
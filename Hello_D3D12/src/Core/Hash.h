@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Stable 64 bit hashing (FNV-1a), the values end up on disk so they must not change between runs or platforms
+
+const uint64_t HashSeed = 0xcbf29ce484222325ull;
+
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = HashSeed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i{ 0 }; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+inline uint64_t HashString(const std::string& value, uint64_t seed = HashSeed)
+{
+	// Hash the length too so "ab" + "c" and "a" + "bc" don't collide when combined
+	const uint64_t length = value.size();
+	return HashBytes(value.data(), value.size(), HashBytes(&length, sizeof(length), seed));
+}
+
+template<typename T>
+inline uint64_t HashValue(const T& value, uint64_t seed = HashSeed)
+{
+	return HashBytes(&value, sizeof(T), seed);
+}
+
+inline uint64_t HashCombine(uint64_t seed, uint64_t value)
+{
+	return HashBytes(&value, sizeof(value), seed);
+}
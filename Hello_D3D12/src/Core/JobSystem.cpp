@@ -0,0 +1,342 @@
+#include "JobSystem.h"
+#include <cassert>
+
+struct Job
+{
+	JobSystem::JobFunction function;
+	JobCounter* counter;
+	bool pinned;
+};
+
+namespace
+{
+	// Which JobSystem thread this is, set once per thread
+	thread_local uint32_t t_threadIndex = JobSystem::InvalidThread;
+	thread_local JobSystem* t_jobSystem = nullptr;
+}
+
+JobSystem::JobSystem() {
+	m_queuedJobs.store(0);
+	m_pinnedQueued.store(0);
+	m_sleepingWorkers.store(0);
+}
+
+JobSystem::~JobSystem() {
+	Shutdown();
+}
+
+uint32_t JobSystem::GetThreadIndex() {
+	return t_threadIndex;
+}
+
+void JobSystem::Initialize(uint32_t workerCount) {
+	Shutdown();
+
+	m_stopping = false;
+	for (uint32_t i{ 0 }; i < workerCount + 1; i++)
+	{
+		m_contexts.emplace_back(new ThreadContext());
+	}
+
+	t_threadIndex = 0;
+	t_jobSystem = this;
+
+	for (uint32_t i{ 0 }; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+	}
+}
+
+void JobSystem::Shutdown() {
+	if (m_contexts.empty())
+	{
+		return;
+	}
+
+	// Drain everything, pinned jobs included, so no counter is left hanging
+	while (m_queuedJobs.load(std::memory_order_acquire) > 0 || m_pinnedQueued.load(std::memory_order_acquire) > 0)
+	{
+		if (!RunOne(true))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+
+	m_workers.clear();
+	m_contexts.clear();
+	if (t_jobSystem == this)
+	{
+		t_threadIndex = InvalidThread;
+		t_jobSystem = nullptr;
+	}
+}
+
+void JobSystem::Run(JobFunction function, JobCounter* counter, JobCounter* dependency) {
+	Enqueue(std::move(function), counter, dependency, false);
+}
+
+void JobSystem::RunPinned(JobFunction function, JobCounter* counter, JobCounter* dependency) {
+	Enqueue(std::move(function), counter, dependency, true);
+}
+
+void JobSystem::Enqueue(JobFunction function, JobCounter* counter, JobCounter* dependency, bool pinned) {
+	Job* job = new Job{ std::move(function), counter, pinned };
+	if (counter)
+	{
+		counter->m_value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// Parked on the dependency until it's done, whoever finishes it schedules the job
+	if (dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->m_mutex);
+		if (!dependency->IsDone())
+		{
+			dependency->m_waiters.push_back(job);
+			return;
+		}
+	}
+
+	Schedule(job);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, RangeFunction function, JobCounter* counter) {
+	assert(batchSize > 0);
+
+	// Shared so every batch doesn't copy the function
+	std::shared_ptr<RangeFunction> shared = std::make_shared<RangeFunction>(std::move(function));
+	for (uint32_t begin{ 0 }; begin < count; begin += batchSize)
+	{
+		const uint32_t end = count - begin < batchSize ? count : begin + batchSize;
+		Run([shared, begin, end]() { (*shared)(begin, end); }, counter);
+	}
+}
+
+void JobSystem::Schedule(Job* job) {
+
+	// Pinned jobs are the main thread's business, no worker needs waking for them
+	if (job->pinned)
+	{
+		m_pinnedQueued.fetch_add(1, std::memory_order_release);
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_pinnedJobs.push_back(job);
+		return;
+	}
+
+	m_queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+	const bool ownThread = t_jobSystem == this && t_threadIndex != InvalidThread;
+	if (!ownThread)
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_sharedJobs.push_back(job);
+	}
+	else if (!m_contexts[t_threadIndex]->deque.Push(job))
+	{
+		// Deque is full, cheaper to just do it than to grow it
+		m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		m_contexts[t_threadIndex]->ranInline++;
+		Execute(job, m_contexts[t_threadIndex].get());
+		return;
+	}
+
+	if (m_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_wake.notify_one();
+	}
+}
+
+void JobSystem::Execute(Job* job, ThreadContext* context) {
+	job->function();
+	if (context)
+	{
+		context->executed++;
+	}
+
+	JobCounter* counter = job->counter;
+	delete job;
+
+	if (counter)
+	{
+		Finish(counter);
+	}
+}
+
+void JobSystem::Finish(JobCounter* counter) {
+
+	// Not the last one, nobody can be done with the counter yet so no lock needed
+	uint32_t value = counter->m_value.load(std::memory_order_relaxed);
+	while (value > 1)
+	{
+		if (counter->m_value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+		{
+			return;
+		}
+	}
+
+	// Possibly the last one. Hitting zero happens under the lock so Wait can use the lock to know we're out.
+	std::vector<Job*> waiters;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (counter->m_value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			waiters.swap(counter->m_waiters);
+		}
+	}
+
+	for (Job* waiter : waiters)
+	{
+		Schedule(waiter);
+	}
+}
+
+Job* JobSystem::FindJob(ThreadContext* context, bool mainThread) {
+	Job* job = context ? context->deque.Pop() : nullptr;
+	if (job)
+	{
+		return job;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (mainThread && !m_pinnedJobs.empty())
+		{
+			job = m_pinnedJobs.front();
+			m_pinnedJobs.pop_front();
+			return job;
+		}
+		if (!m_sharedJobs.empty())
+		{
+			job = m_sharedJobs.front();
+			m_sharedJobs.pop_front();
+			return job;
+		}
+	}
+
+	// Walk the other deques starting somewhere different each time so thieves spread out
+	const uint32_t threadCount = static_cast<uint32_t>(m_contexts.size());
+	const uint32_t start = context ? context->stealCursor++ : 0;
+	for (uint32_t i{ 0 }; i < threadCount; i++)
+	{
+		ThreadContext* victim = m_contexts[(start + i) % threadCount].get();
+		if (victim == context)
+		{
+			continue;
+		}
+
+		job = victim->deque.Steal();
+		if (job)
+		{
+			if (context)
+			{
+				context->stolen++;
+			}
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+bool JobSystem::RunOne(bool allowPinned) {
+	const bool ownThread = t_jobSystem == this && t_threadIndex != InvalidThread;
+	ThreadContext* context = ownThread ? m_contexts[t_threadIndex].get() : nullptr;
+
+	Job* job = FindJob(context, allowPinned && ownThread && t_threadIndex == 0);
+	if (!job)
+	{
+		return false;
+	}
+
+	if (job->pinned)
+	{
+		m_pinnedQueued.fetch_sub(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+	Execute(job, context);
+	return true;
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+	while (!counter.IsDone())
+	{
+		if (!RunOne(true))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Whoever took it to zero may still be unlocking, after this it's safe to destroy
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::RunPinnedJobs() {
+	assert(t_jobSystem == this && t_threadIndex == 0);
+
+	while (true)
+	{
+		Job* job = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			if (m_pinnedJobs.empty())
+			{
+				return;
+			}
+			job = m_pinnedJobs.front();
+			m_pinnedJobs.pop_front();
+		}
+
+		m_pinnedQueued.fetch_sub(1, std::memory_order_relaxed);
+		Execute(job, m_contexts[0].get());
+	}
+}
+
+void JobSystem::WorkerLoop(uint32_t threadIndex) {
+	t_threadIndex = threadIndex;
+	t_jobSystem = this;
+
+	while (true)
+	{
+		if (RunOne(false))
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		if (m_stopping && m_queuedJobs.load(std::memory_order_seq_cst) == 0)
+		{
+			return;
+		}
+
+		m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		m_wake.wait(lock, [this] { return m_stopping || m_queuedJobs.load(std::memory_order_seq_cst) > 0; });
+		m_sleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+	}
+}
+
+JobSystemStats JobSystem::GetStats() const {
+	JobSystemStats stats;
+	stats.threadCount = static_cast<uint32_t>(m_contexts.size());
+	for (const std::unique_ptr<ThreadContext>& context : m_contexts)
+	{
+		stats.executed += context->executed;
+		stats.stolen += context->stolen;
+		stats.ranInline += context->ranInline;
+	}
+	return stats;
+}
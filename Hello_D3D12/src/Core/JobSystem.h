@@ -0,0 +1,120 @@
+#pragma once
+#include "WorkStealingDeque.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+struct Job;
+
+// Counts unfinished jobs. Every job run with it bumps it and drops it when done, Wait on it to join them, or
+// pass it as another job's dependency to hold that job back until it hits zero. Can be reused once it's zero.
+// Only destroy it after a Wait on it returned, IsDone alone doesn't mean the last job has let go of it.
+class JobCounter {
+	friend class JobSystem;
+
+	private:
+		std::atomic<uint32_t> m_value;
+		std::mutex m_mutex;
+		std::vector<Job*> m_waiters;		// Jobs that depend on this counter
+
+	public:
+		JobCounter() { m_value.store(0); }
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool IsDone() const { return m_value.load(std::memory_order_acquire) == 0; }
+};
+
+struct JobSystemStats
+{
+	uint32_t threadCount = 0;
+	uint64_t executed = 0;
+	uint64_t stolen = 0;
+	uint64_t ranInline = 0;		// Own deque was full
+};
+
+// Task scheduler over one work stealing deque per thread. Thread 0 is whoever called Initialize (the main
+// thread), the rest are workers. Jobs pushed from a thread go on its own deque, idle threads steal from the
+// others. Jobs pinned to the main thread sit in their own queue and only run when the main thread waits or calls
+// RunPinnedJobs, for anything that has to happen there (window, D3D queue submission, SDL). Threads that aren't
+// part of the system can still run jobs, those go through a shared queue. Plain threads, no fibers, so a job that
+// waits keeps running other jobs on its stack until its counter is done.
+class JobSystem {
+	public:
+		typedef std::function<void()> JobFunction;
+		// [begin, end) of the range a ParallelFor batch covers
+		typedef std::function<void(uint32_t begin, uint32_t end)> RangeFunction;
+
+	private:
+		struct ThreadContext
+		{
+			WorkStealingDeque<Job> deque;
+			uint64_t executed = 0;
+			uint64_t stolen = 0;
+			uint64_t ranInline = 0;
+			uint32_t stealCursor = 0;
+		};
+
+		std::vector<std::unique_ptr<ThreadContext>> m_contexts;
+		std::vector<std::thread> m_workers;
+
+		// Main thread only jobs, and jobs from threads the system doesn't know
+		std::mutex m_queueMutex;
+		std::deque<Job*> m_pinnedJobs;
+		std::deque<Job*> m_sharedJobs;
+
+		// Idle workers sleep here, m_queuedJobs (everything but pinned jobs) stops wakeups from getting lost
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		std::atomic<uint32_t> m_queuedJobs;
+		std::atomic<uint32_t> m_pinnedQueued;
+		std::atomic<uint32_t> m_sleepingWorkers;
+		bool m_stopping = false;
+
+		void Enqueue(JobFunction function, JobCounter* counter, JobCounter* dependency, bool pinned);
+		void Schedule(Job* job);
+		void Execute(Job* job, ThreadContext* context);
+		void Finish(JobCounter* counter);
+		Job* FindJob(ThreadContext* context, bool mainThread);
+		bool RunOne(bool allowPinned);
+		void WorkerLoop(uint32_t threadIndex);
+
+	public:
+		JobSystem();
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// Zero workers runs everything on whichever thread waits
+		void Initialize(uint32_t workerCount);
+		// Runs everything still queued, then joins the workers. Main thread only, no jobs may be added meanwhile
+		// from outside the system.
+		void Shutdown();
+
+		// counter (optional) counts the job, dependency (optional) holds it back until that counter is done
+		void Run(JobFunction function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+		// Only ever runs on the main thread, from Wait or RunPinnedJobs
+		void RunPinned(JobFunction function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+		// Splits [0, count) into batches of batchSize and runs them as separate jobs
+		void ParallelFor(uint32_t count, uint32_t batchSize, RangeFunction function, JobCounter* counter);
+
+		// Runs jobs (pinned ones too on the main thread) until counter is done
+		void Wait(JobCounter& counter);
+		// Drains the pinned queue, main thread only
+		void RunPinnedJobs();
+
+		// 0 for the main thread, 1..workers for the workers, InvalidThread for anyone else
+		static const uint32_t InvalidThread = 0xFFFFFFFF;
+		static uint32_t GetThreadIndex();
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_contexts.size()); }
+
+		// Only exact while nothing is running
+		JobSystemStats GetStats() const;
+};
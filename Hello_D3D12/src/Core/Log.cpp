@@ -0,0 +1,54 @@
+#include "Log.h"
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+std::shared_ptr<spdlog::details::thread_pool> Log::s_threadPool;
+std::shared_ptr<spdlog::logger> Log::s_hotLogger;
+std::atomic<uint64_t> Log::s_frame{ 0 };
+
+void Log::Initialize(size_t queueSize) {
+	// The queue's slots are allocated once here, messages reuse their buffers after that
+	s_threadPool = std::make_shared<spdlog::details::thread_pool>(queueSize, 1);
+
+	// Only the background thread ever writes to the sink
+	spdlog::sink_ptr sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+
+	std::shared_ptr<spdlog::logger> logger = std::make_shared<spdlog::async_logger>("engine", sink, s_threadPool,
+		spdlog::async_overflow_policy::block);
+	s_hotLogger = std::make_shared<spdlog::async_logger>("engine_hot", sink, s_threadPool,
+		spdlog::async_overflow_policy::discard_new);
+
+	// Errors usually come right before things go wrong, get them out
+	logger->flush_on(spdlog::level::err);
+	s_hotLogger->flush_on(spdlog::level::err);
+
+	spdlog::set_default_logger(logger);
+}
+
+void Log::Shutdown() {
+	if (!s_threadPool)
+	{
+		return;
+	}
+
+	const size_t discarded = s_threadPool->discard_counter();
+	if (discarded > 0)
+	{
+		spdlog::warn("{} hot log messages were dropped on a full queue", discarded);
+	}
+
+	// Queued messages hold on to their logger, so letting go of ours is fine. The pool drains the queue and
+	// joins its thread. The synchronous fallback isn't registered by name (stdout_color_mt would), so it can't
+	// collide with the one a previous Shutdown left behind.
+	spdlog::set_default_logger(std::make_shared<spdlog::logger>("engine_sync", std::make_shared<spdlog::sinks::stdout_color_sink_mt>()));
+	s_hotLogger.reset();
+	s_threadPool.reset();
+}
+
+size_t Log::GetDiscardedCount() {
+	return s_threadPool ? s_threadPool->discard_counter() : 0;
+}
+
+size_t Log::GetQueuedCount() {
+	return s_threadPool ? s_threadPool->queue_size() : 0;
+}
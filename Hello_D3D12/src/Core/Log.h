@@ -0,0 +1,48 @@
+#pragma once
+#include <spdlog/spdlog.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Logging goes through spdlog's async logger, calls format into a preallocated queue and one background thread
+// does the console I/O. The default logger (plain spdlog::info and friends) blocks when the queue is full so
+// nothing gets lost, the hot logger shares the queue and sinks but drops the message instead, for logging in
+// the frame where a stall is worse than a missing line. LOG_FRAME_* and LOG_HOT_* put the frame number on
+// the message when it's made, not when the background thread gets to it.
+class Log {
+	public:
+		static const size_t DefaultQueueSize = 8192;
+
+	private:
+		static std::shared_ptr<spdlog::details::thread_pool> s_threadPool;
+		static std::shared_ptr<spdlog::logger> s_hotLogger;
+		static std::atomic<uint64_t> s_frame;
+
+	public:
+		// Swaps the default logger for the async one, call before any other thread logs
+		static void Initialize(size_t queueSize = DefaultQueueSize);
+		// Drains the queue and puts a synchronous default logger back, nothing else may be logging
+		static void Shutdown();
+
+		static void SetFrame(uint64_t frame) { s_frame.store(frame, std::memory_order_relaxed); }
+		static uint64_t GetFrame() { return s_frame.load(std::memory_order_relaxed); }
+
+		// Falls back to the default logger before Initialize
+		static spdlog::logger* GetHotLogger() { return s_hotLogger ? s_hotLogger.get() : spdlog::default_logger_raw(); }
+		// Messages the hot logger dropped because the queue was full
+		static size_t GetDiscardedCount();
+		// Messages waiting for the background thread
+		static size_t GetQueuedCount();
+};
+
+// The format string has to be a literal, the frame tag is glued on in front of it
+#define LOG_FRAME(level, format, ...) spdlog::default_logger_raw()->log(level, "[frame {}] " format, Log::GetFrame(), ##__VA_ARGS__)
+#define LOG_FRAME_INFO(format, ...) LOG_FRAME(spdlog::level::info, format, ##__VA_ARGS__)
+#define LOG_FRAME_WARN(format, ...) LOG_FRAME(spdlog::level::warn, format, ##__VA_ARGS__)
+#define LOG_FRAME_ERROR(format, ...) LOG_FRAME(spdlog::level::err, format, ##__VA_ARGS__)
+
+// Never blocks, dropped if the queue is full
+#define LOG_HOT(level, format, ...) Log::GetHotLogger()->log(level, "[frame {}] " format, Log::GetFrame(), ##__VA_ARGS__)
+#define LOG_HOT_INFO(format, ...) LOG_HOT(spdlog::level::info, format, ##__VA_ARGS__)
+#define LOG_HOT_WARN(format, ...) LOG_HOT(spdlog::level::warn, format, ##__VA_ARGS__)
+#define LOG_HOT_ERROR(format, ...) LOG_HOT(spdlog::level::err, format, ##__VA_ARGS__)
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file, Win32 or POSIX underneath
+class MappedFile {
+	private:
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+
+#ifdef _WIN32
+		void* m_fileHandle = nullptr;
+		void* m_mappingHandle = nullptr;
+#else
+		int m_fileDescriptor = -1;
+#endif
+
+	public:
+		MappedFile() = default;
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Fails for missing or empty files
+		bool Open(const std::string& path);
+		void Close();
+
+		bool IsOpen() const { return m_data != nullptr; }
+		const uint8_t* GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+};
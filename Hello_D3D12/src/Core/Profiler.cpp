@@ -0,0 +1,154 @@
+#include "Profiler.h"
+#include <chrono>
+#include <fstream>
+
+namespace
+{
+	// The calling thread's track, and the profiler it belongs to
+	thread_local Profiler* t_trackOwner = nullptr;
+	thread_local ProfileTrack* t_track = nullptr;
+
+	void WriteEscaped(std::ostream& out, const char* text)
+	{
+		for (const char* c = text; *c; c++)
+		{
+			switch (*c)
+			{
+			case '"': out << "\\\""; break;
+			case '\\': out << "\\\\"; break;
+			case '\n': out << "\\n"; break;
+			default:
+				if (static_cast<unsigned char>(*c) < 0x20)
+				{
+					// Other control characters have no place in a zone name
+					out << ' ';
+				}
+				else
+				{
+					out << *c;
+				}
+				break;
+			}
+		}
+	}
+}
+
+ProfileTrack::ProfileTrack(const std::string& name, uint32_t id, uint32_t capacity)
+	: m_name(name), m_id(id), m_events(new ProfileEvent[capacity]), m_capacity(capacity) {
+	m_count.store(0);
+	m_dropped.store(0);
+}
+
+Profiler::Profiler() {
+	m_capturing.store(false);
+	m_clock = &Profiler::SteadyClockNow;
+}
+
+Profiler& Profiler::Get() {
+	static Profiler profiler;
+	return profiler;
+}
+
+int64_t Profiler::SteadyClockNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ProfileTrack* Profiler::AddTrack(const std::string& name) {
+	std::lock_guard<std::mutex> lock(m_tracksMutex);
+	const uint32_t id = static_cast<uint32_t>(m_tracks.size());
+	m_tracks.emplace_back(new ProfileTrack(name.empty() ? "Thread " + std::to_string(id) : name, id, m_trackCapacity));
+	return m_tracks.back().get();
+}
+
+void Profiler::BeginCapture() {
+	{
+		std::lock_guard<std::mutex> lock(m_tracksMutex);
+		for (std::unique_ptr<ProfileTrack>& track : m_tracks)
+		{
+			track->m_count.store(0, std::memory_order_relaxed);
+			track->m_dropped.store(0, std::memory_order_relaxed);
+		}
+	}
+	m_capturing.store(true, std::memory_order_release);
+}
+
+void Profiler::EndCapture() {
+	m_capturing.store(false, std::memory_order_release);
+}
+
+ProfileTrack* Profiler::GetThreadTrack() {
+	if (t_trackOwner != this)
+	{
+		t_track = AddTrack(std::string());
+		t_trackOwner = this;
+	}
+	return t_track;
+}
+
+void Profiler::SetThreadName(const char* name) {
+	ProfileTrack* track = GetThreadTrack();
+	std::lock_guard<std::mutex> lock(m_tracksMutex);
+	track->m_name = name;
+}
+
+ProfileTrack* Profiler::CreateTrack(const char* name) {
+	return AddTrack(name);
+}
+
+void Profiler::WriteChromeTrace(std::ostream& out) {
+	std::lock_guard<std::mutex> lock(m_tracksMutex);
+
+	// Chrome wants microseconds, keep the fraction so short zones don't collapse to nothing
+	int64_t origin = INT64_MAX;
+	for (const std::unique_ptr<ProfileTrack>& track : m_tracks)
+	{
+		const uint32_t count = track->GetCount();
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			origin = track->m_events[i].start < origin ? track->m_events[i].start : origin;
+		}
+	}
+
+	// Fixed with ns resolution, the default format turns long captures into 2.6e+09
+	const std::ios::fmtflags flags = out.flags();
+	const std::streamsize precision = out.precision();
+	out << std::fixed;
+	out.precision(3);
+
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (const std::unique_ptr<ProfileTrack>& track : m_tracks)
+	{
+		out << (first ? "\n" : ",\n");
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track->m_id << ",\"args\":{\"name\":\"";
+		WriteEscaped(out, track->m_name.c_str());
+		out << "\"}}";
+
+		const uint32_t count = track->GetCount();
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			const ProfileEvent& event = track->m_events[i];
+			out << ",\n{\"name\":\"";
+			WriteEscaped(out, event.name);
+			out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track->m_id
+				<< ",\"ts\":" << static_cast<double>(event.start - origin) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(event.end - event.start) / 1000.0 << "}";
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+bool Profiler::ExportChromeTrace(const std::string& path) {
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	WriteChromeTrace(file);
+	return static_cast<bool>(file);
+}
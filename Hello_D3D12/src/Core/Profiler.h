@@ -0,0 +1,137 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A finished zone, times in nanoseconds on the profiler's clock
+struct ProfileEvent
+{
+	const char* name;		// Not copied, string literals
+	int64_t start;
+	int64_t end;
+};
+
+// One timeline in the trace, a thread or a GPU queue. Only ever written by one thread at a time, so appending is
+// a plain store plus a release of the count, no locks. Fixed capacity, zones past it are dropped and counted.
+class ProfileTrack {
+	friend class Profiler;
+
+	private:
+		std::string m_name;
+		uint32_t m_id;
+		std::unique_ptr<ProfileEvent[]> m_events;
+		uint32_t m_capacity;
+		std::atomic<uint32_t> m_count;
+		std::atomic<uint32_t> m_dropped;
+
+	public:
+		ProfileTrack(const std::string& name, uint32_t id, uint32_t capacity);
+
+		void Add(const char* name, int64_t start, int64_t end)
+		{
+			const uint32_t index = m_count.load(std::memory_order_relaxed);
+			if (index >= m_capacity)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			m_events[index].name = name;
+			m_events[index].start = start;
+			m_events[index].end = end;
+			m_count.store(index + 1, std::memory_order_release);
+		}
+
+		uint32_t GetCount() const { return m_count.load(std::memory_order_acquire); }
+		uint32_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+		const ProfileEvent& GetEvent(uint32_t index) const { return m_events[index]; }
+		const std::string& GetName() const { return m_name; }
+};
+
+// Collects zones from every thread between BeginCapture and EndCapture and writes them out as a Chrome trace
+// (chrome://tracing, ui.perfetto.dev). Each thread gets its own track the first time it records anything, GPU
+// timelines get tracks of their own through CreateTrack. Nothing is recorded outside a capture, a zone then costs
+// one relaxed load.
+class Profiler {
+	public:
+		typedef int64_t(*ClockFunction)();
+		static const uint32_t DefaultTrackCapacity = 64 * 1024;
+
+	private:
+		std::mutex m_tracksMutex;
+		std::vector<std::unique_ptr<ProfileTrack>> m_tracks;
+		std::atomic<bool> m_capturing;
+		ClockFunction m_clock;
+		uint32_t m_trackCapacity = DefaultTrackCapacity;
+
+		ProfileTrack* AddTrack(const std::string& name);
+
+	public:
+		Profiler();
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+
+		// The one PROFILE_SCOPE records into
+		static Profiler& Get();
+		// steady_clock in nanoseconds, QueryPerformanceCounter underneath on Windows
+		static int64_t SteadyClockNow();
+
+		// Swap the clock out for tests, set it before anything is recorded
+		void SetClock(ClockFunction clock) { m_clock = clock; }
+		int64_t Now() const { return m_clock(); }
+
+		// Both between frames, while no zone is open. BeginCapture throws away the last capture.
+		void BeginCapture();
+		void EndCapture();
+		bool IsCapturing() const { return m_capturing.load(std::memory_order_relaxed); }
+
+		// The calling thread's track, made on first use
+		ProfileTrack* GetThreadTrack();
+		// Renames the calling thread's track, "Thread N" otherwise
+		void SetThreadName(const char* name);
+		// A track that isn't a thread (GPU queue), whoever fills it must be the only writer
+		ProfileTrack* CreateTrack(const char* name);
+
+		// Only after EndCapture
+		void WriteChromeTrace(std::ostream& out);
+		bool ExportChromeTrace(const std::string& path);
+};
+
+// Times its own lifetime into the calling thread's track. Zones nest by time, no explicit parent needed.
+class ProfileScope {
+	private:
+		const char* m_name;
+		ProfileTrack* m_track = nullptr;
+		int64_t m_start = 0;
+
+	public:
+		explicit ProfileScope(const char* name) : m_name(name)
+		{
+			Profiler& profiler = Profiler::Get();
+			if (profiler.IsCapturing())
+			{
+				m_track = profiler.GetThreadTrack();
+				m_start = profiler.Now();
+			}
+		}
+
+		~ProfileScope()
+		{
+			if (m_track)
+			{
+				m_track->Add(m_name, m_start, Profiler::Get().Now());
+			}
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Zone from here to the end of the enclosing block
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
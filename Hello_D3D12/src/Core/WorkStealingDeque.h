@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+// Chase-Lev deque of pointers with a fixed power of two capacity. The owning thread pushes and pops at the
+// bottom (LIFO, keeps its caches warm), any other thread steals from the top (FIFO, takes the oldest and usually
+// biggest work). Push fails instead of growing when full, the caller runs the item itself.
+template<typename T>
+class WorkStealingDeque {
+	private:
+		std::vector<std::atomic<T*>> m_items;
+		int64_t m_mask = 0;
+		std::atomic<int64_t> m_top;
+		std::atomic<int64_t> m_bottom;
+
+	public:
+		explicit WorkStealingDeque(uint32_t capacity = 4096) : m_items(capacity)
+		{
+			assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+			m_mask = static_cast<int64_t>(capacity) - 1;
+			m_top.store(0);
+			m_bottom.store(0);
+		}
+
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+		// Owner only
+		bool Push(T* item)
+		{
+			const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			const int64_t top = m_top.load(std::memory_order_acquire);
+			if (bottom - top > m_mask)
+			{
+				return false;
+			}
+
+			m_items[bottom & m_mask].store(item, std::memory_order_relaxed);
+			m_bottom.store(bottom + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Owner only
+		T* Pop()
+		{
+			const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			// Has to be visible to thieves before we look at top, they do the mirror image
+			m_bottom.store(bottom, std::memory_order_seq_cst);
+			int64_t top = m_top.load(std::memory_order_seq_cst);
+
+			if (top > bottom)
+			{
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			T* item = m_items[bottom & m_mask].load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// Last one, race the thieves for it
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					item = nullptr;
+				}
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		// Any thread
+		T* Steal()
+		{
+			int64_t top = m_top.load(std::memory_order_seq_cst);
+			const int64_t bottom = m_bottom.load(std::memory_order_seq_cst);
+			if (top >= bottom)
+			{
+				return nullptr;
+			}
+
+			T* item = m_items[top & m_mask].load(std::memory_order_relaxed);
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return nullptr;
+			}
+			return item;
+		}
+
+		// Racy, only a hint
+		bool IsEmpty() const { return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,1983 @@
+#include "BlockCompression.h"
+#include "../Core/BitUtils.h"
+#include "../Core/JobSystem.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+	// A block's pixels split by channel, 0 to 255. The fit kernels load whole rows, so everything past the pixels
+	// in use has to hold a real number.
+	struct alignas(64) BlockPixels
+	{
+		float channels[4][16];
+	};
+
+	// What the indices can pick, split by channel like the pixels. These are the exact values the decoder gives
+	// back, so the fit error is the real error.
+	struct alignas(64) Palette
+	{
+		float channels[4][16];
+		uint32_t count;
+	};
+
+	// BC7's mode and partition tables, the partition kernels read the two subset one
+
+	struct Bc7Mode
+	{
+		uint32_t subsets;
+		uint32_t partitionBits;
+		uint32_t rotationBits;
+		uint32_t indexSelectionBits;
+		uint32_t colorBits;
+		uint32_t alphaBits;
+		uint32_t endpointPBits;			// One per endpoint
+		uint32_t sharedPBits;			// One per subset
+		uint32_t indexBits;
+		uint32_t secondaryIndexBits;	// Modes 4 and 5 index alpha separately
+	};
+
+	const Bc7Mode Bc7Modes[8] = {
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	// Bit i set when pixel i is in the second subset
+	const uint16_t Bc7Partitions2[64] = {
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	// Two bits per pixel
+	const uint32_t Bc7Partitions3[64] = {
+		0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+		0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+		0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+		0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+		0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+		0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+		0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+		0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+	};
+
+	// Pixels whose index drops its top bit, besides pixel 0
+	const uint8_t Bc7Anchors2[64] = {
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+	const uint8_t Bc7Anchors3Second[64] = {
+		3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+		3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+		8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+		3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+	};
+	const uint8_t Bc7Anchors3Third[64] = {
+		15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+		15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+		15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+		15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+	};
+
+	const uint32_t Bc7Weights2[4] = { 0, 21, 43, 64 };
+	const uint32_t Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const uint32_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// RGB sums over a set of pixels, enough to tell how well one line fits them without going over the pixels
+	// again. Moments of two sets add up.
+	struct PixelMoments
+	{
+		float count;
+		float sums[3];
+		float products[6];		// rr rg rb gg gb bb
+	};
+
+	// What each pixel adds to the moments, in PixelMoments order, worked out once per block
+	struct MomentTerms
+	{
+		float terms[16][10];
+
+		explicit MomentTerms(const BlockPixels& pixels) {
+			for (uint32_t i{ 0 }; i < 16; i++)
+			{
+				const float r = pixels.channels[0][i];
+				const float g = pixels.channels[1][i];
+				const float b = pixels.channels[2][i];
+				const float values[10] = { 1.0f, r, g, b, r * r, r * g, r * b, g * g, g * b, b * b };
+				memcpy(terms[i], values, sizeof(values));
+			}
+		}
+
+		// Ten separate running sums, a float sum over the pixels would be one long dependency chain
+		PixelMoments Sum(uint32_t mask) const {
+			float sums[10] = {};
+			while (mask)
+			{
+				const float* pixel = terms[FindLowestSetBit(mask)];
+				for (uint32_t term{ 0 }; term < 10; term++)
+				{
+					sums[term] += pixel[term];
+				}
+				mask &= mask - 1;
+			}
+			PixelMoments moments;
+			memcpy(&moments, sums, sizeof(moments));
+			return moments;
+		}
+	};
+
+	// Bc7Partitions2 as 0 / 1 weights pixel by pixel, so a register's worth of partitions sums in one go
+	struct PartitionWeights
+	{
+		alignas(64) float weights[16][64];
+
+		PartitionWeights() {
+			for (uint32_t i{ 0 }; i < 16; i++)
+			{
+				for (uint32_t partition{ 0 }; partition < 64; partition++)
+				{
+					weights[i][partition] = static_cast<float>((Bc7Partitions2[partition] >> i) & 1);
+				}
+			}
+		}
+	};
+
+	const PartitionWeights& GetPartitionWeights() {
+		static const PartitionWeights partitions;
+		return partitions;
+	}
+
+	// Squared distance of the pixels from their principal axis: the scatter's trace minus its largest eigenvalue,
+	// which three power iterations get close enough to rank partitions by. The scatter is divided by its trace
+	// first so the unnormalised iterations can't overflow.
+	float EstimateLineError(const PixelMoments& moments) {
+		const float inverseCount = 1.0f / (moments.count > 1.0f ? moments.count : 1.0f);
+		const float* s = moments.sums;
+		float rr = moments.products[0] - s[0] * s[0] * inverseCount;
+		float rg = moments.products[1] - s[0] * s[1] * inverseCount;
+		float rb = moments.products[2] - s[0] * s[2] * inverseCount;
+		float gg = moments.products[3] - s[1] * s[1] * inverseCount;
+		float gb = moments.products[4] - s[1] * s[2] * inverseCount;
+		float bb = moments.products[5] - s[2] * s[2] * inverseCount;
+		const float trace = rr + gg + bb;
+		if (trace < 1e-3f)
+		{
+			return 0.0f;
+		}
+		const float inverseTrace = 1.0f / trace;
+		rr *= inverseTrace;
+		rg *= inverseTrace;
+		rb *= inverseTrace;
+		gg *= inverseTrace;
+		gb *= inverseTrace;
+		bb *= inverseTrace;
+
+		float x = 1.0f;
+		float y = 1.0f;
+		float z = 1.0f;
+		for (uint32_t iteration{ 0 }; iteration < 3; iteration++)
+		{
+			const float nextX = rr * x + rg * y + rb * z;
+			const float nextY = rg * x + gg * y + gb * z;
+			const float nextZ = rb * x + gb * y + bb * z;
+			x = nextX;
+			y = nextY;
+			z = nextZ;
+		}
+
+		// Rayleigh quotient, never above the real eigenvalue so the estimate errs high
+		const float length = x * x + y * y + z * z;
+		if (length < 1e-12f)
+		{
+			return trace;
+		}
+		const float eigenvalue = ((rr * x + rg * y + rb * z) * x + (rg * x + gg * y + gb * z) * y + (rb * x + gb * y + bb * z) * z) / length;
+		return trace * (1.0f - eigenvalue);
+	}
+
+	// Picks the closest palette entry for pixels [0, pixelCount) over the first channelCount channels, returns the
+	// summed squared error. indices needs room for 16.
+	typedef float(*FitPaletteFunction)(const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount, const Palette& palette, uint8_t* indices);
+	// EstimateLineError of both subsets added up, for all 64 two subset partitions. errors needs room for 64.
+	typedef void(*PartitionErrorsFunction)(const MomentTerms& terms, float* errors);
+
+	struct KernelTable
+	{
+		SimdLevel level;
+		FitPaletteFunction fitPalette;
+		PartitionErrorsFunction partitionErrors;
+	};
+
+	float FitPaletteScalar(const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount, const Palette& palette, uint8_t* indices) {
+		float total = 0.0f;
+		for (uint32_t i{ 0 }; i < pixelCount; i++)
+		{
+			float best = FLT_MAX;
+			uint32_t bestIndex = 0;
+			for (uint32_t entry{ 0 }; entry < palette.count; entry++)
+			{
+				float distance = 0.0f;
+				for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+				{
+					const float difference = pixels.channels[channel][i] - palette.channels[channel][entry];
+					distance += difference * difference;
+				}
+				if (distance < best)
+				{
+					best = distance;
+					bestIndex = entry;
+				}
+			}
+			indices[i] = static_cast<uint8_t>(bestIndex);
+			total += best;
+		}
+		return total;
+	}
+
+	void PartitionErrorsScalar(const MomentTerms& terms, float* errors) {
+		const PixelMoments whole = terms.Sum(0xFFFF);
+		for (uint32_t partition{ 0 }; partition < 64; partition++)
+		{
+			const PixelMoments second = terms.Sum(Bc7Partitions2[partition]);
+			PixelMoments first;
+			first.count = whole.count - second.count;
+			for (uint32_t i{ 0 }; i < 3; i++)
+			{
+				first.sums[i] = whole.sums[i] - second.sums[i];
+			}
+			for (uint32_t i{ 0 }; i < 6; i++)
+			{
+				first.products[i] = whole.products[i] - second.products[i];
+			}
+			errors[partition] = EstimateLineError(first) + EstimateLineError(second);
+		}
+	}
+
+#ifdef CPU_FEATURES_X86
+
+	// SSE2, four pixels a register. Ties go to the lower index, same as the scalar one.
+	float FitPaletteSse2(const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount, const Palette& palette, uint8_t* indices) {
+		__m128 total = _mm_setzero_ps();
+		for (uint32_t i{ 0 }; i < pixelCount; i += 4)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (uint32_t entry{ 0 }; entry < palette.count; entry++)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+				{
+					const __m128 difference = _mm_sub_ps(_mm_load_ps(&pixels.channels[channel][i]), _mm_set1_ps(palette.channels[channel][entry]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+				}
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(entry))), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			// Lanes past pixelCount don't count
+			const __m128i lanes = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)), _mm_setr_epi32(0, 1, 2, 3));
+			const __m128 valid = _mm_castsi128_ps(_mm_cmplt_epi32(lanes, _mm_set1_epi32(static_cast<int>(pixelCount))));
+			total = _mm_add_ps(total, _mm_and_ps(best, valid));
+
+			const __m128i packed = _mm_packs_epi32(bestIndex, bestIndex);
+			const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+			memcpy(indices + i, &bytes, 4);
+		}
+		total = _mm_add_ps(total, _mm_movehl_ps(total, total));
+		total = _mm_add_ss(total, _mm_shuffle_ps(total, total, 1));
+		return _mm_cvtss_f32(total);
+	}
+
+	// EstimateLineError on four partitions' moments (PixelMoments order) at once
+	__m128 EstimateLineErrorSse2(const __m128* moments) {
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 inverseCount = _mm_div_ps(one, _mm_max_ps(moments[0], one));
+		__m128 rr = _mm_sub_ps(moments[4], _mm_mul_ps(_mm_mul_ps(moments[1], moments[1]), inverseCount));
+		__m128 rg = _mm_sub_ps(moments[5], _mm_mul_ps(_mm_mul_ps(moments[1], moments[2]), inverseCount));
+		__m128 rb = _mm_sub_ps(moments[6], _mm_mul_ps(_mm_mul_ps(moments[1], moments[3]), inverseCount));
+		__m128 gg = _mm_sub_ps(moments[7], _mm_mul_ps(_mm_mul_ps(moments[2], moments[2]), inverseCount));
+		__m128 gb = _mm_sub_ps(moments[8], _mm_mul_ps(_mm_mul_ps(moments[2], moments[3]), inverseCount));
+		__m128 bb = _mm_sub_ps(moments[9], _mm_mul_ps(_mm_mul_ps(moments[3], moments[3]), inverseCount));
+		const __m128 trace = _mm_add_ps(_mm_add_ps(rr, gg), bb);
+		const __m128 minimumTrace = _mm_set1_ps(1e-3f);
+		const __m128 inverseTrace = _mm_div_ps(one, _mm_max_ps(trace, minimumTrace));
+		rr = _mm_mul_ps(rr, inverseTrace);
+		rg = _mm_mul_ps(rg, inverseTrace);
+		rb = _mm_mul_ps(rb, inverseTrace);
+		gg = _mm_mul_ps(gg, inverseTrace);
+		gb = _mm_mul_ps(gb, inverseTrace);
+		bb = _mm_mul_ps(bb, inverseTrace);
+
+		__m128 x = one;
+		__m128 y = one;
+		__m128 z = one;
+		for (uint32_t iteration{ 0 }; iteration < 3; iteration++)
+		{
+			const __m128 nextX = _mm_add_ps(_mm_mul_ps(rb, z), _mm_add_ps(_mm_mul_ps(rg, y), _mm_mul_ps(rr, x)));
+			const __m128 nextY = _mm_add_ps(_mm_mul_ps(gb, z), _mm_add_ps(_mm_mul_ps(gg, y), _mm_mul_ps(rg, x)));
+			const __m128 nextZ = _mm_add_ps(_mm_mul_ps(bb, z), _mm_add_ps(_mm_mul_ps(gb, y), _mm_mul_ps(rb, x)));
+			x = nextX;
+			y = nextY;
+			z = nextZ;
+		}
+
+		const __m128 length = _mm_add_ps(_mm_mul_ps(z, z), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(x, x)));
+		const __m128 productX = _mm_add_ps(_mm_mul_ps(rb, z), _mm_add_ps(_mm_mul_ps(rg, y), _mm_mul_ps(rr, x)));
+		const __m128 productY = _mm_add_ps(_mm_mul_ps(gb, z), _mm_add_ps(_mm_mul_ps(gg, y), _mm_mul_ps(rg, x)));
+		const __m128 productZ = _mm_add_ps(_mm_mul_ps(bb, z), _mm_add_ps(_mm_mul_ps(gb, y), _mm_mul_ps(rb, x)));
+		const __m128 product = _mm_add_ps(_mm_mul_ps(productZ, z), _mm_add_ps(_mm_mul_ps(productY, y), _mm_mul_ps(productX, x)));
+		const __m128 minimumLength = _mm_set1_ps(1e-12f);
+		const __m128 eigenvalue = _mm_and_ps(_mm_div_ps(product, _mm_max_ps(length, minimumLength)), _mm_cmpge_ps(length, minimumLength));
+		return _mm_and_ps(_mm_mul_ps(trace, _mm_sub_ps(one, eigenvalue)), _mm_cmpge_ps(trace, minimumTrace));
+	}
+
+	// Four partitions a register, the second subset's moments summed through the 0 / 1 weights and the first's
+	// taken off the whole block's
+	void PartitionErrorsSse2(const MomentTerms& terms, float* errors) {
+		const PartitionWeights& partitions = GetPartitionWeights();
+		const PixelMoments whole = terms.Sum(0xFFFF);
+		float wholeTerms[10];
+		memcpy(wholeTerms, &whole, sizeof(wholeTerms));
+		for (uint32_t first{ 0 }; first < 64; first += 4)
+		{
+			__m128 second[10];
+			for (uint32_t term{ 0 }; term < 10; term++)
+			{
+				second[term] = _mm_setzero_ps();
+			}
+			for (uint32_t i{ 0 }; i < 16; i++)
+			{
+				const __m128 weight = _mm_load_ps(&partitions.weights[i][first]);
+				for (uint32_t term{ 0 }; term < 10; term++)
+				{
+					second[term] = _mm_add_ps(second[term], _mm_mul_ps(weight, _mm_set1_ps(terms.terms[i][term])));
+				}
+			}
+			__m128 rest[10];
+			for (uint32_t term{ 0 }; term < 10; term++)
+			{
+				rest[term] = _mm_sub_ps(_mm_set1_ps(wholeTerms[term]), second[term]);
+			}
+			_mm_storeu_ps(errors + first, _mm_add_ps(EstimateLineErrorSse2(rest), EstimateLineErrorSse2(second)));
+		}
+	}
+
+	SIMD_TARGET_AVX2 float FitPaletteAvx2(const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount, const Palette& palette, uint8_t* indices) {
+		__m256 total = _mm256_setzero_ps();
+		for (uint32_t i{ 0 }; i < pixelCount; i += 8)
+		{
+			__m256 best = _mm256_set1_ps(FLT_MAX);
+			__m256i bestIndex = _mm256_setzero_si256();
+			for (uint32_t entry{ 0 }; entry < palette.count; entry++)
+			{
+				__m256 distance = _mm256_setzero_ps();
+				for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+				{
+					const __m256 difference = _mm256_sub_ps(_mm256_load_ps(&pixels.channels[channel][i]), _mm256_set1_ps(palette.channels[channel][entry]));
+					distance = _mm256_fmadd_ps(difference, difference, distance);
+				}
+				const __m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+				best = _mm256_min_ps(distance, best);
+				bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(static_cast<int>(entry)), _mm256_castps_si256(closer));
+			}
+
+			const __m256i lanes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+			const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(pixelCount)), lanes);
+			total = _mm256_add_ps(total, _mm256_and_ps(best, _mm256_castsi256_ps(valid)));
+
+			const __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(bestIndex), _mm256_extracti128_si256(bestIndex, 1));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(indices + i), _mm_packus_epi16(packed, packed));
+		}
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(total), _mm256_extractf128_ps(total, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+	}
+
+	SIMD_TARGET_AVX2 __m256 EstimateLineErrorAvx2(const __m256* moments) {
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 inverseCount = _mm256_div_ps(one, _mm256_max_ps(moments[0], one));
+		__m256 rr = _mm256_sub_ps(moments[4], _mm256_mul_ps(_mm256_mul_ps(moments[1], moments[1]), inverseCount));
+		__m256 rg = _mm256_sub_ps(moments[5], _mm256_mul_ps(_mm256_mul_ps(moments[1], moments[2]), inverseCount));
+		__m256 rb = _mm256_sub_ps(moments[6], _mm256_mul_ps(_mm256_mul_ps(moments[1], moments[3]), inverseCount));
+		__m256 gg = _mm256_sub_ps(moments[7], _mm256_mul_ps(_mm256_mul_ps(moments[2], moments[2]), inverseCount));
+		__m256 gb = _mm256_sub_ps(moments[8], _mm256_mul_ps(_mm256_mul_ps(moments[2], moments[3]), inverseCount));
+		__m256 bb = _mm256_sub_ps(moments[9], _mm256_mul_ps(_mm256_mul_ps(moments[3], moments[3]), inverseCount));
+		const __m256 trace = _mm256_add_ps(_mm256_add_ps(rr, gg), bb);
+		const __m256 minimumTrace = _mm256_set1_ps(1e-3f);
+		const __m256 inverseTrace = _mm256_div_ps(one, _mm256_max_ps(trace, minimumTrace));
+		rr = _mm256_mul_ps(rr, inverseTrace);
+		rg = _mm256_mul_ps(rg, inverseTrace);
+		rb = _mm256_mul_ps(rb, inverseTrace);
+		gg = _mm256_mul_ps(gg, inverseTrace);
+		gb = _mm256_mul_ps(gb, inverseTrace);
+		bb = _mm256_mul_ps(bb, inverseTrace);
+
+		__m256 x = one;
+		__m256 y = one;
+		__m256 z = one;
+		for (uint32_t iteration{ 0 }; iteration < 3; iteration++)
+		{
+			const __m256 nextX = _mm256_fmadd_ps(rb, z, _mm256_fmadd_ps(rg, y, _mm256_mul_ps(rr, x)));
+			const __m256 nextY = _mm256_fmadd_ps(gb, z, _mm256_fmadd_ps(gg, y, _mm256_mul_ps(rg, x)));
+			const __m256 nextZ = _mm256_fmadd_ps(bb, z, _mm256_fmadd_ps(gb, y, _mm256_mul_ps(rb, x)));
+			x = nextX;
+			y = nextY;
+			z = nextZ;
+		}
+
+		const __m256 length = _mm256_fmadd_ps(z, z, _mm256_fmadd_ps(y, y, _mm256_mul_ps(x, x)));
+		const __m256 productX = _mm256_fmadd_ps(rb, z, _mm256_fmadd_ps(rg, y, _mm256_mul_ps(rr, x)));
+		const __m256 productY = _mm256_fmadd_ps(gb, z, _mm256_fmadd_ps(gg, y, _mm256_mul_ps(rg, x)));
+		const __m256 productZ = _mm256_fmadd_ps(bb, z, _mm256_fmadd_ps(gb, y, _mm256_mul_ps(rb, x)));
+		const __m256 product = _mm256_fmadd_ps(productZ, z, _mm256_fmadd_ps(productY, y, _mm256_mul_ps(productX, x)));
+		const __m256 minimumLength = _mm256_set1_ps(1e-12f);
+		const __m256 eigenvalue = _mm256_and_ps(_mm256_div_ps(product, _mm256_max_ps(length, minimumLength)), _mm256_cmp_ps(length, minimumLength, _CMP_GE_OQ));
+		return _mm256_and_ps(_mm256_mul_ps(trace, _mm256_sub_ps(one, eigenvalue)), _mm256_cmp_ps(trace, minimumTrace, _CMP_GE_OQ));
+	}
+
+	// Eight partitions a register
+	SIMD_TARGET_AVX2 void PartitionErrorsAvx2(const MomentTerms& terms, float* errors) {
+		const PartitionWeights& partitions = GetPartitionWeights();
+		const PixelMoments whole = terms.Sum(0xFFFF);
+		float wholeTerms[10];
+		memcpy(wholeTerms, &whole, sizeof(wholeTerms));
+		for (uint32_t first{ 0 }; first < 64; first += 8)
+		{
+			__m256 second[10];
+			for (uint32_t term{ 0 }; term < 10; term++)
+			{
+				second[term] = _mm256_setzero_ps();
+			}
+			for (uint32_t i{ 0 }; i < 16; i++)
+			{
+				const __m256 weight = _mm256_load_ps(&partitions.weights[i][first]);
+				for (uint32_t term{ 0 }; term < 10; term++)
+				{
+					second[term] = _mm256_fmadd_ps(weight, _mm256_set1_ps(terms.terms[i][term]), second[term]);
+				}
+			}
+			__m256 rest[10];
+			for (uint32_t term{ 0 }; term < 10; term++)
+			{
+				rest[term] = _mm256_sub_ps(_mm256_set1_ps(wholeTerms[term]), second[term]);
+			}
+			_mm256_storeu_ps(errors + first, _mm256_add_ps(EstimateLineErrorAvx2(rest), EstimateLineErrorAvx2(second)));
+		}
+	}
+
+	// AVX-512. GCC 12's headers build the plain intrinsics on their masked forms with _mm512_undefined_ps() as the
+	// merge source, which -Wall flags as uninitialized once inlined into these kernels. The mask is all ones, so
+	// that value never makes it into a result.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+	// The whole block in one register per channel
+	SIMD_TARGET_AVX512 float FitPaletteAvx512(const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount, const Palette& palette, uint8_t* indices) {
+		__m512 channels[4];
+		for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+		{
+			channels[channel] = _mm512_load_ps(pixels.channels[channel]);
+		}
+
+		__m512 best = _mm512_set1_ps(FLT_MAX);
+		__m512i bestIndex = _mm512_setzero_si512();
+		for (uint32_t entry{ 0 }; entry < palette.count; entry++)
+		{
+			__m512 distance = _mm512_setzero_ps();
+			for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+			{
+				const __m512 difference = _mm512_sub_ps(channels[channel], _mm512_set1_ps(palette.channels[channel][entry]));
+				distance = _mm512_fmadd_ps(difference, difference, distance);
+			}
+			const __mmask16 closer = _mm512_cmp_ps_mask(distance, best, _CMP_LT_OQ);
+			best = _mm512_min_ps(distance, best);
+			bestIndex = _mm512_mask_mov_epi32(bestIndex, closer, _mm512_set1_epi32(static_cast<int>(entry)));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), _mm512_cvtepi32_epi8(bestIndex));
+		const __mmask16 valid = static_cast<__mmask16>(pixelCount >= 16 ? 0xFFFF : (1u << pixelCount) - 1);
+		return _mm512_reduce_add_ps(_mm512_maskz_mov_ps(valid, best));
+	}
+
+	SIMD_TARGET_AVX512 __m512 EstimateLineErrorAvx512(const __m512* moments) {
+		const __m512 one = _mm512_set1_ps(1.0f);
+		const __m512 inverseCount = _mm512_div_ps(one, _mm512_max_ps(moments[0], one));
+		__m512 rr = _mm512_sub_ps(moments[4], _mm512_mul_ps(_mm512_mul_ps(moments[1], moments[1]), inverseCount));
+		__m512 rg = _mm512_sub_ps(moments[5], _mm512_mul_ps(_mm512_mul_ps(moments[1], moments[2]), inverseCount));
+		__m512 rb = _mm512_sub_ps(moments[6], _mm512_mul_ps(_mm512_mul_ps(moments[1], moments[3]), inverseCount));
+		__m512 gg = _mm512_sub_ps(moments[7], _mm512_mul_ps(_mm512_mul_ps(moments[2], moments[2]), inverseCount));
+		__m512 gb = _mm512_sub_ps(moments[8], _mm512_mul_ps(_mm512_mul_ps(moments[2], moments[3]), inverseCount));
+		__m512 bb = _mm512_sub_ps(moments[9], _mm512_mul_ps(_mm512_mul_ps(moments[3], moments[3]), inverseCount));
+		const __m512 trace = _mm512_add_ps(_mm512_add_ps(rr, gg), bb);
+		const __m512 minimumTrace = _mm512_set1_ps(1e-3f);
+		const __m512 inverseTrace = _mm512_div_ps(one, _mm512_max_ps(trace, minimumTrace));
+		rr = _mm512_mul_ps(rr, inverseTrace);
+		rg = _mm512_mul_ps(rg, inverseTrace);
+		rb = _mm512_mul_ps(rb, inverseTrace);
+		gg = _mm512_mul_ps(gg, inverseTrace);
+		gb = _mm512_mul_ps(gb, inverseTrace);
+		bb = _mm512_mul_ps(bb, inverseTrace);
+
+		__m512 x = one;
+		__m512 y = one;
+		__m512 z = one;
+		for (uint32_t iteration{ 0 }; iteration < 3; iteration++)
+		{
+			const __m512 nextX = _mm512_fmadd_ps(rb, z, _mm512_fmadd_ps(rg, y, _mm512_mul_ps(rr, x)));
+			const __m512 nextY = _mm512_fmadd_ps(gb, z, _mm512_fmadd_ps(gg, y, _mm512_mul_ps(rg, x)));
+			const __m512 nextZ = _mm512_fmadd_ps(bb, z, _mm512_fmadd_ps(gb, y, _mm512_mul_ps(rb, x)));
+			x = nextX;
+			y = nextY;
+			z = nextZ;
+		}
+
+		const __m512 length = _mm512_fmadd_ps(z, z, _mm512_fmadd_ps(y, y, _mm512_mul_ps(x, x)));
+		const __m512 productX = _mm512_fmadd_ps(rb, z, _mm512_fmadd_ps(rg, y, _mm512_mul_ps(rr, x)));
+		const __m512 productY = _mm512_fmadd_ps(gb, z, _mm512_fmadd_ps(gg, y, _mm512_mul_ps(rg, x)));
+		const __m512 productZ = _mm512_fmadd_ps(bb, z, _mm512_fmadd_ps(gb, y, _mm512_mul_ps(rb, x)));
+		const __m512 product = _mm512_fmadd_ps(productZ, z, _mm512_fmadd_ps(productY, y, _mm512_mul_ps(productX, x)));
+		const __m512 minimumLength = _mm512_set1_ps(1e-12f);
+		const __m512 eigenvalue = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(length, minimumLength, _CMP_GE_OQ), product, _mm512_max_ps(length, minimumLength));
+		return _mm512_maskz_mul_ps(_mm512_cmp_ps_mask(trace, minimumTrace, _CMP_GE_OQ), trace, _mm512_sub_ps(one, eigenvalue));
+	}
+
+	// Sixteen partitions a register
+	SIMD_TARGET_AVX512 void PartitionErrorsAvx512(const MomentTerms& terms, float* errors) {
+		const PartitionWeights& partitions = GetPartitionWeights();
+		const PixelMoments whole = terms.Sum(0xFFFF);
+		float wholeTerms[10];
+		memcpy(wholeTerms, &whole, sizeof(wholeTerms));
+		for (uint32_t first{ 0 }; first < 64; first += 16)
+		{
+			__m512 second[10];
+			for (uint32_t term{ 0 }; term < 10; term++)
+			{
+				second[term] = _mm512_setzero_ps();
+			}
+			for (uint32_t i{ 0 }; i < 16; i++)
+			{
+				const __m512 weight = _mm512_load_ps(&partitions.weights[i][first]);
+				for (uint32_t term{ 0 }; term < 10; term++)
+				{
+					second[term] = _mm512_fmadd_ps(weight, _mm512_set1_ps(terms.terms[i][term]), second[term]);
+				}
+			}
+			__m512 rest[10];
+			for (uint32_t term{ 0 }; term < 10; term++)
+			{
+				rest[term] = _mm512_sub_ps(_mm512_set1_ps(wholeTerms[term]), second[term]);
+			}
+			_mm512_storeu_ps(errors + first, _mm512_add_ps(EstimateLineErrorAvx512(rest), EstimateLineErrorAvx512(second)));
+		}
+	}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+	KernelTable MakeKernelTable(SimdLevel level) {
+		KernelTable table = { SimdLevel::Scalar, FitPaletteScalar, PartitionErrorsScalar };
+#ifdef CPU_FEATURES_X86
+		if (level >= SimdLevel::SSE2)
+		{
+			table = { SimdLevel::SSE2, FitPaletteSse2, PartitionErrorsSse2 };
+		}
+		if (level >= SimdLevel::AVX2)
+		{
+			table = { SimdLevel::AVX2, FitPaletteAvx2, PartitionErrorsAvx2 };
+		}
+		if (level >= SimdLevel::AVX512)
+		{
+			table = { SimdLevel::AVX512, FitPaletteAvx512, PartitionErrorsAvx512 };
+		}
+#endif
+		return table;
+	}
+
+	const KernelTable& GetKernels() {
+		static const SimdKernelTables<KernelTable> tables(MakeKernelTable);
+		return tables.Get();
+	}
+
+	// Shared endpoint fitting
+
+	uint32_t GetRefineIterations(BlockQuality quality) {
+		switch (quality)
+		{
+		case BlockQuality::Fast:
+			return 0;
+		case BlockQuality::Normal:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	// Pixels whose mask bit is set, moved to the front. The rest repeat the first one so the kernels read real
+	// numbers. Returns how many there are.
+	uint32_t GatherPixels(const BlockPixels& pixels, uint32_t mask, BlockPixels& out) {
+		uint32_t count = 0;
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			if (mask & (1u << i))
+			{
+				for (uint32_t channel{ 0 }; channel < 4; channel++)
+				{
+					out.channels[channel][count] = pixels.channels[channel][i];
+				}
+				count++;
+			}
+		}
+		for (uint32_t i{ count }; i < 16; i++)
+		{
+			for (uint32_t channel{ 0 }; channel < 4; channel++)
+			{
+				out.channels[channel][i] = count > 0 ? out.channels[channel][0] : 0.0f;
+			}
+		}
+		return count;
+	}
+
+	// Both ends of the line through the pixels along their principal axis (power iteration on the covariance).
+	// A flat block gives the same point twice.
+	void FitPrincipalLine(const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount, float* end0, float* end1) {
+		float mean[4] = {};
+		for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+		{
+			for (uint32_t i{ 0 }; i < pixelCount; i++)
+			{
+				mean[channel] += pixels.channels[channel][i];
+			}
+			mean[channel] /= static_cast<float>(pixelCount);
+		}
+
+		float covariance[4][4] = {};
+		for (uint32_t i{ 0 }; i < pixelCount; i++)
+		{
+			float offset[4];
+			for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+			{
+				offset[channel] = pixels.channels[channel][i] - mean[channel];
+			}
+			for (uint32_t row{ 0 }; row < channelCount; row++)
+			{
+				for (uint32_t column{ row }; column < channelCount; column++)
+				{
+					covariance[row][column] += offset[row] * offset[column];
+				}
+			}
+		}
+
+		// Start from the channel that varies most, it's never orthogonal to the answer unless the block is flat
+		uint32_t widest = 0;
+		for (uint32_t row{ 0 }; row < channelCount; row++)
+		{
+			for (uint32_t column{ 0 }; column < row; column++)
+			{
+				covariance[row][column] = covariance[column][row];
+			}
+			if (covariance[row][row] > covariance[widest][widest])
+			{
+				widest = row;
+			}
+		}
+		float axis[4] = {};
+		axis[widest] = 1.0f;
+		for (uint32_t iteration{ 0 }; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float largest = 0.0f;
+			for (uint32_t row{ 0 }; row < channelCount; row++)
+			{
+				for (uint32_t column{ 0 }; column < channelCount; column++)
+				{
+					next[row] += covariance[row][column] * axis[column];
+				}
+				largest = std::fabs(next[row]) > largest ? std::fabs(next[row]) : largest;
+			}
+			if (largest < 1e-6f)
+			{
+				break;
+			}
+			for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+			{
+				axis[channel] = next[channel] / largest;
+			}
+		}
+
+		float length = 0.0f;
+		for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+		{
+			length += axis[channel] * axis[channel];
+		}
+		length = std::sqrt(length);
+
+		float lowest = 0.0f;
+		float highest = 0.0f;
+		if (covariance[widest][widest] > 0.0f)
+		{
+			for (uint32_t i{ 0 }; i < pixelCount; i++)
+			{
+				float t = 0.0f;
+				for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+				{
+					t += (pixels.channels[channel][i] - mean[channel]) * axis[channel];
+				}
+				t /= length * length;
+				lowest = t < lowest ? t : lowest;
+				highest = t > highest ? t : highest;
+			}
+		}
+		for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+		{
+			end0[channel] = mean[channel] + axis[channel] * lowest;
+			end1[channel] = mean[channel] + axis[channel] * highest;
+		}
+	}
+
+	// Least squares endpoints for fixed indices, weights[index] is how far toward end1 that index sits. Indices
+	// with a negative weight are fixed colors the endpoints don't move. False when there's no line to fit, every
+	// pixel picked the same weight.
+	bool SolveEndpoints(const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount, const uint8_t* indices, const float* weights,
+		float* end0, float* end1) {
+
+		float a = 0.0f;
+		float b = 0.0f;
+		float c = 0.0f;
+		float toEnd0[4] = {};
+		float toEnd1[4] = {};
+		for (uint32_t i{ 0 }; i < pixelCount; i++)
+		{
+			const float weight = weights[indices[i]];
+			if (weight < 0.0f)
+			{
+				continue;
+			}
+			const float inverse = 1.0f - weight;
+			a += inverse * inverse;
+			b += inverse * weight;
+			c += weight * weight;
+			for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+			{
+				toEnd0[channel] += inverse * pixels.channels[channel][i];
+				toEnd1[channel] += weight * pixels.channels[channel][i];
+			}
+		}
+
+		const float determinant = a * c - b * b;
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+		{
+			end0[channel] = (c * toEnd0[channel] - b * toEnd1[channel]) / determinant;
+			end1[channel] = (a * toEnd1[channel] - b * toEnd0[channel]) / determinant;
+		}
+		return true;
+	}
+
+	uint32_t QuantizeUnorm(float value, uint32_t maximum) {
+		const float scaled = value * static_cast<float>(maximum) / 255.0f + 0.5f;
+		return scaled <= 0.0f ? 0 : (scaled >= static_cast<float>(maximum) ? maximum : static_cast<uint32_t>(scaled));
+	}
+
+	// BC1 colors
+
+	void Unpack565(uint32_t color, uint32_t* rgb) {
+		const uint32_t r = (color >> 11) & 31;
+		const uint32_t g = (color >> 5) & 63;
+		const uint32_t b = color & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// What the decoder makes of two endpoints. Three colors and black when color0 <= color1, unless it's BC3's
+	// color block, which always has four.
+	void GetBc1Palette(uint32_t color0, uint32_t color1, bool fourColorsOnly, uint32_t palette[4][4]) {
+		Unpack565(color0, palette[0]);
+		Unpack565(color1, palette[1]);
+		const bool fourColors = fourColorsOnly || color0 > color1;
+		for (uint32_t channel{ 0 }; channel < 3; channel++)
+		{
+			const uint32_t value0 = palette[0][channel];
+			const uint32_t value1 = palette[1][channel];
+			if (fourColors)
+			{
+				palette[2][channel] = (2 * value0 + value1 + 1) / 3;
+				palette[3][channel] = (value0 + 2 * value1 + 1) / 3;
+			}
+			else
+			{
+				palette[2][channel] = (value0 + value1 + 1) / 2;
+				palette[3][channel] = 0;
+			}
+		}
+		palette[0][3] = 255;
+		palette[1][3] = 255;
+		palette[2][3] = 255;
+		palette[3][3] = fourColors ? 255 : 0;
+	}
+
+	// Best endpoint pair for a flat channel, picked so index 2 lands on the value
+	struct Bc1SingleColorTable
+	{
+		uint8_t ends[2][256][2];		// 5 bit then 6 bit, code for color0 and color1
+
+		Bc1SingleColorTable() {
+			for (uint32_t table{ 0 }; table < 2; table++)
+			{
+				const uint32_t bits = table == 0 ? 5 : 6;
+				const uint32_t maximum = (1u << bits) - 1;
+				for (uint32_t value{ 0 }; value < 256; value++)
+				{
+					uint32_t bestError = 256;
+					for (uint32_t code0{ 0 }; code0 <= maximum; code0++)
+					{
+						for (uint32_t code1{ 0 }; code1 <= maximum; code1++)
+						{
+							const uint32_t expanded0 = (code0 << (8 - bits)) | (code0 >> (2 * bits - 8));
+							const uint32_t expanded1 = (code1 << (8 - bits)) | (code1 >> (2 * bits - 8));
+							const uint32_t interpolated = (2 * expanded0 + expanded1 + 1) / 3;
+							const uint32_t error = interpolated > value ? interpolated - value : value - interpolated;
+							if (error < bestError)
+							{
+								bestError = error;
+								ends[table][value][0] = static_cast<uint8_t>(code0);
+								ends[table][value][1] = static_cast<uint8_t>(code1);
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	struct Bc1Candidate
+	{
+		uint32_t color0;
+		uint32_t color1;
+		bool threeColors;		// color0 <= color1, index 3 is black
+		uint8_t indices[16];
+		float error;
+	};
+
+	uint32_t Pack565(const float* rgb) {
+		return (QuantizeUnorm(rgb[0], 31) << 11) | (QuantizeUnorm(rgb[1], 63) << 5) | QuantizeUnorm(rgb[2], 31);
+	}
+
+	// Puts the endpoints in the order the mode needs and scores them against the exact decoded palette
+	void EvaluateBc1(const KernelTable& kernels, const BlockPixels& pixels, uint32_t pixelCount, bool fourColorsOnly, Bc1Candidate& candidate) {
+		if (candidate.threeColors ? candidate.color0 > candidate.color1 : candidate.color0 < candidate.color1)
+		{
+			const uint32_t color = candidate.color0;
+			candidate.color0 = candidate.color1;
+			candidate.color1 = color;
+		}
+
+		uint32_t decoded[4][4];
+		GetBc1Palette(candidate.color0, candidate.color1, fourColorsOnly, decoded);
+		// Index 3 of the three color mode is transparent, opaque pixels can't have it
+		Palette palette;
+		palette.count = fourColorsOnly || candidate.color0 > candidate.color1 ? 4 : 3;
+		for (uint32_t entry{ 0 }; entry < 4; entry++)
+		{
+			for (uint32_t channel{ 0 }; channel < 3; channel++)
+			{
+				palette.channels[channel][entry] = static_cast<float>(decoded[entry][channel]);
+			}
+		}
+		candidate.error = kernels.fitPalette(pixels, pixelCount, 3, palette, candidate.indices);
+	}
+
+	// Endpoints for the pixels in the mask, the others are transparent (index 3 of the three color mode)
+	Bc1Candidate FitBc1(const KernelTable& kernels, BlockQuality quality, const BlockPixels& block, uint32_t mask, bool threeColors, bool fourColorsOnly) {
+		BlockPixels pixels;
+		const uint32_t pixelCount = GatherPixels(block, mask, pixels);
+
+		Bc1Candidate best;
+		best.color0 = 0;
+		best.color1 = 0;
+		best.threeColors = threeColors;
+		memset(best.indices, 0, sizeof(best.indices));
+		best.error = 0.0f;
+		if (pixelCount == 0)
+		{
+			return best;
+		}
+
+		bool flat = true;
+		for (uint32_t i{ 1 }; i < pixelCount; i++)
+		{
+			for (uint32_t channel{ 0 }; channel < 3; channel++)
+			{
+				flat = flat && pixels.channels[channel][i] == pixels.channels[channel][0];
+			}
+		}
+		if (flat && !threeColors)
+		{
+			static const Bc1SingleColorTable singleColor;
+			uint32_t ends[2][3];
+			for (uint32_t channel{ 0 }; channel < 3; channel++)
+			{
+				const uint32_t value = static_cast<uint32_t>(pixels.channels[channel][0]);
+				const uint32_t table = channel == 1 ? 1 : 0;
+				ends[0][channel] = singleColor.ends[table][value][0];
+				ends[1][channel] = singleColor.ends[table][value][1];
+			}
+			best.color0 = (ends[0][0] << 11) | (ends[0][1] << 5) | ends[0][2];
+			best.color1 = (ends[1][0] << 11) | (ends[1][1] << 5) | ends[1][2];
+			EvaluateBc1(kernels, pixels, pixelCount, fourColorsOnly, best);
+			return best;
+		}
+
+		float end0[3];
+		float end1[3];
+		FitPrincipalLine(pixels, pixelCount, 3, end0, end1);
+		best.color0 = Pack565(end1);
+		best.color1 = Pack565(end0);
+		EvaluateBc1(kernels, pixels, pixelCount, fourColorsOnly, best);
+
+		// Weights of indices 0 to 3 toward color1, black doesn't move the endpoints
+		const float fourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		const float threeColorWeights[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+		const uint32_t iterations = GetRefineIterations(quality);
+		for (uint32_t iteration{ 0 }; iteration < iterations; iteration++)
+		{
+			const bool bestThreeColors = best.threeColors && !fourColorsOnly;
+			if (!SolveEndpoints(pixels, pixelCount, 3, best.indices, bestThreeColors ? threeColorWeights : fourColorWeights, end0, end1))
+			{
+				break;
+			}
+			Bc1Candidate candidate = best;
+			candidate.color0 = Pack565(end0);
+			candidate.color1 = Pack565(end1);
+			EvaluateBc1(kernels, pixels, pixelCount, fourColorsOnly, candidate);
+			if (candidate.error >= best.error)
+			{
+				break;
+			}
+			best = candidate;
+		}
+
+		// One step either way on each endpoint channel
+		if (quality == BlockQuality::High)
+		{
+			const uint32_t shifts[3] = { 11, 5, 0 };
+			const uint32_t maximums[3] = { 31, 63, 31 };
+			for (uint32_t end{ 0 }; end < 2; end++)
+			{
+				for (uint32_t channel{ 0 }; channel < 3; channel++)
+				{
+					for (int32_t step{ -1 }; step <= 1; step += 2)
+					{
+						Bc1Candidate candidate = best;
+						uint32_t& color = end == 0 ? candidate.color0 : candidate.color1;
+						const int32_t code = static_cast<int32_t>((color >> shifts[channel]) & maximums[channel]) + step;
+						if (code < 0 || code > static_cast<int32_t>(maximums[channel]))
+						{
+							continue;
+						}
+						color = (color & ~(maximums[channel] << shifts[channel])) | (static_cast<uint32_t>(code) << shifts[channel]);
+						EvaluateBc1(kernels, pixels, pixelCount, fourColorsOnly, candidate);
+						if (candidate.error < best.error)
+						{
+							best = candidate;
+						}
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	void EncodeBc1Colors(const KernelTable& kernels, BlockQuality quality, const BlockPixels& pixels, bool fourColorsOnly, uint8_t* block) {
+		uint32_t opaque = 0xFFFF;
+		if (!fourColorsOnly)
+		{
+			for (uint32_t i{ 0 }; i < 16; i++)
+			{
+				if (pixels.channels[3][i] < 128.0f)
+				{
+					opaque &= ~(1u << i);
+				}
+			}
+		}
+
+		// Transparent pixels only fit the three color mode. Opaque blocks can still use it on High, the halfway
+		// color sometimes lands closer than the two thirds ones.
+		Bc1Candidate best = FitBc1(kernels, quality, pixels, opaque, opaque != 0xFFFF, fourColorsOnly);
+		if (opaque == 0xFFFF && !fourColorsOnly && quality == BlockQuality::High)
+		{
+			const Bc1Candidate threeColors = FitBc1(kernels, quality, pixels, opaque, true, false);
+			if (threeColors.error < best.error)
+			{
+				best = threeColors;
+			}
+		}
+
+		// Back out to the whole block, the gathered indices are in pixel order
+		uint32_t indices = 0;
+		uint32_t gathered = 0;
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			uint32_t index = 3;
+			if (opaque & (1u << i))
+			{
+				index = best.indices[gathered++];
+			}
+			indices |= index << (i * 2);
+		}
+
+		block[0] = static_cast<uint8_t>(best.color0);
+		block[1] = static_cast<uint8_t>(best.color0 >> 8);
+		block[2] = static_cast<uint8_t>(best.color1);
+		block[3] = static_cast<uint8_t>(best.color1 >> 8);
+		memcpy(block + 4, &indices, 4);
+	}
+
+	void DecodeBc1Colors(const uint8_t* block, bool fourColorsOnly, uint8_t* pixels) {
+		uint32_t palette[4][4];
+		GetBc1Palette(block[0] | (block[1] << 8), block[2] | (block[3] << 8), fourColorsOnly, palette);
+		uint32_t indices;
+		memcpy(&indices, block + 4, 4);
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			const uint32_t* color = palette[(indices >> (i * 2)) & 3];
+			for (uint32_t channel{ 0 }; channel < 4; channel++)
+			{
+				pixels[i * 4 + channel] = static_cast<uint8_t>(color[channel]);
+			}
+		}
+	}
+
+	// BC4, one channel
+
+	// Eight levels when end0 > end1, otherwise six and then 0 and 255
+	void GetBc4Palette(uint32_t end0, uint32_t end1, uint32_t* palette) {
+		palette[0] = end0;
+		palette[1] = end1;
+		if (end0 > end1)
+		{
+			for (uint32_t k{ 1 }; k < 7; k++)
+			{
+				palette[k + 1] = ((7 - k) * end0 + k * end1 + 3) / 7;
+			}
+		}
+		else
+		{
+			for (uint32_t k{ 1 }; k < 5; k++)
+			{
+				palette[k + 1] = ((5 - k) * end0 + k * end1 + 2) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	struct Bc4Candidate
+	{
+		uint32_t end0;
+		uint32_t end1;
+		bool sixLevels;
+		uint8_t indices[16];
+		float error;
+	};
+
+	void EvaluateBc4(const KernelTable& kernels, const BlockPixels& pixels, Bc4Candidate& candidate) {
+		if (candidate.sixLevels ? candidate.end0 > candidate.end1 : candidate.end0 < candidate.end1)
+		{
+			const uint32_t end = candidate.end0;
+			candidate.end0 = candidate.end1;
+			candidate.end1 = end;
+		}
+
+		uint32_t decoded[8];
+		GetBc4Palette(candidate.end0, candidate.end1, decoded);
+		Palette palette;
+		palette.count = 8;
+		for (uint32_t entry{ 0 }; entry < 8; entry++)
+		{
+			palette.channels[0][entry] = static_cast<float>(decoded[entry]);
+		}
+		candidate.error = kernels.fitPalette(pixels, 16, 1, palette, candidate.indices);
+	}
+
+	// pixels only has the one channel, in channel 0
+	Bc4Candidate FitBc4(const KernelTable& kernels, BlockQuality quality, const BlockPixels& pixels, bool sixLevels) {
+		// The six level mode has 0 and 255 for free, its endpoints only need to cover what's between them
+		float lowest = 255.0f;
+		float highest = 0.0f;
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			const float value = pixels.channels[0][i];
+			if (sixLevels && (value == 0.0f || value == 255.0f))
+			{
+				continue;
+			}
+			lowest = value < lowest ? value : lowest;
+			highest = value > highest ? value : highest;
+		}
+		if (lowest > highest)
+		{
+			lowest = 0.0f;
+			highest = 255.0f;
+		}
+
+		Bc4Candidate best;
+		best.end0 = QuantizeUnorm(highest, 255);
+		best.end1 = QuantizeUnorm(lowest, 255);
+		best.sixLevels = sixLevels;
+		EvaluateBc4(kernels, pixels, best);
+
+		const float eightLevelWeights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+		const float sixLevelWeights[8] = { 0.0f, 1.0f, 1.0f / 5.0f, 2.0f / 5.0f, 3.0f / 5.0f, 4.0f / 5.0f, -1.0f, -1.0f };
+		const uint32_t iterations = GetRefineIterations(quality);
+		for (uint32_t iteration{ 0 }; iteration < iterations && best.error > 0.0f; iteration++)
+		{
+			float end0;
+			float end1;
+			if (!SolveEndpoints(pixels, 16, 1, best.indices, best.end0 > best.end1 ? eightLevelWeights : sixLevelWeights, &end0, &end1))
+			{
+				break;
+			}
+			Bc4Candidate candidate = best;
+			candidate.end0 = QuantizeUnorm(end0, 255);
+			candidate.end1 = QuantizeUnorm(end1, 255);
+			EvaluateBc4(kernels, pixels, candidate);
+			if (candidate.error >= best.error)
+			{
+				break;
+			}
+			best = candidate;
+		}
+
+		if (quality == BlockQuality::High)
+		{
+			for (uint32_t end{ 0 }; end < 2; end++)
+			{
+				for (int32_t step{ -1 }; step <= 1; step += 2)
+				{
+					Bc4Candidate candidate = best;
+					uint32_t& value = end == 0 ? candidate.end0 : candidate.end1;
+					const int32_t moved = static_cast<int32_t>(value) + step;
+					if (moved < 0 || moved > 255)
+					{
+						continue;
+					}
+					value = static_cast<uint32_t>(moved);
+					EvaluateBc4(kernels, pixels, candidate);
+					if (candidate.error < best.error)
+					{
+						best = candidate;
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	void EncodeBc4(const KernelTable& kernels, BlockQuality quality, const BlockPixels& block, uint32_t channel, uint8_t* out) {
+		BlockPixels pixels;
+		memcpy(pixels.channels[0], block.channels[channel], sizeof(pixels.channels[0]));
+
+		Bc4Candidate best = FitBc4(kernels, quality, pixels, false);
+		if (quality == BlockQuality::High && best.error > 0.0f)
+		{
+			const Bc4Candidate sixLevels = FitBc4(kernels, quality, pixels, true);
+			if (sixLevels.error < best.error)
+			{
+				best = sixLevels;
+			}
+		}
+
+		uint64_t indices = 0;
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			indices |= static_cast<uint64_t>(best.indices[i]) << (i * 3);
+		}
+		out[0] = static_cast<uint8_t>(best.end0);
+		out[1] = static_cast<uint8_t>(best.end1);
+		for (uint32_t i{ 0 }; i < 6; i++)
+		{
+			out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	void DecodeBc4(const uint8_t* block, uint32_t channel, uint8_t* pixels) {
+		uint32_t palette[8];
+		GetBc4Palette(block[0], block[1], palette);
+		uint64_t indices = 0;
+		for (uint32_t i{ 0 }; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		}
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			pixels[i * 4 + channel] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+		}
+	}
+
+	// BC7
+
+	const uint32_t* GetBc7Weights(uint32_t indexBits) {
+		return indexBits == 2 ? Bc7Weights2 : (indexBits == 3 ? Bc7Weights3 : Bc7Weights4);
+	}
+
+	uint32_t GetBc7Subset(uint32_t subsets, uint32_t partition, uint32_t pixel) {
+		if (subsets == 2)
+		{
+			return (Bc7Partitions2[partition] >> pixel) & 1;
+		}
+		if (subsets == 3)
+		{
+			return (Bc7Partitions3[partition] >> (pixel * 2)) & 3;
+		}
+		return 0;
+	}
+
+	uint32_t GetBc7Anchor(uint32_t subsets, uint32_t partition, uint32_t subset) {
+		if (subset == 0)
+		{
+			return 0;
+		}
+		if (subsets == 2)
+		{
+			return Bc7Anchors2[partition];
+		}
+		return subset == 1 ? Bc7Anchors3Second[partition] : Bc7Anchors3Third[partition];
+	}
+
+	bool IsBc7Anchor(uint32_t subsets, uint32_t partition, uint32_t pixel) {
+		return pixel == GetBc7Anchor(subsets, partition, GetBc7Subset(subsets, partition, pixel));
+	}
+
+	// Endpoint bits (p-bit included) up to 8 by repeating the top ones
+	uint32_t ExpandBc7(uint32_t value, uint32_t bits) {
+		value <<= 8 - bits;
+		return value | (value >> bits);
+	}
+
+	uint32_t InterpolateBc7(uint32_t end0, uint32_t end1, uint32_t weight) {
+		return ((64 - weight) * end0 + weight * end1 + 32) >> 6;
+	}
+
+	// The block as a little endian stream of bits
+	class BitReader {
+		private:
+			uint64_t m_low;
+			uint64_t m_high;
+
+		public:
+			explicit BitReader(const uint8_t* block) {
+				memcpy(&m_low, block, 8);
+				memcpy(&m_high, block + 8, 8);
+			}
+
+			uint32_t Read(uint32_t count) {
+				if (count == 0)
+				{
+					return 0;
+				}
+				const uint32_t value = static_cast<uint32_t>(m_low & ((1ull << count) - 1));
+				m_low = (m_low >> count) | (m_high << (64 - count));
+				m_high >>= count;
+				return value;
+			}
+	};
+
+	class BitWriter {
+		private:
+			uint64_t m_low = 0;
+			uint64_t m_high = 0;
+			uint32_t m_position = 0;
+
+		public:
+			void Write(uint32_t value, uint32_t count) {
+				const uint64_t bits = value & ((1ull << count) - 1);
+				if (m_position < 64)
+				{
+					m_low |= bits << m_position;
+					if (m_position + count > 64)
+					{
+						m_high |= bits >> (64 - m_position);
+					}
+				}
+				else
+				{
+					m_high |= bits << (m_position - 64);
+				}
+				m_position += count;
+			}
+
+			void Store(uint8_t* block) const {
+				memcpy(block, &m_low, 8);
+				memcpy(block + 8, &m_high, 8);
+			}
+	};
+
+	void DecodeBc7(const uint8_t* block, uint8_t* pixels) {
+		uint32_t mode{ 0 };
+		while (mode < 8 && !(block[0] & (1u << mode)))
+		{
+			mode++;
+		}
+		// Reserved, decodes to nothing
+		if (mode == 8)
+		{
+			memset(pixels, 0, 64);
+			return;
+		}
+
+		const Bc7Mode& info = Bc7Modes[mode];
+		BitReader bits(block);
+		bits.Read(mode + 1);
+		const uint32_t partition = bits.Read(info.partitionBits);
+		const uint32_t rotation = bits.Read(info.rotationBits);
+		const uint32_t indexSelection = bits.Read(info.indexSelectionBits);
+
+		// Subset * 2 + end
+		uint32_t endpoints[6][4];
+		const uint32_t endpointCount = info.subsets * 2;
+		for (uint32_t channel{ 0 }; channel < 4; channel++)
+		{
+			const uint32_t channelBits = channel < 3 ? info.colorBits : info.alphaBits;
+			for (uint32_t end{ 0 }; end < endpointCount; end++)
+			{
+				endpoints[end][channel] = bits.Read(channelBits);
+			}
+		}
+		uint32_t pBits[6] = {};
+		for (uint32_t end{ 0 }; end < endpointCount && info.endpointPBits; end++)
+		{
+			pBits[end] = bits.Read(1);
+		}
+		for (uint32_t subset{ 0 }; subset < info.subsets && info.sharedPBits; subset++)
+		{
+			pBits[subset * 2] = pBits[subset * 2 + 1] = bits.Read(1);
+		}
+		const uint32_t pBitCount = info.endpointPBits | info.sharedPBits;
+		for (uint32_t end{ 0 }; end < endpointCount; end++)
+		{
+			for (uint32_t channel{ 0 }; channel < 4; channel++)
+			{
+				const uint32_t channelBits = channel < 3 ? info.colorBits : info.alphaBits;
+				endpoints[end][channel] = channelBits == 0 ? 255 :
+					ExpandBc7((endpoints[end][channel] << pBitCount) | pBits[end], channelBits + pBitCount);
+			}
+		}
+
+		uint32_t indices[16];
+		uint32_t secondaryIndices[16] = {};
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			indices[i] = bits.Read(info.indexBits - (IsBc7Anchor(info.subsets, partition, i) ? 1 : 0));
+		}
+		for (uint32_t i{ 0 }; i < 16 && info.secondaryIndexBits; i++)
+		{
+			secondaryIndices[i] = bits.Read(info.secondaryIndexBits - (i == 0 ? 1 : 0));
+		}
+
+		// With a second index set the index selection bit says which one is color
+		const uint32_t* colorIndices = indexSelection ? secondaryIndices : indices;
+		const uint32_t* alphaIndices = info.secondaryIndexBits && !indexSelection ? secondaryIndices : indices;
+		const uint32_t* colorWeights = GetBc7Weights(indexSelection ? info.secondaryIndexBits : info.indexBits);
+		const uint32_t* alphaWeights = GetBc7Weights(info.secondaryIndexBits && !indexSelection ? info.secondaryIndexBits : info.indexBits);
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			const uint32_t subset = GetBc7Subset(info.subsets, partition, i);
+			const uint32_t* end0 = endpoints[subset * 2];
+			const uint32_t* end1 = endpoints[subset * 2 + 1];
+			uint8_t* pixel = pixels + i * 4;
+			for (uint32_t channel{ 0 }; channel < 3; channel++)
+			{
+				pixel[channel] = static_cast<uint8_t>(InterpolateBc7(end0[channel], end1[channel], colorWeights[colorIndices[i]]));
+			}
+			pixel[3] = static_cast<uint8_t>(InterpolateBc7(end0[3], end1[3], alphaWeights[alphaIndices[i]]));
+			if (rotation > 0)
+			{
+				const uint8_t swapped = pixel[rotation - 1];
+				pixel[rotation - 1] = pixel[3];
+				pixel[3] = swapped;
+			}
+		}
+	}
+
+	// The encoder only writes modes 6 (one subset, RGBA, 16 levels), 5 (RGB and alpha indexed separately) and 1
+	// (two subsets, RGB, 8 levels), they cover most blocks well and their endpoint fits are the same code
+
+	// One subset's endpoints as written (codes and p-bits) and as decoded
+	struct Bc7Endpoints
+	{
+		uint32_t codes[2][4];
+		uint32_t pBits[2];
+		uint32_t values[2][4];
+	};
+
+	void DecodeBc7Endpoints(const Bc7Mode& mode, Bc7Endpoints& endpoints) {
+		const uint32_t pBitCount = mode.endpointPBits | mode.sharedPBits;
+		for (uint32_t end{ 0 }; end < 2; end++)
+		{
+			for (uint32_t channel{ 0 }; channel < 4; channel++)
+			{
+				const uint32_t channelBits = channel < 3 ? mode.colorBits : mode.alphaBits;
+				endpoints.values[end][channel] = channelBits == 0 ? 255 :
+					ExpandBc7((endpoints.codes[end][channel] << pBitCount) | endpoints.pBits[end], channelBits + pBitCount);
+			}
+		}
+	}
+
+	// Closest codes for both ends. Each p-bit choice is tried, per endpoint or for the pair when it's shared.
+	void QuantizeBc7Endpoints(const Bc7Mode& mode, const float* end0, const float* end1, uint32_t channelCount, Bc7Endpoints& endpoints) {
+		const float* ends[2] = { end0, end1 };
+		const uint32_t pBitCount = mode.endpointPBits | mode.sharedPBits;
+		float errors[2][2] = {};
+		uint32_t codes[2][2][4] = {};
+		for (uint32_t pBit{ 0 }; pBit <= pBitCount; pBit++)
+		{
+			for (uint32_t end{ 0 }; end < 2; end++)
+			{
+				for (uint32_t channel{ 0 }; channel < 4; channel++)
+				{
+					const uint32_t channelBits = channel < 3 ? mode.colorBits : mode.alphaBits;
+					if (channelBits == 0)
+					{
+						continue;
+					}
+					// Alpha a mode doesn't fit (mode 1) has to land on 255. The fitted line can run past either end
+					// of the range, clamp it first or every code candidate is out of range.
+					float value = channel < channelCount ? ends[end][channel] : 255.0f;
+					value = value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value);
+					const uint32_t maximum = (1u << channelBits) - 1;
+					const float scaled = (value * static_cast<float>((1u << (channelBits + pBitCount)) - 1) / 255.0f - static_cast<float>(pBit)) /
+						static_cast<float>(1u << pBitCount);
+					const int32_t guess = static_cast<int32_t>(std::floor(scaled + 0.5f));
+					float bestError = FLT_MAX;
+					for (int32_t code{ guess - 1 }; code <= guess + 1; code++)
+					{
+						if (code < 0 || code > static_cast<int32_t>(maximum))
+						{
+							continue;
+						}
+						const float decoded = static_cast<float>(ExpandBc7((static_cast<uint32_t>(code) << pBitCount) | pBit, channelBits + pBitCount));
+						const float error = (decoded - value) * (decoded - value);
+						if (error < bestError)
+						{
+							bestError = error;
+							codes[pBit][end][channel] = static_cast<uint32_t>(code);
+						}
+					}
+					errors[pBit][end] += bestError;
+				}
+			}
+		}
+
+		for (uint32_t end{ 0 }; end < 2; end++)
+		{
+			uint32_t pBit = 0;
+			if (mode.endpointPBits)
+			{
+				pBit = errors[1][end] < errors[0][end] ? 1 : 0;
+			}
+			else if (mode.sharedPBits)
+			{
+				pBit = errors[1][0] + errors[1][1] < errors[0][0] + errors[0][1] ? 1 : 0;
+			}
+			endpoints.pBits[end] = pBit;
+			memcpy(endpoints.codes[end], codes[pBit][end], sizeof(endpoints.codes[end]));
+		}
+		DecodeBc7Endpoints(mode, endpoints);
+	}
+
+	struct Bc7SubsetFit
+	{
+		Bc7Endpoints endpoints;
+		uint8_t indices[16];
+		float error;
+	};
+
+	void EvaluateBc7Subset(const KernelTable& kernels, const Bc7Mode& mode, const BlockPixels& pixels, uint32_t pixelCount, uint32_t channelCount,
+		Bc7SubsetFit& fit) {
+
+		const uint32_t* weights = GetBc7Weights(mode.indexBits);
+		Palette palette;
+		palette.count = 1u << mode.indexBits;
+		for (uint32_t entry{ 0 }; entry < palette.count; entry++)
+		{
+			for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+			{
+				palette.channels[channel][entry] = static_cast<float>(InterpolateBc7(fit.endpoints.values[0][channel], fit.endpoints.values[1][channel], weights[entry]));
+			}
+		}
+		fit.error = kernels.fitPalette(pixels, pixelCount, channelCount, palette, fit.indices);
+	}
+
+	Bc7SubsetFit FitBc7Subset(const KernelTable& kernels, BlockQuality quality, const Bc7Mode& mode, const BlockPixels& pixels, uint32_t pixelCount,
+		uint32_t channelCount) {
+
+		float end0[4];
+		float end1[4];
+		FitPrincipalLine(pixels, pixelCount, channelCount, end0, end1);
+		Bc7SubsetFit best;
+		QuantizeBc7Endpoints(mode, end0, end1, channelCount, best.endpoints);
+		EvaluateBc7Subset(kernels, mode, pixels, pixelCount, channelCount, best);
+
+		const uint32_t* weights = GetBc7Weights(mode.indexBits);
+		float lineWeights[16];
+		for (uint32_t entry{ 0 }; entry < (1u << mode.indexBits); entry++)
+		{
+			lineWeights[entry] = static_cast<float>(weights[entry]) / 64.0f;
+		}
+		const uint32_t iterations = GetRefineIterations(quality);
+		for (uint32_t iteration{ 0 }; iteration < iterations && best.error > 0.0f; iteration++)
+		{
+			if (!SolveEndpoints(pixels, pixelCount, channelCount, best.indices, lineWeights, end0, end1))
+			{
+				break;
+			}
+			Bc7SubsetFit candidate;
+			QuantizeBc7Endpoints(mode, end0, end1, channelCount, candidate.endpoints);
+			EvaluateBc7Subset(kernels, mode, pixels, pixelCount, channelCount, candidate);
+			if (candidate.error >= best.error)
+			{
+				break;
+			}
+			best = candidate;
+		}
+
+		if (quality == BlockQuality::High)
+		{
+			for (uint32_t end{ 0 }; end < 2; end++)
+			{
+				for (uint32_t channel{ 0 }; channel < channelCount; channel++)
+				{
+					const uint32_t maximum = (1u << (channel < 3 ? mode.colorBits : mode.alphaBits)) - 1;
+					for (int32_t step{ -1 }; step <= 1; step += 2)
+					{
+						Bc7SubsetFit candidate = best;
+						const int32_t code = static_cast<int32_t>(candidate.endpoints.codes[end][channel]) + step;
+						if (code < 0 || code > static_cast<int32_t>(maximum))
+						{
+							continue;
+						}
+						candidate.endpoints.codes[end][channel] = static_cast<uint32_t>(code);
+						DecodeBc7Endpoints(mode, candidate.endpoints);
+						EvaluateBc7Subset(kernels, mode, pixels, pixelCount, channelCount, candidate);
+						if (candidate.error < best.error)
+						{
+							best = candidate;
+						}
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+	// The anchor's index loses its top bit, so it has to be in the lower half. Swapping the ends flips the
+	// indices over.
+	void FixBc7Anchor(const Bc7Mode& mode, Bc7SubsetFit& fit, uint32_t anchor, uint32_t pixelCount) {
+		const uint32_t highest = (1u << mode.indexBits) - 1;
+		if (fit.indices[anchor] <= highest >> 1)
+		{
+			return;
+		}
+		for (uint32_t channel{ 0 }; channel < 4; channel++)
+		{
+			const uint32_t code = fit.endpoints.codes[0][channel];
+			fit.endpoints.codes[0][channel] = fit.endpoints.codes[1][channel];
+			fit.endpoints.codes[1][channel] = code;
+		}
+		const uint32_t pBit = fit.endpoints.pBits[0];
+		fit.endpoints.pBits[0] = fit.endpoints.pBits[1];
+		fit.endpoints.pBits[1] = pBit;
+		for (uint32_t i{ 0 }; i < pixelCount; i++)
+		{
+			fit.indices[i] = static_cast<uint8_t>(highest - fit.indices[i]);
+		}
+	}
+
+	float EncodeBc7Mode6(const KernelTable& kernels, BlockQuality quality, const BlockPixels& pixels, uint8_t* block) {
+		const Bc7Mode& mode = Bc7Modes[6];
+		Bc7SubsetFit fit = FitBc7Subset(kernels, quality, mode, pixels, 16, 4);
+		FixBc7Anchor(mode, fit, 0, 16);
+
+		BitWriter bits;
+		bits.Write(1u << 6, 7);
+		for (uint32_t channel{ 0 }; channel < 4; channel++)
+		{
+			bits.Write(fit.endpoints.codes[0][channel], 7);
+			bits.Write(fit.endpoints.codes[1][channel], 7);
+		}
+		bits.Write(fit.endpoints.pBits[0], 1);
+		bits.Write(fit.endpoints.pBits[1], 1);
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			bits.Write(fit.indices[i], i == 0 ? 3 : 4);
+		}
+		bits.Store(block);
+		return fit.error;
+	}
+
+	// For blocks whose alpha doesn't follow the color, mode 6's one line through RGBA can't have both. RGB and alpha
+	// get their own endpoints and indices, no rotation.
+	float EncodeBc7Mode5(const KernelTable& kernels, BlockQuality quality, const BlockPixels& pixels, uint8_t* block) {
+		const Bc7Mode& mode = Bc7Modes[5];
+		Bc7SubsetFit color = FitBc7Subset(kernels, quality, mode, pixels, 16, 3);
+		FixBc7Anchor(mode, color, 0, 16);
+
+		// Alpha fits as a one channel "color" with 8 bit endpoints and 2 bit indices
+		const Bc7Mode alphaMode = { 1, 0, 0, 0, mode.alphaBits, 0, 0, 0, mode.secondaryIndexBits, 0 };
+		BlockPixels alphaPixels;
+		memcpy(alphaPixels.channels[0], pixels.channels[3], sizeof(alphaPixels.channels[0]));
+		Bc7SubsetFit alpha = FitBc7Subset(kernels, quality, alphaMode, alphaPixels, 16, 1);
+		FixBc7Anchor(alphaMode, alpha, 0, 16);
+
+		BitWriter bits;
+		bits.Write(1u << 5, 6);
+		bits.Write(0, 2);
+		for (uint32_t channel{ 0 }; channel < 3; channel++)
+		{
+			bits.Write(color.endpoints.codes[0][channel], 7);
+			bits.Write(color.endpoints.codes[1][channel], 7);
+		}
+		bits.Write(alpha.endpoints.codes[0][0], 8);
+		bits.Write(alpha.endpoints.codes[1][0], 8);
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			bits.Write(color.indices[i], i == 0 ? 1 : 2);
+		}
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			bits.Write(alpha.indices[i], i == 0 ? 1 : 2);
+		}
+		bits.Store(block);
+		return color.error + alpha.error;
+	}
+
+	// Opaque blocks only, mode 1 has no alpha
+	float EncodeBc7Mode1(const KernelTable& kernels, BlockQuality quality, const BlockPixels& pixels, uint32_t partition, uint8_t* block) {
+		const Bc7Mode& mode = Bc7Modes[1];
+		Bc7SubsetFit fits[2];
+		uint32_t masks[2];
+		float error = 0.0f;
+		for (uint32_t subset{ 0 }; subset < 2; subset++)
+		{
+			masks[subset] = subset == 0 ? static_cast<uint32_t>(~Bc7Partitions2[partition] & 0xFFFF) : Bc7Partitions2[partition];
+			BlockPixels gathered;
+			const uint32_t pixelCount = GatherPixels(pixels, masks[subset], gathered);
+			fits[subset] = FitBc7Subset(kernels, quality, mode, gathered, pixelCount, 3);
+
+			// The anchor's position among the gathered pixels
+			const uint32_t anchor = GetBc7Anchor(2, partition, subset);
+			FixBc7Anchor(mode, fits[subset], CountSetBits(masks[subset] & ((1u << anchor) - 1)), pixelCount);
+			error += fits[subset].error;
+		}
+
+		BitWriter bits;
+		bits.Write(1u << 1, 2);
+		bits.Write(partition, 6);
+		for (uint32_t channel{ 0 }; channel < 3; channel++)
+		{
+			for (uint32_t subset{ 0 }; subset < 2; subset++)
+			{
+				bits.Write(fits[subset].endpoints.codes[0][channel], 6);
+				bits.Write(fits[subset].endpoints.codes[1][channel], 6);
+			}
+		}
+		bits.Write(fits[0].endpoints.pBits[0], 1);
+		bits.Write(fits[1].endpoints.pBits[0], 1);
+		uint32_t gathered[2] = {};
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			const uint32_t subset = GetBc7Subset(2, partition, i);
+			bits.Write(fits[subset].indices[gathered[subset]++], IsBc7Anchor(2, partition, i) ? 2 : 3);
+		}
+		bits.Store(block);
+		return error;
+	}
+
+	void EncodeBc7(const KernelTable& kernels, BlockQuality quality, const BlockPixels& pixels, uint8_t* block) {
+		float bestError = EncodeBc7Mode6(kernels, quality, pixels, block);
+		if (bestError == 0.0f)
+		{
+			return;
+		}
+		bool opaque = true;
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			opaque = opaque && pixels.channels[3][i] == 255.0f;
+		}
+		// Opaque blocks try mode 5 too past Fast, its 7 bit color without p-bits is the only way to some saturated
+		// colors exactly (255, 0, 255 has no match in mode 6)
+		if (!opaque || quality != BlockQuality::Fast)
+		{
+			uint8_t candidate[16];
+			const float error = EncodeBc7Mode5(kernels, quality, pixels, candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(block, candidate, 16);
+			}
+		}
+		if (!opaque || quality == BlockQuality::Fast || bestError == 0.0f)
+		{
+			return;
+		}
+
+		// Rank the partitions by how well two lines fit them, only the best few get a real encode
+		const uint32_t tryCount = quality == BlockQuality::High ? 4 : 1;
+		uint32_t candidates[4];
+		float candidateErrors[4];
+		for (uint32_t i{ 0 }; i < tryCount; i++)
+		{
+			candidates[i] = 0;
+			candidateErrors[i] = FLT_MAX;
+		}
+		float estimates[64];
+		kernels.partitionErrors(MomentTerms(pixels), estimates);
+		for (uint32_t partition{ 0 }; partition < 64; partition++)
+		{
+			const float estimate = estimates[partition];
+			for (uint32_t i{ 0 }; i < tryCount; i++)
+			{
+				if (estimate < candidateErrors[i])
+				{
+					for (uint32_t j{ tryCount - 1 }; j > i; j--)
+					{
+						candidates[j] = candidates[j - 1];
+						candidateErrors[j] = candidateErrors[j - 1];
+					}
+					candidates[i] = partition;
+					candidateErrors[i] = estimate;
+					break;
+				}
+			}
+		}
+
+		for (uint32_t i{ 0 }; i < tryCount; i++)
+		{
+			uint8_t candidate[16];
+			const float error = EncodeBc7Mode1(kernels, quality, pixels, candidates[i], candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(block, candidate, 16);
+			}
+		}
+	}
+
+	void LoadBlockPixels(const uint8_t* rgba, BlockPixels& pixels) {
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			for (uint32_t channel{ 0 }; channel < 4; channel++)
+			{
+				pixels.channels[channel][i] = static_cast<float>(rgba[i * 4 + channel]);
+			}
+		}
+	}
+
+	uint32_t GetBlockCount(uint32_t pixels) {
+		return (pixels + 3) / 4;
+	}
+
+}
+
+uint32_t GetBlockByteSize(BlockFormat format) {
+	return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+uint64_t ComputeBlockFootprints(BlockFormat format, uint32_t width, uint32_t height, uint32_t levelCount, MipFootprint* footprints) {
+	const uint32_t blockSize = GetBlockByteSize(format);
+	uint64_t offset = 0;
+	uint64_t totalSize = 0;
+	for (uint32_t level{ 0 }; level < levelCount; level++)
+	{
+		MipFootprint& footprint = footprints[level];
+		footprint.width = width >> level > 0 ? width >> level : 1;
+		footprint.height = height >> level > 0 ? height >> level : 1;
+		const uint64_t rowSize = static_cast<uint64_t>(GetBlockCount(footprint.width)) * blockSize;
+		footprint.rowPitch = static_cast<uint32_t>(AlignUp(rowSize, MipFootprintPitchAlignment));
+		footprint.offset = AlignUp(offset, MipFootprintPlacementAlignment);
+
+		totalSize = footprint.offset + static_cast<uint64_t>(footprint.rowPitch) * (GetBlockCount(footprint.height) - 1) + rowSize;
+		offset = totalSize;
+	}
+	return totalSize;
+}
+
+void EncodeBlock(const BlockEncodeDesc& desc, const uint8_t* pixels, uint8_t* block) {
+	const KernelTable& kernels = GetKernels();
+	BlockPixels loaded;
+	LoadBlockPixels(pixels, loaded);
+
+	switch (desc.format)
+	{
+	case BlockFormat::BC1:
+		EncodeBc1Colors(kernels, desc.quality, loaded, false, block);
+		break;
+	case BlockFormat::BC3:
+		EncodeBc4(kernels, desc.quality, loaded, 3, block);
+		EncodeBc1Colors(kernels, desc.quality, loaded, true, block + 8);
+		break;
+	case BlockFormat::BC4:
+		EncodeBc4(kernels, desc.quality, loaded, 0, block);
+		break;
+	case BlockFormat::BC5:
+		EncodeBc4(kernels, desc.quality, loaded, 0, block);
+		EncodeBc4(kernels, desc.quality, loaded, 1, block + 8);
+		break;
+	case BlockFormat::BC7:
+		EncodeBc7(kernels, desc.quality, loaded, block);
+		break;
+	}
+}
+
+void DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels) {
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		DecodeBc1Colors(block, false, pixels);
+		break;
+	case BlockFormat::BC3:
+		DecodeBc1Colors(block + 8, true, pixels);
+		DecodeBc4(block, 3, pixels);
+		break;
+	case BlockFormat::BC4:
+	case BlockFormat::BC5:
+		for (uint32_t i{ 0 }; i < 16; i++)
+		{
+			pixels[i * 4 + 1] = 0;
+			pixels[i * 4 + 2] = 0;
+			pixels[i * 4 + 3] = 255;
+		}
+		DecodeBc4(block, 0, pixels);
+		if (format == BlockFormat::BC5)
+		{
+			DecodeBc4(block + 8, 1, pixels);
+		}
+		break;
+	case BlockFormat::BC7:
+		DecodeBc7(block, pixels);
+		break;
+	}
+}
+
+void EncodeBlockRows(const BlockEncodeDesc& desc, const uint8_t* source, const MipFootprint& sourceFootprint,
+	uint8_t* destination, const MipFootprint& destinationFootprint, uint32_t firstBlockRow, uint32_t blockRowCount) {
+
+	const uint32_t blockSize = GetBlockByteSize(desc.format);
+	const uint32_t blocksWide = GetBlockCount(sourceFootprint.width);
+	for (uint32_t blockY{ firstBlockRow }; blockY < firstBlockRow + blockRowCount; blockY++)
+	{
+		uint8_t* out = destination + static_cast<uint64_t>(blockY) * destinationFootprint.rowPitch;
+		for (uint32_t blockX{ 0 }; blockX < blocksWide; blockX++)
+		{
+			uint8_t pixels[64];
+			for (uint32_t y{ 0 }; y < 4; y++)
+			{
+				const uint32_t sourceY = blockY * 4 + y < sourceFootprint.height ? blockY * 4 + y : sourceFootprint.height - 1;
+				const uint8_t* row = source + static_cast<uint64_t>(sourceY) * sourceFootprint.rowPitch;
+				if (blockX * 4 + 4 <= sourceFootprint.width)
+				{
+					memcpy(pixels + y * 16, row + blockX * 16, 16);
+					continue;
+				}
+				for (uint32_t x{ 0 }; x < 4; x++)
+				{
+					const uint32_t sourceX = blockX * 4 + x < sourceFootprint.width ? blockX * 4 + x : sourceFootprint.width - 1;
+					memcpy(pixels + (y * 4 + x) * 4, row + sourceX * 4, 4);
+				}
+			}
+			EncodeBlock(desc, pixels, out + blockX * blockSize);
+		}
+	}
+}
+
+void CompressTexture(const BlockEncodeDesc& desc, const uint8_t* source, const MipFootprint* sourceFootprints,
+	uint8_t* destination, const MipFootprint* destinationFootprints, uint32_t levelCount, JobSystem* jobSystem) {
+
+	// Where each level's tiles start in one flat list
+	std::vector<uint32_t> firstTiles(levelCount + 1, 0);
+	for (uint32_t level{ 0 }; level < levelCount; level++)
+	{
+		const uint32_t blockRows = GetBlockCount(sourceFootprints[level].height);
+		firstTiles[level + 1] = firstTiles[level] + (blockRows + BlockTileRows - 1) / BlockTileRows;
+	}
+
+	auto encodeTile = [&](uint32_t tile) {
+		uint32_t level{ 0 };
+		while (tile >= firstTiles[level + 1])
+		{
+			level++;
+		}
+		const uint32_t blockRows = GetBlockCount(sourceFootprints[level].height);
+		const uint32_t firstBlockRow = (tile - firstTiles[level]) * BlockTileRows;
+		const uint32_t blockRowCount = blockRows - firstBlockRow < BlockTileRows ? blockRows - firstBlockRow : BlockTileRows;
+		EncodeBlockRows(desc, source + sourceFootprints[level].offset, sourceFootprints[level],
+			destination + destinationFootprints[level].offset, destinationFootprints[level], firstBlockRow, blockRowCount);
+	};
+
+	const uint32_t tileCount = firstTiles[levelCount];
+	if (!jobSystem || tileCount <= 1)
+	{
+		for (uint32_t tile{ 0 }; tile < tileCount; tile++)
+		{
+			encodeTile(tile);
+		}
+		return;
+	}
+
+	JobCounter counter;
+	jobSystem->ParallelFor(tileCount, 1, [&](uint32_t tile, uint32_t) {
+		encodeTile(tile);
+	}, &counter);
+	jobSystem->Wait(counter);
+}
+
+void DecompressLevel(BlockFormat format, const uint8_t* source, const MipFootprint& sourceFootprint,
+	uint8_t* destination, const MipFootprint& destinationFootprint) {
+
+	const uint32_t blockSize = GetBlockByteSize(format);
+	for (uint32_t blockY{ 0 }; blockY < GetBlockCount(sourceFootprint.height); blockY++)
+	{
+		const uint8_t* blocks = source + static_cast<uint64_t>(blockY) * sourceFootprint.rowPitch;
+		for (uint32_t blockX{ 0 }; blockX < GetBlockCount(sourceFootprint.width); blockX++)
+		{
+			uint8_t pixels[64];
+			DecodeBlock(format, blocks + blockX * blockSize, pixels);
+			for (uint32_t y{ 0 }; y < 4 && blockY * 4 + y < destinationFootprint.height; y++)
+			{
+				const uint32_t width = destinationFootprint.width - blockX * 4 < 4 ? destinationFootprint.width - blockX * 4 : 4;
+				memcpy(destination + static_cast<uint64_t>(blockY * 4 + y) * destinationFootprint.rowPitch + blockX * 16, pixels + y * 16, width * 4);
+			}
+		}
+	}
+}
+
+SimdLevel GetBlockCompressionKernelLevel() {
+	return GetKernels().level;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "../Core/CpuFeatures.h"
+#include "MipChain.h"
+#include <cstdint>
+
+class JobSystem;
+
+// 4x4 pixel blocks, same layout as the DXGI_FORMAT_BCn_UNORM formats
+enum class BlockFormat
+{
+	BC1,		// RGB, 8 bytes. Pixels with alpha under 128 come out transparent black.
+	BC3,		// BC1 color and a BC4 alpha block, 16 bytes
+	BC4,		// R only, 8 bytes
+	BC5,		// R and G as two BC4 blocks, 16 bytes
+	BC7			// RGBA, 16 bytes
+};
+
+enum class BlockQuality
+{
+	Fast,		// Endpoints straight from the principal axis, one index pass
+	Normal,		// Plus least squares endpoint refinement, BC7 also tries mode 5 and its best two subset partition on opaque blocks
+	High		// More refinement, a nudge search on the endpoints and BC7's best four partitions
+};
+
+struct BlockEncodeDesc
+{
+	BlockFormat format = BlockFormat::BC7;
+	BlockQuality quality = BlockQuality::Normal;
+};
+
+// Block rows handed to one job
+static const uint32_t BlockTileRows = 4;
+
+uint32_t GetBlockByteSize(BlockFormat format);
+// Same as ComputeMipFootprints, but a row is a row of blocks. width and height stay in pixels, levels under 4x4
+// still take a whole block. BC textures need their top level to be a multiple of 4 in both directions.
+uint64_t ComputeBlockFootprints(BlockFormat format, uint32_t width, uint32_t height, uint32_t levelCount, MipFootprint* footprints);
+
+// One block from 16 RGBA8 pixels, row by row
+void EncodeBlock(const BlockEncodeDesc& desc, const uint8_t* pixels, uint8_t* block);
+// And back. BC4 and BC5 fill in the channels they don't have as 0 (alpha 255), like the GPU does.
+void DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels);
+
+// Encodes block rows [firstBlockRow, firstBlockRow + blockRowCount) of an RGBA8 level into destination, both
+// pointing at the levels themselves. Blocks past the right or bottom edge repeat the last column / row.
+void EncodeBlockRows(const BlockEncodeDesc& desc, const uint8_t* source, const MipFootprint& sourceFootprint,
+	uint8_t* destination, const MipFootprint& destinationFootprint, uint32_t firstBlockRow, uint32_t blockRowCount);
+// levelCount RGBA8 levels laid out by ComputeMipFootprints into a chain laid out by ComputeBlockFootprints.
+// Levels don't depend on each other, so every level's BlockTileRows tiles go over the job system at once (or all
+// on the calling thread without one). Only writes destination, in order, so an upload heap is fine.
+void CompressTexture(const BlockEncodeDesc& desc, const uint8_t* source, const MipFootprint* sourceFootprints,
+	uint8_t* destination, const MipFootprint* destinationFootprints, uint32_t levelCount, JobSystem* jobSystem);
+// One compressed level back to RGBA8, for checking what the encoder did
+void DecompressLevel(BlockFormat format, const uint8_t* source, const MipFootprint& sourceFootprint,
+	uint8_t* destination, const MipFootprint& destinationFootprint);
+
+// The widest fit and partition kernels in use
+SimdLevel GetBlockCompressionKernelLevel();
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Recycles command allocators (or anything else the GPU reads from) once the fence value they were
+// submitted under has completed. Fence values passed to Release must not go backwards.
+// Not thread safe, every recording thread owns its own pool so acquiring never takes a lock.
+template<typename T>
+class CommandAllocatorPool {
+	private:
+		struct PendingEntry
+		{
+			T allocator;
+			uint64_t fenceValue;
+		};
+
+		std::deque<PendingEntry> m_pending;		// Oldest fence value at the front
+		std::vector<T> m_free;
+
+	public:
+		void Release(const T& allocator, uint64_t fenceValue)
+		{
+			PendingEntry entry = { allocator, fenceValue };
+			m_pending.push_back(entry);
+		}
+
+		// False if nothing has retired yet, the caller creates a new allocator in that case
+		bool Acquire(uint64_t completedFenceValue, T& allocator)
+		{
+			while (!m_pending.empty() && m_pending.front().fenceValue <= completedFenceValue)
+			{
+				m_free.push_back(m_pending.front().allocator);
+				m_pending.pop_front();
+			}
+
+			if (m_free.empty())
+			{
+				return false;
+			}
+
+			allocator = m_free.back();
+			m_free.pop_back();
+			return true;
+		}
+
+		void Clear()
+		{
+			m_pending.clear();
+			m_free.clear();
+		}
+
+		size_t GetPendingCount() const { return m_pending.size(); }
+		size_t GetFreeCount() const { return m_free.size(); }
+};
@@ -0,0 +1,44 @@
+#include "D3D12CommandBackend.h"
+#include <vector>
+
+void D3D12CommandBackend::Initialize(ID3D12Device8* device, ID3D12CommandQueue* commandQueue, D3D12_COMMAND_LIST_TYPE type) {
+	m_device = device;
+	m_commandQueue = commandQueue;
+	m_type = type;
+}
+
+D3D12CommandBackend::Allocator D3D12CommandBackend::CreateAllocator() {
+	// Device creation calls are free threaded, this runs on the recording threads
+	Allocator allocator;
+	DXCall(m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(&allocator)));
+	return allocator;
+}
+
+void D3D12CommandBackend::ResetAllocator(Allocator& allocator) {
+	DXCall(allocator->Reset());
+}
+
+D3D12CommandBackend::CommandList D3D12CommandBackend::CreateCommandList() {
+	// CreateCommandList1 hands it back closed, no allocator needed until it's reset
+	CommandList list;
+	DXCall(m_device->CreateCommandList1(0, m_type, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&list)));
+	return list;
+}
+
+void D3D12CommandBackend::BeginCommandList(CommandList& list, Allocator& allocator) {
+	DXCall(list->Reset(allocator.Get(), nullptr));
+}
+
+void D3D12CommandBackend::CloseCommandList(CommandList& list) {
+	DXCall(list->Close());
+}
+
+void D3D12CommandBackend::ExecuteCommandLists(CommandList* lists, uint32_t count) {
+	std::vector<ID3D12CommandList*> commandLists(count);
+	for (uint32_t i{ 0 }; i < count; i++)
+	{
+		commandLists[i] = lists[i].Get();
+	}
+
+	m_commandQueue->ExecuteCommandLists(count, commandLists.data());
+}
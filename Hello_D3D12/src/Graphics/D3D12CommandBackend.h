@@ -0,0 +1,24 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+
+// ParallelCommandRecorder backend that records real D3D12 command lists and submits them to one queue
+class D3D12CommandBackend {
+	public:
+		typedef ComPtr<ID3D12CommandAllocator> Allocator;
+		typedef ComPtr<ID3D12GraphicsCommandList> CommandList;
+
+	private:
+		ID3D12Device8* m_device = nullptr;
+		ID3D12CommandQueue* m_commandQueue = nullptr;
+		D3D12_COMMAND_LIST_TYPE m_type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+	public:
+		void Initialize(ID3D12Device8* device, ID3D12CommandQueue* commandQueue, D3D12_COMMAND_LIST_TYPE type);
+
+		Allocator CreateAllocator();
+		void ResetAllocator(Allocator& allocator);
+		CommandList CreateCommandList();
+		void BeginCommandList(CommandList& list, Allocator& allocator);
+		void CloseCommandList(CommandList& list);
+		void ExecuteCommandLists(CommandList* lists, uint32_t count);
+};
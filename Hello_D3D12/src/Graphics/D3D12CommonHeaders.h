@@ -38,7 +38,7 @@ if(FAILED(x)) {										\
 #endif // !DXCall
 #else
 #ifndef DXCall
-#deinfe DXCall(x) x
+#define DXCall(x) x
 #endif // !DXCall
 #endif // _DEBUG
 
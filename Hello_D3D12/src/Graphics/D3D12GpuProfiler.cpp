@@ -0,0 +1,115 @@
+#include "D3D12GpuProfiler.h"
+
+void D3D12GpuProfiler::Initialize(ID3D12Device8* device, ID3D12CommandQueue* queue, Profiler* profiler, const char* trackName) {
+	m_queue = queue;
+	m_profiler.Initialize(profiler, trackName);
+	for (UINT& count : m_resolvedCount)
+	{
+		count = 0;
+	}
+
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = QueriesPerFrame * FrameScheduler::MaxFramesInFlight;
+	queryHeapDesc.NodeMask = 0;
+	DXCall(device->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_queryHeap)));
+	NAME_D3D12_OBJECT(m_queryHeap, L"GpuProfilerQueryHeap");
+
+	// Readback heaps aren't something the heap allocator does, one small committed buffer is fine
+	D3D12_HEAP_PROPERTIES heapProperties = {};
+	heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+	heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProperties.CreationNodeMask = 1;
+	heapProperties.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC readbackDesc = {};
+	readbackDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	readbackDesc.Alignment = 0;
+	readbackDesc.Width = static_cast<UINT64>(queryHeapDesc.Count) * sizeof(UINT64);
+	readbackDesc.Height = 1;
+	readbackDesc.DepthOrArraySize = 1;
+	readbackDesc.MipLevels = 1;
+	readbackDesc.Format = DXGI_FORMAT_UNKNOWN;
+	readbackDesc.SampleDesc.Count = 1;
+	readbackDesc.SampleDesc.Quality = 0;
+	readbackDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	readbackDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	DXCall(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &readbackDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_readback)));
+	NAME_D3D12_OBJECT(m_readback, L"GpuProfilerReadback");
+
+	DXCall(m_queue->GetTimestampFrequency(&m_timestampFrequency));
+	LARGE_INTEGER cpuFrequency;
+	QueryPerformanceFrequency(&cpuFrequency);
+	m_cpuFrequency = static_cast<UINT64>(cpuFrequency.QuadPart);
+}
+
+void D3D12GpuProfiler::Shutdown() {
+	m_readback.Reset();
+	m_queryHeap.Reset();
+	m_queue = nullptr;
+}
+
+GpuClockCalibration D3D12GpuProfiler::Calibrate() const {
+	GpuClockCalibration calibration;
+	UINT64 cpuTicks = 0;
+	DXCall(m_queue->GetClockCalibration(&calibration.gpuTimestamp, &cpuTicks));
+	calibration.gpuFrequency = m_timestampFrequency;
+
+	// QPC ticks to ns the way steady_clock does it on Windows, split so the multiply can't overflow
+	const UINT64 seconds = cpuTicks / m_cpuFrequency;
+	const UINT64 remainder = cpuTicks % m_cpuFrequency;
+	calibration.cpuTime = static_cast<int64_t>(seconds * 1000000000ull + remainder * 1000000000ull / m_cpuFrequency);
+	return calibration;
+}
+
+void D3D12GpuProfiler::BeginFrame(UINT frameIndex) {
+	const UINT count = m_resolvedCount[frameIndex];
+	if (count > 0)
+	{
+		const SIZE_T offset = static_cast<SIZE_T>(frameIndex) * QueriesPerFrame * sizeof(UINT64);
+		D3D12_RANGE readRange = { offset, offset + count * sizeof(UINT64) };
+		UINT8* data = nullptr;
+		DXCall(m_readback->Map(0, &readRange, reinterpret_cast<void**>(&data)));
+		m_profiler.ResolveFrame(frameIndex, reinterpret_cast<const uint64_t*>(data + offset), Calibrate());
+
+		// Nothing written
+		D3D12_RANGE writeRange = {};
+		m_readback->Unmap(0, &writeRange);
+	}
+
+	m_resolvedCount[frameIndex] = 0;
+	m_profiler.BeginFrame(frameIndex);
+}
+
+void D3D12GpuProfiler::BeginZone(ID3D12GraphicsCommandList* commandList, UINT zone) const {
+	if (zone != GpuProfiler::InvalidZone)
+	{
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+			m_profiler.GetFrameIndex() * QueriesPerFrame + GpuProfiler::GetBeginQuery(zone));
+	}
+}
+
+void D3D12GpuProfiler::EndZone(ID3D12GraphicsCommandList* commandList, UINT zone) const {
+	if (zone != GpuProfiler::InvalidZone)
+	{
+		commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP,
+			m_profiler.GetFrameIndex() * QueriesPerFrame + GpuProfiler::GetEndQuery(zone));
+	}
+}
+
+void D3D12GpuProfiler::ResolveFrame(ID3D12GraphicsCommandList* commandList) {
+	const UINT frameIndex = m_profiler.GetFrameIndex();
+	const UINT count = m_profiler.GetFrameQueryCount(frameIndex);
+	m_resolvedCount[frameIndex] = count;
+	if (count == 0)
+	{
+		return;
+	}
+
+	const UINT first = frameIndex * QueriesPerFrame;
+	commandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, count, m_readback.Get(),
+		static_cast<UINT64>(first) * sizeof(UINT64));
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+#include "GpuProfiler.h"
+
+// GpuProfiler on a D3D12 queue. Every frame slot owns a range of one timestamp query heap and of one readback
+// buffer, the last command list of the frame resolves the slot's queries into its range and BeginFrame reads
+// them back once the scheduler says the slot is retired, so nothing ever waits on the GPU for timings.
+// Timestamps are put on the CPU timeline with the queue's clock calibration.
+class D3D12GpuProfiler {
+	private:
+		static const UINT QueriesPerFrame = GpuProfiler::MaxZonesPerFrame * 2;
+
+		GpuProfiler m_profiler;
+		ID3D12CommandQueue* m_queue = nullptr;
+		ComPtr<ID3D12QueryHeap> m_queryHeap;
+		ComPtr<ID3D12Resource> m_readback;
+		UINT m_resolvedCount[FrameScheduler::MaxFramesInFlight];	// Queries resolved into each slot's range
+		UINT64 m_timestampFrequency = 0;
+		UINT64 m_cpuFrequency = 0;
+
+		GpuClockCalibration Calibrate() const;
+
+	public:
+		void Initialize(ID3D12Device8* device, ID3D12CommandQueue* queue, Profiler* profiler, const char* trackName);
+		// The GPU has to be idle
+		void Shutdown();
+
+		// Call once the scheduler has retired frameIndex, pushes its timings into the profiler and starts it over
+		void BeginFrame(UINT frameIndex);
+
+		// On the declaring thread, before recording. InvalidZone while the profiler isn't capturing.
+		UINT AddZone(const char* name) { return m_profiler.AddZone(name); }
+		// From any recording thread, for zones of the current frame
+		void BeginZone(ID3D12GraphicsCommandList* commandList, UINT zone) const;
+		void EndZone(ID3D12GraphicsCommandList* commandList, UINT zone) const;
+		// In the frame's last command list, after every zone has ended
+		void ResolveFrame(ID3D12GraphicsCommandList* commandList);
+};
@@ -1,13 +1,51 @@
 #include "D3D12Implementation.h"
+#include "../Core/Hash.h"
+#include "../Core/Profiler.h"
+#include "../Core/BinaryLog.h"
+#include "MipChain.h"
+#include "BlockCompression.h"
+#include "TextureFile.h"
+#include "ProceduralTexture.h"
 
 
 constexpr D3D_FEATURE_LEVEL min_feature_level{ D3D_FEATURE_LEVEL_11_0 };
 
-D3D12Implementation::D3D12Implementation(HWND windowHandle, int windowWidth, int windowHeight) {
+// Only called by the shader cache on a miss
+static bool CompileShaderFromFile(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors)
+{
+	const int wideLength = MultiByteToWideChar(CP_UTF8, 0, request.path.c_str(), -1, nullptr, 0);
+	std::wstring widePath(wideLength, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, request.path.c_str(), -1, &widePath[0], wideLength);
+
+	ComPtr<ID3DBlob> shader;
+	ComPtr<ID3DBlob> compileErrors;
+	const HRESULT hr = D3DCompileFromFile(widePath.c_str(), nullptr, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+		request.entryPoint.c_str(), request.target.c_str(), request.flags, 0, &shader, &compileErrors);
+
+	if (compileErrors)
+	{
+		errors.assign(static_cast<const char*>(compileErrors->GetBufferPointer()), compileErrors->GetBufferSize());
+	}
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	const UINT8* data = static_cast<const UINT8*>(shader->GetBufferPointer());
+	bytecode.assign(data, data + shader->GetBufferSize());
+	return true;
+}
+
+D3D12Implementation::D3D12Implementation(HWND windowHandle, JobSystem* jobSystem, int windowWidth, int windowHeight, UINT framesInFlight) {
 	m_windowHandle = windowHandle;
+	m_jobSystem = jobSystem;
 	m_windowWidth = windowWidth;
 	m_windowHeight = windowHeight;
 	m_frameIndex = 0;
+	// Frame slots and swap chain buffers are the same count, and FLIP_DISCARD needs at least two buffers
+	assert(framesInFlight >= 2 && framesInFlight <= MaxFrameCount);
+	m_framesInFlight = framesInFlight;
+	m_frameScheduler = FrameScheduler(framesInFlight);
 
 	m_viewport = {};
 	m_viewport.TopLeftX = 0.0;
@@ -29,10 +67,15 @@ D3D12Implementation::D3D12Implementation(HWND windowHandle, int windowWidth, int
 
 	// Shut the warnings up
 	m_fenceEvent = nullptr;
-	m_fenceValue = 0;
 	m_vertexBufferView = {};
 	m_constantBufferData = {};
-	m_pCbvDataBegin = nullptr;
+	m_constantBufferAddress = 0;
+	m_instanceDataAddress = 0;
+	m_visibleInstancesAddress = 0;
+	m_visibleInstanceCount = 0;
+	m_instanceRadius = 0.0f;
+	m_textureSrvIndex = DescriptorIndexAllocator::InvalidIndex;
+	m_textureState = ResourceStateTracker::InvalidResource;
 	m_frameCounter = 0;
 
 	spdlog::info("D3D12Implementation Constructor Called");
@@ -150,54 +193,88 @@ bool D3D12Implementation::Initialize() {
 
 void D3D12Implementation::Update() 
 {
-	const float translationSpeed = 0.005f;
-	const float offsetBounds = 1.25f;
+	PROFILE_SCOPE("Update");
+
+	m_instances.Animate(InstanceBounds);
+	m_constantBufferData.instanceCount = m_instances.GetCount();
+
+	// No camera yet, the instances are already in clip space so the frustum is the identity's
+	const glm::mat4 viewProjection(1.0f);
+	m_instanceCuller.Cull(m_instances, MakeFrustum(&viewProjection[0][0]), m_instanceRadius, m_visibleInstances);
+
+	m_frameCounter++;
 
-	m_constantBufferData.nodes[0].offset.x += translationSpeed;
-	if (m_constantBufferData.nodes[0].offset.x > offsetBounds)
+	// MoveToNextFrame already waited for this frame's upload range to retire, so the GPU is done with it
+	LinearAllocation constantBufferAllocation;
+	if (m_uploadAllocator.AllocateConstants(m_constantBufferData, constantBufferAllocation))
 	{
-		m_constantBufferData.nodes[0].offset.x = -offsetBounds;
+		m_constantBufferAddress = constantBufferAllocation.gpuAddress;
 	}
-
-	m_constantBufferData.nodes[1].offset.y += translationSpeed;
-	if (m_constantBufferData.nodes[1].offset.y > offsetBounds)
+	else
 	{
-		m_constantBufferData.nodes[1].offset.y = -offsetBounds;
+		LOG_BINARY_ERROR("Frame upload buffer exhausted, reusing the previous constant buffer");
 	}
-	
-	if (m_frameCounter % 240 >= 120) 
+
+	// SoA straight into the ring, the vertex shader indexes the planes by SV_InstanceID
+	LinearAllocation instanceAllocation;
+	if (m_uploadAllocator.Allocate(m_instances.GetPackedSize(), FrameUploadAllocator::ConstantBufferAlignment, instanceAllocation))
 	{
-		m_constantBufferData.nodeIdx = 1;
+		m_instances.Pack(instanceAllocation.cpuAddress);
+		m_instanceDataAddress = instanceAllocation.gpuAddress;
 	}
-	else 
+	else
 	{
-		m_constantBufferData.nodeIdx = 0;
+		LOG_BINARY_ERROR("Frame upload buffer exhausted, reusing the previous instance data");
 	}
 
-	m_frameCounter++;
-
-	memcpy(m_pCbvDataBegin, &m_constantBufferData, sizeof(m_constantBufferData));
+	LinearAllocation visibleAllocation;
+	const UINT64 visibleSize = m_visibleInstances.size() * sizeof(uint32_t);
+	if (visibleSize == 0)
+	{
+		m_visibleInstanceCount = 0;
+	}
+	else if (m_uploadAllocator.Allocate(visibleSize, FrameUploadAllocator::ConstantBufferAlignment, visibleAllocation))
+	{
+		memcpy(visibleAllocation.cpuAddress, m_visibleInstances.data(), visibleSize);
+		m_visibleInstancesAddress = visibleAllocation.gpuAddress;
+		m_visibleInstanceCount = static_cast<UINT>(m_visibleInstances.size());
+	}
+	else
+	{
+		LOG_BINARY_ERROR("Frame upload buffer exhausted, reusing the previous visible list");
+	}
 }
 
 void D3D12Implementation::Render() {
+	PROFILE_SCOPE("Render");
 
-	// Record all commands we need to render into the command list
+	// Record all commands we need to render, spread over the recording threads
 	PopulateCommandList();
 
-	// Execute the command list.
-	ID3D12CommandList* ppCommanLists[] = { m_commandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(ppCommanLists), ppCommanLists);
+	// Execute the command lists, in order, in one go
+	m_commandRecorder.Submit();
 
 	// Present the frame
 	DXCall(m_swapChain->Present(1, 0));
 
-	WaitForPreviousFrame();
+	MoveToNextFrame();
 }
 
 void D3D12Implementation::Shutdown() {
 	
-	WaitForPreviousFrame();
-
+	WaitForGpu();
+
+	m_commandRecorder.Shutdown();
+	m_instanceCuller.Shutdown();
+	m_renderGraph.Shutdown();
+	m_gpuProfiler.Shutdown();
+	m_pipelineStateCache.Shutdown();
+	m_srvCbvHeap.Shutdown();
+	m_uploadService.Shutdown();
+	m_gpuHeap.Shutdown();
+	m_vertexBuffer = nullptr;
+	m_texture = nullptr;
+	m_uploadBuffer = nullptr;
 	release(m_dxgiFactory);
 
 #ifdef _DEBUG
@@ -225,51 +302,6 @@ void D3D12Implementation::Shutdown() {
 	CloseHandle(m_fenceEvent);
 }
 
-std::vector<UINT8> D3D12Implementation::GenerateCheckeredTextureData() {
-
-	// Memory / Bitcount of the texture
-	const UINT rowPitch = TextureWidth * TexturePixelSize;
-	const UINT textureSize = rowPitch * TextureHeight;
-
-	// Bitshift down by 3. e.g 256 >> 3 = 32;
-	const UINT cellPitch = rowPitch >> 3;
-	const UINT cellHeight = TextureWidth >> 3;
-
-	// Create a vector to hold the texture memory
-	std::vector<UINT8> data(textureSize);
-	UINT8* pData = &data[0];
-
-	for (UINT n = 0; n < textureSize; n += TexturePixelSize) {
-
-		// This generates cell coordinates of this pixel and then 
-		// Colors the cell correctly.
-		UINT x = n % rowPitch;
-		UINT y = n / rowPitch;
-		UINT i = x / cellPitch;
-		UINT j = y / cellHeight;
-
-
-		if (i%2 == j%2)
-		{
-			// Set a black pixel
-			pData[n	   ]	= 0x00;			//R
-			pData[n + 1]	= 0x00;			//G
-			pData[n + 2]	= 0x00;			//B
-			pData[n + 3]	= 0xff;			//A
-		}
-		else
-		{
-			// Set a white pixel
-			pData[n	   ]	= 0xff;			//R
-			pData[n + 1]	= 0xff;			//G
-			pData[n + 2]	= 0xff;			//B
-			pData[n + 3]	= 0xff;			//A
-		}
-	}
-
-	return data;
-}
-
 void D3D12Implementation::LoadPipeline() {
 
 	// Describe and create the command queue
@@ -279,9 +311,15 @@ void D3D12Implementation::LoadPipeline() {
 
 	DXCall(m_mainDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
 
+	// Placed resource heaps for everything LoadAssets creates
+	m_gpuHeap.Initialize(m_mainDevice);
+
+	// Static data goes up on its own copy queue, out of the staging ring
+	m_uploadService.Initialize(m_mainDevice, &m_gpuHeap);
+
 	// Describe and create the swap chain
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
-	swapChainDesc.BufferCount = BufferCount;
+	swapChainDesc.BufferCount = m_framesInFlight;
 	swapChainDesc.Width = m_windowWidth;
 	swapChainDesc.Height = m_windowHeight;
 	swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -302,21 +340,17 @@ void D3D12Implementation::LoadPipeline() {
 	// Create Descriptor Heaps
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {};
-		rtvHeapDesc.NumDescriptors = BufferCount;
+		rtvHeapDesc.NumDescriptors = m_framesInFlight;
 		rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
 		rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 		DXCall(m_mainDevice->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&m_rtvHeap)));
 
 		m_rtvDescriptorSize = m_mainDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
-		D3D12_DESCRIPTOR_HEAP_DESC srvCbvHeapDesc = {};
-		srvCbvHeapDesc.NumDescriptors = 2;
-		srvCbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-		srvCbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-		DXCall(m_mainDevice->CreateDescriptorHeap(&srvCbvHeapDesc, IID_PPV_ARGS(&m_srvCbvHeap)));
-
-		m_srvCbvDescriptorSize = m_mainDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-		
+		// Shader visible SRV/CBV heap, grows on its own once the persistent range fills up
+		m_srvCbvHeap.Initialize(m_mainDevice, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, PersistentDescriptorCount,
+			TransientDescriptorsPerFrame, m_framesInFlight);
+		m_srvCbvHeap.BeginFrame(m_frameScheduler.GetFrameIndex());
 	}
 
 	// Create Frame Resources 
@@ -324,17 +358,22 @@ void D3D12Implementation::LoadPipeline() {
 		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle{};
 		rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
 
-		// Create a RTV  and a Command Allocator for each frame
-		for (UINT32 i{ 0 }; i < BufferCount; i++)
+		// Create a RTV for each frame
+		for (UINT32 i{ 0 }; i < m_framesInFlight; i++)
 		{
 			DXCall(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i])));
 			m_mainDevice->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, rtvHandle);
 			rtvHandle.ptr += m_rtvDescriptorSize;
 
-			DXCall(m_mainDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators[i])));
+			m_renderTargetStates[i] = m_stateTracker.Register(m_renderTargets[i].Get(), 1, D3D12_RESOURCE_STATE_PRESENT);
 		}
 
-		DXCall(m_mainDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_BUNDLE, IID_PPV_ARGS(&m_bundleAllocator)));
+		// Per frame allocators live in the recorder's per thread pools, recycled by fence value
+		m_commandBackend.Initialize(m_mainDevice, m_commandQueue.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT);
+		m_commandRecorder.Initialize(&m_commandBackend, m_jobSystem);
+		m_renderGraph.Initialize(m_mainDevice, &m_stateTracker);
+		m_gpuProfiler.Initialize(m_mainDevice, m_commandQueue.Get(), &Profiler::Get(), "GPU Direct Queue");
+		m_gpuProfiler.BeginFrame(m_frameScheduler.GetFrameIndex());
 	}
 }
 
@@ -354,7 +393,7 @@ void D3D12Implementation::LoadAssets() {
 		// Assert if we cant use the right version, mainly because i dont want to code the alternative
 		assert(featureData.HighestVersion >= D3D_ROOT_SIGNATURE_VERSION_1_1);
 
-		D3D12_DESCRIPTOR_RANGE1 ranges[2];
+		D3D12_DESCRIPTOR_RANGE1 ranges[1];
 		// SRV setup
 		ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
 		ranges[0].NumDescriptors = 1;
@@ -362,25 +401,37 @@ void D3D12Implementation::LoadAssets() {
 		ranges[0].RegisterSpace = 0;
 		ranges[0].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
 		ranges[0].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-		// CBV setup
-		ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-		ranges[1].NumDescriptors = 1;
-		ranges[1].BaseShaderRegister = 0;
-		ranges[1].RegisterSpace = 0;
-		ranges[1].Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
-		ranges[1].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
-		D3D12_ROOT_PARAMETER1 rootParameters[1];
-		// SRV + CBV setup
+
+		D3D12_ROOT_PARAMETER1 rootParameters[4];
+		// SRV table setup
 		rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
 		rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
-		rootParameters[0].DescriptorTable.NumDescriptorRanges = 2;
+		rootParameters[0].DescriptorTable.NumDescriptorRanges = _countof(ranges);
 		rootParameters[0].DescriptorTable.pDescriptorRanges = &ranges[0];
+		// CBV setup, bound as a root descriptor so each frame can point at its own slice
+		rootParameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+		rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		rootParameters[1].Descriptor.ShaderRegister = 0;
+		rootParameters[1].Descriptor.RegisterSpace = 0;
+		rootParameters[1].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+		// Instance data, a root SRV straight at this frame's slice of the upload ring
+		rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+		rootParameters[2].Descriptor.ShaderRegister = 1;
+		rootParameters[2].Descriptor.RegisterSpace = 0;
+		rootParameters[2].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
+		// Indices of the instances that survived culling, same deal
+		rootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+		rootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+		rootParameters[3].Descriptor.ShaderRegister = 2;
+		rootParameters[3].Descriptor.RegisterSpace = 0;
+		rootParameters[3].Descriptor.Flags = D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE;
 
 		// Create the static sampler, that reads the texture data stored in the uploaded resources
 		// This sampler is visible to the pixel shader stage
 		D3D12_STATIC_SAMPLER_DESC samplerDesc = {};
-		samplerDesc.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+		// Crisp squares up close, mips blending in further away
+		samplerDesc.Filter = D3D12_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR;
 		samplerDesc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
 		samplerDesc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
 		samplerDesc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_BORDER;
@@ -412,15 +463,13 @@ void D3D12Implementation::LoadAssets() {
 		DXCall(D3D12SerializeVersionedRootSignature( &versionedRootSignatureDesc, &signature, &error));
 		DXCall(m_mainDevice->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
 			IID_PPV_ARGS(&m_rootSignature)));
+
+		// Part of every PSO key, the serialized blob is stable across runs where the pointer isn't
+		m_rootSignatureHash = HashBytes(signature->GetBufferPointer(), signature->GetBufferSize());
 	}
 
 	// Create the pipeline state
 	{
-		ComPtr<ID3DBlob> vertexShader;
-		ComPtr<ID3DBlob> vertexShaderCompileErrors;
-		ComPtr<ID3DBlob> pixelShader;
-		ComPtr<ID3DBlob> pixelShaderCompileErrors;
-
 #ifdef _DEBUG
 		UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #else
@@ -428,24 +477,45 @@ void D3D12Implementation::LoadAssets() {
 #endif //_Debug
 
 		// generate relative asset path
-		WCHAR assetsPath[512];
-		GetModuleFileName(nullptr, assetsPath, sizeof(assetsPath));
+		CHAR assetsPath[512];
+		GetModuleFileNameA(nullptr, assetsPath, sizeof(assetsPath));
 
-		WCHAR* lastSlash = wcsrchr(assetsPath, L'\\');
+		CHAR* lastSlash = strrchr(assetsPath, '\\');
 		if (lastSlash)
 		{
-			*(lastSlash + 1) = L'\0';
+			*(lastSlash + 1) = '\0';
 		}
 
+		m_assetsPath = assetsPath;
+
+		std::string shaderFile = "Shaders\\shaders_textured_offset.hlsl";
+		std::string shaderFilePath = assetsPath + shaderFile;
 
-		std::wstring shaderFile = L"Shaders\\shaders_textured_offset.hlsl";
-		std::wstring shaderFilePath = assetsPath + shaderFile;
+		// Bytecode is reused across runs, only a change to the source, its includes or the flags recompiles
+		m_shaderCache.Open(std::string(assetsPath) + "shader_cache.bin");
+		m_pipelineStateCache.Initialize(m_mainDevice, std::string(assetsPath) + "pipeline_library.bin", m_jobSystem);
 
+		ShaderCompileRequest vertexShaderRequest;
+		vertexShaderRequest.path = shaderFilePath;
+		vertexShaderRequest.entryPoint = "VSMain";
+		vertexShaderRequest.target = "vs_5_0";
+		vertexShaderRequest.flags = compileFlags;
 
-		DXCall(D3DCompileFromFile(shaderFilePath.c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags,
-			0, &vertexShader, &vertexShaderCompileErrors));
-		DXCall(D3DCompileFromFile(shaderFilePath.c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags,
-			0, &pixelShader, &pixelShaderCompileErrors));
+		ShaderCompileRequest pixelShaderRequest = vertexShaderRequest;
+		pixelShaderRequest.entryPoint = "PSMain";
+		pixelShaderRequest.target = "ps_5_0";
+
+		ShaderBytecode vertexShader;
+		ShaderBytecode pixelShader;
+		std::string compileErrors;
+		if (!m_shaderCache.GetShader(vertexShaderRequest, CompileShaderFromFile, vertexShader, compileErrors) ||
+			!m_shaderCache.GetShader(pixelShaderRequest, CompileShaderFromFile, pixelShader, compileErrors))
+		{
+			spdlog::critical("Shader compilation failed: " + compileErrors);
+			DXCall(E_FAIL);
+		}
+
+		spdlog::info("Shader cache: {} hits, {} misses", m_shaderCache.GetHits(), m_shaderCache.GetMisses());
 		
 		// Define the Vertex Input Layout
 		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
@@ -492,8 +562,8 @@ void D3D12Implementation::LoadAssets() {
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
 		psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
 		psoDesc.pRootSignature = m_rootSignature.Get();
-		psoDesc.VS = {reinterpret_cast<UINT8*>(vertexShader->GetBufferPointer()), vertexShader->GetBufferSize()};
-		psoDesc.PS = { reinterpret_cast<UINT8*>(pixelShader->GetBufferPointer()), pixelShader->GetBufferSize() };
+		psoDesc.VS = { vertexShader.data, vertexShader.size };
+		psoDesc.PS = { pixelShader.data, pixelShader.size };
 		psoDesc.RasterizerState = rasterizerDesc;
 		psoDesc.BlendState = blendDesc;
 		psoDesc.DepthStencilState.DepthEnable = FALSE;
@@ -503,12 +573,12 @@ void D3D12Implementation::LoadAssets() {
 		psoDesc.NumRenderTargets = 1;
 		psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
 		psoDesc.SampleDesc.Count = 1;
-		DXCall(m_mainDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
-	}
+		// Loaded from the pipeline library when this exact desc was built on a previous run
+		m_pipelineState = m_pipelineStateCache.GetGraphicsPipeline(psoDesc, m_rootSignatureHash);
 
-	// Create the command list;
-	DXCall(m_mainDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_commandAllocators[m_frameIndex].Get(),
-		m_pipelineState.Get(), IID_PPV_ARGS(&m_commandList)));
+		// Writes back anything new, the bytecode pointers are dead after this
+		m_shaderCache.Close();
+	}
 
 	// Create the vertex buffer
 	{
@@ -529,13 +599,6 @@ void D3D12Implementation::LoadAssets() {
 		const UINT vertexBufferSize = sizeof(triangleVerts);
 
 		// Create and upload the vertex information
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProps.CreationNodeMask = 1;
-		heapProps.VisibleNodeMask = 1;
-
 		D3D12_RESOURCE_DESC vertexBufferDesc = {};
 		vertexBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
 		vertexBufferDesc.Alignment = 0;
@@ -549,8 +612,7 @@ void D3D12Implementation::LoadAssets() {
 		vertexBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 		vertexBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
-		DXCall(m_mainDevice->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &vertexBufferDesc, 
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_vertexBuffer)));
+		m_vertexBuffer = m_gpuHeap.CreateResource(vertexBufferDesc, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
 
 		// Copy the triangle data into the vertex buffer
 		UINT8* pVertexDataBegin;
@@ -559,283 +621,388 @@ void D3D12Implementation::LoadAssets() {
 		readRange.Begin = 0;
 		readRange.End = 0;
 
-		DXCall( m_vertexBuffer->Map( 0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin) ) );
+		DXCall( m_vertexBuffer->resource->Map( 0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin) ) );
 		memcpy(pVertexDataBegin, triangleVerts, vertexBufferSize);
-		m_vertexBuffer->Unmap(0, nullptr);
+		m_vertexBuffer->resource->Unmap(0, nullptr);
 
 		// Init vertex buffer view
-		m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+		m_vertexBufferView.BufferLocation = m_vertexBuffer->resource->GetGPUVirtualAddress();
 		m_vertexBufferView.StrideInBytes = sizeof(Vertex);
 		m_vertexBufferView.SizeInBytes = vertexBufferSize;
-	}
-
-	// Create the constant buffer
-	{
-		const UINT constantBufferSize = std::max<UINT>(sizeof(SceneConstantBuffer),
-			D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);  // needs to be 256-byte aligned
-
-		
-		// Create and upload the cbv information
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProps.CreationNodeMask = 1;
-		heapProps.VisibleNodeMask = 1;
-
-		D3D12_RESOURCE_DESC constantBufferDesc = {};
-		constantBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		constantBufferDesc.Alignment = 0;
-		constantBufferDesc.Width = constantBufferSize;
-		constantBufferDesc.Height = 1;
-		constantBufferDesc.DepthOrArraySize = 1;
-		constantBufferDesc.MipLevels = 1;
-		constantBufferDesc.Format = DXGI_FORMAT_UNKNOWN;
-		constantBufferDesc.SampleDesc.Count = 1;
-		constantBufferDesc.SampleDesc.Quality = 0;
-		constantBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		constantBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-		DXCall(m_mainDevice->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &constantBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_constantBuffer)));
-
-		// Describe and create the view
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = m_constantBuffer->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = constantBufferSize;
-		// Get the SECOND descriptor inside of the descriptor heap
-		D3D12_CPU_DESCRIPTOR_HANDLE srvCbvHandle =  m_srvCbvHeap->GetCPUDescriptorHandleForHeapStart();
-		srvCbvHandle.ptr += m_srvCbvDescriptorSize;
-
-		m_mainDevice->CreateConstantBufferView(&cbvDesc, srvCbvHandle);
-
-		// map and initialise the constant buffer, we dont unmap till the app closes. keeping things mapped for the
-		// lifetime of the resource is AOK!
 
-		// We do not intend to read this resource on CPU
-		D3D12_RANGE readRange = {};
-		readRange.Begin = 0;
-		readRange.End = 0;
-		DXCall(m_constantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pCbvDataBegin)));
-		memcpy(m_pCbvDataBegin, &m_constantBufferData, sizeof(m_constantBufferData));
+		// Culling treats every instance as a sphere around the origin of the triangle
+		for (const Vertex& vertex : triangleVerts)
+		{
+			m_instanceRadius = glm::max(m_instanceRadius, glm::length(vertex.position));
+		}
 	}
 
-	// will keep this in scope till the GPU has finished upload instead of using the block scope
-	ComPtr<ID3D12Resource> textureUploadHeap;
-	// Create the "texture"
+	// Create the per frame upload buffer
 	{
-		// Create the default heap props
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.Type = D3D12_HEAP_TYPE_DEFAULT;
-		heapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		heapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		heapProps.CreationNodeMask = 1;
-		heapProps.VisibleNodeMask = 1;
-
-		// Describe and create Texture 2D
-		D3D12_RESOURCE_DESC textureDesc{};
-		textureDesc.MipLevels = 1;
-		textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-		textureDesc.Width = TextureWidth;
-		textureDesc.Height = TextureHeight;
-		textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		textureDesc.DepthOrArraySize = 1;
-		textureDesc.SampleDesc.Count = 1;
-		textureDesc.SampleDesc.Quality = 0;
-		textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-
-		DXCall(m_mainDevice->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &textureDesc, 
-			D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_texture)));
-
-		UINT64 uploadBufferSize = 0;
-
-		m_mainDevice->GetCopyableFootprints(&textureDesc, 0, 1, 0, nullptr, nullptr, nullptr, &uploadBufferSize);
-
-		// Creating the GPU upload buffer for the texture
-		// Create the Upload heap props
-		D3D12_HEAP_PROPERTIES uploadHeapProps = {};
-		uploadHeapProps.Type = D3D12_HEAP_TYPE_UPLOAD;
-		uploadHeapProps.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		uploadHeapProps.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		uploadHeapProps.CreationNodeMask = 1;
-		uploadHeapProps.VisibleNodeMask = 1;
-
-		D3D12_RESOURCE_DESC textureBufferDesc = {};
-		textureBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		textureBufferDesc.Alignment = 0;
-		textureBufferDesc.Width = uploadBufferSize;
-		textureBufferDesc.Height = 1,
-		textureBufferDesc.DepthOrArraySize = 1;
-		textureBufferDesc.MipLevels = 1;
-		textureBufferDesc.Format = DXGI_FORMAT_UNKNOWN;
-		textureBufferDesc.SampleDesc.Count = 1;
-		textureBufferDesc.SampleDesc.Quality = 0;
-		textureBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		textureBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
-
-		DXCall(m_mainDevice->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &textureBufferDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&textureUploadHeap)));
-
-		// Copy data to the intermediate upload heap, then schedule a copy from the upload heap to the
-		// Texture2D resource
-		std::vector<UINT8> textureData = GenerateCheckeredTextureData();
-
-		D3D12_SUBRESOURCE_DATA textureSubresourceData = {};
-		textureSubresourceData.pData = &textureData[0];
-		textureSubresourceData.RowPitch = TextureWidth * TexturePixelSize;
-		textureSubresourceData.SlicePitch = textureSubresourceData.RowPitch * TextureHeight;
-
-		// Update sub resources 
+		static_assert(FrameUploadAllocator::ConstantBufferAlignment == D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT,
+			"Upload allocator must hand out CBV aligned slices");
+
+		const UINT64 uploadBufferSize = UploadBufferSizePerFrame * m_framesInFlight;
+
+		D3D12_RESOURCE_DESC uploadBufferDesc = {};
+		uploadBufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+		uploadBufferDesc.Alignment = 0;
+		uploadBufferDesc.Width = uploadBufferSize;
+		uploadBufferDesc.Height = 1;
+		uploadBufferDesc.DepthOrArraySize = 1;
+		uploadBufferDesc.MipLevels = 1;
+		uploadBufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uploadBufferDesc.SampleDesc.Count = 1;
+		uploadBufferDesc.SampleDesc.Quality = 0;
+		uploadBufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+		uploadBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+		m_uploadBuffer = m_gpuHeap.CreateResource(uploadBufferDesc, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+		// map it for the lifetime of the resource, keeping things mapped is AOK!
 		// We do not intend to read this resource on CPU
 		D3D12_RANGE readRange = {};
 		readRange.Begin = 0;
 		readRange.End = 0;
 
-		UINT8* pTextureUploadData = nullptr;
+		UINT8* pUploadDataBegin = nullptr;
+		DXCall(m_uploadBuffer->resource->Map(0, &readRange, reinterpret_cast<void**>(&pUploadDataBegin)));
 
-		DXCall(textureUploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&pTextureUploadData)));
-		memcpy(pTextureUploadData, textureData.data(), textureData.size());
-		textureUploadHeap->Unmap(0, nullptr);
+		m_uploadAllocator.Initialize(pUploadDataBegin, m_uploadBuffer->resource->GetGPUVirtualAddress(), UploadBufferSizePerFrame, m_framesInFlight);
+		m_uploadAllocator.BeginFrame(m_frameScheduler.GetFrameIndex());
 
-		D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
-		srcLocation.pResource = textureUploadHeap.Get();
-		srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-		srcLocation.PlacedFootprint.Offset = 0;
-		srcLocation.PlacedFootprint.Footprint.Format = textureDesc.Format;
-		srcLocation.PlacedFootprint.Footprint.Width = textureDesc.Width;
-		srcLocation.PlacedFootprint.Footprint.Height = textureDesc.Height;
-		srcLocation.PlacedFootprint.Footprint.Depth = textureDesc.DepthOrArraySize;
-		srcLocation.PlacedFootprint.Footprint.RowPitch = TextureWidth * TexturePixelSize;
-
-		D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
-		dstLocation.pResource = m_texture.Get(); 
-		dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-		dstLocation.SubresourceIndex = 0;
+		// make sure the first frame has something valid bound
+		LinearAllocation constantBufferAllocation;
+		m_uploadAllocator.AllocateConstants(m_constantBufferData, constantBufferAllocation);
+		m_constantBufferAddress = constantBufferAllocation.gpuAddress;
+	}
 
-		m_commandList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+	// Scatter the instances, same seed every run so frames are comparable
+	{
+		m_instances.Reserve(InstanceCount);
 
-		D3D12_RESOURCE_BARRIER barrier = {};
-		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-		barrier.Transition.pResource = m_texture.Get();
-		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
-		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
-		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+		UINT32 seed = 0x9E3779B9;
+		const auto random = [&seed]() {
+			seed = seed * 1664525u + 1013904223u;
+			return static_cast<float>(seed >> 8) / static_cast<float>(1 << 24);
+		};
 
-		m_commandList->ResourceBarrier(1, &barrier);
+		for (UINT32 i{ 0 }; i < InstanceCount; i++)
+		{
+			const float x = (random() * 2.0f - 1.0f) * InstanceBounds;
+			const float y = (random() * 2.0f - 1.0f) * InstanceBounds;
+			const float scale = 0.02f + random() * 0.06f;
+			const float velocityX = random() * 0.005f;
+			const float velocityY = random() * 0.005f;
+			m_instances.Add(x, y, 0.0f, scale, velocityX, velocityY);
+		}
 
-		//describe the shader resource view
-		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-		srvDesc.Format = textureDesc.Format;
-		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MipLevels = 1;
-		m_mainDevice->CreateShaderResourceView(m_texture.Get(), &srvDesc, m_srvCbvHeap->GetCPUDescriptorHandleForHeapStart());
+		m_constantBufferData.instanceCount = m_instances.GetCount();
+		m_instanceCuller.Initialize(m_jobSystem);
 	}
 
-	// Close command list and execute to begine the initial gpu setup
-	DXCall(m_commandList->Close());
-	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
-
-	// Create and record the bundle list
+	// Create the "texture"
 	{
-		DXCall(m_mainDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_BUNDLE, m_bundleAllocator.Get(),
-			m_pipelineState.Get(), IID_PPV_ARGS(&m_bundleCommandList)));
+		// Textures\texture.dds next to the executable if there is one (a KTX2 loads the same way), the checker
+		// below if not. Only a plain 2D texture, the view is one.
+		const std::string textureFileName = "Textures\\texture.dds";
+		const std::string texturePath = m_assetsPath + textureFileName;
+		TextureFile textureFile;
+		if (textureFile.Open(texturePath) && textureFile.GetInfo().arraySize != 1)
+		{
+			spdlog::warn("{}: arrays and cube maps can't go on the triangles, using the checker", texturePath);
+			textureFile.Close();
+		}
+		else if (!textureFile.IsOpen())
+		{
+			spdlog::info("{}: {}, using the checker", texturePath, textureFile.GetError());
+		}
 
-		m_bundleCommandList->SetGraphicsRootSignature(m_rootSignature.Get());
-		m_bundleCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		m_bundleCommandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-		m_bundleCommandList->DrawInstanced(3, 1, 0, 0);
+		// The direct queue holds off on anything after this until the copy has landed, the CPU doesn't wait
+		UploadTicket textureTicket;
+		if (textureFile.IsOpen())
+		{
+			textureTicket = CreateFileTexture(textureFile);
+			if (textureTicket.fenceValue == 0)
+			{
+				spdlog::warn("{}: couldn't be uploaded, using the checker", texturePath);
+				ReleaseTexture();
+			}
+			else
+			{
+				m_textureName = textureFileName;
+			}
+		}
+		if (!m_texture)
+		{
+			textureTicket = CreateCheckerTexture();
+			m_textureName = "CheckeredTexture";
+		}
+		m_uploadService.QueueWait(m_commandQueue.Get(), textureTicket);
 
-		DXCall(m_bundleCommandList->Close());
+		//describe the shader resource view
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		m_textureSrvIndex = m_srvCbvHeap.AllocatePersistent();
+		if (m_texture)
+		{
+			srvDesc.Format = m_texture->desc.Format;
+			srvDesc.Texture2D.MipLevels = m_texture->desc.MipLevels;
+			m_mainDevice->CreateShaderResourceView(m_texture->resource.Get(), &srvDesc, m_srvCbvHeap.GetStagingHandle(m_textureSrvIndex));
+		}
+		else
+		{
+			// Out of video memory even for the checker. A null view samples as zero, the triangles go black.
+			spdlog::error("Couldn't create a texture, the triangles go untextured");
+			srvDesc.Format = DXGI_FORMAT_BC1_UNORM;
+			srvDesc.Texture2D.MipLevels = 1;
+			m_mainDevice->CreateShaderResourceView(nullptr, &srvDesc, m_srvCbvHeap.GetStagingHandle(m_textureSrvIndex));
+		}
+		m_srvCbvHeap.CommitPersistent(m_textureSrvIndex);
 	}
 
-	// Create synch objects and wait till assets have been uploaded
+	// Create synch objects
 	{
 		DXCall(m_mainDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
-		m_fenceValue = 1;
 
 		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 		if (m_fenceEvent == nullptr)
 		{
 			DXCall(HRESULT_FROM_WIN32(GetLastError()));
 		}
+	}
+
+}
 
-		// wait for the command list to execute. Wait for setup to complete before continuing.
-		WaitForPreviousFrame();
+D3D12_RESOURCE_DESC D3D12Implementation::CreateTexture(DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels) {
+	D3D12_RESOURCE_DESC textureDesc{};
+	textureDesc.MipLevels = static_cast<UINT16>(mipLevels);
+	textureDesc.Format = format;
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+	textureDesc.DepthOrArraySize = 1;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+	// COMMON so the copy queue can promote it, the graph moves it to shader resource the first time it's read
+	m_texture = m_gpuHeap.CreateResource(textureDesc, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
+	m_textureState = ResourceStateTracker::InvalidResource;
+	if (m_texture)
+	{
+		m_textureState = m_stateTracker.Register(m_texture->resource.Get(), textureDesc.MipLevels, D3D12_RESOURCE_STATE_COMMON);
+	}
+	return textureDesc;
+}
+
+void D3D12Implementation::ReleaseTexture() {
+	// A failed upload may have copied part of it already
+	m_uploadService.Wait(m_uploadService.Flush());
+	if (m_textureState != ResourceStateTracker::InvalidResource)
+	{
+		m_stateTracker.Unregister(m_textureState);
+		m_textureState = ResourceStateTracker::InvalidResource;
+	}
+	m_gpuHeap.Release(m_texture);
+	m_texture = nullptr;
+}
+
+UploadTicket D3D12Implementation::CreateFileTexture(const TextureFile& textureFile) {
+	const TextureFileInfo& info = textureFile.GetInfo();
+	const D3D12_RESOURCE_DESC textureDesc = CreateTexture(static_cast<DXGI_FORMAT>(info.format), info.width, info.height, info.mipLevels);
+	if (!m_texture)
+	{
+		return UploadTicket();
 	}
 
+	// Straight from the mapping into the staging ring, the file's packed rows spread out to the footprint's. For
+	// a BC format the copy's rows are block rows.
+	return m_uploadService.UploadTexture(m_texture->resource.Get(), 0, textureDesc.MipLevels,
+		[&textureFile](UINT subresource, const D3D12_SUBRESOURCE_FOOTPRINT& footprint, UINT firstRow, UINT rowCount, UINT64, UINT8* data) {
+			textureFile.CopySubresource(subresource, data, footprint.RowPitch, firstRow, rowCount);
+		});
+}
+
+UploadTicket D3D12Implementation::CreateCheckerTexture() {
+	// Every mip down to 1x1. BC1, an eighth of RGBA8. Black, white and the greys the mips blur them into all sit on
+	// one line, which is what BC1 does best.
+	const D3D12_RESOURCE_DESC textureDesc = CreateTexture(DXGI_FORMAT_BC1_UNORM, TextureWidth, TextureHeight,
+		GetMipLevelCount(TextureWidth, TextureHeight));
+	if (!m_texture)
+	{
+		return UploadTicket();
+	}
+
+	// Eight black and white squares across, then the mips under them. Building a level reads the one above back,
+	// which is slow from the write combined staging ring, so the chain is built in ordinary memory in the same
+	// footprint layout and each level goes over in one go.
+	std::vector<MipFootprint> mipFootprints(textureDesc.MipLevels);
+	std::vector<UINT8> mipChain(ComputeMipFootprints(MipFormat::RGBA8, TextureWidth, TextureHeight, textureDesc.MipLevels, mipFootprints.data()));
+
+	ProceduralTextureDesc checkerDesc;
+	checkerDesc.pattern = ProceduralPattern::Checker;
+	checkerDesc.cellShift = 5;		// 256 / 8
+	ProceduralTextureTarget checkerTarget;
+	checkerTarget.data = mipChain.data();
+	checkerTarget.rowPitch = mipFootprints[0].rowPitch;
+	checkerTarget.width = TextureWidth;
+	checkerTarget.height = TextureHeight;
+	GenerateProceduralTexture(checkerDesc, checkerTarget, m_jobSystem);
+
+	// The swap chain is UNORM, so the texels are already what ends up on screen (sRGB). Averaging them as they
+	// are would darken the grey the squares blur into.
+	MipChainDesc mipDesc;
+	mipDesc.format = MipFormat::RGBA8;
+	mipDesc.filter = MipFilter::Box;
+	mipDesc.srgb = true;
+	GenerateMipChain(mipDesc, mipChain.data(), mipFootprints.data(), textureDesc.MipLevels, m_jobSystem);
+
+	// Then the whole chain into blocks, laid out the same way with a row being a row of blocks
+	BlockEncodeDesc blockDesc;
+	blockDesc.format = BlockFormat::BC1;
+	blockDesc.quality = BlockQuality::Normal;
+	std::vector<MipFootprint> blockFootprints(textureDesc.MipLevels);
+	std::vector<UINT8> blockChain(ComputeBlockFootprints(blockDesc.format, TextureWidth, TextureHeight, textureDesc.MipLevels, blockFootprints.data()));
+	CompressTexture(blockDesc, mipChain.data(), mipFootprints.data(), blockChain.data(), blockFootprints.data(), textureDesc.MipLevels, m_jobSystem);
+
+	return m_uploadService.UploadTexture(m_texture->resource.Get(), 0, textureDesc.MipLevels,
+		[&blockChain, &blockFootprints](UINT subresource, const D3D12_SUBRESOURCE_FOOTPRINT& footprint, UINT firstRow, UINT rowCount,
+			UINT64 rowSize, UINT8* data) {
+			const MipFootprint& level = blockFootprints[subresource];
+			for (UINT row{ 0 }; row < rowCount; row++)
+			{
+				memcpy(data + static_cast<UINT64>(row) * footprint.RowPitch, blockChain.data() + level.offset + static_cast<UINT64>(firstRow + row) * level.rowPitch,
+					static_cast<size_t>(rowSize));
+			}
+		});
 }
 
 void D3D12Implementation::PopulateCommandList() {
+	PROFILE_SCOPE("PopulateCommandList");
 
-	// Reset command allocator for this frame
-	DXCall(m_commandAllocators[m_frameIndex]->Reset());
+	// Declare the frame, the graph works out the barriers on this thread before anything is recorded
+	m_renderGraph.Reset();
 
-	// Reset the command list
-	DXCall(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
+	const UINT backBuffer = m_renderGraph.ImportTexture("BackBuffer", m_renderTargetStates[m_frameIndex], D3D12_RESOURCE_STATE_PRESENT);
 
-	// Set state
-	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+	const UINT clearPass = m_renderGraph.AddPass("Clear", [this](ID3D12GraphicsCommandList* commandList) { RecordClearPass(commandList); });
+	m_renderGraph.Write(clearPass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-	ID3D12DescriptorHeap* ppHeaps[] = { m_srvCbvHeap.Get() };
-	m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-	m_commandList->SetGraphicsRootDescriptorTable(0, m_srvCbvHeap->GetGPUDescriptorHandleForHeapStart());
+	const UINT scenePass = m_renderGraph.AddPass("Scene", [this](ID3D12GraphicsCommandList* commandList) { RecordScenePass(commandList); });
+	// Nothing to transition behind the null view
+	if (m_texture)
+	{
+		const UINT texture = m_renderGraph.ImportTexture(m_textureName.c_str(), m_textureState);
+		m_renderGraph.Read(scenePass, texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	}
+	m_renderGraph.ReadWrite(scenePass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
-	m_commandList->RSSetViewports(1, &m_viewport);
-	m_commandList->RSSetScissorRects(1, &m_scissorRect);
+	m_renderGraph.Compile();
 
-	// set back buffer for render taget
-	D3D12_RESOURCE_BARRIER barrier = {};
-	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-	barrier.Transition.pResource = m_renderTargets[m_frameIndex].Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PRESENT;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_RENDER_TARGET;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	// Zones are handed out here so the recording threads only read them
+	const UINT passCount = m_renderGraph.GetCompiledPassCount();
+	m_passZones.resize(passCount);
+	for (UINT32 i{ 0 }; i < passCount; i++)
+	{
+		m_passZones[i] = m_gpuProfiler.AddZone(m_renderGraph.GetCompiledPassName(i));
+	}
 
-	m_commandList->ResourceBarrier(1, &barrier);
+	// Allocators are only recycled once the GPU is past the fence they were submitted under
+	m_commandRecorder.Record(passCount, m_fence->GetCompletedValue(),
+		[this, passCount](uint32_t listIndex, ComPtr<ID3D12GraphicsCommandList>& commandList) {
+			m_gpuProfiler.BeginZone(commandList.Get(), m_passZones[listIndex]);
+			m_renderGraph.RecordPass(listIndex, commandList.Get());
+			m_gpuProfiler.EndZone(commandList.Get(), m_passZones[listIndex]);
 
-	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle{};
-	rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
-	rtvHandle.ptr += (static_cast<SIZE_T>(m_frameIndex) * m_rtvDescriptorSize);
-	m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+			// Lists execute in order, the last one sees every other list's timestamps
+			if (listIndex == passCount - 1)
+			{
+				m_gpuProfiler.ResolveFrame(commandList.Get());
+			}
+		});
+}
 
-	// Record the commands // This has been moved to the bundle  to cache the creation
+void D3D12Implementation::RecordClearPass(ID3D12GraphicsCommandList* commandList) {
 	const float clearColor[] = { 0.0f, 0.2f, 0.4f, 1.0f };
-	m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+	commandList->ClearRenderTargetView(GetBackBufferRtv(), clearColor, 0, nullptr);
+}
 
-	m_commandList->ExecuteBundle(m_bundleCommandList.Get());
+void D3D12Implementation::RecordScenePass(ID3D12GraphicsCommandList* commandList) {
 
-	// Inidcate the backbuffer
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
+	// Nothing carries over between command lists, set all the state
+	commandList->SetPipelineState(m_pipelineState.Get());
+	commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 
-	m_commandList->ResourceBarrier(1, &barrier);
+	ID3D12DescriptorHeap* ppHeaps[] = { m_srvCbvHeap.GetShaderVisibleHeap() };
+	commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+	commandList->SetGraphicsRootDescriptorTable(0, m_srvCbvHeap.GetGpuHandle(m_textureSrvIndex));
+	commandList->SetGraphicsRootConstantBufferView(1, m_constantBufferAddress);
+	commandList->SetGraphicsRootShaderResourceView(2, m_instanceDataAddress);
+	commandList->SetGraphicsRootShaderResourceView(3, m_visibleInstancesAddress);
 
-	// Close recording
-	DXCall(m_commandList->Close());
-}
+	commandList->RSSetViewports(1, &m_viewport);
+	commandList->RSSetScissorRects(1, &m_scissorRect);
 
-void D3D12Implementation::WaitForPreviousFrame() {
+	const D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = GetBackBufferRtv();
+	commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
 
-	// signial and increment fence value;
-	const UINT64 localFenceValue = m_fenceValue;
-	DXCall(m_commandQueue->Signal(m_fence.Get(), localFenceValue));
-	m_fenceValue++;
+	// Every instance in one call, the instance count changes per frame so this can't live in a bundle
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+	if (m_visibleInstanceCount > 0)
+	{
+		commandList->DrawInstanced(3, m_visibleInstanceCount, 0, 0);
+	}
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE D3D12Implementation::GetBackBufferRtv() const {
+	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle{};
+	rtvHandle = m_rtvHeap->GetCPUDescriptorHandleForHeapStart();
+	rtvHandle.ptr += (static_cast<SIZE_T>(m_frameIndex) * m_rtvDescriptorSize);
+	return rtvHandle;
+}
 
+void D3D12Implementation::WaitForFenceValue(UINT64 fenceValue) {
+	PROFILE_SCOPE("WaitForFenceValue");
 
-	// wait until the previous frame is finished 
-	if (m_fence->GetCompletedValue() < localFenceValue)
+	// wait until the GPU has reached the value
+	if (m_fence->GetCompletedValue() < fenceValue)
 	{
-		DXCall(m_fence->SetEventOnCompletion(localFenceValue, m_fenceEvent));
+		DXCall(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
 		// No timeout
 		WaitForSingleObject(m_fenceEvent, INFINITE);
 	}
+}
+
+void D3D12Implementation::WaitForGpu() {
+
+	// signal and wait for everything submitted so far, only for setup and shutdown
+	const UINT64 fenceValue = m_frameScheduler.SignalFlush();
+	DXCall(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+	WaitForFenceValue(fenceValue);
 
-	
 	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+}
+
+void D3D12Implementation::MoveToNextFrame() {
+
+	// signal the fence for the frame we just submitted
+	const UINT64 fenceValue = m_frameScheduler.EndFrame();
+	DXCall(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+	m_commandRecorder.Retire(fenceValue);
 
-}
\ No newline at end of file
+	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+	// only block if the GPU is still working on the frame that last used this slot
+	WaitForFenceValue(m_frameScheduler.GetWaitValue());
+
+	// the slot is retired, its upload range and transient descriptors can be recycled in bulk
+	m_uploadAllocator.BeginFrame(m_frameScheduler.GetFrameIndex());
+	m_srvCbvHeap.BeginFrame(m_frameScheduler.GetFrameIndex());
+	m_gpuHeap.BeginFrame(m_frameScheduler.GetFrameIndex());
+	m_renderGraph.BeginFrame(m_frameScheduler.GetFrameIndex());
+	m_gpuProfiler.BeginFrame(m_frameScheduler.GetFrameIndex());
+	m_uploadService.Retire();
+}
@@ -1,80 +1,131 @@
 #pragma once
 #include "D3D12CommonHeaders.h"
+#include "FrameScheduler.h"
+#include "../Core/JobSystem.h"
+#include "LinearAllocator.h"
+#include "DescriptorHeapAllocator.h"
+#include "GpuHeapAllocator.h"
+#include "ShaderCache.h"
+#include "PipelineStateCache.h"
+#include "ParallelCommandRecorder.h"
+#include "D3D12CommandBackend.h"
+#include "D3D12StateTracker.h"
+#include "D3D12RenderGraph.h"
+#include "D3D12GpuProfiler.h"
+#include "UploadService.h"
+#include "InstanceSet.h"
+#include "InstanceCuller.h"
 
 class D3D12Implementation {
 	private:
 		static const UINT TextureWidth = 256;
 		static const UINT TextureHeight = 256;
-		static const UINT TexturePixelSize = 4;    // The number of bytes used to represent a pixel in the texture.
-		static const int32_t BufferCount = 2;
-
-		struct Node
-		{
-			glm::vec4 offset;
-		};
+		static const UINT MaxFrameCount = FrameScheduler::MaxFramesInFlight;
+		static const UINT64 UploadBufferSizePerFrame = 2 * 1024 * 1024;
+		static const UINT PersistentDescriptorCount = 1024;
+		static const UINT TransientDescriptorsPerFrame = 1024;
+		static const UINT InstanceCount = 32768;
+		static constexpr float InstanceBounds = 1.25f;		// Instances wrap around at +-this
 
 		struct SceneConstantBuffer
 		{
-			// This is here because the const buffer register will have this int take up the space of 4, so we need
-			// to pad the struct to eequal the sie of the shader cont buffer
-			int nodeIdx;
-			int padding[3];
-
-			Node nodes[2];
+			// The shader needs it to find where each plane of the instance data starts
+			UINT instanceCount;
+			UINT padding[3];
 		};
 		//static_assert((sizeof(SceneConstantBuffer) % 256) == 0, "Constant Buffer size must be 256-byte aligned");
 
 		int m_windowWidth;
 		int m_windowHeight;
 		int m_frameCounter;
+		UINT m_framesInFlight;	// Swap chain buffers and frames the CPU may record ahead of the GPU
 		float m_aspectRatio;
 		HWND m_windowHandle;
 
+		JobSystem* m_jobSystem;		// Owned by the application, command recording and culling fan out on it
 		ID3D12Device8* m_mainDevice = nullptr;
 		IDXGIFactory7* m_dxgiFactory = nullptr;
 		
 		// Pipeline objects
 		D3D12_VIEWPORT m_viewport;
 		D3D12_RECT m_scissorRect;
-		ComPtr<ID3D12CommandAllocator> m_commandAllocators[BufferCount];
-		ComPtr<ID3D12CommandAllocator> m_bundleAllocator;
 		ComPtr<ID3D12CommandQueue> m_commandQueue;
-		ComPtr<ID3D12GraphicsCommandList> m_commandList;
-		ComPtr<ID3D12GraphicsCommandList> m_bundleCommandList;
+		D3D12CommandBackend m_commandBackend;
+		ParallelCommandRecorder<D3D12CommandBackend> m_commandRecorder;
 		ComPtr<ID3D12RootSignature> m_rootSignature;
 		ComPtr<IDXGISwapChain3> m_swapChain;
 		ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
-		ComPtr<ID3D12DescriptorHeap> m_srvCbvHeap;
+		DescriptorHeapAllocator m_srvCbvHeap;
 		ComPtr<ID3D12PipelineState> m_pipelineState;
-		ComPtr<ID3D12Resource> m_renderTargets[BufferCount];
+		ShaderCache m_shaderCache;
+		PipelineStateCache m_pipelineStateCache;
+		uint64_t m_rootSignatureHash = 0;
+		std::string m_assetsPath;		// Next to the executable, shaders, caches and textures are found from here
+		ComPtr<ID3D12Resource> m_renderTargets[MaxFrameCount];
+		UINT m_renderTargetStates[MaxFrameCount];
+
+		// Every barrier goes through here
+		D3D12StateTracker m_stateTracker;
+		// The frame is built as a graph every frame, each surviving pass is one command list recorded in parallel
+		D3D12RenderGraph m_renderGraph;
+		// Timestamps around every pass, on the profiler's timeline while it captures
+		D3D12GpuProfiler m_gpuProfiler;
+		std::vector<UINT> m_passZones;		// Per compiled pass
 
-		int m_srvCbvDescriptorSize = -1;
 		int m_rtvDescriptorSize = -1;
 
-		// App resources.
-		ComPtr<ID3D12Resource> m_vertexBuffer;
-		ComPtr<ID3D12Resource> m_texture;
+		// App resources. Placed into big heap blocks rather than one committed resource each
+		GpuHeapAllocator m_gpuHeap;
+		UploadService m_uploadService;
+		GpuAllocation* m_vertexBuffer = nullptr;
+		GpuAllocation* m_texture = nullptr;
+		std::string m_textureName;		// The render graph's name for it, the file it came from or the checker
+		UINT m_textureSrvIndex;
+		UINT m_textureState;
 		D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
 
-		ComPtr<ID3D12Resource> m_constantBuffer;
+		// Persistently mapped upload buffer, split into one linear range per frame in flight so we never write over
+		// data the GPU is still reading. Constant buffers are sub allocated from it every frame.
+		GpuAllocation* m_uploadBuffer = nullptr;
+		FrameUploadAllocator m_uploadAllocator;
 		SceneConstantBuffer m_constantBufferData;
-		UINT8* m_pCbvDataBegin;
+		D3D12_GPU_VIRTUAL_ADDRESS m_constantBufferAddress;
+
+		// Every triangle on screen, packed into the upload ring each frame and drawn in one instanced call
+		InstanceSet m_instances;
+		D3D12_GPU_VIRTUAL_ADDRESS m_instanceDataAddress;
+		// Only what survives the frustum is drawn, the shader maps SV_InstanceID through this list
+		InstanceCuller m_instanceCuller;
+		std::vector<uint32_t> m_visibleInstances;
+		D3D12_GPU_VIRTUAL_ADDRESS m_visibleInstancesAddress;
+		UINT m_visibleInstanceCount;
+		float m_instanceRadius;		// The triangle's bounding radius at scale 1
 
 		// Synch objects
-		UINT m_frameIndex;
+		UINT m_frameIndex;		// Back buffer index
 		HANDLE m_fenceEvent;
 		ComPtr<ID3D12Fence> m_fence;
-		UINT64 m_fenceValue;
+		FrameScheduler m_frameScheduler;
 		
 
 		void LoadPipeline();
 		void LoadAssets();
-		std::vector<UINT8> GenerateCheckeredTextureData();
+		// Creates m_texture (null if that failed) and registers it with the state tracker
+		D3D12_RESOURCE_DESC CreateTexture(DXGI_FORMAT format, UINT width, UINT height, UINT mipLevels);
+		void ReleaseTexture();
+		// Zero ticket if the texture couldn't be created or uploaded
+		UploadTicket CreateFileTexture(const TextureFile& textureFile);
+		UploadTicket CreateCheckerTexture();
 		void PopulateCommandList();
-		void WaitForPreviousFrame();
+		void RecordClearPass(ID3D12GraphicsCommandList* commandList);
+		void RecordScenePass(ID3D12GraphicsCommandList* commandList);
+		D3D12_CPU_DESCRIPTOR_HANDLE GetBackBufferRtv() const;
+		void WaitForFenceValue(UINT64 fenceValue);
+		void WaitForGpu();
+		void MoveToNextFrame();
 
 	public:
-		D3D12Implementation(HWND windowHandle, int windowWidth, int windowHeight);
+		D3D12Implementation(HWND windowHandle, JobSystem* jobSystem, int windowWidth, int windowHeight, UINT framesInFlight = 2);
 		~D3D12Implementation();
 		bool Initialize();
 		void Shutdown();
@@ -0,0 +1,265 @@
+#include "D3D12RenderGraph.h"
+#include "../Core/BitUtils.h"
+#include <cassert>
+#include <cstring>
+
+void D3D12RenderGraph::Initialize(ID3D12Device8* device, D3D12StateTracker* stateTracker) {
+	m_device = device;
+	m_stateTracker = stateTracker;
+	m_frameIndex = 0;
+	m_frameCount = 0;
+}
+
+void D3D12RenderGraph::Shutdown() {
+	for (PlacedTexture& placed : m_placedTextures)
+	{
+		m_stateTracker->Unregister(placed.trackerHandle);
+	}
+	m_placedTextures.clear();
+
+	for (RetiredMemory& retired : m_retired)
+	{
+		retired.heap.Reset();
+		retired.resources.clear();
+	}
+
+	m_heap.Reset();
+	m_heapSize = 0;
+	Reset();
+}
+
+void D3D12RenderGraph::BeginFrame(UINT frameIndex) {
+	m_frameIndex = frameIndex;
+	m_frameCount++;
+
+	m_retired[frameIndex].heap.Reset();
+	m_retired[frameIndex].resources.clear();
+}
+
+void D3D12RenderGraph::Reset() {
+	m_graph.Reset();
+	m_executes.clear();
+	m_transients.clear();
+	m_trackerHandles.clear();
+	m_resources.clear();
+}
+
+UINT D3D12RenderGraph::ImportTexture(const char* name, UINT trackerHandle) {
+	const UINT resource = m_graph.ImportResource(name);
+	m_transients.emplace_back();
+	m_trackerHandles.push_back(trackerHandle);
+	m_resources.push_back(m_stateTracker->GetResource(trackerHandle));
+	return resource;
+}
+
+UINT D3D12RenderGraph::ImportTexture(const char* name, UINT trackerHandle, D3D12_RESOURCE_STATES finalState) {
+	const UINT resource = m_graph.ImportResource(name, static_cast<uint32_t>(finalState));
+	m_transients.emplace_back();
+	m_trackerHandles.push_back(trackerHandle);
+	m_resources.push_back(m_stateTracker->GetResource(trackerHandle));
+	return resource;
+}
+
+UINT D3D12RenderGraph::CreateTexture(const char* name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue) {
+	assert(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+
+	const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_device->GetResourceAllocationInfo(0, 1, &desc);
+
+	RenderGraphResourceDesc graphDesc;
+	graphDesc.size = allocationInfo.SizeInBytes;
+	graphDesc.alignment = allocationInfo.Alignment;
+	const UINT resource = m_graph.CreateTransient(name, graphDesc);
+
+	TransientTexture texture = {};
+	texture.desc = desc;
+	texture.hasClearValue = clearValue != nullptr;
+	if (clearValue)
+	{
+		texture.clearValue = *clearValue;
+	}
+	m_transients.push_back(texture);
+	m_trackerHandles.push_back(ResourceStateTracker::InvalidResource);
+	m_resources.push_back(nullptr);
+	return resource;
+}
+
+UINT D3D12RenderGraph::AddPass(const char* name, const ExecuteFunction& execute) {
+	const UINT pass = m_graph.AddPass(name);
+	m_executes.push_back(execute);
+	return pass;
+}
+
+bool D3D12RenderGraph::IsSameTexture(const TransientTexture& a, const TransientTexture& b) {
+	// Field by field, the desc has padding after Dimension
+	const D3D12_RESOURCE_DESC& first = a.desc;
+	const D3D12_RESOURCE_DESC& second = b.desc;
+	if (first.Dimension != second.Dimension || first.Alignment != second.Alignment || first.Width != second.Width ||
+		first.Height != second.Height || first.DepthOrArraySize != second.DepthOrArraySize || first.MipLevels != second.MipLevels ||
+		first.Format != second.Format || first.SampleDesc.Count != second.SampleDesc.Count ||
+		first.SampleDesc.Quality != second.SampleDesc.Quality || first.Layout != second.Layout || first.Flags != second.Flags)
+	{
+		return false;
+	}
+
+	if (a.hasClearValue != b.hasClearValue)
+	{
+		return false;
+	}
+
+	return !a.hasClearValue || (a.clearValue.Format == b.clearValue.Format &&
+		memcmp(a.clearValue.Color, b.clearValue.Color, sizeof(a.clearValue.Color)) == 0);
+}
+
+void D3D12RenderGraph::RetirePlacedTexture(PlacedTexture& placed) {
+	m_stateTracker->Unregister(placed.trackerHandle);
+	m_retired[m_frameIndex].resources.push_back(placed.resource);
+	placed.resource.Reset();
+}
+
+void D3D12RenderGraph::RealizeTransients() {
+
+	// Grow by replacing the heap, every texture placed in the old one goes with it
+	const UINT64 requiredSize = m_graph.GetTransientHeapSize();
+	if (requiredSize > m_heapSize)
+	{
+		for (PlacedTexture& placed : m_placedTextures)
+		{
+			RetirePlacedTexture(placed);
+		}
+		m_placedTextures.clear();
+		m_retired[m_frameIndex].heap = m_heap;
+
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes = AlignUp(requiredSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+		heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+
+		m_heap.Reset();
+		DXCall(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_heap)));
+		NAME_D3D12_OBJECT(m_heap, L"RenderGraphTransientHeap");
+		m_heapSize = heapDesc.SizeInBytes;
+	}
+
+	for (UINT resource{ 0 }; resource < m_graph.GetResourceCount(); resource++)
+	{
+		if (m_graph.IsImported(resource) || !m_graph.IsTransientUsed(resource))
+		{
+			continue;
+		}
+
+		const TransientTexture& texture = m_transients[resource];
+		const UINT64 offset = m_graph.GetTransientOffset(resource);
+
+		// Same texture at the same offset as a previous frame, reuse the resource and its tracked state
+		PlacedTexture* match = nullptr;
+		for (PlacedTexture& placed : m_placedTextures)
+		{
+			if (placed.offset == offset && placed.lastUsedFrame != m_frameCount && IsSameTexture(placed.texture, texture))
+			{
+				match = &placed;
+				break;
+			}
+		}
+
+		if (!match)
+		{
+			const D3D12_RESOURCE_STATES initialState = static_cast<D3D12_RESOURCE_STATES>(m_graph.GetFirstState(resource));
+
+			PlacedTexture placed;
+			placed.texture = texture;
+			placed.offset = offset;
+			DXCall(m_device->CreatePlacedResource(m_heap.Get(), offset, &texture.desc, initialState,
+				texture.hasClearValue ? &texture.clearValue : nullptr, IID_PPV_ARGS(&placed.resource)));
+			placed.trackerHandle = m_stateTracker->Register(placed.resource.Get(),
+				texture.desc.MipLevels * texture.desc.DepthOrArraySize, initialState);
+
+			m_placedTextures.push_back(placed);
+			match = &m_placedTextures.back();
+		}
+
+		match->lastUsedFrame = m_frameCount;
+		m_trackerHandles[resource] = match->trackerHandle;
+		m_resources[resource] = match->resource.Get();
+	}
+
+	// Drop textures nothing has asked for in a while, by then no frame in flight can still use them
+	for (size_t i{ 0 }; i < m_placedTextures.size();)
+	{
+		if (m_frameCount - m_placedTextures[i].lastUsedFrame > FrameScheduler::MaxFramesInFlight * 2)
+		{
+			RetirePlacedTexture(m_placedTextures[i]);
+			m_placedTextures[i] = m_placedTextures.back();
+			m_placedTextures.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void D3D12RenderGraph::BuildBarriers() {
+	const UINT compiledCount = GetCompiledPassCount();
+	m_passBarriers.resize(compiledCount);
+	m_passDiscards.resize(compiledCount);
+
+	for (UINT compiledIndex{ 0 }; compiledIndex < compiledCount; compiledIndex++)
+	{
+		std::vector<D3D12_RESOURCE_BARRIER>& barriers = m_passBarriers[compiledIndex];
+		std::vector<ID3D12Resource*>& discards = m_passDiscards[compiledIndex];
+		barriers.clear();
+		discards.clear();
+
+		for (const RenderGraphAliasing& aliasing : m_graph.GetPassAliasing(compiledIndex))
+		{
+			D3D12_RESOURCE_BARRIER barrier = {};
+			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+			barrier.Aliasing.pResourceBefore = aliasing.before == RenderGraph::InvalidIndex ? nullptr : m_resources[aliasing.before];
+			barrier.Aliasing.pResourceAfter = m_resources[aliasing.after];
+			barriers.push_back(barrier);
+
+			// Discard only works on a render target or depth stencil in that state, which the transitions below
+			// leave it in
+			const D3D12_RESOURCE_STATES firstState = static_cast<D3D12_RESOURCE_STATES>(m_graph.GetFirstState(aliasing.after));
+			assert(firstState == D3D12_RESOURCE_STATE_RENDER_TARGET || firstState == D3D12_RESOURCE_STATE_DEPTH_WRITE);
+			if (firstState == D3D12_RESOURCE_STATE_RENDER_TARGET || firstState == D3D12_RESOURCE_STATE_DEPTH_WRITE)
+			{
+				discards.push_back(m_resources[aliasing.after]);
+			}
+		}
+
+		m_stateTracker->ConvertTransitions(m_graph.GetPassTransitions(compiledIndex), barriers);
+	}
+
+	m_finalBarriers.clear();
+	m_stateTracker->ConvertTransitions(m_graph.GetFinalTransitions(), m_finalBarriers);
+}
+
+void D3D12RenderGraph::Compile() {
+	m_graph.Compile();
+	RealizeTransients();
+	m_graph.PlanBarriers(m_stateTracker->GetTracker(), m_trackerHandles);
+	BuildBarriers();
+}
+
+void D3D12RenderGraph::RecordPass(UINT compiledIndex, ID3D12GraphicsCommandList* commandList) const {
+	const std::vector<D3D12_RESOURCE_BARRIER>& barriers = m_passBarriers[compiledIndex];
+	if (!barriers.empty())
+	{
+		commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+	}
+
+	// Whatever the memory held before is garbage to these, this is the initialization aliasing asks for
+	for (ID3D12Resource* resource : m_passDiscards[compiledIndex])
+	{
+		commandList->DiscardResource(resource, nullptr);
+	}
+
+	m_executes[m_graph.GetCompiledPasses()[compiledIndex]](commandList);
+
+	if (compiledIndex + 1 == GetCompiledPassCount() && !m_finalBarriers.empty())
+	{
+		commandList->ResourceBarrier(static_cast<UINT>(m_finalBarriers.size()), m_finalBarriers.data());
+	}
+}
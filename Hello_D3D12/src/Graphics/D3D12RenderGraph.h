@@ -0,0 +1,106 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+#include "D3D12StateTracker.h"
+#include "FrameScheduler.h"
+#include "RenderGraph.h"
+#include <functional>
+#include <vector>
+
+// RenderGraph on top of D3D12. Passes carry the function that records them, transient textures are placed
+// into one ID3D12Heap at the offsets the graph picked and cached across frames, barriers (aliasing first, then
+// transitions) go in front of each pass. Every compiled pass is meant to be its own command list, RecordPass
+// only reads so the passes can be recorded in parallel once Compile has run.
+// Transients have to be render target or depth stencil textures, the heap is RT/DS only so it works on tier 1.
+// Memory handed from one transient to another holds garbage, so every transient is discarded right after its
+// aliasing barrier, before its first pass runs. That needs the first pass to use it as a render target or depth
+// write, and that pass can't expect anything in it: clear it or write every texel.
+class D3D12RenderGraph {
+	public:
+		typedef std::function<void(ID3D12GraphicsCommandList* commandList)> ExecuteFunction;
+
+	private:
+		struct TransientTexture
+		{
+			D3D12_RESOURCE_DESC desc;
+			D3D12_CLEAR_VALUE clearValue;
+			bool hasClearValue;
+		};
+
+		struct PlacedTexture
+		{
+			ComPtr<ID3D12Resource> resource;
+			TransientTexture texture;
+			UINT64 offset;
+			UINT trackerHandle;
+			UINT64 lastUsedFrame;
+		};
+
+		// Heap and resources replaced while the GPU may still use them
+		struct RetiredMemory
+		{
+			ComPtr<ID3D12Heap> heap;
+			std::vector<ComPtr<ID3D12Resource>> resources;
+		};
+
+		ID3D12Device8* m_device = nullptr;
+		D3D12StateTracker* m_stateTracker = nullptr;
+		UINT m_frameIndex = 0;
+		UINT64 m_frameCount = 0;
+
+		RenderGraph m_graph;
+		std::vector<ExecuteFunction> m_executes;			// Per pass
+		std::vector<TransientTexture> m_transients;			// Per resource, only filled for transients
+		std::vector<uint32_t> m_trackerHandles;				// Per resource
+		std::vector<ID3D12Resource*> m_resources;			// Per resource, valid after Compile
+
+		// Per compiled pass
+		std::vector<std::vector<D3D12_RESOURCE_BARRIER>> m_passBarriers;
+		std::vector<std::vector<ID3D12Resource*>> m_passDiscards;		// Transients first used in the pass
+		std::vector<D3D12_RESOURCE_BARRIER> m_finalBarriers;
+
+		ComPtr<ID3D12Heap> m_heap;
+		UINT64 m_heapSize = 0;
+		std::vector<PlacedTexture> m_placedTextures;
+		RetiredMemory m_retired[FrameScheduler::MaxFramesInFlight];
+
+		static bool IsSameTexture(const TransientTexture& a, const TransientTexture& b);
+		void RetirePlacedTexture(PlacedTexture& placed);
+		void RealizeTransients();
+		void BuildBarriers();
+
+	public:
+		void Initialize(ID3D12Device8* device, D3D12StateTracker* stateTracker);
+		// The GPU has to be idle
+		void Shutdown();
+
+		// Call once the scheduler has retired frameIndex
+		void BeginFrame(UINT frameIndex);
+
+		// Start a new graph, everything from the last one is dropped
+		void Reset();
+
+		// trackerHandle is the resource's handle in the state tracker the graph was initialized with
+		UINT ImportTexture(const char* name, UINT trackerHandle);
+		UINT ImportTexture(const char* name, UINT trackerHandle, D3D12_RESOURCE_STATES finalState);
+		// Its first pass has to write it as a render target or depth stencil, it starts out discarded
+		UINT CreateTexture(const char* name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+		UINT AddPass(const char* name, const ExecuteFunction& execute);
+		void Read(UINT pass, UINT resource, D3D12_RESOURCE_STATES state) { m_graph.Read(pass, resource, state); }
+		void Write(UINT pass, UINT resource, D3D12_RESOURCE_STATES state) { m_graph.Write(pass, resource, state); }
+		void ReadWrite(UINT pass, UINT resource, D3D12_RESOURCE_STATES state) { m_graph.ReadWrite(pass, resource, state); }
+		void SetSideEffects(UINT pass) { m_graph.SetSideEffects(pass); }
+
+		// Culls, places the transients and works out every barrier. Anything still queued in the state tracker
+		// gets folded into the first pass.
+		void Compile();
+
+		UINT GetCompiledPassCount() const { return static_cast<UINT>(m_graph.GetCompiledPasses().size()); }
+		const char* GetCompiledPassName(UINT compiledIndex) const { return m_graph.GetPassName(m_graph.GetCompiledPasses()[compiledIndex]); }
+		// Barriers, discards, then the pass, plus the final transitions after the last one
+		void RecordPass(UINT compiledIndex, ID3D12GraphicsCommandList* commandList) const;
+
+		// For the execute functions, null for culled transients
+		ID3D12Resource* GetResource(UINT resource) const { return m_resources[resource]; }
+		const RenderGraphStats& GetStats() const { return m_graph.GetStats(); }
+};
@@ -0,0 +1,77 @@
+#include "D3D12StateTracker.h"
+
+static_assert(ResourceStateTracker::AllSubresources == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+	"Tracker and D3D12 have to agree on what all subresources means");
+
+// GENERIC_READ is every buffer / shader / copy read state, all of these can be combined without a barrier
+D3D12StateTracker::D3D12StateTracker()
+	: m_tracker(D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_RESOLVE_SOURCE) {
+}
+
+UINT D3D12StateTracker::Register(ID3D12Resource* resource, UINT subresourceCount, D3D12_RESOURCE_STATES initialState) {
+	const UINT handle = m_tracker.RegisterResource(subresourceCount, static_cast<uint32_t>(initialState));
+	if (handle >= m_resources.size())
+	{
+		m_resources.resize(handle + 1, nullptr);
+	}
+
+	m_resources[handle] = resource;
+	return handle;
+}
+
+void D3D12StateTracker::Unregister(UINT handle) {
+	m_tracker.UnregisterResource(handle);
+	m_resources[handle] = nullptr;
+}
+
+void D3D12StateTracker::RequireState(UINT handle, D3D12_RESOURCE_STATES state, UINT subresource) {
+	m_tracker.RequireState(handle, subresource, static_cast<uint32_t>(state));
+}
+
+void D3D12StateTracker::BeginTransition(UINT handle, D3D12_RESOURCE_STATES state, UINT subresource) {
+	m_tracker.BeginTransition(handle, subresource, static_cast<uint32_t>(state));
+}
+
+void D3D12StateTracker::FlushBarriers(std::vector<D3D12_RESOURCE_BARRIER>& barriers) {
+	m_transitions.clear();
+	m_tracker.Flush(m_transitions);
+	ConvertTransitions(m_transitions, barriers);
+}
+
+void D3D12StateTracker::ConvertTransitions(const std::vector<ResourceTransition>& transitions,
+	std::vector<D3D12_RESOURCE_BARRIER>& barriers) const {
+
+	for (const ResourceTransition& transition : transitions)
+	{
+		D3D12_RESOURCE_BARRIER barrier = {};
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		if (transition.type == ResourceTransitionType::BeginOnly)
+		{
+			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY;
+		}
+		else if (transition.type == ResourceTransitionType::EndOnly)
+		{
+			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+		}
+		barrier.Transition.pResource = m_resources[transition.resource];
+		barrier.Transition.Subresource = transition.subresource;
+		barrier.Transition.StateBefore = static_cast<D3D12_RESOURCE_STATES>(transition.stateBefore);
+		barrier.Transition.StateAfter = static_cast<D3D12_RESOURCE_STATES>(transition.stateAfter);
+		barriers.push_back(barrier);
+	}
+}
+
+void D3D12StateTracker::FlushBarriers(ID3D12GraphicsCommandList* commandList) {
+	m_barriers.clear();
+	FlushBarriers(m_barriers);
+
+	if (!m_barriers.empty())
+	{
+		commandList->ResourceBarrier(static_cast<UINT>(m_barriers.size()), m_barriers.data());
+	}
+}
+
+D3D12_RESOURCE_STATES D3D12StateTracker::GetState(UINT handle, UINT subresource) const {
+	return static_cast<D3D12_RESOURCE_STATES>(m_tracker.GetState(handle, subresource));
+}
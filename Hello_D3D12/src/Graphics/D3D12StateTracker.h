@@ -0,0 +1,36 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+#include "ResourceStateTracker.h"
+#include <vector>
+
+// ResourceStateTracker for real D3D12 resources, flushes queued transitions as one ResourceBarrier call
+class D3D12StateTracker {
+	private:
+		ResourceStateTracker m_tracker;
+		std::vector<ID3D12Resource*> m_resources;
+		std::vector<ResourceTransition> m_transitions;
+		std::vector<D3D12_RESOURCE_BARRIER> m_barriers;
+
+	public:
+		D3D12StateTracker();
+
+		// Not ref counted, unregister before the resource goes away
+		UINT Register(ID3D12Resource* resource, UINT subresourceCount, D3D12_RESOURCE_STATES initialState);
+		void Unregister(UINT handle);
+
+		void RequireState(UINT handle, D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+		void BeginTransition(UINT handle, D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+		// Appends the queued barriers, for lists recorded later on another thread
+		void FlushBarriers(std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+		// Records the queued barriers straight into the command list
+		void FlushBarriers(ID3D12GraphicsCommandList* commandList);
+		// For transitions computed elsewhere against the same tracker (the render graph)
+		void ConvertTransitions(const std::vector<ResourceTransition>& transitions, std::vector<D3D12_RESOURCE_BARRIER>& barriers) const;
+
+		ResourceStateTracker& GetTracker() { return m_tracker; }
+		ID3D12Resource* GetResource(UINT handle) const { return m_resources[handle]; }
+
+		D3D12_RESOURCE_STATES GetState(UINT handle, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) const;
+		const ResourceStateTrackerStats& GetStats() const { return m_tracker.GetStats(); }
+};
@@ -0,0 +1,108 @@
+#include "DescriptorHeapAllocator.h"
+
+void DescriptorHeapAllocator::Initialize(ID3D12Device8* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT persistentCapacity,
+	UINT transientCapacityPerFrame, UINT framesInFlight) {
+
+	m_device = device;
+	m_type = type;
+	m_framesInFlight = framesInFlight;
+	m_descriptorSize = m_device->GetDescriptorHandleIncrementSize(type);
+
+	m_indices.Initialize(persistentCapacity, transientCapacityPerFrame, framesInFlight);
+	CreateHeaps(m_stagingHeap, m_shaderVisibleHeap, persistentCapacity);
+}
+
+void DescriptorHeapAllocator::Shutdown() {
+	for (UINT i{ 0 }; i < FrameScheduler::MaxFramesInFlight; i++)
+	{
+		m_retiredHeaps[i].Reset();
+	}
+	m_shaderVisibleHeap.Reset();
+	m_stagingHeap.Reset();
+	m_device = nullptr;
+}
+
+void DescriptorHeapAllocator::CreateHeaps(ComPtr<ID3D12DescriptorHeap>& stagingHeap, ComPtr<ID3D12DescriptorHeap>& shaderVisibleHeap,
+	UINT persistentCapacity) {
+
+	// The staging heap only mirrors the persistent range, transient views never live there
+	D3D12_DESCRIPTOR_HEAP_DESC stagingHeapDesc = {};
+	stagingHeapDesc.NumDescriptors = persistentCapacity;
+	stagingHeapDesc.Type = m_type;
+	stagingHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	DXCall(m_device->CreateDescriptorHeap(&stagingHeapDesc, IID_PPV_ARGS(&stagingHeap)));
+
+	D3D12_DESCRIPTOR_HEAP_DESC shaderVisibleHeapDesc = {};
+	shaderVisibleHeapDesc.NumDescriptors = persistentCapacity + (m_indices.GetTransientCapacityPerFrame() * m_framesInFlight);
+	shaderVisibleHeapDesc.Type = m_type;
+	shaderVisibleHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	DXCall(m_device->CreateDescriptorHeap(&shaderVisibleHeapDesc, IID_PPV_ARGS(&shaderVisibleHeap)));
+
+	NAME_D3D12_OBJECT(stagingHeap, L"Descriptor Staging Heap");
+	NAME_D3D12_OBJECT(shaderVisibleHeap, L"Descriptor Shader Visible Heap");
+}
+
+void DescriptorHeapAllocator::GrowHeaps(UINT frameIndex) {
+
+	const UINT oldCapacity = m_indices.GetPersistentCapacity();
+	const UINT newCapacity = oldCapacity * 2;
+	m_indices.Grow(newCapacity);
+
+	ComPtr<ID3D12DescriptorHeap> stagingHeap;
+	ComPtr<ID3D12DescriptorHeap> shaderVisibleHeap;
+	CreateHeaps(stagingHeap, shaderVisibleHeap, newCapacity);
+
+	// Persistent indices keep their slot, so the old range copies straight across.
+	// Shader visible heaps can't be a copy source, everything goes through the staging heap.
+	m_device->CopyDescriptorsSimple(oldCapacity, stagingHeap->GetCPUDescriptorHandleForHeapStart(),
+		m_stagingHeap->GetCPUDescriptorHandleForHeapStart(), m_type);
+	m_device->CopyDescriptorsSimple(oldCapacity, shaderVisibleHeap->GetCPUDescriptorHandleForHeapStart(),
+		stagingHeap->GetCPUDescriptorHandleForHeapStart(), m_type);
+
+	// Frames still in flight reference the old heap, by the time this slot comes round again they have all retired
+	m_retiredHeaps[frameIndex] = m_shaderVisibleHeap;
+	m_shaderVisibleHeap = shaderVisibleHeap;
+	m_stagingHeap = stagingHeap;
+
+	spdlog::info("Descriptor heap grown from {} to {} persistent descriptors", oldCapacity, newCapacity);
+}
+
+void DescriptorHeapAllocator::BeginFrame(UINT frameIndex) {
+	m_retiredHeaps[frameIndex].Reset();
+	m_indices.BeginFrame(frameIndex);
+
+	if (m_indices.ShouldGrow())
+	{
+		GrowHeaps(frameIndex);
+	}
+}
+
+void DescriptorHeapAllocator::CommitPersistent(UINT index) {
+	D3D12_CPU_DESCRIPTOR_HANDLE destination = m_shaderVisibleHeap->GetCPUDescriptorHandleForHeapStart();
+	destination.ptr += static_cast<SIZE_T>(index) * m_descriptorSize;
+
+	m_device->CopyDescriptorsSimple(1, destination, GetStagingHandle(index), m_type);
+}
+
+void DescriptorHeapAllocator::StageTransient(UINT index, D3D12_CPU_DESCRIPTOR_HANDLE source) {
+	assert(index >= m_indices.GetPersistentCapacity() && index < m_indices.GetTotalCapacity());
+
+	D3D12_CPU_DESCRIPTOR_HANDLE destination = m_shaderVisibleHeap->GetCPUDescriptorHandleForHeapStart();
+	destination.ptr += static_cast<SIZE_T>(index) * m_descriptorSize;
+
+	m_device->CopyDescriptorsSimple(1, destination, source, m_type);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeapAllocator::GetStagingHandle(UINT index) const {
+	assert(index < m_indices.GetPersistentCapacity());
+
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = m_stagingHeap->GetCPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<SIZE_T>(index) * m_descriptorSize;
+	return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeapAllocator::GetGpuHandle(UINT index) const {
+	D3D12_GPU_DESCRIPTOR_HANDLE handle = m_shaderVisibleHeap->GetGPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<UINT64>(index) * m_descriptorSize;
+	return handle;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+#include "DescriptorIndexAllocator.h"
+
+// Shader visible CBV/SRV/UAV (or sampler) heap backed by a CPU only staging heap of the same layout.
+// Persistent views are written into the staging heap and copied across with CommitPersistent, transient views
+// are copied straight into the current frame's range. When the persistent range fills up both heaps are
+// recreated at double size in BeginFrame, the old shader visible heap is kept alive until its frame retires.
+class DescriptorHeapAllocator {
+	private:
+		ID3D12Device8* m_device = nullptr;
+		D3D12_DESCRIPTOR_HEAP_TYPE m_type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		UINT m_descriptorSize = 0;
+		UINT m_framesInFlight = 0;
+
+		ComPtr<ID3D12DescriptorHeap> m_stagingHeap;
+		ComPtr<ID3D12DescriptorHeap> m_shaderVisibleHeap;
+		ComPtr<ID3D12DescriptorHeap> m_retiredHeaps[FrameScheduler::MaxFramesInFlight];
+
+		DescriptorIndexAllocator m_indices;
+
+		void CreateHeaps(ComPtr<ID3D12DescriptorHeap>& stagingHeap, ComPtr<ID3D12DescriptorHeap>& shaderVisibleHeap,
+			UINT numDescriptors);
+		void GrowHeaps(UINT frameIndex);
+
+	public:
+		void Initialize(ID3D12Device8* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT persistentCapacity,
+			UINT transientCapacityPerFrame, UINT framesInFlight);
+		void Shutdown();
+
+		// Call once the scheduler has retired frameIndex, also the only point the heaps can grow
+		void BeginFrame(UINT frameIndex);
+
+		UINT AllocatePersistent() { return m_indices.AllocatePersistent(); }
+		void FreePersistentDeferred(UINT index) { m_indices.FreePersistentDeferred(index); }
+		// Copies a persistent view from the staging heap into the shader visible heap
+		void CommitPersistent(UINT index);
+
+		// Reserves count contiguous slots in this frame's range, fill them with StageTransient
+		UINT AllocateTransient(UINT count) { return m_indices.AllocateTransient(count); }
+		void StageTransient(UINT index, D3D12_CPU_DESCRIPTOR_HANDLE source);
+
+		// Where views for persistent slots get created
+		D3D12_CPU_DESCRIPTOR_HANDLE GetStagingHandle(UINT index) const;
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(UINT index) const;
+
+		ID3D12DescriptorHeap* GetShaderVisibleHeap() const { return m_shaderVisibleHeap.Get(); }
+		DescriptorAllocatorStats GetStats() const { return m_indices.GetStats(); }
+};
@@ -0,0 +1,218 @@
+#include "DescriptorIndexAllocator.h"
+#include <cassert>
+#include <vector>
+
+namespace
+{
+	uint64_t PackHead(uint64_t previousHead, uint32_t index)
+	{
+		const uint64_t tag = (previousHead >> 32) + 1;
+		return (tag << 32) | index;
+	}
+}
+
+DescriptorIndexAllocator::DescriptorIndexAllocator() {
+	m_persistentCapacity = 0;
+	m_transientCapacityPerFrame = 0;
+	m_framesInFlight = 0;
+	m_frameIndex = 0;
+	m_freeHead.store(InvalidIndex, std::memory_order_relaxed);
+	m_highWater.store(0, std::memory_order_relaxed);
+	m_allocatedCount.store(0, std::memory_order_relaxed);
+	m_transientOffset.store(0, std::memory_order_relaxed);
+	m_transientPeak = 0;
+
+	for (uint32_t i{ 0 }; i < FrameScheduler::MaxFramesInFlight; i++)
+	{
+		m_pendingHeads[i].store(InvalidIndex, std::memory_order_relaxed);
+	}
+}
+
+void DescriptorIndexAllocator::Initialize(uint32_t persistentCapacity, uint32_t transientCapacityPerFrame, uint32_t framesInFlight) {
+	assert(framesInFlight > 0 && framesInFlight <= FrameScheduler::MaxFramesInFlight);
+
+	m_persistentCapacity = persistentCapacity;
+	m_transientCapacityPerFrame = transientCapacityPerFrame;
+	m_framesInFlight = framesInFlight;
+	m_frameIndex = 0;
+
+	m_next.reset(new std::atomic<uint32_t>[persistentCapacity]);
+	for (uint32_t i{ 0 }; i < persistentCapacity; i++)
+	{
+		m_next[i].store(InvalidIndex, std::memory_order_relaxed);
+	}
+
+	m_freeHead.store(InvalidIndex, std::memory_order_relaxed);
+	m_highWater.store(0, std::memory_order_relaxed);
+	m_allocatedCount.store(0, std::memory_order_relaxed);
+	m_transientOffset.store(0, std::memory_order_relaxed);
+	m_transientPeak = 0;
+
+	for (uint32_t i{ 0 }; i < FrameScheduler::MaxFramesInFlight; i++)
+	{
+		m_pendingHeads[i].store(InvalidIndex, std::memory_order_relaxed);
+	}
+}
+
+void DescriptorIndexAllocator::Grow(uint32_t newPersistentCapacity) {
+	assert(newPersistentCapacity > m_persistentCapacity);
+
+	std::unique_ptr<std::atomic<uint32_t>[]> next(new std::atomic<uint32_t>[newPersistentCapacity]);
+	for (uint32_t i{ 0 }; i < newPersistentCapacity; i++)
+	{
+		const uint32_t value = i < m_persistentCapacity ? m_next[i].load(std::memory_order_relaxed) : InvalidIndex;
+		next[i].store(value, std::memory_order_relaxed);
+	}
+
+	m_next = std::move(next);
+	m_persistentCapacity = newPersistentCapacity;
+}
+
+uint32_t DescriptorIndexAllocator::AllocatePersistent() {
+
+	// Reuse a freed slot first
+	uint64_t head = m_freeHead.load(std::memory_order_acquire);
+	while (static_cast<uint32_t>(head) != InvalidIndex)
+	{
+		const uint32_t index = static_cast<uint32_t>(head);
+		const uint32_t next = m_next[index].load(std::memory_order_relaxed);
+
+		// If someone else popped in the meantime the tag won't match and we retry with the new head
+		if (m_freeHead.compare_exchange_weak(head, PackHead(head, next), std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			m_allocatedCount.fetch_add(1, std::memory_order_relaxed);
+			return index;
+		}
+	}
+
+	// Otherwise take a slot that has never been used
+	uint32_t highWater = m_highWater.load(std::memory_order_relaxed);
+	do
+	{
+		if (highWater >= m_persistentCapacity)
+		{
+			return InvalidIndex;
+		}
+	} while (!m_highWater.compare_exchange_weak(highWater, highWater + 1, std::memory_order_relaxed));
+
+	m_allocatedCount.fetch_add(1, std::memory_order_relaxed);
+	return highWater;
+}
+
+void DescriptorIndexAllocator::PushChain(uint32_t first, uint32_t last) {
+	uint64_t head = m_freeHead.load(std::memory_order_relaxed);
+	do
+	{
+		m_next[last].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+	} while (!m_freeHead.compare_exchange_weak(head, PackHead(head, first), std::memory_order_release, std::memory_order_relaxed));
+}
+
+void DescriptorIndexAllocator::FreePersistent(uint32_t index) {
+	assert(index < m_highWater.load(std::memory_order_relaxed));
+
+	m_allocatedCount.fetch_sub(1, std::memory_order_relaxed);
+	PushChain(index, index);
+}
+
+void DescriptorIndexAllocator::FreePersistentDeferred(uint32_t index) {
+	assert(index < m_highWater.load(std::memory_order_relaxed));
+
+	// Push only stack, the list is taken whole in BeginFrame so there is no ABA to worry about
+	std::atomic<uint32_t>& pendingHead = m_pendingHeads[m_frameIndex];
+	uint32_t head = pendingHead.load(std::memory_order_relaxed);
+	do
+	{
+		m_next[index].store(head, std::memory_order_relaxed);
+	} while (!pendingHead.compare_exchange_weak(head, index, std::memory_order_release, std::memory_order_relaxed));
+}
+
+uint32_t DescriptorIndexAllocator::AllocateTransient(uint32_t count) {
+	uint32_t offset = m_transientOffset.load(std::memory_order_relaxed);
+	do
+	{
+		if (offset + count > m_transientCapacityPerFrame)
+		{
+			return InvalidIndex;
+		}
+	} while (!m_transientOffset.compare_exchange_weak(offset, offset + count, std::memory_order_relaxed));
+
+	return m_persistentCapacity + (m_frameIndex * m_transientCapacityPerFrame) + offset;
+}
+
+void DescriptorIndexAllocator::BeginFrame(uint32_t frameIndex) {
+	assert(frameIndex < m_framesInFlight);
+
+	// Frees deferred the last time this slot was used are safe now
+	const uint32_t first = m_pendingHeads[frameIndex].exchange(InvalidIndex, std::memory_order_acquire);
+	if (first != InvalidIndex)
+	{
+		uint32_t last = first;
+		uint32_t count = 1;
+		while (m_next[last].load(std::memory_order_relaxed) != InvalidIndex)
+		{
+			last = m_next[last].load(std::memory_order_relaxed);
+			count++;
+		}
+
+		m_allocatedCount.fetch_sub(count, std::memory_order_relaxed);
+		PushChain(first, last);
+	}
+
+	const uint32_t used = m_transientOffset.load(std::memory_order_relaxed);
+	if (used > m_transientPeak)
+	{
+		m_transientPeak = used;
+	}
+
+	m_frameIndex = frameIndex;
+	m_transientOffset.store(0, std::memory_order_relaxed);
+}
+
+bool DescriptorIndexAllocator::ShouldGrow() const {
+	// Grow at 75% so allocations in the middle of a frame don't run dry
+	return m_allocatedCount.load(std::memory_order_relaxed) * 4 >= m_persistentCapacity * 3;
+}
+
+DescriptorAllocatorStats DescriptorIndexAllocator::GetStats() const {
+	DescriptorAllocatorStats stats;
+	stats.persistentCapacity = m_persistentCapacity;
+	stats.persistentAllocated = m_allocatedCount.load(std::memory_order_relaxed);
+	stats.persistentHighWater = m_highWater.load(std::memory_order_relaxed);
+	stats.transientCapacityPerFrame = m_transientCapacityPerFrame;
+	stats.transientUsed = m_transientOffset.load(std::memory_order_relaxed);
+	stats.transientPeak = m_transientPeak;
+
+	// Mark every free slot below the high water mark, everything above it is one free run
+	std::vector<bool> isFree(stats.persistentHighWater, false);
+	for (uint32_t index = static_cast<uint32_t>(m_freeHead.load(std::memory_order_acquire)); index != InvalidIndex;
+		index = m_next[index].load(std::memory_order_relaxed))
+	{
+		isFree[index] = true;
+		stats.freeListLength++;
+	}
+
+	uint32_t run = 0;
+	for (uint32_t i{ 0 }; i < stats.persistentHighWater; i++)
+	{
+		run = isFree[i] ? run + 1 : 0;
+		if (run > stats.largestFreeRun)
+		{
+			stats.largestFreeRun = run;
+		}
+	}
+
+	// The run touching the high water mark continues into the never used tail
+	const uint32_t tail = m_persistentCapacity - stats.persistentHighWater;
+	if (run + tail > stats.largestFreeRun)
+	{
+		stats.largestFreeRun = run + tail;
+	}
+
+	const uint32_t totalFree = stats.freeListLength + tail;
+	if (totalFree > 0)
+	{
+		stats.fragmentation = 1.0f - (static_cast<float>(stats.largestFreeRun) / static_cast<float>(totalFree));
+	}
+
+	return stats;
+}
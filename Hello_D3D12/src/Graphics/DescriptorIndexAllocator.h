@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "FrameScheduler.h"
+
+struct DescriptorAllocatorStats
+{
+	uint32_t persistentCapacity = 0;
+	uint32_t persistentAllocated = 0;
+	uint32_t persistentHighWater = 0;	// Indices below this have been handed out at least once
+	uint32_t freeListLength = 0;
+	uint32_t largestFreeRun = 0;
+	float fragmentation = 0.0f;			// 0 means every free slot is in one contiguous run
+	uint32_t transientCapacityPerFrame = 0;
+	uint32_t transientUsed = 0;
+	uint32_t transientPeak = 0;
+};
+
+// Index management for a descriptor heap, knows nothing about ID3D12DescriptorHeap.
+// The heap is laid out as [ persistent | transient frame 0 | transient frame 1 | ... ].
+// Persistent slots come from a lock free free list (plus a bump pointer for slots never used yet).
+// Transient slots are linear per frame and recycled in bulk in BeginFrame once the frame has retired.
+class DescriptorIndexAllocator {
+	public:
+		static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+	private:
+		uint32_t m_persistentCapacity;
+		uint32_t m_transientCapacityPerFrame;
+		uint32_t m_framesInFlight;
+		uint32_t m_frameIndex;
+
+		// Free list is a Treiber stack threaded through m_next, the head carries an ABA tag in the upper 32 bits
+		std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+		std::atomic<uint64_t> m_freeHead;
+		std::atomic<uint32_t> m_highWater;
+		std::atomic<uint32_t> m_allocatedCount;
+
+		// Frees that have to wait for the frame's fence, spliced into the free list in BeginFrame
+		std::atomic<uint32_t> m_pendingHeads[FrameScheduler::MaxFramesInFlight];
+
+		std::atomic<uint32_t> m_transientOffset;
+		uint32_t m_transientPeak;
+
+		void PushChain(uint32_t first, uint32_t last);
+
+		// Lets the tests hold a stale view of the free list head to replay the ABA interleaving
+		friend struct DescriptorIndexAllocatorTestAccess;
+
+	public:
+		DescriptorIndexAllocator();
+		DescriptorIndexAllocator(const DescriptorIndexAllocator&) = delete;
+		DescriptorIndexAllocator& operator=(const DescriptorIndexAllocator&) = delete;
+
+		void Initialize(uint32_t persistentCapacity, uint32_t transientCapacityPerFrame, uint32_t framesInFlight);
+
+		// Not thread safe, only call between frames. Existing persistent indices stay valid, transient ones move.
+		void Grow(uint32_t newPersistentCapacity);
+
+		uint32_t AllocatePersistent();
+		// Only for slots the GPU can no longer be referencing
+		void FreePersistent(uint32_t index);
+		// Slot is handed back once the current frame has been retired
+		void FreePersistentDeferred(uint32_t index);
+
+		// Returns the first index of count contiguous slots in the current frame's transient range
+		uint32_t AllocateTransient(uint32_t count);
+
+		// Call once the scheduler has retired frameIndex
+		void BeginFrame(uint32_t frameIndex);
+
+		// Not thread safe with concurrent allocations, walks the whole free list
+		DescriptorAllocatorStats GetStats() const;
+
+		bool ShouldGrow() const;
+
+		uint32_t GetPersistentCapacity() const { return m_persistentCapacity; }
+		uint32_t GetTransientCapacityPerFrame() const { return m_transientCapacityPerFrame; }
+		uint32_t GetTotalCapacity() const { return m_persistentCapacity + m_transientCapacityPerFrame * m_framesInFlight; }
+};
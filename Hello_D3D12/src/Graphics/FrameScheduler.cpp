@@ -0,0 +1,38 @@
+#include "FrameScheduler.h"
+#include <cassert>
+
+FrameScheduler::FrameScheduler(uint32_t framesInFlight) {
+	assert(framesInFlight > 0 && framesInFlight <= MaxFramesInFlight);
+
+	m_framesInFlight = framesInFlight;
+	m_frameIndex = 0;
+	m_frameCount = 0;
+
+	// Fences get created with 0, so the first value we signal has to be 1
+	m_nextFenceValue = 1;
+
+	for (uint32_t i{ 0 }; i < MaxFramesInFlight; i++)
+	{
+		m_frameFenceValues[i] = 0;
+	}
+}
+
+uint64_t FrameScheduler::SignalFlush() {
+	return m_nextFenceValue++;
+}
+
+uint64_t FrameScheduler::EndFrame() {
+
+	const uint64_t signalValue = m_nextFenceValue++;
+	m_frameFenceValues[m_frameIndex] = signalValue;
+
+	m_frameIndex = (m_frameIndex + 1) % m_framesInFlight;
+	m_frameCount++;
+
+	return signalValue;
+}
+
+bool FrameScheduler::IsFrameRetired(uint32_t frameIndex, uint64_t completedValue) const {
+	assert(frameIndex < m_framesInFlight);
+	return completedValue >= m_frameFenceValues[frameIndex];
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+
+// Platform neutral bookkeeping for N frames in flight.
+// Every frame slot remembers the fence value that was signalled when it was submitted, the CPU only has to
+// wait when it wraps around to a slot the GPU has not retired yet. No D3D types in here on purpose, the
+// implementation just feeds it completed fence values.
+class FrameScheduler {
+	public:
+		static const uint32_t MaxFramesInFlight = 3;
+
+	private:
+		uint32_t m_framesInFlight;
+		uint32_t m_frameIndex;
+		uint64_t m_frameCount;
+		uint64_t m_nextFenceValue;
+		uint64_t m_frameFenceValues[MaxFramesInFlight];
+
+	public:
+		explicit FrameScheduler(uint32_t framesInFlight = 2);
+
+		// Reserves a fence value for an out of band signal (setup uploads, shutdown flush)
+		uint64_t SignalFlush();
+
+		// Records the fence value for the frame that was just submitted and moves on to the next slot.
+		// Returns the value that should be signalled on the queue.
+		uint64_t EndFrame();
+
+		// The fence value the GPU has to reach before the current slot can be recorded into again.
+		// Zero means the slot has never been used.
+		uint64_t GetWaitValue() const { return m_frameFenceValues[m_frameIndex]; }
+
+		bool IsFrameRetired(uint32_t frameIndex, uint64_t completedValue) const;
+
+		uint32_t GetFrameIndex() const { return m_frameIndex; }
+		uint32_t GetFramesInFlight() const { return m_framesInFlight; }
+		uint64_t GetFrameCount() const { return m_frameCount; }
+		uint64_t GetFrameFenceValue(uint32_t frameIndex) const { return m_frameFenceValues[frameIndex]; }
+		uint64_t GetLastSignalledValue() const { return m_nextFenceValue - 1; }
+};
@@ -0,0 +1,218 @@
+#include "FrustumCull.h"
+#include <cmath>
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+Frustum MakeFrustum(const float* viewProjection) {
+	// Row r of the matrix, column major storage
+	const auto row = [viewProjection](int r, int c) { return viewProjection[c * 4 + r]; };
+
+	Frustum frustum;
+	for (int c{ 0 }; c < 4; c++)
+	{
+		frustum.planes[0][c] = row(3, c) + row(0, c);	// Left
+		frustum.planes[1][c] = row(3, c) - row(0, c);	// Right
+		frustum.planes[2][c] = row(3, c) + row(1, c);	// Bottom
+		frustum.planes[3][c] = row(3, c) - row(1, c);	// Top
+		frustum.planes[4][c] = row(2, c);				// Near, D3D clip depth starts at 0
+		frustum.planes[5][c] = row(3, c) - row(2, c);	// Far
+	}
+
+	for (float* plane : frustum.planes)
+	{
+		const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+		{
+			for (int c{ 0 }; c < 4; c++)
+			{
+				plane[c] /= length;
+			}
+		}
+	}
+
+	return frustum;
+}
+
+uint32_t CullSpheresScalar(const Frustum& frustum, const float* x, const float* y, const float* z, const float* scale,
+	float radiusScale, uint32_t first, uint32_t count, uint32_t* visible) {
+
+	uint32_t visibleCount = 0;
+	for (uint32_t i{ first }; i < first + count; i++)
+	{
+		const float negativeRadius = -(scale[i] * radiusScale);
+
+		bool inside = true;
+		for (const float* plane : frustum.planes)
+		{
+			// Kept as separate multiplies and adds in the same order as the SIMD kernels so they round the same
+			float distance = plane[0] * x[i];
+			distance = distance + plane[1] * y[i];
+			distance = distance + plane[2] * z[i];
+			distance = distance + plane[3];
+			inside = inside && distance >= negativeRadius;
+		}
+
+		visible[visibleCount] = i;
+		visibleCount += inside ? 1 : 0;
+	}
+
+	return visibleCount;
+}
+
+namespace
+{
+	typedef uint32_t(*CullSpheresFunction)(const Frustum& frustum, const float* x, const float* y, const float* z,
+		const float* scale, float radiusScale, uint32_t first, uint32_t count, uint32_t* visible);
+
+	struct KernelTable
+	{
+		SimdLevel level;
+		CullSpheresFunction cullSpheres;
+	};
+
+#ifdef CPU_FEATURES_X86
+
+	// SSE2, 4 spheres at a time
+
+	uint32_t CullSpheresSse2(const Frustum& frustum, const float* x, const float* y, const float* z, const float* scale,
+		float radiusScale, uint32_t first, uint32_t count, uint32_t* visible) {
+
+		__m128 planes[6][4];
+		for (int p{ 0 }; p < 6; p++)
+		{
+			for (int c{ 0 }; c < 4; c++)
+			{
+				planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+			}
+		}
+
+		const __m128 negativeRadiusScale = _mm_set1_ps(-radiusScale);
+
+		uint32_t visibleCount = 0;
+		uint32_t i{ first };
+		const uint32_t end = first + count;
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128 centerX = _mm_loadu_ps(x + i);
+			const __m128 centerY = _mm_loadu_ps(y + i);
+			const __m128 centerZ = _mm_loadu_ps(z + i);
+			const __m128 negativeRadius = _mm_mul_ps(_mm_loadu_ps(scale + i), negativeRadiusScale);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p{ 0 }; p < 6; p++)
+			{
+				__m128 distance = _mm_mul_ps(planes[p][0], centerX);
+				distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][1], centerY));
+				distance = _mm_add_ps(distance, _mm_mul_ps(planes[p][2], centerZ));
+				distance = _mm_add_ps(distance, planes[p][3]);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+
+			// Every lane writes its index, only the ones that survived advance past it
+			const uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+			for (uint32_t lane{ 0 }; lane < 4; lane++)
+			{
+				visible[visibleCount] = i + lane;
+				visibleCount += (mask >> lane) & 1;
+			}
+		}
+
+		return visibleCount + CullSpheresScalar(frustum, x, y, z, scale, radiusScale, i, end - i, visible + visibleCount);
+	}
+
+	// AVX2, 8 spheres at a time. No FMA, the separate multiplies and adds round like the scalar reference.
+
+	SIMD_TARGET_AVX2 uint32_t CullSpheresAvx2(const Frustum& frustum, const float* x, const float* y, const float* z,
+		const float* scale, float radiusScale, uint32_t first, uint32_t count, uint32_t* visible) {
+
+		__m256 planes[6][4];
+		for (int p{ 0 }; p < 6; p++)
+		{
+			for (int c{ 0 }; c < 4; c++)
+			{
+				planes[p][c] = _mm256_set1_ps(frustum.planes[p][c]);
+			}
+		}
+
+		const __m256 negativeRadiusScale = _mm256_set1_ps(-radiusScale);
+		const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+		uint32_t visibleCount = 0;
+		uint32_t i{ first };
+		const uint32_t end = first + count;
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256 centerX = _mm256_loadu_ps(x + i);
+			const __m256 centerY = _mm256_loadu_ps(y + i);
+			const __m256 centerZ = _mm256_loadu_ps(z + i);
+			const __m256 negativeRadius = _mm256_mul_ps(_mm256_loadu_ps(scale + i), negativeRadiusScale);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p{ 0 }; p < 6; p++)
+			{
+				__m256 distance = _mm256_mul_ps(planes[p][0], centerX);
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][1], centerY));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p][2], centerZ));
+				distance = _mm256_add_ps(distance, planes[p][3]);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+			}
+
+			const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+			if (mask == 0)
+			{
+				continue;
+			}
+
+			// All 8 visible is one store, otherwise every lane writes its index and only survivors advance
+			if (mask == 0xFF)
+			{
+				const __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), laneOffsets);
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(visible + visibleCount), indices);
+				visibleCount += 8;
+				continue;
+			}
+
+			for (uint32_t lane{ 0 }; lane < 8; lane++)
+			{
+				visible[visibleCount] = i + lane;
+				visibleCount += (mask >> lane) & 1;
+			}
+		}
+
+		return visibleCount + CullSpheresScalar(frustum, x, y, z, scale, radiusScale, i, end - i, visible + visibleCount);
+	}
+
+#endif
+
+	KernelTable MakeKernelTable(SimdLevel level) {
+		KernelTable table = { SimdLevel::Scalar, CullSpheresScalar };
+#ifdef CPU_FEATURES_X86
+		if (level >= SimdLevel::SSE2)
+		{
+			table = { SimdLevel::SSE2, CullSpheresSse2 };
+		}
+		// No AVX-512 kernel, it runs the AVX2 one
+		if (level >= SimdLevel::AVX2)
+		{
+			table = { SimdLevel::AVX2, CullSpheresAvx2 };
+		}
+#endif
+		return table;
+	}
+
+	const KernelTable& GetKernels() {
+		static const SimdKernelTables<KernelTable> tables(MakeKernelTable);
+		return tables.Get();
+	}
+}
+
+uint32_t CullSpheres(const Frustum& frustum, const float* x, const float* y, const float* z, const float* scale,
+	float radiusScale, uint32_t first, uint32_t count, uint32_t* visible) {
+	return GetKernels().cullSpheres(frustum, x, y, z, scale, radiusScale, first, count, visible);
+}
+
+SimdLevel GetCullKernelLevel() {
+	return GetKernels().level;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "../Core/CpuFeatures.h"
+#include <cstdint>
+
+// Six planes facing inwards, xyz normal and w distance, normalised so the distance is in world units
+struct Frustum
+{
+	float planes[6][4];
+};
+
+// Slack callers leave in visible past count. The kernels write each candidate's index before deciding whether to
+// keep it, lane by lane for a partly visible batch and all 8 at once for a fully visible one, never past count.
+static const uint32_t CullOutputPadding = 8;
+
+// viewProjection is a column major 4x4 (glm layout) with D3D's 0 to 1 clip depth
+Frustum MakeFrustum(const float* viewProjection);
+
+// Sphere i is at (x[i], y[i], z[i]) with radius scale[i] * radiusScale, the planes are InstanceSet's.
+// Both write the index of every sphere in [first, first + count) touching the frustum to visible, in order, and
+// return how many there were. visible needs room for count + CullOutputPadding indices.
+// The scalar one is the reference, CullSpheres picks the widest kernel the CPU has at runtime (see
+// GetSimdLevel) and gives the same answer.
+uint32_t CullSpheresScalar(const Frustum& frustum, const float* x, const float* y, const float* z, const float* scale,
+	float radiusScale, uint32_t first, uint32_t count, uint32_t* visible);
+uint32_t CullSpheres(const Frustum& frustum, const float* x, const float* y, const float* z, const float* scale,
+	float radiusScale, uint32_t first, uint32_t count, uint32_t* visible);
+
+// The kernel CullSpheres runs. AVX-512 CPUs run the AVX2 one.
+SimdLevel GetCullKernelLevel();
@@ -0,0 +1,355 @@
+#include "GpuHeapAllocator.h"
+
+void GpuHeapAllocator::Initialize(ID3D12Device8* device, UINT64 blockSize) {
+	m_device = device;
+	m_blockSize = blockSize;
+	m_frameIndex = 0;
+
+	const D3D12_HEAP_TYPE heapTypes[HeapTypeCount] = { D3D12_HEAP_TYPE_DEFAULT, D3D12_HEAP_TYPE_UPLOAD };
+	const D3D12_HEAP_FLAGS categoryFlags[PoolCategoryCount] = {
+		D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+		D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+	};
+
+	for (UINT type{ 0 }; type < HeapTypeCount; type++)
+	{
+		for (UINT category{ 0 }; category < PoolCategoryCount; category++)
+		{
+			Pool& pool = m_pools[(type * PoolCategoryCount) + category];
+			pool.heapType = heapTypes[type];
+			pool.heapFlags = categoryFlags[category];
+			// MSAA targets need 4MB placement, everything else is happy with 64KB
+			pool.blockAlignment = category == PoolCategoryRenderTarget ?
+				D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			pool.blocks.clear();
+		}
+	}
+}
+
+void GpuHeapAllocator::Shutdown() {
+	for (UINT i{ 0 }; i < FrameScheduler::MaxFramesInFlight; i++)
+	{
+		m_pendingReleases[i].clear();
+	}
+
+	for (UINT i{ 0 }; i < PoolCount; i++)
+	{
+		for (auto& block : m_pools[i].blocks)
+		{
+			for (GpuAllocation* allocation : block->liveAllocations)
+			{
+				delete allocation;
+			}
+		}
+		m_pools[i].blocks.clear();
+	}
+
+	m_device = nullptr;
+}
+
+UINT GpuHeapAllocator::GetPoolIndex(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc) {
+	assert(heapType == D3D12_HEAP_TYPE_DEFAULT || heapType == D3D12_HEAP_TYPE_UPLOAD);
+	const UINT type = heapType == D3D12_HEAP_TYPE_DEFAULT ? 0 : 1;
+
+	UINT category = PoolCategoryTexture;
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		category = PoolCategoryBuffer;
+	}
+	else if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+	{
+		category = PoolCategoryRenderTarget;
+	}
+
+	return (type * PoolCategoryCount) + category;
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO GpuHeapAllocator::GetAllocationInfo(D3D12_RESOURCE_DESC& desc) const {
+
+	// Small textures can get away with 4KB placement, the runtime tells us if this one can't
+	const bool isTexture = desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER;
+	const bool isTarget = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+	if (isTexture && !isTarget && desc.SampleDesc.Count <= 1)
+	{
+		desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+		const D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+		if (info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+		{
+			return info;
+		}
+	}
+
+	// Buffers are always 64KB
+	desc.Alignment = 0;
+	return m_device->GetResourceAllocationInfo(0, 1, &desc);
+}
+
+UINT GpuHeapAllocator::CreateBlock(UINT poolIndex, UINT64 minimumSize) {
+	Pool& pool = m_pools[poolIndex];
+
+	// Anything bigger than a block gets a dedicated one
+	UINT64 blockSize = m_blockSize;
+	if (minimumSize > blockSize)
+	{
+		blockSize = (minimumSize + pool.blockAlignment - 1) & ~(pool.blockAlignment - 1);
+	}
+
+	D3D12_HEAP_DESC heapDesc = {};
+	heapDesc.SizeInBytes = blockSize;
+	heapDesc.Properties.Type = pool.heapType;
+	heapDesc.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapDesc.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapDesc.Properties.CreationNodeMask = 1;
+	heapDesc.Properties.VisibleNodeMask = 1;
+	heapDesc.Alignment = pool.blockAlignment;
+	heapDesc.Flags = pool.heapFlags;
+
+	std::unique_ptr<HeapBlock> block = std::make_unique<HeapBlock>();
+	HRESULT hr{ S_OK };
+	DXCall(hr = m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&block->heap)));
+	if (FAILED(hr))
+	{
+		spdlog::error("Couldn't create a GPU heap block of {} bytes for pool {}", blockSize, poolIndex);
+		return InvalidBlock;
+	}
+	NAME_D3D12_OBJECT(block->heap, L"GPU Heap Block");
+	block->allocator.Initialize(blockSize);
+
+	pool.blocks.push_back(std::move(block));
+
+	spdlog::info("GPU heap block created, pool {} block {} size {}", poolIndex, pool.blocks.size() - 1, blockSize);
+	return static_cast<UINT>(pool.blocks.size() - 1);
+}
+
+bool GpuHeapAllocator::AllocatePlacement(UINT poolIndex, const D3D12_RESOURCE_ALLOCATION_INFO& info, UINT excludedBlock,
+	UINT& blockIndex, TlsfAllocation& placement) {
+
+	Pool& pool = m_pools[poolIndex];
+	for (UINT i{ 0 }; i < pool.blocks.size(); i++)
+	{
+		if (i == excludedBlock || !pool.blocks[i]->heap)
+		{
+			continue;
+		}
+
+		if (pool.blocks[i]->allocator.Allocate(info.SizeInBytes, info.Alignment, placement))
+		{
+			blockIndex = i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void GpuHeapAllocator::AddLive(GpuAllocation* allocation) {
+	std::vector<GpuAllocation*>& live = m_pools[allocation->poolIndex].blocks[allocation->blockIndex]->liveAllocations;
+	allocation->liveIndex = static_cast<UINT>(live.size());
+	live.push_back(allocation);
+}
+
+void GpuHeapAllocator::RemoveLive(GpuAllocation* allocation) {
+	std::vector<GpuAllocation*>& live = m_pools[allocation->poolIndex].blocks[allocation->blockIndex]->liveAllocations;
+	live[allocation->liveIndex] = live.back();
+	live[allocation->liveIndex]->liveIndex = allocation->liveIndex;
+	live.pop_back();
+}
+
+void GpuHeapAllocator::FreePlacement(UINT poolIndex, UINT blockIndex, const TlsfAllocation& placement) {
+	m_pools[poolIndex].blocks[blockIndex]->allocator.Free(placement);
+}
+
+GpuAllocation* GpuHeapAllocator::CreateResource(const D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue) {
+
+	GpuAllocation* allocation = new GpuAllocation();
+	allocation->desc = desc;
+	allocation->poolIndex = GetPoolIndex(heapType, desc);
+
+	const D3D12_RESOURCE_ALLOCATION_INFO info = GetAllocationInfo(allocation->desc);
+
+	if (!AllocatePlacement(allocation->poolIndex, info, InvalidBlock, allocation->blockIndex, allocation->placement))
+	{
+		// A new block starts on the pool's alignment, which covers any placement alignment, so it always fits
+		// unless the heap can't be created
+		allocation->blockIndex = CreateBlock(allocation->poolIndex, info.SizeInBytes);
+		if (allocation->blockIndex == InvalidBlock ||
+			!m_pools[allocation->poolIndex].blocks[allocation->blockIndex]->allocator.Allocate(
+				info.SizeInBytes, info.Alignment, allocation->placement))
+		{
+			spdlog::error("Couldn't place a resource of {} bytes in pool {}", info.SizeInBytes, allocation->poolIndex);
+			delete allocation;
+			return nullptr;
+		}
+	}
+
+	ID3D12Heap* heap = m_pools[allocation->poolIndex].blocks[allocation->blockIndex]->heap.Get();
+	HRESULT hr{ S_OK };
+	DXCall(hr = m_device->CreatePlacedResource(heap, allocation->placement.offset, &allocation->desc, initialState, clearValue,
+		IID_PPV_ARGS(&allocation->resource)));
+	if (FAILED(hr))
+	{
+		FreePlacement(allocation->poolIndex, allocation->blockIndex, allocation->placement);
+		delete allocation;
+		return nullptr;
+	}
+
+	AddLive(allocation);
+	return allocation;
+}
+
+void GpuHeapAllocator::Release(GpuAllocation* allocation) {
+	if (!allocation)
+	{
+		return;
+	}
+
+	RemoveLive(allocation);
+
+	PendingRelease pending;
+	pending.resource = allocation->resource;
+	pending.poolIndex = allocation->poolIndex;
+	pending.blockIndex = allocation->blockIndex;
+	pending.placement = allocation->placement;
+	m_pendingReleases[m_frameIndex].push_back(pending);
+
+	delete allocation;
+}
+
+void GpuHeapAllocator::BeginFrame(UINT frameIndex) {
+	m_frameIndex = frameIndex;
+
+	// Everything released the last time this slot was used is safe to reuse now
+	for (const PendingRelease& pending : m_pendingReleases[frameIndex])
+	{
+		FreePlacement(pending.poolIndex, pending.blockIndex, pending.placement);
+	}
+	m_pendingReleases[frameIndex].clear();
+
+	// Give blocks at the end of a pool back once they've been empty for a while, the ones in the middle stay so
+	// block indices don't move. Every pool keeps its first block.
+	for (UINT i{ 0 }; i < PoolCount; i++)
+	{
+		std::vector<std::unique_ptr<HeapBlock>>& blocks = m_pools[i].blocks;
+		for (auto& block : blocks)
+		{
+			block->emptyFrames = block->allocator.IsEmpty() ? block->emptyFrames + 1 : 0;
+		}
+		while (blocks.size() > 1 && blocks.back()->emptyFrames > BlockReleaseFrames)
+		{
+			spdlog::info("GPU heap block released, pool {} block {}", i, blocks.size() - 1);
+			blocks.pop_back();
+		}
+	}
+}
+
+UINT GpuHeapAllocator::Defragment(UINT maxMoves, const DefragmentCallback& onMove) {
+
+	// Only default heap buffers and textures, upload memory is cheap to recreate and targets are handled by their owners
+	UINT sourcePool = PoolCount;
+	UINT sourceBlock = 0;
+	UINT64 lowestUsed = ~0ull;
+	for (UINT poolIndex : { static_cast<UINT>(PoolCategoryBuffer), static_cast<UINT>(PoolCategoryTexture) })
+	{
+		const Pool& pool = m_pools[poolIndex];
+		if (pool.blocks.size() < 2)
+		{
+			continue;
+		}
+
+		for (UINT i{ 0 }; i < pool.blocks.size(); i++)
+		{
+			const UINT64 used = pool.blocks[i]->allocator.GetUsedSize();
+			if (!pool.blocks[i]->liveAllocations.empty() && used < lowestUsed)
+			{
+				lowestUsed = used;
+				sourcePool = poolIndex;
+				sourceBlock = i;
+			}
+		}
+	}
+
+	if (sourcePool == PoolCount)
+	{
+		return 0;
+	}
+
+	UINT moves = 0;
+	std::vector<GpuAllocation*>& live = m_pools[sourcePool].blocks[sourceBlock]->liveAllocations;
+	while (moves < maxMoves && !live.empty())
+	{
+		GpuAllocation* allocation = live.back();
+
+		D3D12_RESOURCE_DESC desc = allocation->desc;
+		const D3D12_RESOURCE_ALLOCATION_INFO info = GetAllocationInfo(desc);
+
+		UINT blockIndex;
+		TlsfAllocation placement;
+		if (!AllocatePlacement(sourcePool, info, sourceBlock, blockIndex, placement))
+		{
+			break;
+		}
+
+		ComPtr<ID3D12Resource> newResource;
+		HRESULT hr{ S_OK };
+		DXCall(hr = m_device->CreatePlacedResource(m_pools[sourcePool].blocks[blockIndex]->heap.Get(), placement.offset, &desc,
+			D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&newResource)));
+		if (FAILED(hr))
+		{
+			// Leave it where it is, the old resource is still valid. Trying the rest would most likely fail the same way.
+			spdlog::error("Couldn't create a placed resource to move {} bytes into, stopping the defragment pass", info.SizeInBytes);
+			FreePlacement(sourcePool, blockIndex, placement);
+			break;
+		}
+
+		onMove(*allocation, newResource.Get());
+
+		// The copy reads the old resource on the GPU, so it is released like any other
+		PendingRelease pending;
+		pending.resource = allocation->resource;
+		pending.poolIndex = allocation->poolIndex;
+		pending.blockIndex = allocation->blockIndex;
+		pending.placement = allocation->placement;
+		m_pendingReleases[m_frameIndex].push_back(pending);
+
+		RemoveLive(allocation);
+		allocation->resource = newResource;
+		allocation->blockIndex = blockIndex;
+		allocation->placement = placement;
+		AddLive(allocation);
+
+		moves++;
+	}
+
+	return moves;
+}
+
+GpuHeapStats GpuHeapAllocator::GetStats() const {
+	GpuHeapStats stats;
+	UINT64 freeBytes = 0;
+
+	for (UINT i{ 0 }; i < PoolCount; i++)
+	{
+		for (const auto& block : m_pools[i].blocks)
+		{
+			const TlsfStats blockStats = block->allocator.GetStats();
+			stats.blockCount++;
+			stats.allocationCount += blockStats.allocationCount;
+			stats.totalBytes += blockStats.totalSize;
+			stats.usedBytes += blockStats.usedSize;
+			freeBytes += blockStats.totalSize - blockStats.usedSize;
+			if (blockStats.largestFreeBlock > stats.largestFreeBlock)
+			{
+				stats.largestFreeBlock = blockStats.largestFreeBlock;
+			}
+		}
+	}
+
+	if (freeBytes > 0)
+	{
+		stats.fragmentation = 1.0f - static_cast<float>(static_cast<double>(stats.largestFreeBlock) / static_cast<double>(freeBytes));
+	}
+
+	return stats;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+#include "FrameScheduler.h"
+#include "TlsfAllocator.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// A placed resource living in one of the GpuHeapAllocator blocks
+struct GpuAllocation
+{
+	ComPtr<ID3D12Resource> resource;
+	D3D12_RESOURCE_DESC desc = {};
+	UINT poolIndex = 0;
+	UINT blockIndex = 0;
+	UINT liveIndex = 0;				// Slot in the block's live list, lets the defragmenter find it
+	TlsfAllocation placement;
+};
+
+struct GpuHeapStats
+{
+	UINT blockCount = 0;
+	UINT allocationCount = 0;
+	UINT64 totalBytes = 0;
+	UINT64 usedBytes = 0;
+	UINT64 largestFreeBlock = 0;
+	float fragmentation = 0.0f;
+};
+
+// Sub allocates placed resources out of big ID3D12Heap blocks instead of one committed resource each.
+// Blocks are split into pools by heap type and by buffer / texture / render target so it works on resource heap tier 1.
+// Each block is carved by a TlsfAllocator. Releases are deferred until the frame slot they happened in retires.
+class GpuHeapAllocator {
+	public:
+		static const UINT64 DefaultBlockSize = 64 * 1024 * 1024;
+
+		// Called for every resource Defragment moves. newResource starts in COPY_DEST,
+		// record the copy from allocation.resource and any view updates in here.
+		typedef std::function<void(const GpuAllocation& allocation, ID3D12Resource* newResource)> DefragmentCallback;
+
+	private:
+		enum PoolCategory
+		{
+			PoolCategoryBuffer = 0,
+			PoolCategoryTexture,
+			PoolCategoryRenderTarget,
+			PoolCategoryCount
+		};
+
+		struct HeapBlock
+		{
+			ComPtr<ID3D12Heap> heap;
+			TlsfAllocator allocator;
+			std::vector<GpuAllocation*> liveAllocations;
+			UINT emptyFrames = 0;			// BeginFrames in a row it had nothing in it
+		};
+
+		struct Pool
+		{
+			D3D12_HEAP_TYPE heapType;
+			D3D12_HEAP_FLAGS heapFlags;
+			UINT64 blockAlignment;
+			std::vector<std::unique_ptr<HeapBlock>> blocks;
+		};
+
+		// Placed resources that moved or were released, kept alive until their frame retires
+		struct PendingRelease
+		{
+			ComPtr<ID3D12Resource> resource;
+			UINT poolIndex;
+			UINT blockIndex;
+			TlsfAllocation placement;
+		};
+
+		static const UINT HeapTypeCount = 2;	// Default and upload
+		static const UINT PoolCount = HeapTypeCount * PoolCategoryCount;
+		static const UINT InvalidBlock = 0xFFFFFFFF;
+		// How long an empty block hangs around before it's given back, so a resource that comes and goes every
+		// few frames doesn't create and destroy a heap each time
+		static const UINT BlockReleaseFrames = 120;
+
+		ID3D12Device8* m_device = nullptr;
+		UINT64 m_blockSize = DefaultBlockSize;
+		UINT m_frameIndex = 0;
+		Pool m_pools[PoolCount];
+		std::vector<PendingRelease> m_pendingReleases[FrameScheduler::MaxFramesInFlight];
+
+		static UINT GetPoolIndex(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc);
+		D3D12_RESOURCE_ALLOCATION_INFO GetAllocationInfo(D3D12_RESOURCE_DESC& desc) const;
+		// InvalidBlock if the heap couldn't be created
+		UINT CreateBlock(UINT poolIndex, UINT64 minimumSize);
+		bool AllocatePlacement(UINT poolIndex, const D3D12_RESOURCE_ALLOCATION_INFO& info, UINT excludedBlock,
+			UINT& blockIndex, TlsfAllocation& placement);
+		void AddLive(GpuAllocation* allocation);
+		void RemoveLive(GpuAllocation* allocation);
+		void FreePlacement(UINT poolIndex, UINT blockIndex, const TlsfAllocation& placement);
+
+	public:
+		void Initialize(ID3D12Device8* device, UINT64 blockSize = DefaultBlockSize);
+		void Shutdown();
+
+		// Call once the scheduler has retired frameIndex
+		void BeginFrame(UINT frameIndex);
+
+		// nullptr if there's no memory left for it
+		GpuAllocation* CreateResource(const D3D12_RESOURCE_DESC& desc, D3D12_HEAP_TYPE heapType,
+			D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+		// Deferred, the memory is reused once the current frame has retired
+		void Release(GpuAllocation* allocation);
+
+		// Tries to empty the least occupied default heap block into the others, returns how many resources moved.
+		// Only call while recording a command list the callback can put the copies in.
+		UINT Defragment(UINT maxMoves, const DefragmentCallback& onMove);
+
+		GpuHeapStats GetStats() const;
+};
@@ -0,0 +1,56 @@
+#include "GpuProfiler.h"
+
+void GpuProfiler::Initialize(Profiler* profiler, const char* trackName) {
+	m_profiler = profiler;
+	m_track = profiler->CreateTrack(trackName);
+	m_frameIndex = 0;
+	for (std::vector<const char*>& zones : m_frameZones)
+	{
+		zones.clear();
+		zones.reserve(MaxZonesPerFrame);
+	}
+}
+
+void GpuProfiler::BeginFrame(uint32_t frameIndex) {
+	m_frameIndex = frameIndex;
+	m_frameZones[frameIndex].clear();
+}
+
+uint32_t GpuProfiler::AddZone(const char* name) {
+	std::vector<const char*>& zones = m_frameZones[m_frameIndex];
+	if (!m_profiler->IsCapturing() || zones.size() >= MaxZonesPerFrame)
+	{
+		return InvalidZone;
+	}
+
+	zones.push_back(name);
+	return static_cast<uint32_t>(zones.size() - 1);
+}
+
+void GpuProfiler::ResolveFrame(uint32_t frameIndex, const uint64_t* timestamps, const GpuClockCalibration& calibration) {
+	std::vector<const char*>& zones = m_frameZones[frameIndex];
+
+	if (m_profiler->IsCapturing() && calibration.gpuFrequency > 0)
+	{
+		// Relative to the calibration point, the difference is small enough for a double to stay exact
+		const double nanosecondsPerTick = 1e9 / static_cast<double>(calibration.gpuFrequency);
+		const auto toCpu = [&](uint64_t timestamp) {
+			const int64_t ticks = static_cast<int64_t>(timestamp - calibration.gpuTimestamp);
+			return calibration.cpuTime + static_cast<int64_t>(static_cast<double>(ticks) * nanosecondsPerTick);
+		};
+
+		for (uint32_t zone{ 0 }; zone < zones.size(); zone++)
+		{
+			const uint64_t begin = timestamps[GetBeginQuery(zone)];
+			const uint64_t end = timestamps[GetEndQuery(zone)];
+			// Zero or backwards means the query never ran (device removed, list dropped), nothing to show
+			if (begin == 0 || end < begin)
+			{
+				continue;
+			}
+			m_track->Add(zones[zone], toCpu(begin), toCpu(end));
+		}
+	}
+
+	zones.clear();
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "FrameScheduler.h"
+#include "../Core/Profiler.h"
+#include <cstdint>
+#include <vector>
+
+// Ties a GPU timestamp to the CPU clock, both read at (nearly) the same moment
+struct GpuClockCalibration
+{
+	uint64_t gpuTimestamp = 0;
+	uint64_t gpuFrequency = 0;		// Ticks per second
+	int64_t cpuTime = 0;			// Nanoseconds on the profiler's clock
+};
+
+// Bookkeeping for GPU zones, nothing D3D in here. Zones are declared on one thread while the frame is set up and
+// zone z uses timestamps 2z (begin) and 2z + 1 (end), so recording threads only need the zone index and the
+// resolve knows how many timestamps there are before any list is recorded. Once a frame slot retires its raw
+// timestamps come back through ResolveFrame and go into a profiler track on the CPU timeline.
+// D3D12GpuProfiler does the queries and the readback.
+class GpuProfiler {
+	public:
+		static const uint32_t MaxZonesPerFrame = 256;
+		static const uint32_t InvalidZone = 0xFFFFFFFF;
+
+	private:
+		std::vector<const char*> m_frameZones[FrameScheduler::MaxFramesInFlight];
+		uint32_t m_frameIndex = 0;
+		ProfileTrack* m_track = nullptr;
+		Profiler* m_profiler = nullptr;
+
+	public:
+		void Initialize(Profiler* profiler, const char* trackName);
+
+		// Slot being recorded from now on, its previous contents must have been resolved or are dropped
+		void BeginFrame(uint32_t frameIndex);
+
+		// InvalidZone once the frame is full, skip the queries then
+		uint32_t AddZone(const char* name);
+		static uint32_t GetBeginQuery(uint32_t zone) { return zone * 2; }
+		static uint32_t GetEndQuery(uint32_t zone) { return zone * 2 + 1; }
+
+		uint32_t GetFrameQueryCount(uint32_t frameIndex) const { return static_cast<uint32_t>(m_frameZones[frameIndex].size()) * 2; }
+		uint32_t GetFrameIndex() const { return m_frameIndex; }
+
+		// timestamps holds GetFrameQueryCount(frameIndex) raw ticks, in query order. Clears the slot.
+		void ResolveFrame(uint32_t frameIndex, const uint64_t* timestamps, const GpuClockCalibration& calibration);
+};
@@ -0,0 +1,72 @@
+#include "HeadlessCommandBackend.h"
+#include <cassert>
+
+void HeadlessCommandList::Record(uint32_t opcode, uint64_t payload) {
+	assert(m_recording);
+
+	HeadlessCommand command;
+	command.opcode = opcode;
+	command.listIndex = 0;
+	command.payload = payload;
+	m_allocator->m_memory.push_back(command);
+}
+
+HeadlessCommandBackend::Allocator HeadlessCommandBackend::CreateAllocator() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_allocators.emplace_back(new HeadlessCommandAllocator());
+	return m_allocators.back().get();
+}
+
+void HeadlessCommandBackend::ResetAllocator(Allocator& allocator) {
+	assert(allocator->m_openLists == 0);
+
+	allocator->m_memory.clear();
+	allocator->m_resetCount++;
+}
+
+HeadlessCommandBackend::CommandList HeadlessCommandBackend::CreateCommandList() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_commandLists.emplace_back(new HeadlessCommandList());
+	return m_commandLists.back().get();
+}
+
+void HeadlessCommandBackend::BeginCommandList(CommandList& list, Allocator& allocator) {
+	assert(!list->m_recording);
+	assert(allocator->m_openLists == 0);
+
+	allocator->m_openLists++;
+	list->m_allocator = allocator;
+	list->m_begin = allocator->m_memory.size();
+	list->m_end = list->m_begin;
+	list->m_recording = true;
+}
+
+void HeadlessCommandBackend::CloseCommandList(CommandList& list) {
+	assert(list->m_recording);
+
+	list->m_allocator->m_openLists--;
+	list->m_end = list->m_allocator->m_memory.size();
+	list->m_recording = false;
+}
+
+void HeadlessCommandBackend::ExecuteCommandLists(CommandList* lists, uint32_t count) {
+	m_executeCalls++;
+
+	for (uint32_t i{ 0 }; i < count; i++)
+	{
+		const HeadlessCommandList* list = lists[i];
+		assert(!list->m_recording);
+
+		for (size_t command{ list->m_begin }; command < list->m_end; command++)
+		{
+			HeadlessCommand executed = list->m_allocator->m_memory[command];
+			executed.listIndex = i;
+			m_executed.push_back(executed);
+		}
+	}
+}
+
+uint32_t HeadlessCommandBackend::GetAllocatorCount() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return static_cast<uint32_t>(m_allocators.size());
+}
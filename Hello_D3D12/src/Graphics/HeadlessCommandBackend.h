@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One captured command, what the opcode and payload mean is up to whoever records them
+struct HeadlessCommand
+{
+	uint32_t opcode;
+	uint32_t listIndex;		// Set on execute, which list it was submitted in
+	uint64_t payload;
+};
+
+// Owns the memory its lists record into, like a real command allocator
+class HeadlessCommandAllocator {
+	private:
+		friend class HeadlessCommandBackend;
+		friend class HeadlessCommandList;
+
+		std::vector<HeadlessCommand> m_memory;
+		uint32_t m_openLists = 0;
+		uint32_t m_resetCount = 0;
+
+	public:
+		uint32_t GetResetCount() const { return m_resetCount; }
+};
+
+class HeadlessCommandList {
+	private:
+		friend class HeadlessCommandBackend;
+
+		HeadlessCommandAllocator* m_allocator = nullptr;
+		size_t m_begin = 0;
+		size_t m_end = 0;
+		bool m_recording = false;
+
+	public:
+		void Record(uint32_t opcode, uint64_t payload = 0);
+
+		bool IsRecording() const { return m_recording; }
+		size_t GetCommandCount() const { return m_end - m_begin; }
+};
+
+// ParallelCommandRecorder backend with no GPU behind it. Lists record into their allocator's memory and
+// ExecuteCommandLists appends them to one flat stream, so ordering and threading can be checked on any platform.
+// Misuse that D3D12 would reject (two open lists on one allocator, resetting an allocator with an open list,
+// executing an open list) asserts.
+class HeadlessCommandBackend {
+	public:
+		typedef HeadlessCommandAllocator* Allocator;
+		typedef HeadlessCommandList* CommandList;
+
+	private:
+		std::mutex m_mutex;
+		std::vector<std::unique_ptr<HeadlessCommandAllocator>> m_allocators;
+		std::vector<std::unique_ptr<HeadlessCommandList>> m_commandLists;
+		std::vector<HeadlessCommand> m_executed;
+		uint32_t m_executeCalls = 0;
+
+	public:
+		Allocator CreateAllocator();
+		void ResetAllocator(Allocator& allocator);
+		CommandList CreateCommandList();
+		void BeginCommandList(CommandList& list, Allocator& allocator);
+		void CloseCommandList(CommandList& list);
+		void ExecuteCommandLists(CommandList* lists, uint32_t count);
+
+		// Everything executed so far, in submission order
+		const std::vector<HeadlessCommand>& GetExecutedCommands() const { return m_executed; }
+		void ClearExecutedCommands() { m_executed.clear(); }
+		uint32_t GetExecuteCalls() const { return m_executeCalls; }
+		uint32_t GetAllocatorCount();
+};
@@ -0,0 +1,54 @@
+#include "InstanceCuller.h"
+#include <cstring>
+
+void InstanceCuller::Initialize(JobSystem* jobSystem) {
+	m_jobSystem = jobSystem;
+	m_stats = InstanceCullerStats();
+	m_stats.threadCount = jobSystem->GetThreadCount();
+}
+
+void InstanceCuller::Shutdown() {
+	m_jobSystem = nullptr;
+	m_scratch.clear();
+	m_chunkCounts.clear();
+}
+
+uint32_t InstanceCuller::Cull(const InstanceSet& instances, const Frustum& frustum, float radiusScale, std::vector<uint32_t>& visible) {
+	const uint32_t count = instances.GetCount();
+	const uint32_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+	m_scratch.resize(static_cast<size_t>(chunkCount) * (ChunkSize + CullOutputPadding));
+	m_chunkCounts.resize(chunkCount);
+
+	const float* x = instances.GetPlane(InstanceSet::InstancePlanePositionX);
+	const float* y = instances.GetPlane(InstanceSet::InstancePlanePositionY);
+	const float* z = instances.GetPlane(InstanceSet::InstancePlanePositionZ);
+	const float* scale = instances.GetPlane(InstanceSet::InstancePlaneScale);
+
+	JobCounter counter;
+	m_jobSystem->ParallelFor(chunkCount, 1, [&](uint32_t chunk, uint32_t) {
+		const uint32_t first = chunk * ChunkSize;
+		const uint32_t chunkSize = count - first < ChunkSize ? count - first : ChunkSize;
+		uint32_t* out = m_scratch.data() + static_cast<size_t>(chunk) * (ChunkSize + CullOutputPadding);
+		m_chunkCounts[chunk] = CullSpheres(frustum, x, y, z, scale, radiusScale, first, chunkSize, out);
+	}, &counter);
+	m_jobSystem->Wait(counter);
+
+	// Pack the slices together, chunk order keeps the indices sorted
+	uint32_t visibleCount = 0;
+	for (uint32_t chunk{ 0 }; chunk < chunkCount; chunk++)
+	{
+		visibleCount += m_chunkCounts[chunk];
+	}
+
+	visible.resize(visibleCount);
+	uint32_t* out = visible.data();
+	for (uint32_t chunk{ 0 }; chunk < chunkCount; chunk++)
+	{
+		memcpy(out, m_scratch.data() + static_cast<size_t>(chunk) * (ChunkSize + CullOutputPadding), m_chunkCounts[chunk] * sizeof(uint32_t));
+		out += m_chunkCounts[chunk];
+	}
+
+	m_stats.tested = count;
+	m_stats.visible = visibleCount;
+	return visibleCount;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "FrustumCull.h"
+#include "InstanceSet.h"
+#include "../Core/JobSystem.h"
+#include <vector>
+
+struct InstanceCullerStats
+{
+	uint32_t threadCount = 0;
+	uint32_t tested = 0;
+	uint32_t visible = 0;
+};
+
+// Frustum culls an InstanceSet into a compacted list of visible indices, in ascending order.
+// The set is cut into fixed size chunks, each one a job on the JobSystem that culls into its own slice of a
+// scratch list, the slices are then packed together on the calling thread. One Cull at a time.
+class InstanceCuller {
+	public:
+		static const uint32_t ChunkSize = 4096;
+
+	private:
+		JobSystem* m_jobSystem = nullptr;
+		std::vector<uint32_t> m_scratch;			// ChunkSize + CullOutputPadding per chunk
+		std::vector<uint32_t> m_chunkCounts;
+		InstanceCullerStats m_stats;
+
+	public:
+		void Initialize(JobSystem* jobSystem);
+		void Shutdown();
+
+		// radiusScale turns an instance's scale into its bounding radius (the mesh's radius at scale 1).
+		// visible is overwritten, returns its size.
+		uint32_t Cull(const InstanceSet& instances, const Frustum& frustum, float radiusScale, std::vector<uint32_t>& visible);
+
+		const InstanceCullerStats& GetStats() const { return m_stats; }
+};
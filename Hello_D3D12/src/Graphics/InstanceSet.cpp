@@ -0,0 +1,59 @@
+#include "InstanceSet.h"
+#include <cstring>
+
+void InstanceSet::Reserve(uint32_t count) {
+	for (std::vector<float>& plane : m_planes)
+	{
+		plane.reserve(count);
+	}
+	m_velocityX.reserve(count);
+	m_velocityY.reserve(count);
+}
+
+void InstanceSet::Clear() {
+	for (std::vector<float>& plane : m_planes)
+	{
+		plane.clear();
+	}
+	m_velocityX.clear();
+	m_velocityY.clear();
+}
+
+uint32_t InstanceSet::Add(float x, float y, float z, float scale, float velocityX, float velocityY) {
+	const uint32_t index = GetCount();
+	m_planes[InstancePlanePositionX].push_back(x);
+	m_planes[InstancePlanePositionY].push_back(y);
+	m_planes[InstancePlanePositionZ].push_back(z);
+	m_planes[InstancePlaneScale].push_back(scale);
+	m_velocityX.push_back(velocityX);
+	m_velocityY.push_back(velocityY);
+	return index;
+}
+
+void InstanceSet::Animate(float bounds) {
+	const uint32_t count = GetCount();
+	float* x = m_planes[InstancePlanePositionX].data();
+	float* y = m_planes[InstancePlanePositionY].data();
+	const float* velocityX = m_velocityX.data();
+	const float* velocityY = m_velocityY.data();
+
+	// Branch free wrap so the compiler can vectorise it
+	for (uint32_t i{ 0 }; i < count; i++)
+	{
+		const float newX = x[i] + velocityX[i];
+		const float newY = y[i] + velocityY[i];
+		x[i] = newX > bounds ? newX - 2.0f * bounds : newX;
+		y[i] = newY > bounds ? newY - 2.0f * bounds : newY;
+	}
+}
+
+void InstanceSet::Pack(void* destination) const {
+	const size_t planeSize = GetCount() * sizeof(float);
+	uint8_t* out = static_cast<uint8_t*>(destination);
+
+	for (const std::vector<float>& plane : m_planes)
+	{
+		memcpy(out, plane.data(), planeSize);
+		out += planeSize;
+	}
+}
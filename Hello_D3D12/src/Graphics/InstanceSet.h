@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Per instance data kept as structure of arrays, one tightly packed plane per field. The GPU reads the same
+// layout (InstancePlane order, GetCount floats per plane) so packing a frame is one memcpy per plane straight
+// into the upload ring, no per instance shuffling. Velocity is CPU only, it never goes up.
+class InstanceSet {
+	public:
+		enum InstancePlane
+		{
+			InstancePlanePositionX = 0,
+			InstancePlanePositionY,
+			InstancePlanePositionZ,
+			InstancePlaneScale,
+			InstancePlaneCount
+		};
+
+	private:
+		std::vector<float> m_planes[InstancePlaneCount];
+		std::vector<float> m_velocityX;
+		std::vector<float> m_velocityY;
+
+	public:
+		void Reserve(uint32_t count);
+		void Clear();
+		uint32_t Add(float x, float y, float z, float scale, float velocityX, float velocityY);
+
+		// Moves everything by its velocity, wrapping at +-bounds like the old node offsets did
+		void Animate(float bounds);
+
+		uint64_t GetPackedSize() const { return GetPackedSize(GetCount()); }
+		static uint64_t GetPackedSize(uint32_t count) { return static_cast<uint64_t>(count) * InstancePlaneCount * sizeof(float); }
+		// destination needs GetPackedSize bytes. Only writes, in order, so it's fine on write combined memory.
+		void Pack(void* destination) const;
+
+		uint32_t GetCount() const { return static_cast<uint32_t>(m_planes[0].size()); }
+		const float* GetPlane(InstancePlane plane) const { return m_planes[plane].data(); }
+		float* GetPlane(InstancePlane plane) { return m_planes[plane].data(); }
+};
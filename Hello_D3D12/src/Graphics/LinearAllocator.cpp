@@ -0,0 +1,87 @@
+#include "LinearAllocator.h"
+#include <cassert>
+
+LinearAllocator::LinearAllocator() {
+	m_cpuBase = nullptr;
+	m_gpuBase = 0;
+	m_capacity = 0;
+	m_offset.store(0, std::memory_order_relaxed);
+}
+
+void LinearAllocator::Initialize(uint8_t* cpuBase, uint64_t gpuBase, uint64_t capacity) {
+	m_cpuBase = cpuBase;
+	m_gpuBase = gpuBase;
+	m_capacity = capacity;
+	m_offset.store(0, std::memory_order_relaxed);
+}
+
+bool LinearAllocator::Allocate(uint64_t size, uint64_t alignment, LinearAllocation& allocation) {
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	// CAS loop instead of a plain fetch_add so mixed alignments don't leave the offset past the end on failure
+	uint64_t current = m_offset.load(std::memory_order_relaxed);
+	uint64_t alignedOffset;
+	do
+	{
+		alignedOffset = (current + alignment - 1) & ~(alignment - 1);
+		if (alignedOffset + size > m_capacity)
+		{
+			return false;
+		}
+	} while (!m_offset.compare_exchange_weak(current, alignedOffset + size, std::memory_order_relaxed));
+
+	allocation.cpuAddress = m_cpuBase + alignedOffset;
+	allocation.gpuAddress = m_gpuBase + alignedOffset;
+	allocation.offset = alignedOffset;
+	allocation.size = size;
+	return true;
+}
+
+void LinearAllocator::Reset() {
+	m_offset.store(0, std::memory_order_relaxed);
+}
+
+FrameUploadAllocator::FrameUploadAllocator() {
+	m_framesInFlight = 0;
+	m_frameIndex = 0;
+	m_peakUsed = 0;
+	m_failedAllocations.store(0, std::memory_order_relaxed);
+}
+
+void FrameUploadAllocator::Initialize(uint8_t* cpuBase, uint64_t gpuBase, uint64_t capacityPerFrame, uint32_t framesInFlight) {
+	assert(framesInFlight > 0 && framesInFlight <= FrameScheduler::MaxFramesInFlight);
+	// Keep every frame range starting on a constant buffer boundary
+	assert((capacityPerFrame % ConstantBufferAlignment) == 0);
+
+	m_framesInFlight = framesInFlight;
+	m_frameIndex = 0;
+
+	for (uint32_t i{ 0 }; i < framesInFlight; i++)
+	{
+		const uint64_t frameOffset = capacityPerFrame * i;
+		m_frames[i].Initialize(cpuBase + frameOffset, gpuBase + frameOffset, capacityPerFrame);
+	}
+}
+
+void FrameUploadAllocator::BeginFrame(uint32_t frameIndex) {
+	assert(frameIndex < m_framesInFlight);
+
+	// The range being recycled is final now, so this is the one place the peak can be read without racing
+	const uint64_t used = m_frames[frameIndex].GetUsed();
+	if (used > m_peakUsed)
+	{
+		m_peakUsed = used;
+	}
+
+	m_frameIndex = frameIndex;
+	m_frames[frameIndex].Reset();
+}
+
+bool FrameUploadAllocator::Allocate(uint64_t size, uint64_t alignment, LinearAllocation& allocation) {
+	if (!m_frames[m_frameIndex].Allocate(size, alignment, allocation))
+	{
+		m_failedAllocations.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "FrameScheduler.h"
+
+// Slice of a mapped upload buffer handed out by the linear allocators
+struct LinearAllocation
+{
+	uint8_t* cpuAddress = nullptr;
+	uint64_t gpuAddress = 0;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+// Lock free bump allocator over a fixed range of a persistently mapped buffer.
+// It knows nothing about D3D, it just gets a cpu pointer and the matching gpu address for the start of the range.
+// Nothing is freed individually, the whole range is reset at once.
+class LinearAllocator {
+	private:
+		uint8_t* m_cpuBase;
+		uint64_t m_gpuBase;
+		uint64_t m_capacity;
+		std::atomic<uint64_t> m_offset;
+
+	public:
+		LinearAllocator();
+		LinearAllocator(const LinearAllocator&) = delete;
+		LinearAllocator& operator=(const LinearAllocator&) = delete;
+
+		void Initialize(uint8_t* cpuBase, uint64_t gpuBase, uint64_t capacity);
+
+		// Alignment must be a power of two. Returns false when the range is exhausted.
+		bool Allocate(uint64_t size, uint64_t alignment, LinearAllocation& allocation);
+		void Reset();
+
+		uint64_t GetUsed() const { return m_offset.load(std::memory_order_relaxed); }
+		uint64_t GetCapacity() const { return m_capacity; }
+};
+
+// One linear range per frame in flight, carved out of one big upload buffer.
+// A frame's range is only reset in BeginFrame, which must be called once the FrameScheduler says the GPU has
+// retired that slot. Allocate is safe to call from several threads between BeginFrame calls.
+class FrameUploadAllocator {
+	public:
+		// Same as D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, kept here so the core stays backend agnostic
+		static const uint64_t ConstantBufferAlignment = 256;
+
+	private:
+		LinearAllocator m_frames[FrameScheduler::MaxFramesInFlight];
+		uint32_t m_framesInFlight;
+		uint32_t m_frameIndex;
+		uint64_t m_peakUsed;
+		std::atomic<uint64_t> m_failedAllocations;
+
+	public:
+		FrameUploadAllocator();
+
+		void Initialize(uint8_t* cpuBase, uint64_t gpuBase, uint64_t capacityPerFrame, uint32_t framesInFlight);
+		void BeginFrame(uint32_t frameIndex);
+
+		bool Allocate(uint64_t size, uint64_t alignment, LinearAllocation& allocation);
+
+		// Copies the data into a 256 byte aligned slice ready to be bound as a CBV
+		template<typename T>
+		bool AllocateConstants(const T& data, LinearAllocation& allocation)
+		{
+			if (!Allocate(sizeof(T), ConstantBufferAlignment, allocation))
+			{
+				return false;
+			}
+
+			memcpy(allocation.cpuAddress, &data, sizeof(T));
+			return true;
+		}
+
+		uint64_t GetUsed() const { return m_frames[m_frameIndex].GetUsed(); }
+		uint64_t GetCapacityPerFrame() const { return m_frames[m_frameIndex].GetCapacity(); }
+		uint64_t GetPeakUsed() const { return m_peakUsed; }
+		uint64_t GetFailedAllocations() const { return m_failedAllocations.load(std::memory_order_relaxed); }
+};
@@ -0,0 +1,646 @@
+#include "MipChain.h"
+#include "../Core/BitUtils.h"
+#include "../Core/JobSystem.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+	// Every filter works on rows of linear float RGBA, the formats are decoded into that and encoded back out of it
+
+	// Destination pixels [0, width) from source rows row0 and row1, sourceWidth pixels wide
+	typedef void(*BoxRowFunction)(const float* row0, const float* row1, uint32_t sourceWidth, float* out, uint32_t width);
+	// out[i] = sum of weights[k] * rows[k][i], floatCount floats
+	typedef void(*WeightedSumFunction)(const float* const* rows, const float* weights, uint32_t rowCount, float* out, uint32_t floatCount);
+	// Horizontal half of the Kaiser filter, destination pixels [0, width)
+	typedef void(*KaiserRowFunction)(const float* row, uint32_t sourceWidth, const float* weights, float* out, uint32_t width);
+	// RGBA8 without sRGB, pixelCount pixels
+	typedef void(*DecodeUnorm8Function)(const uint8_t* in, float* out, uint32_t pixelCount);
+	typedef void(*EncodeUnorm8Function)(const float* in, uint8_t* out, uint32_t pixelCount);
+	// RGBA16F
+	typedef void(*DecodeHalfFunction)(const uint8_t* in, float* out, uint32_t pixelCount);
+	typedef void(*EncodeHalfFunction)(const float* in, uint8_t* out, uint32_t pixelCount);
+
+	struct KernelTable
+	{
+		SimdLevel level;
+		BoxRowFunction boxRow;
+		WeightedSumFunction weightedSum;
+		KaiserRowFunction kaiserRow;
+		DecodeUnorm8Function decodeUnorm8;
+		EncodeUnorm8Function encodeUnorm8;
+		DecodeHalfFunction decodeHalf;
+		EncodeHalfFunction encodeHalf;
+	};
+
+	static const uint32_t KaiserTaps = 6;
+	static const uint32_t KaiserTapOffset = 2;		// Destination pixel x covers source pixels 2x - 2 to 2x + 3
+
+	float BesselI0(float x) {
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (uint32_t k{ 1 }; k < 20; k++)
+		{
+			term *= (x * 0.5f) / static_cast<float>(k);
+			sum += term * term;
+		}
+		return sum;
+	}
+
+	struct KaiserWeights
+	{
+		float weights[KaiserTaps];
+
+		// Sinc at half the source rate, Kaiser window (alpha 4) over 3 source pixels either side, taps at
+		// -2.5 to 2.5 source pixels from the destination pixel's center. Normalised so flat areas stay flat.
+		KaiserWeights()
+		{
+			const float pi = 3.14159265358979f;
+			const float alpha = 4.0f;
+			const float radius = 3.0f;
+			float sum = 0.0f;
+			for (uint32_t k{ 0 }; k < KaiserTaps; k++)
+			{
+				const float distance = static_cast<float>(k) - 2.5f;
+				const float x = pi * distance * 0.5f;
+				const float sinc = sinf(x) / x;
+				const float t = distance / radius;
+				const float window = BesselI0(alpha * sqrtf(1.0f - t * t)) / BesselI0(alpha);
+				weights[k] = sinc * window;
+				sum += weights[k];
+			}
+			for (float& weight : weights)
+			{
+				weight /= sum;
+			}
+		}
+	};
+
+	const float* GetKaiserWeights() {
+		static const KaiserWeights kaiser;
+		return kaiser.weights;
+	}
+
+	// sRGB <-> linear. Decoding is exact, encoding goes through 4096 evenly spaced linear steps, which is within a
+	// step of exact everywhere
+	struct SrgbTables
+	{
+		static const uint32_t EncodeSteps = 4096;
+
+		float toLinear[256];
+		uint8_t toSrgb[EncodeSteps];
+
+		SrgbTables()
+		{
+			for (uint32_t i{ 0 }; i < 256; i++)
+			{
+				const float srgb = static_cast<float>(i) / 255.0f;
+				toLinear[i] = srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+			}
+			for (uint32_t i{ 0 }; i < EncodeSteps; i++)
+			{
+				const float linear = static_cast<float>(i) / static_cast<float>(EncodeSteps - 1);
+				const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = static_cast<uint8_t>(srgb * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	const SrgbTables& GetSrgbTables() {
+		static const SrgbTables tables;
+		return tables;
+	}
+
+	float Saturate(float value) {
+		return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+	}
+
+	void DecodeSrgb8(const uint8_t* in, float* out, uint32_t pixelCount) {
+		const float* toLinear = GetSrgbTables().toLinear;
+		for (uint32_t i{ 0 }; i < pixelCount; i++)
+		{
+			out[i * 4 + 0] = toLinear[in[i * 4 + 0]];
+			out[i * 4 + 1] = toLinear[in[i * 4 + 1]];
+			out[i * 4 + 2] = toLinear[in[i * 4 + 2]];
+			out[i * 4 + 3] = static_cast<float>(in[i * 4 + 3]) * (1.0f / 255.0f);
+		}
+	}
+
+	void EncodeSrgb8(const float* in, uint8_t* out, uint32_t pixelCount) {
+		const uint8_t* toSrgb = GetSrgbTables().toSrgb;
+		const float steps = static_cast<float>(SrgbTables::EncodeSteps - 1);
+		for (uint32_t i{ 0 }; i < pixelCount; i++)
+		{
+			out[i * 4 + 0] = toSrgb[static_cast<uint32_t>(Saturate(in[i * 4 + 0]) * steps + 0.5f)];
+			out[i * 4 + 1] = toSrgb[static_cast<uint32_t>(Saturate(in[i * 4 + 1]) * steps + 0.5f)];
+			out[i * 4 + 2] = toSrgb[static_cast<uint32_t>(Saturate(in[i * 4 + 2]) * steps + 0.5f)];
+			out[i * 4 + 3] = static_cast<uint8_t>(Saturate(in[i * 4 + 3]) * 255.0f + 0.5f);
+		}
+	}
+
+	// IEEE half <-> float, round to nearest even. What F16C does, for CPUs below the AVX2 level.
+	float HalfToFloat(uint16_t half) {
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		const uint32_t exponent = (half >> 10) & 0x1F;
+		const uint32_t mantissa = half & 0x3FF;
+
+		uint32_t bits;
+		if (exponent == 0)
+		{
+			// Zero or denormal, mantissa * 2^-24
+			const float value = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+			memcpy(&bits, &value, sizeof(bits));
+			bits |= sign;
+		}
+		else if (exponent == 31)
+		{
+			bits = sign | 0x7F800000 | (mantissa << 13);
+		}
+		else
+		{
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		}
+
+		float result;
+		memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	uint16_t FloatToHalf(float value) {
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t magnitude = bits & 0x7FFFFFFF;
+
+		if (magnitude >= 0x7F800000)
+		{
+			return static_cast<uint16_t>(sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00));
+		}
+		if (magnitude >= 0x47800000)
+		{
+			return static_cast<uint16_t>(sign | 0x7C00);
+		}
+		if (magnitude < 0x38800000)
+		{
+			// Below the smallest normal half, counted in steps of 2^-24
+			float absolute;
+			memcpy(&absolute, &magnitude, sizeof(absolute));
+			return static_cast<uint16_t>(sign | static_cast<uint32_t>(std::nearbyint(absolute * 16777216.0f)));
+		}
+
+		// Rebias the exponent and round the 13 dropped bits to nearest even, a carry out of the mantissa rounds
+		// up into the exponent (up to infinity) as it should
+		const uint32_t odd = (magnitude >> 13) & 1;
+		magnitude += 0xC8000FFF + odd;
+		return static_cast<uint16_t>(sign | (magnitude >> 13));
+	}
+
+	void DecodeHalfScalar(const uint8_t* in, float* out, uint32_t pixelCount) {
+		const uint16_t* halves = reinterpret_cast<const uint16_t*>(in);
+		for (uint32_t i{ 0 }; i < pixelCount * 4; i++)
+		{
+			out[i] = HalfToFloat(halves[i]);
+		}
+	}
+
+	void EncodeHalfScalar(const float* in, uint8_t* out, uint32_t pixelCount) {
+		uint16_t* halves = reinterpret_cast<uint16_t*>(out);
+		for (uint32_t i{ 0 }; i < pixelCount * 4; i++)
+		{
+			halves[i] = FloatToHalf(in[i]);
+		}
+	}
+
+	// Scalar, also the edges and tails of the SIMD kernels
+
+	void BoxPixelsScalar(const float* row0, const float* row1, uint32_t sourceWidth, float* out, uint32_t begin, uint32_t end) {
+		for (uint32_t x{ begin }; x < end; x++)
+		{
+			const uint32_t left = x * 2;
+			const uint32_t right = left + 1 < sourceWidth ? left + 1 : sourceWidth - 1;
+			for (uint32_t channel{ 0 }; channel < 4; channel++)
+			{
+				out[x * 4 + channel] = (row0[left * 4 + channel] + row0[right * 4 + channel] + row1[left * 4 + channel] + row1[right * 4 + channel]) * 0.25f;
+			}
+		}
+	}
+
+	void BoxRowScalar(const float* row0, const float* row1, uint32_t sourceWidth, float* out, uint32_t width) {
+		BoxPixelsScalar(row0, row1, sourceWidth, out, 0, width);
+	}
+
+	void WeightedSumScalar(const float* const* rows, const float* weights, uint32_t rowCount, float* out, uint32_t floatCount) {
+		for (uint32_t i{ 0 }; i < floatCount; i++)
+		{
+			float sum = 0.0f;
+			for (uint32_t k{ 0 }; k < rowCount; k++)
+			{
+				sum += weights[k] * rows[k][i];
+			}
+			out[i] = sum;
+		}
+	}
+
+	void KaiserPixelsScalar(const float* row, uint32_t sourceWidth, const float* weights, float* out, uint32_t begin, uint32_t end) {
+		for (uint32_t x{ begin }; x < end; x++)
+		{
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (uint32_t k{ 0 }; k < KaiserTaps; k++)
+			{
+				const int32_t tap = static_cast<int32_t>(x * 2 + k) - static_cast<int32_t>(KaiserTapOffset);
+				const uint32_t source = tap < 0 ? 0 : (static_cast<uint32_t>(tap) >= sourceWidth ? sourceWidth - 1 : static_cast<uint32_t>(tap));
+				for (uint32_t channel{ 0 }; channel < 4; channel++)
+				{
+					sum[channel] += weights[k] * row[source * 4 + channel];
+				}
+			}
+			memcpy(out + x * 4, sum, sizeof(sum));
+		}
+	}
+
+	void KaiserRowScalar(const float* row, uint32_t sourceWidth, const float* weights, float* out, uint32_t width) {
+		KaiserPixelsScalar(row, sourceWidth, weights, out, 0, width);
+	}
+
+	void DecodeUnorm8Scalar(const uint8_t* in, float* out, uint32_t pixelCount) {
+		for (uint32_t i{ 0 }; i < pixelCount * 4; i++)
+		{
+			out[i] = static_cast<float>(in[i]) * (1.0f / 255.0f);
+		}
+	}
+
+	void EncodeUnorm8Scalar(const float* in, uint8_t* out, uint32_t pixelCount) {
+		for (uint32_t i{ 0 }; i < pixelCount * 4; i++)
+		{
+			out[i] = static_cast<uint8_t>(Saturate(in[i]) * 255.0f + 0.5f);
+		}
+	}
+
+#ifdef CPU_FEATURES_X86
+
+	// SSE2, one RGBA pixel is one register
+
+	void BoxRowSse2(const float* row0, const float* row1, uint32_t sourceWidth, float* out, uint32_t width) {
+		const __m128 quarter = _mm_set1_ps(0.25f);
+		// Only pixels whose right source pixel exists, a 1 wide source goes through the scalar clamp
+		const uint32_t simdWidth = sourceWidth / 2 < width ? sourceWidth / 2 : width;
+		for (uint32_t x{ 0 }; x < simdWidth; x++)
+		{
+			const __m128 top = _mm_add_ps(_mm_loadu_ps(row0 + x * 8), _mm_loadu_ps(row0 + x * 8 + 4));
+			const __m128 bottom = _mm_add_ps(_mm_loadu_ps(row1 + x * 8), _mm_loadu_ps(row1 + x * 8 + 4));
+			_mm_storeu_ps(out + x * 4, _mm_mul_ps(_mm_add_ps(top, bottom), quarter));
+		}
+		BoxPixelsScalar(row0, row1, sourceWidth, out, simdWidth, width);
+	}
+
+	void WeightedSumSse2(const float* const* rows, const float* weights, uint32_t rowCount, float* out, uint32_t floatCount) {
+		uint32_t i{ 0 };
+		for (; i + 4 <= floatCount; i += 4)
+		{
+			__m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(rows[0] + i));
+			for (uint32_t k{ 1 }; k < rowCount; k++)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + i)));
+			}
+			_mm_storeu_ps(out + i, sum);
+		}
+
+		const float* tails[KaiserTaps];
+		for (uint32_t k{ 0 }; k < rowCount; k++)
+		{
+			tails[k] = rows[k] + i;
+		}
+		WeightedSumScalar(tails, weights, rowCount, out + i, floatCount - i);
+	}
+
+	void KaiserRowSse2(const float* row, uint32_t sourceWidth, const float* weights, float* out, uint32_t width) {
+		__m128 weight[KaiserTaps];
+		for (uint32_t k{ 0 }; k < KaiserTaps; k++)
+		{
+			weight[k] = _mm_set1_ps(weights[k]);
+		}
+
+		// Pixels whose taps all land inside the row, x >= 1 and 2x + 3 < sourceWidth
+		const uint32_t first = width < 1 ? width : 1;
+		const uint32_t last = sourceWidth >= 4 ? (sourceWidth - 4) / 2 + 1 : first;
+		const uint32_t end = last < width ? (last > first ? last : first) : width;
+
+		KaiserPixelsScalar(row, sourceWidth, weights, out, 0, first);
+		for (uint32_t x{ first }; x < end; x++)
+		{
+			const float* taps = row + (x * 2 - KaiserTapOffset) * 4;
+			__m128 sum = _mm_mul_ps(weight[0], _mm_loadu_ps(taps));
+			sum = _mm_add_ps(sum, _mm_mul_ps(weight[1], _mm_loadu_ps(taps + 4)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(weight[2], _mm_loadu_ps(taps + 8)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(weight[3], _mm_loadu_ps(taps + 12)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(weight[4], _mm_loadu_ps(taps + 16)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(weight[5], _mm_loadu_ps(taps + 20)));
+			_mm_storeu_ps(out + x * 4, sum);
+		}
+		KaiserPixelsScalar(row, sourceWidth, weights, out, end, width);
+	}
+
+	void DecodeUnorm8Sse2(const uint8_t* in, float* out, uint32_t pixelCount) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+		uint32_t i{ 0 };
+		for (; i + 4 <= pixelCount; i += 4)
+		{
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 4));
+			const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+			const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_ps(out + i * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+			_mm_storeu_ps(out + i * 4 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+			_mm_storeu_ps(out + i * 4 + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+			_mm_storeu_ps(out + i * 4 + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+		}
+		DecodeUnorm8Scalar(in + i * 4, out + i * 4, pixelCount - i);
+	}
+
+	// The packs saturate, which is the clamp to 0..255
+	void EncodeUnorm8Sse2(const float* in, uint8_t* out, uint32_t pixelCount) {
+		const __m128 scale = _mm_set1_ps(255.0f);
+		uint32_t i{ 0 };
+		for (; i + 4 <= pixelCount; i += 4)
+		{
+			const __m128i pixel0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i * 4), scale));
+			const __m128i pixel1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i * 4 + 4), scale));
+			const __m128i pixel2 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i * 4 + 8), scale));
+			const __m128i pixel3 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i * 4 + 12), scale));
+			const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(pixel0, pixel1), _mm_packs_epi32(pixel2, pixel3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), packed);
+		}
+		EncodeUnorm8Scalar(in + i * 4, out + i * 4, pixelCount - i);
+	}
+
+	// AVX2 + FMA, two pixels a register
+
+	// Rows hold pixels 2x and 2x + 1 in one register and 2x + 2, 2x + 3 in the next, the lane swap puts the left
+	// and right halves of both destination pixels side by side
+	SIMD_TARGET_AVX2 void BoxRowAvx2(const float* row0, const float* row1, uint32_t sourceWidth, float* out, uint32_t width) {
+		const __m256 quarter = _mm256_set1_ps(0.25f);
+		const uint32_t simdWidth = sourceWidth / 2 < width ? sourceWidth / 2 : width;
+		uint32_t x{ 0 };
+		for (; x + 2 <= simdWidth; x += 2)
+		{
+			const __m256 sum01 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8), _mm256_loadu_ps(row1 + x * 8));
+			const __m256 sum23 = _mm256_add_ps(_mm256_loadu_ps(row0 + x * 8 + 8), _mm256_loadu_ps(row1 + x * 8 + 8));
+			const __m256 left = _mm256_permute2f128_ps(sum01, sum23, 0x20);
+			const __m256 right = _mm256_permute2f128_ps(sum01, sum23, 0x31);
+			_mm256_storeu_ps(out + x * 4, _mm256_mul_ps(_mm256_add_ps(left, right), quarter));
+		}
+		BoxPixelsScalar(row0, row1, sourceWidth, out, x, width);
+	}
+
+	SIMD_TARGET_AVX2 void WeightedSumAvx2(const float* const* rows, const float* weights, uint32_t rowCount, float* out, uint32_t floatCount) {
+		uint32_t i{ 0 };
+		for (; i + 8 <= floatCount; i += 8)
+		{
+			__m256 sum = _mm256_mul_ps(_mm256_set1_ps(weights[0]), _mm256_loadu_ps(rows[0] + i));
+			for (uint32_t k{ 1 }; k < rowCount; k++)
+			{
+				sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i), sum);
+			}
+			_mm256_storeu_ps(out + i, sum);
+		}
+
+		const float* tails[KaiserTaps];
+		for (uint32_t k{ 0 }; k < rowCount; k++)
+		{
+			tails[k] = rows[k] + i;
+		}
+		WeightedSumSse2(tails, weights, rowCount, out + i, floatCount - i);
+	}
+
+	SIMD_TARGET_AVX2 void DecodeHalfAvx2(const uint8_t* in, float* out, uint32_t pixelCount) {
+		uint32_t i{ 0 };
+		for (; i + 2 <= pixelCount; i += 2)
+		{
+			_mm256_storeu_ps(out + i * 4, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 8))));
+		}
+		DecodeHalfScalar(in + i * 8, out + i * 4, pixelCount - i);
+	}
+
+	SIMD_TARGET_AVX2 void EncodeHalfAvx2(const float* in, uint8_t* out, uint32_t pixelCount) {
+		uint32_t i{ 0 };
+		for (; i + 2 <= pixelCount; i += 2)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 8), _mm256_cvtps_ph(_mm256_loadu_ps(in + i * 4), _MM_FROUND_TO_NEAREST_INT));
+		}
+		EncodeHalfScalar(in + i * 4, out + i * 8, pixelCount - i);
+	}
+
+#endif
+
+	KernelTable MakeKernelTable(SimdLevel level) {
+		KernelTable table = { SimdLevel::Scalar, BoxRowScalar, WeightedSumScalar, KaiserRowScalar, DecodeUnorm8Scalar, EncodeUnorm8Scalar,
+			DecodeHalfScalar, EncodeHalfScalar };
+#ifdef CPU_FEATURES_X86
+		if (level >= SimdLevel::SSE2)
+		{
+			table = { SimdLevel::SSE2, BoxRowSse2, WeightedSumSse2, KaiserRowSse2, DecodeUnorm8Sse2, EncodeUnorm8Sse2,
+				DecodeHalfScalar, EncodeHalfScalar };
+		}
+		// The horizontal Kaiser taps are a pixel apart, two destination pixels don't share a load so it stays SSE2.
+		// AVX-512 runs these too, the rows are memory bound.
+		if (level >= SimdLevel::AVX2)
+		{
+			table = { SimdLevel::AVX2, BoxRowAvx2, WeightedSumAvx2, KaiserRowSse2, DecodeUnorm8Sse2, EncodeUnorm8Sse2,
+				DecodeHalfAvx2, EncodeHalfAvx2 };
+		}
+#endif
+		return table;
+	}
+
+	const KernelTable& GetKernels() {
+		static const SimdKernelTables<KernelTable> tables(MakeKernelTable);
+		return tables.Get();
+	}
+
+	// Decoded source rows for one tile. Consecutive destination rows move two source rows down and the Kaiser
+	// filter spans six, so eight slots keep every row decoded once.
+	class DecodedRows {
+		public:
+			static const uint32_t SlotCount = 8;
+
+		private:
+			const MipChainDesc& m_desc;
+			const KernelTable& m_kernels;
+			const uint8_t* m_source;
+			const MipFootprint& m_footprint;
+			std::vector<float> m_rows;
+			uint32_t m_tags[SlotCount];
+
+		public:
+			DecodedRows(const MipChainDesc& desc, const KernelTable& kernels, const uint8_t* source, const MipFootprint& footprint) :
+				m_desc(desc), m_kernels(kernels), m_source(source), m_footprint(footprint)
+			{
+				// Float rows are read in place
+				if (desc.format != MipFormat::RGBA32F)
+				{
+					m_rows.resize(static_cast<size_t>(SlotCount) * footprint.width * 4);
+				}
+				for (uint32_t& tag : m_tags)
+				{
+					tag = 0xFFFFFFFF;
+				}
+			}
+
+			const float* Get(uint32_t row)
+			{
+				const uint8_t* data = m_source + static_cast<uint64_t>(row) * m_footprint.rowPitch;
+				if (m_desc.format == MipFormat::RGBA32F)
+				{
+					return reinterpret_cast<const float*>(data);
+				}
+
+				const uint32_t slot = row & (SlotCount - 1);
+				float* decoded = m_rows.data() + static_cast<size_t>(slot) * m_footprint.width * 4;
+				if (m_tags[slot] != row)
+				{
+					if (m_desc.format == MipFormat::RGBA16F)
+					{
+						m_kernels.decodeHalf(data, decoded, m_footprint.width);
+					}
+					else if (m_desc.srgb)
+					{
+						DecodeSrgb8(data, decoded, m_footprint.width);
+					}
+					else
+					{
+						m_kernels.decodeUnorm8(data, decoded, m_footprint.width);
+					}
+					m_tags[slot] = row;
+				}
+				return decoded;
+			}
+	};
+
+	uint32_t ClampRow(int32_t row, uint32_t height) {
+		return row < 0 ? 0 : (static_cast<uint32_t>(row) >= height ? height - 1 : static_cast<uint32_t>(row));
+	}
+}
+
+uint32_t GetMipPixelSize(MipFormat format) {
+	switch (format)
+	{
+	case MipFormat::RGBA16F:
+		return 8;
+	case MipFormat::RGBA32F:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+	const uint32_t largest = width > height ? width : height;
+	return largest == 0 ? 0 : FindHighestSetBit(largest) + 1;
+}
+
+uint64_t ComputeMipFootprints(MipFormat format, uint32_t width, uint32_t height, uint32_t levelCount, MipFootprint* footprints) {
+	const uint32_t pixelSize = GetMipPixelSize(format);
+	uint64_t offset = 0;
+	uint64_t totalSize = 0;
+	for (uint32_t level{ 0 }; level < levelCount; level++)
+	{
+		MipFootprint& footprint = footprints[level];
+		footprint.width = width >> level > 0 ? width >> level : 1;
+		footprint.height = height >> level > 0 ? height >> level : 1;
+		footprint.rowPitch = static_cast<uint32_t>(AlignUp(static_cast<uint64_t>(footprint.width) * pixelSize, MipFootprintPitchAlignment));
+		footprint.offset = AlignUp(offset, MipFootprintPlacementAlignment);
+
+		// The last row doesn't count its padding, same as GetCopyableFootprints' total
+		totalSize = footprint.offset + static_cast<uint64_t>(footprint.rowPitch) * (footprint.height - 1) + static_cast<uint64_t>(footprint.width) * pixelSize;
+		offset = totalSize;
+	}
+	return totalSize;
+}
+
+void GenerateMipLevel(const MipChainDesc& desc, const uint8_t* source, const MipFootprint& sourceFootprint,
+	uint8_t* destination, const MipFootprint& destinationFootprint, uint32_t firstRow, uint32_t rowCount) {
+
+	const KernelTable& kernels = GetKernels();
+	const float* kaiserWeights = GetKaiserWeights();
+	DecodedRows rows(desc, kernels, source, sourceFootprint);
+
+	const uint32_t width = destinationFootprint.width;
+	std::vector<float> filtered(desc.format == MipFormat::RGBA32F ? 0 : static_cast<size_t>(width) * 4);
+	std::vector<float> vertical(desc.filter == MipFilter::Kaiser ? static_cast<size_t>(sourceFootprint.width) * 4 : 0);
+
+	for (uint32_t y{ firstRow }; y < firstRow + rowCount; y++)
+	{
+		uint8_t* destinationRow = destination + static_cast<uint64_t>(y) * destinationFootprint.rowPitch;
+		// Float levels are filtered straight into place
+		float* out = desc.format == MipFormat::RGBA32F ? reinterpret_cast<float*>(destinationRow) : filtered.data();
+
+		if (desc.filter == MipFilter::Box)
+		{
+			const float* row0 = rows.Get(ClampRow(static_cast<int32_t>(y * 2), sourceFootprint.height));
+			const float* row1 = rows.Get(ClampRow(static_cast<int32_t>(y * 2 + 1), sourceFootprint.height));
+			kernels.boxRow(row0, row1, sourceFootprint.width, out, width);
+		}
+		else
+		{
+			// Separable, the six source rows down to one, then that row across
+			const float* taps[KaiserTaps];
+			for (uint32_t k{ 0 }; k < KaiserTaps; k++)
+			{
+				taps[k] = rows.Get(ClampRow(static_cast<int32_t>(y * 2 + k) - static_cast<int32_t>(KaiserTapOffset), sourceFootprint.height));
+			}
+			kernels.weightedSum(taps, kaiserWeights, KaiserTaps, vertical.data(), sourceFootprint.width * 4);
+			kernels.kaiserRow(vertical.data(), sourceFootprint.width, kaiserWeights, out, width);
+		}
+
+		if (desc.format == MipFormat::RGBA16F)
+		{
+			kernels.encodeHalf(out, destinationRow, width);
+		}
+		else if (desc.format == MipFormat::RGBA8)
+		{
+			if (desc.srgb)
+			{
+				EncodeSrgb8(out, destinationRow, width);
+			}
+			else
+			{
+				kernels.encodeUnorm8(out, destinationRow, width);
+			}
+		}
+	}
+}
+
+void GenerateMipChain(const MipChainDesc& desc, uint8_t* data, const MipFootprint* footprints, uint32_t levelCount, JobSystem* jobSystem) {
+	for (uint32_t level{ 1 }; level < levelCount; level++)
+	{
+		const MipFootprint& source = footprints[level - 1];
+		const MipFootprint& destination = footprints[level];
+		const uint8_t* sourceData = data + source.offset;
+		uint8_t* destinationData = data + destination.offset;
+
+		// Each level needs all of the one above, so only the rows within a level go wide
+		const uint32_t tileCount = (destination.height + MipTileRows - 1) / MipTileRows;
+		if (!jobSystem || tileCount <= 1)
+		{
+			GenerateMipLevel(desc, sourceData, source, destinationData, destination, 0, destination.height);
+			continue;
+		}
+
+		JobCounter counter;
+		jobSystem->ParallelFor(tileCount, 1, [&](uint32_t tile, uint32_t) {
+			const uint32_t firstRow = tile * MipTileRows;
+			const uint32_t rowCount = destination.height - firstRow < MipTileRows ? destination.height - firstRow : MipTileRows;
+			GenerateMipLevel(desc, sourceData, source, destinationData, destination, firstRow, rowCount);
+		}, &counter);
+		jobSystem->Wait(counter);
+	}
+}
+
+SimdLevel GetMipChainKernelLevel() {
+	return GetKernels().level;
+}
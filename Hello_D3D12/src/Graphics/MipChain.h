@@ -0,0 +1,60 @@
+#pragma once
+#include "../Core/CpuFeatures.h"
+#include <cstdint>
+
+class JobSystem;
+
+enum class MipFormat
+{
+	RGBA8,
+	RGBA16F,
+	RGBA32F
+};
+
+enum class MipFilter
+{
+	Box,		// 2x2 average, odd sizes drop their last row / column
+	Kaiser		// 6x6 Kaiser windowed sinc, sharper and covers odd sizes, clamped at the edges
+};
+
+struct MipChainDesc
+{
+	MipFormat format = MipFormat::RGBA8;
+	MipFilter filter = MipFilter::Box;
+	bool srgb = false;		// RGBA8 only, RGB is filtered in linear space and stored back as sRGB. Alpha is linear.
+};
+
+// Where one level sits in the chain's buffer, the same numbers as a D3D12_PLACED_SUBRESOURCE_FOOTPRINT
+struct MipFootprint
+{
+	uint64_t offset = 0;
+	uint32_t rowPitch = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// D3D12's rules for buffer to texture copies, so a chain laid out here copies with one CopyTextureRegion each
+static const uint32_t MipFootprintPitchAlignment = 256;
+static const uint32_t MipFootprintPlacementAlignment = 512;
+// Destination rows handed to one job
+static const uint32_t MipTileRows = 16;
+
+uint32_t GetMipPixelSize(MipFormat format);
+// Levels down to 1x1
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+// Lays levelCount levels of a width x height texture out like GetCopyableFootprints does (base offset 0),
+// footprints needs levelCount entries. Returns the buffer size the chain needs.
+uint64_t ComputeMipFootprints(MipFormat format, uint32_t width, uint32_t height, uint32_t levelCount, MipFootprint* footprints);
+
+// Writes rows [firstRow, firstRow + rowCount) of destination, the level below source. Both point at the levels
+// themselves, the footprints' offsets aren't used.
+void GenerateMipLevel(const MipChainDesc& desc, const uint8_t* source, const MipFootprint& sourceFootprint,
+	uint8_t* destination, const MipFootprint& destinationFootprint, uint32_t firstRow, uint32_t rowCount);
+// Fills levels 1 to levelCount - 1 of data from level 0, which has to be there already. Each level reads the one
+// above it back, so data should be ordinary memory, not a write combined upload heap. Levels go one after the
+// other, the rows of each one are split into MipTileRows tiles over the job system (or all on the calling thread
+// without one).
+void GenerateMipChain(const MipChainDesc& desc, uint8_t* data, const MipFootprint* footprints, uint32_t levelCount, JobSystem* jobSystem);
+
+// The widest filter kernels in use, AVX2 at most
+SimdLevel GetMipChainKernelLevel();
@@ -0,0 +1,181 @@
+#pragma once
+#include "CommandAllocatorPool.h"
+#include "../Core/JobSystem.h"
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <vector>
+
+struct CommandRecorderStats
+{
+	uint32_t threadCount = 0;
+	uint32_t commandListCount = 0;
+	uint32_t allocatorCount = 0;		// Created over the recorder's lifetime, stops growing once the pools warm up
+};
+
+// Splits a frame into N command lists recorded in parallel and submits them in index order.
+// Every list is a job on the JobSystem, whichever thread runs it records with that thread's own allocator, taken
+// from its own fence aware pool. Which thread recorded which list doesn't matter, Submit always hands them to the
+// backend in index order in one call.
+//
+// Backend has to provide:
+//		typedef ... Allocator;		// Copyable handles
+//		typedef ... CommandList;
+//		Allocator CreateAllocator();								// Called from any recording thread
+//		void ResetAllocator(Allocator& allocator);					// Called from any recording thread
+//		CommandList CreateCommandList();							// Returned closed
+//		void BeginCommandList(CommandList& list, Allocator& allocator);
+//		void CloseCommandList(CommandList& list);
+//		void ExecuteCommandLists(CommandList* lists, uint32_t count);
+// D3D12CommandBackend is the real one, HeadlessCommandBackend captures the streams so this runs without a GPU.
+template<typename Backend>
+class ParallelCommandRecorder {
+	public:
+		typedef typename Backend::Allocator Allocator;
+		typedef typename Backend::CommandList CommandList;
+		typedef std::function<void(uint32_t listIndex, CommandList& list)> RecordFunction;
+
+	private:
+		struct ThreadContext
+		{
+			CommandAllocatorPool<Allocator> pool;
+			std::vector<Allocator> recorded;		// Used since the last Retire
+			Allocator current;
+			bool hasCurrent = false;
+		};
+
+		Backend* m_backend = nullptr;
+		JobSystem* m_jobSystem = nullptr;
+		std::vector<ThreadContext> m_contexts;		// One per job system thread
+		std::vector<CommandList> m_lists;
+		uint32_t m_recordedListCount = 0;
+		std::atomic<uint32_t> m_allocatorCount;
+
+		const RecordFunction* m_record = nullptr;
+		uint64_t m_completedFenceValue = 0;
+
+		void RecordList(uint32_t listIndex)
+		{
+			const uint32_t threadIndex = JobSystem::GetThreadIndex();
+			assert(threadIndex < m_contexts.size());
+			ThreadContext& context = m_contexts[threadIndex];
+
+			// One allocator per thread per Record, lists recorded one after another can share it
+			if (!context.hasCurrent)
+			{
+				if (!context.pool.Acquire(m_completedFenceValue, context.current))
+				{
+					context.current = m_backend->CreateAllocator();
+					m_allocatorCount.fetch_add(1, std::memory_order_relaxed);
+				}
+				m_backend->ResetAllocator(context.current);
+				context.hasCurrent = true;
+			}
+
+			CommandList& list = m_lists[listIndex];
+			m_backend->BeginCommandList(list, context.current);
+			(*m_record)(listIndex, list);
+			m_backend->CloseCommandList(list);
+		}
+
+	public:
+		ParallelCommandRecorder()
+		{
+			m_allocatorCount.store(0);
+		}
+
+		~ParallelCommandRecorder()
+		{
+			Shutdown();
+		}
+
+		ParallelCommandRecorder(const ParallelCommandRecorder&) = delete;
+		ParallelCommandRecorder& operator=(const ParallelCommandRecorder&) = delete;
+
+		// Lists are recorded by jobSystem's threads, the calling thread included
+		void Initialize(Backend* backend, JobSystem* jobSystem)
+		{
+			Shutdown();
+
+			m_backend = backend;
+			m_jobSystem = jobSystem;
+			m_contexts = std::vector<ThreadContext>(jobSystem->GetThreadCount());
+		}
+
+		// Drops every allocator and list, the GPU has to be idle
+		void Shutdown()
+		{
+			m_contexts.clear();
+			m_lists.clear();
+			m_recordedListCount = 0;
+			m_backend = nullptr;
+			m_jobSystem = nullptr;
+		}
+
+		// Calls record once for every index in [0, listCount), one job each, and blocks until all lists are
+		// closed. completedFenceValue decides which allocators can be recycled. Main thread only.
+		void Record(uint32_t listCount, uint64_t completedFenceValue, const RecordFunction& record)
+		{
+			assert(m_backend);
+
+			while (m_lists.size() < listCount)
+			{
+				m_lists.push_back(m_backend->CreateCommandList());
+			}
+
+			m_record = &record;
+			m_completedFenceValue = completedFenceValue;
+
+			JobCounter counter;
+			m_jobSystem->ParallelFor(listCount, 1, [this](uint32_t begin, uint32_t) { RecordList(begin); }, &counter);
+			m_jobSystem->Wait(counter);
+
+			// Every job is done, whatever each thread had open goes in with this Record's allocators
+			for (ThreadContext& context : m_contexts)
+			{
+				if (context.hasCurrent)
+				{
+					context.recorded.push_back(context.current);
+					context.current = Allocator();
+					context.hasCurrent = false;
+				}
+			}
+
+			m_record = nullptr;
+			m_recordedListCount = listCount;
+		}
+
+		// Hands the lists from the last Record to the backend in index order
+		void Submit()
+		{
+			if (m_recordedListCount > 0)
+			{
+				m_backend->ExecuteCommandLists(m_lists.data(), m_recordedListCount);
+				m_recordedListCount = 0;
+			}
+		}
+
+		// Every allocator recorded into since the last call can be reused once the GPU passes fenceValue
+		void Retire(uint64_t fenceValue)
+		{
+			for (ThreadContext& context : m_contexts)
+			{
+				for (const Allocator& allocator : context.recorded)
+				{
+					context.pool.Release(allocator, fenceValue);
+				}
+				context.recorded.clear();
+			}
+		}
+
+		CommandList& GetCommandList(uint32_t listIndex) { return m_lists[listIndex]; }
+
+		CommandRecorderStats GetStats() const
+		{
+			CommandRecorderStats stats;
+			stats.threadCount = static_cast<uint32_t>(m_contexts.size());
+			stats.commandListCount = static_cast<uint32_t>(m_lists.size());
+			stats.allocatorCount = m_allocatorCount.load(std::memory_order_relaxed);
+			return stats;
+		}
+};
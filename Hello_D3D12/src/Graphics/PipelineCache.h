@@ -0,0 +1,148 @@
+#pragma once
+#include "../Core/JobSystem.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct PipelineCacheStats
+{
+	uint64_t requests = 0;
+	uint64_t deduplicated = 0;		// Requests served by an entry that already existed or was in flight
+	uint64_t created = 0;
+};
+
+// Deduplicating, asynchronous cache of anything expensive to build keyed by a 64 bit hash.
+// The first request for a key runs the create function as a job on the job system, every later request for the
+// same key (in flight or done) gets the same shared_future. Without a job system creation happens inline in Request.
+// No D3D in here, PipelineStateCache plugs in the actual PSO creation.
+template<typename T>
+class PipelineCache {
+	public:
+		typedef std::function<T()> CreateFunction;
+
+	private:
+		std::mutex m_mutex;
+		std::unordered_map<uint64_t, std::shared_future<T>> m_entries;
+		JobSystem* m_jobSystem;
+		JobCounter m_jobs;
+
+		std::atomic<uint64_t> m_requests;
+		std::atomic<uint64_t> m_deduplicated;
+		std::atomic<uint64_t> m_created;
+
+	public:
+		explicit PipelineCache(JobSystem* jobSystem = nullptr)
+		{
+			m_jobSystem = jobSystem;
+			m_requests.store(0);
+			m_deduplicated.store(0);
+			m_created.store(0);
+		}
+
+		// Nobody is left waiting on a future that never resolves
+		~PipelineCache()
+		{
+			WaitIdle();
+		}
+
+		PipelineCache(const PipelineCache&) = delete;
+		PipelineCache& operator=(const PipelineCache&) = delete;
+
+		std::shared_future<T> Request(uint64_t key, const CreateFunction& create)
+		{
+			m_requests.fetch_add(1, std::memory_order_relaxed);
+
+			std::shared_ptr<std::packaged_task<T()>> task;
+			std::shared_future<T> future;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				const auto found = m_entries.find(key);
+				if (found != m_entries.end())
+				{
+					m_deduplicated.fetch_add(1, std::memory_order_relaxed);
+					return found->second;
+				}
+
+				task = std::make_shared<std::packaged_task<T()>>(create);
+				future = task->get_future().share();
+				m_entries.emplace(key, future);
+			}
+
+			m_created.fetch_add(1, std::memory_order_relaxed);
+
+			if (m_jobSystem)
+			{
+				m_jobSystem->Run([task] { (*task)(); }, &m_jobs);
+			}
+			else
+			{
+				(*task)();
+			}
+
+			return future;
+		}
+
+		// future.get(), except the waiting thread runs jobs meanwhile. The job making it may be sitting in this
+		// thread's own deque, blocking on the future alone could wait forever.
+		T Wait(const std::shared_future<T>& future)
+		{
+			if (m_jobSystem && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				m_jobSystem->Wait(m_jobs);
+			}
+			return future.get();
+		}
+
+		T Get(uint64_t key, const CreateFunction& create)
+		{
+			return Wait(Request(key, create));
+		}
+
+		// Non blocking, false if the key was never requested or is still being created
+		bool TryGet(uint64_t key, T& value)
+		{
+			std::shared_future<T> future;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				const auto found = m_entries.find(key);
+				if (found == m_entries.end())
+				{
+					return false;
+				}
+				future = found->second;
+			}
+
+			if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				return false;
+			}
+
+			value = future.get();
+			return true;
+		}
+
+		// Blocks until everything requested so far has been created, running jobs meanwhile
+		void WaitIdle()
+		{
+			if (m_jobSystem)
+			{
+				m_jobSystem->Wait(m_jobs);
+			}
+		}
+
+		PipelineCacheStats GetStats() const
+		{
+			PipelineCacheStats stats;
+			stats.requests = m_requests.load(std::memory_order_relaxed);
+			stats.deduplicated = m_deduplicated.load(std::memory_order_relaxed);
+			stats.created = m_created.load(std::memory_order_relaxed);
+			return stats;
+		}
+};
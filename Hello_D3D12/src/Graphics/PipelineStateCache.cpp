@@ -0,0 +1,248 @@
+#include "PipelineStateCache.h"
+#include "../Core/Hash.h"
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+	uint64_t HashShader(const D3D12_SHADER_BYTECODE& shader, uint64_t seed)
+	{
+		seed = HashValue(static_cast<uint64_t>(shader.BytecodeLength), seed);
+		return shader.pShaderBytecode ? HashBytes(shader.pShaderBytecode, shader.BytecodeLength, seed) : seed;
+	}
+
+	void CopyShader(D3D12_SHADER_BYTECODE& shader, std::vector<UINT8>& storage)
+	{
+		if (!shader.pShaderBytecode)
+		{
+			return;
+		}
+
+		const UINT8* bytecode = static_cast<const UINT8*>(shader.pShaderBytecode);
+		storage.assign(bytecode, bytecode + shader.BytecodeLength);
+		shader.pShaderBytecode = storage.data();
+	}
+}
+
+PipelineStateCache::PipelineStateCache() {
+	m_libraryDirty.store(false);
+}
+
+void PipelineStateCache::Initialize(ID3D12Device8* device, const std::string& libraryPath, JobSystem* jobSystem) {
+	m_device = device;
+	m_libraryPath = libraryPath;
+	m_libraryDirty.store(false);
+
+	// A driver update or a different GPU invalidates the blob, start an empty library in that case
+	HRESULT hr = E_FAIL;
+	if (m_libraryFile.Open(libraryPath))
+	{
+		hr = m_device->CreatePipelineLibrary(m_libraryFile.GetData(), m_libraryFile.GetSize(), IID_PPV_ARGS(&m_library));
+		if (FAILED(hr))
+		{
+			spdlog::info("Pipeline library on disk is stale, rebuilding");
+			m_libraryFile.Close();
+		}
+	}
+
+	if (FAILED(hr))
+	{
+		DXCall(m_device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library)));
+	}
+
+	m_cache = std::make_unique<PipelineCache<ComPtr<ID3D12PipelineState>>>(jobSystem);
+}
+
+void PipelineStateCache::Shutdown() {
+
+	// Waits for the creations still in flight
+	m_cache.reset();
+
+	std::vector<UINT8> serialized;
+	if (m_library && m_libraryDirty.load())
+	{
+		serialized.resize(m_library->GetSerializedSize());
+		DXCall(m_library->Serialize(serialized.data(), serialized.size()));
+	}
+
+	// Library first, it references the mapped blob
+	m_library.Reset();
+	m_libraryFile.Close();
+
+	if (!serialized.empty())
+	{
+		const std::string tempPath = m_libraryPath + ".tmp";
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(serialized.data()), static_cast<std::streamsize>(serialized.size()));
+		out.close();
+
+		if (!out.fail())
+		{
+			std::remove(m_libraryPath.c_str());
+			std::rename(tempPath.c_str(), m_libraryPath.c_str());
+		}
+	}
+
+	m_device = nullptr;
+}
+
+uint64_t PipelineStateCache::HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) {
+	uint64_t hash = HashValue(rootSignatureHash);
+
+	hash = HashShader(desc.VS, hash);
+	hash = HashShader(desc.PS, hash);
+	hash = HashShader(desc.DS, hash);
+	hash = HashShader(desc.HS, hash);
+	hash = HashShader(desc.GS, hash);
+
+	hash = HashValue(desc.StreamOutput.NumEntries, hash);
+	for (UINT i{ 0 }; i < desc.StreamOutput.NumEntries; i++)
+	{
+		const D3D12_SO_DECLARATION_ENTRY& entry = desc.StreamOutput.pSODeclaration[i];
+		hash = HashString(entry.SemanticName ? entry.SemanticName : "", hash);
+		hash = HashValue(entry.Stream, hash);
+		hash = HashValue(entry.SemanticIndex, hash);
+		hash = HashValue(entry.StartComponent, hash);
+		hash = HashValue(entry.ComponentCount, hash);
+		hash = HashValue(entry.OutputSlot, hash);
+	}
+	hash = HashValue(desc.StreamOutput.NumStrides, hash);
+	if (desc.StreamOutput.NumStrides > 0)
+	{
+		hash = HashBytes(desc.StreamOutput.pBufferStrides, desc.StreamOutput.NumStrides * sizeof(UINT), hash);
+	}
+	hash = HashValue(desc.StreamOutput.RasterizedStream, hash);
+
+	// Field by field wherever the struct has padding, the padding bytes are whatever the caller left on the stack
+	hash = HashValue(desc.BlendState.AlphaToCoverageEnable, hash);
+	hash = HashValue(desc.BlendState.IndependentBlendEnable, hash);
+	for (UINT i{ 0 }; i < D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT; i++)
+	{
+		const D3D12_RENDER_TARGET_BLEND_DESC& blend = desc.BlendState.RenderTarget[i];
+		hash = HashValue(blend.BlendEnable, hash);
+		hash = HashValue(blend.LogicOpEnable, hash);
+		hash = HashValue(blend.SrcBlend, hash);
+		hash = HashValue(blend.DestBlend, hash);
+		hash = HashValue(blend.BlendOp, hash);
+		hash = HashValue(blend.SrcBlendAlpha, hash);
+		hash = HashValue(blend.DestBlendAlpha, hash);
+		hash = HashValue(blend.BlendOpAlpha, hash);
+		hash = HashValue(blend.LogicOp, hash);
+		hash = HashValue(blend.RenderTargetWriteMask, hash);
+	}
+
+	hash = HashValue(desc.SampleMask, hash);
+	hash = HashValue(desc.RasterizerState, hash);	// All 4 byte members, no padding
+
+	const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+	hash = HashValue(depthStencil.DepthEnable, hash);
+	hash = HashValue(depthStencil.DepthWriteMask, hash);
+	hash = HashValue(depthStencil.DepthFunc, hash);
+	hash = HashValue(depthStencil.StencilEnable, hash);
+	hash = HashValue(depthStencil.StencilReadMask, hash);
+	hash = HashValue(depthStencil.StencilWriteMask, hash);
+	hash = HashValue(depthStencil.FrontFace, hash);
+	hash = HashValue(depthStencil.BackFace, hash);
+
+	hash = HashValue(desc.InputLayout.NumElements, hash);
+	for (UINT i{ 0 }; i < desc.InputLayout.NumElements; i++)
+	{
+		const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+		hash = HashString(element.SemanticName, hash);
+		hash = HashValue(element.SemanticIndex, hash);
+		hash = HashValue(element.Format, hash);
+		hash = HashValue(element.InputSlot, hash);
+		hash = HashValue(element.AlignedByteOffset, hash);
+		hash = HashValue(element.InputSlotClass, hash);
+		hash = HashValue(element.InstanceDataStepRate, hash);
+	}
+
+	hash = HashValue(desc.IBStripCutValue, hash);
+	hash = HashValue(desc.PrimitiveTopologyType, hash);
+	hash = HashValue(desc.NumRenderTargets, hash);
+	for (UINT i{ 0 }; i < desc.NumRenderTargets; i++)
+	{
+		hash = HashValue(desc.RTVFormats[i], hash);
+	}
+	hash = HashValue(desc.DSVFormat, hash);
+	hash = HashValue(desc.SampleDesc, hash);
+	hash = HashValue(desc.NodeMask, hash);
+	hash = HashValue(desc.Flags, hash);
+
+	return hash;
+}
+
+std::shared_ptr<PipelineStateCache::CapturedDesc> PipelineStateCache::Capture(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) {
+	std::shared_ptr<CapturedDesc> captured = std::make_shared<CapturedDesc>();
+	captured->desc = desc;
+	captured->rootSignature = desc.pRootSignature;
+
+	CopyShader(captured->desc.VS, captured->shaders[0]);
+	CopyShader(captured->desc.PS, captured->shaders[1]);
+	CopyShader(captured->desc.DS, captured->shaders[2]);
+	CopyShader(captured->desc.HS, captured->shaders[3]);
+	CopyShader(captured->desc.GS, captured->shaders[4]);
+
+	// Names first so the element pointers into them don't move afterwards
+	const UINT elementCount = desc.InputLayout.NumElements;
+	captured->semanticNames.reserve(elementCount);
+	for (UINT i{ 0 }; i < elementCount; i++)
+	{
+		captured->semanticNames.push_back(desc.InputLayout.pInputElementDescs[i].SemanticName);
+	}
+
+	captured->inputElements.assign(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + elementCount);
+	for (UINT i{ 0 }; i < elementCount; i++)
+	{
+		captured->inputElements[i].SemanticName = captured->semanticNames[i].c_str();
+	}
+	captured->desc.InputLayout.pInputElementDescs = captured->inputElements.data();
+
+	// Stream output and cached blobs aren't used anywhere yet
+	assert(desc.StreamOutput.NumEntries == 0);
+	captured->desc.CachedPSO = {};
+
+	return captured;
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::CreateGraphicsPipeline(uint64_t key, const CapturedDesc& captured) {
+	WCHAR name[32];
+	swprintf_s(name, L"PSO_%016llx", static_cast<unsigned long long>(key));
+
+	// The cache guarantees one creation per key, which is all the library needs to be used from workers
+	ComPtr<ID3D12PipelineState> pipelineState;
+	if (SUCCEEDED(m_library->LoadGraphicsPipeline(name, &captured.desc, IID_PPV_ARGS(&pipelineState))))
+	{
+		return pipelineState;
+	}
+
+	DXCall(m_device->CreateGraphicsPipelineState(&captured.desc, IID_PPV_ARGS(&pipelineState)));
+	if (SUCCEEDED(m_library->StorePipeline(name, pipelineState.Get())))
+	{
+		m_libraryDirty.store(true);
+	}
+
+	return pipelineState;
+}
+
+std::shared_future<ComPtr<ID3D12PipelineState>> PipelineStateCache::RequestGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+	uint64_t rootSignatureHash) {
+
+	const uint64_t key = HashGraphicsPipelineDesc(desc, rootSignatureHash);
+
+	// Skip the deep copy when the PSO is already built, an in flight key still pays for it but gets deduplicated
+	ComPtr<ID3D12PipelineState> existing;
+	if (m_cache->TryGet(key, existing))
+	{
+		std::promise<ComPtr<ID3D12PipelineState>> ready;
+		ready.set_value(existing);
+		return ready.get_future().share();
+	}
+
+	std::shared_ptr<CapturedDesc> captured = Capture(desc);
+	return m_cache->Request(key, [this, key, captured]() { return CreateGraphicsPipeline(key, *captured); });
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::GetGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) {
+	return m_cache->Wait(RequestGraphicsPipeline(desc, rootSignatureHash));
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+#include "PipelineCache.h"
+#include "../Core/MappedFile.h"
+#include <string>
+
+// Graphics PSOs keyed by a stable hash of their full description.
+// Identical requests share one creation, creation runs as jobs on the job system, and every PSO is stored in an
+// ID3D12PipelineLibrary that is serialized to disk on Shutdown so the next run only has to load them.
+class PipelineStateCache {
+	private:
+		// Deep copy of a desc so it can outlive the caller's stack while a worker builds it
+		struct CapturedDesc
+		{
+			D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+			ComPtr<ID3D12RootSignature> rootSignature;
+			std::vector<UINT8> shaders[5];
+			std::vector<D3D12_INPUT_ELEMENT_DESC> inputElements;
+			std::vector<std::string> semanticNames;
+		};
+
+		ID3D12Device8* m_device = nullptr;
+		std::unique_ptr<PipelineCache<ComPtr<ID3D12PipelineState>>> m_cache;
+
+		std::string m_libraryPath;
+		MappedFile m_libraryFile;		// The library points into this, it has to outlive it
+		ComPtr<ID3D12PipelineLibrary> m_library;
+		std::atomic<bool> m_libraryDirty;
+
+		static std::shared_ptr<CapturedDesc> Capture(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+		ComPtr<ID3D12PipelineState> CreateGraphicsPipeline(uint64_t key, const CapturedDesc& captured);
+
+	public:
+		PipelineStateCache();
+
+		// jobSystem can be null, creation then happens inline on whoever asks
+		void Initialize(ID3D12Device8* device, const std::string& libraryPath, JobSystem* jobSystem);
+		// Waits for outstanding creations and writes the library back if anything new was stored
+		void Shutdown();
+
+		// The root signature is hashed by the caller (from its serialized blob), the pointer isn't stable across runs
+		static uint64_t HashGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+		std::shared_future<ComPtr<ID3D12PipelineState>> RequestGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc,
+			uint64_t rootSignatureHash);
+		ComPtr<ID3D12PipelineState> GetGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash);
+
+		PipelineCacheStats GetStats() const { return m_cache ? m_cache->GetStats() : PipelineCacheStats(); }
+};
@@ -0,0 +1,340 @@
+#include "ProceduralTexture.h"
+#include "../Core/JobSystem.h"
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+	// The desc worked out into what the row kernels want
+	struct PatternParams
+	{
+		uint32_t colorA;
+		uint32_t colorB;
+		float baseColor[4];			// colorA per channel
+		float deltaColor[4];		// colorB - colorA per channel
+		uint32_t cellShift;
+		uint32_t seed;
+		float gradientScale;		// 1 / (width + height - 2), x + y times this is 0 to 1 across the texture
+	};
+
+	// Writes pixels [begin, end) of row y
+	typedef void(*RowFunction)(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row);
+
+	struct KernelTable
+	{
+		SimdLevel level;
+		RowFunction rows[3];		// ProceduralPattern order
+	};
+
+	// lowbias32 over the cell coordinates, the SIMD kernels do the exact same integer math
+	const uint32_t NoiseKeyX = 0x9E3779B1u;
+	const uint32_t NoiseKeyY = 0x85EBCA77u;
+	const uint32_t NoiseMultiply0 = 0x7FEB352Du;
+	const uint32_t NoiseMultiply1 = 0x846CA68Bu;
+
+	uint32_t NoiseRowKey(const PatternParams& params, uint32_t y) {
+		return params.seed ^ ((y >> params.cellShift) * NoiseKeyY);
+	}
+
+	uint32_t HashNoiseCell(uint32_t cellX, uint32_t rowKey) {
+		uint32_t hash = rowKey ^ (cellX * NoiseKeyX);
+		hash ^= hash >> 16;
+		hash *= NoiseMultiply0;
+		hash ^= hash >> 15;
+		hash *= NoiseMultiply1;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
+	uint32_t LerpColorScalar(const PatternParams& params, float t) {
+		uint32_t pixel = 0;
+		for (uint32_t channel{ 0 }; channel < 4; channel++)
+		{
+			const uint32_t value = static_cast<uint32_t>(params.baseColor[channel] + params.deltaColor[channel] * t + 0.5f);
+			pixel |= value << (channel * 8);
+		}
+		return pixel;
+	}
+
+	// Scalar, one pixel at a time. Also the tail of the SIMD rows.
+
+	void CheckerRowScalar(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const uint32_t rowParity = (y >> params.cellShift) & 1;
+		for (uint32_t x{ begin }; x < end; x++)
+		{
+			row[x] = (((x >> params.cellShift) ^ rowParity) & 1) ? params.colorB : params.colorA;
+		}
+	}
+
+	void GradientRowScalar(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		for (uint32_t x{ begin }; x < end; x++)
+		{
+			row[x] = LerpColorScalar(params, static_cast<float>(x + y) * params.gradientScale);
+		}
+	}
+
+	void NoiseRowScalar(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const uint32_t rowKey = NoiseRowKey(params, y);
+		for (uint32_t x{ begin }; x < end; x++)
+		{
+			const uint32_t hash = HashNoiseCell(x >> params.cellShift, rowKey);
+			row[x] = LerpColorScalar(params, static_cast<float>(hash >> 24) * (1.0f / 255.0f));
+		}
+	}
+
+#ifdef CPU_FEATURES_X86
+
+	// SSE2, four pixels a store
+
+	// Low 32 bits of each product, SSE2 only has the 32 x 32 -> 64 bit multiply of the even lanes
+	__m128i MultiplyLow32Sse2(__m128i a, __m128i b) {
+		const __m128i even = _mm_mul_epu32(a, b);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	// base + delta * t for four pixels, rounded and packed to RGBA8
+	__m128i LerpPixelsSse2(__m128 t, __m128 base, __m128 delta) {
+		const __m128i pixel0 = _mm_cvtps_epi32(_mm_add_ps(base, _mm_mul_ps(delta, _mm_shuffle_ps(t, t, 0x00))));
+		const __m128i pixel1 = _mm_cvtps_epi32(_mm_add_ps(base, _mm_mul_ps(delta, _mm_shuffle_ps(t, t, 0x55))));
+		const __m128i pixel2 = _mm_cvtps_epi32(_mm_add_ps(base, _mm_mul_ps(delta, _mm_shuffle_ps(t, t, 0xAA))));
+		const __m128i pixel3 = _mm_cvtps_epi32(_mm_add_ps(base, _mm_mul_ps(delta, _mm_shuffle_ps(t, t, 0xFF))));
+		return _mm_packus_epi16(_mm_packs_epi32(pixel0, pixel1), _mm_packs_epi32(pixel2, pixel3));
+	}
+
+	__m128i FirstPixelsSse2(uint32_t begin) {
+		const int x = static_cast<int>(begin);
+		return _mm_setr_epi32(x, x + 1, x + 2, x + 3);
+	}
+
+	void CheckerRowSse2(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(params.cellShift));
+		const __m128i rowParity = _mm_set1_epi32(static_cast<int>((y >> params.cellShift) & 1));
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128i colorA = _mm_set1_epi32(static_cast<int>(params.colorA));
+		const __m128i colorB = _mm_set1_epi32(static_cast<int>(params.colorB));
+		const __m128i step = _mm_set1_epi32(4);
+
+		__m128i x = FirstPixelsSse2(begin);
+		uint32_t i{ begin };
+		for (; i + 4 <= end; i += 4)
+		{
+			const __m128i parity = _mm_and_si128(_mm_xor_si128(_mm_srl_epi32(x, shift), rowParity), one);
+			const __m128i useB = _mm_cmpeq_epi32(parity, one);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_or_si128(_mm_andnot_si128(useB, colorA), _mm_and_si128(useB, colorB)));
+			x = _mm_add_epi32(x, step);
+		}
+
+		CheckerRowScalar(params, y, i, end, row);
+	}
+
+	void GradientRowSse2(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const __m128 base = _mm_loadu_ps(params.baseColor);
+		const __m128 delta = _mm_loadu_ps(params.deltaColor);
+		const __m128 scale = _mm_set1_ps(params.gradientScale);
+		const __m128 step = _mm_set1_ps(4.0f);
+
+		// x + y, exact in a float for any texture size D3D allows
+		__m128 position = _mm_add_ps(_mm_cvtepi32_ps(FirstPixelsSse2(begin)), _mm_set1_ps(static_cast<float>(y)));
+		uint32_t i{ begin };
+		for (; i + 4 <= end; i += 4)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), LerpPixelsSse2(_mm_mul_ps(position, scale), base, delta));
+			position = _mm_add_ps(position, step);
+		}
+
+		GradientRowScalar(params, y, i, end, row);
+	}
+
+	void NoiseRowSse2(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const __m128 base = _mm_loadu_ps(params.baseColor);
+		const __m128 delta = _mm_loadu_ps(params.deltaColor);
+		const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(params.cellShift));
+		const __m128i rowKey = _mm_set1_epi32(static_cast<int>(NoiseRowKey(params, y)));
+		const __m128i keyX = _mm_set1_epi32(static_cast<int>(NoiseKeyX));
+		const __m128i multiply0 = _mm_set1_epi32(static_cast<int>(NoiseMultiply0));
+		const __m128i multiply1 = _mm_set1_epi32(static_cast<int>(NoiseMultiply1));
+		const __m128 toUnit = _mm_set1_ps(1.0f / 255.0f);
+		const __m128i step = _mm_set1_epi32(4);
+
+		__m128i x = FirstPixelsSse2(begin);
+		uint32_t i{ begin };
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128i hash = _mm_xor_si128(rowKey, MultiplyLow32Sse2(_mm_srl_epi32(x, shift), keyX));
+			hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 16));
+			hash = MultiplyLow32Sse2(hash, multiply0);
+			hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 15));
+			hash = MultiplyLow32Sse2(hash, multiply1);
+			hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 16));
+			const __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(hash, 24)), toUnit);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), LerpPixelsSse2(t, base, delta));
+			x = _mm_add_epi32(x, step);
+		}
+
+		NoiseRowScalar(params, y, i, end, row);
+	}
+
+	// AVX2 + FMA, eight pixels a store
+
+	// The packs work per 128 bit lane, so the pixels come out as 0 2 4 6 | 1 3 5 7 and get put back in order
+	SIMD_TARGET_AVX2 __m256i LerpPixelsAvx2(__m256 t, __m256 base, __m256 delta) {
+		const __m256 t01 = _mm256_permutevar8x32_ps(t, _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1));
+		const __m256 t23 = _mm256_permutevar8x32_ps(t, _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3));
+		const __m256 t45 = _mm256_permutevar8x32_ps(t, _mm256_setr_epi32(4, 4, 4, 4, 5, 5, 5, 5));
+		const __m256 t67 = _mm256_permutevar8x32_ps(t, _mm256_setr_epi32(6, 6, 6, 6, 7, 7, 7, 7));
+		const __m256i pixels01 = _mm256_cvtps_epi32(_mm256_fmadd_ps(delta, t01, base));
+		const __m256i pixels23 = _mm256_cvtps_epi32(_mm256_fmadd_ps(delta, t23, base));
+		const __m256i pixels45 = _mm256_cvtps_epi32(_mm256_fmadd_ps(delta, t45, base));
+		const __m256i pixels67 = _mm256_cvtps_epi32(_mm256_fmadd_ps(delta, t67, base));
+		const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(pixels01, pixels23), _mm256_packs_epi32(pixels45, pixels67));
+		return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+	}
+
+	SIMD_TARGET_AVX2 __m256i FirstPixelsAvx2(uint32_t begin) {
+		const int x = static_cast<int>(begin);
+		return _mm256_setr_epi32(x, x + 1, x + 2, x + 3, x + 4, x + 5, x + 6, x + 7);
+	}
+
+	SIMD_TARGET_AVX2 void CheckerRowAvx2(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(params.cellShift));
+		const __m256i rowParity = _mm256_set1_epi32(static_cast<int>((y >> params.cellShift) & 1));
+		const __m256i one = _mm256_set1_epi32(1);
+		const __m256i colorA = _mm256_set1_epi32(static_cast<int>(params.colorA));
+		const __m256i colorB = _mm256_set1_epi32(static_cast<int>(params.colorB));
+		const __m256i step = _mm256_set1_epi32(8);
+
+		__m256i x = FirstPixelsAvx2(begin);
+		uint32_t i{ begin };
+		for (; i + 8 <= end; i += 8)
+		{
+			const __m256i parity = _mm256_and_si256(_mm256_xor_si256(_mm256_srl_epi32(x, shift), rowParity), one);
+			const __m256i useB = _mm256_cmpeq_epi32(parity, one);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i), _mm256_blendv_epi8(colorA, colorB, useB));
+			x = _mm256_add_epi32(x, step);
+		}
+
+		CheckerRowSse2(params, y, i, end, row);
+	}
+
+	SIMD_TARGET_AVX2 void GradientRowAvx2(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const __m256 base = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(params.baseColor));
+		const __m256 delta = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(params.deltaColor));
+		const __m256 scale = _mm256_set1_ps(params.gradientScale);
+		const __m256 step = _mm256_set1_ps(8.0f);
+
+		__m256 position = _mm256_add_ps(_mm256_cvtepi32_ps(FirstPixelsAvx2(begin)), _mm256_set1_ps(static_cast<float>(y)));
+		uint32_t i{ begin };
+		for (; i + 8 <= end; i += 8)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i), LerpPixelsAvx2(_mm256_mul_ps(position, scale), base, delta));
+			position = _mm256_add_ps(position, step);
+		}
+
+		GradientRowSse2(params, y, i, end, row);
+	}
+
+	SIMD_TARGET_AVX2 void NoiseRowAvx2(const PatternParams& params, uint32_t y, uint32_t begin, uint32_t end, uint32_t* row) {
+		const __m256 base = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(params.baseColor));
+		const __m256 delta = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(params.deltaColor));
+		const __m128i shift = _mm_cvtsi32_si128(static_cast<int>(params.cellShift));
+		const __m256i rowKey = _mm256_set1_epi32(static_cast<int>(NoiseRowKey(params, y)));
+		const __m256i keyX = _mm256_set1_epi32(static_cast<int>(NoiseKeyX));
+		const __m256i multiply0 = _mm256_set1_epi32(static_cast<int>(NoiseMultiply0));
+		const __m256i multiply1 = _mm256_set1_epi32(static_cast<int>(NoiseMultiply1));
+		const __m256 toUnit = _mm256_set1_ps(1.0f / 255.0f);
+		const __m256i step = _mm256_set1_epi32(8);
+
+		__m256i x = FirstPixelsAvx2(begin);
+		uint32_t i{ begin };
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256i hash = _mm256_xor_si256(rowKey, _mm256_mullo_epi32(_mm256_srl_epi32(x, shift), keyX));
+			hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 16));
+			hash = _mm256_mullo_epi32(hash, multiply0);
+			hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 15));
+			hash = _mm256_mullo_epi32(hash, multiply1);
+			hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 16));
+			const __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(hash, 24)), toUnit);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(row + i), LerpPixelsAvx2(t, base, delta));
+			x = _mm256_add_epi32(x, step);
+		}
+
+		NoiseRowSse2(params, y, i, end, row);
+	}
+
+#endif
+
+	KernelTable MakeKernelTable(SimdLevel level) {
+		KernelTable table = { SimdLevel::Scalar, { CheckerRowScalar, GradientRowScalar, NoiseRowScalar } };
+#ifdef CPU_FEATURES_X86
+		if (level >= SimdLevel::SSE2)
+		{
+			table = { SimdLevel::SSE2, { CheckerRowSse2, GradientRowSse2, NoiseRowSse2 } };
+		}
+		// Rows are store bound by AVX2 already, AVX-512 runs the AVX2 kernels
+		if (level >= SimdLevel::AVX2)
+		{
+			table = { SimdLevel::AVX2, { CheckerRowAvx2, GradientRowAvx2, NoiseRowAvx2 } };
+		}
+#endif
+		return table;
+	}
+
+	const KernelTable& GetKernels() {
+		static const SimdKernelTables<KernelTable> tables(MakeKernelTable);
+		return tables.Get();
+	}
+
+	PatternParams MakePatternParams(const ProceduralTextureDesc& desc, const ProceduralTextureTarget& target) {
+		PatternParams params;
+		params.colorA = desc.colorA;
+		params.colorB = desc.colorB;
+		for (uint32_t channel{ 0 }; channel < 4; channel++)
+		{
+			const float a = static_cast<float>((desc.colorA >> (channel * 8)) & 0xFF);
+			const float b = static_cast<float>((desc.colorB >> (channel * 8)) & 0xFF);
+			params.baseColor[channel] = a;
+			params.deltaColor[channel] = b - a;
+		}
+		params.cellShift = desc.cellShift;
+		params.seed = desc.seed;
+		const uint32_t span = target.width + target.height - 2;
+		params.gradientScale = span > 0 ? 1.0f / static_cast<float>(span) : 0.0f;
+		return params;
+	}
+}
+
+void GenerateProceduralRows(const ProceduralTextureDesc& desc, const ProceduralTextureTarget& target, uint32_t firstRow, uint32_t rowCount) {
+	const PatternParams params = MakePatternParams(desc, target);
+	const RowFunction generateRow = GetKernels().rows[static_cast<uint32_t>(desc.pattern)];
+
+	for (uint32_t y{ firstRow }; y < firstRow + rowCount; y++)
+	{
+		generateRow(params, y, 0, target.width, reinterpret_cast<uint32_t*>(target.data + y * target.rowPitch));
+	}
+}
+
+void GenerateProceduralTexture(const ProceduralTextureDesc& desc, const ProceduralTextureTarget& target, JobSystem* jobSystem) {
+	const uint32_t tileCount = (target.height + ProceduralTileRows - 1) / ProceduralTileRows;
+	if (!jobSystem || tileCount <= 1)
+	{
+		GenerateProceduralRows(desc, target, 0, target.height);
+		return;
+	}
+
+	// Whole rows per tile, every job writes one contiguous run of the footprint
+	JobCounter counter;
+	jobSystem->ParallelFor(tileCount, 1, [&](uint32_t tile, uint32_t) {
+		const uint32_t firstRow = tile * ProceduralTileRows;
+		const uint32_t rowCount = target.height - firstRow < ProceduralTileRows ? target.height - firstRow : ProceduralTileRows;
+		GenerateProceduralRows(desc, target, firstRow, rowCount);
+	}, &counter);
+	jobSystem->Wait(counter);
+}
+
+SimdLevel GetProceduralTextureLevel() {
+	return GetKernels().level;
+}
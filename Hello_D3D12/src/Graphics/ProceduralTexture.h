@@ -0,0 +1,45 @@
+#pragma once
+#include "../Core/CpuFeatures.h"
+#include <cstdint>
+
+class JobSystem;
+
+enum class ProceduralPattern
+{
+	Checker,		// Squares of colorA and colorB, colorA in the top left
+	Gradient,		// colorA in the top left corner to colorB in the bottom right
+	Noise			// Random blend of colorA and colorB per cell
+};
+
+struct ProceduralTextureDesc
+{
+	ProceduralPattern pattern = ProceduralPattern::Checker;
+	uint32_t colorA = 0xFF000000;		// RGBA8, R in the low byte
+	uint32_t colorB = 0xFFFFFFFF;
+	uint32_t cellShift = 5;				// Checker squares and noise cells are 1 << cellShift pixels wide
+	uint32_t seed = 0;					// Noise only
+};
+
+// Where the RGBA8 pixels go, rows rowPitch bytes apart. Meant to be an upload footprint (GetCopyableFootprints'
+// RowPitch), the padding past width * 4 is left alone.
+struct ProceduralTextureTarget
+{
+	uint8_t* data = nullptr;
+	uint64_t rowPitch = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Rows handed to one job
+static const uint32_t ProceduralTileRows = 32;
+
+// Writes rows [firstRow, firstRow + rowCount) of the pattern. Every pixel is computed from its coordinates, never
+// read back from the target, so it can be a mapped upload heap. The rows are built by SIMD kernels picked at
+// runtime like the transform kernels.
+void GenerateProceduralRows(const ProceduralTextureDesc& desc, const ProceduralTextureTarget& target, uint32_t firstRow, uint32_t rowCount);
+// The whole target, cut into ProceduralTileRows row tiles spread over the job system (or all on the calling
+// thread without one). Returns once every tile is written.
+void GenerateProceduralTexture(const ProceduralTextureDesc& desc, const ProceduralTextureTarget& target, JobSystem* jobSystem);
+
+// The widest row kernels in use, AVX2 at most
+SimdLevel GetProceduralTextureLevel();
@@ -0,0 +1,479 @@
+#include "RenderGraph.h"
+#include "../Core/BitUtils.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <map>
+
+void RenderGraph::Reset() {
+	m_resources.clear();
+	m_passes.clear();
+	m_pendingAccesses.clear();
+	m_accesses.clear();
+	m_compiledPasses.clear();
+	m_finalTransitions.clear();
+	m_transientHeapSize = 0;
+	m_compiled = false;
+	m_stats = RenderGraphStats();
+}
+
+uint32_t RenderGraph::ImportResource(const char* name) {
+	Resource resource = {};
+	resource.name = name;
+	resource.imported = true;
+	resource.firstPass = InvalidIndex;
+	resource.lastPass = InvalidIndex;
+	m_resources.push_back(resource);
+	return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::ImportResource(const char* name, uint32_t finalState) {
+	const uint32_t resource = ImportResource(name);
+	m_resources[resource].hasFinalState = true;
+	m_resources[resource].finalState = finalState;
+	return resource;
+}
+
+uint32_t RenderGraph::CreateTransient(const char* name, const RenderGraphResourceDesc& desc) {
+	assert(desc.size > 0);
+
+	Resource resource = {};
+	resource.name = name;
+	resource.desc = desc;
+	resource.desc.alignment = std::max<uint64_t>(desc.alignment, 1);
+	resource.imported = false;
+	resource.firstPass = InvalidIndex;
+	resource.lastPass = InvalidIndex;
+	m_resources.push_back(resource);
+	return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::AddPass(const char* name) {
+	Pass pass = {};
+	pass.name = name;
+	m_passes.push_back(pass);
+	return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void RenderGraph::AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool read, bool write) {
+	assert(pass < m_passes.size() && resource < m_resources.size());
+
+	PendingAccess pending;
+	pending.pass = pass;
+	pending.access.resource = resource;
+	pending.access.state = state;
+	pending.access.read = read;
+	pending.access.write = write;
+	m_pendingAccesses.push_back(pending);
+}
+
+void RenderGraph::GatherAccesses() {
+
+	// Passes can be set up in any order, group the accesses by pass (stable, keeps declaration order)
+	std::stable_sort(m_pendingAccesses.begin(), m_pendingAccesses.end(),
+		[](const PendingAccess& a, const PendingAccess& b) { return a.pass < b.pass; });
+
+	m_accesses.clear();
+	m_accesses.reserve(m_pendingAccesses.size());
+
+	size_t next = 0;
+	for (uint32_t passIndex{ 0 }; passIndex < m_passes.size(); passIndex++)
+	{
+		Pass& pass = m_passes[passIndex];
+		pass.firstAccess = static_cast<uint32_t>(m_accesses.size());
+
+		for (; next < m_pendingAccesses.size() && m_pendingAccesses[next].pass == passIndex; next++)
+		{
+			const Access& access = m_pendingAccesses[next].access;
+
+			// The same resource twice in one pass (read as SRV and as copy source) becomes one combined access
+			bool merged = false;
+			for (size_t i{ pass.firstAccess }; i < m_accesses.size(); i++)
+			{
+				if (m_accesses[i].resource == access.resource)
+				{
+					m_accesses[i].state |= access.state;
+					m_accesses[i].read |= access.read;
+					m_accesses[i].write |= access.write;
+					merged = true;
+					break;
+				}
+			}
+
+			if (!merged)
+			{
+				m_accesses.push_back(access);
+			}
+		}
+
+		pass.accessCount = static_cast<uint32_t>(m_accesses.size()) - pass.firstAccess;
+	}
+}
+
+void RenderGraph::CullPasses() {
+	const uint32_t passCount = static_cast<uint32_t>(m_passes.size());
+
+	// Every pass depends on the last pass before it that wrote something it reads
+	std::vector<uint32_t> lastWriter(m_resources.size(), InvalidIndex);
+	m_producerOffsets.assign(passCount + 1, 0);
+	m_producers.clear();
+
+	for (uint32_t passIndex{ 0 }; passIndex < passCount; passIndex++)
+	{
+		const Pass& pass = m_passes[passIndex];
+		m_producerOffsets[passIndex] = static_cast<uint32_t>(m_producers.size());
+
+		for (uint32_t i{ pass.firstAccess }; i < pass.firstAccess + pass.accessCount; i++)
+		{
+			const Access& access = m_accesses[i];
+			if (access.read && lastWriter[access.resource] != InvalidIndex)
+			{
+				m_producers.push_back(lastWriter[access.resource]);
+			}
+		}
+
+		for (uint32_t i{ pass.firstAccess }; i < pass.firstAccess + pass.accessCount; i++)
+		{
+			if (m_accesses[i].write)
+			{
+				lastWriter[m_accesses[i].resource] = passIndex;
+			}
+		}
+	}
+	m_producerOffsets[passCount] = static_cast<uint32_t>(m_producers.size());
+
+	// Whatever ends up in an output and anything with side effects is visible, everything they need stays
+	std::vector<uint32_t> stack;
+	for (uint32_t passIndex{ 0 }; passIndex < passCount; passIndex++)
+	{
+		m_passes[passIndex].live = false;
+		if (m_passes[passIndex].sideEffects)
+		{
+			stack.push_back(passIndex);
+		}
+	}
+
+	for (uint32_t resource{ 0 }; resource < m_resources.size(); resource++)
+	{
+		if (m_resources[resource].hasFinalState && lastWriter[resource] != InvalidIndex)
+		{
+			stack.push_back(lastWriter[resource]);
+		}
+	}
+
+	while (!stack.empty())
+	{
+		const uint32_t passIndex = stack.back();
+		stack.pop_back();
+
+		if (m_passes[passIndex].live)
+		{
+			continue;
+		}
+		m_passes[passIndex].live = true;
+
+		for (uint32_t i{ m_producerOffsets[passIndex] }; i < m_producerOffsets[passIndex + 1]; i++)
+		{
+			if (!m_passes[m_producers[i]].live)
+			{
+				stack.push_back(m_producers[i]);
+			}
+		}
+	}
+
+	m_compiledPasses.clear();
+	for (uint32_t passIndex{ 0 }; passIndex < passCount; passIndex++)
+	{
+		if (m_passes[passIndex].live)
+		{
+			m_compiledPasses.push_back(passIndex);
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes() {
+	for (Resource& resource : m_resources)
+	{
+		resource.firstPass = InvalidIndex;
+		resource.lastPass = InvalidIndex;
+		resource.offset = 0;
+	}
+
+	for (uint32_t compiledIndex{ 0 }; compiledIndex < m_compiledPasses.size(); compiledIndex++)
+	{
+		const Pass& pass = m_passes[m_compiledPasses[compiledIndex]];
+		for (uint32_t i{ pass.firstAccess }; i < pass.firstAccess + pass.accessCount; i++)
+		{
+			Resource& resource = m_resources[m_accesses[i].resource];
+			if (resource.firstPass == InvalidIndex)
+			{
+				resource.firstPass = compiledIndex;
+			}
+			resource.lastPass = compiledIndex;
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients() {
+	const uint32_t compiledCount = static_cast<uint32_t>(m_compiledPasses.size());
+	m_passAliasing.resize(compiledCount);
+	for (uint32_t i{ 0 }; i < compiledCount; i++)
+	{
+		m_passAliasing[i].clear();
+	}
+
+	std::vector<uint32_t> transients;
+	for (uint32_t resource{ 0 }; resource < m_resources.size(); resource++)
+	{
+		if (!m_resources[resource].imported && m_resources[resource].firstPass != InvalidIndex)
+		{
+			transients.push_back(resource);
+			m_stats.transientUnaliasedSize += m_resources[resource].desc.size;
+		}
+	}
+	m_stats.transientCount = static_cast<uint32_t>(transients.size());
+
+	// Biggest first packs best, ties go to whatever starts earlier
+	std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b)
+	{
+		const Resource& first = m_resources[a];
+		const Resource& second = m_resources[b];
+		return first.desc.size != second.desc.size ? first.desc.size > second.desc.size : first.firstPass < second.firstPass;
+	});
+
+	struct Range
+	{
+		uint64_t begin;
+		uint64_t end;
+	};
+
+	// Kept apart from m_resources so the overlap scan below stays in a small contiguous array
+	struct PlacedRange
+	{
+		uint32_t firstPass;
+		uint32_t lastPass;
+		Range memory;
+	};
+
+	std::vector<uint32_t> placed;
+	std::vector<PlacedRange> placedRanges;
+	std::vector<Range> occupied;
+	placed.reserve(transients.size());
+	placedRanges.reserve(transients.size());
+	for (const uint32_t candidate : transients)
+	{
+		Resource& resource = m_resources[candidate];
+
+		// Only resources alive at the same time as this one block memory
+		occupied.clear();
+		for (const PlacedRange& other : placedRanges)
+		{
+			if (other.lastPass >= resource.firstPass && resource.lastPass >= other.firstPass)
+			{
+				occupied.push_back(other.memory);
+			}
+		}
+
+		std::sort(occupied.begin(), occupied.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+		// First gap that fits
+		uint64_t offset = 0;
+		for (const Range& range : occupied)
+		{
+			if (AlignUp(offset, resource.desc.alignment) + resource.desc.size <= range.begin)
+			{
+				break;
+			}
+			offset = std::max(offset, range.end);
+		}
+
+		resource.offset = AlignUp(offset, resource.desc.alignment);
+		m_transientHeapSize = std::max(m_transientHeapSize, resource.offset + resource.desc.size);
+
+		PlacedRange placedRange = { resource.firstPass, resource.lastPass, { resource.offset, resource.offset + resource.desc.size } };
+		placedRanges.push_back(placedRange);
+		placed.push_back(candidate);
+	}
+
+	// Walk the transients in the order they come alive, painting the heap with whoever used each byte last.
+	// Anything already painted under a new transient's range is dead by then, it couldn't share the memory otherwise.
+	struct Owner
+	{
+		uint64_t end;
+		uint32_t resource;
+	};
+
+	std::sort(placed.begin(), placed.end(), [this](uint32_t a, uint32_t b) { return m_resources[a].firstPass < m_resources[b].firstPass; });
+
+	std::map<uint64_t, Owner> owners;
+	for (const uint32_t candidate : placed)
+	{
+		const Resource& resource = m_resources[candidate];
+		const uint64_t begin = resource.offset;
+		const uint64_t end = resource.offset + resource.desc.size;
+
+		// Split whatever straddles the start so the range can be replaced as a whole
+		auto it = owners.upper_bound(begin);
+		if (it != owners.begin())
+		{
+			auto previous = std::prev(it);
+			if (previous->second.end > begin)
+			{
+				it = previous;
+			}
+		}
+
+		RenderGraphAliasing aliasing = { InvalidIndex, candidate };
+		uint32_t latestPass = 0;
+		while (it != owners.end() && it->first < end)
+		{
+			const Owner owner = it->second;
+			const uint64_t ownerBegin = it->first;
+
+			const Resource& previous = m_resources[owner.resource];
+			if (aliasing.before == InvalidIndex || previous.lastPass >= latestPass)
+			{
+				aliasing.before = owner.resource;
+				latestPass = previous.lastPass;
+			}
+
+			it = owners.erase(it);
+			if (ownerBegin < begin)
+			{
+				Owner head = { begin, owner.resource };
+				owners.emplace(ownerBegin, head);
+			}
+			if (owner.end > end)
+			{
+				Owner tail = { owner.end, owner.resource };
+				it = owners.emplace(end, tail).first;
+				break;
+			}
+		}
+
+		Owner painted = { end, candidate };
+		owners.emplace(begin, painted);
+
+		// Nothing earlier this frame, but the memory may have held something else last frame
+		m_passAliasing[resource.firstPass].push_back(aliasing);
+		m_stats.aliasingCount++;
+	}
+
+	m_stats.transientHeapSize = m_transientHeapSize;
+}
+
+void RenderGraph::Compile() {
+	GatherAccesses();
+	CullPasses();
+	ComputeLifetimes();
+	PlaceTransients();
+
+	m_stats.passCount = static_cast<uint32_t>(m_passes.size());
+	m_stats.culledPassCount = m_stats.passCount - static_cast<uint32_t>(m_compiledPasses.size());
+	m_compiled = true;
+}
+
+uint32_t RenderGraph::GetFirstState(uint32_t resource) const {
+	assert(m_compiled && m_resources[resource].firstPass != InvalidIndex);
+
+	const Pass& pass = m_passes[m_compiledPasses[m_resources[resource].firstPass]];
+	for (uint32_t i{ pass.firstAccess }; i < pass.firstAccess + pass.accessCount; i++)
+	{
+		if (m_accesses[i].resource == resource)
+		{
+			return m_accesses[i].state;
+		}
+	}
+	return 0;
+}
+
+void RenderGraph::PlanBarriers(ResourceStateTracker& tracker, const std::vector<uint32_t>& trackerHandles) {
+	assert(m_compiled && trackerHandles.size() >= m_resources.size());
+
+	const uint32_t compiledCount = static_cast<uint32_t>(m_compiledPasses.size());
+
+	// Next use of the resource after every access, walking backwards. The final state counts as a use after
+	// the last pass so outputs get split barriers too.
+	std::vector<uint32_t> nextPass(m_accesses.size(), InvalidIndex);
+	std::vector<uint32_t> nextState(m_accesses.size(), 0);
+	{
+		std::vector<uint32_t> upcomingPass(m_resources.size(), InvalidIndex);
+		std::vector<uint32_t> upcomingState(m_resources.size(), 0);
+		for (uint32_t resource{ 0 }; resource < m_resources.size(); resource++)
+		{
+			if (m_resources[resource].hasFinalState)
+			{
+				upcomingPass[resource] = compiledCount;
+				upcomingState[resource] = m_resources[resource].finalState;
+			}
+		}
+
+		for (uint32_t compiledIndex{ compiledCount }; compiledIndex-- > 0;)
+		{
+			const Pass& pass = m_passes[m_compiledPasses[compiledIndex]];
+			for (uint32_t i{ pass.firstAccess }; i < pass.firstAccess + pass.accessCount; i++)
+			{
+				const uint32_t resource = m_accesses[i].resource;
+				nextPass[i] = upcomingPass[resource];
+				nextState[i] = upcomingState[resource];
+				upcomingPass[resource] = compiledIndex;
+				upcomingState[resource] = m_accesses[i].state;
+			}
+		}
+	}
+
+	m_passTransitions.resize(compiledCount);
+	for (uint32_t compiledIndex{ 0 }; compiledIndex < compiledCount; compiledIndex++)
+	{
+		const Pass& pass = m_passes[m_compiledPasses[compiledIndex]];
+		for (uint32_t i{ pass.firstAccess }; i < pass.firstAccess + pass.accessCount; i++)
+		{
+			tracker.RequireState(trackerHandles[m_accesses[i].resource], ResourceStateTracker::AllSubresources, m_accesses[i].state);
+		}
+
+		// Also picks up the split begins queued after the previous pass
+		std::vector<ResourceTransition>& transitions = m_passTransitions[compiledIndex];
+		transitions.clear();
+		tracker.Flush(transitions);
+
+		// Passes in between that don't touch the resource give the GPU room to overlap the transition
+		for (uint32_t i{ pass.firstAccess }; i < pass.firstAccess + pass.accessCount; i++)
+		{
+			if (nextPass[i] != InvalidIndex && nextPass[i] > compiledIndex + 1)
+			{
+				tracker.BeginTransition(trackerHandles[m_accesses[i].resource], ResourceStateTracker::AllSubresources, nextState[i]);
+			}
+		}
+	}
+
+	for (uint32_t resource{ 0 }; resource < m_resources.size(); resource++)
+	{
+		if (m_resources[resource].hasFinalState && m_resources[resource].firstPass != InvalidIndex)
+		{
+			tracker.RequireState(trackerHandles[resource], ResourceStateTracker::AllSubresources, m_resources[resource].finalState);
+		}
+	}
+
+	m_finalTransitions.clear();
+	tracker.Flush(m_finalTransitions);
+
+	m_stats.transitionCount = 0;
+	m_stats.splitTransitionCount = 0;
+	const auto count = [this](const std::vector<ResourceTransition>& transitions)
+	{
+		for (const ResourceTransition& transition : transitions)
+		{
+			m_stats.transitionCount++;
+			if (transition.type == ResourceTransitionType::BeginOnly)
+			{
+				m_stats.splitTransitionCount++;
+			}
+		}
+	};
+
+	for (const std::vector<ResourceTransition>& transitions : m_passTransitions)
+	{
+		count(transitions);
+	}
+	count(m_finalTransitions);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "ResourceStateTracker.h"
+#include <cstdint>
+#include <vector>
+
+// What the graph needs to know about a transient resource to place it, the rest stays with the caller
+struct RenderGraphResourceDesc
+{
+	uint64_t size = 0;
+	uint64_t alignment = 0;
+};
+
+// Memory handed from one transient to another, before is InvalidResource if nothing is known to have been there
+struct RenderGraphAliasing
+{
+	uint32_t before;
+	uint32_t after;
+};
+
+struct RenderGraphStats
+{
+	uint32_t passCount = 0;
+	uint32_t culledPassCount = 0;
+	uint32_t transientCount = 0;
+	uint64_t transientHeapSize = 0;
+	uint64_t transientUnaliasedSize = 0;	// What the transients would take without aliasing
+	uint32_t transitionCount = 0;
+	uint32_t splitTransitionCount = 0;		// Begin halves
+	uint32_t aliasingCount = 0;
+};
+
+// Frame graph built fresh every frame. Passes declare which resources they read and write and in which state,
+// Compile then culls every pass nothing visible depends on, works out transient lifetimes and packs transients
+// with disjoint lifetimes into the same memory. PlanBarriers runs the compiled passes through a
+// ResourceStateTracker to get each pass's transitions, with split barriers across passes that don't touch the
+// resource. Pure CPU, D3D12RenderGraph turns the result into real resources and barriers.
+// Pass and resource names are not copied, they have to outlive the graph (string literals).
+class RenderGraph {
+	public:
+		static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+	private:
+		struct Resource
+		{
+			const char* name;
+			RenderGraphResourceDesc desc;
+			bool imported;
+			bool hasFinalState;
+			uint32_t finalState;
+			// Compiled
+			uint32_t firstPass;
+			uint32_t lastPass;
+			uint64_t offset;
+		};
+
+		struct Access
+		{
+			uint32_t resource;
+			uint32_t state;
+			bool read;
+			bool write;
+		};
+
+		struct Pass
+		{
+			const char* name;
+			bool sideEffects;
+			bool live;
+			uint32_t firstAccess;		// Into m_accesses once compiled, sorted by pass
+			uint32_t accessCount;
+		};
+
+		struct PendingAccess
+		{
+			uint32_t pass;
+			Access access;
+		};
+
+		std::vector<Resource> m_resources;
+		std::vector<Pass> m_passes;
+		std::vector<PendingAccess> m_pendingAccesses;
+		std::vector<Access> m_accesses;
+
+		// Compile output
+		std::vector<uint32_t> m_compiledPasses;
+		std::vector<uint32_t> m_producerOffsets;
+		std::vector<uint32_t> m_producers;
+		std::vector<std::vector<ResourceTransition>> m_passTransitions;
+		std::vector<ResourceTransition> m_finalTransitions;
+		std::vector<std::vector<RenderGraphAliasing>> m_passAliasing;
+		uint64_t m_transientHeapSize = 0;
+		bool m_compiled = false;
+		RenderGraphStats m_stats;
+
+		void AddAccess(uint32_t pass, uint32_t resource, uint32_t state, bool read, bool write);
+		void GatherAccesses();
+		void CullPasses();
+		void ComputeLifetimes();
+		void PlaceTransients();
+
+	public:
+		// Drops every pass and resource, keeps the memory for the next frame
+		void Reset();
+
+		// Lives outside the graph (back buffer, persistent textures), finalState is where it's left after the frame
+		uint32_t ImportResource(const char* name);
+		uint32_t ImportResource(const char* name, uint32_t finalState);
+		uint32_t CreateTransient(const char* name, const RenderGraphResourceDesc& desc);
+
+		uint32_t AddPass(const char* name);
+		void Read(uint32_t pass, uint32_t resource, uint32_t state) { AddAccess(pass, resource, state, true, false); }
+		// Overwrites every bit the pass cares about, whatever was in there before is dead
+		void Write(uint32_t pass, uint32_t resource, uint32_t state) { AddAccess(pass, resource, state, false, true); }
+		// Keeps what earlier passes wrote (blending, depth testing)
+		void ReadWrite(uint32_t pass, uint32_t resource, uint32_t state) { AddAccess(pass, resource, state, true, true); }
+		// Never culled, for passes with effects the graph can't see (readbacks, UAV writes to persistent data)
+		void SetSideEffects(uint32_t pass) { m_passes[pass].sideEffects = true; }
+
+		// Culls, orders and packs transients. Resources with a final state count as outputs.
+		void Compile();
+		// trackerHandles maps every graph resource to its handle in tracker, transients have to be realized first
+		void PlanBarriers(ResourceStateTracker& tracker, const std::vector<uint32_t>& trackerHandles);
+
+		// Surviving passes in execution order, as indices into the passes that were added
+		const std::vector<uint32_t>& GetCompiledPasses() const { return m_compiledPasses; }
+		bool IsPassCulled(uint32_t pass) const { return !m_passes[pass].live; }
+		const char* GetPassName(uint32_t pass) const { return m_passes[pass].name; }
+
+		uint32_t GetResourceCount() const { return static_cast<uint32_t>(m_resources.size()); }
+		const char* GetResourceName(uint32_t resource) const { return m_resources[resource].name; }
+		bool IsImported(uint32_t resource) const { return m_resources[resource].imported; }
+		// Transients not used by any surviving pass aren't placed and don't need to exist
+		bool IsTransientUsed(uint32_t resource) const { return m_resources[resource].firstPass != InvalidIndex; }
+		uint64_t GetTransientOffset(uint32_t resource) const { return m_resources[resource].offset; }
+		uint64_t GetTransientHeapSize() const { return m_transientHeapSize; }
+		// The state a resource is first used in this frame, what a freshly created transient should start in
+		uint32_t GetFirstState(uint32_t resource) const;
+
+		// Per compiled pass index, issue the aliasing barriers first, then the transitions, then run the pass
+		const std::vector<ResourceTransition>& GetPassTransitions(uint32_t compiledIndex) const { return m_passTransitions[compiledIndex]; }
+		const std::vector<RenderGraphAliasing>& GetPassAliasing(uint32_t compiledIndex) const { return m_passAliasing[compiledIndex]; }
+		// After the last pass, puts outputs into their final state
+		const std::vector<ResourceTransition>& GetFinalTransitions() const { return m_finalTransitions; }
+
+		const RenderGraphStats& GetStats() const { return m_stats; }
+};
@@ -0,0 +1,233 @@
+#include "ResourceStateTracker.h"
+#include <algorithm>
+#include <cassert>
+
+ResourceStateTracker::ResourceStateTracker(uint32_t readOnlyStates) {
+	m_readOnlyStates = readOnlyStates;
+}
+
+uint32_t ResourceStateTracker::RegisterResource(uint32_t subresourceCount, uint32_t initialState) {
+	assert(subresourceCount > 0);
+
+	uint32_t resource;
+	if (!m_freeHandles.empty())
+	{
+		resource = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else
+	{
+		resource = static_cast<uint32_t>(m_resources.size());
+		m_resources.emplace_back();
+	}
+
+	ResourceState& entry = m_resources[resource];
+	entry.subresourceCount = subresourceCount;
+	entry.state = initialState;
+	entry.uniform = true;
+	entry.registered = true;
+	entry.subresourceStates.clear();
+	entry.splits.clear();
+	return resource;
+}
+
+void ResourceStateTracker::UnregisterResource(uint32_t resource) {
+	assert(resource < m_resources.size() && m_resources[resource].registered);
+
+	// Anything still queued for it would point at a dead resource
+	m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+		[resource](const ResourceTransition& transition) { return transition.resource == resource; }), m_pending.end());
+
+	ResourceState& entry = m_resources[resource];
+	entry.registered = false;
+	entry.subresourceStates.clear();
+	entry.splits.clear();
+	m_freeHandles.push_back(resource);
+}
+
+bool ResourceStateTracker::IsSatisfied(uint32_t currentState, uint32_t requiredState) const {
+	if (currentState == requiredState)
+	{
+		return true;
+	}
+
+	// Reading a subset of a combined read state is fine, anything involving a write needs the exact state
+	return requiredState != 0 && (requiredState & ~currentState) == 0 && (currentState & ~m_readOnlyStates) == 0;
+}
+
+void ResourceStateTracker::Queue(uint32_t resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter,
+	ResourceTransitionType type) {
+
+	// Two full transitions of the same subresource in one batch, the middle state is never observed
+	if (type == ResourceTransitionType::Full)
+	{
+		for (size_t i{ m_pending.size() }; i-- > 0;)
+		{
+			ResourceTransition& previous = m_pending[i];
+			if (previous.resource != resource)
+			{
+				continue;
+			}
+
+			if (previous.subresource == subresource && previous.type == ResourceTransitionType::Full)
+			{
+				m_stats.collapsed++;
+				previous.stateAfter = stateAfter;
+				if (previous.stateBefore == previous.stateAfter)
+				{
+					m_pending.erase(m_pending.begin() + i);
+				}
+				return;
+			}
+			break;
+		}
+	}
+
+	ResourceTransition transition;
+	transition.resource = resource;
+	transition.subresource = subresource;
+	transition.stateBefore = stateBefore;
+	transition.stateAfter = stateAfter;
+	transition.type = type;
+	m_pending.push_back(transition);
+}
+
+void ResourceStateTracker::EndSplits(uint32_t resource, uint32_t subresource) {
+	std::vector<SplitTransition>& splits = m_resources[resource].splits;
+
+	for (size_t i{ 0 }; i < splits.size();)
+	{
+		const SplitTransition split = splits[i];
+		if (subresource != AllSubresources && split.subresource != AllSubresources && split.subresource != subresource)
+		{
+			i++;
+			continue;
+		}
+
+		// Still in the same batch as its begin, nothing to overlap with so make it a plain barrier
+		bool merged = false;
+		for (ResourceTransition& pending : m_pending)
+		{
+			if (pending.type == ResourceTransitionType::BeginOnly && pending.resource == resource &&
+				pending.subresource == split.subresource && pending.stateBefore == split.stateBefore &&
+				pending.stateAfter == split.stateAfter)
+			{
+				pending.type = ResourceTransitionType::Full;
+				merged = true;
+				break;
+			}
+		}
+
+		if (!merged)
+		{
+			Queue(resource, split.subresource, split.stateBefore, split.stateAfter, ResourceTransitionType::EndOnly);
+		}
+
+		splits.erase(splits.begin() + i);
+	}
+}
+
+void ResourceStateTracker::Transition(uint32_t resource, uint32_t subresource, uint32_t state, ResourceTransitionType type) {
+	assert(resource < m_resources.size() && m_resources[resource].registered);
+	ResourceState& entry = m_resources[resource];
+	m_stats.requests++;
+
+	// A single subresource is the whole resource, keep it as one state
+	if (entry.subresourceCount == 1)
+	{
+		subresource = AllSubresources;
+	}
+	assert(subresource == AllSubresources || subresource < entry.subresourceCount);
+
+	EndSplits(resource, subresource);
+
+	bool emitted = false;
+	const auto emit = [&](uint32_t target, uint32_t stateBefore)
+	{
+		Queue(resource, target, stateBefore, state, type);
+		if (type == ResourceTransitionType::BeginOnly)
+		{
+			SplitTransition split = { target, stateBefore, state };
+			entry.splits.push_back(split);
+		}
+		emitted = true;
+	};
+
+	if (entry.uniform)
+	{
+		if (IsSatisfied(entry.state, state))
+		{
+			m_stats.skipped++;
+			return;
+		}
+
+		if (subresource == AllSubresources)
+		{
+			emit(AllSubresources, entry.state);
+			entry.state = state;
+			return;
+		}
+
+		// First time this resource diverges, track it per subresource from here on
+		entry.subresourceStates.assign(entry.subresourceCount, entry.state);
+		entry.uniform = false;
+	}
+
+	const uint32_t first = subresource == AllSubresources ? 0 : subresource;
+	const uint32_t last = subresource == AllSubresources ? entry.subresourceCount : subresource + 1;
+	for (uint32_t i{ first }; i < last; i++)
+	{
+		if (!IsSatisfied(entry.subresourceStates[i], state))
+		{
+			emit(i, entry.subresourceStates[i]);
+			entry.subresourceStates[i] = state;
+		}
+	}
+
+	if (!emitted)
+	{
+		m_stats.skipped++;
+	}
+
+	// Back to one state for everything, the next whole resource request is a single barrier again
+	if (std::all_of(entry.subresourceStates.begin(), entry.subresourceStates.end(),
+		[&](uint32_t subresourceState) { return subresourceState == entry.subresourceStates[0]; }))
+	{
+		entry.state = entry.subresourceStates[0];
+		entry.uniform = true;
+		entry.subresourceStates.clear();
+	}
+}
+
+void ResourceStateTracker::RequireState(uint32_t resource, uint32_t subresource, uint32_t state) {
+	Transition(resource, subresource, state, ResourceTransitionType::Full);
+}
+
+void ResourceStateTracker::BeginTransition(uint32_t resource, uint32_t subresource, uint32_t state) {
+	Transition(resource, subresource, state, ResourceTransitionType::BeginOnly);
+}
+
+void ResourceStateTracker::Flush(std::vector<ResourceTransition>& transitions) {
+	if (m_pending.empty())
+	{
+		return;
+	}
+
+	m_stats.flushes++;
+	m_stats.transitions += m_pending.size();
+	transitions.insert(transitions.end(), m_pending.begin(), m_pending.end());
+	m_pending.clear();
+}
+
+uint32_t ResourceStateTracker::GetState(uint32_t resource, uint32_t subresource) const {
+	assert(resource < m_resources.size() && m_resources[resource].registered);
+	const ResourceState& entry = m_resources[resource];
+
+	if (entry.uniform)
+	{
+		return entry.state;
+	}
+
+	assert(subresource != AllSubresources);
+	return entry.subresourceStates[subresource];
+}
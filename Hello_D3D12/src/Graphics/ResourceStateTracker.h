@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+enum class ResourceTransitionType : uint8_t
+{
+	Full,
+	BeginOnly,		// First half of a split barrier, the GPU can start the transition early
+	EndOnly
+};
+
+// One transition barrier, states are opaque bit masks (D3D12_RESOURCE_STATES on the D3D side)
+struct ResourceTransition
+{
+	uint32_t resource;
+	uint32_t subresource;
+	uint32_t stateBefore;
+	uint32_t stateAfter;
+	ResourceTransitionType type;
+};
+
+struct ResourceStateTrackerStats
+{
+	uint64_t requests = 0;
+	uint64_t transitions = 0;		// Emitted by Flush
+	uint64_t skipped = 0;			// Requests already satisfied by the current state
+	uint64_t collapsed = 0;			// A -> B -> C chains within one batch turned into A -> C (or dropped if A == C)
+	uint64_t flushes = 0;
+};
+
+// Knows the current state of every subresource of every registered resource and turns "this pass needs X in
+// state S" into the minimal set of transitions, queued until Flush hands them over as one batch.
+// Resources stay tracked as one state until a single subresource diverges, so whole resource requests are
+// one barrier in the common case. Nothing D3D in here, D3D12StateTracker maps it onto real barriers.
+// Not thread safe, compute the barriers for every command list up front on one thread.
+class ResourceStateTracker {
+	public:
+		static const uint32_t AllSubresources = 0xFFFFFFFF;
+		static const uint32_t InvalidResource = 0xFFFFFFFF;
+
+	private:
+		struct SplitTransition
+		{
+			uint32_t subresource;
+			uint32_t stateBefore;
+			uint32_t stateAfter;
+		};
+
+		struct ResourceState
+		{
+			uint32_t subresourceCount = 0;
+			uint32_t state = 0;						// Valid while uniform
+			bool uniform = true;
+			bool registered = false;
+			std::vector<uint32_t> subresourceStates;
+			std::vector<SplitTransition> splits;	// Begun but not ended yet
+		};
+
+		uint32_t m_readOnlyStates = 0;
+		std::vector<ResourceState> m_resources;
+		std::vector<uint32_t> m_freeHandles;
+		std::vector<ResourceTransition> m_pending;
+		ResourceStateTrackerStats m_stats;
+
+		bool IsSatisfied(uint32_t currentState, uint32_t requiredState) const;
+		void Queue(uint32_t resource, uint32_t subresource, uint32_t stateBefore, uint32_t stateAfter, ResourceTransitionType type);
+		void EndSplits(uint32_t resource, uint32_t subresource);
+		void Transition(uint32_t resource, uint32_t subresource, uint32_t state, ResourceTransitionType type);
+
+	public:
+		// readOnlyStates are the bits that can be combined and read at the same time,
+		// a request for a subset of the current read state doesn't need a barrier
+		explicit ResourceStateTracker(uint32_t readOnlyStates = 0);
+
+		uint32_t RegisterResource(uint32_t subresourceCount, uint32_t initialState);
+		void UnregisterResource(uint32_t resource);
+
+		// Queues whatever transitions it takes to get the subresource (or all of them) into state
+		void RequireState(uint32_t resource, uint32_t subresource, uint32_t state);
+		// Queues the begin half of a split barrier, the next RequireState for that state ends it. Worth it when
+		// there is other work between the last write and the next read.
+		void BeginTransition(uint32_t resource, uint32_t subresource, uint32_t state);
+
+		// Moves every queued transition into transitions (appended), in the order they were requested
+		void Flush(std::vector<ResourceTransition>& transitions);
+
+		bool HasPendingTransitions() const { return !m_pending.empty(); }
+		uint32_t GetState(uint32_t resource, uint32_t subresource) const;
+		const ResourceStateTrackerStats& GetStats() const { return m_stats; }
+};
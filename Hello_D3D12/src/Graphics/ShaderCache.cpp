@@ -0,0 +1,307 @@
+#include "ShaderCache.h"
+#include "../Core/Hash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	// The source with every comment blanked out, newlines kept so line ends still line up. String literals are left
+	// alone, a "//" inside one isn't a comment.
+	std::string StripComments(const std::string& source)
+	{
+		std::string stripped = source;
+		size_t i = 0;
+		while (i < stripped.size())
+		{
+			const char c = stripped[i];
+			const char next = i + 1 < stripped.size() ? stripped[i + 1] : '\0';
+			if (c == '"')
+			{
+				for (i++; i < stripped.size() && stripped[i] != '"' && stripped[i] != '\n'; i++)
+				{
+					if (stripped[i] == '\\')
+					{
+						i++;
+					}
+				}
+				i++;
+			}
+			else if (c == '/' && next == '/')
+			{
+				for (; i < stripped.size() && stripped[i] != '\n'; i++)
+				{
+					stripped[i] = ' ';
+				}
+			}
+			else if (c == '/' && next == '*')
+			{
+				const size_t end = stripped.find("*/", i + 2);
+				const size_t last = end == std::string::npos ? stripped.size() : end + 2;
+				for (; i < last; i++)
+				{
+					if (stripped[i] != '\n')
+					{
+						stripped[i] = ' ';
+					}
+				}
+			}
+			else
+			{
+				i++;
+			}
+		}
+		return stripped;
+	}
+
+	// Length first, so "ab" + "c" and "a" + "bc" are different keys
+	void AppendString(std::string& key, const std::string& value)
+	{
+		const uint64_t length = value.size();
+		key.append(reinterpret_cast<const char*>(&length), sizeof(length));
+		key.append(value);
+	}
+
+	void AppendValue(std::string& key, uint32_t value)
+	{
+		key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+}
+
+ShaderCache::~ShaderCache() {
+	Close();
+}
+
+void ShaderCache::Open(const std::string& cachePath) {
+	Close();
+
+	m_cachePath = cachePath;
+	m_hits = 0;
+	m_misses = 0;
+
+	if (m_file.Open(cachePath) && !LoadIndex())
+	{
+		// Stale version or a truncated write, just start over
+		m_entries.clear();
+		m_file.Close();
+	}
+}
+
+bool ShaderCache::LoadIndex() {
+	const uint8_t* data = m_file.GetData();
+	const size_t size = m_file.GetSize();
+
+	if (size < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != FileMagic || header.version != FileVersion)
+	{
+		return false;
+	}
+
+	const uint64_t indexEnd = sizeof(FileHeader) + (static_cast<uint64_t>(header.entryCount) * sizeof(FileEntry));
+	if (indexEnd > size)
+	{
+		return false;
+	}
+
+	for (uint32_t i{ 0 }; i < header.entryCount; i++)
+	{
+		FileEntry entry;
+		memcpy(&entry, data + sizeof(FileHeader) + (i * sizeof(FileEntry)), sizeof(entry));
+
+		if (entry.offset < indexEnd || entry.size > size || entry.offset > size - entry.size ||
+			entry.keyOffset < indexEnd || entry.keySize > size || entry.keyOffset > size - entry.keySize)
+		{
+			return false;
+		}
+
+		Entry& loaded = m_entries[entry.hash];
+		loaded.key = reinterpret_cast<const char*>(data + entry.keyOffset);
+		loaded.keySize = static_cast<size_t>(entry.keySize);
+		loaded.bytecode.data = data + entry.offset;
+		loaded.bytecode.size = static_cast<size_t>(entry.size);
+	}
+
+	return true;
+}
+
+bool ShaderCache::Close() {
+	bool result = true;
+
+	if (!m_newEntries.empty())
+	{
+		// Rewrite the whole file next to the old one, then swap it in
+		const std::string tempPath = m_cachePath + ".tmp";
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+		FileHeader header = {};
+		header.magic = FileMagic;
+		header.version = FileVersion;
+		header.entryCount = static_cast<uint32_t>(m_entries.size());
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		uint64_t offset = sizeof(FileHeader) + (static_cast<uint64_t>(header.entryCount) * sizeof(FileEntry));
+		// Each entry's key then its bytecode
+		for (const auto& entry : m_entries)
+		{
+			FileEntry fileEntry = {};
+			fileEntry.hash = entry.first;
+			fileEntry.keyOffset = offset;
+			fileEntry.keySize = entry.second.keySize;
+			fileEntry.offset = offset + entry.second.keySize;
+			fileEntry.size = entry.second.bytecode.size;
+			out.write(reinterpret_cast<const char*>(&fileEntry), sizeof(fileEntry));
+			offset += fileEntry.keySize + fileEntry.size;
+		}
+
+		for (const auto& entry : m_entries)
+		{
+			out.write(entry.second.key, static_cast<std::streamsize>(entry.second.keySize));
+			out.write(reinterpret_cast<const char*>(entry.second.bytecode.data), static_cast<std::streamsize>(entry.second.bytecode.size));
+		}
+
+		out.close();
+		result = !out.fail();
+
+		// The mapping has to go before the old file can be replaced
+		m_file.Close();
+		if (result)
+		{
+			std::remove(m_cachePath.c_str());
+			result = std::rename(tempPath.c_str(), m_cachePath.c_str()) == 0;
+		}
+	}
+
+	m_file.Close();
+	m_entries.clear();
+	m_newEntries.clear();
+	return result;
+}
+
+bool ShaderCache::ReadTextFile(const std::string& path, std::string& text) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	text = contents.str();
+	return true;
+}
+
+void ShaderCache::AppendIncludes(const std::string& path, const std::string& fileSource, std::vector<std::string>& visited, std::string& key) {
+
+	// A commented out #include isn't a dependency
+	const std::string source = StripComments(fileSource);
+
+	const size_t lastSlash = path.find_last_of("/\\");
+	const std::string directory = lastSlash == std::string::npos ? std::string() : path.substr(0, lastSlash + 1);
+
+	size_t position = 0;
+	while ((position = source.find("#include", position)) != std::string::npos)
+	{
+		position += 8;
+
+		const size_t open = source.find_first_of("\"<", position);
+		const size_t lineEnd = source.find('\n', position);
+		if (open == std::string::npos || (lineEnd != std::string::npos && open > lineEnd))
+		{
+			continue;
+		}
+
+		const char closeChar = source[open] == '"' ? '"' : '>';
+		const size_t close = source.find(closeChar, open + 1);
+		if (close == std::string::npos)
+		{
+			break;
+		}
+
+		const std::string name = source.substr(open + 1, close - open - 1);
+		const std::string includePath = directory + name;
+		position = close + 1;
+
+		if (std::find(visited.begin(), visited.end(), includePath) != visited.end())
+		{
+			continue;
+		}
+		visited.push_back(includePath);
+
+		// The name is part of the key either way, a missing include will fail the compile anyway
+		AppendString(key, name);
+
+		std::string includeSource;
+		const bool found = ReadTextFile(includePath, includeSource);
+		AppendValue(key, found ? 1 : 0);
+		if (found)
+		{
+			AppendString(key, includeSource);
+			AppendIncludes(includePath, includeSource, visited, key);
+		}
+	}
+}
+
+bool ShaderCache::ComputeKey(const ShaderCompileRequest& request, std::string& key, uint64_t& hash) {
+	std::string source;
+	if (!ReadTextFile(request.path, source))
+	{
+		return false;
+	}
+
+	std::vector<std::string> visited;
+	visited.push_back(request.path);
+
+	key.clear();
+	AppendValue(key, FileVersion);
+	AppendString(key, source);
+	AppendIncludes(request.path, source, visited, key);
+	AppendString(key, request.entryPoint);
+	AppendString(key, request.target);
+	AppendValue(key, request.flags);
+	hash = HashBytes(key.data(), key.size());
+	return true;
+}
+
+bool ShaderCache::GetShader(const ShaderCompileRequest& request, const CompileFunction& compile, ShaderBytecode& bytecode, std::string& errors) {
+	std::unique_ptr<CompiledEntry> compiled(new CompiledEntry());
+	uint64_t hash;
+	if (!ComputeKey(request, compiled->key, hash))
+	{
+		errors = "Unable to read shader source " + request.path;
+		return false;
+	}
+
+	// Same hash but a different key is a collision, it's compiled and replaces the entry
+	const auto found = m_entries.find(hash);
+	if (found != m_entries.end() && found->second.keySize == compiled->key.size() &&
+		memcmp(found->second.key, compiled->key.data(), compiled->key.size()) == 0)
+	{
+		m_hits++;
+		bytecode = found->second.bytecode;
+		return true;
+	}
+
+	m_misses++;
+
+	if (!compile(request, compiled->bytecode, errors))
+	{
+		return false;
+	}
+
+	Entry& entry = m_entries[hash];
+	entry.key = compiled->key.data();
+	entry.keySize = compiled->key.size();
+	entry.bytecode.data = compiled->bytecode.data();
+	entry.bytecode.size = compiled->bytecode.size();
+	bytecode = entry.bytecode;
+	m_newEntries.push_back(std::move(compiled));
+	return true;
+}
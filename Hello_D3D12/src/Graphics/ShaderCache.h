@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../Core/MappedFile.h"
+
+struct ShaderCompileRequest
+{
+	std::string path;
+	std::string entryPoint;
+	std::string target;
+	uint32_t flags = 0;
+};
+
+// Points either into the mapped cache file or at bytecode compiled this run, valid until ShaderCache::Close
+struct ShaderBytecode
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
+
+// Content addressed cache of compiled shader bytecode.
+// The key covers the source, every file it includes (transitively), the entry point, target and compile flags,
+// so touching any of them is a miss. Everything lives in one file that is memory mapped on Open, new entries
+// are written back on Close. The compiler itself is passed in, nothing in here depends on D3D.
+// Entries are found by a 64 bit hash of the key but the key itself is stored with the bytecode and compared on
+// every hit, so a hash collision is a miss rather than the wrong shader.
+class ShaderCache {
+	public:
+		typedef std::function<bool(const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors)> CompileFunction;
+
+		static const uint32_t FileMagic = 0x43435348;	// "HSCC"
+		static const uint32_t FileVersion = 2;
+
+	private:
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t entryCount;
+			uint32_t reserved;
+		};
+
+		struct FileEntry
+		{
+			uint64_t hash;
+			uint64_t keyOffset;
+			uint64_t keySize;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		struct Entry
+		{
+			const char* key;
+			size_t keySize;
+			ShaderBytecode bytecode;
+		};
+
+		// Compiled this run, not in the mapped file yet
+		struct CompiledEntry
+		{
+			std::string key;
+			std::vector<uint8_t> bytecode;
+		};
+
+		std::string m_cachePath;
+		MappedFile m_file;
+		std::unordered_map<uint64_t, Entry> m_entries;
+		std::vector<std::unique_ptr<CompiledEntry>> m_newEntries;
+
+		uint32_t m_hits = 0;
+		uint32_t m_misses = 0;
+
+		bool LoadIndex();
+		static bool ReadTextFile(const std::string& path, std::string& text);
+		static void AppendIncludes(const std::string& path, const std::string& source, std::vector<std::string>& visited, std::string& key);
+
+	public:
+		ShaderCache() = default;
+		~ShaderCache();
+		ShaderCache(const ShaderCache&) = delete;
+		ShaderCache& operator=(const ShaderCache&) = delete;
+
+		// A missing or corrupt cache file just means starting empty
+		void Open(const std::string& cachePath);
+		// Writes any new entries back, invalidates every ShaderBytecode handed out
+		bool Close();
+
+		// Returns false if the shader source can't be read or it fails to compile, errors has the compiler output
+		bool GetShader(const ShaderCompileRequest& request, const CompileFunction& compile, ShaderBytecode& bytecode, std::string& errors);
+
+		// Everything the bytecode depends on, serialized, and its hash
+		static bool ComputeKey(const ShaderCompileRequest& request, std::string& key, uint64_t& hash);
+
+		uint32_t GetHits() const { return m_hits; }
+		uint32_t GetMisses() const { return m_misses; }
+};
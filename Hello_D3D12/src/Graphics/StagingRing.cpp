@@ -0,0 +1,71 @@
+#include "StagingRing.h"
+#include "../Core/BitUtils.h"
+#include <cassert>
+
+void StagingRing::Initialize(uint64_t capacity) {
+	m_capacity = capacity;
+	m_head = 0;
+	m_tail = 0;
+	m_submitted = 0;
+	m_batches.clear();
+}
+
+bool StagingRing::Allocate(uint64_t size, uint64_t alignment, StagingAllocation& allocation) {
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	assert(m_capacity % alignment == 0);
+
+	if (size == 0 || size > m_capacity)
+	{
+		return false;
+	}
+
+	// Nothing in use, start over at zero so the whole capacity is there and not just the part after the head
+	if (m_head == m_tail && m_head % m_capacity != 0)
+	{
+		m_head += m_capacity - m_head % m_capacity;
+		m_tail = m_head;
+		m_submitted = m_head;
+	}
+
+	const uint64_t physical = m_head % m_capacity;
+	uint64_t aligned = AlignUp(physical, alignment);
+	uint64_t newHead = m_head + (aligned - physical) + size;
+
+	// Doesn't fit before the end, waste the tail and start over at zero
+	if (aligned + size > m_capacity)
+	{
+		aligned = 0;
+		newHead = m_head + (m_capacity - physical) + size;
+	}
+
+	if (newHead - m_tail > m_capacity)
+	{
+		return false;
+	}
+
+	allocation.offset = aligned;
+	allocation.size = size;
+	m_head = newHead;
+	return true;
+}
+
+void StagingRing::Submit(uint64_t fenceValue) {
+	if (m_head == m_submitted)
+	{
+		return;
+	}
+
+	assert(m_batches.empty() || m_batches.back().fenceValue <= fenceValue);
+
+	Batch batch = { m_head, fenceValue };
+	m_batches.push_back(batch);
+	m_submitted = m_head;
+}
+
+void StagingRing::Retire(uint64_t completedFenceValue) {
+	while (!m_batches.empty() && m_batches.front().fenceValue <= completedFenceValue)
+	{
+		m_tail = m_batches.front().end;
+		m_batches.pop_front();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+struct StagingAllocation
+{
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+// Ring of staging memory handed out front to back and given back in batches once the fence value a batch was
+// submitted under completes. Offsets only ever grow internally, the physical offset is taken modulo the capacity,
+// and an allocation that doesn't fit before the end skips to the start (the skipped tail is freed with it).
+// Only bookkeeping, the memory itself is up to the caller. Not thread safe.
+class StagingRing {
+	private:
+		struct Batch
+		{
+			uint64_t end;			// Head once the batch was submitted
+			uint64_t fenceValue;
+		};
+
+		uint64_t m_capacity = 0;
+		uint64_t m_head = 0;		// Next free byte
+		uint64_t m_tail = 0;		// Oldest byte still in use
+		uint64_t m_submitted = 0;	// Head at the last Submit
+		std::deque<Batch> m_batches;
+
+	public:
+		void Initialize(uint64_t capacity);
+
+		// False if the ring is too full right now, retire something and try again
+		bool Allocate(uint64_t size, uint64_t alignment, StagingAllocation& allocation);
+
+		// Everything allocated since the last Submit is free once the GPU completes fenceValue
+		void Submit(uint64_t fenceValue);
+		void Retire(uint64_t completedFenceValue);
+
+		// Fence value of the oldest batch still holding memory, zero if nothing submitted is outstanding
+		uint64_t GetOldestFenceValue() const { return m_batches.empty() ? 0 : m_batches.front().fenceValue; }
+		bool HasUnsubmitted() const { return m_head != m_submitted; }
+
+		uint64_t GetUsed() const { return m_head - m_tail; }
+		uint64_t GetCapacity() const { return m_capacity; }
+};
@@ -0,0 +1,482 @@
+#include "TextureFile.h"
+#include "../Core/BitUtils.h"
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+	struct TextureFormat
+	{
+		uint32_t format;			// DXGI_FORMAT
+		uint32_t vkFormat;			// VkFormat of the same layout, for KTX2
+		uint32_t blockSize;			// Pixels across a block, 1 for uncompressed
+		uint32_t bytesPerBlock;
+	};
+
+	const TextureFormat TextureFormats[] = {
+		{ 2, 109, 1, 16 },		// R32G32B32A32_FLOAT
+		{ 10, 97, 1, 8 },		// R16G16B16A16_FLOAT
+		{ 11, 91, 1, 8 },		// R16G16B16A16_UNORM
+		{ 16, 103, 1, 8 },		// R32G32_FLOAT
+		{ 24, 64, 1, 4 },		// R10G10B10A2_UNORM
+		{ 26, 122, 1, 4 },		// R11G11B10_FLOAT
+		{ 28, 37, 1, 4 },		// R8G8B8A8_UNORM
+		{ 29, 43, 1, 4 },		// R8G8B8A8_UNORM_SRGB
+		{ 34, 83, 1, 4 },		// R16G16_FLOAT
+		{ 41, 100, 1, 4 },		// R32_FLOAT
+		{ 49, 16, 1, 2 },		// R8G8_UNORM
+		{ 54, 76, 1, 2 },		// R16_FLOAT
+		{ 61, 9, 1, 1 },		// R8_UNORM
+		{ 71, 133, 4, 8 },		// BC1_UNORM
+		{ 72, 134, 4, 8 },		// BC1_UNORM_SRGB
+		{ 74, 135, 4, 16 },		// BC2_UNORM
+		{ 75, 136, 4, 16 },		// BC2_UNORM_SRGB
+		{ 77, 137, 4, 16 },		// BC3_UNORM
+		{ 78, 138, 4, 16 },		// BC3_UNORM_SRGB
+		{ 80, 139, 4, 8 },		// BC4_UNORM
+		{ 81, 140, 4, 8 },		// BC4_SNORM
+		{ 83, 141, 4, 16 },		// BC5_UNORM
+		{ 84, 142, 4, 16 },		// BC5_SNORM
+		{ 87, 44, 1, 4 },		// B8G8R8A8_UNORM
+		{ 91, 50, 1, 4 },		// B8G8R8A8_UNORM_SRGB
+		{ 95, 143, 4, 16 },		// BC6H_UF16
+		{ 96, 144, 4, 16 },		// BC6H_SF16
+		{ 98, 145, 4, 16 },		// BC7_UNORM
+		{ 99, 146, 4, 16 }		// BC7_UNORM_SRGB
+	};
+
+	const TextureFormat* FindFormat(uint32_t format) {
+		for (const TextureFormat& entry : TextureFormats)
+		{
+			if (entry.format == format)
+			{
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	uint32_t GetKtx2Format(uint32_t vkFormat) {
+		// BC1_RGB, the same blocks read with alpha ignored
+		if (vkFormat == 131 || vkFormat == 132)
+		{
+			vkFormat += 2;
+		}
+		for (const TextureFormat& entry : TextureFormats)
+		{
+			if (entry.vkFormat == vkFormat)
+			{
+				return entry.format;
+			}
+		}
+		return 0;
+	}
+
+	// DDS
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d) {
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	const uint32_t DdsMagic = MakeFourCC('D', 'D', 'S', ' ');
+	const uint32_t DdsMipMapCount = 0x20000;
+	const uint32_t DdsFourCC = 0x4;
+	const uint32_t DdsRgb = 0x40;
+	const uint32_t DdsLuminance = 0x20000;
+	const uint32_t DdsCaps2Cubemap = 0x200;
+	const uint32_t DdsCaps2AllFaces = 0xFC00;
+	const uint32_t DdsCaps2Volume = 0x200000;
+	const uint32_t DdsDimensionTexture2D = 3;
+	const uint32_t DdsMiscTextureCube = 0x4;
+
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DdsHeader) == 124, "DDS header layout");
+	static_assert(sizeof(DdsHeaderDx10) == 20, "DDS DX10 header layout");
+
+	// Files without the DX10 header, only the formats D3D10+ can still sample as they are
+	uint32_t GetLegacyDdsFormat(const DdsPixelFormat& pixelFormat) {
+		if (pixelFormat.flags & DdsFourCC)
+		{
+			switch (pixelFormat.fourCC)
+			{
+				case MakeFourCC('D', 'X', 'T', '1'): return 71;
+				case MakeFourCC('D', 'X', 'T', '2'):
+				case MakeFourCC('D', 'X', 'T', '3'): return 74;
+				case MakeFourCC('D', 'X', 'T', '4'):
+				case MakeFourCC('D', 'X', 'T', '5'): return 77;
+				case MakeFourCC('A', 'T', 'I', '1'):
+				case MakeFourCC('B', 'C', '4', 'U'): return 80;
+				case MakeFourCC('B', 'C', '4', 'S'): return 81;
+				case MakeFourCC('A', 'T', 'I', '2'):
+				case MakeFourCC('B', 'C', '5', 'U'): return 83;
+				case MakeFourCC('B', 'C', '5', 'S'): return 84;
+				// D3DFORMAT values
+				case 36: return 11;
+				case 111: return 54;
+				case 112: return 34;
+				case 113: return 10;
+				case 114: return 41;
+				case 115: return 16;
+				case 116: return 2;
+				default: return 0;
+			}
+		}
+		if ((pixelFormat.flags & DdsRgb) && pixelFormat.rgbBitCount == 32)
+		{
+			if (pixelFormat.rBitMask == 0xFF && pixelFormat.gBitMask == 0xFF00 && pixelFormat.bBitMask == 0xFF0000)
+			{
+				return 28;
+			}
+			if (pixelFormat.rBitMask == 0xFF0000 && pixelFormat.gBitMask == 0xFF00 && pixelFormat.bBitMask == 0xFF)
+			{
+				return 87;
+			}
+		}
+		if ((pixelFormat.flags & DdsLuminance) && pixelFormat.rgbBitCount == 8 && pixelFormat.rBitMask == 0xFF)
+		{
+			return 61;
+		}
+		return 0;
+	}
+
+	// KTX2
+
+	const uint8_t Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	struct Ktx2Header
+	{
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	// Right after the header, level 0 (the biggest) first
+	struct Ktx2Level
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+	static_assert(sizeof(Ktx2Level) == 24, "KTX2 level index layout");
+
+	// Everything but the offset
+	TextureFileSubresource MakeSubresource(const TextureFormat& format, const TextureFileInfo& info, uint32_t mip) {
+		TextureFileSubresource subresource;
+		subresource.width = info.width >> mip > 0 ? info.width >> mip : 1;
+		subresource.height = info.height >> mip > 0 ? info.height >> mip : 1;
+		subresource.rowSize = (subresource.width + format.blockSize - 1) / format.blockSize * format.bytesPerBlock;
+		subresource.rowCount = (subresource.height + format.blockSize - 1) / format.blockSize;
+		return subresource;
+	}
+
+}
+
+bool TextureFile::Open(const std::string& path) {
+	Close();
+	if (!m_file.Open(path))
+	{
+		return Fail("can't open the file");
+	}
+	m_data = m_file.GetData();
+	m_size = m_file.GetSize();
+	return Parse();
+}
+
+bool TextureFile::Load(const uint8_t* data, size_t size) {
+	Close();
+	m_data = data;
+	m_size = size;
+	return Parse();
+}
+
+void TextureFile::Close() {
+	m_file.Close();
+	m_data = nullptr;
+	m_size = 0;
+	m_info = TextureFileInfo();
+	m_subresources.clear();
+	m_error = nullptr;
+}
+
+bool TextureFile::Fail(const char* error) {
+	Close();
+	m_error = error;
+	return false;
+}
+
+bool TextureFile::Parse() {
+	if (m_size >= sizeof(uint32_t))
+	{
+		uint32_t magic;
+		memcpy(&magic, m_data, sizeof(magic));
+		if (magic == DdsMagic)
+		{
+			return ParseDds();
+		}
+	}
+	if (m_size >= sizeof(Ktx2Identifier) && memcmp(m_data, Ktx2Identifier, sizeof(Ktx2Identifier)) == 0)
+	{
+		return ParseKtx2();
+	}
+	return Fail("not a DDS or KTX2 file");
+}
+
+bool TextureFile::ParseDds() {
+	uint64_t dataOffset = sizeof(uint32_t) + sizeof(DdsHeader);
+	if (m_size < dataOffset)
+	{
+		return Fail("truncated DDS header");
+	}
+	DdsHeader header;
+	memcpy(&header, m_data + sizeof(uint32_t), sizeof(header));
+	if (header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat))
+	{
+		return Fail("bad DDS header size");
+	}
+
+	m_info.type = TextureFileType::DDS;
+	m_info.width = header.width;
+	m_info.height = header.height;
+	m_info.mipLevels = (header.flags & DdsMipMapCount) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+	m_info.arraySize = 1;
+
+	if ((header.pixelFormat.flags & DdsFourCC) && header.pixelFormat.fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		if (m_size < dataOffset + sizeof(DdsHeaderDx10))
+		{
+			return Fail("truncated DDS DX10 header");
+		}
+		DdsHeaderDx10 extension;
+		memcpy(&extension, m_data + dataOffset, sizeof(extension));
+		dataOffset += sizeof(extension);
+
+		if (extension.resourceDimension != DdsDimensionTexture2D)
+		{
+			return Fail("only 2D textures are supported");
+		}
+		if (extension.arraySize == 0 || extension.arraySize > MaxArraySize)
+		{
+			return Fail("array size out of range");
+		}
+		m_info.format = extension.dxgiFormat;
+		m_info.cube = (extension.miscFlag & DdsMiscTextureCube) != 0;
+		m_info.arraySize = extension.arraySize * (m_info.cube ? 6 : 1);
+	}
+	else
+	{
+		if (header.caps2 & DdsCaps2Volume)
+		{
+			return Fail("volume textures aren't supported");
+		}
+		m_info.format = GetLegacyDdsFormat(header.pixelFormat);
+		if (header.caps2 & DdsCaps2Cubemap)
+		{
+			if ((header.caps2 & DdsCaps2AllFaces) != DdsCaps2AllFaces)
+			{
+				return Fail("cube maps need all six faces");
+			}
+			m_info.cube = true;
+			m_info.arraySize = 6;
+		}
+	}
+
+	if (!Validate())
+	{
+		return false;
+	}
+
+	// Slice after slice, each with its whole mip chain
+	const TextureFormat& format = *FindFormat(m_info.format);
+	m_subresources.reserve(static_cast<size_t>(m_info.mipLevels) * m_info.arraySize);
+	uint64_t offset = dataOffset;
+	for (uint32_t slice{ 0 }; slice < m_info.arraySize; slice++)
+	{
+		for (uint32_t mip{ 0 }; mip < m_info.mipLevels; mip++)
+		{
+			TextureFileSubresource subresource = MakeSubresource(format, m_info, mip);
+			subresource.offset = offset;
+			offset += static_cast<uint64_t>(subresource.rowSize) * subresource.rowCount;
+			if (offset > m_size)
+			{
+				return Fail("texel data runs past the end of the file");
+			}
+			m_subresources.push_back(subresource);
+		}
+	}
+	return true;
+}
+
+bool TextureFile::ParseKtx2() {
+	if (m_size < sizeof(Ktx2Header))
+	{
+		return Fail("truncated KTX2 header");
+	}
+	Ktx2Header header;
+	memcpy(&header, m_data, sizeof(header));
+	if (header.supercompressionScheme != 0)
+	{
+		return Fail("supercompressed KTX2 isn't supported");
+	}
+	if (header.pixelDepth != 0)
+	{
+		return Fail("volume textures aren't supported");
+	}
+	if (header.pixelHeight == 0)
+	{
+		return Fail("only 2D textures are supported");
+	}
+	if (header.faceCount != 1 && header.faceCount != 6)
+	{
+		return Fail("KTX2 face count has to be 1 or 6");
+	}
+	const uint32_t layerCount = header.layerCount > 0 ? header.layerCount : 1;
+	if (layerCount > MaxArraySize)
+	{
+		return Fail("array size out of range");
+	}
+
+	m_info.type = TextureFileType::KTX2;
+	m_info.format = GetKtx2Format(header.vkFormat);
+	m_info.width = header.pixelWidth;
+	m_info.height = header.pixelHeight;
+	// 0 asks the loader to build the mips, the file only has the top level then
+	m_info.mipLevels = header.levelCount > 0 ? header.levelCount : 1;
+	m_info.arraySize = layerCount * header.faceCount;
+	m_info.cube = header.faceCount == 6;
+	if (!Validate())
+	{
+		return false;
+	}
+
+	const uint64_t indexEnd = sizeof(Ktx2Header) + static_cast<uint64_t>(m_info.mipLevels) * sizeof(Ktx2Level);
+	if (indexEnd > m_size)
+	{
+		return Fail("truncated KTX2 level index");
+	}
+
+	// Each level holds every layer, each layer every face, in the same order as D3D12's array slices
+	const TextureFormat& format = *FindFormat(m_info.format);
+	m_subresources.resize(static_cast<size_t>(m_info.mipLevels) * m_info.arraySize);
+	for (uint32_t mip{ 0 }; mip < m_info.mipLevels; mip++)
+	{
+		Ktx2Level level;
+		memcpy(&level, m_data + sizeof(Ktx2Header) + static_cast<size_t>(mip) * sizeof(Ktx2Level), sizeof(level));
+
+		TextureFileSubresource subresource = MakeSubresource(format, m_info, mip);
+		const uint64_t imageSize = static_cast<uint64_t>(subresource.rowSize) * subresource.rowCount;
+		if (level.byteLength < imageSize * m_info.arraySize || level.byteLength > m_size || level.byteOffset > m_size - level.byteLength)
+		{
+			return Fail("KTX2 level runs past the end of the file");
+		}
+		for (uint32_t slice{ 0 }; slice < m_info.arraySize; slice++)
+		{
+			subresource.offset = level.byteOffset + slice * imageSize;
+			m_subresources[mip + slice * m_info.mipLevels] = subresource;
+		}
+	}
+	return true;
+}
+
+bool TextureFile::Validate() {
+	const TextureFormat* format = FindFormat(m_info.format);
+	if (!format)
+	{
+		return Fail("unsupported format");
+	}
+	if (m_info.width == 0 || m_info.height == 0 || m_info.width > MaxDimension || m_info.height > MaxDimension)
+	{
+		return Fail("size out of range");
+	}
+	// D3D12 wants the top level of a BC texture in whole blocks
+	if (format->blockSize > 1 && (m_info.width % format->blockSize != 0 || m_info.height % format->blockSize != 0))
+	{
+		return Fail("block compressed textures have to be a multiple of 4 in size");
+	}
+	if (m_info.mipLevels > FindHighestSetBit(m_info.width | m_info.height) + 1)
+	{
+		return Fail("more mip levels than the size allows");
+	}
+	if (m_info.arraySize == 0 || m_info.arraySize > MaxArraySize)
+	{
+		return Fail("array size out of range");
+	}
+	if (m_info.cube && m_info.width != m_info.height)
+	{
+		return Fail("cube faces have to be square");
+	}
+	return true;
+}
+
+void TextureFile::CopySubresource(uint32_t subresource, uint8_t* destination, uint64_t destinationRowPitch,
+	uint32_t firstRow, uint32_t rowCount) const {
+	const TextureFileSubresource& source = m_subresources[subresource];
+	assert(firstRow <= source.rowCount);
+	if (rowCount > source.rowCount - firstRow)
+	{
+		rowCount = source.rowCount - firstRow;
+	}
+
+	const uint8_t* data = m_data + source.offset + static_cast<size_t>(firstRow) * source.rowSize;
+	if (destinationRowPitch == source.rowSize)
+	{
+		memcpy(destination, data, static_cast<size_t>(source.rowSize) * rowCount);
+		return;
+	}
+	for (uint32_t row{ 0 }; row < rowCount; row++)
+	{
+		memcpy(destination + row * destinationRowPitch, data + static_cast<size_t>(row) * source.rowSize, source.rowSize);
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../Core/MappedFile.h"
+
+enum class TextureFileType
+{
+	DDS,
+	KTX2
+};
+
+// What the file holds. Formats are DXGI_FORMAT values, KTX2's Vulkan formats are mapped over. Plain numbers so
+// this builds without the D3D headers.
+struct TextureFileInfo
+{
+	TextureFileType type = TextureFileType::DDS;
+	uint32_t format = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t mipLevels = 0;
+	uint32_t arraySize = 0;		// Slices, a cube is six
+	bool cube = false;
+};
+
+// One mip of one slice as it sits in the file, rows packed with no padding. For block compressed formats a row
+// is a row of 4x4 blocks, the same rows GetCopyableFootprints counts.
+struct TextureFileSubresource
+{
+	uint64_t offset = 0;		// From the start of the file
+	uint32_t rowSize = 0;
+	uint32_t rowCount = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// DDS or KTX2 texture read through a memory mapping. Open only parses the headers and works out where every
+// subresource is, the texels stay in the mapping until CopySubresource moves them straight to where they're
+// going (an upload heap), repacked to the destination's row pitch on the way. No read into a buffer first.
+// 2D textures, arrays and cubes in uncompressed 8/16/32 bit and BC1-7 formats. No volumes, no KTX2
+// supercompression (Basis), those fail to open.
+class TextureFile {
+	public:
+		// D3D12's limits, anything past them can't be created anyway
+		static const uint32_t MaxDimension = 16384;
+		static const uint32_t MaxArraySize = 2048;
+
+	private:
+		MappedFile m_file;
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+		TextureFileInfo m_info;
+		// In D3D12 subresource order, mip + slice * mipLevels
+		std::vector<TextureFileSubresource> m_subresources;
+		const char* m_error = nullptr;
+
+		bool Parse();
+		bool ParseDds();
+		bool ParseKtx2();
+		// Limits every file type shares, once m_info is filled in
+		bool Validate();
+		// Closes, so a failed Open leaves nothing half loaded
+		bool Fail(const char* error);
+
+	public:
+		TextureFile() = default;
+		TextureFile(const TextureFile&) = delete;
+		TextureFile& operator=(const TextureFile&) = delete;
+
+		// Picks DDS or KTX2 from the file's magic, false with GetError set if it's missing, malformed or a
+		// texture this can't load
+		bool Open(const std::string& path);
+		// Same for a file that's already in memory, data has to outlive the TextureFile
+		bool Load(const uint8_t* data, size_t size);
+		void Close();
+
+		bool IsOpen() const { return m_data != nullptr; }
+		const char* GetError() const { return m_error; }
+		const TextureFileInfo& GetInfo() const { return m_info; }
+		uint32_t GetSubresourceCount() const { return static_cast<uint32_t>(m_subresources.size()); }
+		const TextureFileSubresource& GetSubresource(uint32_t subresource) const { return m_subresources[subresource]; }
+		const uint8_t* GetSubresourceData(uint32_t subresource) const { return m_data + m_subresources[subresource].offset; }
+
+		// Copies rowCount of the subresource's rows from firstRow on to destination, destinationRowPitch bytes
+		// apart, all of them by default. Meant for the staging memory UploadTexture's fill function hands out,
+		// with the footprint's RowPitch and the rows it asks for.
+		static const uint32_t AllRows = 0xFFFFFFFF;
+		void CopySubresource(uint32_t subresource, uint8_t* destination, uint64_t destinationRowPitch,
+			uint32_t firstRow = 0, uint32_t rowCount = AllRows) const;
+};
@@ -0,0 +1,266 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+constexpr uint32_t TextureStreamer::InvalidTexture;
+constexpr uint32_t TextureStreamer::NotRequested;
+constexpr uint32_t TextureStreamer::MaxMipLevels;
+constexpr uint32_t TextureStreamer::InvalidMip;
+
+TextureStreamer::~TextureStreamer() {
+	Shutdown();
+}
+
+void TextureStreamer::Initialize(JobSystem* jobSystem, const LoadFunction& load, uint64_t budget, uint32_t maxLoadsInFlight) {
+	Shutdown();
+	m_jobSystem = jobSystem;
+	m_load = load;
+	m_maxLoadsInFlight = maxLoadsInFlight;
+	m_stats.budget = budget;
+}
+
+void TextureStreamer::Shutdown() {
+	if (m_jobSystem)
+	{
+		m_jobSystem->Wait(m_loads);
+	}
+	m_jobSystem = nullptr;
+	m_load = nullptr;
+	m_textures.clear();
+	m_unusedTextures.clear();
+	m_lruHead = InvalidTexture;
+	m_lruTail = InvalidTexture;
+	m_completed.clear();
+	m_frame = 0;
+	m_stats = TextureStreamerStats();
+}
+
+void TextureStreamer::LinkLast(uint32_t texture) {
+	Texture& entry = m_textures[texture];
+	entry.lruPrev = m_lruTail;
+	entry.lruNext = InvalidTexture;
+	if (m_lruTail != InvalidTexture)
+	{
+		m_textures[m_lruTail].lruNext = texture;
+	}
+	else
+	{
+		m_lruHead = texture;
+	}
+	m_lruTail = texture;
+}
+
+void TextureStreamer::Unlink(uint32_t texture) {
+	Texture& entry = m_textures[texture];
+	if (entry.lruPrev != InvalidTexture)
+	{
+		m_textures[entry.lruPrev].lruNext = entry.lruNext;
+	}
+	else
+	{
+		m_lruHead = entry.lruNext;
+	}
+	if (entry.lruNext != InvalidTexture)
+	{
+		m_textures[entry.lruNext].lruPrev = entry.lruPrev;
+	}
+	else
+	{
+		m_lruTail = entry.lruPrev;
+	}
+	entry.lruPrev = InvalidTexture;
+	entry.lruNext = InvalidTexture;
+}
+
+uint64_t TextureStreamer::GetSize(const Texture& texture, uint32_t firstMip) const {
+	uint64_t size = 0;
+	for (uint32_t mip{ firstMip }; mip < texture.mipLevels; mip++)
+	{
+		size += texture.mipSizes[mip];
+	}
+	return size;
+}
+
+uint32_t TextureStreamer::Register(uint32_t mipLevels, const uint64_t* mipSizes, uint32_t tailMip) {
+	assert(tailMip < mipLevels && mipLevels <= MaxMipLevels);
+
+	uint32_t index;
+	if (!m_unusedTextures.empty())
+	{
+		index = m_unusedTextures.back();
+		m_unusedTextures.pop_back();
+	}
+	else
+	{
+		index = static_cast<uint32_t>(m_textures.size());
+		m_textures.emplace_back();
+	}
+
+	Texture& texture = m_textures[index];
+	memcpy(texture.mipSizes, mipSizes, mipLevels * sizeof(uint64_t));
+	texture.mipLevels = mipLevels;
+	texture.tailMip = tailMip;
+	texture.residentMip = tailMip;
+	texture.wantedMip = tailMip;
+	texture.loadingMip = InvalidMip;
+	texture.lastUsedFrame = m_frame;
+	texture.registered = true;
+	texture.failed = false;
+	LinkLast(index);
+
+	const uint64_t tailSize = GetSize(texture, tailMip);
+	m_stats.residentSize += tailSize;
+	m_stats.tailSize += tailSize;
+	m_stats.textureCount++;
+	return index;
+}
+
+void TextureStreamer::Unregister(uint32_t texture) {
+	Texture& entry = m_textures[texture];
+	Unlink(texture);
+	m_stats.residentSize -= GetSize(entry, entry.residentMip);
+	m_stats.tailSize -= GetSize(entry, entry.tailMip);
+	m_stats.textureCount--;
+	entry.registered = false;
+
+	// A load in flight still holds its size and the slot until it comes back
+	if (entry.loadingMip == InvalidMip)
+	{
+		m_unusedTextures.push_back(texture);
+	}
+}
+
+bool TextureStreamer::EvictOne(uint32_t& cursor, std::vector<TextureStreamEvent>& events) {
+	// Nothing before the cursor has a spare mip, and nothing in an Update gains one
+	while (cursor != InvalidTexture)
+	{
+		Texture& texture = m_textures[cursor];
+		// A loading texture is left alone, its load lands right above residentMip
+		if (texture.residentMip < texture.wantedMip && texture.loadingMip == InvalidMip)
+		{
+			m_stats.residentSize -= texture.mipSizes[texture.residentMip];
+			m_stats.evictions++;
+			texture.residentMip++;
+			events.push_back({ cursor, texture.residentMip, false });
+			return true;
+		}
+		cursor = texture.lruNext;
+	}
+	return false;
+}
+
+void TextureStreamer::Load(uint32_t texture, uint32_t mip) {
+	JobSystem::JobFunction job = [this, texture, mip]() {
+		const bool succeeded = m_load(texture, mip);
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		m_completed.push_back({ texture, mip, succeeded });
+	};
+	if (m_jobSystem)
+	{
+		m_jobSystem->Run(job, &m_loads);
+	}
+	else
+	{
+		job();
+	}
+}
+
+void TextureStreamer::Update(const uint32_t* feedback, uint32_t feedbackCount, std::vector<TextureStreamEvent>& events) {
+	events.clear();
+	m_frame++;
+
+	// Loads that came back since the last Update
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		m_completedScratch.swap(m_completed);
+	}
+	for (const Completion& completion : m_completedScratch)
+	{
+		Texture& texture = m_textures[completion.texture];
+		texture.loadingMip = InvalidMip;
+		m_stats.loadingSize -= texture.mipSizes[completion.mip];
+		m_stats.loadsInFlight--;
+		if (!texture.registered)
+		{
+			m_unusedTextures.push_back(completion.texture);
+		}
+		else if (completion.succeeded)
+		{
+			texture.residentMip = completion.mip;
+			m_stats.residentSize += texture.mipSizes[completion.mip];
+			events.push_back({ completion.texture, completion.mip, true });
+		}
+		else
+		{
+			texture.failed = true;
+			m_stats.loadsFailed++;
+		}
+	}
+	m_completedScratch.clear();
+
+	// What every texture wants this frame. Sampled ones go to the back of the LRU list, the rest only need their
+	// tail, anything finer they still have is spare.
+	m_requests.clear();
+	for (uint32_t index{ 0 }; index < m_textures.size(); index++)
+	{
+		Texture& texture = m_textures[index];
+		if (!texture.registered)
+		{
+			continue;
+		}
+		const uint32_t requested = index < feedbackCount ? feedback[index] : NotRequested;
+		if (requested == NotRequested)
+		{
+			texture.wantedMip = texture.tailMip;
+			continue;
+		}
+		texture.wantedMip = requested < texture.tailMip ? requested : texture.tailMip;
+		texture.lastUsedFrame = m_frame;
+		Unlink(index);
+		LinkLast(index);
+		if (texture.wantedMip < texture.residentMip && texture.loadingMip == InvalidMip && !texture.failed)
+		{
+			m_requests.push_back(index);
+		}
+	}
+
+	// The budget may have gone down
+	uint32_t cursor = m_lruHead;
+	while (m_stats.residentSize + m_stats.loadingSize > m_stats.budget && EvictOne(cursor, events))
+	{
+	}
+
+	// Furthest from what they asked for first, then in texture order so runs repeat
+	std::sort(m_requests.begin(), m_requests.end(), [this](uint32_t a, uint32_t b) {
+		const uint32_t gapA = m_textures[a].residentMip - m_textures[a].wantedMip;
+		const uint32_t gapB = m_textures[b].residentMip - m_textures[b].wantedMip;
+		return gapA != gapB ? gapA > gapB : a < b;
+	});
+	for (uint32_t index : m_requests)
+	{
+		if (m_stats.loadsInFlight >= m_maxLoadsInFlight)
+		{
+			break;
+		}
+
+		Texture& texture = m_textures[index];
+		const uint32_t mip = texture.residentMip - 1;
+		const uint64_t size = texture.mipSizes[mip];
+		while (m_stats.residentSize + m_stats.loadingSize + size > m_stats.budget && EvictOne(cursor, events))
+		{
+		}
+		// A smaller mip further down might still fit
+		if (m_stats.residentSize + m_stats.loadingSize + size > m_stats.budget)
+		{
+			m_stats.budgetStalls++;
+			continue;
+		}
+
+		texture.loadingMip = mip;
+		m_stats.loadingSize += size;
+		m_stats.loadsInFlight++;
+		m_stats.loadsIssued++;
+		Load(index, mip);
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "../Core/JobSystem.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Something the renderer has to act on, in the order it happened
+struct TextureStreamEvent
+{
+	uint32_t texture;
+	uint32_t residentMip;		// The texture's finest resident mip now
+	// True when residentMip arrived: upload it, then lower the texture's min LOD. False when the mips above
+	// residentMip were dropped: raise the min LOD, free them once the GPU is done with them.
+	bool loaded;
+};
+
+struct TextureStreamerStats
+{
+	uint64_t budget = 0;
+	uint64_t residentSize = 0;		// Tails included
+	uint64_t tailSize = 0;
+	uint64_t loadingSize = 0;		// Held for loads in flight
+	uint32_t textureCount = 0;
+	uint32_t loadsInFlight = 0;
+	uint64_t loadsIssued = 0;
+	uint64_t loadsFailed = 0;
+	uint64_t evictions = 0;			// Mips dropped
+	uint64_t budgetStalls = 0;		// Loads held back because nothing could be evicted to make room
+};
+
+// Decides which mips of which textures are in memory. Pure CPU bookkeeping, the actual reading, decoding and
+// uploading is the caller's, so the policy runs the same against a real GPU or simulated feedback.
+// - Every texture's mip tail (tailMip and down) is resident from Register to Unregister and never evicted.
+// - Finer mips load on demand from a feedback buffer, one requested mip per texture per frame (what a shader
+//   InterlockedMin's into a UAV). A texture streams in one mip at a time, coarse to fine, the blurriest
+//   relative to its request first.
+// - Resident mips plus loads in flight stay under the budget. Room is made by dropping mips finer than what
+//   their texture asks for, least recently sampled texture first. Tails alone can go over it.
+// - Loads run the LoadFunction as jobs on the job system (inline without one) and come back in a later Update.
+class TextureStreamer {
+	public:
+		static constexpr uint32_t InvalidTexture = 0xFFFFFFFF;
+		// Feedback for a texture nothing sampled this frame, what the buffer is cleared to
+		static constexpr uint32_t NotRequested = 0xFFFFFFFF;
+		// 16384 down to 1
+		static constexpr uint32_t MaxMipLevels = 15;
+
+		// Reads and decodes one mip into wherever the caller stages it, on a worker thread, so it has to be
+		// thread safe. False if it failed, the texture then stops streaming and keeps what it has.
+		typedef std::function<bool(uint32_t texture, uint32_t mip)> LoadFunction;
+
+	private:
+		static constexpr uint32_t InvalidMip = 0xFFFFFFFF;
+
+		struct Texture
+		{
+			uint64_t mipSizes[MaxMipLevels];
+			uint32_t mipLevels;
+			uint32_t tailMip;
+			uint32_t residentMip;
+			uint32_t wantedMip;
+			uint32_t loadingMip;
+			uint64_t lastUsedFrame;
+			// Least recently used first
+			uint32_t lruPrev;
+			uint32_t lruNext;
+			bool registered;
+			bool failed;
+		};
+
+		struct Completion
+		{
+			uint32_t texture;
+			uint32_t mip;
+			bool succeeded;
+		};
+
+		std::vector<Texture> m_textures;
+		std::vector<uint32_t> m_unusedTextures;
+		uint32_t m_lruHead = InvalidTexture;
+		uint32_t m_lruTail = InvalidTexture;
+
+		JobSystem* m_jobSystem = nullptr;
+		LoadFunction m_load;
+		JobCounter m_loads;
+		uint32_t m_maxLoadsInFlight = 0;
+
+		// Filled by the load jobs
+		std::mutex m_completedMutex;
+		std::vector<Completion> m_completed;
+		std::vector<Completion> m_completedScratch;
+		std::vector<uint32_t> m_requests;
+
+		uint64_t m_frame = 0;
+		TextureStreamerStats m_stats;
+
+		void LinkLast(uint32_t texture);
+		void Unlink(uint32_t texture);
+		uint64_t GetSize(const Texture& texture, uint32_t firstMip) const;
+		// Drops the finest mip of the least recently used texture that has one it doesn't want, starting the
+		// search at cursor. False if there's none.
+		bool EvictOne(uint32_t& cursor, std::vector<TextureStreamEvent>& events);
+		void Load(uint32_t texture, uint32_t mip);
+
+	public:
+		TextureStreamer() = default;
+		~TextureStreamer();
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// jobSystem can be null, loads then run inside Update
+		void Initialize(JobSystem* jobSystem, const LoadFunction& load, uint64_t budget, uint32_t maxLoadsInFlight);
+		// Waits for the loads in flight, their results are dropped
+		void Shutdown();
+
+		// mipSizes[mipLevels] are what each mip costs in memory, tailMip < mipLevels <= MaxMipLevels. The caller
+		// has made mips tailMip and down resident already. The index is the texture's slot in the feedback buffer.
+		uint32_t Register(uint32_t mipLevels, const uint64_t* mipSizes, uint32_t tailMip);
+		// Its memory is the caller's to free, a load still in flight for it is thrown away
+		void Unregister(uint32_t texture);
+
+		// Takes effect on the next Update, a lower budget evicts until it fits
+		void SetBudget(uint64_t budget) { m_stats.budget = budget; }
+
+		// Once a frame, with the feedback the GPU wrote for a finished frame. feedback[texture] is the finest mip
+		// it sampled or NotRequested, textures past feedbackCount count as not sampled. events is overwritten.
+		void Update(const uint32_t* feedback, uint32_t feedbackCount, std::vector<TextureStreamEvent>& events);
+
+		uint32_t GetResidentMip(uint32_t texture) const { return m_textures[texture].residentMip; }
+		uint32_t GetWantedMip(uint32_t texture) const { return m_textures[texture].wantedMip; }
+		bool IsLoading(uint32_t texture) const { return m_textures[texture].loadingMip != InvalidMip; }
+		const TextureStreamerStats& GetStats() const { return m_stats; }
+};
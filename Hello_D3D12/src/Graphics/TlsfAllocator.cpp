@@ -0,0 +1,316 @@
+#include "TlsfAllocator.h"
+#include "../Core/BitUtils.h"
+#include <cassert>
+
+TlsfAllocator::TlsfAllocator() {
+	Initialize(0);
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t size) {
+	Initialize(size);
+}
+
+void TlsfAllocator::Initialize(uint64_t size) {
+	m_nodes.clear();
+	m_unusedNodes.clear();
+
+	m_firstLevelBitmap = 0;
+	for (uint32_t i{ 0 }; i < FirstLevelCount; i++)
+	{
+		m_secondLevelBitmaps[i] = 0;
+		for (uint32_t j{ 0 }; j < SecondLevelCount; j++)
+		{
+			m_freeLists[i][j] = InvalidNode;
+		}
+	}
+
+	m_size = size;
+	m_usedSize = 0;
+	m_allocationCount = 0;
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	// One free block covering everything. Node 0 always stays the first physical block.
+	const uint32_t node = CreateNode();
+	m_nodes[node].offset = 0;
+	m_nodes[node].size = size;
+	m_nodes[node].isFree = true;
+	InsertFree(node);
+}
+
+uint32_t TlsfAllocator::CreateNode() {
+	Node node = {};
+	node.prevPhysical = InvalidNode;
+	node.nextPhysical = InvalidNode;
+	node.prevFree = InvalidNode;
+	node.nextFree = InvalidNode;
+
+	if (!m_unusedNodes.empty())
+	{
+		const uint32_t index = m_unusedNodes.back();
+		m_unusedNodes.pop_back();
+		m_nodes[index] = node;
+		return index;
+	}
+
+	m_nodes.push_back(node);
+	return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void TlsfAllocator::ReleaseNode(uint32_t node) {
+	m_nodes[node].size = 0;
+	m_unusedNodes.push_back(node);
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+	if (size < SecondLevelCount)
+	{
+		// Tiny sizes all live in the first row, one list per byte count
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(size);
+		return;
+	}
+
+	const uint32_t log2 = FindHighestSetBit(size);
+	firstLevel = log2 - SecondLevelLog2 + 1;
+	secondLevel = static_cast<uint32_t>(size >> (log2 - SecondLevelLog2)) ^ SecondLevelCount;
+}
+
+void TlsfAllocator::InsertFree(uint32_t node) {
+	uint32_t firstLevel, secondLevel;
+	Mapping(m_nodes[node].size, firstLevel, secondLevel);
+
+	const uint32_t head = m_freeLists[firstLevel][secondLevel];
+	m_nodes[node].prevFree = InvalidNode;
+	m_nodes[node].nextFree = head;
+	if (head != InvalidNode)
+	{
+		m_nodes[head].prevFree = node;
+	}
+
+	m_freeLists[firstLevel][secondLevel] = node;
+	m_firstLevelBitmap |= (1ull << firstLevel);
+	m_secondLevelBitmaps[firstLevel] |= (1u << secondLevel);
+}
+
+void TlsfAllocator::RemoveFree(uint32_t node) {
+	uint32_t firstLevel, secondLevel;
+	Mapping(m_nodes[node].size, firstLevel, secondLevel);
+
+	const uint32_t prev = m_nodes[node].prevFree;
+	const uint32_t next = m_nodes[node].nextFree;
+	if (prev != InvalidNode)
+	{
+		m_nodes[prev].nextFree = next;
+	}
+	else
+	{
+		m_freeLists[firstLevel][secondLevel] = next;
+	}
+	if (next != InvalidNode)
+	{
+		m_nodes[next].prevFree = prev;
+	}
+
+	if (m_freeLists[firstLevel][secondLevel] == InvalidNode)
+	{
+		m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+		if (m_secondLevelBitmaps[firstLevel] == 0)
+		{
+			m_firstLevelBitmap &= ~(1ull << firstLevel);
+		}
+	}
+
+	m_nodes[node].prevFree = InvalidNode;
+	m_nodes[node].nextFree = InvalidNode;
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t size) {
+
+	// Round up to the next list boundary so any block in the list we land on is big enough
+	uint64_t searchSize = size;
+	if (size >= SecondLevelCount)
+	{
+		searchSize += (1ull << (FindHighestSetBit(size) - SecondLevelLog2)) - 1;
+	}
+
+	uint32_t firstLevel, secondLevel;
+	Mapping(searchSize, firstLevel, secondLevel);
+
+	uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		// Nothing left in this row, take the smallest non empty row above it
+		const uint64_t firstLevelMap = m_firstLevelBitmap & (~0ull << (firstLevel + 1));
+		if (firstLevelMap == 0)
+		{
+			return InvalidNode;
+		}
+
+		firstLevel = FindLowestSetBit(firstLevelMap);
+		secondLevelMap = m_secondLevelBitmaps[firstLevel];
+	}
+
+	secondLevel = FindLowestSetBit(secondLevelMap);
+	return m_freeLists[firstLevel][secondLevel];
+}
+
+void TlsfAllocator::SplitFront(uint32_t node, uint64_t size) {
+	assert(m_nodes[node].size > size);
+
+	// CreateNode can grow the vector, so only index from here on
+	const uint32_t remainder = CreateNode();
+	m_nodes[remainder].offset = m_nodes[node].offset + size;
+	m_nodes[remainder].size = m_nodes[node].size - size;
+	m_nodes[remainder].isFree = true;
+	m_nodes[remainder].prevPhysical = node;
+	m_nodes[remainder].nextPhysical = m_nodes[node].nextPhysical;
+
+	if (m_nodes[node].nextPhysical != InvalidNode)
+	{
+		m_nodes[m_nodes[node].nextPhysical].prevPhysical = remainder;
+	}
+
+	m_nodes[node].nextPhysical = remainder;
+	m_nodes[node].size = size;
+
+	InsertFree(remainder);
+}
+
+bool TlsfAllocator::Fits(uint32_t node, uint64_t size, uint64_t alignment) const {
+	const uint64_t padding = AlignUp(m_nodes[node].offset, alignment) - m_nodes[node].offset;
+	return m_nodes[node].size >= size + padding;
+}
+
+bool TlsfAllocator::Allocate(uint64_t size, uint64_t alignment, TlsfAllocation& allocation) {
+	assert(size > 0);
+	assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+	// Most blocks are aligned already (everything is carved in aligned sizes), so try without any slack first
+	uint32_t node = FindFree(size);
+	if (node != InvalidNode && !Fits(node, size, alignment))
+	{
+		// Enough slack that whatever comes back can be aligned
+		node = alignment > 1 ? FindFree(size + alignment - 1) : InvalidNode;
+	}
+	if (node == InvalidNode)
+	{
+		// Last resort, a block in size's own list that happens to be big enough once aligned. The lookups above
+		// skip that list since not every block in it is.
+		uint32_t firstLevel, secondLevel;
+		Mapping(size, firstLevel, secondLevel);
+		node = m_freeLists[firstLevel][secondLevel];
+		while (node != InvalidNode && !Fits(node, size, alignment))
+		{
+			node = m_nodes[node].nextFree;
+		}
+	}
+	if (node == InvalidNode)
+	{
+		return false;
+	}
+
+	RemoveFree(node);
+
+	// Give the alignment padding back as its own free block
+	const uint64_t padding = AlignUp(m_nodes[node].offset, alignment) - m_nodes[node].offset;
+	if (padding > 0)
+	{
+		SplitFront(node, padding);
+		const uint32_t aligned = m_nodes[node].nextPhysical;
+		RemoveFree(aligned);
+		InsertFree(node);
+		node = aligned;
+	}
+
+	if (m_nodes[node].size > size)
+	{
+		SplitFront(node, size);
+	}
+
+	m_nodes[node].isFree = false;
+	m_usedSize += m_nodes[node].size;
+	m_allocationCount++;
+
+	allocation.offset = m_nodes[node].offset;
+	allocation.size = m_nodes[node].size;
+	allocation.node = node;
+	return true;
+}
+
+void TlsfAllocator::Free(const TlsfAllocation& allocation) {
+	uint32_t node = allocation.node;
+	assert(node < m_nodes.size() && !m_nodes[node].isFree);
+
+	m_usedSize -= m_nodes[node].size;
+	m_allocationCount--;
+	m_nodes[node].isFree = true;
+
+	// Merge with the block before
+	const uint32_t prev = m_nodes[node].prevPhysical;
+	if (prev != InvalidNode && m_nodes[prev].isFree)
+	{
+		RemoveFree(prev);
+		m_nodes[prev].size += m_nodes[node].size;
+		m_nodes[prev].nextPhysical = m_nodes[node].nextPhysical;
+		if (m_nodes[node].nextPhysical != InvalidNode)
+		{
+			m_nodes[m_nodes[node].nextPhysical].prevPhysical = prev;
+		}
+
+		ReleaseNode(node);
+		node = prev;
+	}
+
+	// And with the block after
+	const uint32_t next = m_nodes[node].nextPhysical;
+	if (next != InvalidNode && m_nodes[next].isFree)
+	{
+		RemoveFree(next);
+		m_nodes[node].size += m_nodes[next].size;
+		m_nodes[node].nextPhysical = m_nodes[next].nextPhysical;
+		if (m_nodes[next].nextPhysical != InvalidNode)
+		{
+			m_nodes[m_nodes[next].nextPhysical].prevPhysical = node;
+		}
+
+		ReleaseNode(next);
+	}
+
+	InsertFree(node);
+}
+
+TlsfStats TlsfAllocator::GetStats() const {
+	TlsfStats stats;
+	stats.totalSize = m_size;
+	stats.usedSize = m_usedSize;
+	stats.allocationCount = m_allocationCount;
+
+	if (m_nodes.empty())
+	{
+		return stats;
+	}
+
+	for (uint32_t node = 0; node != InvalidNode; node = m_nodes[node].nextPhysical)
+	{
+		if (m_nodes[node].isFree)
+		{
+			stats.freeBlockCount++;
+			if (m_nodes[node].size > stats.largestFreeBlock)
+			{
+				stats.largestFreeBlock = m_nodes[node].size;
+			}
+		}
+	}
+
+	const uint64_t freeSize = m_size - m_usedSize;
+	if (freeSize > 0)
+	{
+		stats.fragmentation = 1.0f - static_cast<float>(static_cast<double>(stats.largestFreeBlock) / static_cast<double>(freeSize));
+	}
+
+	return stats;
+}
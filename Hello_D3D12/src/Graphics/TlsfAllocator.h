@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct TlsfAllocation
+{
+	uint64_t offset = 0;
+	uint64_t size = 0;
+	uint32_t node = 0xFFFFFFFF;		// Handle back into the allocator, needed to free
+};
+
+struct TlsfStats
+{
+	uint64_t totalSize = 0;
+	uint64_t usedSize = 0;
+	uint64_t largestFreeBlock = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeBlockCount = 0;
+	float fragmentation = 0.0f;		// 0 means all free space is one block
+};
+
+// Two level segregated fit allocator over an abstract range of offsets [0, size).
+// No memory is touched, it only hands out offsets, so it can carve an ID3D12Heap (or anything else).
+// Allocate and free are O(1): two bitmap lookups to find a free list, then split/merge with physical neighbours.
+class TlsfAllocator {
+	public:
+		static const uint64_t InvalidOffset = ~0ull;
+		static const uint32_t InvalidNode = 0xFFFFFFFF;
+
+	private:
+		static const uint32_t SecondLevelLog2 = 4;
+		static const uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+		static const uint32_t FirstLevelCount = 64 - SecondLevelLog2 + 1;
+
+		struct Node
+		{
+			uint64_t offset;
+			uint64_t size;
+			uint32_t prevPhysical;
+			uint32_t nextPhysical;
+			uint32_t prevFree;
+			uint32_t nextFree;
+			bool isFree;
+		};
+
+		std::vector<Node> m_nodes;
+		std::vector<uint32_t> m_unusedNodes;
+
+		uint64_t m_firstLevelBitmap;
+		uint32_t m_secondLevelBitmaps[FirstLevelCount];
+		uint32_t m_freeLists[FirstLevelCount][SecondLevelCount];
+
+		uint64_t m_size;
+		uint64_t m_usedSize;
+		uint32_t m_allocationCount;
+
+		uint32_t CreateNode();
+		void ReleaseNode(uint32_t node);
+
+		static void Mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+		void InsertFree(uint32_t node);
+		void RemoveFree(uint32_t node);
+		// Head of the first free list whose blocks are all at least size, InvalidNode if there's none
+		uint32_t FindFree(uint64_t size);
+		// Whether size bytes aligned to alignment fit in the free node
+		bool Fits(uint32_t node, uint64_t size, uint64_t alignment) const;
+		// Splits size bytes off the front of node, the remainder becomes a new free node
+		void SplitFront(uint32_t node, uint64_t size);
+
+	public:
+		TlsfAllocator();
+		explicit TlsfAllocator(uint64_t size);
+
+		void Initialize(uint64_t size);
+
+		// Alignment must be a power of two. Returns false when no free block is big enough.
+		bool Allocate(uint64_t size, uint64_t alignment, TlsfAllocation& allocation);
+		void Free(const TlsfAllocation& allocation);
+
+		// Walks every node, not meant for per allocation use
+		TlsfStats GetStats() const;
+
+		uint64_t GetSize() const { return m_size; }
+		uint64_t GetUsedSize() const { return m_usedSize; }
+		uint32_t GetAllocationCount() const { return m_allocationCount; }
+		bool IsEmpty() const { return m_allocationCount == 0; }
+};
@@ -0,0 +1,351 @@
+#include "TransformKernels.h"
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+	typedef void(*MultiplyMatricesFunction)(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count);
+	typedef void(*TransformPointsFunction)(const glm::mat4& matrix, const glm::vec4* points, glm::vec4* out, size_t count);
+	typedef void(*TransformAabbsFunction)(const glm::mat4& matrix, const Aabb* boxes, Aabb* out, size_t count);
+
+	struct KernelTable
+	{
+		SimdLevel level;
+		MultiplyMatricesFunction multiplyMatrices;
+		TransformPointsFunction transformPoints;
+		TransformAabbsFunction transformAabbs;
+	};
+
+	// Plain glm, the reference the others are checked against
+
+	void MultiplyMatricesScalar(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			out[i] = left * right[i];
+		}
+	}
+
+	void TransformPointsScalar(const glm::mat4& matrix, const glm::vec4* points, glm::vec4* out, size_t count) {
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			out[i] = matrix * points[i];
+		}
+	}
+
+	void TransformAabbsScalar(const glm::mat4& matrix, const Aabb* boxes, Aabb* out, size_t count) {
+		const glm::mat3 absolute(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			const glm::vec3 center = (boxes[i].min + boxes[i].max) * 0.5f;
+			const glm::vec3 extent = (boxes[i].max - boxes[i].min) * 0.5f;
+			const glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+			const glm::vec3 newExtent = absolute * extent;
+			out[i].min = newCenter - newExtent;
+			out[i].max = newCenter + newExtent;
+		}
+	}
+
+#ifdef CPU_FEATURES_X86
+
+	// SSE2, every x64 CPU has it. Column j of the product is left's columns weighted by the lanes of column j.
+
+	void MultiplyMatricesSse2(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+		const float* l = &left[0][0];
+		const __m128 l0 = _mm_loadu_ps(l);
+		const __m128 l1 = _mm_loadu_ps(l + 4);
+		const __m128 l2 = _mm_loadu_ps(l + 8);
+		const __m128 l3 = _mm_loadu_ps(l + 12);
+
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			const float* r = &right[i][0][0];
+			float* o = &out[i][0][0];
+			for (int column{ 0 }; column < 4; column++)
+			{
+				const __m128 c = _mm_loadu_ps(r + column * 4);
+				__m128 result = _mm_mul_ps(l0, _mm_shuffle_ps(c, c, 0x00));
+				result = _mm_add_ps(result, _mm_mul_ps(l1, _mm_shuffle_ps(c, c, 0x55)));
+				result = _mm_add_ps(result, _mm_mul_ps(l2, _mm_shuffle_ps(c, c, 0xAA)));
+				result = _mm_add_ps(result, _mm_mul_ps(l3, _mm_shuffle_ps(c, c, 0xFF)));
+				_mm_storeu_ps(o + column * 4, result);
+			}
+		}
+	}
+
+	void TransformPointsSse2(const glm::mat4& matrix, const glm::vec4* points, glm::vec4* out, size_t count) {
+		const float* m = &matrix[0][0];
+		const __m128 m0 = _mm_loadu_ps(m);
+		const __m128 m1 = _mm_loadu_ps(m + 4);
+		const __m128 m2 = _mm_loadu_ps(m + 8);
+		const __m128 m3 = _mm_loadu_ps(m + 12);
+
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			const __m128 p = _mm_loadu_ps(&points[i].x);
+			__m128 result = _mm_mul_ps(m0, _mm_shuffle_ps(p, p, 0x00));
+			result = _mm_add_ps(result, _mm_mul_ps(m1, _mm_shuffle_ps(p, p, 0x55)));
+			result = _mm_add_ps(result, _mm_mul_ps(m2, _mm_shuffle_ps(p, p, 0xAA)));
+			result = _mm_add_ps(result, _mm_mul_ps(m3, _mm_shuffle_ps(p, p, 0xFF)));
+			_mm_storeu_ps(&out[i].x, result);
+		}
+	}
+
+	// Boxes are 6 floats, min is loaded as [min.xyz, max.x] and max as [min.z, max.xyz] so nothing reads past the
+	// box. The stores go in the same overlapping way, min first.
+	void TransformAabbsSse2(const glm::mat4& matrix, const Aabb* boxes, Aabb* out, size_t count) {
+		const float* m = &matrix[0][0];
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 m0 = _mm_loadu_ps(m);
+		const __m128 m1 = _mm_loadu_ps(m + 4);
+		const __m128 m2 = _mm_loadu_ps(m + 8);
+		const __m128 m3 = _mm_loadu_ps(m + 12);
+		const __m128 a0 = _mm_and_ps(m0, signMask);
+		const __m128 a1 = _mm_and_ps(m1, signMask);
+		const __m128 a2 = _mm_and_ps(m2, signMask);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			const float* box = &boxes[i].min.x;
+			const __m128 boxMin = _mm_loadu_ps(box);
+			const __m128 shiftedMax = _mm_loadu_ps(box + 2);
+			const __m128 boxMax = _mm_shuffle_ps(shiftedMax, shiftedMax, _MM_SHUFFLE(3, 3, 2, 1));
+			const __m128 center = _mm_mul_ps(_mm_add_ps(boxMin, boxMax), half);
+			const __m128 extent = _mm_mul_ps(_mm_sub_ps(boxMax, boxMin), half);
+
+			__m128 newCenter = _mm_add_ps(m3, _mm_mul_ps(m0, _mm_shuffle_ps(center, center, 0x00)));
+			newCenter = _mm_add_ps(newCenter, _mm_mul_ps(m1, _mm_shuffle_ps(center, center, 0x55)));
+			newCenter = _mm_add_ps(newCenter, _mm_mul_ps(m2, _mm_shuffle_ps(center, center, 0xAA)));
+			__m128 newExtent = _mm_mul_ps(a0, _mm_shuffle_ps(extent, extent, 0x00));
+			newExtent = _mm_add_ps(newExtent, _mm_mul_ps(a1, _mm_shuffle_ps(extent, extent, 0x55)));
+			newExtent = _mm_add_ps(newExtent, _mm_mul_ps(a2, _mm_shuffle_ps(extent, extent, 0xAA)));
+
+			const __m128 newMin = _mm_sub_ps(newCenter, newExtent);
+			const __m128 newMax = _mm_add_ps(newCenter, newExtent);
+			// [newMin.z, newMax.x, newMax.y, newMax.z]
+			const __m128 mixed = _mm_shuffle_ps(newMin, newMax, _MM_SHUFFLE(1, 0, 2, 2));
+			const __m128 shiftedNewMax = _mm_shuffle_ps(mixed, newMax, _MM_SHUFFLE(2, 1, 2, 0));
+
+			float* target = &out[i].min.x;
+			_mm_storeu_ps(target, newMin);
+			_mm_storeu_ps(target + 2, shiftedNewMax);
+		}
+	}
+
+	// AVX2 + FMA, two columns (or points) per register. The in-lane shuffle broadcasts each half's own lanes.
+
+	SIMD_TARGET_AVX2 void MultiplyMatricesAvx2(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+		const float* l = &left[0][0];
+		const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l));
+		const __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l + 4));
+		const __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l + 8));
+		const __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(l + 12));
+
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			const float* r = &right[i][0][0];
+			float* o = &out[i][0][0];
+			const __m256 c01 = _mm256_loadu_ps(r);
+			const __m256 c23 = _mm256_loadu_ps(r + 8);
+
+			__m256 result01 = _mm256_mul_ps(l0, _mm256_shuffle_ps(c01, c01, 0x00));
+			__m256 result23 = _mm256_mul_ps(l0, _mm256_shuffle_ps(c23, c23, 0x00));
+			result01 = _mm256_fmadd_ps(l1, _mm256_shuffle_ps(c01, c01, 0x55), result01);
+			result23 = _mm256_fmadd_ps(l1, _mm256_shuffle_ps(c23, c23, 0x55), result23);
+			result01 = _mm256_fmadd_ps(l2, _mm256_shuffle_ps(c01, c01, 0xAA), result01);
+			result23 = _mm256_fmadd_ps(l2, _mm256_shuffle_ps(c23, c23, 0xAA), result23);
+			result01 = _mm256_fmadd_ps(l3, _mm256_shuffle_ps(c01, c01, 0xFF), result01);
+			result23 = _mm256_fmadd_ps(l3, _mm256_shuffle_ps(c23, c23, 0xFF), result23);
+			_mm256_storeu_ps(o, result01);
+			_mm256_storeu_ps(o + 8, result23);
+		}
+	}
+
+	SIMD_TARGET_AVX2 void TransformPointsAvx2(const glm::mat4& matrix, const glm::vec4* points, glm::vec4* out, size_t count) {
+		const float* m = &matrix[0][0];
+		const __m256 m0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+		const __m256 m1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+		const __m256 m2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+		const __m256 m3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+
+		size_t i{ 0 };
+		for (; i + 2 <= count; i += 2)
+		{
+			const __m256 p = _mm256_loadu_ps(&points[i].x);
+			__m256 result = _mm256_mul_ps(m0, _mm256_shuffle_ps(p, p, 0x00));
+			result = _mm256_fmadd_ps(m1, _mm256_shuffle_ps(p, p, 0x55), result);
+			result = _mm256_fmadd_ps(m2, _mm256_shuffle_ps(p, p, 0xAA), result);
+			result = _mm256_fmadd_ps(m3, _mm256_shuffle_ps(p, p, 0xFF), result);
+			_mm256_storeu_ps(&out[i].x, result);
+		}
+
+		TransformPointsSse2(matrix, points + i, out + i, count - i);
+	}
+
+	// Two boxes a register, same overlapping loads as the SSE2 one
+	SIMD_TARGET_AVX2 void TransformAabbsAvx2(const glm::mat4& matrix, const Aabb* boxes, Aabb* out, size_t count) {
+		const float* m = &matrix[0][0];
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		const __m256 m0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+		const __m256 m1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+		const __m256 m2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+		const __m256 m3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+		const __m256 a0 = _mm256_and_ps(m0, signMask);
+		const __m256 a1 = _mm256_and_ps(m1, signMask);
+		const __m256 a2 = _mm256_and_ps(m2, signMask);
+		const __m256 half = _mm256_set1_ps(0.5f);
+
+		size_t i{ 0 };
+		for (; i + 2 <= count; i += 2)
+		{
+			const float* box = &boxes[i].min.x;
+			// Box i + 1 starts 6 floats later
+			const __m256 boxMin = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(box)), _mm_loadu_ps(box + 6), 1);
+			const __m256 shiftedMax = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(box + 2)), _mm_loadu_ps(box + 8), 1);
+			const __m256 boxMax = _mm256_shuffle_ps(shiftedMax, shiftedMax, _MM_SHUFFLE(3, 3, 2, 1));
+			const __m256 center = _mm256_mul_ps(_mm256_add_ps(boxMin, boxMax), half);
+			const __m256 extent = _mm256_mul_ps(_mm256_sub_ps(boxMax, boxMin), half);
+
+			__m256 newCenter = _mm256_fmadd_ps(m0, _mm256_shuffle_ps(center, center, 0x00), m3);
+			newCenter = _mm256_fmadd_ps(m1, _mm256_shuffle_ps(center, center, 0x55), newCenter);
+			newCenter = _mm256_fmadd_ps(m2, _mm256_shuffle_ps(center, center, 0xAA), newCenter);
+			__m256 newExtent = _mm256_mul_ps(a0, _mm256_shuffle_ps(extent, extent, 0x00));
+			newExtent = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(extent, extent, 0x55), newExtent);
+			newExtent = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(extent, extent, 0xAA), newExtent);
+
+			const __m256 newMin = _mm256_sub_ps(newCenter, newExtent);
+			const __m256 newMax = _mm256_add_ps(newCenter, newExtent);
+			const __m256 mixed = _mm256_shuffle_ps(newMin, newMax, _MM_SHUFFLE(1, 0, 2, 2));
+			const __m256 shiftedNewMax = _mm256_shuffle_ps(mixed, newMax, _MM_SHUFFLE(2, 1, 2, 0));
+
+			float* target = &out[i].min.x;
+			_mm_storeu_ps(target, _mm256_castps256_ps128(newMin));
+			_mm_storeu_ps(target + 2, _mm256_castps256_ps128(shiftedNewMax));
+			_mm_storeu_ps(target + 6, _mm256_extractf128_ps(newMin, 1));
+			_mm_storeu_ps(target + 8, _mm256_extractf128_ps(shiftedNewMax, 1));
+		}
+
+		TransformAabbsSse2(matrix, boxes + i, out + i, count - i);
+	}
+
+	// AVX-512, a whole matrix (or four points) per register
+
+	// GCC 12 implements the unmasked AVX-512 intrinsics as masked ones merging into _mm512_undefined_ps(), a self
+	// initialized variable, and -Wall calls that (maybe) uninitialized once they're inlined here. Nothing is read from it.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+	SIMD_TARGET_AVX512 void MultiplyMatricesAvx512(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+		const float* l = &left[0][0];
+		const __m512 l0 = _mm512_broadcast_f32x4(_mm_loadu_ps(l));
+		const __m512 l1 = _mm512_broadcast_f32x4(_mm_loadu_ps(l + 4));
+		const __m512 l2 = _mm512_broadcast_f32x4(_mm_loadu_ps(l + 8));
+		const __m512 l3 = _mm512_broadcast_f32x4(_mm_loadu_ps(l + 12));
+
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			const __m512 c = _mm512_loadu_ps(&right[i][0][0]);
+			__m512 result = _mm512_mul_ps(l0, _mm512_permute_ps(c, 0x00));
+			result = _mm512_fmadd_ps(l1, _mm512_permute_ps(c, 0x55), result);
+			result = _mm512_fmadd_ps(l2, _mm512_permute_ps(c, 0xAA), result);
+			result = _mm512_fmadd_ps(l3, _mm512_permute_ps(c, 0xFF), result);
+			_mm512_storeu_ps(&out[i][0][0], result);
+		}
+	}
+
+	SIMD_TARGET_AVX512 void TransformPointsAvx512(const glm::mat4& matrix, const glm::vec4* points, glm::vec4* out, size_t count) {
+		const float* m = &matrix[0][0];
+		const __m512 m0 = _mm512_broadcast_f32x4(_mm_loadu_ps(m));
+		const __m512 m1 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 4));
+		const __m512 m2 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 8));
+		const __m512 m3 = _mm512_broadcast_f32x4(_mm_loadu_ps(m + 12));
+
+		size_t i{ 0 };
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m512 p = _mm512_loadu_ps(&points[i].x);
+			__m512 result = _mm512_mul_ps(m0, _mm512_permute_ps(p, 0x00));
+			result = _mm512_fmadd_ps(m1, _mm512_permute_ps(p, 0x55), result);
+			result = _mm512_fmadd_ps(m2, _mm512_permute_ps(p, 0xAA), result);
+			result = _mm512_fmadd_ps(m3, _mm512_permute_ps(p, 0xFF), result);
+			_mm512_storeu_ps(&out[i].x, result);
+		}
+
+		TransformPointsAvx2(matrix, points + i, out + i, count - i);
+	}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+	KernelTable MakeKernelTable(SimdLevel level) {
+		KernelTable table = { SimdLevel::Scalar, MultiplyMatricesScalar, TransformPointsScalar, TransformAabbsScalar };
+#ifdef CPU_FEATURES_X86
+		if (level >= SimdLevel::SSE2)
+		{
+			table = { SimdLevel::SSE2, MultiplyMatricesSse2, TransformPointsSse2, TransformAabbsSse2 };
+		}
+		if (level >= SimdLevel::AVX2)
+		{
+			table = { SimdLevel::AVX2, MultiplyMatricesAvx2, TransformPointsAvx2, TransformAabbsAvx2 };
+		}
+		// Boxes don't fill a 512 bit register without a gather, the AVX2 kernel is as good as it gets
+		if (level >= SimdLevel::AVX512)
+		{
+			table = { SimdLevel::AVX512, MultiplyMatricesAvx512, TransformPointsAvx512, TransformAabbsAvx2 };
+		}
+#endif
+		return table;
+	}
+
+	const KernelTable& GetKernels() {
+		static const SimdKernelTables<KernelTable> tables(MakeKernelTable);
+		return tables.Get();
+	}
+}
+
+void MultiplyMatrices(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count) {
+	GetKernels().multiplyMatrices(left, right, out, count);
+}
+
+void ComposeHierarchy(const glm::mat4* local, const uint32_t* parents, glm::mat4* world, size_t count) {
+	const MultiplyMatricesFunction multiply = GetKernels().multiplyMatrices;
+	for (size_t i{ 0 }; i < count;)
+	{
+		if (parents[i] == InvalidParent)
+		{
+			world[i] = local[i];
+			i++;
+			continue;
+		}
+
+		// Siblings stored next to each other share the left matrix, one kernel call for the whole run. Their
+		// parent comes before all of them so it's never written by the call that reads it.
+		size_t end{ i + 1 };
+		while (end < count && parents[end] == parents[i])
+		{
+			end++;
+		}
+		multiply(world[parents[i]], local + i, world + i, end - i);
+		i = end;
+	}
+}
+
+void TransformPoints(const glm::mat4& matrix, const glm::vec4* points, glm::vec4* out, size_t count) {
+	GetKernels().transformPoints(matrix, points, out, count);
+}
+
+void TransformAabbs(const glm::mat4& matrix, const Aabb* boxes, Aabb* out, size_t count) {
+	GetKernels().transformAabbs(matrix, boxes, out, count);
+}
+
+SimdLevel GetTransformKernelLevel() {
+	return GetKernels().level;
+}
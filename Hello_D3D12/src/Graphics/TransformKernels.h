@@ -0,0 +1,32 @@
+#pragma once
+#include "../Core/CpuFeatures.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+struct Aabb
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+static const uint32_t InvalidParent = 0xFFFFFFFF;
+
+// Batched versions of glm's matrix products, for whole arrays of transforms at once. The kernel is picked at
+// runtime from what the CPU supports (SSE2, AVX2 + FMA, AVX-512), so one build runs everywhere. FMA rounds
+// differently from glm's separate multiplies and adds, results can be off from glm in the last bit or so.
+// out may be the same array as the input in all of them.
+
+// out[i] = left * right[i]
+void MultiplyMatrices(const glm::mat4& left, const glm::mat4* right, glm::mat4* out, size_t count);
+// world[i] = world[parents[i]] * local[i], or just local[i] for InvalidParent. Parents have to come before
+// their children so the whole hierarchy resolves in one pass. Runs of siblings go through the kernel in one
+// call, so storing children together (breadth first) is faster.
+void ComposeHierarchy(const glm::mat4* local, const uint32_t* parents, glm::mat4* world, size_t count);
+// out[i] = matrix * points[i]
+void TransformPoints(const glm::mat4& matrix, const glm::vec4* points, glm::vec4* out, size_t count);
+// The box around each transformed box (Arvo), matrix has to be affine
+void TransformAabbs(const glm::mat4& matrix, const Aabb* boxes, Aabb* out, size_t count);
+
+// The widest kernels in use. Boxes stay on AVX2 under AVX-512.
+SimdLevel GetTransformKernelLevel();
@@ -0,0 +1,163 @@
+#include "TransformStore.h"
+#include "../Core/BitUtils.h"
+#include <cassert>
+#include <cstring>
+
+void TransformStore::Reserve(uint32_t count) {
+	for (std::vector<float>* plane : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW, &m_scaleX, &m_scaleY, &m_scaleZ })
+	{
+		plane->reserve(count);
+	}
+	m_parents.reserve(count);
+	m_firstChild.reserve(count);
+	m_nextSibling.reserve(count);
+	m_world.reserve(count);
+	m_dirty.reserve((count + 63) / 64);
+}
+
+void TransformStore::Clear() {
+	for (std::vector<float>* plane : { &m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY, &m_rotationZ, &m_rotationW, &m_scaleX, &m_scaleY, &m_scaleZ })
+	{
+		plane->clear();
+	}
+	m_parents.clear();
+	m_firstChild.clear();
+	m_nextSibling.clear();
+	m_world.clear();
+	m_dirty.clear();
+	m_changed.clear();
+}
+
+uint32_t TransformStore::Add(uint32_t parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+	const uint32_t index = GetCount();
+	// Parents first or the single pass in UpdateWorld reads a stale parent
+	assert(parent == InvalidParent || parent < index);
+
+	m_positionX.push_back(position.x);
+	m_positionY.push_back(position.y);
+	m_positionZ.push_back(position.z);
+	m_rotationX.push_back(rotation.x);
+	m_rotationY.push_back(rotation.y);
+	m_rotationZ.push_back(rotation.z);
+	m_rotationW.push_back(rotation.w);
+	m_scaleX.push_back(scale.x);
+	m_scaleY.push_back(scale.y);
+	m_scaleZ.push_back(scale.z);
+
+	m_parents.push_back(parent);
+	m_firstChild.push_back(InvalidParent);
+	m_nextSibling.push_back(InvalidParent);
+	if (parent != InvalidParent)
+	{
+		m_nextSibling[index] = m_firstChild[parent];
+		m_firstChild[parent] = index;
+	}
+
+	m_world.push_back(glm::mat4(1.0f));
+	if ((index >> 6) >= m_dirty.size())
+	{
+		m_dirty.push_back(0);
+	}
+	MarkDirty(index);
+	return index;
+}
+
+void TransformStore::SetPosition(uint32_t node, const glm::vec3& position) {
+	m_positionX[node] = position.x;
+	m_positionY[node] = position.y;
+	m_positionZ[node] = position.z;
+	MarkDirty(node);
+}
+
+void TransformStore::SetRotation(uint32_t node, const glm::quat& rotation) {
+	m_rotationX[node] = rotation.x;
+	m_rotationY[node] = rotation.y;
+	m_rotationZ[node] = rotation.z;
+	m_rotationW[node] = rotation.w;
+	MarkDirty(node);
+}
+
+void TransformStore::SetScale(uint32_t node, const glm::vec3& scale) {
+	m_scaleX[node] = scale.x;
+	m_scaleY[node] = scale.y;
+	m_scaleZ[node] = scale.z;
+	MarkDirty(node);
+}
+
+// translate * mat4_cast(rotation) * scale, written out so nothing gets multiplied by the zeros
+glm::mat4 TransformStore::ComposeLocal(uint32_t node) const {
+	const float x = m_rotationX[node];
+	const float y = m_rotationY[node];
+	const float z = m_rotationZ[node];
+	const float w = m_rotationW[node];
+	const float xx = x * x, yy = y * y, zz = z * z;
+	const float xy = x * y, xz = x * z, yz = y * z;
+	const float wx = w * x, wy = w * y, wz = w * z;
+	const float scaleX = m_scaleX[node];
+	const float scaleY = m_scaleY[node];
+	const float scaleZ = m_scaleZ[node];
+
+	return glm::mat4(
+		(1.0f - 2.0f * (yy + zz)) * scaleX, 2.0f * (xy + wz) * scaleX, 2.0f * (xz - wy) * scaleX, 0.0f,
+		2.0f * (xy - wz) * scaleY, (1.0f - 2.0f * (xx + zz)) * scaleY, 2.0f * (yz + wx) * scaleY, 0.0f,
+		2.0f * (xz + wy) * scaleZ, 2.0f * (yz - wx) * scaleZ, (1.0f - 2.0f * (xx + yy)) * scaleZ, 0.0f,
+		m_positionX[node], m_positionY[node], m_positionZ[node], 1.0f);
+}
+
+uint32_t TransformStore::UpdateWorld() {
+	m_changed.clear();
+
+	// Ascending walk of the dirty set. Rebuilding a node dirties its children, they all have higher indices so
+	// the same walk picks them up later, after their parent is current.
+	const uint32_t wordCount = static_cast<uint32_t>(m_dirty.size());
+	for (uint32_t word{ 0 }; word < wordCount; word++)
+	{
+		uint64_t bits = m_dirty[word];
+		if (bits == 0)
+		{
+			continue;
+		}
+		m_dirty[word] = 0;
+
+		while (bits != 0)
+		{
+			const uint32_t node = (word << 6) + FindLowestSetBit(bits);
+			bits &= bits - 1;
+
+			const glm::mat4 local = ComposeLocal(node);
+			const uint32_t parent = m_parents[node];
+			if (parent == InvalidParent)
+			{
+				m_world[node] = local;
+			}
+			else
+			{
+				MultiplyMatrices(m_world[parent], &local, &m_world[node], 1);
+			}
+			m_changed.push_back(node);
+
+			for (uint32_t child = m_firstChild[node]; child != InvalidParent; child = m_nextSibling[child])
+			{
+				// Children in this word go into the local copy, the word itself is already cleared
+				if ((child >> 6) == word)
+				{
+					bits |= 1ull << (child & 63);
+				}
+				else
+				{
+					MarkDirty(child);
+				}
+			}
+		}
+	}
+
+	return static_cast<uint32_t>(m_changed.size());
+}
+
+void TransformStore::PackChanged(void* destination) const {
+	glm::mat4* out = static_cast<glm::mat4*>(destination);
+	for (uint32_t node : m_changed)
+	{
+		memcpy(out++, &m_world[node], sizeof(glm::mat4));
+	}
+}
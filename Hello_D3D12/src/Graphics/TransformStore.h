@@ -0,0 +1,64 @@
+#pragma once
+#include "TransformKernels.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+
+// Scene node transforms, local position / rotation / scale as structure of arrays and the world matrices built
+// from them. Nodes are added parents first (a parent's index is always lower than its children's), so one pass
+// in index order resolves the whole hierarchy. Setters only flip a bit in the dirty set, UpdateWorld then
+// rebuilds the dirty nodes and everything below them and lists what changed, so only those need uploading.
+class TransformStore {
+	private:
+		std::vector<float> m_positionX;
+		std::vector<float> m_positionY;
+		std::vector<float> m_positionZ;
+		std::vector<float> m_rotationX;
+		std::vector<float> m_rotationY;
+		std::vector<float> m_rotationZ;
+		std::vector<float> m_rotationW;
+		std::vector<float> m_scaleX;
+		std::vector<float> m_scaleY;
+		std::vector<float> m_scaleZ;
+
+		std::vector<uint32_t> m_parents;
+		std::vector<uint32_t> m_firstChild;
+		std::vector<uint32_t> m_nextSibling;
+
+		std::vector<glm::mat4> m_world;
+		std::vector<uint64_t> m_dirty;			// One bit per node, local changes not in m_world yet
+		std::vector<uint32_t> m_changed;		// Nodes the last UpdateWorld rebuilt, ascending
+
+		void MarkDirty(uint32_t node) { m_dirty[node >> 6] |= 1ull << (node & 63); }
+		glm::mat4 ComposeLocal(uint32_t node) const;
+
+	public:
+		void Reserve(uint32_t count);
+		void Clear();
+		// parent is InvalidParent for a root, otherwise an existing node. New nodes start dirty.
+		uint32_t Add(uint32_t parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+		void SetPosition(uint32_t node, const glm::vec3& position);
+		void SetRotation(uint32_t node, const glm::quat& rotation);
+		void SetScale(uint32_t node, const glm::vec3& scale);
+		glm::vec3 GetPosition(uint32_t node) const { return glm::vec3(m_positionX[node], m_positionY[node], m_positionZ[node]); }
+		glm::quat GetRotation(uint32_t node) const { return glm::quat(m_rotationW[node], m_rotationX[node], m_rotationY[node], m_rotationZ[node]); }
+		glm::vec3 GetScale(uint32_t node) const { return glm::vec3(m_scaleX[node], m_scaleY[node], m_scaleZ[node]); }
+
+		// Rebuilds the world matrix of every dirty node and its descendants, clears the dirty set.
+		// Returns how many nodes changed.
+		uint32_t UpdateWorld();
+		const std::vector<uint32_t>& GetChangedNodes() const { return m_changed; }
+		// Changed world matrices in GetChangedNodes order, destination needs GetChangedSize bytes. Each one is a
+		// whole 64 byte copy into the next slot, so an upload heap can be the destination.
+		uint64_t GetChangedSize() const { return m_changed.size() * sizeof(glm::mat4); }
+		void PackChanged(void* destination) const;
+
+		bool IsDirty(uint32_t node) const { return (m_dirty[node >> 6] >> (node & 63)) & 1; }
+		uint32_t GetCount() const { return static_cast<uint32_t>(m_parents.size()); }
+		uint32_t GetParent(uint32_t node) const { return m_parents[node]; }
+		// Only current after UpdateWorld
+		const glm::mat4& GetWorld(uint32_t node) const { return m_world[node]; }
+		const glm::mat4* GetWorldMatrices() const { return m_world.data(); }
+};
@@ -0,0 +1,329 @@
+#include "UploadService.h"
+#include <vector>
+
+void UploadService::Initialize(ID3D12Device8* device, GpuHeapAllocator* gpuHeap, UINT64 stagingSize) {
+	m_device = device;
+	m_gpuHeap = gpuHeap;
+	m_nextFenceValue = 1;
+	m_recording = false;
+
+	D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+	queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	DXCall(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_copyQueue)));
+	NAME_D3D12_OBJECT(m_copyQueue, L"UploadCopyQueue");
+
+	DXCall(m_device->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_COPY, D3D12_COMMAND_LIST_FLAG_NONE, IID_PPV_ARGS(&m_commandList)));
+
+	DXCall(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+	m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+	if (m_fenceEvent == nullptr)
+	{
+		DXCall(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	// One staging buffer for the lifetime of the service, mapped the whole time
+	D3D12_RESOURCE_DESC stagingDesc = {};
+	stagingDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	stagingDesc.Alignment = 0;
+	stagingDesc.Width = stagingSize;
+	stagingDesc.Height = 1;
+	stagingDesc.DepthOrArraySize = 1;
+	stagingDesc.MipLevels = 1;
+	stagingDesc.Format = DXGI_FORMAT_UNKNOWN;
+	stagingDesc.SampleDesc.Count = 1;
+	stagingDesc.SampleDesc.Quality = 0;
+	stagingDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	stagingDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	m_stagingBuffer = m_gpuHeap->CreateResource(stagingDesc, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	// We do not intend to read this resource on CPU
+	D3D12_RANGE readRange = {};
+	DXCall(m_stagingBuffer->resource->Map(0, &readRange, reinterpret_cast<void**>(&m_stagingData)));
+
+	m_ring.Initialize(stagingSize);
+}
+
+void UploadService::Shutdown() {
+	if (!m_device)
+	{
+		return;
+	}
+
+	Wait(Flush());
+
+	m_stagingBuffer->resource->Unmap(0, nullptr);
+	m_gpuHeap->Release(m_stagingBuffer);
+	m_stagingBuffer = nullptr;
+	m_stagingData = nullptr;
+
+	m_allocatorPool.Clear();
+	m_currentAllocator.Reset();
+	m_commandList.Reset();
+	m_copyQueue.Reset();
+	m_fence.Reset();
+	CloseHandle(m_fenceEvent);
+	m_fenceEvent = nullptr;
+	m_device = nullptr;
+}
+
+void UploadService::BeginRecording() {
+	if (m_recording)
+	{
+		return;
+	}
+
+	if (!m_allocatorPool.Acquire(m_fence->GetCompletedValue(), m_currentAllocator))
+	{
+		DXCall(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_currentAllocator)));
+	}
+
+	DXCall(m_currentAllocator->Reset());
+	DXCall(m_commandList->Reset(m_currentAllocator.Get(), nullptr));
+	m_recording = true;
+}
+
+UploadTicket UploadService::SubmitLocked() {
+	UploadTicket ticket;
+	ticket.fenceValue = m_nextFenceValue - 1;
+
+	if (!m_recording)
+	{
+		return ticket;
+	}
+
+	DXCall(m_commandList->Close());
+	ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
+	m_copyQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+	ticket.fenceValue = m_nextFenceValue++;
+	DXCall(m_copyQueue->Signal(m_fence.Get(), ticket.fenceValue));
+
+	m_ring.Submit(ticket.fenceValue);
+	m_allocatorPool.Release(m_currentAllocator, ticket.fenceValue);
+	m_currentAllocator.Reset();
+	m_recording = false;
+	return ticket;
+}
+
+void UploadService::WaitForFenceValue(UINT64 fenceValue) {
+	if (m_fence->GetCompletedValue() < fenceValue)
+	{
+		DXCall(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+
+bool UploadService::AllocateStaging(UINT64 size, UINT64 alignment, StagingAllocation& allocation) {
+	m_ring.Retire(m_fence->GetCompletedValue());
+	if (m_ring.Allocate(size, alignment, allocation))
+	{
+		return true;
+	}
+
+	// Full, push out what's recorded and block on the oldest batch until there is room
+	SubmitLocked();
+	while (!m_ring.Allocate(size, alignment, allocation))
+	{
+		const UINT64 oldestFenceValue = m_ring.GetOldestFenceValue();
+		if (oldestFenceValue == 0)
+		{
+			spdlog::error("Upload of {} bytes doesn't fit in the {} byte staging ring", size, m_ring.GetCapacity());
+			return false;
+		}
+
+		WaitForFenceValue(oldestFenceValue);
+		m_ring.Retire(m_fence->GetCompletedValue());
+	}
+
+	// The submit above closed the batch, this upload goes in a new one
+	BeginRecording();
+	return true;
+}
+
+UploadTicket UploadService::UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	StagingAllocation allocation;
+	if (!AllocateStaging(size, 16, allocation))
+	{
+		return UploadTicket();
+	}
+
+	memcpy(m_stagingData + allocation.offset, data, static_cast<size_t>(size));
+
+	BeginRecording();
+	m_commandList->CopyBufferRegion(destination, destinationOffset, m_stagingBuffer->resource.Get(), allocation.offset, size);
+
+	UploadTicket ticket;
+	ticket.fenceValue = m_nextFenceValue;
+	return ticket;
+}
+
+UploadTicket UploadService::UploadTexture(ID3D12Resource* destination, const D3D12_SUBRESOURCE_DATA* subresources,
+	UINT firstSubresource, UINT subresourceCount) {
+
+	return UploadTexture(destination, firstSubresource, subresourceCount,
+		[subresources, firstSubresource](UINT subresource, const D3D12_SUBRESOURCE_FOOTPRINT& footprint, UINT firstRow, UINT rowCount,
+			UINT64 rowSize, UINT8* data) {
+			// The staging rows are padded out to the footprint's pitch, the source rows usually aren't
+			const D3D12_SUBRESOURCE_DATA& source = subresources[subresource - firstSubresource];
+			const UINT8* sourceData = static_cast<const UINT8*>(source.pData) + static_cast<UINT64>(firstRow) * source.RowPitch;
+
+			for (UINT z{ 0 }; z < footprint.Depth; z++)
+			{
+				for (UINT row{ 0 }; row < rowCount; row++)
+				{
+					memcpy(data + (static_cast<UINT64>(z) * footprint.RowPitch * rowCount) + (static_cast<UINT64>(row) * footprint.RowPitch),
+						sourceData + (z * source.SlicePitch) + (row * source.RowPitch),
+						static_cast<size_t>(rowSize));
+				}
+			}
+		});
+}
+
+void UploadService::CopyToTexture(ID3D12Resource* destination, UINT subresource, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint, UINT y) {
+	D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+	srcLocation.pResource = m_stagingBuffer->resource.Get();
+	srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+	srcLocation.PlacedFootprint = footprint;
+
+	D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+	dstLocation.pResource = destination;
+	dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+	dstLocation.SubresourceIndex = subresource;
+
+	m_commandList->CopyTextureRegion(&dstLocation, 0, y, 0, &srcLocation, nullptr);
+}
+
+UploadTicket UploadService::UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT subresourceCount, const FillFunction& fill) {
+	const D3D12_RESOURCE_DESC desc = destination->GetDesc();
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(subresourceCount);
+	std::vector<UINT> rowCounts(subresourceCount);
+	std::vector<UINT64> rowSizes(subresourceCount);
+	UINT64 totalSize = 0;
+	m_device->GetCopyableFootprints(&desc, firstSubresource, subresourceCount, 0, footprints.data(), rowCounts.data(),
+		rowSizes.data(), &totalSize);
+
+	// Where each subresource's staging ends, relative to the first one
+	const auto subresourceEnd = [&](UINT i) { return i + 1 < subresourceCount ? footprints[i + 1].Offset : totalSize; };
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Half the ring, a piece the size of the whole ring would have to wait for every copy before it to finish
+	const UINT64 pieceSize = m_ring.GetCapacity() / 2;
+	UINT first = 0;
+	while (first < subresourceCount)
+	{
+		// As many whole subresources as fit in a piece
+		UINT end = first;
+		while (end < subresourceCount && subresourceEnd(end) - footprints[first].Offset <= pieceSize)
+		{
+			end++;
+		}
+
+		if (end > first)
+		{
+			StagingAllocation allocation;
+			if (!AllocateStaging(subresourceEnd(end - 1) - footprints[first].Offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, allocation))
+			{
+				return UploadTicket();
+			}
+
+			BeginRecording();
+			for (UINT i{ first }; i < end; i++)
+			{
+				D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = footprints[i];
+				footprint.Offset = allocation.offset + footprints[i].Offset - footprints[first].Offset;
+				fill(firstSubresource + i, footprint.Footprint, 0, rowCounts[i], rowSizes[i], m_stagingData + footprint.Offset);
+				CopyToTexture(destination, firstSubresource + i, footprint, 0);
+			}
+			first = end;
+			continue;
+		}
+
+		// Too big on its own, bands of rows. A row of a BC format is a row of blocks, blockHeight texels tall.
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& whole = footprints[first];
+		if (whole.Footprint.Depth != 1)
+		{
+			spdlog::error("Upload of a {} byte volume subresource doesn't fit in the {} byte staging ring",
+				subresourceEnd(first) - whole.Offset, m_ring.GetCapacity());
+			return UploadTicket();
+		}
+
+		const UINT rowCount = rowCounts[first];
+		const UINT blockHeight = whole.Footprint.Height / rowCount;
+		const UINT64 rowsPerPiece = pieceSize / whole.Footprint.RowPitch;
+		const UINT bandRows = rowsPerPiece == 0 ? 1 : static_cast<UINT>(rowsPerPiece);
+		for (UINT row{ 0 }; row < rowCount; row += bandRows)
+		{
+			const UINT rows = rowCount - row < bandRows ? rowCount - row : bandRows;
+			StagingAllocation allocation;
+			if (!AllocateStaging(static_cast<UINT64>(rows) * whole.Footprint.RowPitch, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, allocation))
+			{
+				return UploadTicket();
+			}
+
+			D3D12_PLACED_SUBRESOURCE_FOOTPRINT band = whole;
+			band.Offset = allocation.offset;
+			band.Footprint.Height = row + rows == rowCount ? whole.Footprint.Height - row * blockHeight : rows * blockHeight;
+
+			BeginRecording();
+			fill(firstSubresource + first, band.Footprint, row, rows, rowSizes[first], m_stagingData + band.Offset);
+			CopyToTexture(destination, firstSubresource + first, band, row * blockHeight);
+		}
+		first++;
+	}
+
+	UploadTicket ticket;
+	ticket.fenceValue = m_nextFenceValue;
+	return ticket;
+}
+
+UploadTicket UploadService::Flush() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return SubmitLocked();
+}
+
+bool UploadService::IsComplete(const UploadTicket& ticket) const {
+	return m_fence->GetCompletedValue() >= ticket.fenceValue;
+}
+
+void UploadService::Wait(const UploadTicket& ticket) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (ticket.fenceValue >= m_nextFenceValue)
+	{
+		SubmitLocked();
+	}
+	WaitForFenceValue(ticket.fenceValue);
+}
+
+void UploadService::QueueWait(ID3D12CommandQueue* queue, const UploadTicket& ticket) {
+	if (ticket.fenceValue == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (ticket.fenceValue >= m_nextFenceValue)
+		{
+			SubmitLocked();
+		}
+	}
+
+	// GPU side, the CPU carries on straight away
+	DXCall(queue->Wait(m_fence.Get(), ticket.fenceValue));
+}
+
+void UploadService::Retire() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ring.Retire(m_fence->GetCompletedValue());
+}
+
+UINT64 UploadService::GetStagingUsed() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_ring.GetUsed();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "D3D12CommonHeaders.h"
+#include "CommandAllocatorPool.h"
+#include "GpuHeapAllocator.h"
+#include "StagingRing.h"
+#include <functional>
+#include <mutex>
+
+// Identifies the copy queue batch an upload went out in. Zero means there is nothing to wait for.
+struct UploadTicket
+{
+	UINT64 fenceValue = 0;
+};
+
+// Uploads buffers and textures on a dedicated copy queue through one persistently mapped staging ring.
+// Uploads are recorded into the open batch and go out on Flush (or when a queue asks to wait on them), the
+// ticket they return is the fence value that batch signals. Other queues wait on tickets GPU side with
+// QueueWait so nothing blocks the CPU. Destinations have to be in the COMMON state, the copy queue promotes
+// them to COPY_DEST and they decay back to COMMON once the batch is done. Thread safe.
+class UploadService {
+	public:
+		static const UINT64 DefaultStagingSize = 16 * 1024 * 1024;
+		// Writes rows [firstRow, firstRow + rowCount) of one subresource into data, laid out as footprint says:
+		// rowCount rows per slice, RowPitch apart, rowSize bytes of each actually used. That's the whole
+		// subresource unless it's bigger than the staging ring allows, a 2D one then comes in bands of rows.
+		typedef std::function<void(UINT subresource, const D3D12_SUBRESOURCE_FOOTPRINT& footprint, UINT firstRow, UINT rowCount,
+			UINT64 rowSize, UINT8* data)> FillFunction;
+
+	private:
+		ID3D12Device8* m_device = nullptr;
+		GpuHeapAllocator* m_gpuHeap = nullptr;
+
+		ComPtr<ID3D12CommandQueue> m_copyQueue;
+		ComPtr<ID3D12GraphicsCommandList> m_commandList;
+		CommandAllocatorPool<ComPtr<ID3D12CommandAllocator>> m_allocatorPool;
+		ComPtr<ID3D12CommandAllocator> m_currentAllocator;
+		bool m_recording = false;
+
+		ComPtr<ID3D12Fence> m_fence;
+		HANDLE m_fenceEvent = nullptr;
+		UINT64 m_nextFenceValue = 1;
+
+		GpuAllocation* m_stagingBuffer = nullptr;
+		UINT8* m_stagingData = nullptr;
+		StagingRing m_ring;
+
+		mutable std::mutex m_mutex;
+
+		void BeginRecording();
+		UploadTicket SubmitLocked();
+		bool AllocateStaging(UINT64 size, UINT64 alignment, StagingAllocation& allocation);
+		// Staging at footprint.Offset into the subresource, y texels down from its top
+		void CopyToTexture(ID3D12Resource* destination, UINT subresource, const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint, UINT y);
+		void WaitForFenceValue(UINT64 fenceValue);
+
+	public:
+		void Initialize(ID3D12Device8* device, GpuHeapAllocator* gpuHeap, UINT64 stagingSize = DefaultStagingSize);
+		// Waits for every batch, then releases everything
+		void Shutdown();
+
+		// A zero ticket means the data didn't fit in the staging ring at all
+		UploadTicket UploadBuffer(ID3D12Resource* destination, UINT64 destinationOffset, const void* data, UINT64 size);
+		// Textures of any size. Subresources go over as many at a time as fit in half the ring, bands of rows for a
+		// subresource too big for that, so the ring keeps being recycled and one half can fill while the other is
+		// being copied. Zero only for a volume slice too big for the ring.
+		UploadTicket UploadTexture(ID3D12Resource* destination, const D3D12_SUBRESOURCE_DATA* subresources,
+			UINT firstSubresource, UINT subresourceCount);
+		// Same, but fill writes straight into the staging ring, no copy of the data has to exist anywhere else.
+		// fill runs under the upload lock, it must not upload anything itself.
+		UploadTicket UploadTexture(ID3D12Resource* destination, UINT firstSubresource, UINT subresourceCount, const FillFunction& fill);
+
+		// Submits the open batch, returns its ticket (or the last one if nothing was recorded)
+		UploadTicket Flush();
+
+		bool IsComplete(const UploadTicket& ticket) const;
+		// Blocks the CPU, only for setup and shutdown
+		void Wait(const UploadTicket& ticket);
+		// queue won't run anything submitted after this until the ticket's batch is done
+		void QueueWait(ID3D12CommandQueue* queue, const UploadTicket& ticket);
+
+		// Hands staging memory back from finished batches, call once a frame
+		void Retire();
+
+		UINT64 GetStagingUsed() const;
+};
@@ -1,8 +1,38 @@
 #include <SDL.h>
+#include <cstdio>
+#include <cstring>
 #include "Application/Application.h"
+#include "Core/BinaryLogDecoder.h"
 
+// Hello_D3D12 --decode-log file prints a binary log written by BinaryLog and exits
+static int DecodeLog(const char* path) {
+	BinaryLogReader reader;
+	if (!reader.Open(path))
+	{
+		fprintf(stderr, "%s is not a binary log\n", path);
+		return 1;
+	}
+
+	BinaryLogEntry entry;
+	while (reader.Next(entry))
+	{
+		printf("%s\n", BinaryLogReader::FormatLine(entry).c_str());
+	}
+
+	if (reader.IsCorrupt())
+	{
+		fprintf(stderr, "%s is cut off or corrupt\n", path);
+		return 1;
+	}
+	return 0;
+}
 
 int main(int argc, char* args[]) {
+	if (argc == 3 && strcmp(args[1], "--decode-log") == 0)
+	{
+		return DecodeLog(args[2]);
+	}
+
 	Application app;
 
 	app.Initialize();
@@ -1,15 +1,14 @@
 
- struct Node
-{
-    float4 offset;
-};
-
 cbuffer SceneConstantBuffer : register (b0)
 {
-    int nodeIdx;
-    Node nodes[2];
+    uint instanceCount;
 };
 
+// Structure of arrays, instanceCount floats per plane: position x, position y, position z, scale
+StructuredBuffer<float> g_instances : register(t1);
+// The instances that survived culling, one per drawn instance
+StructuredBuffer<uint> g_visibleInstances : register(t2);
+
 struct PSInput
 {
     float4 position : SV_Position;
@@ -20,11 +19,15 @@ struct PSInput
 Texture2D g_texture : register(t0);
 SamplerState g_sampler : register(s0);
 
-PSInput VSMain(float4 position: POSITION, float4 color: COLOR, float4 uv: TEXCOORD)
+PSInput VSMain(float4 position: POSITION, float4 color: COLOR, float4 uv: TEXCOORD, uint instanceId : SV_InstanceID)
 {
     PSInput result;
 
-    result.position = position + nodes[nodeIdx].offset;
+    instanceId = g_visibleInstances[instanceId];
+    float4 offset = float4(g_instances[instanceId], g_instances[instanceCount + instanceId], g_instances[2 * instanceCount + instanceId], 0.0f);
+    float scale = g_instances[3 * instanceCount + instanceId];
+
+    result.position = float4(position.xyz * scale, 1.0f) + offset;
     result.color = color;
     result.uv = uv;
 
@@ -0,0 +1,255 @@
+#include "Core/BinaryLog.h"
+#include "Core/BinaryLogDecoder.h"
+#include "TestHarness.h"
+#include <spdlog/sinks/ostream_sink.h>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	enum class Mode : uint8_t { A = 3 };
+
+	const char* const TestFile = "BinaryLogTests.blog";
+
+	void Append(std::vector<char>& bytes, const void* data, size_t size) {
+		bytes.insert(bytes.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+	}
+
+	template<typename T>
+	void AppendValue(std::vector<char>& bytes, T value) {
+		Append(bytes, &value, sizeof(value));
+	}
+
+	// "x {} y" at level 2, then one record of it with the argument 42
+	std::vector<char> MakeFile(uint8_t level, uint32_t formatLength) {
+		std::vector<char> bytes;
+		Append(bytes, BinaryLogFormat::Magic, sizeof(BinaryLogFormat::Magic));
+		bytes.push_back(BinaryLogFormat::SiteTag);
+		AppendValue<uint32_t>(bytes, 0);
+		AppendValue<uint8_t>(bytes, level);
+		AppendValue<int32_t>(bytes, 7);
+		AppendValue<uint32_t>(bytes, formatLength);
+		Append(bytes, "x {} y", 6);
+		AppendValue<uint32_t>(bytes, 3);
+		Append(bytes, "a.c", 3);
+
+		bytes.push_back(BinaryLogFormat::RecordTag);
+		AppendValue<uint32_t>(bytes, 0);
+		AppendValue<uint32_t>(bytes, 1);
+		AppendValue<int64_t>(bytes, 0);
+		AppendValue<uint64_t>(bytes, 3);
+		AppendValue<uint32_t>(bytes, 1);
+		AppendValue<uint32_t>(bytes, 9);
+		AppendValue<uint8_t>(bytes, static_cast<uint8_t>(BinaryArgType::Int64));
+		AppendValue<int64_t>(bytes, 42);
+		return bytes;
+	}
+
+	void WriteFile(const std::vector<char>& bytes) {
+		FILE* file = fopen(TestFile, "wb");
+		fwrite(bytes.data(), 1, bytes.size(), file);
+		fclose(file);
+	}
+
+	void FormatsIntoALogger() {
+		std::ostringstream text;
+		std::shared_ptr<spdlog::logger> logger = std::make_shared<spdlog::logger>("binary",
+			std::make_shared<spdlog::sinks::ostream_sink_mt>(text));
+		logger->set_pattern("%l %v");
+		BinaryLog::Initialize(logger, 4096);
+		Log::SetFrame(12);
+
+		const std::string name("std string");
+		const char* cstr = "cstr";
+		LOG_BINARY_INFO("ints {} {} float {:.2f} char {} bool {} str '{}' '{}' enum {}", -5, 7u, 1.5f, 'c', true, name, cstr, Mode::A);
+		LOG_BINARY_WARN("no args");
+		LOG_BINARY_ERROR("bad {} {}", 1);
+		BinaryLog::Shutdown();
+
+		std::istringstream lines(text.str());
+		std::string line;
+		CHECK(std::getline(lines, line) && line == "info [frame 12] ints -5 7 float 1.50 char c bool true str 'std string' 'cstr' enum 3");
+		CHECK(std::getline(lines, line) && line == "warning [frame 12] no args");
+		// A format error is reported in the line instead of throwing on the backend thread
+		CHECK(std::getline(lines, line) && line.find("error [frame 12] <format error") == 0);
+		Log::SetFrame(0);
+	}
+
+	// With small rings some records are dropped, but every one is either written or counted
+	void EveryRecordIsWrittenOrDropped() {
+		const int threadCount = 4;
+		const int recordsPerThread = 2000;
+		std::ostringstream text;
+		std::shared_ptr<spdlog::logger> logger = std::make_shared<spdlog::logger>("binary",
+			std::make_shared<spdlog::sinks::ostream_sink_mt>(text));
+		logger->set_pattern("%v");
+		const uint64_t droppedBefore = BinaryLog::GetDroppedCount();
+		BinaryLog::Initialize(logger, 1024);
+
+		std::vector<std::thread> threads;
+		for (int t{ 0 }; t < threadCount; t++)
+		{
+			threads.emplace_back([t]() {
+				for (int i{ 0 }; i < recordsPerThread; i++)
+				{
+					LOG_BINARY_INFO("t {} i {}", t, i);
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		BinaryLog::Shutdown();
+
+		size_t lines = 0;
+		const std::string output = text.str();
+		for (size_t position = output.find('\n'); position != std::string::npos; position = output.find('\n', position + 1))
+		{
+			lines++;
+		}
+		CHECK(lines > 0);
+		CHECK(lines + (BinaryLog::GetDroppedCount() - droppedBefore) == static_cast<size_t>(threadCount * recordsPerThread));
+	}
+
+	void FileRoundTrip() {
+		Log::SetFrame(5);
+		BinaryLog::Initialize(std::string(TestFile), 1 << 16);
+		LOG_BINARY_INFO("file {} {}", 1, "two");
+		LOG_BINARY_INFO("file {} {}", 3, "four");
+		LOG_BINARY_WARN("other site {:>6}", 2.5);
+		BinaryLog::Shutdown();
+		Log::SetFrame(0);
+
+		BinaryLogReader reader;
+		CHECK(reader.Open(TestFile));
+		const char* expected[] = { "file 1 two", "file 3 four", "other site    2.5" };
+		const spdlog::level::level_enum levels[] = { spdlog::level::info, spdlog::level::info, spdlog::level::warn };
+		BinaryLogEntry entry;
+		int count = 0;
+		while (reader.Next(entry))
+		{
+			CHECK(count < 3 && entry.message == expected[count] && entry.level == levels[count] && entry.frame == 5);
+			count++;
+		}
+		CHECK(count == 3);
+		CHECK(!reader.IsCorrupt());
+		CHECK(BinaryLogReader::FormatLine(entry).find("[warning] [frame 5] [thread ") != std::string::npos);
+	}
+
+	void ReaderRejectsBadFiles() {
+		BinaryLogEntry entry;
+		{
+			WriteFile(MakeFile(2, 6));
+			BinaryLogReader reader;
+			CHECK(reader.Open(TestFile) && reader.Next(entry) && entry.message == "x 42 y" && entry.frame == 3);
+		}
+		{
+			WriteFile(MakeFile(spdlog::level::n_levels, 6));
+			BinaryLogReader reader;
+			CHECK(reader.Open(TestFile) && !reader.Next(entry) && reader.IsCorrupt());
+		}
+		{
+			// A length past the end of the file is never allocated
+			WriteFile(MakeFile(2, 0x7FFFFFFF));
+			BinaryLogReader reader;
+			CHECK(reader.Open(TestFile) && !reader.Next(entry) && reader.IsCorrupt());
+		}
+		{
+			std::vector<char> bytes = MakeFile(2, 6);
+			bytes[0] = 'X';
+			WriteFile(bytes);
+			BinaryLogReader reader;
+			CHECK(!reader.Open(TestFile));
+		}
+
+		// An argument count past the bytes there are
+		std::string message;
+		const uint8_t args[] = { static_cast<uint8_t>(BinaryArgType::Bool), 1 };
+		CHECK(FormatBinaryLogArgs("{}", args, sizeof(args), 1, message) && message == "true");
+		CHECK(!FormatBinaryLogArgs("{} {}", args, sizeof(args), 0xFFFFFFFF, message));
+		CHECK(!FormatBinaryLogArgs("{}", args, 1, 1, message));
+	}
+
+	// Random bytes flipped and the file cut short, the reader stops instead of crashing
+	void ReaderSurvivesMutations() {
+		const std::vector<char> base = MakeFile(2, 6);
+		std::mt19937 random(1);
+		int intact = 0;
+		for (int iteration{ 0 }; iteration < 2000; iteration++)
+		{
+			std::vector<char> bytes = base;
+			const int flips = 1 + random() % 4;
+			for (int i{ 0 }; i < flips; i++)
+			{
+				bytes[8 + random() % (bytes.size() - 8)] = static_cast<char>(random());
+			}
+			if (random() % 4 == 0)
+			{
+				bytes.resize(8 + random() % (bytes.size() - 8));
+			}
+			WriteFile(bytes);
+
+			BinaryLogReader reader;
+			CHECK(reader.Open(TestFile));
+			BinaryLogEntry entry;
+			int count = 0;
+			while (reader.Next(entry))
+			{
+				BinaryLogReader::FormatLine(entry);
+				count++;
+			}
+			CHECK(count <= 1);
+			intact += count == 1 && !reader.IsCorrupt() ? 1 : 0;
+		}
+		CHECK(intact < 2000);
+		remove(TestFile);
+	}
+
+	// The backend keeps draining, and the next session gets rings of its own size rather than the freed ones
+	void UnopenableFileIsSurvived() {
+		BinaryLog::Initialize(std::string("no/such/directory/BinaryLogTests.blog"), 64);
+		for (int i{ 0 }; i < 1000; i++)
+		{
+			LOG_BINARY_INFO("nowhere {}", i);
+		}
+		BinaryLog::Shutdown();
+
+		const uint64_t dropped = BinaryLog::GetDroppedCount();
+		BinaryLog::Initialize(std::string(TestFile), 1 << 16);
+		LOG_BINARY_INFO("after {}", std::string(200, 'x'));
+		BinaryLog::Shutdown();
+		CHECK(BinaryLog::GetDroppedCount() == dropped);
+
+		BinaryLogReader reader;
+		CHECK(reader.Open(TestFile));
+		BinaryLogEntry entry;
+		CHECK(reader.Next(entry) && entry.message == "after " + std::string(200, 'x'));
+		CHECK(!reader.Next(entry) && !reader.IsCorrupt());
+		remove(TestFile);
+	}
+
+	void InactiveDropsAreCountedApart() {
+		const uint64_t dropped = BinaryLog::GetDroppedCount();
+		const uint64_t inactive = BinaryLog::GetInactiveDroppedCount();
+		LOG_BINARY_INFO("before {}", 1);
+		LOG_BINARY_INFO("before {}", 2);
+		CHECK(BinaryLog::GetInactiveDroppedCount() == inactive + 2);
+		CHECK(BinaryLog::GetDroppedCount() == dropped);
+	}
+}
+
+int main() {
+	RUN_TEST(FormatsIntoALogger);
+	RUN_TEST(EveryRecordIsWrittenOrDropped);
+	RUN_TEST(FileRoundTrip);
+	RUN_TEST(ReaderRejectsBadFiles);
+	RUN_TEST(ReaderSurvivesMutations);
+	RUN_TEST(UnopenableFileIsSurvived);
+	RUN_TEST(InactiveDropsAreCountedApart);
+	return TestResult();
+}
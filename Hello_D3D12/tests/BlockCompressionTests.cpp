@@ -0,0 +1,256 @@
+#include "Graphics/BlockCompression.h"
+#include "Graphics/ProceduralTexture.h"
+#include "Core/JobSystem.h"
+#include "TestHarness.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const BlockFormat Formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 };
+	const BlockQuality Qualities[] = { BlockQuality::Fast, BlockQuality::Normal, BlockQuality::High };
+	const SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+	const int ChannelCounts[] = { 3, 4, 1, 2, 4 };
+	const char* FormatNames[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+	const char* QualityNames[] = { "Fast", "Normal", "High" };
+
+	// Worst PSNR each format may drop to on the test image, per quality. A few tenths of a dB under what the
+	// encoder gets, so a real regression shows up and a change in rounding doesn't.
+	const double MinimumPsnr[5][3] = {
+		{ 41.3, 41.7, 42.1 },		// BC1
+		{ 40.8, 41.2, 41.7 },		// BC3
+		{ 48.8, 50.4, 50.9 },		// BC4
+		{ 50.0, 51.2, 51.8 },		// BC5
+		{ 43.8, 45.2, 45.4 }		// BC7
+	};
+
+	struct Texture
+	{
+		MipFootprint footprint;
+		std::vector<uint8_t> pixels;
+	};
+
+	// Something like a photo: smooth color gradients with grain, a few hard edges, and alpha that cuts out, ramps,
+	// then stays opaque for the bottom half
+	Texture MakeTestImage(uint32_t width, uint32_t height) {
+		Texture texture;
+		texture.footprint.width = width;
+		texture.footprint.height = height;
+		texture.footprint.rowPitch = width * 4;
+		texture.pixels.resize(width * height * 4);
+		std::mt19937 random(11);
+		for (uint32_t y{ 0 }; y < height; y++)
+		{
+			for (uint32_t x{ 0 }; x < width; x++)
+			{
+				const double u = static_cast<double>(x) / width;
+				const double v = static_cast<double>(y) / height;
+				double r = 0.5 + 0.4 * std::sin(u * 6.0 + v * 2.0);
+				double g = 0.5 + 0.4 * std::cos(v * 5.0 - u);
+				double b = 0.3 + 0.3 * u * v;
+				// A disc and a bar with hard edges
+				if ((u - 0.3) * (u - 0.3) + (v - 0.6) * (v - 0.6) < 0.04)
+				{
+					r = 0.9; g = 0.2; b = 0.1;
+				}
+				if (x / 8 % 8 == 3)
+				{
+					b = 0.9;
+				}
+				const int grain = static_cast<int>(random() % 9) - 4;
+				uint8_t* pixel = &texture.pixels[(y * width + x) * 4];
+				pixel[0] = static_cast<uint8_t>(r * 255.0 + grain + 0.5);
+				pixel[1] = static_cast<uint8_t>(g * 255.0 + grain + 0.5);
+				pixel[2] = static_cast<uint8_t>(b * 255.0 + 0.5);
+				pixel[3] = static_cast<uint8_t>(y < height / 8 ? 0 : y < height / 2 ? 255.0 * u : 255.0);
+			}
+		}
+		return texture;
+	}
+
+	std::vector<uint8_t> Compress(const BlockEncodeDesc& desc, const Texture& texture, MipFootprint& footprint, JobSystem* jobSystem) {
+		std::vector<uint8_t> blocks(ComputeBlockFootprints(desc.format, texture.footprint.width, texture.footprint.height, 1, &footprint));
+		CompressTexture(desc, texture.pixels.data(), &texture.footprint, blocks.data(), &footprint, 1, jobSystem);
+		return blocks;
+	}
+
+	// Over the channels the format has. BC1 can only keep a pixel under alpha 128 as transparent black.
+	double Psnr(BlockFormat format, const Texture& texture, const std::vector<uint8_t>& blocks, const MipFootprint& footprint) {
+		std::vector<uint8_t> decoded(texture.pixels.size());
+		DecompressLevel(format, blocks.data(), footprint, decoded.data(), texture.footprint);
+		const int channels = ChannelCounts[static_cast<int>(format)];
+		double squaredError = 0.0;
+		uint64_t count = 0;
+		for (size_t i{ 0 }; i < texture.pixels.size(); i += 4)
+		{
+			for (int channel{ 0 }; channel < channels; channel++)
+			{
+				const int expected = format == BlockFormat::BC1 && texture.pixels[i + 3] < 128 ? 0 : texture.pixels[i + channel];
+				const double difference = expected - decoded[i + channel];
+				squaredError += difference * difference;
+				count++;
+			}
+		}
+		return squaredError == 0.0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / (squaredError / count));
+	}
+
+	void QualityHoldsUp() {
+		const Texture texture = MakeTestImage(128, 128);
+		for (int f{ 0 }; f < 5; f++)
+		{
+			double previous = 0.0;
+			for (int q{ 0 }; q < 3; q++)
+			{
+				BlockEncodeDesc desc;
+				desc.format = Formats[f];
+				desc.quality = Qualities[q];
+				MipFootprint footprint;
+				const std::vector<uint8_t> blocks = Compress(desc, texture, footprint, nullptr);
+				const double psnr = Psnr(desc.format, texture, blocks, footprint);
+				printf("  %s %-6s %.2f dB\n", FormatNames[f], QualityNames[q], psnr);
+				CHECK(psnr >= MinimumPsnr[f][q]);
+				// Better quality never does noticeably worse
+				CHECK(psnr >= previous - 0.05);
+				previous = psnr;
+			}
+		}
+	}
+
+	// Kernel levels may round differently, the result has to be as good. Threads can't change a byte.
+	void LevelsAndThreadsAgree() {
+		const Texture texture = MakeTestImage(64, 64);
+		JobSystem jobSystem;
+		jobSystem.Initialize(3);
+		for (BlockFormat format : Formats)
+		{
+			BlockEncodeDesc desc;
+			desc.format = format;
+			SetSimdLevel(SimdLevel::Scalar);
+			MipFootprint footprint;
+			const std::vector<uint8_t> scalar = Compress(desc, texture, footprint, nullptr);
+			const double scalarPsnr = Psnr(format, texture, scalar, footprint);
+
+			for (SimdLevel level : Levels)
+			{
+				SetSimdLevel(level);
+				const std::vector<uint8_t> serial = Compress(desc, texture, footprint, nullptr);
+				const std::vector<uint8_t> threaded = Compress(desc, texture, footprint, &jobSystem);
+				CHECK(serial == threaded);
+				CHECK_NEAR(Psnr(format, texture, serial, footprint), scalarPsnr, 0.1);
+			}
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+		jobSystem.Shutdown();
+	}
+
+	void DecodesKnownBlocks() {
+		uint8_t pixels[64];
+
+		// Red and blue endpoints, every index 0 is red, index 1 blue
+		const uint8_t bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x55 };
+		DecodeBlock(BlockFormat::BC1, bc1, pixels);
+		CHECK(pixels[0] == 255 && pixels[1] == 0 && pixels[2] == 0 && pixels[3] == 255);
+		CHECK(pixels[12 * 4 + 0] == 0 && pixels[12 * 4 + 2] == 255 && pixels[12 * 4 + 3] == 255);
+
+		// color0 <= color1 is the three color mode, index 3 is transparent black
+		const uint8_t bc1Alpha[8] = { 0x1F, 0x00, 0x00, 0xF8, 0xFF, 0xFF, 0xFF, 0xFF };
+		DecodeBlock(BlockFormat::BC1, bc1Alpha, pixels);
+		CHECK(pixels[0] == 0 && pixels[1] == 0 && pixels[2] == 0 && pixels[3] == 0);
+
+		// 255 and 0, index 0 and 1 are the endpoints. G and B come back 0, alpha 255.
+		const uint8_t bc4[8] = { 255, 0, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00 };
+		DecodeBlock(BlockFormat::BC4, bc4, pixels);
+		CHECK(pixels[0] == 255 && pixels[1] == 0 && pixels[2] == 0 && pixels[3] == 255);
+		CHECK(pixels[4] == 0 && pixels[8] == 255);
+	}
+
+	void FlatBlocksAreExact() {
+		uint8_t pixels[64];
+		for (int i{ 0 }; i < 16; i++)
+		{
+			pixels[i * 4 + 0] = 255;
+			pixels[i * 4 + 1] = 0;
+			pixels[i * 4 + 2] = 255;
+			pixels[i * 4 + 3] = 255;
+		}
+		for (BlockFormat format : Formats)
+		{
+			BlockEncodeDesc desc;
+			desc.format = format;
+			uint8_t block[16];
+			uint8_t decoded[64];
+			EncodeBlock(desc, pixels, block);
+			DecodeBlock(format, block, decoded);
+			const int channels = ChannelCounts[static_cast<int>(format)];
+			bool exact = true;
+			for (int i{ 0 }; i < 16; i++)
+			{
+				for (int channel{ 0 }; channel < channels; channel++)
+				{
+					exact = exact && decoded[i * 4 + channel] == pixels[i * 4 + channel];
+				}
+			}
+			CHECK(exact);
+		}
+	}
+
+	// The sample's sRGB checker chain in BC1, every level with whole 4x4 blocks of one color comes back exact.
+	// From 4x4 down the cells blur to grey and that's what rounds.
+	void CheckerChainIsExact() {
+		const uint32_t size = 256;
+		const uint32_t levelCount = GetMipLevelCount(size, size);
+		std::vector<MipFootprint> footprints(levelCount);
+		std::vector<MipFootprint> blockFootprints(levelCount);
+		std::vector<uint8_t> chain(ComputeMipFootprints(MipFormat::RGBA8, size, size, levelCount, footprints.data()));
+
+		ProceduralTextureDesc checker;
+		checker.cellShift = 5;
+		ProceduralTextureTarget target;
+		target.data = chain.data();
+		target.rowPitch = footprints[0].rowPitch;
+		target.width = size;
+		target.height = size;
+		GenerateProceduralTexture(checker, target, nullptr);
+		MipChainDesc mipDesc;
+		mipDesc.srgb = true;
+		GenerateMipChain(mipDesc, chain.data(), footprints.data(), levelCount, nullptr);
+
+		BlockEncodeDesc desc;
+		desc.format = BlockFormat::BC1;
+		std::vector<uint8_t> blocks(ComputeBlockFootprints(desc.format, size, size, levelCount, blockFootprints.data()));
+		CHECK(blocks.size() < chain.size() / 7);
+		CompressTexture(desc, chain.data(), footprints.data(), blocks.data(), blockFootprints.data(), levelCount, nullptr);
+
+		std::vector<uint8_t> decoded(chain.size());
+		for (uint32_t level{ 0 }; level < levelCount; level++)
+		{
+			const MipFootprint& footprint = footprints[level];
+			DecompressLevel(desc.format, blocks.data() + blockFootprints[level].offset, blockFootprints[level],
+				decoded.data() + footprint.offset, footprint);
+			int difference = 0;
+			for (uint32_t y{ 0 }; y < footprint.height; y++)
+			{
+				for (uint32_t x{ 0 }; x < footprint.width * 4; x++)
+				{
+					const uint64_t i = footprint.offset + y * footprint.rowPitch + x;
+					const int d = std::abs(chain[i] - decoded[i]);
+					difference = d > difference ? d : difference;
+				}
+			}
+			CHECK(footprint.width < 8 || difference == 0);
+			CHECK(difference <= 1);
+		}
+	}
+}
+
+int main() {
+	printf("CPU: %s\n", GetSimdLevelName(GetCpuSimdLevel()));
+	RUN_TEST(QualityHoldsUp);
+	RUN_TEST(LevelsAndThreadsAgree);
+	RUN_TEST(DecodesKnownBlocks);
+	RUN_TEST(FlatBlocksAreExact);
+	RUN_TEST(CheckerChainIsExact);
+	return TestResult();
+}
@@ -0,0 +1,370 @@
+#include "Graphics/DescriptorIndexAllocator.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct DescriptorIndexAllocatorTestAccess
+{
+	static uint64_t GetFreeHead(const DescriptorIndexAllocator& allocator) {
+		return allocator.m_freeHead.load();
+	}
+
+	static uint32_t GetNext(const DescriptorIndexAllocator& allocator, uint32_t index) {
+		return allocator.m_next[index].load();
+	}
+
+	// The second half of a pop that read head and next earlier
+	static bool FinishPop(DescriptorIndexAllocator& allocator, uint64_t head, uint32_t next) {
+		return allocator.m_freeHead.compare_exchange_strong(head, (head & 0xFFFFFFFF00000000ull) + (1ull << 32) + next);
+	}
+};
+
+namespace
+{
+	const uint32_t Invalid = DescriptorIndexAllocator::InvalidIndex;
+
+	// Marks which indices are out, a slot handed to two owners at once shows up as a second claim
+	class Owners {
+		private:
+			std::unique_ptr<std::atomic<uint32_t>[]> m_claims;
+
+		public:
+			std::atomic<uint32_t> doubleClaims;
+			std::atomic<uint32_t> badFrees;
+
+			explicit Owners(uint32_t capacity) : m_claims(new std::atomic<uint32_t>[capacity]), doubleClaims(0), badFrees(0) {
+				for (uint32_t i{ 0 }; i < capacity; i++)
+				{
+					m_claims[i].store(0);
+				}
+			}
+
+			void Claim(uint32_t index) {
+				if (m_claims[index].exchange(1) != 0)
+				{
+					doubleClaims++;
+				}
+			}
+
+			void Release(uint32_t index) {
+				if (m_claims[index].exchange(0) != 1)
+				{
+					badFrees++;
+				}
+			}
+	};
+
+	template<typename Function>
+	void RunThreads(uint32_t threadCount, Function function) {
+		std::vector<std::thread> threads;
+		for (uint32_t t{ 0 }; t < threadCount; t++)
+		{
+			threads.emplace_back(function, t);
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// Fresh slots come off the bump pointer, freed ones are reused last in first out
+	void FreedSlotsAreReused() {
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(8, 4, 2);
+		CHECK(allocator.AllocatePersistent() == 0 && allocator.AllocatePersistent() == 1 && allocator.AllocatePersistent() == 2);
+		allocator.FreePersistent(1);
+		allocator.FreePersistent(0);
+		CHECK(allocator.AllocatePersistent() == 0 && allocator.AllocatePersistent() == 1);
+		CHECK(allocator.AllocatePersistent() == 3);
+
+		const DescriptorAllocatorStats stats = allocator.GetStats();
+		CHECK(stats.persistentAllocated == 4 && stats.persistentHighWater == 4 && stats.freeListLength == 0);
+		CHECK(stats.largestFreeRun == 4 && stats.fragmentation == 0.0f);
+	}
+
+	// Full is full on every path, and a slot freed after that is the one that comes back
+	void ExhaustionAndRecovery() {
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(4, 0, 1);
+		for (uint32_t i{ 0 }; i < 4; i++)
+		{
+			CHECK(allocator.AllocatePersistent() == i);
+		}
+		CHECK(allocator.AllocatePersistent() == Invalid && allocator.AllocatePersistent() == Invalid);
+		CHECK(allocator.ShouldGrow());
+		allocator.FreePersistent(2);
+		CHECK(allocator.AllocatePersistent() == 2 && allocator.AllocatePersistent() == Invalid);
+
+		// Growing keeps the old slots and the free list, new ones come off the bump pointer
+		allocator.FreePersistent(1);
+		allocator.Grow(6);
+		CHECK(allocator.AllocatePersistent() == 1 && allocator.AllocatePersistent() == 4 && allocator.AllocatePersistent() == 5);
+		CHECK(allocator.AllocatePersistent() == Invalid);
+	}
+
+	// Deferred frees stay out until their frame slot comes around again
+	void DeferredFreesWaitForTheirFrame() {
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(4, 0, 2);
+		for (uint32_t i{ 0 }; i < 4; i++)
+		{
+			allocator.AllocatePersistent();
+		}
+		allocator.FreePersistentDeferred(0);
+		allocator.FreePersistentDeferred(3);
+		allocator.BeginFrame(1);
+		CHECK(allocator.AllocatePersistent() == Invalid);
+		allocator.FreePersistentDeferred(1);
+		allocator.BeginFrame(0);
+		const uint32_t a = allocator.AllocatePersistent();
+		const uint32_t b = allocator.AllocatePersistent();
+		CHECK(((a == 0 && b == 3) || (a == 3 && b == 0)) && allocator.AllocatePersistent() == Invalid);
+		allocator.BeginFrame(1);
+		CHECK(allocator.AllocatePersistent() == 1 && allocator.GetStats().persistentAllocated == 4);
+	}
+
+	// Transient ranges are contiguous, per frame, and reset when their frame comes back
+	void TransientRangesPerFrame() {
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(16, 8, 3);
+		CHECK(allocator.GetTotalCapacity() == 16 + 24);
+		CHECK(allocator.AllocateTransient(3) == 16 && allocator.AllocateTransient(5) == 19);
+		CHECK(allocator.AllocateTransient(1) == Invalid);
+		allocator.BeginFrame(1);
+		CHECK(allocator.AllocateTransient(2) == 24 && allocator.AllocateTransient(7) == Invalid);
+		allocator.BeginFrame(2);
+		CHECK(allocator.AllocateTransient(8) == 32);
+		allocator.BeginFrame(0);
+		CHECK(allocator.AllocateTransient(1) == 16 && allocator.GetStats().transientPeak == 8);
+	}
+
+	// Freed slots scattered through the used range show up as fragmentation
+	void StatsSeeFragmentation() {
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(16, 0, 1);
+		for (uint32_t i{ 0 }; i < 12; i++)
+		{
+			allocator.AllocatePersistent();
+		}
+		allocator.FreePersistent(1);
+		allocator.FreePersistent(5);
+		allocator.FreePersistent(6);
+		allocator.FreePersistent(11);
+		const DescriptorAllocatorStats stats = allocator.GetStats();
+		CHECK(stats.freeListLength == 4 && stats.persistentAllocated == 8);
+		// 11 runs into the 4 never used slots
+		CHECK(stats.largestFreeRun == 5);
+		CHECK_NEAR(stats.fragmentation, 1.0 - 5.0 / 8.0, 1e-6);
+	}
+
+	// Threads allocating and freeing through one free list, holding a few slots each at a time. No slot may ever
+	// have two owners and everything has to be back on the list at the end.
+	void ConcurrentAllocateAndFree() {
+		const uint32_t capacity = 256;
+		const uint32_t threadCount = 8;
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(capacity, 0, 1);
+		Owners owners(capacity);
+		std::atomic<uint32_t> failed(0);
+
+		RunThreads(threadCount, [&](uint32_t t) {
+			uint32_t held[16];
+			for (uint32_t round{ 0 }; round < 20000; round++)
+			{
+				const uint32_t count = 1 + (round + t) % 16;
+				for (uint32_t i{ 0 }; i < count; i++)
+				{
+					held[i] = allocator.AllocatePersistent();
+					if (held[i] == Invalid)
+					{
+						failed++;
+						continue;
+					}
+					owners.Claim(held[i]);
+				}
+				for (uint32_t i{ count }; i-- > 0;)
+				{
+					if (held[i] != Invalid)
+					{
+						owners.Release(held[i]);
+						allocator.FreePersistent(held[i]);
+					}
+				}
+			}
+		});
+
+		CHECK(owners.doubleClaims == 0 && owners.badFrees == 0);
+		// 8 threads hold 128 slots at most, the list never runs dry
+		CHECK(failed == 0);
+		const DescriptorAllocatorStats stats = allocator.GetStats();
+		CHECK(stats.persistentAllocated == 0);
+		CHECK(stats.freeListLength == stats.persistentHighWater && stats.persistentHighWater <= threadCount * 16);
+	}
+
+	// The ABA case, played out step by step: a pop reads head A and next B, then stalls while others pop A, pop B
+	// and push A back. A is on top again but B is owned, so the stalled pop must not install B as the head.
+	void StalePopLosesAfterAba() {
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(4, 0, 1);
+		for (uint32_t i{ 0 }; i < 4; i++)
+		{
+			allocator.AllocatePersistent();
+		}
+		allocator.FreePersistent(2);
+		allocator.FreePersistent(1);
+
+		const uint64_t staleHead = DescriptorIndexAllocatorTestAccess::GetFreeHead(allocator);
+		const uint32_t staleNext = DescriptorIndexAllocatorTestAccess::GetNext(allocator, static_cast<uint32_t>(staleHead));
+		CHECK(static_cast<uint32_t>(staleHead) == 1 && staleNext == 2);
+
+		CHECK(allocator.AllocatePersistent() == 1 && allocator.AllocatePersistent() == 2);
+		allocator.FreePersistent(1);
+		CHECK(static_cast<uint32_t>(DescriptorIndexAllocatorTestAccess::GetFreeHead(allocator)) == 1);
+
+		// Same index on top, but the tag moved on
+		CHECK(!DescriptorIndexAllocatorTestAccess::FinishPop(allocator, staleHead, staleNext));
+		CHECK(allocator.AllocatePersistent() == 1 && allocator.AllocatePersistent() == Invalid);
+	}
+
+	// The same race left to the scheduler: a handful of slots shared by more threads that each hold two for a
+	// moment keeps the same indices cycling through the head. Only finds anything with several cores.
+	void AbaUnderHeavyReuse() {
+		const uint32_t capacity = 8;
+		const uint32_t threadCount = 8;
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(capacity, 0, 1);
+		Owners owners(capacity);
+		std::atomic<uint64_t> allocations(0);
+
+		RunThreads(threadCount, [&](uint32_t t) {
+			uint32_t spin = t;
+			for (uint32_t round{ 0 }; round < 100000; round++)
+			{
+				uint32_t held[2];
+				for (uint32_t& index : held)
+				{
+					index = allocator.AllocatePersistent();
+					if (index != Invalid)
+					{
+						owners.Claim(index);
+						allocations++;
+					}
+				}
+				// Hold them for a varying moment
+				for (uint32_t i{ 0 }; i < round % 64; i++)
+				{
+					spin = spin * 1664525u + 1013904223u;
+				}
+				for (uint32_t index : held)
+				{
+					if (index != Invalid)
+					{
+						owners.Release(index);
+						allocator.FreePersistent(index);
+					}
+				}
+			}
+			allocations += spin & 1;
+		});
+
+		CHECK(owners.doubleClaims == 0 && owners.badFrees == 0);
+		CHECK(allocations > 0);
+		const DescriptorAllocatorStats stats = allocator.GetStats();
+		CHECK(stats.persistentAllocated == 0 && stats.freeListLength == capacity);
+	}
+
+	// Threads racing to drain the allocator get every slot exactly once between them, then nothing. It is done
+	// twice, once off the bump pointer and once off the free list.
+	void ConcurrentExhaustion() {
+		const uint32_t capacity = 10000;
+		const uint32_t threadCount = 8;
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(capacity, 0, 1);
+		Owners owners(capacity);
+		std::vector<std::vector<uint32_t>> got(threadCount);
+
+		for (int pass{ 0 }; pass < 2; pass++)
+		{
+			std::atomic<uint32_t> invalidAfterFull(0);
+			RunThreads(threadCount, [&](uint32_t t) {
+				for (;;)
+				{
+					const uint32_t index = allocator.AllocatePersistent();
+					if (index == Invalid)
+					{
+						break;
+					}
+					owners.Claim(index);
+					got[t].push_back(index);
+				}
+				// Once one failed it stays failed
+				for (int i{ 0 }; i < 100; i++)
+				{
+					invalidAfterFull += allocator.AllocatePersistent() == Invalid ? 1 : 0;
+				}
+			});
+
+			size_t total = 0;
+			for (const std::vector<uint32_t>& list : got)
+			{
+				total += list.size();
+			}
+			CHECK(total == capacity && owners.doubleClaims == 0);
+			CHECK(invalidAfterFull == threadCount * 100);
+			CHECK(allocator.GetStats().persistentAllocated == capacity);
+
+			// Hand everything back from all threads at once for the second pass
+			RunThreads(threadCount, [&](uint32_t t) {
+				for (uint32_t index : got[t])
+				{
+					owners.Release(index);
+					allocator.FreePersistent(index);
+				}
+				got[t].clear();
+			});
+			CHECK(owners.badFrees == 0);
+			const DescriptorAllocatorStats stats = allocator.GetStats();
+			CHECK(stats.persistentAllocated == 0 && stats.freeListLength == capacity);
+		}
+	}
+
+	// Deferred frees from several threads land in the same pending list and all come back in BeginFrame
+	void ConcurrentDeferredFrees() {
+		const uint32_t capacity = 4096;
+		const uint32_t threadCount = 4;
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(capacity, 0, 2);
+		for (uint32_t i{ 0 }; i < capacity; i++)
+		{
+			allocator.AllocatePersistent();
+		}
+		RunThreads(threadCount, [&](uint32_t t) {
+			for (uint32_t i{ t }; i < capacity; i += threadCount)
+			{
+				allocator.FreePersistentDeferred(i);
+			}
+		});
+		allocator.BeginFrame(1);
+		CHECK(allocator.AllocatePersistent() == Invalid);
+		allocator.BeginFrame(0);
+		const DescriptorAllocatorStats stats = allocator.GetStats();
+		CHECK(stats.persistentAllocated == 0 && stats.freeListLength == capacity);
+		CHECK(stats.largestFreeRun == capacity && stats.fragmentation == 0.0f);
+	}
+}
+
+int main() {
+	RUN_TEST(FreedSlotsAreReused);
+	RUN_TEST(ExhaustionAndRecovery);
+	RUN_TEST(DeferredFreesWaitForTheirFrame);
+	RUN_TEST(TransientRangesPerFrame);
+	RUN_TEST(StatsSeeFragmentation);
+	RUN_TEST(ConcurrentAllocateAndFree);
+	RUN_TEST(StalePopLosesAfterAba);
+	RUN_TEST(AbaUnderHeavyReuse);
+	RUN_TEST(ConcurrentExhaustion);
+	RUN_TEST(ConcurrentDeferredFrees);
+	return TestResult();
+}
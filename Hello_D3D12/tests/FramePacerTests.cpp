@@ -0,0 +1,183 @@
+#include "Core/FramePacer.h"
+#include "TestHarness.h"
+
+namespace
+{
+	// Counts what the pacer asks of a FakePacerClock
+	class CountingClock : public PacerClock {
+		public:
+			FakePacerClock fake;
+			int sleeps = 0;
+			int spins = 0;
+
+			int64_t Now() override { return fake.Now(); }
+			void SleepFor(int64_t nanoseconds) override { sleeps++; fake.SleepFor(nanoseconds); }
+			void Spin() override { spins++; fake.Spin(); }
+
+			void ResetCounts() { sleeps = 0; spins = 0; }
+	};
+
+	const int64_t Millisecond = 1000000;
+
+	void HoldsRateWithCoarseSleeps() {
+		FakePacerClock clock;
+		clock.SetOversleep(1500000);
+		clock.SetSpinStep(1000);
+		FramePacer pacer;
+		pacer.Initialize(&clock, 100.0);
+		CHECK(pacer.WaitForNextFrame() == 0.0);
+
+		for (int frame{ 0 }; frame < 500; frame++)
+		{
+			clock.Advance(3 * Millisecond);
+			const double frameTime = pacer.WaitForNextFrame();
+			// The first few sleeps find out how late they wake
+			if (frame > 5)
+			{
+				CHECK_NEAR(frameTime, 0.01, 2e-6);
+			}
+		}
+
+		const FramePacerStats& stats = pacer.GetStats();
+		CHECK(stats.missedFrames == 0);
+		CHECK(stats.frameCount == 500);
+		CHECK_NEAR(stats.meanFrameTime, 0.01, 2e-6);
+		CHECK(stats.frameTimeVariance < 1e-11);
+		CHECK_NEAR(stats.sleepOvershoot, 0.0015, 1e-4);
+	}
+
+	void LongFrameRestartsTheSchedule() {
+		FakePacerClock clock;
+		FramePacer pacer;
+		pacer.Initialize(&clock, 100.0);
+		pacer.WaitForNextFrame();
+		clock.Advance(2 * Millisecond);
+		pacer.WaitForNextFrame();
+
+		// Three and a half periods, not followed by a burst of frames to catch up
+		clock.Advance(35 * Millisecond);
+		CHECK_NEAR(pacer.WaitForNextFrame(), 0.035, 1e-6);
+		CHECK(pacer.GetStats().missedFrames == 1);
+		clock.Advance(1000);
+		CHECK_NEAR(pacer.WaitForNextFrame(), 0.01, 2e-6);
+		CHECK(pacer.GetStats().missedFrames == 1);
+	}
+
+	void UncappedNeverWaits() {
+		CountingClock clock;
+		FramePacer pacer;
+		pacer.Initialize(&clock, 0.0);
+		CHECK(pacer.IsUncapped());
+		pacer.WaitForNextFrame();
+		for (int frame{ 0 }; frame < 10; frame++)
+		{
+			clock.fake.Advance(4 * Millisecond);
+			CHECK_NEAR(pacer.WaitForNextFrame(), 0.004, 1e-9);
+		}
+		CHECK(clock.sleeps == 0 && clock.spins == 0);
+
+		// And back to capped
+		pacer.SetTargetFrameRate(50.0);
+		CHECK(!pacer.IsUncapped());
+		clock.fake.Advance(Millisecond);
+		CHECK_NEAR(pacer.WaitForNextFrame(), 0.02, 2e-6);
+	}
+
+	// One wake 14ms late used to push the overshoot estimate, and with it the spin, past a whole period. Frames
+	// then never slept again, so nothing ever brought the estimate back down and every frame spun to its deadline.
+	void RecoversFromOneTerribleWake() {
+		CountingClock clock;
+		clock.fake.SetSpinStep(1000);
+		clock.fake.SetOversleep(50000);
+		FramePacer pacer;
+		pacer.Initialize(&clock, 120.0);
+		pacer.WaitForNextFrame();
+
+		clock.fake.SetOversleep(14 * Millisecond);
+		clock.fake.Advance(Millisecond);
+		pacer.WaitForNextFrame();
+		clock.fake.SetOversleep(50000);
+
+		// Never more than a quarter period of spinning, even straight after it
+		const int maximumSpins = static_cast<int>(1000000000 / 120 / 4 / 1000) + 1;
+		for (int frame{ 0 }; frame < 300; frame++)
+		{
+			clock.ResetCounts();
+			clock.fake.Advance(2 * Millisecond);
+			pacer.WaitForNextFrame();
+			CHECK(clock.spins <= maximumSpins);
+		}
+		// Sleeping through most of the frame again, with the estimate back at the sleeps' real overshoot
+		CHECK(clock.sleeps > 0);
+		CHECK(clock.spins < 300);
+		CHECK(pacer.GetStats().sleepOvershoot < 0.0002);
+	}
+
+	// Frames that finish inside the spin window never sleep, the estimate has to come down without a measurement
+	void OvershootDecaysOnFramesThatDontSleep() {
+		CountingClock clock;
+		clock.fake.SetSpinStep(1000);
+		FramePacer pacer;
+		pacer.Initialize(&clock, 100.0);
+		pacer.WaitForNextFrame();
+
+		clock.fake.SetOversleep(2 * Millisecond);
+		clock.fake.Advance(Millisecond);
+		pacer.WaitForNextFrame();
+		clock.fake.SetOversleep(0);
+		const double highOvershoot = pacer.GetStats().sleepOvershoot;
+		CHECK(highOvershoot >= 0.002);
+
+		// 1ms before the deadline, inside the 2ms spin window
+		clock.ResetCounts();
+		for (int frame{ 0 }; frame < 20; frame++)
+		{
+			clock.fake.Advance(9 * Millisecond);
+			pacer.WaitForNextFrame();
+		}
+		CHECK(pacer.GetStats().sleepOvershoot < highOvershoot / 2);
+		// Down far enough that 1ms out is worth a sleep again
+		CHECK(clock.sleeps > 0);
+	}
+
+	void StatsCoverTheWindow() {
+		FakePacerClock clock;
+		FramePacer pacer;
+		pacer.Initialize(&clock, 0.0);
+		pacer.SetSmoothing(0.5);
+		pacer.WaitForNextFrame();
+
+		clock.Advance(10 * Millisecond);
+		pacer.WaitForNextFrame();
+		clock.Advance(20 * Millisecond);
+		pacer.WaitForNextFrame();
+
+		const FramePacerStats& stats = pacer.GetStats();
+		CHECK(stats.frameCount == 2);
+		CHECK_NEAR(stats.frameTime, 0.02, 1e-12);
+		CHECK_NEAR(stats.smoothedFrameTime, 0.015, 1e-12);
+		CHECK_NEAR(stats.meanFrameTime, 0.015, 1e-12);
+		CHECK_NEAR(stats.frameTimeVariance, 0.000025, 1e-12);
+		CHECK_NEAR(stats.minFrameTime, 0.01, 1e-12);
+		CHECK_NEAR(stats.maxFrameTime, 0.02, 1e-12);
+
+		// Older frames fall out of the window
+		for (uint32_t frame{ 0 }; frame < FramePacer::HistorySize; frame++)
+		{
+			clock.Advance(5 * Millisecond);
+			pacer.WaitForNextFrame();
+		}
+		CHECK_NEAR(pacer.GetStats().maxFrameTime, 0.005, 1e-12);
+		CHECK_NEAR(pacer.GetStats().frameTimeVariance, 0.0, 1e-15);
+	}
+}
+
+int main() {
+	RUN_TEST(HoldsRateWithCoarseSleeps);
+	RUN_TEST(LongFrameRestartsTheSchedule);
+	RUN_TEST(UncappedNeverWaits);
+	RUN_TEST(RecoversFromOneTerribleWake);
+	RUN_TEST(OvershootDecaysOnFramesThatDontSleep);
+	RUN_TEST(StatsCoverTheWindow);
+	return TestResult();
+}
@@ -0,0 +1,175 @@
+#include "Graphics/FrameScheduler.h"
+#include "TestHarness.h"
+#include <deque>
+
+namespace
+{
+	// A queue that runs submitted frames one after another, each taking gpuTime, on a clock the CPU side
+	// advances. Completed is the fence value the GPU has reached by now.
+	class SimulatedQueue {
+		private:
+			struct Submission
+			{
+				uint64_t fenceValue;
+				double doneTime;
+			};
+
+			std::deque<Submission> m_pending;
+			double m_busyUntil = 0.0;
+			uint64_t m_completed = 0;
+
+		public:
+			double now = 0.0;
+
+			void Submit(uint64_t fenceValue, double gpuTime) {
+				m_busyUntil = (m_busyUntil > now ? m_busyUntil : now) + gpuTime;
+				m_pending.push_back({ fenceValue, m_busyUntil });
+			}
+
+			uint64_t GetCompleted() {
+				while (!m_pending.empty() && m_pending.front().doneTime <= now)
+				{
+					m_completed = m_pending.front().fenceValue;
+					m_pending.pop_front();
+				}
+				return m_completed;
+			}
+
+			// Advances the clock until the fence reaches value, false if nothing submitted will ever get there
+			bool WaitFor(uint64_t value) {
+				while (GetCompleted() < value)
+				{
+					if (m_pending.empty())
+					{
+						return false;
+					}
+					now = m_pending.front().doneTime;
+				}
+				return true;
+			}
+
+			size_t GetInFlight() { GetCompleted(); return m_pending.size(); }
+	};
+
+	struct Timeline
+	{
+		double frameTime = 0.0;		// Average over the last half
+		uint32_t waits = 0;
+		bool reusedBusySlot = false;
+		bool tooFarAhead = false;
+		bool unreachableWait = false;
+	};
+
+	// The loop D3D12Implementation runs: wait for the slot, record, submit and signal
+	Timeline Run(uint32_t framesInFlight, double cpuTime, double gpuTime, int frames) {
+		FrameScheduler scheduler(framesInFlight);
+		SimulatedQueue queue;
+		Timeline timeline;
+		double halfway = 0.0;
+		for (int frame{ 0 }; frame < frames; frame++)
+		{
+			if (frame == frames / 2)
+			{
+				halfway = queue.now;
+			}
+			const double before = queue.now;
+			if (!queue.WaitFor(scheduler.GetWaitValue()))
+			{
+				timeline.unreachableWait = true;
+			}
+			if (queue.now > before)
+			{
+				timeline.waits++;
+			}
+			timeline.reusedBusySlot = timeline.reusedBusySlot ||
+				!scheduler.IsFrameRetired(scheduler.GetFrameIndex(), queue.GetCompleted());
+
+			queue.now += cpuTime;
+			queue.Submit(scheduler.EndFrame(), gpuTime);
+			timeline.tooFarAhead = timeline.tooFarAhead || queue.GetInFlight() > framesInFlight;
+		}
+		timeline.frameTime = (queue.now - halfway) / (frames - frames / 2);
+		return timeline;
+	}
+
+	void SlotsCycleAndFenceValuesGrow() {
+		FrameScheduler scheduler(3);
+		CHECK(scheduler.GetFramesInFlight() == 3 && scheduler.GetFrameIndex() == 0);
+		CHECK(scheduler.GetWaitValue() == 0 && scheduler.GetLastSignalledValue() == 0);
+
+		// Setup uploads flush before the first frame, out of band
+		CHECK(scheduler.SignalFlush() == 1);
+		CHECK(scheduler.EndFrame() == 2 && scheduler.GetFrameIndex() == 1);
+		CHECK(scheduler.EndFrame() == 3 && scheduler.GetFrameIndex() == 2);
+		CHECK(scheduler.SignalFlush() == 4);
+		CHECK(scheduler.EndFrame() == 5 && scheduler.GetFrameIndex() == 0);
+		CHECK(scheduler.GetFrameCount() == 3 && scheduler.GetLastSignalledValue() == 5);
+
+		// Back at slot 0, its frame signalled 2
+		CHECK(scheduler.GetWaitValue() == 2);
+		CHECK(!scheduler.IsFrameRetired(0, 1) && scheduler.IsFrameRetired(0, 2));
+		CHECK(scheduler.GetFrameFenceValue(1) == 3 && scheduler.GetFrameFenceValue(2) == 5);
+		CHECK(scheduler.IsFrameRetired(2, 5) && !scheduler.IsFrameRetired(2, 4));
+	}
+
+	// GPU bound: the CPU gets framesInFlight frames ahead and then waits each frame, the GPU never idles
+	void GpuBoundRunsAtGpuSpeed() {
+		for (uint32_t framesInFlight : { 2u, 3u })
+		{
+			const Timeline timeline = Run(framesInFlight, 4.0, 10.0, 200);
+			CHECK_NEAR(timeline.frameTime, 10.0, 1e-9);
+			CHECK(!timeline.reusedBusySlot && !timeline.tooFarAhead && !timeline.unreachableWait);
+			CHECK(timeline.waits >= 200 - framesInFlight - 1);
+		}
+	}
+
+	// CPU bound with room to run ahead: nobody waits on the fence
+	void CpuBoundNeverWaits() {
+		for (uint32_t framesInFlight : { 2u, 3u })
+		{
+			const Timeline timeline = Run(framesInFlight, 10.0, 4.0, 200);
+			CHECK_NEAR(timeline.frameTime, 10.0, 1e-9);
+			CHECK(timeline.waits == 0);
+			CHECK(!timeline.reusedBusySlot && !timeline.tooFarAhead);
+		}
+	}
+
+	// Balanced load is where more frames in flight pay off. One frame in flight serializes CPU and GPU, two
+	// overlap them.
+	void FramesInFlightOverlapCpuAndGpu() {
+		const Timeline single = Run(1, 8.0, 8.0, 200);
+		const Timeline doubled = Run(2, 8.0, 8.0, 200);
+		CHECK_NEAR(single.frameTime, 16.0, 1e-9);
+		CHECK_NEAR(doubled.frameTime, 8.0, 1e-9);
+		CHECK(!doubled.reusedBusySlot && !doubled.tooFarAhead);
+	}
+
+	// A GPU spike drains the frames the CPU had ahead, it catches up after without waiting on anything older
+	void SpikeOnlyStallsTheSlotItHits() {
+		FrameScheduler scheduler(3);
+		SimulatedQueue queue;
+		bool reusedBusySlot = false;
+		double worstWait = 0.0;
+		for (int frame{ 0 }; frame < 60; frame++)
+		{
+			const double before = queue.now;
+			queue.WaitFor(scheduler.GetWaitValue());
+			worstWait = queue.now - before > worstWait ? queue.now - before : worstWait;
+			reusedBusySlot = reusedBusySlot || !scheduler.IsFrameRetired(scheduler.GetFrameIndex(), queue.GetCompleted());
+			queue.now += 5.0;
+			queue.Submit(scheduler.EndFrame(), frame == 30 ? 50.0 : 4.0);
+		}
+		CHECK(!reusedBusySlot);
+		// The spike minus the two frames of CPU work that were queued behind it
+		CHECK(worstWait > 30.0 && worstWait < 50.0);
+	}
+}
+
+int main() {
+	RUN_TEST(SlotsCycleAndFenceValuesGrow);
+	RUN_TEST(GpuBoundRunsAtGpuSpeed);
+	RUN_TEST(CpuBoundNeverWaits);
+	RUN_TEST(FramesInFlightOverlapCpuAndGpu);
+	RUN_TEST(SpikeOnlyStallsTheSlotItHits);
+	return TestResult();
+}
@@ -0,0 +1,157 @@
+#include "Graphics/FrustumCull.h"
+#include "Graphics/InstanceCuller.h"
+#include "TestHarness.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Clip space is the world, x and y in [-1, 1], z in [0, 1]
+	const float Identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	InstanceSet MakeRandomSet(uint32_t count, uint32_t seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> position(-1.5f, 1.5f);
+		std::uniform_real_distribution<float> scale(0.0f, 0.1f);
+		InstanceSet instances;
+		instances.Reserve(count);
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			const float x = position(random);
+			const float y = position(random);
+			const float z = position(random) * 0.5f + 0.5f;
+			instances.Add(x, y, z, scale(random), 0.0f, 0.0f);
+		}
+		return instances;
+	}
+
+	uint32_t CullReference(const InstanceSet& instances, const Frustum& frustum, float radiusScale, uint32_t first,
+		uint32_t count, std::vector<uint32_t>& visible) {
+		visible.resize(count + CullOutputPadding);
+		const uint32_t visibleCount = CullSpheresScalar(frustum, instances.GetPlane(InstanceSet::InstancePlanePositionX),
+			instances.GetPlane(InstanceSet::InstancePlanePositionY), instances.GetPlane(InstanceSet::InstancePlanePositionZ),
+			instances.GetPlane(InstanceSet::InstancePlaneScale), radiusScale, first, count, visible.data());
+		visible.resize(visibleCount);
+		return visibleCount;
+	}
+
+	void MakeFrustumNormalisesPlanes() {
+		float scaled[16];
+		memcpy(scaled, Identity, sizeof(scaled));
+		scaled[0] = 2.0f;		// Half as wide, the side planes move in to +-0.5
+		const Frustum frustum = MakeFrustum(scaled);
+		CHECK_NEAR(frustum.planes[0][0] * frustum.planes[0][0] + frustum.planes[0][2] * frustum.planes[0][2]
+			+ frustum.planes[0][1] * frustum.planes[0][1], 1.0, 1e-6);
+		// Distance of x = 0.5 from the left plane (x = -0.5) is 1 in world units
+		CHECK_NEAR(frustum.planes[0][0] * 0.5f + frustum.planes[0][3], 1.0, 1e-6);
+		CHECK_NEAR(frustum.planes[1][0] * 0.5f + frustum.planes[1][3], 0.0, 1e-6);
+	}
+
+	void SpheresTouchingThePlanesAreVisible() {
+		const Frustum frustum = MakeFrustum(Identity);
+		InstanceSet instances;
+		instances.Add(0.0f, 0.0f, 0.5f, 0.1f, 0.0f, 0.0f);		// Inside
+		instances.Add(1.5f, 0.0f, 0.5f, 0.4f, 0.0f, 0.0f);		// Out to the right
+		instances.Add(1.5f, 0.0f, 0.5f, 0.6f, 0.0f, 0.0f);		// Pokes in from the right
+		instances.Add(0.0f, 0.0f, -0.5f, 0.4f, 0.0f, 0.0f);		// Behind the near plane
+		instances.Add(0.0f, 0.0f, 1.5f, 0.6f, 0.0f, 0.0f);		// Pokes in through the far plane
+		instances.Add(-2.0f, 2.0f, 0.5f, 0.9f, 0.0f, 0.0f);		// Past two planes
+
+		std::vector<uint32_t> visible;
+		CHECK(CullReference(instances, frustum, 1.0f, 0, instances.GetCount(), visible) == 3);
+		CHECK(visible == std::vector<uint32_t>({ 0, 2, 4 }));
+
+		std::vector<uint32_t> simd(instances.GetCount() + CullOutputPadding);
+		const uint32_t simdCount = CullSpheres(frustum, instances.GetPlane(InstanceSet::InstancePlanePositionX),
+			instances.GetPlane(InstanceSet::InstancePlanePositionY), instances.GetPlane(InstanceSet::InstancePlanePositionZ),
+			instances.GetPlane(InstanceSet::InstancePlaneScale), 1.0f, 0, instances.GetCount(), simd.data());
+		simd.resize(simdCount);
+		CHECK(simd == visible);
+	}
+
+	// Every level the CPU has, and none of them writes past count
+	void KernelMatchesScalar() {
+		const Frustum frustum = MakeFrustum(Identity);
+		const InstanceSet instances = MakeRandomSet(20000, 5);
+
+		// Odd counts and starts so every kernel's tail handling and unaligned start gets a go
+		const uint32_t counts[] = { 0, 1, 3, 7, 8, 9, 15, 17, 4095, 4096, 4097, 19000 };
+		const uint32_t firsts[] = { 0, 1, 5, 8, 13 };
+		std::vector<uint32_t> reference;
+		std::vector<uint32_t> simd;
+		for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 })
+		{
+			SetSimdLevel(level);
+			for (uint32_t count : counts)
+			{
+				for (uint32_t first : firsts)
+				{
+					const uint32_t referenceCount = CullReference(instances, frustum, 3.0f, first, count, reference);
+					simd.assign(count + CullOutputPadding, 0xFFFFFFFF);
+					const uint32_t simdCount = CullSpheres(frustum, instances.GetPlane(InstanceSet::InstancePlanePositionX),
+						instances.GetPlane(InstanceSet::InstancePlanePositionY), instances.GetPlane(InstanceSet::InstancePlanePositionZ),
+						instances.GetPlane(InstanceSet::InstancePlaneScale), 3.0f, first, count, simd.data());
+					bool untouched = true;
+					for (uint32_t i{ count }; i < count + CullOutputPadding; i++)
+					{
+						untouched = untouched && simd[i] == 0xFFFFFFFF;
+					}
+					simd.resize(simdCount);
+					CHECK(simdCount == referenceCount);
+					CHECK(simd == reference);
+					CHECK(untouched);
+				}
+			}
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+	}
+
+	void LevelFollowsTheCap() {
+		SetSimdLevel(SimdLevel::Scalar);
+		CHECK(GetCullKernelLevel() == SimdLevel::Scalar);
+		SetSimdLevel(SimdLevel::AVX512);
+		CHECK(GetCullKernelLevel() <= GetCpuSimdLevel() && GetCullKernelLevel() <= SimdLevel::AVX2);
+	}
+
+	void CullerMatchesScalarOnAnyThreadCount() {
+		const Frustum frustum = MakeFrustum(Identity);
+		const uint32_t counts[] = { 0, 1, InstanceCuller::ChunkSize - 1, InstanceCuller::ChunkSize, InstanceCuller::ChunkSize + 1, 50000 };
+		const uint32_t workerCounts[] = { 0, 1, 3 };
+		for (uint32_t count : counts)
+		{
+			const InstanceSet instances = MakeRandomSet(count, count + 1);
+			std::vector<uint32_t> reference;
+			const uint32_t referenceCount = CullReference(instances, frustum, 3.0f, 0, count, reference);
+
+			for (uint32_t workers : workerCounts)
+			{
+				JobSystem jobSystem;
+				jobSystem.Initialize(workers);
+				InstanceCuller culler;
+				culler.Initialize(&jobSystem);
+				std::vector<uint32_t> visible;
+				// Again with the scratch already sized
+				for (int run{ 0 }; run < 2; run++)
+				{
+					CHECK(culler.Cull(instances, frustum, 3.0f, visible) == referenceCount);
+					CHECK(visible == reference);
+				}
+				CHECK(culler.GetStats().tested == count);
+				CHECK(culler.GetStats().visible == referenceCount);
+				culler.Shutdown();
+				jobSystem.Shutdown();
+			}
+		}
+	}
+}
+
+int main() {
+	printf("CPU: %s\n", GetSimdLevelName(GetCpuSimdLevel()));
+	RUN_TEST(MakeFrustumNormalisesPlanes);
+	RUN_TEST(SpheresTouchingThePlanesAreVisible);
+	RUN_TEST(KernelMatchesScalar);
+	RUN_TEST(LevelFollowsTheCap);
+	RUN_TEST(CullerMatchesScalarOnAnyThreadCount);
+	return TestResult();
+}
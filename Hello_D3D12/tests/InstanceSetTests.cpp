@@ -0,0 +1,57 @@
+#include "Graphics/InstanceSet.h"
+#include "TestHarness.h"
+#include <vector>
+
+namespace
+{
+	void PackLaysOutPlanesInOrder() {
+		InstanceSet instances;
+		for (uint32_t i{ 0 }; i < 5; i++)
+		{
+			instances.Add(1.0f + i, 10.0f + i, 20.0f + i, 30.0f + i, 0.0f, 0.0f);
+		}
+		CHECK(instances.GetPackedSize() == 5 * InstanceSet::InstancePlaneCount * sizeof(float));
+
+		std::vector<float> packed(static_cast<size_t>(instances.GetPackedSize() / sizeof(float)));
+		instances.Pack(packed.data());
+		for (uint32_t i{ 0 }; i < 5; i++)
+		{
+			CHECK(packed[InstanceSet::InstancePlanePositionX * 5 + i] == 1.0f + i);
+			CHECK(packed[InstanceSet::InstancePlanePositionY * 5 + i] == 10.0f + i);
+			CHECK(packed[InstanceSet::InstancePlanePositionZ * 5 + i] == 20.0f + i);
+			CHECK(packed[InstanceSet::InstancePlaneScale * 5 + i] == 30.0f + i);
+		}
+	}
+
+	void AnimateWrapsAtBounds() {
+		InstanceSet instances;
+		instances.Add(0.9f, -0.5f, 0.0f, 1.0f, 0.2f, 0.25f);
+		instances.Add(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+		instances.Animate(1.0f);
+
+		const float* x = instances.GetPlane(InstanceSet::InstancePlanePositionX);
+		const float* y = instances.GetPlane(InstanceSet::InstancePlanePositionY);
+		CHECK_NEAR(x[0], -0.9f, 1e-6);
+		CHECK_NEAR(y[0], -0.25f, 1e-6);
+		CHECK(x[1] == 0.0f && y[1] == 0.0f);
+		// Z and scale never move
+		CHECK(instances.GetPlane(InstanceSet::InstancePlanePositionZ)[0] == 0.0f);
+		CHECK(instances.GetPlane(InstanceSet::InstancePlaneScale)[0] == 1.0f);
+	}
+
+	void ClearEmpties() {
+		InstanceSet instances;
+		instances.Add(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+		instances.Clear();
+		CHECK(instances.GetCount() == 0);
+		CHECK(instances.GetPackedSize() == 0);
+		CHECK(instances.Add(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f) == 0);
+	}
+}
+
+int main() {
+	RUN_TEST(PackLaysOutPlanesInOrder);
+	RUN_TEST(AnimateWrapsAtBounds);
+	RUN_TEST(ClearEmpties);
+	return TestResult();
+}
@@ -0,0 +1,300 @@
+#include "Core/JobSystem.h"
+#include "Core/WorkStealingDeque.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const uint32_t WorkerCounts[] = { 0, 1, 3, 7 };
+
+	void DequeOwnerIsLifoThievesFifo() {
+		WorkStealingDeque<int> deque(4);
+		int items[5] = { 0, 1, 2, 3, 4 };
+		for (int i{ 0 }; i < 4; i++)
+		{
+			CHECK(deque.Push(&items[i]));
+		}
+		// Full, the caller runs it itself
+		CHECK(!deque.Push(&items[4]));
+
+		CHECK(deque.Steal() == &items[0]);
+		CHECK(deque.Pop() == &items[3]);
+		CHECK(deque.Steal() == &items[1]);
+		CHECK(deque.Pop() == &items[2]);
+		CHECK(deque.Pop() == nullptr);
+		CHECK(deque.Steal() == nullptr);
+		CHECK(deque.IsEmpty());
+	}
+
+	void DequeHandsOutEveryItemOnce() {
+		const int itemCount = 200000;
+		std::vector<int> items(itemCount);
+		std::vector<std::atomic<int>> taken(itemCount);
+		for (int i{ 0 }; i < itemCount; i++)
+		{
+			items[i] = i;
+			taken[i].store(0);
+		}
+
+		WorkStealingDeque<int> deque(256);
+		std::atomic<bool> done(false);
+		const auto take = [&](int* item) { taken[*item].fetch_add(1, std::memory_order_relaxed); };
+
+		std::vector<std::thread> thieves;
+		for (int t{ 0 }; t < 3; t++)
+		{
+			thieves.emplace_back([&]() {
+				while (!done.load(std::memory_order_acquire) || !deque.IsEmpty())
+				{
+					if (int* item = deque.Steal())
+					{
+						take(item);
+					}
+				}
+			});
+		}
+
+		// The owner pushes until full, then pops a few, racing the thieves for the last item
+		int next = 0;
+		while (next < itemCount)
+		{
+			while (next < itemCount && deque.Push(&items[next]))
+			{
+				next++;
+			}
+			for (int i{ 0 }; i < 3; i++)
+			{
+				if (int* item = deque.Pop())
+				{
+					take(item);
+				}
+			}
+		}
+		while (int* item = deque.Pop())
+		{
+			take(item);
+		}
+		done.store(true, std::memory_order_release);
+		for (std::thread& thief : thieves)
+		{
+			thief.join();
+		}
+
+		int wrong = 0;
+		for (int i{ 0 }; i < itemCount; i++)
+		{
+			wrong += taken[i].load() == 1 ? 0 : 1;
+		}
+		CHECK(wrong == 0);
+	}
+
+	void ParallelForCoversTheRangeOnce() {
+		for (uint32_t workers : WorkerCounts)
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+			std::vector<std::atomic<int>> hits(100000);
+			for (std::atomic<int>& hit : hits)
+			{
+				hit.store(0);
+			}
+
+			// Batches that don't divide the count
+			JobCounter counter;
+			jobSystem.ParallelFor(static_cast<uint32_t>(hits.size()), 97, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i{ begin }; i < end; i++)
+				{
+					hits[i]++;
+				}
+			}, &counter);
+			jobSystem.Wait(counter);
+
+			int wrong = 0;
+			for (std::atomic<int>& hit : hits)
+			{
+				wrong += hit.load() == 1 ? 0 : 1;
+			}
+			CHECK(wrong == 0);
+
+			// Nothing to do is fine too
+			jobSystem.ParallelFor(0, 16, [&](uint32_t, uint32_t) { wrong++; }, &counter);
+			jobSystem.Wait(counter);
+			CHECK(wrong == 0);
+		}
+	}
+
+	void NestedWaitsRunOtherJobs() {
+		for (uint32_t workers : WorkerCounts)
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+			std::atomic<int> count(0);
+			JobCounter outer;
+			// More waiting jobs than threads, they only finish if a waiting thread runs the inner jobs itself
+			for (int i{ 0 }; i < 200; i++)
+			{
+				jobSystem.Run([&]() {
+					JobCounter inner;
+					for (int k{ 0 }; k < 50; k++)
+					{
+						jobSystem.Run([&]() { count++; }, &inner);
+					}
+					jobSystem.Wait(inner);
+				}, &outer);
+			}
+			jobSystem.Wait(outer);
+			CHECK(count.load() == 200 * 50);
+		}
+	}
+
+	void DependencyHoldsJobBack() {
+		for (uint32_t workers : WorkerCounts)
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+			std::mutex mutex;
+			std::vector<int> order;
+			JobCounter first;
+			JobCounter second;
+			JobCounter third;
+			for (int i{ 0 }; i < 10; i++)
+			{
+				jobSystem.Run([&]() {
+					std::this_thread::sleep_for(std::chrono::microseconds(100));
+					std::lock_guard<std::mutex> lock(mutex);
+					order.push_back(1);
+				}, &first);
+			}
+			jobSystem.Run([&]() {
+				std::lock_guard<std::mutex> lock(mutex);
+				order.push_back(2);
+			}, &second, &first);
+			// Chained on a dependency that is itself waiting
+			jobSystem.Run([&]() {
+				std::lock_guard<std::mutex> lock(mutex);
+				order.push_back(3);
+			}, &third, &second);
+			jobSystem.Wait(third);
+			jobSystem.Wait(second);
+			jobSystem.Wait(first);
+
+			CHECK(order.size() == 12 && order[10] == 2 && order[11] == 3);
+
+			// A dependency that's already done doesn't hold anything back
+			bool ran = false;
+			jobSystem.Run([&]() { ran = true; }, &third, &first);
+			jobSystem.Wait(third);
+			CHECK(ran);
+		}
+	}
+
+	void PinnedJobsRunOnTheMainThread() {
+		for (uint32_t workers : WorkerCounts)
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+			const std::thread::id mainThread = std::this_thread::get_id();
+			std::atomic<int> pinned(0);
+			std::atomic<int> elsewhere(0);
+			JobCounter counter;
+			for (int i{ 0 }; i < 100; i++)
+			{
+				jobSystem.Run([&]() {
+					jobSystem.RunPinned([&]() {
+						(std::this_thread::get_id() == mainThread ? pinned : elsewhere)++;
+						CHECK(JobSystem::GetThreadIndex() == 0);
+					}, &counter);
+				}, &counter);
+			}
+			jobSystem.Wait(counter);
+			CHECK(pinned.load() == 100);
+			CHECK(elsewhere.load() == 0);
+
+			// Or when the main thread asks for them
+			jobSystem.RunPinned([&]() { pinned++; });
+			jobSystem.RunPinnedJobs();
+			CHECK(pinned.load() == 101);
+		}
+	}
+
+	void OutsideThreadsGoThroughTheSharedQueue() {
+		for (uint32_t workers : WorkerCounts)
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+			std::atomic<int> count(0);
+			JobCounter counter;
+			uint32_t outsideIndex = 0;
+			std::thread outside([&]() {
+				outsideIndex = JobSystem::GetThreadIndex();
+				for (int i{ 0 }; i < 1000; i++)
+				{
+					jobSystem.Run([&]() { count++; }, &counter);
+				}
+				jobSystem.Wait(counter);
+			});
+			outside.join();
+			jobSystem.Wait(counter);
+			CHECK(outsideIndex == JobSystem::InvalidThread);
+			CHECK(count.load() == 1000);
+		}
+	}
+
+	void FullDequeRunsInline() {
+		for (uint32_t workers : WorkerCounts)
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+			std::atomic<int> count(0);
+			JobCounter counter;
+			// Past the deque's 4096
+			for (int i{ 0 }; i < 10000; i++)
+			{
+				jobSystem.Run([&]() { count++; }, &counter);
+			}
+			jobSystem.Wait(counter);
+			CHECK(count.load() == 10000);
+			const JobSystemStats stats = jobSystem.GetStats();
+			CHECK(stats.threadCount == workers + 1);
+			CHECK(stats.executed + stats.ranInline >= 10000);
+		}
+	}
+
+	void ShutdownDrainsEverything() {
+		for (uint32_t workers : WorkerCounts)
+		{
+			std::atomic<int> count(0);
+			{
+				JobSystem jobSystem;
+				jobSystem.Initialize(workers);
+				for (int i{ 0 }; i < 100; i++)
+				{
+					jobSystem.Run([&]() { count++; });
+					jobSystem.RunPinned([&]() { count++; });
+				}
+				jobSystem.Shutdown();
+				CHECK(count.load() == 200);
+				// Again is fine, and so is the destructor after it
+				jobSystem.Shutdown();
+			}
+			CHECK(JobSystem::GetThreadIndex() == JobSystem::InvalidThread);
+		}
+	}
+}
+
+int main() {
+	RUN_TEST(DequeOwnerIsLifoThievesFifo);
+	RUN_TEST(DequeHandsOutEveryItemOnce);
+	RUN_TEST(ParallelForCoversTheRangeOnce);
+	RUN_TEST(NestedWaitsRunOtherJobs);
+	RUN_TEST(DependencyHoldsJobBack);
+	RUN_TEST(PinnedJobsRunOnTheMainThread);
+	RUN_TEST(OutsideThreadsGoThroughTheSharedQueue);
+	RUN_TEST(FullDequeRunsInline);
+	RUN_TEST(ShutdownDrainsEverything);
+	return TestResult();
+}
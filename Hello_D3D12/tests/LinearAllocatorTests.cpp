@@ -0,0 +1,145 @@
+#include "Graphics/LinearAllocator.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const uint64_t GpuBase = 0x10000000;
+
+	void AllocationsAreAligned() {
+		std::vector<uint8_t> memory(4096);
+		LinearAllocator allocator;
+		allocator.Initialize(memory.data(), GpuBase, memory.size());
+		LinearAllocation allocation;
+
+		CHECK(allocator.Allocate(3, 1, allocation) && allocation.offset == 0 && allocation.size == 3);
+		CHECK(allocator.Allocate(8, 16, allocation) && allocation.offset == 16);
+		CHECK(allocator.Allocate(1, 1, allocation) && allocation.offset == 24);
+		CHECK(allocator.Allocate(100, 256, allocation) && allocation.offset == 256);
+		CHECK(allocation.cpuAddress == memory.data() + 256 && allocation.gpuAddress == GpuBase + 256);
+		CHECK(allocator.GetUsed() == 356);
+		// Already on the boundary, no padding
+		CHECK(allocator.Allocate(4, 4, allocation) && allocation.offset == 356);
+	}
+
+	// A failed allocation leaves the offset alone, so a smaller one after it still fits
+	void ExhaustionLeavesTheOffset() {
+		std::vector<uint8_t> memory(1024);
+		LinearAllocator allocator;
+		allocator.Initialize(memory.data(), GpuBase, memory.size());
+		LinearAllocation allocation;
+		CHECK(allocator.Allocate(700, 256, allocation));
+		CHECK(!allocator.Allocate(100, 512, allocation));
+		CHECK(allocator.GetUsed() == 700);
+		CHECK(allocator.Allocate(324, 4, allocation) && allocation.offset == 700);
+		CHECK(allocator.GetUsed() == allocator.GetCapacity());
+		CHECK(!allocator.Allocate(1, 1, allocation));
+		allocator.Reset();
+		CHECK(allocator.GetUsed() == 0 && allocator.Allocate(1024, 1024, allocation) && allocation.offset == 0);
+	}
+
+	// Each frame slot has its own range, a full one fails without spilling into the next. Moving on to the next
+	// slot rolls over into a fresh range, coming back to a slot resets only that one.
+	void FramesRollOverAndReset() {
+		const uint64_t perFrame = 1024;
+		std::vector<uint8_t> memory(perFrame * 3);
+		FrameUploadAllocator allocator;
+		allocator.Initialize(memory.data(), GpuBase, perFrame, 3);
+		LinearAllocation allocation;
+
+		struct Constants
+		{
+			float values[20];
+		};
+		Constants constants = {};
+		constants.values[19] = 19.0f;
+
+		uint64_t used[3] = {};
+		for (uint32_t frame{ 0 }; frame < 3; frame++)
+		{
+			allocator.BeginFrame(frame);
+			CHECK(allocator.GetUsed() == 0);
+			for (uint32_t i{ 0 }; i <= frame; i++)
+			{
+				CHECK(allocator.AllocateConstants(constants, allocation));
+				CHECK(allocation.offset % FrameUploadAllocator::ConstantBufferAlignment == 0);
+				CHECK(allocation.cpuAddress >= memory.data() + frame * perFrame && allocation.cpuAddress + sizeof(Constants) <= memory.data() + (frame + 1) * perFrame);
+				CHECK(allocation.gpuAddress == GpuBase + static_cast<uint64_t>(allocation.cpuAddress - memory.data()));
+				float copied;
+				memcpy(&copied, allocation.cpuAddress + 19 * sizeof(float), sizeof(copied));
+				CHECK(copied == 19.0f);
+			}
+			used[frame] = allocator.GetUsed();
+		}
+		CHECK(used[0] == 80 && used[1] == 256 + 80 && used[2] == 512 + 80);
+
+		// Frame 2's range holds four constant buffers, the fifth fails and is counted
+		CHECK(allocator.AllocateConstants(constants, allocation));
+		CHECK(!allocator.AllocateConstants(constants, allocation));
+		CHECK(allocator.GetFailedAllocations() == 1);
+
+		// Slot 0 again, its range empty. The peak is taken as each slot is recycled.
+		allocator.BeginFrame(0);
+		CHECK(allocator.GetUsed() == 0);
+		CHECK(allocator.AllocateConstants(constants, allocation) && allocation.cpuAddress == memory.data());
+		allocator.BeginFrame(1);
+		CHECK(allocator.GetPeakUsed() == 256 + 80);
+		allocator.BeginFrame(2);
+		CHECK(allocator.GetPeakUsed() == 768 + 80);
+	}
+
+	// Threads recording in parallel get slices that never overlap
+	void ThreadsGetDisjointSlices() {
+		const uint32_t threadCount = 4;
+		const uint32_t perThread = 5000;
+		std::vector<uint8_t> memory(threadCount * perThread * 128);
+		LinearAllocator allocator;
+		allocator.Initialize(memory.data(), GpuBase, memory.size());
+
+		std::vector<std::vector<LinearAllocation>> allocations(threadCount);
+		std::vector<std::thread> threads;
+		for (uint32_t t{ 0 }; t < threadCount; t++)
+		{
+			threads.emplace_back([&, t]() {
+				for (uint32_t i{ 0 }; i < perThread; i++)
+				{
+					LinearAllocation allocation;
+					const uint64_t alignment = 1ull << ((i + t) % 7);
+					if (allocator.Allocate(1 + (i * 7 + t) % 40, alignment, allocation))
+					{
+						allocations[t].push_back(allocation);
+					}
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		std::vector<LinearAllocation> all;
+		for (const std::vector<LinearAllocation>& list : allocations)
+		{
+			all.insert(all.end(), list.begin(), list.end());
+		}
+		CHECK(all.size() == threadCount * perThread);
+		std::sort(all.begin(), all.end(), [](const LinearAllocation& a, const LinearAllocation& b) { return a.offset < b.offset; });
+		bool disjoint = true;
+		for (size_t i{ 1 }; i < all.size(); i++)
+		{
+			disjoint = disjoint && all[i - 1].offset + all[i - 1].size <= all[i].offset;
+		}
+		CHECK(disjoint);
+		CHECK(all.back().offset + all.back().size <= allocator.GetUsed());
+	}
+}
+
+int main() {
+	RUN_TEST(AllocationsAreAligned);
+	RUN_TEST(ExhaustionLeavesTheOffset);
+	RUN_TEST(FramesRollOverAndReset);
+	RUN_TEST(ThreadsGetDisjointSlices);
+	return TestResult();
+}
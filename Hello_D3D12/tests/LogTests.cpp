@@ -0,0 +1,141 @@
+#include "Core/Log.h"
+#include "TestHarness.h"
+#include <spdlog/async.h>
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/sinks/ostream_sink.h>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	// Holds the background thread in its first write until Release, so the queue behind it fills up
+	class GateSink : public spdlog::sinks::base_sink<std::mutex> {
+		private:
+			std::mutex m_gateMutex;
+			std::condition_variable m_gateChanged;
+			bool m_open = false;
+			bool m_entered = false;
+
+		public:
+			std::atomic<int> written{ 0 };
+
+			void WaitUntilEntered()
+			{
+				std::unique_lock<std::mutex> lock(m_gateMutex);
+				m_gateChanged.wait(lock, [this]() { return m_entered; });
+			}
+
+			void Release()
+			{
+				std::lock_guard<std::mutex> lock(m_gateMutex);
+				m_open = true;
+				m_gateChanged.notify_all();
+			}
+
+		protected:
+			void sink_it_(const spdlog::details::log_msg&) override
+			{
+				std::unique_lock<std::mutex> lock(m_gateMutex);
+				m_entered = true;
+				m_gateChanged.notify_all();
+				m_gateChanged.wait(lock, [this]() { return m_open; });
+				written++;
+			}
+
+			void flush_() override {}
+	};
+
+	void QueueDiscardsWhenFull() {
+		spdlog::details::mpmc_blocking_queue<int> queue(4);
+		for (int i{ 0 }; i < 6; i++)
+		{
+			int item = i;
+			queue.enqueue_if_have_room(std::move(item));
+		}
+		CHECK(queue.size() == 4);
+		CHECK(queue.discard_counter() == 2);
+
+		// The oldest are kept, the new ones went
+		for (int i{ 0 }; i < 4; i++)
+		{
+			int item = -1;
+			CHECK(queue.dequeue_for(item, std::chrono::milliseconds(0)));
+			CHECK(item == i);
+		}
+		queue.reset_discard_counter();
+		CHECK(queue.discard_counter() == 0);
+	}
+
+	void DiscardNewNeverBlocks() {
+		std::shared_ptr<GateSink> sink = std::make_shared<GateSink>();
+		{
+			std::shared_ptr<spdlog::details::thread_pool> threadPool = std::make_shared<spdlog::details::thread_pool>(16, 1);
+			std::shared_ptr<spdlog::async_logger> logger = std::make_shared<spdlog::async_logger>("discard", sink, threadPool,
+				spdlog::async_overflow_policy::discard_new);
+
+			// The background thread takes the first message and sits on it, 16 more fill the queue
+			logger->info("first");
+			sink->WaitUntilEntered();
+			for (int i{ 0 }; i < 100; i++)
+			{
+				logger->info("message {}", i);
+			}
+			CHECK(threadPool->queue_size() == 16);
+			CHECK(threadPool->discard_counter() == 100 - 16);
+
+			sink->Release();
+			logger.reset();
+			// Drains and joins
+		}
+		CHECK(sink->written.load() == 1 + 16);
+	}
+
+	void FrameTagGoesOnAtTheCall() {
+		std::ostringstream text;
+		std::shared_ptr<spdlog::logger> previous = spdlog::default_logger();
+		std::shared_ptr<spdlog::logger> logger = std::make_shared<spdlog::logger>("capture",
+			std::make_shared<spdlog::sinks::ostream_sink_mt>(text));
+		logger->set_pattern("%v");
+		spdlog::set_default_logger(logger);
+
+		Log::SetFrame(7);
+		LOG_FRAME_INFO("hello {}", "world");
+		LOG_FRAME_WARN("no arguments");
+		// Before Initialize the hot path is the default logger
+		LOG_HOT_ERROR("hot {}", 1);
+		Log::SetFrame(8);
+		LOG_FRAME_INFO("next");
+
+		spdlog::set_default_logger(previous);
+		CHECK(text.str() == "[frame 7] hello world\n[frame 7] no arguments\n[frame 7] hot 1\n[frame 8] next\n");
+	}
+
+	void InitializeAndShutdown() {
+		Log::Initialize(64);
+		CHECK(Log::GetHotLogger() != spdlog::default_logger_raw());
+		CHECK(Log::GetDiscardedCount() == 0);
+		Log::Shutdown();
+		CHECK(Log::GetHotLogger() == spdlog::default_logger_raw());
+		CHECK(Log::GetQueuedCount() == 0);
+		// Twice is fine
+		Log::Shutdown();
+
+		// So is a second cycle, even with something else registered under the fallback's name meanwhile
+		Log::Initialize(64);
+		spdlog::register_logger(std::make_shared<spdlog::logger>("engine_sync"));
+		LOG_HOT_INFO("second cycle");
+		Log::Shutdown();
+		CHECK(Log::GetHotLogger() == spdlog::default_logger_raw());
+		spdlog::info("after the second cycle");
+	}
+}
+
+int main() {
+	RUN_TEST(QueueDiscardsWhenFull);
+	RUN_TEST(DiscardNewNeverBlocks);
+	RUN_TEST(FrameTagGoesOnAtTheCall);
+	RUN_TEST(InitializeAndShutdown);
+	return TestResult();
+}
@@ -0,0 +1,374 @@
+#include "Graphics/MipChain.h"
+#include "Core/JobSystem.h"
+#include "TestHarness.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+	const double Pi = 3.14159265358979323846;
+
+	// Everything below is a double precision reference written from the definitions, not from MipChain.cpp
+	double SrgbToLinear(double value) {
+		return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+	}
+
+	double LinearToSrgb(double value) {
+		value = value < 0.0 ? 0.0 : value > 1.0 ? 1.0 : value;
+		return value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+	}
+
+	double BesselI0(double x) {
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k{ 1 }; k < 30; k++)
+		{
+			term *= x / 2.0 / k;
+			sum += term * term;
+		}
+		return sum;
+	}
+
+	// Half of a sinc two destination pixels wide, Kaiser window with alpha 4, taps at -2.5 to 2.5
+	std::vector<double> KaiserWeights() {
+		std::vector<double> weights(6);
+		double sum = 0.0;
+		for (int k{ 0 }; k < 6; k++)
+		{
+			const double d = k - 2.5;
+			const double x = Pi * d / 2.0;
+			const double t = d / 3.0;
+			weights[k] = std::sin(x) / x * BesselI0(4.0 * std::sqrt(1.0 - t * t)) / BesselI0(4.0);
+			sum += weights[k];
+		}
+		for (double& weight : weights)
+		{
+			weight /= sum;
+		}
+		return weights;
+	}
+
+	// Normal halves only, that's all the inputs use
+	uint16_t MakeHalf(bool negative, int exponent, uint32_t mantissa) {
+		return static_cast<uint16_t>((negative ? 0x8000 : 0) | ((exponent + 15) << 10) | mantissa);
+	}
+
+	double HalfValue(uint16_t half) {
+		const int exponent = (half >> 10) & 0x1F;
+		const double value = exponent == 0 ? std::ldexp(half & 0x3FF, -24) : std::ldexp(1.0 + (half & 0x3FF) / 1024.0, exponent - 15);
+		return (half & 0x8000) ? -value : value;
+	}
+
+	struct Image
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<double> values;
+
+		double& At(uint32_t x, uint32_t y, int channel) { return values[(y * width + x) * 4 + channel]; }
+	};
+
+	uint32_t Clamp(int value, uint32_t size) {
+		return static_cast<uint32_t>(value < 0 ? 0 : value >= static_cast<int>(size) ? static_cast<int>(size) - 1 : value);
+	}
+
+	Image Downsample(Image& source, MipFilter filter) {
+		const std::vector<double> weights = KaiserWeights();
+		Image destination;
+		destination.width = source.width / 2 > 0 ? source.width / 2 : 1;
+		destination.height = source.height / 2 > 0 ? source.height / 2 : 1;
+		destination.values.assign(destination.width * destination.height * 4, 0.0);
+		for (uint32_t y{ 0 }; y < destination.height; y++)
+		{
+			for (uint32_t x{ 0 }; x < destination.width; x++)
+			{
+				for (int channel{ 0 }; channel < 4; channel++)
+				{
+					double value = 0.0;
+					if (filter == MipFilter::Box)
+					{
+						for (int j{ 0 }; j < 2; j++)
+						{
+							for (int i{ 0 }; i < 2; i++)
+							{
+								value += 0.25 * source.At(Clamp(2 * x + i, source.width), Clamp(2 * y + j, source.height), channel);
+							}
+						}
+					}
+					else
+					{
+						for (int j{ 0 }; j < 6; j++)
+						{
+							for (int i{ 0 }; i < 6; i++)
+							{
+								value += weights[i] * weights[j] *
+									source.At(Clamp(2 * x + i - 2, source.width), Clamp(2 * y + j - 2, source.height), channel);
+							}
+						}
+					}
+					destination.At(x, y, channel) = value;
+				}
+			}
+		}
+		return destination;
+	}
+
+	// What's stored for channel of pixel (x, y), as the value the reference works with
+	double StoredValue(const MipChainDesc& desc, const uint8_t* row, uint32_t x, int channel) {
+		if (desc.format == MipFormat::RGBA8)
+		{
+			const double value = row[x * 4 + channel] / 255.0;
+			return desc.srgb && channel < 3 ? SrgbToLinear(value) : value;
+		}
+		if (desc.format == MipFormat::RGBA16F)
+		{
+			uint16_t half = 0;
+			memcpy(&half, row + x * 8 + channel * 2, sizeof(half));
+			return HalfValue(half);
+		}
+		float value = 0.0f;
+		memcpy(&value, row + x * 16 + channel * 4, sizeof(value));
+		return value;
+	}
+
+	// RGBA8 in 8 bit steps, halves relative to their size, floats absolute
+	double StoredError(const MipChainDesc& desc, const uint8_t* row, uint32_t x, int channel, double expected) {
+		if (desc.format == MipFormat::RGBA8)
+		{
+			const double clamped = expected < 0.0 ? 0.0 : expected > 1.0 ? 1.0 : expected;
+			const double expectedByte = (desc.srgb && channel < 3 ? LinearToSrgb(expected) : clamped) * 255.0;
+			return std::fabs(row[x * 4 + channel] - expectedByte);
+		}
+		const double value = StoredValue(desc, row, x, channel);
+		if (desc.format == MipFormat::RGBA16F)
+		{
+			return std::fabs(value - expected) / (1e-3 + std::fabs(expected));
+		}
+		return std::fabs(value - expected);
+	}
+
+	void FillLevelZero(const MipChainDesc& desc, const MipFootprint& footprint, uint8_t* data, Image& reference, std::mt19937& random) {
+		reference.width = footprint.width;
+		reference.height = footprint.height;
+		reference.values.resize(footprint.width * footprint.height * 4);
+		for (uint32_t y{ 0 }; y < footprint.height; y++)
+		{
+			uint8_t* row = data + y * footprint.rowPitch;
+			for (uint32_t x{ 0 }; x < footprint.width; x++)
+			{
+				for (int channel{ 0 }; channel < 4; channel++)
+				{
+					if (desc.format == MipFormat::RGBA8)
+					{
+						row[x * 4 + channel] = static_cast<uint8_t>(random());
+					}
+					else if (desc.format == MipFormat::RGBA16F)
+					{
+						const uint16_t half = MakeHalf(random() % 4 == 0, -5 + static_cast<int>(random() % 6), random() % 1024);
+						memcpy(row + x * 8 + channel * 2, &half, sizeof(half));
+					}
+					else
+					{
+						const float value = static_cast<float>(random() % 20001) / 10000.0f - 0.5f;
+						memcpy(row + x * 16 + channel * 4, &value, sizeof(value));
+					}
+					reference.At(x, y, channel) = StoredValue(desc, row, x, channel);
+				}
+			}
+		}
+	}
+
+	// A 2x2 black and white checker averages to half the light, which is 188 in sRGB and 128 stored linear
+	void CheckerAveragesInLinearLight() {
+		for (bool srgb : { false, true })
+		{
+			MipFootprint footprints[2];
+			std::vector<uint8_t> data(ComputeMipFootprints(MipFormat::RGBA8, 2, 2, 2, footprints));
+			const uint8_t top[8] = { 0, 0, 0, 255, 255, 255, 255, 255 };
+			const uint8_t bottom[8] = { 255, 255, 255, 255, 0, 0, 0, 255 };
+			memcpy(data.data(), top, sizeof(top));
+			memcpy(data.data() + footprints[0].rowPitch, bottom, sizeof(bottom));
+
+			MipChainDesc desc;
+			desc.srgb = srgb;
+			GenerateMipChain(desc, data.data(), footprints, 2, nullptr);
+			const uint8_t* pixel = data.data() + footprints[1].offset;
+			const uint8_t expected = srgb ? 188 : 128;
+			CHECK(pixel[0] == expected && pixel[1] == expected && pixel[2] == expected && pixel[3] == 255);
+		}
+	}
+
+	// Same layout as GetCopyableFootprints for a 256x256 RGBA8 texture with all its levels
+	void FootprintsFollowD3D12() {
+		CHECK(GetMipLevelCount(256, 256) == 9);
+		CHECK(GetMipLevelCount(37, 11) == 6);
+		CHECK(GetMipLevelCount(1, 1) == 1);
+
+		MipFootprint footprints[9];
+		const uint64_t size = ComputeMipFootprints(MipFormat::RGBA8, 256, 256, 9, footprints);
+		const uint64_t offsets[9] = { 0, 262144, 327680, 344064, 352256, 356352, 358400, 359424, 359936 };
+		const uint32_t pitches[9] = { 1024, 512, 256, 256, 256, 256, 256, 256, 256 };
+		for (uint32_t level{ 0 }; level < 9; level++)
+		{
+			CHECK(footprints[level].offset == offsets[level]);
+			CHECK(footprints[level].rowPitch == pitches[level]);
+			CHECK(footprints[level].width == 256u >> level && footprints[level].height == 256u >> level);
+		}
+		// The last row without its padding
+		CHECK(size == 359936 + 4);
+
+		// Odd sizes and wider pixels still keep D3D12's alignments
+		MipFootprint odd[6];
+		ComputeMipFootprints(MipFormat::RGBA32F, 37, 11, 6, odd);
+		for (uint32_t level{ 1 }; level < 6; level++)
+		{
+			CHECK(odd[level].offset % MipFootprintPlacementAlignment == 0);
+			CHECK(odd[level].rowPitch % MipFootprintPitchAlignment == 0 && odd[level].rowPitch >= odd[level].width * 16);
+			CHECK(odd[level].offset >= odd[level - 1].offset + static_cast<uint64_t>(odd[level - 1].rowPitch) * odd[level - 1].height);
+		}
+		CHECK(odd[5].width == 1 && odd[5].height == 1);
+	}
+
+	// Every format, filter and kernel level against the reference. Each level of the reference starts from what
+	// was stored for the level above, so rounding doesn't pile up differently.
+	void ChainsMatchTheReference() {
+		JobSystem jobSystem;
+		jobSystem.Initialize(3);
+		const MipFormat formats[] = { MipFormat::RGBA8, MipFormat::RGBA16F, MipFormat::RGBA32F };
+		const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser };
+		const uint32_t sizes[][2] = { { 64, 64 }, { 37, 11 }, { 1, 9 }, { 128, 3 } };
+		for (MipFormat format : formats)
+		{
+			for (MipFilter filter : filters)
+			{
+				for (bool srgb : { false, true })
+				{
+					if (srgb && format != MipFormat::RGBA8)
+					{
+						continue;
+					}
+					MipChainDesc desc;
+					desc.format = format;
+					desc.filter = filter;
+					desc.srgb = srgb;
+					const double tolerance = format == MipFormat::RGBA8 ? 1.0 : format == MipFormat::RGBA16F ? 2e-3 : 1e-5;
+
+					for (const uint32_t* size : sizes)
+					{
+						for (SimdLevel simdLevel : Levels)
+						{
+							SetSimdLevel(simdLevel);
+							const uint32_t levelCount = GetMipLevelCount(size[0], size[1]);
+							std::vector<MipFootprint> footprints(levelCount);
+							std::vector<uint8_t> data(ComputeMipFootprints(format, size[0], size[1], levelCount, footprints.data()));
+							std::mt19937 random(size[0] * 131 + size[1]);
+							Image reference;
+							FillLevelZero(desc, footprints[0], data.data(), reference, random);
+							GenerateMipChain(desc, data.data(), footprints.data(), levelCount, &jobSystem);
+
+							double error = 0.0;
+							for (uint32_t level{ 1 }; level < levelCount; level++)
+							{
+								reference = Downsample(reference, filter);
+								CHECK(reference.width == footprints[level].width && reference.height == footprints[level].height);
+								for (uint32_t y{ 0 }; y < reference.height; y++)
+								{
+									const uint8_t* row = data.data() + footprints[level].offset + y * footprints[level].rowPitch;
+									for (uint32_t x{ 0 }; x < reference.width; x++)
+									{
+										for (int channel{ 0 }; channel < 4; channel++)
+										{
+											const double e = StoredError(desc, row, x, channel, reference.At(x, y, channel));
+											error = e > error ? e : error;
+											reference.At(x, y, channel) = StoredValue(desc, row, x, channel);
+										}
+									}
+								}
+							}
+							CHECK_NEAR(error, 0.0, tolerance);
+						}
+					}
+				}
+			}
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+		jobSystem.Shutdown();
+	}
+
+	// A box over four copies of a value is that value, so every finite half has to come back bit for bit
+	// through the half to float and float to half conversions
+	void HalvesRoundTripExactly() {
+		const uint32_t size = 256;
+		MipFootprint footprints[2];
+		std::vector<uint8_t> data(ComputeMipFootprints(MipFormat::RGBA16F, size, size, 2, footprints));
+		for (uint32_t half{ 0 }; half < 65536; half++)
+		{
+			// 4 channels per pixel, each pixel of the level below is a 2x2 block
+			const uint32_t pixel = half / 4;
+			const uint32_t channel = half % 4;
+			const uint32_t x = pixel % (size / 2);
+			const uint32_t y = pixel / (size / 2);
+			const uint16_t value = ((half >> 10) & 0x1F) == 0x1F ? 0 : static_cast<uint16_t>(half);
+			for (uint32_t j{ 0 }; j < 2; j++)
+			{
+				for (uint32_t i{ 0 }; i < 2; i++)
+				{
+					memcpy(data.data() + (2 * y + j) * footprints[0].rowPitch + (2 * x + i) * 8 + channel * 2, &value, sizeof(value));
+				}
+			}
+		}
+
+		MipChainDesc desc;
+		desc.format = MipFormat::RGBA16F;
+		for (SimdLevel level : Levels)
+		{
+			SetSimdLevel(level);
+			GenerateMipChain(desc, data.data(), footprints, 2, nullptr);
+			uint32_t mismatches = 0;
+			for (uint32_t half{ 0 }; half < 65536; half++)
+			{
+				const uint32_t pixel = half / 4;
+				const uint16_t expected = ((half >> 10) & 0x1F) == 0x1F ? 0 : static_cast<uint16_t>(half);
+				uint16_t value = 0;
+				memcpy(&value, data.data() + footprints[1].offset + (pixel / (size / 2)) * footprints[1].rowPitch + (pixel % (size / 2)) * 8 +
+					(half % 4) * 2, sizeof(value));
+				mismatches += value == expected ? 0 : 1;
+			}
+			CHECK(mismatches == 0);
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+	}
+
+	void ThreadsDontChangeTheResult() {
+		JobSystem jobSystem;
+		jobSystem.Initialize(3);
+		MipChainDesc desc;
+		desc.filter = MipFilter::Kaiser;
+		desc.srgb = true;
+		const uint32_t levelCount = GetMipLevelCount(300, 200);
+		std::vector<MipFootprint> footprints(levelCount);
+		std::vector<uint8_t> serial(ComputeMipFootprints(MipFormat::RGBA8, 300, 200, levelCount, footprints.data()));
+		std::mt19937 random(9);
+		for (uint64_t i{ 0 }; i < footprints[1].offset; i++)
+		{
+			serial[i] = static_cast<uint8_t>(random());
+		}
+		std::vector<uint8_t> threaded = serial;
+		GenerateMipChain(desc, serial.data(), footprints.data(), levelCount, nullptr);
+		GenerateMipChain(desc, threaded.data(), footprints.data(), levelCount, &jobSystem);
+		CHECK(serial == threaded);
+		jobSystem.Shutdown();
+	}
+}
+
+int main() {
+	RUN_TEST(CheckerAveragesInLinearLight);
+	RUN_TEST(FootprintsFollowD3D12);
+	RUN_TEST(ChainsMatchTheReference);
+	RUN_TEST(HalvesRoundTripExactly);
+	RUN_TEST(ThreadsDontChangeTheResult);
+	return TestResult();
+}
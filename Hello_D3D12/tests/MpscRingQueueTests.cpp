@@ -0,0 +1,173 @@
+// Built with SPDLOG_USE_MPSC_QUEUE, so spdlog's thread pool runs on the ring too
+#include "TestHarness.h"
+#include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/details/mpsc_ring_q.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/sinks/base_sink.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef spdlog::details::mpsc_ring_queue<int> IntQueue;
+
+	class CountingSink : public spdlog::sinks::base_sink<spdlog::details::null_mutex> {
+		public:
+			std::atomic<size_t> count{ 0 };
+
+		protected:
+			void sink_it_(const spdlog::details::log_msg&) override { count++; }
+			void flush_() override {}
+	};
+
+	bool Dequeue(IntQueue& queue, int& item) {
+		return queue.dequeue_for(item, std::chrono::milliseconds(0));
+	}
+
+	void FirstInFirstOut() {
+		// Rounded up to a power of two
+		IntQueue queue(5);
+		for (int i{ 0 }; i < 8; i++)
+		{
+			int item = i;
+			queue.enqueue_if_have_room(std::move(item));
+		}
+		CHECK(queue.size() == 8);
+		CHECK(queue.discard_counter() == 0);
+
+		int item = -1;
+		for (int i{ 0 }; i < 8; i++)
+		{
+			CHECK(Dequeue(queue, item) && item == i);
+		}
+		CHECK(!Dequeue(queue, item));
+		CHECK(queue.size() == 0);
+	}
+
+	void DiscardNewDropsTheNewest() {
+		IntQueue queue(4);
+		for (int i{ 0 }; i < 7; i++)
+		{
+			int item = i;
+			queue.enqueue_if_have_room(std::move(item));
+		}
+		CHECK(queue.discard_counter() == 3);
+		int item = -1;
+		CHECK(Dequeue(queue, item) && item == 0);
+		queue.reset_discard_counter();
+		CHECK(queue.discard_counter() == 0);
+	}
+
+	void OverrunDropsTheOldest() {
+		IntQueue queue(4);
+		for (int i{ 0 }; i < 7; i++)
+		{
+			int item = i;
+			queue.enqueue_nowait(std::move(item));
+		}
+		CHECK(queue.overrun_counter() == 3);
+		int item = -1;
+		for (int i{ 3 }; i < 7; i++)
+		{
+			CHECK(Dequeue(queue, item) && item == i);
+		}
+	}
+
+	void EmptyDequeueTimesOut() {
+		IntQueue queue(4);
+		int item = -1;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		CHECK(!queue.dequeue_for(item, std::chrono::milliseconds(20)));
+		CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+	}
+
+	// Many producers blocking on a small queue, every item arrives once and each producer's in order
+	void BlockingProducersLoseNothing() {
+		const int producerCount = 8;
+		const int itemsPerProducer = 20000;
+		IntQueue queue(64);
+
+		std::vector<std::thread> producers;
+		for (int p{ 0 }; p < producerCount; p++)
+		{
+			producers.emplace_back([&queue, p]() {
+				for (int i{ 0 }; i < itemsPerProducer; i++)
+				{
+					int item = p * itemsPerProducer + i;
+					queue.enqueue(std::move(item));
+				}
+			});
+		}
+
+		std::vector<int> next(producerCount, 0);
+		int outOfOrder = 0;
+		for (int received{ 0 }; received < producerCount * itemsPerProducer; received++)
+		{
+			int item = -1;
+			queue.dequeue(item);
+			const int producer = item / itemsPerProducer;
+			outOfOrder += item % itemsPerProducer == next[producer] ? 0 : 1;
+			next[producer] = item % itemsPerProducer + 1;
+		}
+		for (std::thread& producer : producers)
+		{
+			producer.join();
+		}
+
+		CHECK(outOfOrder == 0);
+		CHECK(queue.size() == 0);
+	}
+
+	// Through the async logger, every message is delivered or counted under each policy
+	void EveryPolicyAccountsForEveryMessage() {
+		const spdlog::async_overflow_policy policies[] = { spdlog::async_overflow_policy::block,
+			spdlog::async_overflow_policy::overrun_oldest, spdlog::async_overflow_policy::discard_new };
+		const int producerCount = 4;
+		const int messagesPerProducer = 5000;
+		for (spdlog::async_overflow_policy policy : policies)
+		{
+			std::shared_ptr<CountingSink> sink = std::make_shared<CountingSink>();
+			size_t overrun = 0;
+			size_t discarded = 0;
+			{
+				std::shared_ptr<spdlog::details::thread_pool> threadPool = std::make_shared<spdlog::details::thread_pool>(128, 1);
+				std::shared_ptr<spdlog::async_logger> logger = std::make_shared<spdlog::async_logger>("ring", sink, threadPool, policy);
+				std::vector<std::thread> producers;
+				for (int p{ 0 }; p < producerCount; p++)
+				{
+					producers.emplace_back([&logger, p]() {
+						for (int i{ 0 }; i < messagesPerProducer; i++)
+						{
+							logger->info("message {} {}", p, i);
+						}
+					});
+				}
+				for (std::thread& producer : producers)
+				{
+					producer.join();
+				}
+				logger.reset();
+				overrun = threadPool->overrun_counter();
+				discarded = threadPool->discard_counter();
+			}
+
+			CHECK(sink->count.load() + overrun + discarded == static_cast<size_t>(producerCount * messagesPerProducer));
+			if (policy == spdlog::async_overflow_policy::block)
+			{
+				CHECK(overrun == 0 && discarded == 0);
+			}
+		}
+	}
+}
+
+int main() {
+	RUN_TEST(FirstInFirstOut);
+	RUN_TEST(DiscardNewDropsTheNewest);
+	RUN_TEST(OverrunDropsTheOldest);
+	RUN_TEST(EmptyDequeueTimesOut);
+	RUN_TEST(BlockingProducersLoseNothing);
+	RUN_TEST(EveryPolicyAccountsForEveryMessage);
+	return TestResult();
+}
@@ -0,0 +1,174 @@
+#include "Graphics/HeadlessCommandBackend.h"
+#include "Graphics/ParallelCommandRecorder.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef ParallelCommandRecorder<HeadlessCommandBackend> Recorder;
+
+	// Each list records its index and a running number in the payload, a varying number of commands so lists
+	// finish out of order
+	void RecordNumbered(uint32_t listIndex, HeadlessCommandList*& list) {
+		const uint32_t count = 1 + (listIndex * 37) % 23;
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			list->Record(listIndex, i);
+		}
+		if (listIndex % 5 == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// The executed stream is list 0's commands in order, then list 1's, and so on
+	bool InIndexOrder(const std::vector<HeadlessCommand>& executed, uint32_t listCount) {
+		size_t position = 0;
+		for (uint32_t list{ 0 }; list < listCount; list++)
+		{
+			const uint32_t count = 1 + (list * 37) % 23;
+			for (uint32_t i{ 0 }; i < count; i++, position++)
+			{
+				if (position >= executed.size() || executed[position].opcode != list || executed[position].payload != i ||
+					executed[position].listIndex != list)
+				{
+					return false;
+				}
+			}
+		}
+		return position == executed.size();
+	}
+
+	// Whatever thread records which list, Submit hands them over in index order in one call
+	void SubmitsInIndexOrder() {
+		for (uint32_t workers : { 0u, 1u, 3u })
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+			HeadlessCommandBackend backend;
+			Recorder recorder;
+			recorder.Initialize(&backend, &jobSystem);
+
+			for (uint32_t frame{ 0 }; frame < 20; frame++)
+			{
+				const uint32_t listCount = 64;
+				backend.ClearExecutedCommands();
+				recorder.Record(listCount, frame, RecordNumbered);
+				recorder.Submit();
+				recorder.Retire(frame + 1);
+				CHECK(InIndexOrder(backend.GetExecutedCommands(), listCount));
+			}
+			CHECK(backend.GetExecuteCalls() == 20);
+
+			// Lists only ever get created, never more than the largest Record asked for
+			const CommandRecorderStats stats = recorder.GetStats();
+			CHECK(stats.threadCount == workers + 1 && stats.commandListCount == 64);
+			recorder.Shutdown();
+			jobSystem.Shutdown();
+		}
+	}
+
+	// A smaller Record after a bigger one submits only its own lists. Submit without a Record since does nothing.
+	void SubmitsOnlyTheLastRecord() {
+		JobSystem jobSystem;
+		jobSystem.Initialize(2);
+		HeadlessCommandBackend backend;
+		Recorder recorder;
+		recorder.Initialize(&backend, &jobSystem);
+
+		recorder.Record(40, 0, RecordNumbered);
+		recorder.Submit();
+		recorder.Retire(1);
+		backend.ClearExecutedCommands();
+		recorder.Record(7, 0, RecordNumbered);
+		recorder.Submit();
+		CHECK(InIndexOrder(backend.GetExecutedCommands(), 7));
+		recorder.Submit();
+		CHECK(backend.GetExecuteCalls() == 2 && recorder.GetStats().commandListCount == 40);
+		recorder.Shutdown();
+		jobSystem.Shutdown();
+	}
+
+	// The headless backend plus a record of which fence each allocator was last submitted under, so a reset of
+	// one the GPU could still be reading shows up
+	class FenceCheckingBackend : public HeadlessCommandBackend {
+		private:
+			std::mutex m_mutex;
+			std::map<Allocator, uint64_t> m_lastUse;
+			std::set<Allocator> m_usedThisFrame;
+
+		public:
+			uint64_t completedFenceValue = 0;
+			uint32_t earlyResets = 0;
+
+			void ResetAllocator(Allocator& allocator) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					const auto found = m_lastUse.find(allocator);
+					if (found != m_lastUse.end() && found->second > completedFenceValue)
+					{
+						earlyResets++;
+					}
+				}
+				HeadlessCommandBackend::ResetAllocator(allocator);
+			}
+
+			void BeginCommandList(CommandList& list, Allocator& allocator) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_usedThisFrame.insert(allocator);
+				}
+				HeadlessCommandBackend::BeginCommandList(list, allocator);
+			}
+
+			// The frame was submitted with this fence
+			void EndFrame(uint64_t fenceValue) {
+				for (Allocator allocator : m_usedThisFrame)
+				{
+					m_lastUse[allocator] = fenceValue;
+				}
+				m_usedThisFrame.clear();
+			}
+	};
+
+	// Frames in flight with the GPU behind: allocators only come back once their frame's fence has completed,
+	// and once warm the pools stop creating new ones
+	void AllocatorsWaitForTheirFence() {
+		const uint32_t framesInFlight = 3;
+		JobSystem jobSystem;
+		jobSystem.Initialize(3);
+		FenceCheckingBackend backend;
+		ParallelCommandRecorder<FenceCheckingBackend> recorder;
+		recorder.Initialize(&backend, &jobSystem);
+
+		for (uint64_t frame{ 1 }; frame <= 200; frame++)
+		{
+			backend.completedFenceValue = frame > framesInFlight ? frame - framesInFlight : 0;
+			backend.ClearExecutedCommands();
+			recorder.Record(32, backend.completedFenceValue, RecordNumbered);
+			recorder.Submit();
+			recorder.Retire(frame);
+			backend.EndFrame(frame);
+			CHECK(InIndexOrder(backend.GetExecutedCommands(), 32));
+		}
+
+		CHECK(backend.earlyResets == 0);
+		const CommandRecorderStats stats = recorder.GetStats();
+		// One per thread per frame in flight plus the one being recorded, at most, however long it runs
+		CHECK(stats.allocatorCount <= stats.threadCount * (framesInFlight + 1));
+		CHECK(stats.allocatorCount == backend.GetAllocatorCount());
+		recorder.Shutdown();
+		jobSystem.Shutdown();
+	}
+}
+
+int main() {
+	RUN_TEST(SubmitsInIndexOrder);
+	RUN_TEST(SubmitsOnlyTheLastRecord);
+	RUN_TEST(AllocatorsWaitForTheirFence);
+	return TestResult();
+}
@@ -0,0 +1,136 @@
+#include "Graphics/PipelineCache.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Inline creation: the first request for a key builds it, later ones get the same value
+	void InlineRequestsDeduplicate() {
+		PipelineCache<std::shared_ptr<int>> cache;
+		uint32_t created = 0;
+		const auto create = [&created]() { created++; return std::make_shared<int>(static_cast<int>(created)); };
+
+		const std::shared_ptr<int> a = cache.Get(1, create);
+		const std::shared_ptr<int> b = cache.Get(1, create);
+		const std::shared_ptr<int> c = cache.Get(2, create);
+		CHECK(created == 2 && a == b && a != c && *a == 1 && *c == 2);
+
+		std::shared_ptr<int> found;
+		CHECK(cache.TryGet(1, found) && found == a);
+		CHECK(!cache.TryGet(3, found));
+
+		const PipelineCacheStats stats = cache.GetStats();
+		CHECK(stats.requests == 3 && stats.deduplicated == 1 && stats.created == 2);
+	}
+
+	// A key still being created on a worker is shared too, TryGet says no until it's done
+	void InFlightRequestsShareOneCreation() {
+		JobSystem jobSystem;
+		jobSystem.Initialize(2);
+		{
+			PipelineCache<int> cache(&jobSystem);
+			std::atomic<bool> release(false);
+			std::atomic<uint32_t> created(0);
+			const auto slow = [&]() {
+				created++;
+				while (!release.load())
+				{
+					std::this_thread::yield();
+				}
+				return 42;
+			};
+
+			const std::shared_future<int> first = cache.Request(7, slow);
+			const std::shared_future<int> second = cache.Request(7, slow);
+			int value = 0;
+			CHECK(!cache.TryGet(7, value));
+			release.store(true);
+			CHECK(cache.Wait(first) == 42 && cache.Wait(second) == 42);
+			CHECK(created == 1 && cache.TryGet(7, value) && value == 42);
+			CHECK(cache.GetStats().deduplicated == 1);
+		}
+		jobSystem.Shutdown();
+	}
+
+	// Threads all asking for the same handful of keys at once: one creation per key, everyone sees its value
+	void ConcurrentRequestsCreateOncePerKey() {
+		const uint32_t keyCount = 16;
+		const uint32_t threadCount = 4;
+		JobSystem jobSystem;
+		jobSystem.Initialize(3);
+		{
+			PipelineCache<uint64_t> cache(&jobSystem);
+			std::vector<std::atomic<uint32_t>> created(keyCount);
+			for (std::atomic<uint32_t>& count : created)
+			{
+				count.store(0);
+			}
+			std::atomic<uint32_t> wrongValues(0);
+
+			std::vector<std::thread> threads;
+			for (uint32_t t{ 0 }; t < threadCount; t++)
+			{
+				threads.emplace_back([&, t]() {
+					for (uint32_t round{ 0 }; round < 200; round++)
+					{
+						const uint64_t key = (round * 7 + t) % keyCount;
+						const uint64_t value = cache.Get(key, [&created, key]() {
+							created[key]++;
+							std::this_thread::sleep_for(std::chrono::microseconds(100));
+							return key * 1000;
+						});
+						wrongValues += value != key * 1000 ? 1 : 0;
+					}
+				});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+
+			bool oncePerKey = true;
+			for (const std::atomic<uint32_t>& count : created)
+			{
+				oncePerKey = oncePerKey && count == 1;
+			}
+			CHECK(oncePerKey);
+			CHECK(wrongValues == 0);
+			const PipelineCacheStats stats = cache.GetStats();
+			CHECK(stats.requests == threadCount * 200 && stats.created == keyCount);
+			CHECK(stats.deduplicated == stats.requests - keyCount);
+		}
+		jobSystem.Shutdown();
+	}
+
+	// Destroying the cache waits for what's still being created
+	void DestructionWaitsForCreations() {
+		JobSystem jobSystem;
+		jobSystem.Initialize(2);
+		std::atomic<uint32_t> finished(0);
+		{
+			PipelineCache<int> cache(&jobSystem);
+			for (uint64_t key{ 0 }; key < 8; key++)
+			{
+				cache.Request(key, [&finished]() {
+					std::this_thread::sleep_for(std::chrono::milliseconds(2));
+					finished++;
+					return 0;
+				});
+			}
+		}
+		CHECK(finished == 8);
+		jobSystem.Shutdown();
+	}
+}
+
+int main() {
+	RUN_TEST(InlineRequestsDeduplicate);
+	RUN_TEST(InFlightRequestsShareOneCreation);
+	RUN_TEST(ConcurrentRequestsCreateOncePerKey);
+	RUN_TEST(DestructionWaitsForCreations);
+	return TestResult();
+}
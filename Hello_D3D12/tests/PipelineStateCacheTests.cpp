@@ -0,0 +1,230 @@
+#include "Graphics/PipelineStateCache.h"
+#include "TestHarness.h"
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Only the desc hashing, which needs the D3D12 headers but no device
+namespace
+{
+	const uint64_t RootSignatureHash = 0x1234;
+
+	// A desc the way the app fills one, built from scratch each time so nothing but the values is shared.
+	// The padding bytes are filled with garbage, they mustn't reach the hash.
+	struct DescBuilder
+	{
+		std::vector<UINT8> vertexShader;
+		std::vector<UINT8> pixelShader;
+		std::string position;
+		std::string texcoord;
+		D3D12_INPUT_ELEMENT_DESC elements[2];
+		D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+
+		explicit DescBuilder(unsigned char padding) : vertexShader(64, 0xAB), pixelShader(48, 0xCD), position("POSITION"), texcoord("TEXCOORD") {
+			memset(&desc, padding, sizeof(desc));
+			memset(elements, padding, sizeof(elements));
+
+			elements[0].SemanticName = position.c_str();
+			elements[0].SemanticIndex = 0;
+			elements[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+			elements[0].InputSlot = 0;
+			elements[0].AlignedByteOffset = 0;
+			elements[0].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA;
+			elements[0].InstanceDataStepRate = 0;
+			elements[1] = elements[0];
+			elements[1].SemanticName = texcoord.c_str();
+			elements[1].Format = DXGI_FORMAT_R32G32_FLOAT;
+			elements[1].AlignedByteOffset = 12;
+
+			desc.pRootSignature = nullptr;
+			desc.VS = { vertexShader.data(), vertexShader.size() };
+			desc.PS = { pixelShader.data(), pixelShader.size() };
+			desc.DS = {};
+			desc.HS = {};
+			desc.GS = {};
+			desc.StreamOutput = {};
+
+			desc.BlendState.AlphaToCoverageEnable = FALSE;
+			desc.BlendState.IndependentBlendEnable = FALSE;
+			for (D3D12_RENDER_TARGET_BLEND_DESC& blend : desc.BlendState.RenderTarget)
+			{
+				blend.BlendEnable = FALSE;
+				blend.LogicOpEnable = FALSE;
+				blend.SrcBlend = D3D12_BLEND_ONE;
+				blend.DestBlend = D3D12_BLEND_ZERO;
+				blend.BlendOp = D3D12_BLEND_OP_ADD;
+				blend.SrcBlendAlpha = D3D12_BLEND_ONE;
+				blend.DestBlendAlpha = D3D12_BLEND_ZERO;
+				blend.BlendOpAlpha = D3D12_BLEND_OP_ADD;
+				blend.LogicOp = D3D12_LOGIC_OP_NOOP;
+				blend.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
+			}
+			desc.SampleMask = UINT_MAX;
+
+			desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+			desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+			desc.RasterizerState.FrontCounterClockwise = FALSE;
+			desc.RasterizerState.DepthBias = D3D12_DEFAULT_DEPTH_BIAS;
+			desc.RasterizerState.DepthBiasClamp = D3D12_DEFAULT_DEPTH_BIAS_CLAMP;
+			desc.RasterizerState.SlopeScaledDepthBias = D3D12_DEFAULT_SLOPE_SCALED_DEPTH_BIAS;
+			desc.RasterizerState.DepthClipEnable = TRUE;
+			desc.RasterizerState.MultisampleEnable = FALSE;
+			desc.RasterizerState.AntialiasedLineEnable = FALSE;
+			desc.RasterizerState.ForcedSampleCount = 0;
+			desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF;
+
+			desc.DepthStencilState.DepthEnable = TRUE;
+			desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+			desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+			desc.DepthStencilState.StencilEnable = FALSE;
+			desc.DepthStencilState.StencilReadMask = D3D12_DEFAULT_STENCIL_READ_MASK;
+			desc.DepthStencilState.StencilWriteMask = D3D12_DEFAULT_STENCIL_WRITE_MASK;
+			desc.DepthStencilState.FrontFace = { D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_STENCIL_OP_KEEP, D3D12_COMPARISON_FUNC_ALWAYS };
+			desc.DepthStencilState.BackFace = desc.DepthStencilState.FrontFace;
+
+			desc.InputLayout = { elements, 2 };
+			desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+			desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+			desc.NumRenderTargets = 1;
+			for (DXGI_FORMAT& format : desc.RTVFormats)
+			{
+				format = DXGI_FORMAT_UNKNOWN;
+			}
+			desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+			desc.SampleDesc = { 1, 0 };
+			desc.NodeMask = 0;
+			desc.CachedPSO = {};
+			desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+		}
+
+		DescBuilder(const DescBuilder&) = delete;
+		DescBuilder& operator=(const DescBuilder&) = delete;
+
+		uint64_t Hash() const { return PipelineStateCache::HashGraphicsPipelineDesc(desc, RootSignatureHash); }
+	};
+
+	// Two descs built separately, with different garbage in the padding and everything behind a pointer living at
+	// another address, hash the same
+	void EqualDescsHashEqual() {
+		DescBuilder a(0x00);
+		DescBuilder b(0xCD);
+		CHECK(a.desc.VS.pShaderBytecode != b.desc.VS.pShaderBytecode && a.elements[0].SemanticName != b.elements[0].SemanticName);
+		CHECK(a.Hash() == b.Hash());
+
+		// What the hash deliberately leaves out: the root signature pointer, cached blobs, unused RTV slots
+		b.desc.pRootSignature = reinterpret_cast<ID3D12RootSignature*>(static_cast<uintptr_t>(0x1000));
+		b.desc.CachedPSO = { b.vertexShader.data(), 8 };
+		b.desc.RTVFormats[5] = DXGI_FORMAT_R16_FLOAT;
+		CHECK(a.Hash() == b.Hash());
+		CHECK(PipelineStateCache::HashGraphicsPipelineDesc(a.desc, RootSignatureHash + 1) != a.Hash());
+	}
+
+	// Every field that changes the PSO changes the key, and no two of these changes land on the same key
+	void EachFieldChangesTheKey() {
+		typedef std::function<void(DescBuilder&)> Change;
+		const std::vector<std::pair<const char*, Change>> changes = {
+			{ "VS bytes", [](DescBuilder& d) { d.vertexShader[10] ^= 1; } },
+			{ "VS length", [](DescBuilder& d) { d.desc.VS.BytecodeLength--; } },
+			{ "PS bytes", [](DescBuilder& d) { d.pixelShader[0] ^= 1; } },
+			{ "PS missing", [](DescBuilder& d) { d.desc.PS = {}; } },
+			{ "GS added", [](DescBuilder& d) { d.desc.GS = { d.pixelShader.data(), d.pixelShader.size() }; } },
+			{ "HS added", [](DescBuilder& d) { d.desc.HS = { d.pixelShader.data(), d.pixelShader.size() }; } },
+			{ "DS added", [](DescBuilder& d) { d.desc.DS = { d.pixelShader.data(), d.pixelShader.size() }; } },
+			{ "AlphaToCoverage", [](DescBuilder& d) { d.desc.BlendState.AlphaToCoverageEnable = TRUE; } },
+			{ "IndependentBlend", [](DescBuilder& d) { d.desc.BlendState.IndependentBlendEnable = TRUE; } },
+			{ "BlendEnable", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].BlendEnable = TRUE; } },
+			{ "LogicOpEnable", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].LogicOpEnable = TRUE; } },
+			{ "SrcBlend", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; } },
+			{ "DestBlend", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA; } },
+			{ "BlendOp", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].BlendOp = D3D12_BLEND_OP_MAX; } },
+			{ "SrcBlendAlpha", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].SrcBlendAlpha = D3D12_BLEND_ZERO; } },
+			{ "DestBlendAlpha", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].DestBlendAlpha = D3D12_BLEND_ONE; } },
+			{ "BlendOpAlpha", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_MIN; } },
+			{ "LogicOp", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].LogicOp = D3D12_LOGIC_OP_XOR; } },
+			{ "WriteMask", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[0].RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED; } },
+			{ "Blend on RT 3", [](DescBuilder& d) { d.desc.BlendState.RenderTarget[3].BlendEnable = TRUE; } },
+			{ "SampleMask", [](DescBuilder& d) { d.desc.SampleMask = 0xF; } },
+			{ "FillMode", [](DescBuilder& d) { d.desc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME; } },
+			{ "CullMode", [](DescBuilder& d) { d.desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; } },
+			{ "FrontCounterClockwise", [](DescBuilder& d) { d.desc.RasterizerState.FrontCounterClockwise = TRUE; } },
+			{ "DepthBias", [](DescBuilder& d) { d.desc.RasterizerState.DepthBias = 4; } },
+			{ "DepthBiasClamp", [](DescBuilder& d) { d.desc.RasterizerState.DepthBiasClamp = 0.5f; } },
+			{ "SlopeScaledDepthBias", [](DescBuilder& d) { d.desc.RasterizerState.SlopeScaledDepthBias = 1.5f; } },
+			{ "DepthClipEnable", [](DescBuilder& d) { d.desc.RasterizerState.DepthClipEnable = FALSE; } },
+			{ "MultisampleEnable", [](DescBuilder& d) { d.desc.RasterizerState.MultisampleEnable = TRUE; } },
+			{ "AntialiasedLineEnable", [](DescBuilder& d) { d.desc.RasterizerState.AntialiasedLineEnable = TRUE; } },
+			{ "ForcedSampleCount", [](DescBuilder& d) { d.desc.RasterizerState.ForcedSampleCount = 4; } },
+			{ "ConservativeRaster", [](DescBuilder& d) { d.desc.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON; } },
+			{ "DepthEnable", [](DescBuilder& d) { d.desc.DepthStencilState.DepthEnable = FALSE; } },
+			{ "DepthWriteMask", [](DescBuilder& d) { d.desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; } },
+			{ "DepthFunc", [](DescBuilder& d) { d.desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER; } },
+			{ "StencilEnable", [](DescBuilder& d) { d.desc.DepthStencilState.StencilEnable = TRUE; } },
+			{ "StencilReadMask", [](DescBuilder& d) { d.desc.DepthStencilState.StencilReadMask = 0x0F; } },
+			{ "StencilWriteMask", [](DescBuilder& d) { d.desc.DepthStencilState.StencilWriteMask = 0xF0; } },
+			{ "FrontFace", [](DescBuilder& d) { d.desc.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_INCR; } },
+			{ "BackFace", [](DescBuilder& d) { d.desc.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL; } },
+			{ "Element count", [](DescBuilder& d) { d.desc.InputLayout.NumElements = 1; } },
+			{ "SemanticName", [](DescBuilder& d) { d.texcoord = "NORMAL"; d.elements[1].SemanticName = d.texcoord.c_str(); } },
+			{ "SemanticIndex", [](DescBuilder& d) { d.elements[1].SemanticIndex = 1; } },
+			{ "Format", [](DescBuilder& d) { d.elements[1].Format = DXGI_FORMAT_R16G16_FLOAT; } },
+			{ "InputSlot", [](DescBuilder& d) { d.elements[1].InputSlot = 1; } },
+			{ "AlignedByteOffset", [](DescBuilder& d) { d.elements[1].AlignedByteOffset = 16; } },
+			{ "InputSlotClass", [](DescBuilder& d) { d.elements[1].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA; } },
+			{ "InstanceDataStepRate", [](DescBuilder& d) { d.elements[1].InstanceDataStepRate = 1; } },
+			{ "IBStripCutValue", [](DescBuilder& d) { d.desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF; } },
+			{ "Topology", [](DescBuilder& d) { d.desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; } },
+			{ "NumRenderTargets", [](DescBuilder& d) { d.desc.NumRenderTargets = 2; } },
+			{ "RTVFormat", [](DescBuilder& d) { d.desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; } },
+			{ "DSVFormat", [](DescBuilder& d) { d.desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT; } },
+			{ "SampleCount", [](DescBuilder& d) { d.desc.SampleDesc.Count = 4; } },
+			{ "SampleQuality", [](DescBuilder& d) { d.desc.SampleDesc.Quality = 1; } },
+			{ "NodeMask", [](DescBuilder& d) { d.desc.NodeMask = 1; } },
+			{ "Flags", [](DescBuilder& d) { d.desc.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; } },
+		};
+
+		DescBuilder base(0);
+		std::vector<uint64_t> keys = { base.Hash() };
+		for (const auto& change : changes)
+		{
+			DescBuilder changed(0);
+			change.second(changed);
+			const uint64_t key = changed.Hash();
+			for (size_t i{ 0 }; i < keys.size(); i++)
+			{
+				if (keys[i] == key)
+				{
+					printf("  %s gives the same key as %s\n", change.first, i == 0 ? "the base desc" : changes[i - 1].first);
+					TestFailed(__FILE__, __LINE__, "distinct keys");
+				}
+			}
+			keys.push_back(key);
+		}
+	}
+
+	// What the cache does with the keys: equal descs requested over and over make one PSO, each different one
+	// makes its own
+	void EqualDescsShareOnePipeline() {
+		PipelineCache<uint32_t> cache;
+		uint32_t created = 0;
+		const auto create = [&created]() { return ++created; };
+
+		DescBuilder a(0x00);
+		DescBuilder b(0x11);
+		DescBuilder c(0x22);
+		c.desc.RasterizerState.CullMode = D3D12_CULL_MODE_FRONT;
+		const uint32_t first = cache.Get(a.Hash(), create);
+		CHECK(cache.Get(b.Hash(), create) == first && cache.Get(a.Hash(), create) == first);
+		CHECK(cache.Get(c.Hash(), create) != first && created == 2);
+		CHECK(cache.GetStats().deduplicated == 2);
+	}
+}
+
+int main() {
+	RUN_TEST(EqualDescsHashEqual);
+	RUN_TEST(EachFieldChangesTheKey);
+	RUN_TEST(EqualDescsShareOnePipeline);
+	return TestResult();
+}
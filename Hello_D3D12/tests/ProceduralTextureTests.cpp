@@ -0,0 +1,168 @@
+#include "Graphics/ProceduralTexture.h"
+#include "Core/JobSystem.h"
+#include "TestHarness.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+	const ProceduralPattern Patterns[] = { ProceduralPattern::Checker, ProceduralPattern::Gradient, ProceduralPattern::Noise };
+	const uint8_t Untouched = 0xCD;
+
+	// Rows padded to 256 bytes like an upload footprint, the padding filled with Untouched
+	struct Image
+	{
+		std::vector<uint8_t> pixels;
+		ProceduralTextureTarget target;
+
+		Image(uint32_t width, uint32_t height) {
+			target.rowPitch = (width * 4 + 255) / 256 * 256;
+			target.width = width;
+			target.height = height;
+			pixels.assign(target.rowPitch * height, Untouched);
+			target.data = pixels.data();
+		}
+
+		uint32_t Pixel(uint32_t x, uint32_t y) const {
+			uint32_t value = 0;
+			memcpy(&value, &pixels[y * target.rowPitch + x * 4], sizeof(value));
+			return value;
+		}
+	};
+
+	ProceduralTextureDesc MakeDesc(ProceduralPattern pattern) {
+		ProceduralTextureDesc desc;
+		desc.pattern = pattern;
+		desc.cellShift = 2;
+		desc.seed = 7;
+		desc.colorA = 0xFF102030;
+		desc.colorB = 0x80F0E0D0;
+		return desc;
+	}
+
+	// The SIMD rows round the gradient and noise blends their own way, a step of 1 at most
+	void LevelsMatchScalar() {
+		JobSystem jobSystem;
+		jobSystem.Initialize(3);
+		for (uint32_t width : { 1u, 7u, 13u, 256u, 333u })
+		{
+			for (ProceduralPattern pattern : Patterns)
+			{
+				const ProceduralTextureDesc desc = MakeDesc(pattern);
+				Image reference(width, width + 3);
+				SetSimdLevel(SimdLevel::Scalar);
+				GenerateProceduralTexture(desc, reference.target, nullptr);
+
+				for (SimdLevel level : Levels)
+				{
+					SetSimdLevel(level);
+					Image image(width, width + 3);
+					GenerateProceduralTexture(desc, image.target, &jobSystem);
+
+					int difference = 0;
+					bool paddingUntouched = true;
+					for (uint64_t i{ 0 }; i < image.pixels.size(); i++)
+					{
+						if (i % image.target.rowPitch >= width * 4)
+						{
+							paddingUntouched = paddingUntouched && image.pixels[i] == Untouched;
+						}
+						else
+						{
+							const int d = std::abs(image.pixels[i] - reference.pixels[i]);
+							difference = d > difference ? d : difference;
+						}
+					}
+					CHECK(difference <= 1);
+					CHECK(paddingUntouched);
+					if (pattern == ProceduralPattern::Checker)
+					{
+						CHECK(difference == 0);
+					}
+				}
+			}
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+		jobSystem.Shutdown();
+	}
+
+	void PatternsLookRight() {
+		Image checker(16, 16);
+		GenerateProceduralTexture(MakeDesc(ProceduralPattern::Checker), checker.target, nullptr);
+		CHECK(checker.Pixel(0, 0) == 0xFF102030 && checker.Pixel(3, 3) == 0xFF102030);
+		CHECK(checker.Pixel(4, 0) == 0x80F0E0D0 && checker.Pixel(0, 4) == 0x80F0E0D0);
+		CHECK(checker.Pixel(4, 4) == 0xFF102030 && checker.Pixel(15, 11) == 0x80F0E0D0);
+
+		Image gradient(64, 64);
+		GenerateProceduralTexture(MakeDesc(ProceduralPattern::Gradient), gradient.target, nullptr);
+		CHECK(gradient.Pixel(0, 0) == 0xFF102030);
+		for (int channel{ 0 }; channel < 4; channel++)
+		{
+			const int corner = (gradient.Pixel(63, 63) >> (channel * 8)) & 0xFF;
+			CHECK(std::abs(corner - static_cast<int>((0x80F0E0D0u >> (channel * 8)) & 0xFF)) <= 8);
+		}
+
+		// Same seed, same noise. Another seed, other noise.
+		ProceduralTextureDesc desc = MakeDesc(ProceduralPattern::Noise);
+		Image first(32, 32);
+		Image second(32, 32);
+		GenerateProceduralTexture(desc, first.target, nullptr);
+		GenerateProceduralTexture(desc, second.target, nullptr);
+		CHECK(first.pixels == second.pixels);
+		desc.seed = 8;
+		GenerateProceduralTexture(desc, second.target, nullptr);
+		CHECK(first.pixels != second.pixels);
+	}
+
+	// The loop the sample filled its texture with before, 8x8 black and white squares
+	void CheckerMatchesTheOldTexture() {
+		const uint32_t size = 256;
+		const uint32_t rowPitch = size * 4;
+		const uint32_t cellPitch = rowPitch >> 3;
+		const uint32_t cellHeight = size >> 3;
+		std::vector<uint8_t> old(rowPitch * size);
+		for (uint32_t n{ 0 }; n < old.size(); n += 4)
+		{
+			const uint32_t i = (n % rowPitch) / cellPitch;
+			const uint32_t j = (n / rowPitch) / cellHeight;
+			const uint8_t value = i % 2 == j % 2 ? 0x00 : 0xFF;
+			old[n] = old[n + 1] = old[n + 2] = value;
+			old[n + 3] = 0xFF;
+		}
+
+		std::vector<uint8_t> pixels(old.size());
+		ProceduralTextureDesc desc;
+		desc.cellShift = 5;
+		ProceduralTextureTarget target;
+		target.data = pixels.data();
+		target.rowPitch = rowPitch;
+		target.width = size;
+		target.height = size;
+		GenerateProceduralTexture(desc, target, nullptr);
+		CHECK(pixels == old);
+	}
+
+	void RowRangesAddUpToTheWhole() {
+		for (ProceduralPattern pattern : Patterns)
+		{
+			const ProceduralTextureDesc desc = MakeDesc(pattern);
+			Image whole(45, 77);
+			GenerateProceduralTexture(desc, whole.target, nullptr);
+			Image pieces(45, 77);
+			GenerateProceduralRows(desc, pieces.target, 40, 37);
+			GenerateProceduralRows(desc, pieces.target, 0, 1);
+			GenerateProceduralRows(desc, pieces.target, 1, 39);
+			CHECK(pieces.pixels == whole.pixels);
+		}
+	}
+}
+
+int main() {
+	RUN_TEST(LevelsMatchScalar);
+	RUN_TEST(PatternsLookRight);
+	RUN_TEST(CheckerMatchesTheOldTexture);
+	RUN_TEST(RowRangesAddUpToTheWhole);
+	return TestResult();
+}
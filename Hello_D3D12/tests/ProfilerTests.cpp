@@ -0,0 +1,165 @@
+#include "Core/JobSystem.h"
+#include "Core/Profiler.h"
+#include "Graphics/GpuProfiler.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	// Every read is a microsecond after the last, zones get exact and predictable times
+	std::atomic<int64_t> g_fakeNow(0);
+	int64_t FakeClock() {
+		return g_fakeNow.fetch_add(1000) + 1000;
+	}
+
+	size_t CountOccurrences(const std::string& text, const std::string& what) {
+		size_t count = 0;
+		for (size_t position = text.find(what); position != std::string::npos; position = text.find(what, position + 1))
+		{
+			count++;
+		}
+		return count;
+	}
+
+	const ProfileEvent* FindEvent(const ProfileTrack* track, const char* name) {
+		for (uint32_t i{ 0 }; i < track->GetCount(); i++)
+		{
+			if (std::string(track->GetEvent(i).name) == name)
+			{
+				return &track->GetEvent(i);
+			}
+		}
+		return nullptr;
+	}
+
+	void ScopesRecordOnlyWhileCapturing() {
+		Profiler& profiler = Profiler::Get();
+		profiler.SetClock(&FakeClock);
+		{
+			PROFILE_SCOPE("Before");
+		}
+
+		profiler.BeginCapture();
+		{
+			PROFILE_SCOPE("Outer");
+			{
+				PROFILE_SCOPE("Inner");
+			}
+		}
+		profiler.EndCapture();
+		{
+			PROFILE_SCOPE("After");
+		}
+
+		const ProfileTrack* track = profiler.GetThreadTrack();
+		CHECK(track->GetCount() == 2);
+		const ProfileEvent* outer = FindEvent(track, "Outer");
+		const ProfileEvent* inner = FindEvent(track, "Inner");
+		CHECK(outer && inner);
+		if (outer && inner)
+		{
+			// Nested by time, inner closes first
+			CHECK(outer->start < inner->start && inner->end < outer->end);
+			CHECK(inner->end - inner->start == 1000);
+		}
+
+		// A new capture starts empty
+		profiler.BeginCapture();
+		profiler.EndCapture();
+		CHECK(profiler.GetThreadTrack()->GetCount() == 0);
+		profiler.SetClock(&Profiler::SteadyClockNow);
+	}
+
+	void EveryThreadGetsItsOwnTrack() {
+		Profiler& profiler = Profiler::Get();
+		JobSystem jobSystem;
+		jobSystem.Initialize(3);
+
+		profiler.BeginCapture();
+		profiler.SetThreadName("Main \"thread\"");
+		JobCounter counter;
+		jobSystem.ParallelFor(1000, 1, [](uint32_t, uint32_t) { PROFILE_SCOPE("Job"); }, &counter);
+		jobSystem.Wait(counter);
+		profiler.EndCapture();
+		jobSystem.Shutdown();
+
+		std::ostringstream trace;
+		profiler.WriteChromeTrace(trace);
+		const std::string text = trace.str();
+		CHECK(CountOccurrences(text, "\"name\":\"Job\"") == 1000);
+		CHECK(text.find("Main \\\"thread\\\"") != std::string::npos);
+		CHECK(text.find("{\"traceEvents\":[") == 0);
+		CHECK(text.find("],\"displayTimeUnit\":\"ms\"}") != std::string::npos);
+	}
+
+	void FullTrackDropsAndCounts() {
+		ProfileTrack track("Small", 0, 2);
+		track.Add("A", 0, 1);
+		track.Add("B", 1, 2);
+		track.Add("C", 2, 3);
+		CHECK(track.GetCount() == 2);
+		CHECK(track.GetDropped() == 1);
+		CHECK(std::string(track.GetEvent(1).name) == "B");
+	}
+
+	void GpuZonesLandOnTheCpuTimeline() {
+		Profiler profiler;
+		GpuProfiler gpu;
+		gpu.Initialize(&profiler, "GPU");
+
+		// Nothing is queried outside a capture
+		gpu.BeginFrame(0);
+		CHECK(gpu.AddZone("Skipped") == GpuProfiler::InvalidZone);
+		CHECK(gpu.GetFrameQueryCount(0) == 0);
+
+		profiler.BeginCapture();
+		gpu.BeginFrame(1);
+		CHECK(gpu.AddZone("Clear") == 0);
+		CHECK(gpu.AddZone("Scene") == 1);
+		CHECK(gpu.AddZone("Lost") == 2);
+		CHECK(gpu.GetFrameQueryCount(1) == 6);
+		CHECK(GpuProfiler::GetBeginQuery(1) == 2 && GpuProfiler::GetEndQuery(1) == 3);
+
+		// A 1 MHz GPU clock that read 1000000 when the CPU clock read 5s. The last zone's queries never ran.
+		const uint64_t timestamps[6] = { 1000000, 1001000, 1001000, 1005000, 0, 0 };
+		GpuClockCalibration calibration;
+		calibration.gpuTimestamp = 1000000;
+		calibration.gpuFrequency = 1000000;
+		calibration.cpuTime = 5000000000LL;
+		gpu.ResolveFrame(1, timestamps, calibration);
+		CHECK(gpu.GetFrameQueryCount(1) == 0);
+
+		std::ostringstream trace;
+		profiler.EndCapture();
+		profiler.WriteChromeTrace(trace);
+		const std::string text = trace.str();
+		CHECK(text.find("\"name\":\"Clear\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":0.000,\"dur\":1000.000") != std::string::npos);
+		CHECK(text.find("\"name\":\"Scene\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":1000.000,\"dur\":4000.000") != std::string::npos);
+		CHECK(text.find("Lost") == std::string::npos);
+	}
+
+	void GpuFrameIsCapped() {
+		Profiler profiler;
+		GpuProfiler gpu;
+		gpu.Initialize(&profiler, "GPU");
+		profiler.BeginCapture();
+		gpu.BeginFrame(0);
+		for (uint32_t i{ 0 }; i < GpuProfiler::MaxZonesPerFrame; i++)
+		{
+			CHECK(gpu.AddZone("Zone") == i);
+		}
+		CHECK(gpu.AddZone("Zone") == GpuProfiler::InvalidZone);
+		profiler.EndCapture();
+	}
+}
+
+int main() {
+	RUN_TEST(ScopesRecordOnlyWhileCapturing);
+	RUN_TEST(EveryThreadGetsItsOwnTrack);
+	RUN_TEST(FullTrackDropsAndCounts);
+	RUN_TEST(GpuZonesLandOnTheCpuTimeline);
+	RUN_TEST(GpuFrameIsCapped);
+	return TestResult();
+}
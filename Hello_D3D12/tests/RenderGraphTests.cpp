@@ -0,0 +1,327 @@
+#include "Graphics/RenderGraph.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// The D3D12_RESOURCE_STATES values
+	const uint32_t Present = 0;
+	const uint32_t RenderTarget = 0x4;
+	const uint32_t UnorderedAccess = 0x8;
+	const uint32_t DepthWrite = 0x10;
+	const uint32_t PixelShaderResource = 0x80;
+	const uint32_t CopySource = 0x800;
+	const uint32_t ReadOnly = 0x40 | PixelShaderResource | CopySource;
+
+	const uint64_t KB = 1024;
+	const uint64_t MB = 1024 * KB;
+	const uint32_t All = ResourceStateTracker::AllSubresources;
+
+	RenderGraphResourceDesc Desc(uint64_t size, uint64_t alignment = 64 * KB) {
+		RenderGraphResourceDesc desc;
+		desc.size = size;
+		desc.alignment = alignment;
+		return desc;
+	}
+
+	bool CompiledPassesAre(const RenderGraph& graph, std::initializer_list<uint32_t> expected) {
+		return graph.GetCompiledPasses() == std::vector<uint32_t>(expected);
+	}
+
+	bool SameTransition(const ResourceTransition& got, const ResourceTransition& want) {
+		return got.resource == want.resource && got.subresource == want.subresource && got.stateBefore == want.stateBefore &&
+			got.stateAfter == want.stateAfter && got.type == want.type;
+	}
+
+	bool TransitionsAre(const std::vector<ResourceTransition>& transitions, std::initializer_list<ResourceTransition> expected) {
+		if (transitions.size() != expected.size())
+		{
+			printf("  %zu transitions, expected %zu\n", transitions.size(), expected.size());
+			return false;
+		}
+		size_t i = 0;
+		for (const ResourceTransition& want : expected)
+		{
+			if (!SameTransition(transitions[i++], want))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Registers every graph resource with the tracker, transients in the state their first pass wants them in
+	std::vector<uint32_t> RegisterAll(const RenderGraph& graph, ResourceStateTracker& tracker, uint32_t importedState) {
+		std::vector<uint32_t> handles(graph.GetResourceCount(), ResourceStateTracker::InvalidResource);
+		for (uint32_t resource{ 0 }; resource < graph.GetResourceCount(); resource++)
+		{
+			if (graph.IsImported(resource))
+			{
+				handles[resource] = tracker.RegisterResource(1, importedState);
+			}
+			else if (graph.IsTransientUsed(resource))
+			{
+				handles[resource] = tracker.RegisterResource(1, graph.GetFirstState(resource));
+			}
+		}
+		return handles;
+	}
+
+	// Passes nothing visible reads from go, so does everything only they needed. Side effects keep a pass.
+	void CullsUnusedPasses() {
+		RenderGraph graph;
+		const uint32_t backBuffer = graph.ImportResource("BackBuffer", Present);
+		const uint32_t shadow = graph.CreateTransient("Shadow", Desc(4 * MB));
+		const uint32_t debug = graph.CreateTransient("Debug", Desc(MB));
+		const uint32_t history = graph.ImportResource("History");
+
+		const uint32_t shadowPass = graph.AddPass("Shadow");
+		graph.Write(shadowPass, shadow, DepthWrite);
+		const uint32_t debugPass = graph.AddPass("DebugDraw");
+		graph.Write(debugPass, debug, RenderTarget);
+		const uint32_t overlayPass = graph.AddPass("DebugOverlay");
+		graph.Read(overlayPass, debug, PixelShaderResource);
+		graph.Write(overlayPass, history, RenderTarget);
+		const uint32_t mainPass = graph.AddPass("Main");
+		graph.Read(mainPass, shadow, PixelShaderResource);
+		graph.Write(mainPass, backBuffer, RenderTarget);
+		const uint32_t readbackPass = graph.AddPass("Readback");
+		graph.Read(readbackPass, shadow, CopySource);
+		graph.SetSideEffects(readbackPass);
+		graph.Compile();
+
+		CHECK(CompiledPassesAre(graph, { shadowPass, mainPass, readbackPass }));
+		CHECK(graph.IsPassCulled(debugPass) && graph.IsPassCulled(overlayPass) && !graph.IsPassCulled(shadowPass));
+		CHECK(graph.IsTransientUsed(shadow) && !graph.IsTransientUsed(debug));
+		CHECK(graph.GetStats().passCount == 5 && graph.GetStats().culledPassCount == 2);
+		CHECK(graph.GetStats().transientCount == 1);
+
+		// A Write overwrites, so the pass before it that wrote the same thing is dead. ReadWrite keeps it.
+		graph.Reset();
+		const uint32_t target = graph.ImportResource("BackBuffer", Present);
+		const uint32_t clear = graph.AddPass("Clear");
+		graph.Write(clear, target, RenderTarget);
+		const uint32_t fullscreen = graph.AddPass("Fullscreen");
+		graph.Write(fullscreen, target, RenderTarget);
+		const uint32_t ui = graph.AddPass("UI");
+		graph.ReadWrite(ui, target, RenderTarget);
+		graph.Compile();
+		CHECK(CompiledPassesAre(graph, { fullscreen, ui }));
+
+		// Passes declared out of order still get their accesses, and nothing is an output without a final state
+		graph.Reset();
+		const uint32_t scratch = graph.ImportResource("Scratch");
+		const uint32_t first = graph.AddPass("First");
+		const uint32_t second = graph.AddPass("Second");
+		graph.Read(second, scratch, PixelShaderResource);
+		graph.Write(first, scratch, UnorderedAccess);
+		graph.Compile();
+		CHECK(graph.GetCompiledPasses().empty());
+		graph.SetSideEffects(second);
+		graph.Compile();
+		CHECK(CompiledPassesAre(graph, { first, second }));
+	}
+
+	// A chain of three transients: the first and last never live at the same time so they share memory, the
+	// middle one overlaps both
+	void AliasesDisjointLifetimes() {
+		RenderGraph graph;
+		const uint32_t backBuffer = graph.ImportResource("BackBuffer", Present);
+		const uint32_t a = graph.CreateTransient("A", Desc(MB));
+		const uint32_t b = graph.CreateTransient("B", Desc(MB));
+		const uint32_t c = graph.CreateTransient("C", Desc(MB));
+
+		const uint32_t pass0 = graph.AddPass("WriteA");
+		graph.Write(pass0, a, RenderTarget);
+		const uint32_t pass1 = graph.AddPass("AToB");
+		graph.Read(pass1, a, PixelShaderResource);
+		graph.Write(pass1, b, RenderTarget);
+		const uint32_t pass2 = graph.AddPass("BToC");
+		graph.Read(pass2, b, PixelShaderResource);
+		graph.Write(pass2, c, RenderTarget);
+		const uint32_t pass3 = graph.AddPass("Present");
+		graph.Read(pass3, c, PixelShaderResource);
+		graph.Write(pass3, backBuffer, RenderTarget);
+		graph.Compile();
+
+		CHECK(graph.GetTransientOffset(a) == graph.GetTransientOffset(c));
+		CHECK(graph.GetTransientOffset(b) != graph.GetTransientOffset(a));
+		CHECK(graph.GetTransientHeapSize() == 2 * MB);
+		CHECK(graph.GetStats().transientUnaliasedSize == 3 * MB && graph.GetStats().transientHeapSize == 2 * MB);
+
+		// Each transient's first pass says who had the memory before it
+		const std::vector<RenderGraphAliasing>& first = graph.GetPassAliasing(0);
+		const std::vector<RenderGraphAliasing>& third = graph.GetPassAliasing(2);
+		CHECK(first.size() == 1 && first[0].before == RenderGraph::InvalidIndex && first[0].after == a);
+		CHECK(graph.GetPassAliasing(1).size() == 1 && graph.GetPassAliasing(1)[0].after == b);
+		CHECK(third.size() == 1 && third[0].before == a && third[0].after == c);
+		CHECK(graph.GetPassAliasing(3).empty());
+		CHECK(graph.GetStats().aliasingCount == 3);
+
+		// A bigger alignment than the gap allows goes past it
+		graph.Reset();
+		const uint32_t output = graph.ImportResource("BackBuffer", Present);
+		const uint32_t small = graph.CreateTransient("Small", Desc(64 * KB));
+		const uint32_t msaa = graph.CreateTransient("Msaa", Desc(64 * KB, 4 * MB));
+		const uint32_t pass = graph.AddPass("Both");
+		graph.Write(pass, small, RenderTarget);
+		graph.Write(pass, msaa, RenderTarget);
+		graph.Write(pass, output, RenderTarget);
+		graph.Compile();
+		CHECK(graph.GetTransientOffset(msaa) % (4 * MB) == 0);
+		CHECK(graph.GetTransientOffset(small) != graph.GetTransientOffset(msaa));
+		CHECK(graph.GetTransientHeapSize() == 4 * MB + 64 * KB);
+	}
+
+	// Random graphs: whatever is alive at the same time never shares a byte, every offset is aligned, and a
+	// transient is placed exactly when a surviving pass uses it
+	void AliasingNeverOverlapsLiveResources() {
+		std::mt19937 random(1234);
+		for (uint32_t round{ 0 }; round < 20; round++)
+		{
+			RenderGraph graph;
+			const uint32_t backBuffer = graph.ImportResource("BackBuffer", Present);
+			std::vector<uint32_t> transients;
+			std::vector<uint64_t> sizes;
+			std::vector<uint64_t> alignments;
+			std::vector<std::vector<uint32_t>> passTransients;
+			const uint32_t passCount = 20 + random() % 200;
+			for (uint32_t passIndex{ 0 }; passIndex < passCount; passIndex++)
+			{
+				const uint32_t pass = graph.AddPass("Pass");
+				passTransients.emplace_back();
+				for (uint32_t read{ 0 }; read < 2 && !transients.empty(); read++)
+				{
+					const size_t back = std::min<size_t>(transients.size(), 1 + random() % 12);
+					graph.Read(pass, transients[transients.size() - back], PixelShaderResource);
+					passTransients.back().push_back(transients[transients.size() - back]);
+				}
+				const uint64_t alignment = random() % 8 == 0 ? 4 * MB : 64 * KB;
+				sizes.push_back((1 + random() % 64) * 64 * KB);
+				alignments.push_back(alignment);
+				transients.push_back(graph.CreateTransient("Target", Desc(sizes.back(), alignment)));
+				graph.Write(pass, transients.back(), RenderTarget);
+				passTransients.back().push_back(transients.back());
+				if (random() % 3 == 0)
+				{
+					graph.ReadWrite(pass, backBuffer, RenderTarget);
+				}
+			}
+			graph.Compile();
+
+			// Lifetimes in compiled passes, worked out from what each surviving pass touched
+			std::vector<uint32_t> firstUse(graph.GetResourceCount(), RenderGraph::InvalidIndex);
+			std::vector<uint32_t> lastUse(graph.GetResourceCount(), 0);
+			const std::vector<uint32_t>& compiled = graph.GetCompiledPasses();
+			for (uint32_t compiledIndex{ 0 }; compiledIndex < compiled.size(); compiledIndex++)
+			{
+				for (const uint32_t resource : passTransients[compiled[compiledIndex]])
+				{
+					firstUse[resource] = std::min(firstUse[resource], compiledIndex);
+					lastUse[resource] = compiledIndex;
+				}
+			}
+
+			bool aligned = true;
+			bool disjoint = true;
+			bool usedMatches = true;
+			for (size_t i{ 0 }; i < transients.size(); i++)
+			{
+				const uint32_t a = transients[i];
+				usedMatches = usedMatches && graph.IsTransientUsed(a) == (firstUse[a] != RenderGraph::InvalidIndex);
+				if (firstUse[a] == RenderGraph::InvalidIndex)
+				{
+					continue;
+				}
+				const uint64_t offsetA = graph.GetTransientOffset(a);
+				aligned = aligned && offsetA % alignments[i] == 0;
+				for (size_t j{ i + 1 }; j < transients.size(); j++)
+				{
+					const uint32_t b = transients[j];
+					if (firstUse[b] == RenderGraph::InvalidIndex || lastUse[a] < firstUse[b] || lastUse[b] < firstUse[a])
+					{
+						continue;
+					}
+					const uint64_t offsetB = graph.GetTransientOffset(b);
+					disjoint = disjoint && (offsetA + sizes[i] <= offsetB || offsetB + sizes[j] <= offsetA);
+				}
+			}
+			CHECK(usedMatches);
+			CHECK(aligned);
+			CHECK(disjoint);
+		}
+	}
+
+	// Transitions land right before the pass that needs them, with a split begin as early as the resource is
+	// free when passes in between don't touch it. Outputs go to their final state after the last pass.
+	void PlacesBarriers() {
+		RenderGraph graph;
+		const uint32_t backBuffer = graph.ImportResource("BackBuffer", Present);
+		const uint32_t shadow = graph.CreateTransient("Shadow", Desc(4 * MB));
+		const uint32_t gBuffer = graph.CreateTransient("GBuffer", Desc(8 * MB));
+
+		const uint32_t shadowPass = graph.AddPass("Shadow");
+		graph.Write(shadowPass, shadow, DepthWrite);
+		const uint32_t gBufferPass = graph.AddPass("GBuffer");
+		graph.Write(gBufferPass, gBuffer, RenderTarget);
+		const uint32_t lightingPass = graph.AddPass("Lighting");
+		graph.Read(lightingPass, shadow, PixelShaderResource);
+		graph.Read(lightingPass, gBuffer, PixelShaderResource);
+		graph.Write(lightingPass, backBuffer, RenderTarget);
+		graph.Compile();
+		CHECK(graph.GetFirstState(shadow) == DepthWrite && graph.GetFirstState(backBuffer) == RenderTarget);
+
+		ResourceStateTracker tracker(ReadOnly);
+		const std::vector<uint32_t> handles = RegisterAll(graph, tracker, Present);
+		graph.PlanBarriers(tracker, handles);
+		const uint32_t shadowHandle = handles[shadow];
+
+		// Shadow is done after the first pass but not read until the third, so the transition starts early
+		CHECK(graph.GetPassTransitions(0).empty());
+		CHECK(TransitionsAre(graph.GetPassTransitions(1), { { shadowHandle, All, DepthWrite, PixelShaderResource, ResourceTransitionType::BeginOnly } }));
+		CHECK(TransitionsAre(graph.GetPassTransitions(2), {
+			{ shadowHandle, All, DepthWrite, PixelShaderResource, ResourceTransitionType::EndOnly },
+			{ handles[gBuffer], All, RenderTarget, PixelShaderResource, ResourceTransitionType::Full },
+			{ handles[backBuffer], All, Present, RenderTarget, ResourceTransitionType::Full } }));
+		CHECK(TransitionsAre(graph.GetFinalTransitions(), { { handles[backBuffer], All, RenderTarget, Present, ResourceTransitionType::Full } }));
+		CHECK(graph.GetStats().transitionCount == 5 && graph.GetStats().splitTransitionCount == 1);
+		CHECK(tracker.GetState(handles[backBuffer], All) == Present);
+	}
+
+	// One pass using a resource two ways gets one barrier to the combined state, later reads of part of it none
+	void CombinesAccessesWithinAPass() {
+		RenderGraph graph;
+		const uint32_t output = graph.ImportResource("Output", Present);
+		const uint32_t source = graph.ImportResource("Source");
+
+		const uint32_t copyPass = graph.AddPass("CopyAndSample");
+		graph.Read(copyPass, source, PixelShaderResource);
+		graph.Read(copyPass, source, CopySource);
+		graph.Write(copyPass, output, RenderTarget);
+		const uint32_t samplePass = graph.AddPass("SampleAgain");
+		graph.Read(samplePass, source, PixelShaderResource);
+		graph.ReadWrite(samplePass, output, RenderTarget);
+		graph.Compile();
+
+		ResourceStateTracker tracker(ReadOnly);
+		const std::vector<uint32_t> handles = RegisterAll(graph, tracker, Present);
+		graph.PlanBarriers(tracker, handles);
+		CHECK(TransitionsAre(graph.GetPassTransitions(0), {
+			{ handles[source], All, Present, PixelShaderResource | CopySource, ResourceTransitionType::Full },
+			{ handles[output], All, Present, RenderTarget, ResourceTransitionType::Full } }));
+		CHECK(graph.GetPassTransitions(1).empty());
+		CHECK(graph.GetFinalTransitions().size() == 1);
+	}
+}
+
+int main() {
+	RUN_TEST(CullsUnusedPasses);
+	RUN_TEST(AliasesDisjointLifetimes);
+	RUN_TEST(AliasingNeverOverlapsLiveResources);
+	RUN_TEST(PlacesBarriers);
+	RUN_TEST(CombinesAccessesWithinAPass);
+	return TestResult();
+}
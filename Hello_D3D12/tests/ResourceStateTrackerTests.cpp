@@ -0,0 +1,232 @@
+#include "Graphics/ResourceStateTracker.h"
+#include "TestHarness.h"
+#include <initializer_list>
+#include <vector>
+
+namespace
+{
+	// The D3D12_RESOURCE_STATES values, so the streams read like the real barriers
+	const uint32_t Common = 0;
+	const uint32_t RenderTarget = 0x4;
+	const uint32_t UnorderedAccess = 0x8;
+	const uint32_t NonPixelShaderResource = 0x40;
+	const uint32_t PixelShaderResource = 0x80;
+	const uint32_t CopyDest = 0x400;
+	const uint32_t CopySource = 0x800;
+	const uint32_t ReadOnly = NonPixelShaderResource | PixelShaderResource | CopySource;
+
+	const uint32_t All = ResourceStateTracker::AllSubresources;
+	const ResourceTransitionType Full = ResourceTransitionType::Full;
+	const ResourceTransitionType BeginOnly = ResourceTransitionType::BeginOnly;
+	const ResourceTransitionType EndOnly = ResourceTransitionType::EndOnly;
+
+	// Flushes and compares the batch against the expected stream, in order
+	bool Emits(ResourceStateTracker& tracker, std::initializer_list<ResourceTransition> expected) {
+		std::vector<ResourceTransition> transitions;
+		tracker.Flush(transitions);
+		if (transitions.size() != expected.size())
+		{
+			printf("  %zu transitions, expected %zu\n", transitions.size(), expected.size());
+			return false;
+		}
+
+		size_t i = 0;
+		for (const ResourceTransition& want : expected)
+		{
+			const ResourceTransition& got = transitions[i++];
+			if (got.resource != want.resource || got.subresource != want.subresource || got.stateBefore != want.stateBefore ||
+				got.stateAfter != want.stateAfter || got.type != want.type)
+			{
+				printf("  #%zu: %u/%u 0x%x -> 0x%x (%d)\n", i - 1, got.resource, got.subresource, got.stateBefore,
+					got.stateAfter, static_cast<int>(got.type));
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Whole resource requests are one barrier each, a request for the current state none
+	void WholeResourceTransitions() {
+		ResourceStateTracker tracker(ReadOnly);
+		const uint32_t texture = tracker.RegisterResource(8, CopyDest);
+		const uint32_t target = tracker.RegisterResource(1, Common);
+
+		tracker.RequireState(texture, All, PixelShaderResource);
+		tracker.RequireState(target, All, RenderTarget);
+		tracker.RequireState(target, 0, RenderTarget);
+		CHECK(Emits(tracker, { { texture, All, CopyDest, PixelShaderResource, Full }, { target, All, Common, RenderTarget, Full } }));
+		CHECK(tracker.GetState(texture, All) == PixelShaderResource && tracker.GetState(target, 0) == RenderTarget);
+
+		tracker.RequireState(texture, All, PixelShaderResource);
+		CHECK(!tracker.HasPendingTransitions());
+		CHECK(Emits(tracker, {}));
+
+		const ResourceStateTrackerStats& stats = tracker.GetStats();
+		CHECK(stats.requests == 4 && stats.skipped == 2 && stats.transitions == 2 && stats.flushes == 1);
+	}
+
+	// A -> B -> C within one batch is A -> C, A -> B -> A is nothing, other resources in between don't stop it.
+	// A flush in between does, the GPU saw B by then.
+	void CollapsesWithinBatch() {
+		ResourceStateTracker tracker(ReadOnly);
+		const uint32_t a = tracker.RegisterResource(1, Common);
+		const uint32_t b = tracker.RegisterResource(1, Common);
+
+		tracker.RequireState(a, All, CopyDest);
+		tracker.RequireState(b, All, RenderTarget);
+		tracker.RequireState(a, All, UnorderedAccess);
+		tracker.RequireState(a, All, PixelShaderResource);
+		CHECK(Emits(tracker, { { a, All, Common, PixelShaderResource, Full }, { b, All, Common, RenderTarget, Full } }));
+
+		tracker.RequireState(b, All, PixelShaderResource);
+		tracker.RequireState(b, All, RenderTarget);
+		CHECK(Emits(tracker, {}));
+		CHECK(tracker.GetState(b, All) == RenderTarget);
+
+		tracker.RequireState(a, All, CopySource);
+		CHECK(Emits(tracker, { { a, All, PixelShaderResource, CopySource, Full } }));
+		tracker.RequireState(a, All, RenderTarget);
+		CHECK(Emits(tracker, { { a, All, CopySource, RenderTarget, Full } }));
+
+		CHECK(tracker.GetStats().collapsed == 3);
+	}
+
+	// One mip diverging gets its own barrier, a whole resource request after that only touches the mips that
+	// aren't there yet, and once they agree again it's back to one barrier
+	void SubresourcesDivergeAndRejoin() {
+		ResourceStateTracker tracker(ReadOnly);
+		const uint32_t texture = tracker.RegisterResource(4, PixelShaderResource);
+
+		tracker.RequireState(texture, 2, UnorderedAccess);
+		CHECK(Emits(tracker, { { texture, 2, PixelShaderResource, UnorderedAccess, Full } }));
+		CHECK(tracker.GetState(texture, 1) == PixelShaderResource && tracker.GetState(texture, 2) == UnorderedAccess);
+
+		tracker.RequireState(texture, All, UnorderedAccess);
+		CHECK(Emits(tracker, {
+			{ texture, 0, PixelShaderResource, UnorderedAccess, Full },
+			{ texture, 1, PixelShaderResource, UnorderedAccess, Full },
+			{ texture, 3, PixelShaderResource, UnorderedAccess, Full } }));
+
+		tracker.RequireState(texture, All, PixelShaderResource);
+		CHECK(Emits(tracker, { { texture, All, UnorderedAccess, PixelShaderResource, Full } }));
+
+		// Diverging and coming back within one batch collapses per subresource
+		tracker.RequireState(texture, 1, RenderTarget);
+		tracker.RequireState(texture, All, PixelShaderResource);
+		CHECK(Emits(tracker, {}));
+		CHECK(tracker.GetState(texture, All) == PixelShaderResource);
+	}
+
+	// A begin in one batch and the end in a later one are the two halves with the same states. The end comes
+	// from whatever request touches the resource next.
+	void SplitBarriersAcrossBatches() {
+		ResourceStateTracker tracker(ReadOnly);
+		const uint32_t shadow = tracker.RegisterResource(1, RenderTarget);
+		const uint32_t other = tracker.RegisterResource(1, Common);
+
+		tracker.BeginTransition(shadow, All, PixelShaderResource);
+		CHECK(Emits(tracker, { { shadow, All, RenderTarget, PixelShaderResource, BeginOnly } }));
+		CHECK(tracker.GetState(shadow, All) == PixelShaderResource);
+
+		tracker.RequireState(other, All, CopyDest);
+		CHECK(Emits(tracker, { { other, All, Common, CopyDest, Full } }));
+
+		tracker.RequireState(shadow, All, PixelShaderResource);
+		CHECK(Emits(tracker, { { shadow, All, RenderTarget, PixelShaderResource, EndOnly } }));
+		tracker.RequireState(shadow, All, PixelShaderResource);
+		CHECK(Emits(tracker, {}));
+
+		// Ended by a request for some other state, the end still comes first
+		tracker.BeginTransition(shadow, All, RenderTarget);
+		CHECK(Emits(tracker, { { shadow, All, PixelShaderResource, RenderTarget, BeginOnly } }));
+		tracker.RequireState(shadow, All, CopySource);
+		CHECK(Emits(tracker, {
+			{ shadow, All, PixelShaderResource, RenderTarget, EndOnly },
+			{ shadow, All, RenderTarget, CopySource, Full } }));
+	}
+
+	// Both halves in one batch have nothing to overlap with, that's just a plain barrier
+	void SplitWithinBatchIsFull() {
+		ResourceStateTracker tracker(ReadOnly);
+		const uint32_t texture = tracker.RegisterResource(2, RenderTarget);
+
+		tracker.BeginTransition(texture, All, PixelShaderResource);
+		tracker.RequireState(texture, All, PixelShaderResource);
+		CHECK(Emits(tracker, { { texture, All, RenderTarget, PixelShaderResource, Full } }));
+
+		// Per subresource, ending one mip leaves the other's split alone
+		tracker.BeginTransition(texture, 0, CopySource);
+		tracker.BeginTransition(texture, 1, CopySource);
+		CHECK(Emits(tracker, {
+			{ texture, 0, PixelShaderResource, CopySource, BeginOnly },
+			{ texture, 1, PixelShaderResource, CopySource, BeginOnly } }));
+		tracker.RequireState(texture, 1, CopySource);
+		CHECK(Emits(tracker, { { texture, 1, PixelShaderResource, CopySource, EndOnly } }));
+		tracker.RequireState(texture, All, CopySource);
+		CHECK(Emits(tracker, { { texture, 0, PixelShaderResource, CopySource, EndOnly } }));
+	}
+
+	// A read of part of a combined read state needs no barrier, a write or a read the state doesn't include does
+	void ReadStatesCombine() {
+		ResourceStateTracker tracker(ReadOnly);
+		const uint32_t buffer = tracker.RegisterResource(1, Common);
+		const uint32_t bothShaders = NonPixelShaderResource | PixelShaderResource;
+
+		tracker.RequireState(buffer, All, bothShaders);
+		CHECK(Emits(tracker, { { buffer, All, Common, bothShaders, Full } }));
+
+		tracker.RequireState(buffer, All, PixelShaderResource);
+		tracker.RequireState(buffer, All, NonPixelShaderResource);
+		CHECK(Emits(tracker, {}));
+		CHECK(tracker.GetState(buffer, All) == bothShaders);
+
+		tracker.RequireState(buffer, All, CopySource);
+		CHECK(Emits(tracker, { { buffer, All, bothShaders, CopySource, Full } }));
+
+		// Common is not a read state the others are part of
+		tracker.RequireState(buffer, All, Common);
+		CHECK(Emits(tracker, { { buffer, All, CopySource, Common, Full } }));
+
+		// Without read only bits every state has to match exactly
+		ResourceStateTracker strict;
+		const uint32_t texture = strict.RegisterResource(1, bothShaders);
+		strict.RequireState(texture, All, PixelShaderResource);
+		CHECK(Emits(strict, { { texture, All, bothShaders, PixelShaderResource, Full } }));
+
+		// A write bit in the current state means no subset of it counts either
+		ResourceStateTracker writes(ReadOnly | UnorderedAccess);
+		const uint32_t target = writes.RegisterResource(1, RenderTarget | PixelShaderResource);
+		writes.RequireState(target, All, PixelShaderResource);
+		CHECK(Emits(writes, { { target, All, RenderTarget | PixelShaderResource, PixelShaderResource, Full } }));
+	}
+
+	// Unregistering drops its queued transitions and the handle gets reused with a fresh state
+	void UnregisterDropsPending() {
+		ResourceStateTracker tracker(ReadOnly);
+		const uint32_t a = tracker.RegisterResource(1, Common);
+		const uint32_t b = tracker.RegisterResource(4, Common);
+
+		tracker.RequireState(a, All, CopyDest);
+		tracker.RequireState(b, 1, CopyDest);
+		tracker.BeginTransition(b, 2, PixelShaderResource);
+		tracker.UnregisterResource(b);
+		CHECK(Emits(tracker, { { a, All, Common, CopyDest, Full } }));
+
+		const uint32_t c = tracker.RegisterResource(2, RenderTarget);
+		CHECK(c == b);
+		CHECK(tracker.GetState(c, All) == RenderTarget);
+		tracker.RequireState(c, All, PixelShaderResource);
+		CHECK(Emits(tracker, { { c, All, RenderTarget, PixelShaderResource, Full } }));
+	}
+}
+
+int main() {
+	RUN_TEST(WholeResourceTransitions);
+	RUN_TEST(CollapsesWithinBatch);
+	RUN_TEST(SubresourcesDivergeAndRejoin);
+	RUN_TEST(SplitBarriersAcrossBatches);
+	RUN_TEST(SplitWithinBatchIsFull);
+	RUN_TEST(ReadStatesCombine);
+	RUN_TEST(UnregisterDropsPending);
+	return TestResult();
+}
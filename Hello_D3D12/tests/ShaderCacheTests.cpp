@@ -0,0 +1,283 @@
+#include "Graphics/ShaderCache.h"
+#include "TestHarness.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char* const ShaderFile = "ShaderCacheTests.hlsl";
+	const char* const IncludeFile = "ShaderCacheTests_common.hlsli";
+	const char* const NestedFile = "ShaderCacheTests_nested.hlsli";
+	const char* const CacheFile = "ShaderCacheTests.cache";
+
+	void WriteText(const char* path, const std::string& text) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+	}
+
+	std::string ReadBytes(const char* path) {
+		std::ifstream file(path, std::ios::binary);
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		return contents.str();
+	}
+
+	// Stands in for D3DCompile: the "bytecode" is the entry point, target and source it was given, so a wrong
+	// shader coming back out of the cache shows. A source containing "error" fails.
+	struct StubCompiler
+	{
+		uint32_t calls = 0;
+
+		ShaderCache::CompileFunction Function() {
+			return [this](const ShaderCompileRequest& request, std::vector<uint8_t>& bytecode, std::string& errors) {
+				calls++;
+				std::ifstream file(request.path, std::ios::binary);
+				std::ostringstream contents;
+				contents << file.rdbuf();
+				if (contents.str().find("error") != std::string::npos)
+				{
+					errors = request.path + "(1): error X3000: syntax error";
+					return false;
+				}
+				const std::string text = request.entryPoint + "|" + request.target + "|" + contents.str();
+				bytecode.assign(text.begin(), text.end());
+				return true;
+			};
+		}
+	};
+
+	ShaderCompileRequest Request(const char* entryPoint = "VSMain", const char* target = "vs_5_0", uint32_t flags = 0) {
+		ShaderCompileRequest request;
+		request.path = ShaderFile;
+		request.entryPoint = entryPoint;
+		request.target = target;
+		request.flags = flags;
+		return request;
+	}
+
+	std::string AsString(const ShaderBytecode& bytecode) {
+		return std::string(reinterpret_cast<const char*>(bytecode.data), bytecode.size);
+	}
+
+	void WriteShaders() {
+		WriteText(ShaderFile, "#include \"ShaderCacheTests_common.hlsli\"\nfloat4 VSMain() : SV_Position { return Offset(); }\n");
+		WriteText(IncludeFile, "#include \"ShaderCacheTests_nested.hlsli\"\nfloat4 Offset() { return Base; }\n");
+		WriteText(NestedFile, "static const float4 Base = 1;\n");
+		remove(CacheFile);
+	}
+
+	void MissThenHit() {
+		WriteShaders();
+		StubCompiler compiler;
+		ShaderCache cache;
+		cache.Open(CacheFile);
+
+		ShaderBytecode first, second;
+		std::string errors;
+		CHECK(cache.GetShader(Request(), compiler.Function(), first, errors));
+		CHECK(compiler.calls == 1 && cache.GetMisses() == 1 && cache.GetHits() == 0);
+		CHECK(cache.GetShader(Request(), compiler.Function(), second, errors));
+		CHECK(compiler.calls == 1 && cache.GetHits() == 1);
+		CHECK(second.data == first.data && AsString(second).compare(0, 14, "VSMain|vs_5_0|") == 0);
+
+		// Same file, different entry point, target or flags are different shaders
+		ShaderBytecode other;
+		CHECK(cache.GetShader(Request("PSMain", "ps_5_0"), compiler.Function(), other, errors) && compiler.calls == 2);
+		CHECK(AsString(other).compare(0, 14, "PSMain|ps_5_0|") == 0);
+		CHECK(cache.GetShader(Request("VSMain", "vs_5_1"), compiler.Function(), other, errors) && compiler.calls == 3);
+		CHECK(cache.GetShader(Request("VSMain", "vs_5_0", 1), compiler.Function(), other, errors) && compiler.calls == 4);
+		CHECK(cache.GetShader(Request(), compiler.Function(), other, errors) && compiler.calls == 4);
+		CHECK(cache.Close());
+	}
+
+	// Closing writes the cache, the next run gets everything from the mapped file without compiling
+	void PersistsAcrossRuns() {
+		WriteShaders();
+		StubCompiler compiler;
+		std::string compiled;
+		{
+			ShaderCache cache;
+			cache.Open(CacheFile);
+			ShaderBytecode bytecode;
+			std::string errors;
+			CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors));
+			CHECK(cache.GetShader(Request("PSMain", "ps_5_0"), compiler.Function(), bytecode, errors));
+			compiled = AsString(bytecode);
+			CHECK(cache.Close());
+		}
+
+		ShaderCache cache;
+		cache.Open(CacheFile);
+		ShaderBytecode bytecode;
+		std::string errors;
+		CHECK(cache.GetShader(Request("PSMain", "ps_5_0"), compiler.Function(), bytecode, errors) && AsString(bytecode) == compiled);
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors));
+		CHECK(compiler.calls == 2 && cache.GetHits() == 2 && cache.GetMisses() == 0);
+		// Nothing new, the file is left as it is
+		const std::string before = ReadBytes(CacheFile);
+		CHECK(cache.Close() && ReadBytes(CacheFile) == before);
+	}
+
+	// Any edit to the source or a file it pulls in, however deep, is a miss
+	void EditsInvalidate() {
+		WriteShaders();
+		StubCompiler compiler;
+		ShaderCache cache;
+		cache.Open(CacheFile);
+		ShaderBytecode bytecode;
+		std::string errors;
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors));
+
+		WriteText(NestedFile, "static const float4 Base = 2;\n");
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == 2);
+		WriteText(IncludeFile, "#include \"ShaderCacheTests_nested.hlsli\"\nfloat4 Offset() { return Base * 2; }\n");
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == 3);
+		WriteText(ShaderFile, "#include \"ShaderCacheTests_common.hlsli\"\nfloat4 VSMain() : SV_Position { return -Offset(); }\n");
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == 4);
+		CHECK(AsString(bytecode).find("-Offset()") != std::string::npos);
+
+		// Putting a file back the way it was finds the old entry again
+		WriteText(NestedFile, "static const float4 Base = 1;\n");
+		WriteText(IncludeFile, "#include \"ShaderCacheTests_nested.hlsli\"\nfloat4 Offset() { return Base; }\n");
+		WriteText(ShaderFile, "#include \"ShaderCacheTests_common.hlsli\"\nfloat4 VSMain() : SV_Position { return Offset(); }\n");
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == 4);
+		cache.Close();
+	}
+
+	// Only real includes are dependencies, a commented out one can change freely
+	void CommentedIncludesAreIgnored() {
+		WriteShaders();
+		WriteText(ShaderFile, "// #include \"ShaderCacheTests_common.hlsli\"\n/* #include \"ShaderCacheTests_nested.hlsli\" */\nfloat4 VSMain() : SV_Position { return 0; }\n");
+		std::string key, otherKey;
+		uint64_t hash, otherHash;
+		CHECK(ShaderCache::ComputeKey(Request(), key, hash));
+		WriteText(IncludeFile, "float4 Offset() { return 3; }\n");
+		WriteText(NestedFile, "static const float4 Base = 3;\n");
+		CHECK(ShaderCache::ComputeKey(Request(), otherKey, otherHash) && otherKey == key && otherHash == hash);
+
+		WriteShaders();
+		CHECK(ShaderCache::ComputeKey(Request(), key, hash) && key.find("static const float4 Base = 1;") != std::string::npos);
+	}
+
+	// A failed compile isn't cached, the next request tries again. A missing source fails without compiling.
+	void FailuresAreNotCached() {
+		WriteShaders();
+		WriteText(ShaderFile, "float4 VSMain() : SV_Position { error }\n");
+		StubCompiler compiler;
+		ShaderCache cache;
+		cache.Open(CacheFile);
+		ShaderBytecode bytecode;
+		std::string errors;
+		CHECK(!cache.GetShader(Request(), compiler.Function(), bytecode, errors) && errors.find("X3000") != std::string::npos);
+		CHECK(!cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == 2);
+
+		ShaderCompileRequest missing = Request();
+		missing.path = "ShaderCacheTests_missing.hlsl";
+		CHECK(!cache.GetShader(missing, compiler.Function(), bytecode, errors) && compiler.calls == 2);
+		CHECK(errors.find("ShaderCacheTests_missing.hlsl") != std::string::npos);
+
+		// Nothing compiled, nothing written
+		CHECK(cache.Close());
+		FILE* file = fopen(CacheFile, "rb");
+		CHECK(file == nullptr);
+		if (file)
+		{
+			fclose(file);
+		}
+	}
+
+	// An entry whose hash matches but whose stored key doesn't is what a hash collision looks like. It has to
+	// be a miss that compiles, not the stored bytecode. Made here by changing the stored key in the file.
+	void StoredKeyIsCompared() {
+		WriteShaders();
+		StubCompiler compiler;
+		{
+			ShaderCache cache;
+			cache.Open(CacheFile);
+			ShaderBytecode bytecode;
+			std::string errors;
+			CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors));
+			cache.Close();
+		}
+
+		// The key holds the nested include's text ahead of the bytecode, which doesn't have it
+		std::string bytes = ReadBytes(CacheFile);
+		const size_t position = bytes.find("Base = 1;");
+		CHECK(position != std::string::npos && bytes.find("Base = 1;", position + 1) == std::string::npos);
+		bytes[position + 7] = '7';
+		WriteText(CacheFile, bytes);
+
+		ShaderCache cache;
+		cache.Open(CacheFile);
+		ShaderBytecode bytecode;
+		std::string errors;
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors));
+		CHECK(compiler.calls == 2 && cache.GetMisses() == 1 && cache.GetHits() == 0);
+		CHECK(AsString(bytecode).find("return Offset();") != std::string::npos);
+		// The recompiled entry replaces it
+		CHECK(cache.Close());
+		cache.Open(CacheFile);
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == 2);
+		cache.Close();
+	}
+
+	// Garbage, a truncated file or an older version all start empty instead of failing
+	void BadCacheFilesStartEmpty() {
+		WriteShaders();
+		StubCompiler compiler;
+		{
+			ShaderCache cache;
+			cache.Open(CacheFile);
+			ShaderBytecode bytecode;
+			std::string errors;
+			cache.GetShader(Request(), compiler.Function(), bytecode, errors);
+			cache.Close();
+		}
+		const std::string good = ReadBytes(CacheFile);
+
+		std::string oldVersion = good;
+		const uint32_t version = 1;
+		memcpy(&oldVersion[4], &version, sizeof(version));
+		const std::string bad[] = { "not a cache", good.substr(0, good.size() / 2), good.substr(0, 20), oldVersion };
+		for (const std::string& contents : bad)
+		{
+			WriteText(CacheFile, contents);
+			ShaderCache cache;
+			cache.Open(CacheFile);
+			ShaderBytecode bytecode;
+			std::string errors;
+			const uint32_t callsBefore = compiler.calls;
+			CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == callsBefore + 1);
+			CHECK(cache.GetMisses() == 1);
+			cache.Close();
+		}
+
+		// And the rewrite after that is good again
+		ShaderCache cache;
+		cache.Open(CacheFile);
+		ShaderBytecode bytecode;
+		std::string errors;
+		const uint32_t callsBefore = compiler.calls;
+		CHECK(cache.GetShader(Request(), compiler.Function(), bytecode, errors) && compiler.calls == callsBefore);
+		cache.Close();
+	}
+}
+
+int main() {
+	RUN_TEST(MissThenHit);
+	RUN_TEST(PersistsAcrossRuns);
+	RUN_TEST(EditsInvalidate);
+	RUN_TEST(CommentedIncludesAreIgnored);
+	RUN_TEST(FailuresAreNotCached);
+	RUN_TEST(StoredKeyIsCompared);
+	RUN_TEST(BadCacheFilesStartEmpty);
+	remove(ShaderFile);
+	remove(IncludeFile);
+	remove(NestedFile);
+	remove(CacheFile);
+	return TestResult();
+}
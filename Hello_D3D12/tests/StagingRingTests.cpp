@@ -0,0 +1,124 @@
+#include "Graphics/StagingRing.h"
+#include "TestHarness.h"
+#include <random>
+#include <vector>
+
+namespace
+{
+	void FillsWrapsAndRetires() {
+		StagingRing ring;
+		ring.Initialize(4096);
+		StagingAllocation allocation;
+		CHECK(ring.Allocate(1000, 512, allocation) && allocation.offset == 0 && allocation.size == 1000);
+		CHECK(ring.Allocate(1000, 512, allocation) && allocation.offset == 1024);
+		CHECK(!ring.Allocate(2100, 512, allocation));
+		CHECK(!ring.Allocate(0, 512, allocation) && !ring.Allocate(4097, 512, allocation));
+		CHECK(ring.HasUnsubmitted() && ring.GetOldestFenceValue() == 0);
+
+		ring.Submit(1);
+		CHECK(!ring.HasUnsubmitted() && ring.GetOldestFenceValue() == 1);
+		ring.Retire(0);
+		CHECK(ring.GetUsed() == 2024);
+		CHECK(!ring.Allocate(2100, 512, allocation));
+
+		CHECK(ring.Allocate(1000, 1, allocation) && allocation.offset == 2024);
+		ring.Submit(2);
+		ring.Retire(1);
+		CHECK(ring.GetUsed() == 1000 && ring.GetOldestFenceValue() == 2);
+
+		// Doesn't fit between 3072 and the end, the 1072 bytes after 3024 are skipped and go with the batch
+		CHECK(ring.Allocate(1100, 256, allocation) && allocation.offset == 0);
+		CHECK(ring.GetUsed() == 1000 + 1072 + 1100);
+		ring.Submit(3);
+		ring.Retire(2);
+		CHECK(ring.GetUsed() == 1072 + 1100 && ring.GetOldestFenceValue() == 3);
+		ring.Retire(3);
+		CHECK(ring.GetUsed() == 0 && ring.GetOldestFenceValue() == 0);
+
+		// Submitting nothing adds no batch
+		ring.Submit(4);
+		CHECK(ring.GetOldestFenceValue() == 0);
+	}
+
+	// Once everything is back the next allocation starts at zero, the whole capacity free again
+	void EmptyRingStartsOver() {
+		StagingRing ring;
+		ring.Initialize(4096);
+		StagingAllocation allocation;
+		CHECK(ring.Allocate(1000, 512, allocation));
+		CHECK(ring.Allocate(1000, 512, allocation));
+		ring.Submit(1);
+		ring.Retire(1);
+		CHECK(ring.GetUsed() == 0);
+		CHECK(ring.Allocate(2000, 512, allocation) && allocation.offset == 0);
+		CHECK(ring.Allocate(2000, 512, allocation) && allocation.offset == 2048);
+		ring.Submit(2);
+		ring.Retire(2);
+		CHECK(ring.Allocate(4096, 4096, allocation) && allocation.offset == 0);
+		CHECK(ring.GetUsed() == 4096);
+	}
+
+	// Live allocations tracked on the side, none may overlap another or run past the end
+	void RandomAllocationsNeverOverlap() {
+		struct Live
+		{
+			uint64_t offset;
+			uint64_t size;
+			uint64_t fenceValue;
+		};
+
+		const uint64_t capacity = 1 << 16;
+		StagingRing ring;
+		ring.Initialize(capacity);
+		std::mt19937 random(1);
+		std::vector<Live> live;
+		uint64_t fenceValue = 0;
+		uint64_t completed = 0;
+		uint32_t allocations = 0;
+		bool overlapped = false;
+		bool misplaced = false;
+		for (uint32_t i{ 0 }; i < 200000; i++)
+		{
+			const uint64_t size = 1 + random() % 9000;
+			const uint64_t alignment = 1ull << (random() % 10);
+			StagingAllocation allocation;
+			if (ring.Allocate(size, alignment, allocation))
+			{
+				allocations++;
+				misplaced = misplaced || allocation.offset % alignment != 0 || allocation.offset + size > capacity;
+				for (const Live& other : live)
+				{
+					overlapped = overlapped || (allocation.offset < other.offset + other.size && other.offset < allocation.offset + size);
+				}
+				live.push_back({ allocation.offset, size, fenceValue + 1 });
+			}
+			if (random() % 4 == 0)
+			{
+				ring.Submit(++fenceValue);
+			}
+			if (random() % 3 == 0 && completed < fenceValue)
+			{
+				ring.Retire(++completed);
+				std::vector<Live> remaining;
+				for (const Live& other : live)
+				{
+					if (other.fenceValue > completed)
+					{
+						remaining.push_back(other);
+					}
+				}
+				live.swap(remaining);
+			}
+		}
+		CHECK(!overlapped);
+		CHECK(!misplaced);
+		CHECK(allocations > 10000);
+	}
+}
+
+int main() {
+	RUN_TEST(FillsWrapsAndRetires);
+	RUN_TEST(EmptyRingStartsOver);
+	RUN_TEST(RandomAllocationsNeverOverlap);
+	return TestResult();
+}
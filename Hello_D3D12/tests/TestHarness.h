@@ -0,0 +1,36 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+// Just enough for console tests. CHECK reports a failure and carries on, RUN_TEST runs a test function, and main
+// returns TestResult() so ctest sees the failures.
+inline int& TestFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+inline void TestFailed(const char* file, int line, const char* expression) {
+	printf("%s(%d): CHECK failed: %s\n", file, line, expression);
+	TestFailures()++;
+}
+
+#define CHECK(condition) \
+	do { if (!(condition)) { TestFailed(__FILE__, __LINE__, #condition); } } while (false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { if (!(std::fabs(static_cast<double>(a) - static_cast<double>(b)) <= (tolerance))) { \
+		printf("  %g vs %g\n", static_cast<double>(a), static_cast<double>(b)); \
+		TestFailed(__FILE__, __LINE__, #a " ~= " #b); } } while (false)
+
+#define RUN_TEST(test) \
+	do { const int failuresBefore = TestFailures(); test(); \
+		printf("%s %s\n", TestFailures() == failuresBefore ? "[ ok ]" : "[FAIL]", #test); } while (false)
+
+inline int TestResult() {
+	if (TestFailures() != 0)
+	{
+		printf("%d check(s) failed\n", TestFailures());
+		return 1;
+	}
+	return 0;
+}
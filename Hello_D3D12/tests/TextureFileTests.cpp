@@ -0,0 +1,407 @@
+#include "Graphics/TextureFile.h"
+#include "TestHarness.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const char* const TestFile = "TextureFileTests.dds";
+
+	struct Format
+	{
+		uint32_t dxgi;
+		uint32_t vk;
+		uint32_t blockSize;
+		uint32_t bytesPerBlock;
+	};
+
+	const Format Rgba8 = { 28, 37, 1, 4 };
+	const Format Rgba16F = { 10, 97, 1, 8 };
+	const Format Bc1 = { 71, 133, 4, 8 };
+	const Format Bc3 = { 77, 137, 4, 16 };
+	const Format Bc7 = { 98, 145, 4, 16 };
+
+	template<typename T>
+	void Append(std::vector<uint8_t>& bytes, T value) {
+		const size_t offset = bytes.size();
+		bytes.resize(offset + sizeof(T));
+		memcpy(&bytes[offset], &value, sizeof(T));
+	}
+
+	// Different for every slice, mip and byte, so a subresource read from the wrong place shows
+	uint8_t Pattern(uint32_t slice, uint32_t mip, uint64_t i) {
+		return static_cast<uint8_t>(slice * 31 + mip * 7 + i * 13 + (i >> 8));
+	}
+
+	uint64_t ImageSize(const Format& format, uint32_t width, uint32_t height, uint32_t mip) {
+		const uint32_t mipWidth = width >> mip > 0 ? width >> mip : 1;
+		const uint32_t mipHeight = height >> mip > 0 ? height >> mip : 1;
+		return static_cast<uint64_t>((mipWidth + format.blockSize - 1) / format.blockSize * format.bytesPerBlock) *
+			((mipHeight + format.blockSize - 1) / format.blockSize);
+	}
+
+	// Legacy files only know DXT1 and DXT5 here, and no arrays
+	std::vector<uint8_t> MakeDds(const Format& format, uint32_t width, uint32_t height, uint32_t mips, uint32_t arraySize,
+		bool cube, bool dx10) {
+		std::vector<uint8_t> bytes;
+		Append<uint32_t>(bytes, 0x20534444);
+		uint32_t header[31] = {};
+		header[0] = 124;
+		header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;
+		header[2] = height;
+		header[3] = width;
+		header[6] = mips;
+		header[18] = 32;
+		header[19] = 0x4;
+		header[20] = dx10 ? 0x30315844 : format.dxgi == 71 ? 0x31545844 : 0x35545844;
+		header[26] = 0x1000 | 0x400000 | 0x8;
+		header[27] = cube && !dx10 ? 0x200 | 0xFC00 : 0;
+		for (uint32_t value : header)
+		{
+			Append(bytes, value);
+		}
+		if (dx10)
+		{
+			Append<uint32_t>(bytes, format.dxgi);
+			Append<uint32_t>(bytes, 3);
+			Append<uint32_t>(bytes, cube ? 4 : 0);
+			Append<uint32_t>(bytes, arraySize);
+			Append<uint32_t>(bytes, 0);
+		}
+		const uint32_t slices = arraySize * (cube ? 6 : 1);
+		for (uint32_t slice{ 0 }; slice < slices; slice++)
+		{
+			for (uint32_t mip{ 0 }; mip < mips; mip++)
+			{
+				const uint64_t size = ImageSize(format, width, height, mip);
+				for (uint64_t i{ 0 }; i < size; i++)
+				{
+					bytes.push_back(Pattern(slice, mip, i));
+				}
+			}
+		}
+		return bytes;
+	}
+
+	// Levels stored smallest first and 16 byte aligned, like real files
+	std::vector<uint8_t> MakeKtx2(const Format& format, uint32_t width, uint32_t height, uint32_t mips, uint32_t layers, uint32_t faces) {
+		const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		std::vector<uint8_t> bytes(identifier, identifier + sizeof(identifier));
+		const uint32_t header[] = { format.vk, 1, width, height, 0, layers, faces, mips, 0, 0, 0, 0, 0 };
+		for (uint32_t value : header)
+		{
+			Append(bytes, value);
+		}
+		Append<uint64_t>(bytes, 0);
+		Append<uint64_t>(bytes, 0);
+
+		const size_t index = bytes.size();
+		bytes.resize(bytes.size() + 24 * mips);
+		const uint32_t slices = (layers > 0 ? layers : 1) * faces;
+		for (uint32_t mip{ mips }; mip-- > 0;)
+		{
+			while (bytes.size() % 16 != 0)
+			{
+				bytes.push_back(0);
+			}
+			const uint64_t offset = bytes.size();
+			const uint64_t size = ImageSize(format, width, height, mip);
+			for (uint32_t slice{ 0 }; slice < slices; slice++)
+			{
+				for (uint64_t i{ 0 }; i < size; i++)
+				{
+					bytes.push_back(Pattern(slice, mip, i));
+				}
+			}
+			const uint64_t length = size * slices;
+			memcpy(&bytes[index + 24 * mip], &offset, 8);
+			memcpy(&bytes[index + 24 * mip + 8], &length, 8);
+			memcpy(&bytes[index + 24 * mip + 16], &length, 8);
+		}
+		return bytes;
+	}
+
+	// Every subresource copied out to a 256 byte pitch, compared byte for byte and the padding left alone
+	bool Matches(const TextureFile& file, const Format& format, uint32_t width, uint32_t height, uint32_t mips, uint32_t slices) {
+		const TextureFileInfo& info = file.GetInfo();
+		if (info.format != format.dxgi || info.width != width || info.height != height || info.mipLevels != mips ||
+			info.arraySize != slices || file.GetSubresourceCount() != mips * slices)
+		{
+			return false;
+		}
+		std::vector<uint8_t> destination;
+		for (uint32_t slice{ 0 }; slice < slices; slice++)
+		{
+			for (uint32_t mip{ 0 }; mip < mips; mip++)
+			{
+				const uint32_t index = mip + slice * mips;
+				const TextureFileSubresource& subresource = file.GetSubresource(index);
+				if (static_cast<uint64_t>(subresource.rowSize) * subresource.rowCount != ImageSize(format, width, height, mip))
+				{
+					return false;
+				}
+				const uint64_t pitch = (subresource.rowSize + 255ull) & ~255ull;
+				destination.assign(static_cast<size_t>(pitch * subresource.rowCount), 0xCD);
+				file.CopySubresource(index, destination.data(), pitch);
+				uint64_t i = 0;
+				for (uint32_t row{ 0 }; row < subresource.rowCount; row++)
+				{
+					for (uint64_t x{ 0 }; x < pitch; x++)
+					{
+						const uint8_t expected = x < subresource.rowSize ? Pattern(slice, mip, i++) : 0xCD;
+						if (destination[static_cast<size_t>(row * pitch + x)] != expected)
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	struct Case
+	{
+		Format format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mips;
+		uint32_t arraySize;
+		bool cube;
+	};
+
+	const Case Cases[] = {
+		{ Rgba8, 256, 128, 9, 1, false },
+		{ Rgba8, 37, 19, 6, 1, false },
+		{ Bc1, 256, 256, 9, 1, false },
+		{ Bc7, 64, 32, 7, 3, false },
+		{ Bc3, 128, 128, 8, 1, true },
+		{ Rgba16F, 16, 16, 5, 2, true },
+		{ Rgba8, 1, 1, 1, 1, false },
+		{ Bc1, 4, 12, 4, 1, false }
+	};
+
+	void DdsLayoutsMatch() {
+		for (const Case& c : Cases)
+		{
+			const uint32_t slices = c.arraySize * (c.cube ? 6 : 1);
+			const bool legacy = c.arraySize == 1 && (c.format.dxgi == Bc1.dxgi || c.format.dxgi == Bc3.dxgi);
+			for (bool dx10 : { false, true })
+			{
+				if (!dx10 && !legacy)
+				{
+					continue;
+				}
+				const std::vector<uint8_t> bytes = MakeDds(c.format, c.width, c.height, c.mips, c.arraySize, c.cube, dx10);
+				TextureFile file;
+				CHECK(file.Load(bytes.data(), bytes.size()));
+				CHECK(file.GetInfo().type == TextureFileType::DDS && file.GetInfo().cube == c.cube);
+				CHECK(Matches(file, c.format, c.width, c.height, c.mips, slices));
+			}
+		}
+	}
+
+	void Ktx2LayoutsMatch() {
+		for (const Case& c : Cases)
+		{
+			const std::vector<uint8_t> bytes = MakeKtx2(c.format, c.width, c.height, c.mips, c.arraySize > 1 ? c.arraySize : 0, c.cube ? 6 : 1);
+			TextureFile file;
+			CHECK(file.Load(bytes.data(), bytes.size()));
+			CHECK(file.GetInfo().type == TextureFileType::KTX2 && file.GetInfo().cube == c.cube);
+			CHECK(Matches(file, c.format, c.width, c.height, c.mips, c.arraySize * (c.cube ? 6 : 1)));
+		}
+	}
+
+	// The way UploadTexture hands out rows, a few at a time
+	void RowRangesAddUpToTheWhole() {
+		const std::vector<uint8_t> bytes = MakeDds(Bc7, 64, 32, 7, 3, false, true);
+		TextureFile file;
+		CHECK(file.Load(bytes.data(), bytes.size()));
+		for (uint32_t index{ 0 }; index < file.GetSubresourceCount(); index++)
+		{
+			const TextureFileSubresource& subresource = file.GetSubresource(index);
+			const uint64_t pitch = subresource.rowSize + 16;
+			std::vector<uint8_t> whole(static_cast<size_t>(pitch * subresource.rowCount), 0xCD);
+			std::vector<uint8_t> pieces(whole.size(), 0xCD);
+			file.CopySubresource(index, whole.data(), pitch);
+			for (uint32_t row{ 0 }; row < subresource.rowCount; row += 3)
+			{
+				file.CopySubresource(index, pieces.data() + row * pitch, pitch, row, 3);
+			}
+			CHECK(pieces == whole);
+		}
+
+		// Packed rows take the single memcpy, a count past the end stops at the last row
+		const TextureFileSubresource& top = file.GetSubresource(0);
+		std::vector<uint8_t> packed(top.rowSize * top.rowCount);
+		file.CopySubresource(0, packed.data(), top.rowSize, 2, 1000);
+		CHECK(memcmp(packed.data(), file.GetSubresourceData(0) + 2 * top.rowSize, (top.rowCount - 2) * top.rowSize) == 0);
+	}
+
+	bool Rejects(const std::vector<uint8_t>& bytes) {
+		TextureFile file;
+		const bool loaded = file.Load(bytes.data(), bytes.size());
+		return !loaded && !file.IsOpen() && file.GetError() != nullptr;
+	}
+
+	void Poke(std::vector<uint8_t>& bytes, size_t offset, uint32_t value) {
+		memcpy(&bytes[offset], &value, sizeof(value));
+	}
+
+	void BadFilesAreRejected() {
+		// Offsets into the DDS header: height 12, width 16, mip count 28, DX10 array size 140
+		std::vector<uint8_t> dds = MakeDds(Rgba8, 16, 16, 5, 2, false, true);
+		CHECK(!Rejects(dds));
+		CHECK(Rejects(std::vector<uint8_t>(dds.begin(), dds.end() - 1)));
+		CHECK(Rejects(std::vector<uint8_t>(dds.begin(), dds.begin() + 100)));
+		CHECK(Rejects(std::vector<uint8_t>()));
+
+		std::vector<uint8_t> bad = dds;
+		Poke(bad, 16, TextureFile::MaxDimension + 1);
+		CHECK(Rejects(bad));
+		bad = dds;
+		Poke(bad, 16, 0);
+		CHECK(Rejects(bad));
+		bad = dds;
+		Poke(bad, 28, 6);
+		CHECK(Rejects(bad));
+		bad = dds;
+		Poke(bad, 140, TextureFile::MaxArraySize + 1);
+		CHECK(Rejects(bad));
+		bad = dds;
+		Poke(bad, 140, 0);
+		CHECK(Rejects(bad));
+		bad = dds;
+		Poke(bad, 128, 9999);
+		CHECK(Rejects(bad));
+
+		// As big as D3D12 goes parses as far as the data, which isn't there
+		bad = MakeDds(Rgba8, 4, 4, 1, 1, false, true);
+		Poke(bad, 12, TextureFile::MaxDimension);
+		Poke(bad, 16, TextureFile::MaxDimension);
+		TextureFile file;
+		CHECK(!file.Load(bad.data(), bad.size()));
+		CHECK(strcmp(file.GetError(), "texel data runs past the end of the file") == 0);
+
+		// BC sizes in whole blocks, cube faces square
+		CHECK(Rejects(MakeDds(Bc1, 6, 8, 1, 1, false, true)));
+		CHECK(Rejects(MakeDds(Rgba8, 16, 8, 1, 1, true, true)));
+
+		// KTX2: layer count 32, face count 36, level count 40, supercompression 44, first level's length 88
+		std::vector<uint8_t> ktx2 = MakeKtx2(Bc3, 32, 32, 6, 0, 6);
+		CHECK(!Rejects(ktx2));
+		bad = ktx2;
+		Poke(bad, 36, 2);
+		CHECK(Rejects(bad));
+		bad = ktx2;
+		Poke(bad, 32, TextureFile::MaxArraySize + 1);
+		CHECK(Rejects(bad));
+		bad = ktx2;
+		Poke(bad, 44, 1);
+		CHECK(Rejects(bad));
+		bad = ktx2;
+		Poke(bad, 40, 200);
+		CHECK(Rejects(bad));
+		bad = ktx2;
+		Poke(bad, 88, 16);
+		CHECK(Rejects(bad));
+		CHECK(Rejects(std::vector<uint8_t>(ktx2.begin(), ktx2.begin() + 60)));
+	}
+
+	// Whatever a mutated header says, an accepted file's subresources lie inside the data. The copy goes to an
+	// exact size heap block so a sanitizer build catches any overread.
+	void MutatedHeadersStayInBounds() {
+		const std::vector<std::vector<uint8_t>> seeds = {
+			MakeDds(Bc7, 64, 32, 7, 3, false, true),
+			MakeDds(Bc1, 64, 64, 7, 1, true, false),
+			MakeKtx2(Bc3, 32, 32, 6, 0, 6),
+			MakeKtx2(Rgba8, 20, 12, 5, 4, 1)
+		};
+		std::mt19937 random(5);
+		uint32_t accepted = 0;
+		for (uint32_t iteration{ 0 }; iteration < 4000; iteration++)
+		{
+			std::vector<uint8_t> bytes = seeds[random() % seeds.size()];
+			const bool headerOnly = random() % 4 != 0;
+			const uint32_t mutations = 1 + random() % 8;
+			for (uint32_t m{ 0 }; m < mutations && !bytes.empty(); m++)
+			{
+				const size_t position = random() % (headerOnly && bytes.size() > 200 ? 200 : bytes.size());
+				switch (random() % 4)
+				{
+					case 0:
+						bytes[position] ^= static_cast<uint8_t>(1u << (random() % 8));
+						break;
+					case 1:
+						bytes[position] = static_cast<uint8_t>(random());
+						break;
+					case 2:
+					{
+						const uint32_t choice = random() % 3;
+						const uint32_t value = choice == 0 ? 0xFFFFFFFFu : choice == 1 ? 0u : random() % 70000;
+						if ((position & ~size_t(3)) + 4 <= bytes.size())
+						{
+							Poke(bytes, position & ~size_t(3), value);
+						}
+						break;
+					}
+					default:
+						bytes.resize(random() % (bytes.size() + 1));
+						break;
+				}
+			}
+
+			uint8_t* data = static_cast<uint8_t*>(malloc(bytes.empty() ? 1 : bytes.size()));
+			memcpy(data, bytes.data(), bytes.size());
+			TextureFile file;
+			if (file.Load(data, bytes.size()))
+			{
+				accepted++;
+				for (uint32_t index{ 0 }; index < file.GetSubresourceCount(); index++)
+				{
+					const TextureFileSubresource& subresource = file.GetSubresource(index);
+					const uint64_t size = static_cast<uint64_t>(subresource.rowSize) * subresource.rowCount;
+					CHECK(subresource.offset + size <= bytes.size());
+					std::vector<uint8_t> destination(static_cast<size_t>(size));
+					file.CopySubresource(index, destination.data(), subresource.rowSize);
+				}
+			}
+			else
+			{
+				CHECK(file.GetError() != nullptr);
+			}
+			free(data);
+		}
+		printf("  %u of 4000 mutated files accepted\n", accepted);
+		CHECK(accepted > 0 && accepted < 4000);
+	}
+
+	void OpensFromDisk() {
+		const std::vector<uint8_t> bytes = MakeDds(Bc3, 128, 128, 8, 1, true, false);
+		FILE* output = fopen(TestFile, "wb");
+		fwrite(bytes.data(), 1, bytes.size(), output);
+		fclose(output);
+
+		TextureFile file;
+		CHECK(file.Open(TestFile));
+		CHECK(Matches(file, Bc3, 128, 128, 8, 6));
+		file.Close();
+		CHECK(!file.IsOpen() && file.GetSubresourceCount() == 0);
+		remove(TestFile);
+		CHECK(!file.Open(TestFile));
+		CHECK(strcmp(file.GetError(), "can't open the file") == 0);
+	}
+}
+
+int main() {
+	RUN_TEST(DdsLayoutsMatch);
+	RUN_TEST(Ktx2LayoutsMatch);
+	RUN_TEST(RowRangesAddUpToTheWhole);
+	RUN_TEST(BadFilesAreRejected);
+	RUN_TEST(MutatedHeadersStayInBounds);
+	RUN_TEST(OpensFromDisk);
+	return TestResult();
+}
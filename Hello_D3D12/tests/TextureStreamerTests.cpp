@@ -0,0 +1,265 @@
+#include "Graphics/TextureStreamer.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// 256x256 BC7 down to 1x1, mips 0-3 stream, 4 and down (16 KB and less) are the tail
+	const uint64_t SmallMips[] = { 65536, 16384, 4096, 1024, 256, 64, 16, 16, 16 };
+	const uint32_t SmallMipLevels = 9;
+	const uint32_t SmallTail = 4;
+	const uint64_t SmallTailSize = 256 + 64 + 16 * 3;
+
+	bool LoadEverything(uint32_t, uint32_t) {
+		return true;
+	}
+
+	// Inline loads land on the Update after the one that issued them
+	void StreamsInCoarseToFine() {
+		TextureStreamer streamer;
+		streamer.Initialize(nullptr, LoadEverything, 1 << 20, 4);
+		const uint32_t texture = streamer.Register(SmallMipLevels, SmallMips, SmallTail);
+		CHECK(streamer.GetResidentMip(texture) == SmallTail);
+		CHECK(streamer.GetStats().residentSize == SmallTailSize && streamer.GetStats().tailSize == SmallTailSize);
+
+		const uint32_t feedback = 0;
+		std::vector<TextureStreamEvent> events;
+		streamer.Update(&feedback, 1, events);
+		CHECK(events.empty() && streamer.IsLoading(texture));
+		for (uint32_t mip{ SmallTail }; mip-- > 0;)
+		{
+			streamer.Update(&feedback, 1, events);
+			CHECK(events.size() == 1 && events[0].texture == texture && events[0].residentMip == mip && events[0].loaded);
+		}
+		streamer.Update(&feedback, 1, events);
+		CHECK(events.empty() && !streamer.IsLoading(texture));
+		CHECK(streamer.GetStats().residentSize == 65536 + 16384 + 4096 + 1024 + SmallTailSize);
+		CHECK(streamer.GetStats().loadsIssued == SmallTail && streamer.GetStats().loadingSize == 0);
+
+		// Not sampled any more, nothing happens until the memory is needed
+		const uint32_t none = TextureStreamer::NotRequested;
+		streamer.Update(&none, 1, events);
+		CHECK(events.empty() && streamer.GetResidentMip(texture) == 0 && streamer.GetWantedMip(texture) == SmallTail);
+		// Then it goes finest first, one mip per event, never into the tail
+		streamer.SetBudget(0);
+		streamer.Update(&none, 1, events);
+		CHECK(events.size() == SmallTail);
+		for (uint32_t i{ 0 }; i < events.size(); i++)
+		{
+			CHECK(!events[i].loaded && events[i].residentMip == i + 1);
+		}
+		CHECK(streamer.GetStats().residentSize == SmallTailSize && streamer.GetStats().evictions == SmallTail);
+	}
+
+	// Making room takes from the texture sampled longest ago
+	void EvictsTheLeastRecentlyUsed() {
+		TextureStreamer streamer;
+		const uint64_t resident = 65536 + 16384 + 4096 + 1024 + SmallTailSize;
+		streamer.Initialize(nullptr, LoadEverything, 2 * resident + SmallTailSize, 4);
+		const uint32_t a = streamer.Register(SmallMipLevels, SmallMips, SmallTail);
+		const uint32_t b = streamer.Register(SmallMipLevels, SmallMips, SmallTail);
+		const uint32_t c = streamer.Register(SmallMipLevels, SmallMips, SmallTail);
+
+		std::vector<TextureStreamEvent> events;
+		uint32_t feedback[3] = { 0, 0, TextureStreamer::NotRequested };
+		for (int frame{ 0 }; frame < 6; frame++)
+		{
+			streamer.Update(feedback, 3, events);
+		}
+		CHECK(streamer.GetResidentMip(a) == 0 && streamer.GetResidentMip(b) == 0);
+
+		// b sampled after a, so when c wants memory a pays for it
+		feedback[0] = TextureStreamer::NotRequested;
+		streamer.Update(feedback, 3, events);
+		feedback[1] = TextureStreamer::NotRequested;
+		feedback[2] = 0;
+		streamer.Update(feedback, 3, events);
+		CHECK(events.size() == 1 && events[0].texture == a && !events[0].loaded && events[0].residentMip == 1);
+		CHECK(streamer.GetResidentMip(b) == 0 && streamer.IsLoading(c));
+		CHECK(streamer.GetStats().residentSize + streamer.GetStats().loadingSize <= streamer.GetStats().budget);
+	}
+
+	// A failed load keeps what the texture has and doesn't retry. A load coming back for an unregistered texture
+	// is dropped and only then is the slot reused.
+	void FailuresAndUnregisterMidLoad() {
+		TextureStreamer streamer;
+		streamer.Initialize(nullptr, [](uint32_t, uint32_t mip) { return mip != 2; }, 1 << 20, 4);
+		const uint32_t texture = streamer.Register(SmallMipLevels, SmallMips, SmallTail);
+		const uint32_t feedback[2] = { 0, 0 };
+		std::vector<TextureStreamEvent> events;
+		for (int frame{ 0 }; frame < 6; frame++)
+		{
+			streamer.Update(feedback, 2, events);
+		}
+		CHECK(streamer.GetResidentMip(texture) == 3 && !streamer.IsLoading(texture));
+		CHECK(streamer.GetStats().loadsFailed == 1 && streamer.GetStats().loadsIssued == 2);
+
+		const uint32_t other = streamer.Register(SmallMipLevels, SmallMips, SmallTail);
+		streamer.Update(feedback, 2, events);
+		CHECK(streamer.IsLoading(other));
+		streamer.Unregister(other);
+		CHECK(streamer.Register(SmallMipLevels, SmallMips, SmallTail) != other);
+		streamer.Update(feedback, 2, events);
+		for (const TextureStreamEvent& event : events)
+		{
+			CHECK(event.texture != other);
+		}
+		CHECK(streamer.GetStats().loadsInFlight == 0 && streamer.GetStats().loadingSize == 0);
+		CHECK(streamer.Register(SmallMipLevels, SmallMips, SmallTail) == other);
+	}
+
+	// A camera drifting over a field of textures that ask for finer mips the closer they are, with churn and the
+	// budget halved half way. Every frame the events have to replay to what the streamer says is resident, its
+	// size has to match a recount, and it may only be over budget when nothing spare is left to evict.
+	void SimulationKeepsItsBooks(uint32_t workerCount) {
+		const uint32_t count = 400;
+		// A texture unregistered mid load gets a new slot, there are 24 of those at most
+		const uint32_t slotCount = count + 64;
+		const int frames = 1200;
+		const uint64_t budget = 96ull << 20;
+
+		JobSystem jobSystem;
+		jobSystem.Initialize(workerCount);
+		std::vector<std::vector<uint64_t>> mipSizes(count);
+		std::vector<std::atomic<int>> active(slotCount);
+		std::atomic<uint32_t> doubleLoads(0);
+		for (std::atomic<int>& loading : active)
+		{
+			loading.store(0);
+		}
+		TextureStreamer streamer;
+		streamer.Initialize(workerCount > 0 ? &jobSystem : nullptr, [&](uint32_t texture, uint32_t mip) {
+			if (active[texture].fetch_add(1) != 0)
+			{
+				doubleLoads++;
+			}
+			if (workerCount > 0 && mip == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+			}
+			active[texture].fetch_sub(1);
+			return (texture * 7 + mip) % 97 != 3;
+		}, budget, 16);
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> place(0.0f, 100.0f);
+		std::vector<float> x(count);
+		std::vector<float> y(count);
+		std::vector<uint32_t> ids(count);
+		std::vector<uint32_t> shadow(slotCount);
+		const auto registerTexture = [&](uint32_t i) {
+			const std::vector<uint64_t>& sizes = mipSizes[i];
+			uint32_t tail = 0;
+			while (tail + 1 < sizes.size() && sizes[tail] > 65536)
+			{
+				tail++;
+			}
+			ids[i] = streamer.Register(static_cast<uint32_t>(sizes.size()), sizes.data(), tail);
+			shadow[ids[i]] = tail;
+		};
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			// 256 to 2048 BC7 down to 1x1
+			const uint32_t size = 256u << (random() % 4);
+			for (uint32_t width{ size }; width > 0; width >>= 1)
+			{
+				mipSizes[i].push_back(static_cast<uint64_t>((width + 3) / 4) * ((width + 3) / 4) * 16);
+			}
+			x[i] = place(random);
+			y[i] = place(random);
+			registerTexture(i);
+		}
+
+		std::vector<uint32_t> feedback(slotCount, TextureStreamer::NotRequested);
+		std::vector<TextureStreamEvent> events;
+		uint32_t badEvents = 0;
+		uint32_t badResidency = 0;
+		uint32_t badSize = 0;
+		uint32_t overBudget = 0;
+		for (int frame{ 0 }; frame < frames; frame++)
+		{
+			const float cameraX = 50.0f + 35.0f * std::cos(frame * 0.01f);
+			const float cameraY = 50.0f + 35.0f * std::sin(frame * 0.013f);
+			for (uint32_t i{ 0 }; i < count; i++)
+			{
+				const float distance = std::hypot(x[i] - cameraX, y[i] - cameraY);
+				feedback[ids[i]] = distance > 20.0f ? TextureStreamer::NotRequested :
+					static_cast<uint32_t>(std::max(0.0f, std::log2(distance + 1.0f) - 1.0f));
+			}
+			if (frame == frames / 2)
+			{
+				streamer.SetBudget(budget / 2);
+			}
+			if (frame % 50 == 49)
+			{
+				const uint32_t i = random() % count;
+				streamer.Unregister(ids[i]);
+				registerTexture(i);
+			}
+
+			streamer.Update(feedback.data(), slotCount, events);
+			for (const TextureStreamEvent& event : events)
+			{
+				const uint32_t expected = event.loaded ? shadow[event.texture] - 1 : shadow[event.texture] + 1;
+				badEvents += event.residentMip != expected ? 1 : 0;
+				shadow[event.texture] = event.residentMip;
+			}
+
+			uint64_t residentSize = 0;
+			bool spare = false;
+			for (uint32_t i{ 0 }; i < count; i++)
+			{
+				const uint32_t id = ids[i];
+				const uint32_t residentMip = streamer.GetResidentMip(id);
+				badResidency += residentMip != shadow[id] ? 1 : 0;
+				for (uint32_t mip{ residentMip }; mip < mipSizes[i].size(); mip++)
+				{
+					residentSize += mipSizes[i][mip];
+				}
+				spare = spare || (residentMip < streamer.GetWantedMip(id) && !streamer.IsLoading(id));
+			}
+			const TextureStreamerStats& stats = streamer.GetStats();
+			badSize += stats.residentSize != residentSize ? 1 : 0;
+			overBudget += stats.residentSize + stats.loadingSize > stats.budget && spare ? 1 : 0;
+		}
+
+		const TextureStreamerStats& stats = streamer.GetStats();
+		printf("  %u workers: %llu loads, %llu failed, %llu evictions, %llu stalls, %.1f MB resident, %.1f MB tails\n", workerCount,
+			static_cast<unsigned long long>(stats.loadsIssued), static_cast<unsigned long long>(stats.loadsFailed),
+			static_cast<unsigned long long>(stats.evictions), static_cast<unsigned long long>(stats.budgetStalls),
+			stats.residentSize / 1048576.0, stats.tailSize / 1048576.0);
+		CHECK(badEvents == 0);
+		CHECK(badResidency == 0);
+		CHECK(badSize == 0);
+		CHECK(overBudget == 0);
+		CHECK(doubleLoads == 0);
+		// And it was actually under pressure
+		CHECK(stats.loadsIssued > 100 && stats.loadsFailed > 0 && stats.evictions > 100 && stats.budgetStalls > 0);
+		CHECK(stats.textureCount == count);
+		streamer.Shutdown();
+		jobSystem.Shutdown();
+	}
+
+	void SimulationInline() {
+		SimulationKeepsItsBooks(0);
+	}
+
+	void SimulationOnWorkers() {
+		SimulationKeepsItsBooks(3);
+	}
+}
+
+int main() {
+	RUN_TEST(StreamsInCoarseToFine);
+	RUN_TEST(EvictsTheLeastRecentlyUsed);
+	RUN_TEST(FailuresAndUnregisterMidLoad);
+	RUN_TEST(SimulationInline);
+	RUN_TEST(SimulationOnWorkers);
+	return TestResult();
+}
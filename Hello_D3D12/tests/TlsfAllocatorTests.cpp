@@ -0,0 +1,200 @@
+#include "Graphics/TlsfAllocator.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const uint64_t KB = 1024;
+	const uint64_t MB = 1024 * KB;
+
+	// A fresh allocator carves from the front, every allocation gets exactly the size it asked for
+	void CarvesFromTheFront() {
+		TlsfAllocator allocator(MB);
+		TlsfAllocation a, b, c;
+		CHECK(allocator.Allocate(100, 1, a) && a.offset == 0 && a.size == 100);
+		CHECK(allocator.Allocate(7, 1, b) && b.offset == 100 && b.size == 7);
+		CHECK(allocator.Allocate(64 * KB, 1, c) && c.offset == 107);
+		CHECK(allocator.GetUsedSize() == 100 + 7 + 64 * KB && allocator.GetAllocationCount() == 3);
+
+		const TlsfStats stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 1 && stats.largestFreeBlock == MB - allocator.GetUsedSize());
+		CHECK(stats.fragmentation == 0.0f);
+	}
+
+	// Alignment padding goes back as a free block, and the next allocation small enough lands in it
+	void AlignmentPaddingIsReused() {
+		TlsfAllocator allocator(MB);
+		TlsfAllocation a, b, c;
+		CHECK(allocator.Allocate(100, 1, a));
+		CHECK(allocator.Allocate(64 * KB, 64 * KB, b) && b.offset == 64 * KB && b.size == 64 * KB);
+		CHECK(allocator.GetStats().freeBlockCount == 2);
+		CHECK(allocator.Allocate(1000, 8, c) && c.offset == 104);
+		CHECK(allocator.GetUsedSize() == 100 + 64 * KB + 1000);
+
+		// Offset 0 is the only 4 MB boundary in range and it's taken
+		TlsfAllocation big;
+		CHECK(!allocator.Allocate(KB, 4 * MB, big));
+	}
+
+	// Freeing merges with free neighbours on both sides, so an emptied allocator is one block again
+	void FreeMergesNeighbours() {
+		TlsfAllocator allocator(4 * KB);
+		TlsfAllocation blocks[4];
+		for (TlsfAllocation& block : blocks)
+		{
+			CHECK(allocator.Allocate(KB, 1, block));
+		}
+		CHECK(allocator.GetStats().freeBlockCount == 0 && allocator.GetUsedSize() == 4 * KB);
+
+		allocator.Free(blocks[0]);
+		allocator.Free(blocks[2]);
+		TlsfStats stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 2 && stats.largestFreeBlock == KB);
+		CHECK_NEAR(stats.fragmentation, 0.5, 1e-6);
+
+		// The middle one joins both sides
+		allocator.Free(blocks[1]);
+		stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 1 && stats.largestFreeBlock == 3 * KB && stats.fragmentation == 0.0f);
+
+		allocator.Free(blocks[3]);
+		stats = allocator.GetStats();
+		CHECK(allocator.IsEmpty() && stats.freeBlockCount == 1 && stats.largestFreeBlock == 4 * KB);
+
+		// All of it in one go, then nothing
+		TlsfAllocation all, none;
+		CHECK(allocator.Allocate(4 * KB, 4 * KB, all) && all.offset == 0);
+		CHECK(!allocator.Allocate(1, 1, none));
+	}
+
+	// Full fails cleanly, and a freed hole is found again by a request of its size
+	void ExhaustionAndHoles() {
+		TlsfAllocator allocator(64 * KB);
+		std::vector<TlsfAllocation> blocks(16);
+		for (TlsfAllocation& block : blocks)
+		{
+			CHECK(allocator.Allocate(4 * KB, 4 * KB, block));
+		}
+		TlsfAllocation extra;
+		CHECK(!allocator.Allocate(1, 1, extra));
+		CHECK(allocator.GetUsedSize() == allocator.GetSize());
+
+		allocator.Free(blocks[5]);
+		allocator.Free(blocks[11]);
+		// Two 4 KB holes, not 8 KB in a row
+		CHECK(!allocator.Allocate(8 * KB, 1, extra));
+		CHECK(allocator.Allocate(4 * KB, 4 * KB, extra) && (extra.offset == 20 * KB || extra.offset == 44 * KB));
+		CHECK(allocator.Allocate(3 * KB, 1, extra) && (extra.offset == 20 * KB || extra.offset == 44 * KB));
+		CHECK(allocator.Allocate(KB, 1, extra) && !allocator.Allocate(1, 1, extra));
+	}
+
+	// Blocks whose size maps to the request's own list are only checked as a last resort, an exact fit there
+	// still has to be found
+	void FindsAnExactFitInItsOwnList() {
+		TlsfAllocator allocator(3 * MB);
+		TlsfAllocation first, hole, last;
+		CHECK(allocator.Allocate(MB, 1, first));
+		CHECK(allocator.Allocate(MB + 100 * KB, 1, hole));
+		CHECK(allocator.Allocate(allocator.GetSize() - allocator.GetUsedSize(), 1, last));
+		allocator.Free(hole);
+		// 1 MB + 90 KB maps to the same list as the 1 MB + 100 KB hole
+		TlsfAllocation fit;
+		CHECK(allocator.Allocate(MB + 90 * KB, 64 * KB, fit) && fit.offset == MB);
+	}
+
+	// Random allocations and frees with mixed sizes and alignments, checked against a list of what's live: no
+	// overlap, alignment honoured, everything in range and the used size adding up. Freeing it all has to leave
+	// a single block.
+	void RandomTrace() {
+		const uint64_t size = 256 * MB;
+		TlsfAllocator allocator(size);
+		std::mt19937 random(7);
+		std::vector<TlsfAllocation> live;
+		uint32_t misaligned = 0;
+		uint32_t outOfRange = 0;
+		uint32_t overlaps = 0;
+		uint32_t badUsed = 0;
+
+		for (int step{ 0 }; step < 20000; step++)
+		{
+			const bool allocate = live.empty() || random() % 100 < (allocator.GetUsedSize() < size / 2 ? 65u : 45u);
+			if (allocate)
+			{
+				// Buffers and textures, 256 B to 16 MB, mostly small
+				const uint64_t requestSize = 256ull << (random() % 17) >> (random() % 4);
+				const uint64_t alignments[] = { 256, 4 * KB, 64 * KB, 4 * MB };
+				const uint64_t alignment = alignments[random() % 4];
+				TlsfAllocation allocation;
+				if (allocator.Allocate(requestSize, alignment, allocation))
+				{
+					misaligned += allocation.offset % alignment != 0 ? 1 : 0;
+					outOfRange += allocation.offset + allocation.size > size || allocation.size != requestSize ? 1 : 0;
+					live.push_back(allocation);
+				}
+			}
+			else
+			{
+				const size_t index = random() % live.size();
+				allocator.Free(live[index]);
+				live[index] = live.back();
+				live.pop_back();
+			}
+
+			if (step % 500 == 0 || step == 19999)
+			{
+				std::vector<TlsfAllocation> sorted = live;
+				std::sort(sorted.begin(), sorted.end(), [](const TlsfAllocation& a, const TlsfAllocation& b) { return a.offset < b.offset; });
+				uint64_t used = 0;
+				for (size_t i{ 0 }; i < sorted.size(); i++)
+				{
+					used += sorted[i].size;
+					overlaps += i > 0 && sorted[i - 1].offset + sorted[i - 1].size > sorted[i].offset ? 1 : 0;
+				}
+				const TlsfStats stats = allocator.GetStats();
+				badUsed += used != allocator.GetUsedSize() || stats.allocationCount != live.size() ? 1 : 0;
+				badUsed += stats.largestFreeBlock > size - used ? 1 : 0;
+			}
+		}
+
+		CHECK(misaligned == 0);
+		CHECK(outOfRange == 0);
+		CHECK(overlaps == 0);
+		CHECK(badUsed == 0);
+		// Still holding plenty at the end, or the test isn't testing much
+		CHECK(live.size() > 100);
+
+		for (const TlsfAllocation& allocation : live)
+		{
+			allocator.Free(allocation);
+		}
+		const TlsfStats stats = allocator.GetStats();
+		CHECK(allocator.IsEmpty() && stats.usedSize == 0);
+		CHECK(stats.freeBlockCount == 1 && stats.largestFreeBlock == size);
+	}
+
+	// An empty allocator has nothing to give, Initialize throws away whatever was allocated
+	void ReinitializeStartsOver() {
+		TlsfAllocator allocator;
+		CHECK(allocator.GetSize() == 0);
+		TlsfAllocation allocation;
+		CHECK(!allocator.Allocate(1, 1, allocation));
+		allocator.Initialize(KB);
+		CHECK(allocator.Allocate(KB, 1, allocation));
+		allocator.Initialize(2 * KB);
+		CHECK(allocator.IsEmpty() && allocator.GetStats().largestFreeBlock == 2 * KB);
+		CHECK(allocator.Allocate(2 * KB, 1, allocation) && allocation.offset == 0);
+	}
+}
+
+int main() {
+	RUN_TEST(CarvesFromTheFront);
+	RUN_TEST(AlignmentPaddingIsReused);
+	RUN_TEST(FreeMergesNeighbours);
+	RUN_TEST(ExhaustionAndHoles);
+	RUN_TEST(FindsAnExactFitInItsOwnList);
+	RUN_TEST(RandomTrace);
+	RUN_TEST(ReinitializeStartsOver);
+	return TestResult();
+}
@@ -0,0 +1,264 @@
+#include "Graphics/TransformKernels.h"
+#include "TestHarness.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const SimdLevel Levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+
+	// FMA and reordered sums differ from glm in the last bits, relative to the size of the value
+	const double Tolerance = 1e-5;
+
+	struct Scene
+	{
+		glm::mat4 left;
+		std::vector<glm::mat4> matrices;
+		std::vector<glm::vec4> points;
+		std::vector<Aabb> boxes;
+		std::vector<uint32_t> parents;
+	};
+
+	// Odd count so every kernel runs its tail too
+	Scene MakeScene(size_t count) {
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+		Scene scene;
+		scene.matrices.resize(count);
+		scene.points.resize(count);
+		scene.boxes.resize(count);
+		scene.parents.resize(count);
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			for (int column{ 0 }; column < 4; column++)
+			{
+				for (int row{ 0 }; row < 4; row++)
+				{
+					scene.matrices[i][column][row] = value(random) * 0.5f;
+				}
+			}
+			scene.points[i] = glm::vec4(value(random), value(random), value(random), 1.0f);
+			const glm::vec3 corner(value(random), value(random), value(random));
+			const glm::vec3 size(std::fabs(value(random)), std::fabs(value(random)), std::fabs(value(random)));
+			scene.boxes[i] = { corner, corner + size };
+			scene.parents[i] = i == 0 || i % 7 == 0 ? InvalidParent : static_cast<uint32_t>(random() % i);
+		}
+
+		// Affine, for the boxes
+		scene.left = scene.matrices[count / 2];
+		scene.left[0][3] = scene.left[1][3] = scene.left[2][3] = 0.0f;
+		scene.left[3][3] = 1.0f;
+		return scene;
+	}
+
+	double RelativeError(float value, float expected) {
+		return std::fabs(static_cast<double>(value) - expected) / (1.0 + std::fabs(expected));
+	}
+
+	double MaxError(const glm::mat4& value, const glm::mat4& expected) {
+		double error = 0.0;
+		for (int column{ 0 }; column < 4; column++)
+		{
+			for (int row{ 0 }; row < 4; row++)
+			{
+				const double e = RelativeError(value[column][row], expected[column][row]);
+				error = e > error ? e : error;
+			}
+		}
+		return error;
+	}
+
+	double MaxError(const glm::vec4& value, const glm::vec4& expected) {
+		double error = 0.0;
+		for (int i{ 0 }; i < 4; i++)
+		{
+			const double e = RelativeError(value[i], expected[i]);
+			error = e > error ? e : error;
+		}
+		return error;
+	}
+
+	void MatricesAndPointsMatchGlm() {
+		for (size_t count : { size_t(1), size_t(3), size_t(5), size_t(9), size_t(17), size_t(1003) })
+		{
+			const Scene scene = MakeScene(count);
+			std::vector<glm::mat4> matrices(count);
+			std::vector<glm::mat4> world(count);
+			std::vector<glm::vec4> points(count);
+			std::vector<glm::mat4> expectedWorld(count);
+			for (size_t i{ 0 }; i < count; i++)
+			{
+				expectedWorld[i] = scene.parents[i] == InvalidParent ? scene.matrices[i] : expectedWorld[scene.parents[i]] * scene.matrices[i];
+			}
+
+			for (SimdLevel level : Levels)
+			{
+				SetSimdLevel(level);
+				MultiplyMatrices(scene.left, scene.matrices.data(), matrices.data(), count);
+				TransformPoints(scene.left, scene.points.data(), points.data(), count);
+				ComposeHierarchy(scene.matrices.data(), scene.parents.data(), world.data(), count);
+
+				double matrixError = 0.0;
+				double pointError = 0.0;
+				double worldError = 0.0;
+				for (size_t i{ 0 }; i < count; i++)
+				{
+					const double m = MaxError(matrices[i], scene.left * scene.matrices[i]);
+					const double p = MaxError(points[i], scene.left * scene.points[i]);
+					const double w = MaxError(world[i], expectedWorld[i]);
+					matrixError = m > matrixError ? m : matrixError;
+					pointError = p > pointError ? p : pointError;
+					worldError = w > worldError ? w : worldError;
+				}
+				CHECK_NEAR(matrixError, 0.0, Tolerance);
+				CHECK_NEAR(pointError, 0.0, Tolerance);
+				CHECK_NEAR(worldError, 0.0, Tolerance);
+			}
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+	}
+
+	// Arvo's box has to be the tight one around the 8 transformed corners
+	void BoxesMatchTheirCorners() {
+		const size_t count = 1003;
+		const Scene scene = MakeScene(count);
+		std::vector<Aabb> expected(count);
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			glm::vec3 low(1e30f);
+			glm::vec3 high(-1e30f);
+			for (int k{ 0 }; k < 8; k++)
+			{
+				const Aabb& box = scene.boxes[i];
+				const glm::vec3 corner((k & 1) ? box.max.x : box.min.x, (k & 2) ? box.max.y : box.min.y, (k & 4) ? box.max.z : box.min.z);
+				const glm::vec3 transformed = glm::vec3(scene.left * glm::vec4(corner, 1.0f));
+				low = glm::min(low, transformed);
+				high = glm::max(high, transformed);
+			}
+			expected[i] = { low, high };
+		}
+
+		std::vector<Aabb> boxes(count);
+		for (SimdLevel level : Levels)
+		{
+			SetSimdLevel(level);
+			TransformAabbs(scene.left, scene.boxes.data(), boxes.data(), count);
+			double error = 0.0;
+			for (size_t i{ 0 }; i < count; i++)
+			{
+				for (int axis{ 0 }; axis < 3; axis++)
+				{
+					const double low = RelativeError(boxes[i].min[axis], expected[i].min[axis]);
+					const double high = RelativeError(boxes[i].max[axis], expected[i].max[axis]);
+					error = low > error ? low : error;
+					error = high > error ? high : error;
+				}
+			}
+			CHECK_NEAR(error, 0.0, Tolerance);
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+	}
+
+	void InPlaceMatchesOutOfPlace() {
+		const size_t count = 1003;
+		const Scene scene = MakeScene(count);
+		for (SimdLevel level : Levels)
+		{
+			SetSimdLevel(level);
+			std::vector<glm::mat4> matrices(count);
+			std::vector<glm::vec4> points(count);
+			std::vector<Aabb> boxes(count);
+			std::vector<glm::mat4> world(count);
+			MultiplyMatrices(scene.left, scene.matrices.data(), matrices.data(), count);
+			TransformPoints(scene.left, scene.points.data(), points.data(), count);
+			TransformAabbs(scene.left, scene.boxes.data(), boxes.data(), count);
+			ComposeHierarchy(scene.matrices.data(), scene.parents.data(), world.data(), count);
+
+			std::vector<glm::mat4> inPlaceMatrices = scene.matrices;
+			std::vector<glm::vec4> inPlacePoints = scene.points;
+			std::vector<Aabb> inPlaceBoxes = scene.boxes;
+			std::vector<glm::mat4> inPlaceWorld = scene.matrices;
+			MultiplyMatrices(scene.left, inPlaceMatrices.data(), inPlaceMatrices.data(), count);
+			TransformPoints(scene.left, inPlacePoints.data(), inPlacePoints.data(), count);
+			TransformAabbs(scene.left, inPlaceBoxes.data(), inPlaceBoxes.data(), count);
+			ComposeHierarchy(inPlaceWorld.data(), scene.parents.data(), inPlaceWorld.data(), count);
+
+			CHECK(memcmp(matrices.data(), inPlaceMatrices.data(), count * sizeof(glm::mat4)) == 0);
+			CHECK(memcmp(points.data(), inPlacePoints.data(), count * sizeof(glm::vec4)) == 0);
+			CHECK(memcmp(boxes.data(), inPlaceBoxes.data(), count * sizeof(Aabb)) == 0);
+			CHECK(memcmp(world.data(), inPlaceWorld.data(), count * sizeof(glm::mat4)) == 0);
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+	}
+
+	// Breadth first, so children sit together in runs of every length up to 9, with a root every so often
+	// cutting into a run. Out of place and in place have to agree with glm.
+	void SiblingRunsMatchGlm() {
+		const size_t count = 1003;
+		Scene scene = MakeScene(count);
+		size_t parent = 0;
+		size_t siblings = 0;
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			if (i == 0 || i % 97 == 0)
+			{
+				scene.parents[i] = InvalidParent;
+				continue;
+			}
+			if (siblings == 1 + parent % 9)
+			{
+				parent++;
+				siblings = 0;
+			}
+			scene.parents[i] = static_cast<uint32_t>(parent);
+			siblings++;
+		}
+
+		std::vector<glm::mat4> expectedWorld(count);
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			expectedWorld[i] = scene.parents[i] == InvalidParent ? scene.matrices[i] : expectedWorld[scene.parents[i]] * scene.matrices[i];
+		}
+
+		for (SimdLevel level : Levels)
+		{
+			SetSimdLevel(level);
+			std::vector<glm::mat4> world(count);
+			std::vector<glm::mat4> inPlaceWorld = scene.matrices;
+			ComposeHierarchy(scene.matrices.data(), scene.parents.data(), world.data(), count);
+			ComposeHierarchy(inPlaceWorld.data(), scene.parents.data(), inPlaceWorld.data(), count);
+
+			double worldError = 0.0;
+			for (size_t i{ 0 }; i < count; i++)
+			{
+				const double w = MaxError(world[i], expectedWorld[i]);
+				worldError = w > worldError ? w : worldError;
+			}
+			CHECK_NEAR(worldError, 0.0, Tolerance);
+			CHECK(memcmp(world.data(), inPlaceWorld.data(), count * sizeof(glm::mat4)) == 0);
+		}
+		SetSimdLevel(SimdLevel::AVX512);
+	}
+
+	void LevelFollowsTheCap() {
+		SetSimdLevel(SimdLevel::Scalar);
+		CHECK(GetTransformKernelLevel() == SimdLevel::Scalar);
+		// Never above what the CPU has
+		SetSimdLevel(SimdLevel::AVX512);
+		CHECK(GetTransformKernelLevel() <= GetCpuSimdLevel());
+		glm::mat4 identity(1.0f);
+		MultiplyMatrices(identity, &identity, &identity, 1);
+		CHECK(identity == glm::mat4(1.0f));
+	}
+}
+
+int main() {
+	printf("CPU: %s\n", GetSimdLevelName(GetCpuSimdLevel()));
+	RUN_TEST(MatricesAndPointsMatchGlm);
+	RUN_TEST(BoxesMatchTheirCorners);
+	RUN_TEST(InPlaceMatchesOutOfPlace);
+	RUN_TEST(SiblingRunsMatchGlm);
+	RUN_TEST(LevelFollowsTheCap);
+	return TestResult();
+}
@@ -0,0 +1,147 @@
+#include "Graphics/TransformStore.h"
+#include "TestHarness.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
+#include <vector>
+
+namespace
+{
+	glm::mat4 ComposeWithGlm(const TransformStore& store, uint32_t node) {
+		const glm::mat4 local = glm::translate(glm::mat4(1.0f), store.GetPosition(node)) * glm::mat4_cast(store.GetRotation(node)) *
+			glm::scale(glm::mat4(1.0f), store.GetScale(node));
+		const uint32_t parent = store.GetParent(node);
+		return parent == InvalidParent ? local : ComposeWithGlm(store, parent) * local;
+	}
+
+	double MaxWorldError(const TransformStore& store) {
+		double error = 0.0;
+		for (uint32_t node{ 0 }; node < store.GetCount(); node++)
+		{
+			const glm::mat4 expected = ComposeWithGlm(store, node);
+			for (int column{ 0 }; column < 4; column++)
+			{
+				for (int row{ 0 }; row < 4; row++)
+				{
+					const double e = std::fabs(static_cast<double>(store.GetWorld(node)[column][row]) - expected[column][row]);
+					error = e > error ? e : error;
+				}
+			}
+		}
+		return error;
+	}
+
+	glm::quat RandomRotation(std::mt19937& random) {
+		std::uniform_real_distribution<float> angle(-3.0f, 3.0f);
+		std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+		return glm::angleAxis(angle(random), glm::normalize(glm::vec3(axis(random), axis(random), axis(random)) + glm::vec3(0.0f, 0.0f, 2.0f)));
+	}
+
+	// Random forest, a third of the nodes are roots and the rest hang off any earlier node
+	void BuildForest(TransformStore& store, uint32_t count, std::mt19937& random) {
+		std::uniform_real_distribution<float> position(-2.0f, 2.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			const uint32_t parent = i == 0 || random() % 3 == 0 ? InvalidParent : static_cast<uint32_t>(random() % i);
+			store.Add(parent, glm::vec3(position(random), position(random), position(random)), RandomRotation(random),
+				glm::vec3(scale(random), scale(random), scale(random)));
+		}
+	}
+
+	void WorldMatchesGlm() {
+		std::mt19937 random(3);
+		TransformStore store;
+		BuildForest(store, 300, random);
+		CHECK(store.IsDirty(0) && store.IsDirty(299));
+		CHECK(store.UpdateWorld() == 300);
+		CHECK(!store.IsDirty(0) && !store.IsDirty(299));
+		CHECK_NEAR(MaxWorldError(store), 0.0, 1e-4);
+
+		// Nothing changed, nothing rebuilt
+		CHECK(store.UpdateWorld() == 0);
+		CHECK(store.GetChangedSize() == 0);
+	}
+
+	// A change rebuilds the node and everything below it, nothing else
+	void DirtyReachesEveryDescendant() {
+		TransformStore store;
+		const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+		const glm::vec3 one(1.0f);
+		// 0 - 1 - 2, with 3 under 0 and 4 on its own. 70 more roots so a child lands in another dirty word.
+		store.Add(InvalidParent, glm::vec3(1.0f, 0.0f, 0.0f), identity, one);
+		store.Add(0, glm::vec3(0.0f, 1.0f, 0.0f), identity, one);
+		store.Add(1, glm::vec3(0.0f, 0.0f, 1.0f), identity, one);
+		store.Add(0, glm::vec3(2.0f, 0.0f, 0.0f), identity, one);
+		store.Add(InvalidParent, glm::vec3(5.0f, 0.0f, 0.0f), identity, one);
+		for (uint32_t i{ 0 }; i < 70; i++)
+		{
+			store.Add(InvalidParent, glm::vec3(0.0f), identity, one);
+		}
+		const uint32_t farChild = store.Add(1, glm::vec3(0.0f, 0.0f, 3.0f), identity, one);
+		store.UpdateWorld();
+		CHECK(glm::vec3(store.GetWorld(2)[3]) == glm::vec3(1.0f, 1.0f, 1.0f));
+		CHECK(glm::vec3(store.GetWorld(farChild)[3]) == glm::vec3(1.0f, 1.0f, 3.0f));
+
+		store.SetPosition(1, glm::vec3(0.0f, 10.0f, 0.0f));
+		CHECK(store.UpdateWorld() == 3);
+		const std::vector<uint32_t> expected = { 1, 2, farChild };
+		CHECK(store.GetChangedNodes() == expected);
+		CHECK(glm::vec3(store.GetWorld(2)[3]) == glm::vec3(1.0f, 10.0f, 1.0f));
+		CHECK(glm::vec3(store.GetWorld(farChild)[3]) == glm::vec3(1.0f, 10.0f, 3.0f));
+
+		store.SetScale(0, glm::vec3(2.0f));
+		store.SetRotation(4, glm::angleAxis(1.0f, glm::vec3(0.0f, 1.0f, 0.0f)));
+		CHECK(store.UpdateWorld() == 6);
+		CHECK(glm::vec3(store.GetWorld(2)[3]) == glm::vec3(1.0f, 20.0f, 2.0f));
+		CHECK_NEAR(MaxWorldError(store), 0.0, 1e-4);
+	}
+
+	void PackChangedCopiesInOrder() {
+		std::mt19937 random(4);
+		TransformStore store;
+		BuildForest(store, 200, random);
+		store.UpdateWorld();
+		for (uint32_t i{ 0 }; i < 10; i++)
+		{
+			store.SetPosition(random() % 200, glm::vec3(static_cast<float>(i)));
+		}
+		const uint32_t changed = store.UpdateWorld();
+		CHECK(changed >= 1 && changed <= 200);
+		CHECK(store.GetChangedSize() == changed * sizeof(glm::mat4));
+
+		std::vector<glm::mat4> packed(changed + 1, glm::mat4(-1.0f));
+		store.PackChanged(packed.data());
+		uint32_t previous = 0;
+		for (uint32_t i{ 0 }; i < changed; i++)
+		{
+			const uint32_t node = store.GetChangedNodes()[i];
+			CHECK(i == 0 || node > previous);
+			CHECK(packed[i] == store.GetWorld(node));
+			previous = node;
+		}
+		// Nothing past the end
+		CHECK(packed[changed] == glm::mat4(-1.0f));
+		CHECK_NEAR(MaxWorldError(store), 0.0, 1e-4);
+	}
+
+	void ClearStartsOver() {
+		std::mt19937 random(5);
+		TransformStore store;
+		BuildForest(store, 100, random);
+		store.UpdateWorld();
+		store.Clear();
+		CHECK(store.GetCount() == 0);
+		CHECK(store.UpdateWorld() == 0);
+		BuildForest(store, 10, random);
+		CHECK(store.UpdateWorld() == 10);
+		CHECK_NEAR(MaxWorldError(store), 0.0, 1e-4);
+	}
+}
+
+int main() {
+	RUN_TEST(WorldMatchesGlm);
+	RUN_TEST(DirtyReachesEveryDescendant);
+	RUN_TEST(PackChangedCopiesInOrder);
+	RUN_TEST(ClearStartsOver);
+	return TestResult();
+}
@@ -0,0 +1,82 @@
+// Built twice, AsyncQueueBenchmarkMutex on spdlog's mutex queue and AsyncQueueBenchmarkRing with SPDLOG_USE_MPSC_QUEUE
+#include "Benchmark.h"
+#include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/sinks/base_sink.h>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Costs nothing, so the queue is all that's measured
+	class CountingSink : public spdlog::sinks::base_sink<spdlog::details::null_mutex> {
+		public:
+			std::atomic<size_t> count{ 0 };
+
+		protected:
+			void sink_it_(const spdlog::details::log_msg&) override { count++; }
+			void flush_() override {}
+	};
+}
+
+// Producer contention on a 1024 slot queue, 1 to 32 threads logging as fast as they can under each policy
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int messagesPerProducer = smoke ? 500 : 20000;
+	const int producerCounts[] = { 1, 2, 4, 8, 16, 32 };
+	const spdlog::async_overflow_policy policies[] = { spdlog::async_overflow_policy::block,
+		spdlog::async_overflow_policy::overrun_oldest, spdlog::async_overflow_policy::discard_new };
+	const char* policyNames[] = { "block", "overrun_oldest", "discard_new" };
+
+#ifdef SPDLOG_USE_MPSC_QUEUE
+	printf("mpsc_ring_queue\n");
+#else
+	printf("mpmc_blocking_queue\n");
+#endif
+	for (int p{ 0 }; p < 3; p++)
+	{
+		for (int producerCount : producerCounts)
+		{
+			std::shared_ptr<CountingSink> sink = std::make_shared<CountingSink>();
+			size_t overrun = 0;
+			size_t discarded = 0;
+			double elapsed = 0.0;
+			{
+				std::shared_ptr<spdlog::details::thread_pool> threadPool = std::make_shared<spdlog::details::thread_pool>(1024, 1);
+				std::shared_ptr<spdlog::async_logger> logger = std::make_shared<spdlog::async_logger>("bench", sink, threadPool, policies[p]);
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				std::vector<std::thread> producers;
+				for (int t{ 0 }; t < producerCount; t++)
+				{
+					producers.emplace_back([&logger, t, messagesPerProducer]() {
+						for (int i{ 0 }; i < messagesPerProducer; i++)
+						{
+							logger->info("message {} {}", t, i);
+						}
+					});
+				}
+				for (std::thread& producer : producers)
+				{
+					producer.join();
+				}
+				elapsed = MillisecondsSince(start);
+				logger.reset();
+				overrun = threadPool->overrun_counter();
+				discarded = threadPool->discard_counter();
+			}
+
+			const size_t total = static_cast<size_t>(producerCount) * messagesPerProducer;
+			printf("  %-14s %2d producers: %8.1f ns/msg, delivered %zu, overrun %zu, discarded %zu\n", policyNames[p],
+				producerCount, elapsed * 1e6 / total, sink->count.load(), overrun, discarded);
+			if (sink->count.load() + overrun + discarded != total)
+			{
+				printf("  lost messages\n");
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
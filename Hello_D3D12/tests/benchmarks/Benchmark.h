@@ -0,0 +1,33 @@
+#pragma once
+#include <chrono>
+#include <cstring>
+
+// --smoke shrinks a benchmark to a quick run that only checks it still works, which is how ctest runs them
+inline bool IsSmokeRun(int argc, char** argv) {
+	for (int i{ 1 }; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--smoke") == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+inline double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Fastest of runs calls in milliseconds, the least disturbed by everything else on the machine
+template<typename Function>
+double BestOf(int runs, Function&& function) {
+	double best = 0.0;
+	for (int run{ 0 }; run < runs; run++)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		function();
+		const double elapsed = MillisecondsSince(start);
+		best = run == 0 || elapsed < best ? elapsed : best;
+	}
+	return best;
+}
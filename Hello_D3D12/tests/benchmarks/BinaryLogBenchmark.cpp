@@ -0,0 +1,73 @@
+#include "Core/BinaryLog.h"
+#include "Benchmark.h"
+#include <spdlog/async.h>
+#include <spdlog/sinks/null_sink.h>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	void PrintPercentiles(const char* label, std::vector<std::vector<int64_t>>& perThread) {
+		std::vector<int64_t> all;
+		for (std::vector<int64_t>& latencies : perThread)
+		{
+			all.insert(all.end(), latencies.begin(), latencies.end());
+			latencies.clear();
+		}
+		std::sort(all.begin(), all.end());
+		printf("%-14s p50 %6lld ns  p99 %7lld ns\n", label, static_cast<long long>(all[all.size() / 2]),
+			static_cast<long long>(all[all.size() * 99 / 100]));
+	}
+
+	template<typename Function>
+	void Measure(int threadCount, int callsPerThread, std::vector<std::vector<int64_t>>& latencies, Function call) {
+		std::vector<std::thread> threads;
+		for (int t{ 0 }; t < threadCount; t++)
+		{
+			threads.emplace_back([&latencies, &call, t, callsPerThread]() {
+				latencies[t].reserve(callsPerThread);
+				for (int i{ 0 }; i < callsPerThread; i++)
+				{
+					const Clock::time_point start = Clock::now();
+					call(i);
+					latencies[t].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
+
+// Latency of one call with three arguments on the logging thread, binary records vs spdlog's async logger
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int threadCount = 4;
+	const int callsPerThread = smoke ? 1000 : 20000;
+	std::vector<std::vector<int64_t>> latencies(threadCount);
+
+	BinaryLog::Initialize(std::make_shared<spdlog::logger>("null", std::make_shared<spdlog::sinks::null_sink_mt>()), 1 << 20);
+	Measure(threadCount, callsPerThread, latencies, [](int i) {
+		LOG_BINARY_INFO("instance {} at {:.3f} in {}", i, i * 0.5, "scene");
+	});
+	BinaryLog::Shutdown();
+	PrintPercentiles("binary", latencies);
+
+	{
+		std::shared_ptr<spdlog::details::thread_pool> threadPool = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+		std::shared_ptr<spdlog::async_logger> logger = std::make_shared<spdlog::async_logger>("async",
+			std::make_shared<spdlog::sinks::null_sink_mt>(), threadPool, spdlog::async_overflow_policy::discard_new);
+		Measure(threadCount, callsPerThread, latencies, [&logger](int i) {
+			logger->info("[frame {}] instance {} at {:.3f} in {}", Log::GetFrame(), i, i * 0.5, "scene");
+		});
+	}
+	PrintPercentiles("spdlog async", latencies);
+	printf("binary records dropped %llu\n", static_cast<unsigned long long>(BinaryLog::GetDroppedCount()));
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include "Graphics/BlockCompression.h"
+#include "Core/JobSystem.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Encode MPix/s for every format and quality at each kernel level on the calling thread, the widest level on
+// 3 workers, and decode MPix/s
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t size = smoke ? 64 : 512;
+	const int runs = smoke ? 1 : 3;
+	const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 };
+	const char* formatNames[] = { "BC1", "BC3", "BC4", "BC5", "BC7" };
+	const BlockQuality qualities[] = { BlockQuality::Fast, BlockQuality::Normal, BlockQuality::High };
+	const char* qualityNames[] = { "Fast", "Normal", "High" };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+
+	// Smooth gradients with grain and a hard edge every 16 pixels, opaque
+	std::mt19937 random(3);
+	MipFootprint footprint;
+	footprint.width = size;
+	footprint.height = size;
+	footprint.rowPitch = size * 4;
+	std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4);
+	for (uint32_t y{ 0 }; y < size; y++)
+	{
+		for (uint32_t x{ 0 }; x < size; x++)
+		{
+			uint8_t* pixel = &pixels[(static_cast<size_t>(y) * size + x) * 4];
+			const uint32_t grain = random() % 8;
+			pixel[0] = static_cast<uint8_t>(x * 200 / size + grain);
+			pixel[1] = static_cast<uint8_t>(y * 200 / size + grain);
+			pixel[2] = static_cast<uint8_t>(x / 16 % 2 == 0 ? 40 : 220);
+			pixel[3] = 255;
+		}
+	}
+
+	JobSystem jobSystem;
+	jobSystem.Initialize(3);
+	const double megapixels = static_cast<double>(size) * size / 1e6;
+	uint32_t checksum = 0;
+	printf("%u x %u, MPix/s\n", size, size);
+	for (int f{ 0 }; f < 5; f++)
+	{
+		MipFootprint blockFootprint;
+		std::vector<uint8_t> blocks(ComputeBlockFootprints(formats[f], size, size, 1, &blockFootprint));
+		for (int q{ 0 }; q < 3; q++)
+		{
+			BlockEncodeDesc desc;
+			desc.format = formats[f];
+			desc.quality = qualities[q];
+			printf("  %s %-6s", formatNames[f], qualityNames[q]);
+			for (SimdLevel level : levels)
+			{
+				if (level > GetCpuSimdLevel())
+				{
+					break;
+				}
+				SetSimdLevel(level);
+				const double elapsed = BestOf(runs, [&]() {
+					CompressTexture(desc, pixels.data(), &footprint, blocks.data(), &blockFootprint, 1, nullptr);
+				});
+				checksum += blocks[blocks.size() / 2];
+				printf("  %s %7.2f", GetSimdLevelName(GetBlockCompressionKernelLevel()), megapixels * 1e3 / elapsed);
+			}
+			const double threaded = BestOf(runs, [&]() {
+				CompressTexture(desc, pixels.data(), &footprint, blocks.data(), &blockFootprint, 1, &jobSystem);
+			});
+			printf("  3 workers %7.2f\n", megapixels * 1e3 / threaded);
+		}
+
+		std::vector<uint8_t> decoded(pixels.size());
+		const double decode = BestOf(runs, [&]() { DecompressLevel(formats[f], blocks.data(), blockFootprint, decoded.data(), footprint); });
+		checksum += decoded[decoded.size() / 2];
+		printf("  %s decode %8.1f\n", formatNames[f], megapixels * 1e3 / decode);
+	}
+	jobSystem.Shutdown();
+	printf("checksum %u\n", checksum);
+	return 0;
+}
@@ -0,0 +1,86 @@
+#include "Graphics/DescriptorIndexAllocator.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// ns per allocate and free pair as more threads share the free list head. Each thread holds a few slots at a
+// time like a loader creating views would, so pops and pushes both contend. Deferred frees and BeginFrame
+// are timed on their own.
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t pairsPerThread = smoke ? 10000 : 1000000;
+	const int runs = smoke ? 1 : 5;
+	const uint32_t capacity = 65536;
+
+	std::vector<uint32_t> threadCounts = { 1, 2, 4 };
+	const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads > 4)
+	{
+		threadCounts.push_back(hardwareThreads);
+	}
+
+	uint64_t checksum = 0;
+	for (uint32_t threadCount : threadCounts)
+	{
+		DescriptorIndexAllocator allocator;
+		allocator.Initialize(capacity, 0, 1);
+		const double elapsed = BestOf(runs, [&]() {
+			std::vector<std::thread> threads;
+			for (uint32_t t{ 0 }; t < threadCount; t++)
+			{
+				threads.emplace_back([&]() {
+					uint32_t held[8];
+					for (uint32_t i{ 0 }; i < pairsPerThread; i += 8)
+					{
+						for (uint32_t& index : held)
+						{
+							index = allocator.AllocatePersistent();
+						}
+						for (uint32_t index : held)
+						{
+							allocator.FreePersistent(index);
+						}
+					}
+				});
+			}
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		});
+		const DescriptorAllocatorStats stats = allocator.GetStats();
+		printf("%2u threads: %8.3f ms, %6.1f ns a pair per thread, high water %u\n", threadCount, elapsed,
+			elapsed * 1e6 / pairsPerThread, stats.persistentHighWater);
+		checksum += stats.freeListLength + stats.persistentAllocated;
+	}
+
+	// A frame's worth of deferred frees and the BeginFrame that splices them back
+	DescriptorIndexAllocator allocator;
+	allocator.Initialize(capacity, 0, 2);
+	double deferred = 0.0;
+	double splice = 0.0;
+	for (int run{ 0 }; run < runs; run++)
+	{
+		for (uint32_t i{ 0 }; i < capacity; i++)
+		{
+			allocator.AllocatePersistent();
+		}
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (uint32_t i{ 0 }; i < capacity; i++)
+		{
+			allocator.FreePersistentDeferred(i);
+		}
+		const double freeTime = MillisecondsSince(start);
+		allocator.BeginFrame(1);
+		start = std::chrono::steady_clock::now();
+		allocator.BeginFrame(0);
+		const double spliceTime = MillisecondsSince(start);
+		deferred = run == 0 || freeTime < deferred ? freeTime : deferred;
+		splice = run == 0 || spliceTime < splice ? spliceTime : splice;
+	}
+	printf("%u deferred frees %8.3f ms, BeginFrame splicing them %8.3f ms\n", capacity, deferred, splice);
+	checksum += allocator.GetStats().freeListLength;
+	printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+	return 0;
+}
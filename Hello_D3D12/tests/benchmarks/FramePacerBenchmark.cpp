@@ -0,0 +1,38 @@
+#include "Core/FramePacer.h"
+#include "Benchmark.h"
+#include <cmath>
+#include <cstdio>
+
+// How close to the target the real clock gets, with a little busy work in each frame. What sleeps cost on this
+// machine shows up as the overshoot the pacer measured.
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const double rates[] = { 60.0, 144.0, 240.0 };
+	const int frames = smoke ? 5 : 240;
+
+	SteadyPacerClock clock;
+	for (double rate : rates)
+	{
+		FramePacer pacer;
+		pacer.Initialize(&clock, rate);
+		pacer.WaitForNextFrame();
+
+		double worst = 0.0;
+		for (int frame{ 0 }; frame < frames; frame++)
+		{
+			// About a millisecond of "work"
+			const int64_t workEnd = clock.Now() + 1000000;
+			while (clock.Now() < workEnd)
+			{
+			}
+			const double frameTime = pacer.WaitForNextFrame();
+			worst = std::fabs(frameTime - 1.0 / rate) > worst ? std::fabs(frameTime - 1.0 / rate) : worst;
+		}
+
+		const FramePacerStats& stats = pacer.GetStats();
+		printf("%5.0f Hz: mean %.4f ms (target %.4f), stddev %6.1f us, worst %6.1f us off, overshoot %6.1f us, missed %llu\n",
+			rate, stats.meanFrameTime * 1e3, 1e3 / rate, std::sqrt(stats.frameTimeVariance) * 1e6, worst * 1e6,
+			stats.sleepOvershoot * 1e6, static_cast<unsigned long long>(stats.missedFrames));
+	}
+	return 0;
+}
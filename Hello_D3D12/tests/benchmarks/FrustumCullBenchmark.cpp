@@ -0,0 +1,71 @@
+#include "Graphics/InstanceCuller.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+// 1M spheres through the scalar reference, each kernel level the CPU has, and InstanceCuller on the job system.
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t count = smoke ? 10000 : 1000000;
+	const int runs = smoke ? 1 : 20;
+
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> position(-1.5f, 1.5f);
+	std::uniform_real_distribution<float> scale(0.0f, 0.1f);
+	InstanceSet instances;
+	instances.Reserve(count);
+	for (uint32_t i{ 0 }; i < count; i++)
+	{
+		const float x = position(random);
+		const float y = position(random);
+		const float z = position(random) * 0.5f + 0.5f;
+		instances.Add(x, y, z, scale(random), 0.0f, 0.0f);
+	}
+
+	const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	const Frustum frustum = MakeFrustum(identity);
+	const float* x = instances.GetPlane(InstanceSet::InstancePlanePositionX);
+	const float* y = instances.GetPlane(InstanceSet::InstancePlanePositionY);
+	const float* z = instances.GetPlane(InstanceSet::InstancePlanePositionZ);
+	const float* radius = instances.GetPlane(InstanceSet::InstancePlaneScale);
+	std::vector<uint32_t> visible(count + CullOutputPadding);
+
+	uint32_t visibleCount = 0;
+	const double scalar = BestOf(runs, [&]() { visibleCount = CullSpheresScalar(frustum, x, y, z, radius, 3.0f, 0, count, visible.data()); });
+	printf("%u spheres, %u visible\n", count, visibleCount);
+	printf("  Scalar        %8.3f ms\n", scalar);
+	for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2 })
+	{
+		if (level > GetCpuSimdLevel())
+		{
+			break;
+		}
+		SetSimdLevel(level);
+		const double simd = BestOf(runs, [&]() { visibleCount = CullSpheres(frustum, x, y, z, radius, 3.0f, 0, count, visible.data()); });
+		printf("  %-13s %8.3f ms\n", GetSimdLevelName(GetCullKernelLevel()), simd);
+	}
+	SetSimdLevel(SimdLevel::AVX512);
+
+	// Up to one worker per extra core, like Application sets it up
+	std::vector<uint32_t> workerCounts = { 0, 1, 3 };
+	const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads > 4)
+	{
+		workerCounts.push_back(hardwareThreads - 1);
+	}
+	for (uint32_t workers : workerCounts)
+	{
+		JobSystem jobSystem;
+		jobSystem.Initialize(workers);
+		InstanceCuller culler;
+		culler.Initialize(&jobSystem);
+		std::vector<uint32_t> culled;
+		const double threaded = BestOf(runs, [&]() { culler.Cull(instances, frustum, 3.0f, culled); });
+		printf("  Culler, %2u workers %8.3f ms (%zu visible)\n", workers, threaded, culled.size());
+		culler.Shutdown();
+		jobSystem.Shutdown();
+	}
+	return 0;
+}
@@ -0,0 +1,44 @@
+#include "Graphics/InstanceSet.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <vector>
+
+// What Update does to the instances every frame: Animate, then Pack into upload memory
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t counts[] = { 32768, 100000, 1000000 };
+	const int frames = smoke ? 2 : 200;
+
+	for (uint32_t count : counts)
+	{
+		if (smoke && count > 32768)
+		{
+			break;
+		}
+
+		InstanceSet instances;
+		instances.Reserve(count);
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			instances.Add((i % 1000) * 0.002f - 1.0f, (i / 1000 % 1000) * 0.002f - 1.0f, 0.0f, 0.02f, 0.005f, 0.003f);
+		}
+		std::vector<float> upload(static_cast<size_t>(instances.GetPackedSize() / sizeof(float)));
+
+		const double animate = BestOf(3, [&]() {
+			for (int frame{ 0 }; frame < frames; frame++)
+			{
+				instances.Animate(1.25f);
+			}
+		}) / frames;
+		const double pack = BestOf(3, [&]() {
+			for (int frame{ 0 }; frame < frames; frame++)
+			{
+				instances.Pack(upload.data());
+			}
+		}) / frames;
+
+		printf("%8u instances: Animate %.3f ms, Pack %.3f ms (%.1f MB), checksum %g\n", count, animate, pack,
+			instances.GetPackedSize() / (1024.0 * 1024.0), upload[count / 2]);
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+#include "Core/JobSystem.h"
+#include "Benchmark.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// What a job costs: empty jobs run and waited on, ParallelFor at a few batch sizes over a cheap loop, and jobs
+// that wait on jobs of their own
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t jobCount = smoke ? 1000 : 100000;
+	const uint32_t rangeSize = smoke ? 1 << 16 : 1 << 22;
+	const int runs = smoke ? 1 : 5;
+
+	std::vector<uint32_t> workerCounts = { 0, 1, 3 };
+	const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads > 4)
+	{
+		workerCounts.push_back(hardwareThreads - 1);
+	}
+
+	for (uint32_t workers : workerCounts)
+	{
+		JobSystem jobSystem;
+		jobSystem.Initialize(workers);
+		printf("%u workers\n", workers);
+
+		std::atomic<uint32_t> ran(0);
+		const double empty = BestOf(runs, [&]() {
+			JobCounter counter;
+			for (uint32_t i{ 0 }; i < jobCount; i++)
+			{
+				jobSystem.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+			}
+			jobSystem.Wait(counter);
+		});
+		printf("  %u empty jobs       %8.3f ms, %6.0f ns a job\n", jobCount, empty, empty * 1e6 / jobCount);
+
+		const uint32_t batchSizes[] = { 256, 4096, 65536 };
+		for (uint32_t batchSize : batchSizes)
+		{
+			std::atomic<uint64_t> sum(0);
+			const double parallelFor = BestOf(runs, [&]() {
+				JobCounter counter;
+				jobSystem.ParallelFor(rangeSize, batchSize, [&sum](uint32_t begin, uint32_t end) {
+					uint64_t batchSum = 0;
+					for (uint32_t i{ begin }; i < end; i++)
+					{
+						batchSum += static_cast<uint64_t>(i) * i % 7;
+					}
+					sum.fetch_add(batchSum, std::memory_order_relaxed);
+				}, &counter);
+				jobSystem.Wait(counter);
+			});
+			printf("  ParallelFor %u, batches of %-5u %8.3f ms (sum %llu)\n", rangeSize, batchSize, parallelFor,
+				static_cast<unsigned long long>(sum.load()));
+		}
+
+		const double nested = BestOf(runs, [&]() {
+			JobCounter outer;
+			for (uint32_t i{ 0 }; i < jobCount / 64; i++)
+			{
+				jobSystem.Run([&]() {
+					JobCounter inner;
+					for (int k{ 0 }; k < 63; k++)
+					{
+						jobSystem.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &inner);
+					}
+					jobSystem.Wait(inner);
+				}, &outer);
+			}
+			jobSystem.Wait(outer);
+		});
+		printf("  %u nested jobs      %8.3f ms\n", jobCount / 64 * 64, nested);
+
+		const JobSystemStats stats = jobSystem.GetStats();
+		printf("  executed %llu, stolen %llu, ran inline %llu\n", static_cast<unsigned long long>(stats.executed),
+			static_cast<unsigned long long>(stats.stolen), static_cast<unsigned long long>(stats.ranInline));
+		jobSystem.Shutdown();
+	}
+	return 0;
+}
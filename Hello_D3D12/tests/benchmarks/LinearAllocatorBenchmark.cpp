@@ -0,0 +1,63 @@
+#include "Graphics/LinearAllocator.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct ObjectConstants
+	{
+		float world[16];
+		float color[4];
+	};
+}
+
+// ns per AllocateConstants, one thread filling a frame and several threads recording into the same one, where the
+// CAS on the offset is all they share
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t perFrame = smoke ? 10000 : 200000;
+	const int frames = smoke ? 2 : 20;
+	const int runs = smoke ? 1 : 5;
+	const uint32_t framesInFlight = 3;
+	const uint64_t capacityPerFrame = static_cast<uint64_t>(perFrame) * FrameUploadAllocator::ConstantBufferAlignment;
+
+	std::vector<uint8_t> memory(capacityPerFrame * framesInFlight);
+	uint64_t checksum = 0;
+	for (uint32_t threadCount : { 1u, 2u, 4u })
+	{
+		FrameUploadAllocator allocator;
+		allocator.Initialize(memory.data(), 0x10000000, capacityPerFrame, framesInFlight);
+		const double elapsed = BestOf(runs, [&]() {
+			for (int frame{ 0 }; frame < frames; frame++)
+			{
+				allocator.BeginFrame(frame % framesInFlight);
+				std::vector<std::thread> threads;
+				for (uint32_t t{ 0 }; t < threadCount; t++)
+				{
+					threads.emplace_back([&, t]() {
+						ObjectConstants constants = {};
+						LinearAllocation allocation;
+						for (uint32_t i{ t }; i < perFrame; i += threadCount)
+						{
+							constants.world[0] = static_cast<float>(i);
+							allocator.AllocateConstants(constants, allocation);
+						}
+					});
+				}
+				for (std::thread& thread : threads)
+				{
+					thread.join();
+				}
+			}
+		});
+		const double allocations = static_cast<double>(perFrame) * frames;
+		printf("%u threads: %8.3f ms, %6.1f ns an allocation, peak %llu KB, %llu failed\n", threadCount, elapsed,
+			elapsed * 1e6 / allocations, static_cast<unsigned long long>(allocator.GetPeakUsed() / 1024),
+			static_cast<unsigned long long>(allocator.GetFailedAllocations()));
+		checksum += allocator.GetUsed() + allocator.GetFailedAllocations();
+	}
+	printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+	return 0;
+}
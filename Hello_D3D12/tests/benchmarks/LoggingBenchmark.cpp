@@ -0,0 +1,69 @@
+#include "Benchmark.h"
+#include <spdlog/async.h>
+#include <spdlog/sinks/basic_file_sink.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Per call latency of a frame tagged message from 1 and 4 threads, synchronous file logging against the async
+// logger blocking or dropping on a full queue. The file goes next to the executable.
+namespace
+{
+	void Measure(const char* label, spdlog::logger* logger, int threadCount, int messagesPerThread) {
+		std::vector<std::vector<int64_t>> latencies(threadCount);
+		std::vector<std::thread> threads;
+		for (int t{ 0 }; t < threadCount; t++)
+		{
+			threads.emplace_back([&, t]() {
+				std::vector<int64_t>& latency = latencies[t];
+				latency.reserve(messagesPerThread);
+				for (int i{ 0 }; i < messagesPerThread; i++)
+				{
+					const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					logger->info("[frame {}] instance {} at {:.3f}", 42, i, i * 0.5);
+					latency.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		std::vector<int64_t> all;
+		for (const std::vector<int64_t>& latency : latencies)
+		{
+			all.insert(all.end(), latency.begin(), latency.end());
+		}
+		std::sort(all.begin(), all.end());
+		printf("  %-20s %d thread(s): p50 %7lld ns, p99 %8lld ns, max %9lld ns\n", label, threadCount,
+			static_cast<long long>(all[all.size() / 2]), static_cast<long long>(all[all.size() * 99 / 100]),
+			static_cast<long long>(all.back()));
+	}
+}
+
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int messagesPerThread = smoke ? 1000 : 100000;
+
+	std::shared_ptr<spdlog::logger> sync = spdlog::basic_logger_mt("sync", "LoggingBenchmark_sync.log", true);
+	std::shared_ptr<spdlog::details::thread_pool> threadPool = std::make_shared<spdlog::details::thread_pool>(8192, 1);
+	spdlog::sink_ptr fileSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>("LoggingBenchmark_async.log", true);
+	std::shared_ptr<spdlog::logger> block = std::make_shared<spdlog::async_logger>("block", fileSink, threadPool,
+		spdlog::async_overflow_policy::block);
+	std::shared_ptr<spdlog::logger> discard = std::make_shared<spdlog::async_logger>("discard_new", fileSink, threadPool,
+		spdlog::async_overflow_policy::discard_new);
+
+	const int threadCounts[] = { 1, 4 };
+	for (int threadCount : threadCounts)
+	{
+		Measure("sync file", sync.get(), threadCount, messagesPerThread);
+		Measure("async block", block.get(), threadCount, messagesPerThread);
+		Measure("async discard_new", discard.get(), threadCount, messagesPerThread);
+	}
+	printf("  %zu discarded\n", threadPool->discard_counter());
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include "Graphics/MipChain.h"
+#include "Core/JobSystem.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <vector>
+
+// ms for a whole square chain per format and filter, each kernel level on the calling thread, then the widest on 3 workers
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int runs = smoke ? 1 : 5;
+	const std::vector<uint32_t> sizes = smoke ? std::vector<uint32_t>{ 256 } : std::vector<uint32_t>{ 256, 2048 };
+	const MipFormat formats[] = { MipFormat::RGBA8, MipFormat::RGBA16F, MipFormat::RGBA32F };
+	const char* formatNames[] = { "RGBA8 sRGB", "RGBA16F", "RGBA32F" };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+
+	JobSystem jobSystem;
+	jobSystem.Initialize(3);
+	uint32_t checksum = 0;
+	for (int f{ 0 }; f < 3; f++)
+	{
+		for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+		{
+			for (uint32_t size : sizes)
+			{
+				MipChainDesc desc;
+				desc.format = formats[f];
+				desc.filter = filter;
+				desc.srgb = formats[f] == MipFormat::RGBA8;
+				const uint32_t levelCount = GetMipLevelCount(size, size);
+				std::vector<MipFootprint> footprints(levelCount);
+				std::vector<uint8_t> data(ComputeMipFootprints(desc.format, size, size, levelCount, footprints.data()));
+				// Small values that are fine as bytes, halves (positive normals) and floats (tiny positives)
+				for (uint64_t i{ 0 }; i < footprints[1].offset; i++)
+				{
+					data[i] = static_cast<uint8_t>((i * 2654435761u) >> 24) & 0x3F;
+				}
+
+				printf("%-10s %-6s %4u", formatNames[f], filter == MipFilter::Box ? "box" : "kaiser", size);
+				double widest = 0.0;
+				for (SimdLevel level : levels)
+				{
+					if (level > GetCpuSimdLevel())
+					{
+						break;
+					}
+					SetSimdLevel(level);
+					widest = BestOf(runs, [&]() { GenerateMipChain(desc, data.data(), footprints.data(), levelCount, nullptr); });
+					checksum += data[footprints[levelCount - 1].offset];
+					printf("  %s %7.2f ms", GetSimdLevelName(GetMipChainKernelLevel()), widest);
+				}
+				const double threaded = BestOf(runs, [&]() { GenerateMipChain(desc, data.data(), footprints.data(), levelCount, &jobSystem); });
+				printf("  3 workers %7.2f ms  %6.0f MPix/s\n", threaded, static_cast<double>(size) * size / 1e3 / widest);
+			}
+		}
+	}
+	SetSimdLevel(SimdLevel::AVX512);
+	jobSystem.Shutdown();
+	printf("checksum %u\n", checksum);
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include "Graphics/HeadlessCommandBackend.h"
+#include "Graphics/ParallelCommandRecorder.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+// Record and Submit on the headless backend, so what's timed is the recorder's own overhead (jobs, allocator
+// pools, ordered submit) plus a cheap per command cost, at a few list counts and worker counts
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t commandsPerFrame = smoke ? 4096 : 1 << 18;
+	const int frames = smoke ? 3 : 30;
+	const int runs = smoke ? 1 : 3;
+	const uint32_t framesInFlight = 3;
+
+	std::vector<uint32_t> workerCounts = { 0, 1, 3 };
+	const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	if (hardwareThreads > 4)
+	{
+		workerCounts.push_back(hardwareThreads - 1);
+	}
+
+	uint64_t checksum = 0;
+	for (uint32_t workers : workerCounts)
+	{
+		JobSystem jobSystem;
+		jobSystem.Initialize(workers);
+		printf("%u workers\n", workers);
+		for (uint32_t listCount : { 1u, 8u, 64u })
+		{
+			const uint32_t perList = commandsPerFrame / listCount;
+			HeadlessCommandBackend backend;
+			ParallelCommandRecorder<HeadlessCommandBackend> recorder;
+			recorder.Initialize(&backend, &jobSystem);
+			const ParallelCommandRecorder<HeadlessCommandBackend>::RecordFunction record = [perList](uint32_t listIndex, HeadlessCommandList*& list) {
+				uint64_t state = listIndex;
+				for (uint32_t i{ 0 }; i < perList; i++)
+				{
+					state = state * 6364136223846793005ull + 1442695040888963407ull;
+					list->Record(listIndex, state >> 33);
+				}
+			};
+
+			uint64_t fence = 0;
+			const double elapsed = BestOf(runs, [&]() {
+				for (int frame{ 0 }; frame < frames; frame++)
+				{
+					fence++;
+					backend.ClearExecutedCommands();
+					recorder.Record(listCount, fence > framesInFlight ? fence - framesInFlight : 0, record);
+					recorder.Submit();
+					recorder.Retire(fence);
+				}
+			});
+			const double commands = static_cast<double>(perList) * listCount * frames;
+			printf("  %2u lists: %8.3f ms a frame, %5.1f ns a command, %u allocators\n", listCount, elapsed / frames,
+				elapsed * 1e6 / commands, recorder.GetStats().allocatorCount);
+			checksum += backend.GetExecutedCommands().size() + backend.GetExecutedCommands().back().payload;
+			recorder.Shutdown();
+		}
+		jobSystem.Shutdown();
+	}
+	printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+	return 0;
+}
@@ -0,0 +1,57 @@
+#include "Graphics/ProceduralTexture.h"
+#include "Core/JobSystem.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <vector>
+
+// ms per square texture for each pattern and row kernel level on the calling thread, then the checker on 3 workers
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int runs = smoke ? 1 : 5;
+	const std::vector<uint32_t> sizes = smoke ? std::vector<uint32_t>{ 256 } : std::vector<uint32_t>{ 256, 1024, 4096 };
+	const ProceduralPattern patterns[] = { ProceduralPattern::Checker, ProceduralPattern::Gradient, ProceduralPattern::Noise };
+	const char* patternNames[] = { "checker", "gradient", "noise" };
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+
+	JobSystem jobSystem;
+	jobSystem.Initialize(3);
+	uint32_t checksum = 0;
+	for (uint32_t size : sizes)
+	{
+		std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4);
+		ProceduralTextureTarget target;
+		target.data = pixels.data();
+		target.rowPitch = size * 4;
+		target.width = size;
+		target.height = size;
+
+		printf("%u x %u\n", size, size);
+		for (int p{ 0 }; p < 3; p++)
+		{
+			ProceduralTextureDesc desc;
+			desc.pattern = patterns[p];
+			printf("  %-9s", patternNames[p]);
+			for (SimdLevel level : levels)
+			{
+				if (level > GetCpuSimdLevel())
+				{
+					break;
+				}
+				SetSimdLevel(level);
+				const double elapsed = BestOf(runs, [&]() { GenerateProceduralTexture(desc, target, nullptr); });
+				checksum += pixels[pixels.size() / 2];
+				printf("  %s %8.3f ms", GetSimdLevelName(GetProceduralTextureLevel()), elapsed);
+			}
+			printf("\n");
+		}
+
+		SetSimdLevel(SimdLevel::AVX512);
+		ProceduralTextureDesc desc;
+		const double threaded = BestOf(runs, [&]() { GenerateProceduralTexture(desc, target, &jobSystem); });
+		checksum += pixels[pixels.size() / 2];
+		printf("  checker, %s, 3 workers %8.3f ms\n", GetSimdLevelName(GetProceduralTextureLevel()), threaded);
+	}
+	jobSystem.Shutdown();
+	printf("checksum %u\n", checksum);
+	return 0;
+}
@@ -0,0 +1,113 @@
+#include "Graphics/RenderGraph.h"
+#include "Benchmark.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const uint64_t KB = 1024;
+	const uint32_t RenderTarget = 0x4;
+	const uint32_t PixelShaderResource = 0x80;
+
+	// A long post processing style chain: every pass writes a new target of a few hundred KB to a few MB, reads
+	// the last couple and now and then one from far back (history, bloom mips), so lifetimes range from one pass
+	// to most of the frame. With imported set nothing is transient and Compile skips the placement entirely.
+	void BuildGraph(RenderGraph& graph, uint32_t passCount, bool imported) {
+		std::mt19937 random(42);
+		graph.Reset();
+		const uint32_t backBuffer = graph.ImportResource("BackBuffer", 0);
+		std::vector<uint32_t> targets;
+		for (uint32_t passIndex{ 0 }; passIndex < passCount; passIndex++)
+		{
+			const uint32_t pass = graph.AddPass("Pass");
+			for (uint32_t back{ 1 }; back <= 2 && back <= targets.size(); back++)
+			{
+				graph.Read(pass, targets[targets.size() - back], PixelShaderResource);
+			}
+			if (random() % 16 == 0 && !targets.empty())
+			{
+				graph.Read(pass, targets[random() % targets.size()], PixelShaderResource);
+			}
+
+			RenderGraphResourceDesc desc;
+			desc.size = (4 + random() % 60) * 64 * KB;
+			desc.alignment = 64 * KB;
+			targets.push_back(imported ? graph.ImportResource("Target") : graph.CreateTransient("Target", desc));
+			graph.Write(pass, targets.back(), RenderTarget);
+		}
+		const uint32_t present = graph.AddPass("Present");
+		graph.Read(present, targets.back(), PixelShaderResource);
+		graph.Write(present, backBuffer, RenderTarget);
+	}
+
+	// Fastest Compile of a freshly built graph, building it isn't timed
+	double TimeCompile(RenderGraph& graph, uint32_t passCount, bool imported, int runs) {
+		double best = 0.0;
+		for (int run{ 0 }; run < runs; run++)
+		{
+			BuildGraph(graph, passCount, imported);
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			graph.Compile();
+			const double elapsed = MillisecondsSince(start);
+			best = run == 0 || elapsed < best ? elapsed : best;
+		}
+		return best;
+	}
+}
+
+// Compile on graphs of 1000+ passes, with and without transients. The difference is the first fit placement,
+// which checks every transient against all the ones placed before it, so doubling the passes should roughly
+// quadruple it while the rest of Compile only doubles.
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int runs = smoke ? 1 : 5;
+	std::vector<uint32_t> passCounts = { 1000 };
+	if (!smoke)
+	{
+		passCounts.push_back(2000);
+		passCounts.push_back(4000);
+		passCounts.push_back(8000);
+	}
+
+	uint64_t checksum = 0;
+	double previousPlacement = 0.0;
+	RenderGraph graph;
+	for (const uint32_t passCount : passCounts)
+	{
+		const double withoutTransients = TimeCompile(graph, passCount, true, runs);
+		const double compile = TimeCompile(graph, passCount, false, runs);
+		const RenderGraphStats stats = graph.GetStats();
+
+		ResourceStateTracker tracker(PixelShaderResource);
+		std::vector<uint32_t> handles(graph.GetResourceCount(), ResourceStateTracker::InvalidResource);
+		for (uint32_t resource{ 0 }; resource < graph.GetResourceCount(); resource++)
+		{
+			if (graph.IsImported(resource) || graph.IsTransientUsed(resource))
+			{
+				handles[resource] = tracker.RegisterResource(1, graph.IsImported(resource) ? 0 : graph.GetFirstState(resource));
+			}
+		}
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		graph.PlanBarriers(tracker, handles);
+		const double barriers = MillisecondsSince(start);
+
+		const double placement = compile - withoutTransients;
+		printf("%5u passes: compile %8.3f ms (%7.3f ms without transients, placement ~%7.3f ms", passCount, compile,
+			withoutTransients, placement);
+		if (previousPlacement > 0.0)
+		{
+			printf(", x%.1f", placement / previousPlacement);
+		}
+		printf("), barriers %7.3f ms\n", barriers);
+		printf("              %u transients in %llu KB instead of %llu KB, %u transitions (%u split)\n",
+			stats.transientCount, static_cast<unsigned long long>(stats.transientHeapSize / KB),
+			static_cast<unsigned long long>(stats.transientUnaliasedSize / KB), graph.GetStats().transitionCount,
+			graph.GetStats().splitTransitionCount);
+		previousPlacement = placement;
+		checksum += stats.transientHeapSize + graph.GetStats().transitionCount;
+	}
+	printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+	return 0;
+}
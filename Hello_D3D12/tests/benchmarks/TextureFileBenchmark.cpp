@@ -0,0 +1,121 @@
+#include "Graphics/TextureFile.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const char* const BenchmarkFile = "TextureFileBenchmark.dds";
+
+	template<typename T>
+	void Append(std::vector<uint8_t>& bytes, T value) {
+		const size_t offset = bytes.size();
+		bytes.resize(offset + sizeof(T));
+		memcpy(&bytes[offset], &value, sizeof(T));
+	}
+
+	// BC7 with the DX10 header and a full chain per slice, texel bytes that don't compress or repeat
+	void WriteBc7Dds(uint32_t size, uint32_t mips, uint32_t slices) {
+		std::vector<uint8_t> bytes;
+		Append<uint32_t>(bytes, 0x20534444);
+		uint32_t header[31] = {};
+		header[0] = 124;
+		header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;
+		header[2] = size;
+		header[3] = size;
+		header[6] = mips;
+		header[18] = 32;
+		header[19] = 0x4;
+		header[20] = 0x30315844;
+		header[26] = 0x1000 | 0x400000 | 0x8;
+		for (uint32_t value : header)
+		{
+			Append(bytes, value);
+		}
+		const uint32_t dx10[] = { 98, 3, 0, slices, 0 };
+		for (uint32_t value : dx10)
+		{
+			Append(bytes, value);
+		}
+		FILE* file = fopen(BenchmarkFile, "wb");
+		fwrite(bytes.data(), 1, bytes.size(), file);
+		std::vector<uint8_t> level;
+		uint32_t state = 1;
+		for (uint32_t slice{ 0 }; slice < slices; slice++)
+		{
+			for (uint32_t mip{ 0 }; mip < mips; mip++)
+			{
+				const uint32_t blocks = (size >> mip) / 4 > 0 ? (size >> mip) / 4 : 1;
+				level.resize(static_cast<size_t>(blocks) * blocks * 16);
+				for (uint8_t& byte : level)
+				{
+					state = state * 1664525u + 1013904223u;
+					byte = static_cast<uint8_t>(state >> 24);
+				}
+				fwrite(level.data(), 1, level.size(), file);
+			}
+		}
+		fclose(file);
+	}
+
+	std::vector<uint8_t> ReadWholeFile() {
+		std::vector<uint8_t> bytes;
+		FILE* file = fopen(BenchmarkFile, "rb");
+		fseek(file, 0, SEEK_END);
+		bytes.resize(static_cast<size_t>(ftell(file)));
+		fseek(file, 0, SEEK_SET);
+		fread(bytes.data(), 1, bytes.size(), file);
+		fclose(file);
+		return bytes;
+	}
+
+	// Every subresource into one staging buffer, rows at D3D12's 256 byte pitch and subresources 512 aligned,
+	// the way UploadTexture lays them out
+	uint64_t CopyToStaging(const TextureFile& texture, std::vector<uint8_t>& staging) {
+		uint64_t offset = 0;
+		uint64_t bytes = 0;
+		for (uint32_t index{ 0 }; index < texture.GetSubresourceCount(); index++)
+		{
+			const TextureFileSubresource& subresource = texture.GetSubresource(index);
+			const uint64_t pitch = (subresource.rowSize + 255ull) & ~255ull;
+			offset = (offset + 511) & ~511ull;
+			texture.CopySubresource(index, staging.data() + offset, pitch);
+			offset += pitch * subresource.rowCount;
+			bytes += static_cast<uint64_t>(subresource.rowSize) * subresource.rowCount;
+		}
+		return bytes;
+	}
+}
+
+// MB/s from file to staging memory: mapped and copied straight over, against reading the file into a vector
+// first and copying from that. Best of the runs, so mostly with the file in the page cache.
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int runs = smoke ? 1 : 5;
+	const uint32_t size = smoke ? 256 : 4096;
+	const uint32_t mips = smoke ? 7 : 13;
+	const uint32_t slices = 4;
+	WriteBc7Dds(size, mips, slices);
+
+	std::vector<uint8_t> staging(static_cast<size_t>(size) * size * 2 * slices);
+	uint64_t bytes = 0;
+	const double mapped = BestOf(runs, [&]() {
+		TextureFile texture;
+		texture.Open(BenchmarkFile);
+		bytes = CopyToStaging(texture, staging);
+	});
+	const double readCopy = BestOf(runs, [&]() {
+		const std::vector<uint8_t> file = ReadWholeFile();
+		TextureFile texture;
+		texture.Load(file.data(), file.size());
+		CopyToStaging(texture, staging);
+	});
+
+	printf("BC7 %u x %u, %u mips, %u slices, %.1f MB\n", size, size, mips, slices, bytes / 1e6);
+	printf("  mapped      %8.2f ms  %6.0f MB/s\n", mapped, bytes / 1e3 / mapped);
+	printf("  read + copy %8.2f ms  %6.0f MB/s\n", readCopy, bytes / 1e3 / readCopy);
+	remove(BenchmarkFile);
+	printf("checksum %u\n", static_cast<uint32_t>(staging[staging.size() / 3] + bytes));
+	return bytes > 0 ? 0 : 1;
+}
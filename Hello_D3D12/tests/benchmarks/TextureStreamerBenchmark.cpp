@@ -0,0 +1,76 @@
+#include "Graphics/TextureStreamer.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// us per Update with a camera sweeping over the textures, loads inline and doing nothing so only the
+// bookkeeping is timed: the feedback pass, LRU moves, request sort and evictions under a tight budget
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const int frames = smoke ? 20 : 500;
+	const std::vector<uint32_t> counts = smoke ? std::vector<uint32_t>{ 1000 } : std::vector<uint32_t>{ 1000, 10000, 100000 };
+
+	uint64_t checksum = 0;
+	for (uint32_t count : counts)
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> place(0.0f, 100.0f);
+		std::vector<float> x(count);
+		std::vector<float> y(count);
+		std::vector<uint32_t> ids(count);
+		TextureStreamer streamer;
+		// About a tenth of what every texture at mip 0 would take
+		streamer.Initialize(nullptr, [](uint32_t, uint32_t) { return true; }, static_cast<uint64_t>(count) * 200000, 64);
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			const uint32_t size = 256u << (random() % 4);
+			std::vector<uint64_t> mipSizes;
+			for (uint32_t width{ size }; width > 0; width >>= 1)
+			{
+				mipSizes.push_back(static_cast<uint64_t>((width + 3) / 4) * ((width + 3) / 4) * 16);
+			}
+			uint32_t tail = 0;
+			while (tail + 1 < mipSizes.size() && mipSizes[tail] > 65536)
+			{
+				tail++;
+			}
+			ids[i] = streamer.Register(static_cast<uint32_t>(mipSizes.size()), mipSizes.data(), tail);
+			x[i] = place(random);
+			y[i] = place(random);
+		}
+
+		std::vector<uint32_t> feedback(count);
+		std::vector<TextureStreamEvent> events;
+		double updateTime = 0.0;
+		double worst = 0.0;
+		for (int frame{ 0 }; frame < frames; frame++)
+		{
+			const float cameraX = 50.0f + 35.0f * std::cos(frame * 0.01f);
+			const float cameraY = 50.0f + 35.0f * std::sin(frame * 0.013f);
+			for (uint32_t i{ 0 }; i < count; i++)
+			{
+				const float distance = std::hypot(x[i] - cameraX, y[i] - cameraY);
+				feedback[ids[i]] = distance > 20.0f ? TextureStreamer::NotRequested :
+					static_cast<uint32_t>(std::max(0.0f, std::log2(distance + 1.0f) - 1.0f));
+			}
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			streamer.Update(feedback.data(), count, events);
+			const double elapsed = MillisecondsSince(start);
+			updateTime += elapsed;
+			worst = elapsed > worst ? elapsed : worst;
+			checksum += events.size();
+		}
+
+		const TextureStreamerStats& stats = streamer.GetStats();
+		printf("%6u textures: %8.1f us per Update, worst %8.1f us, %llu loads, %llu evictions, %llu stalls\n", count,
+			updateTime * 1e3 / frames, worst * 1e3, static_cast<unsigned long long>(stats.loadsIssued),
+			static_cast<unsigned long long>(stats.evictions), static_cast<unsigned long long>(stats.budgetStalls));
+		checksum += stats.residentSize;
+	}
+	printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+	return 0;
+}
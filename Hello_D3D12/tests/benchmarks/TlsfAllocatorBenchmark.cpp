@@ -0,0 +1,180 @@
+#include "Graphics/TlsfAllocator.h"
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const uint64_t KB = 1024;
+	const uint64_t MB = 1024 * KB;
+
+	struct TraceEvent
+	{
+		bool allocate;
+		uint32_t slot;			// Which live allocation a free hands back
+		uint64_t size;
+		uint64_t alignment;
+	};
+
+	// A heap block's life as resources come and go: buffers of a few KB to a few MB on 64 KB placement
+	// alignment with the odd 4 MB aligned texture (MSAA), held near a target fill with a random one freed each
+	// time it's over
+	std::vector<TraceEvent> MakeTrace(uint64_t heapSize, double targetFill, uint32_t eventCount, uint32_t seed) {
+		std::mt19937 random(seed);
+		std::vector<TraceEvent> trace;
+		std::vector<uint64_t> liveSizes;
+		uint64_t used = 0;
+		while (trace.size() < eventCount)
+		{
+			TraceEvent event = {};
+			event.allocate = liveSizes.empty() || used < heapSize * targetFill || random() % 4 == 0;
+			if (event.allocate)
+			{
+				event.size = (4 * KB << (random() % 11)) + (random() % 16) * 256;
+				event.alignment = random() % 16 == 0 ? 4 * MB : 64 * KB;
+				event.slot = static_cast<uint32_t>(liveSizes.size());
+				liveSizes.push_back(event.size);
+				used += event.size;
+			}
+			else
+			{
+				event.slot = static_cast<uint32_t>(random() % liveSizes.size());
+				used -= liveSizes[event.slot];
+				liveSizes[event.slot] = liveSizes.back();
+				liveSizes.pop_back();
+			}
+			trace.push_back(event);
+		}
+		return trace;
+	}
+
+	struct TraceResult
+	{
+		double allocateNs = 0.0;
+		double freeNs = 0.0;
+		double allocateP99Ns = 0.0;		// The worst is whatever the scheduler did, the 99th percentile is the allocator
+		uint32_t failed = 0;
+		float fragmentation = 0.0f;		// Averaged over the samples
+		float worstFragmentation = 0.0f;
+		double fill = 0.0;
+	};
+
+	// Replays the trace timing each call. A failed allocation stays in the live list as empty so the slots of
+	// later frees still line up.
+	TraceResult Replay(const std::vector<TraceEvent>& trace, uint64_t heapSize) {
+		TlsfAllocator allocator(heapSize);
+		std::vector<TlsfAllocation> live;
+		std::vector<bool> placed;
+		std::vector<double> allocateTimes;
+		TraceResult result;
+		uint32_t frees = 0;
+		uint32_t samples = 0;
+		for (size_t i{ 0 }; i < trace.size(); i++)
+		{
+			const TraceEvent& event = trace[i];
+			if (event.allocate)
+			{
+				TlsfAllocation allocation;
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				const bool ok = allocator.Allocate(event.size, event.alignment, allocation);
+				const double elapsed = MillisecondsSince(start) * 1e6;
+				allocateTimes.push_back(elapsed);
+				result.failed += ok ? 0 : 1;
+				live.push_back(allocation);
+				placed.push_back(ok);
+			}
+			else
+			{
+				if (placed[event.slot])
+				{
+					const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					allocator.Free(live[event.slot]);
+					result.freeNs += MillisecondsSince(start) * 1e6;
+					frees++;
+				}
+				live[event.slot] = live.back();
+				live.pop_back();
+				placed[event.slot] = placed.back();
+				placed.pop_back();
+			}
+
+			if (i % 1000 == 999)
+			{
+				const TlsfStats stats = allocator.GetStats();
+				result.fragmentation += stats.fragmentation;
+				result.worstFragmentation = std::max(result.worstFragmentation, stats.fragmentation);
+				result.fill += static_cast<double>(stats.usedSize) / heapSize;
+				samples++;
+			}
+		}
+		for (double time : allocateTimes)
+		{
+			result.allocateNs += time;
+		}
+		result.allocateNs /= std::max<size_t>(allocateTimes.size(), 1);
+		if (!allocateTimes.empty())
+		{
+			const size_t p99 = allocateTimes.size() * 99 / 100;
+			std::nth_element(allocateTimes.begin(), allocateTimes.begin() + p99, allocateTimes.end());
+			result.allocateP99Ns = allocateTimes[p99];
+		}
+		result.freeNs /= std::max(frees, 1u);
+		result.fragmentation /= std::max(samples, 1u);
+		result.fill /= std::max(samples, 1u);
+		return result;
+	}
+}
+
+// Allocation latency and fragmentation replaying a resource churn trace against a 256 MB heap block at a few fill
+// levels. Each call is timed on its own, so the per call numbers include the clock read.
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t eventCount = smoke ? 5000 : 1000000;
+	const uint64_t heapSize = 256 * MB;
+
+	uint64_t checksum = 0;
+	for (double targetFill : { 0.5, 0.75, 0.9 })
+	{
+		const std::vector<TraceEvent> trace = MakeTrace(heapSize, targetFill, eventCount, 1);
+		const TraceResult result = Replay(trace, heapSize);
+		printf("%2.0f%% target: allocate %5.1f ns (p99 %5.0f), free %5.1f ns, fill %4.1f%%, fragmentation %.3f (worst %.3f), %u failed\n",
+			targetFill * 100.0, result.allocateNs, result.allocateP99Ns, result.freeNs, result.fill * 100.0,
+			result.fragmentation, result.worstFragmentation, result.failed);
+		checksum += result.failed + static_cast<uint64_t>(result.fill * 1000.0);
+	}
+
+	// And the whole trace untimed per call, for throughput without the clock reads
+	const std::vector<TraceEvent> trace = MakeTrace(heapSize, 0.75, eventCount, 2);
+	const double whole = BestOf(smoke ? 1 : 5, [&]() {
+		TlsfAllocator allocator(heapSize);
+		std::vector<TlsfAllocation> live;
+		std::vector<bool> placed;
+		for (const TraceEvent& event : trace)
+		{
+			if (event.allocate)
+			{
+				TlsfAllocation allocation;
+				placed.push_back(allocator.Allocate(event.size, event.alignment, allocation));
+				live.push_back(allocation);
+			}
+			else
+			{
+				if (placed[event.slot])
+				{
+					allocator.Free(live[event.slot]);
+				}
+				live[event.slot] = live.back();
+				live.pop_back();
+				placed[event.slot] = placed.back();
+				placed.pop_back();
+			}
+		}
+		checksum += allocator.GetAllocationCount();
+	});
+	printf("%u events in %8.3f ms, %5.1f ns an event\n", eventCount, whole, whole * 1e6 / eventCount);
+	printf("checksum %llu\n", static_cast<unsigned long long>(checksum));
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include "Graphics/TransformKernels.h"
+#include "Benchmark.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// ns per transform for a plain glm loop and each kernel level the CPU has, in 4096 element batches that stay in cache.
+// count has to be a multiple of batch.
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const size_t count = smoke ? 8192 : 98304;
+	const size_t batch = 4096;
+	const int runs = smoke ? 1 : 15;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+	std::vector<glm::mat4> matrices(count);
+	std::vector<glm::vec4> points(count);
+	std::vector<Aabb> boxes(count);
+	std::vector<uint32_t> parents(count);
+	// Breadth first with 8 children each, ComposeHierarchy's best case next to the random parents' worst
+	std::vector<uint32_t> treeParents(count);
+	for (size_t i{ 0 }; i < count; i++)
+	{
+		for (int column{ 0 }; column < 4; column++)
+		{
+			for (int row{ 0 }; row < 4; row++)
+			{
+				matrices[i][column][row] = value(random);
+			}
+		}
+		points[i] = glm::vec4(value(random), value(random), value(random), 1.0f);
+		const glm::vec3 corner(value(random), value(random), value(random));
+		boxes[i] = { corner, corner + glm::vec3(0.5f) };
+		parents[i] = i % 7 == 0 ? InvalidParent : static_cast<uint32_t>(random() % i);
+		treeParents[i] = i == 0 ? InvalidParent : static_cast<uint32_t>((i - 1) / 8);
+	}
+	glm::mat4 left = matrices[5];
+	left[0][3] = left[1][3] = left[2][3] = 0.0f;
+	left[3][3] = 1.0f;
+
+	std::vector<glm::mat4> outMatrices(count);
+	std::vector<glm::vec4> outPoints(count);
+	std::vector<Aabb> outBoxes(count);
+	const double toNs = 1e6 / count;
+	float checksum = 0.0f;
+
+	const double glmMatrices = BestOf(runs, [&]() { for (size_t i{ 0 }; i < count; i++) { outMatrices[i] = left * matrices[i]; } });
+	const double glmPoints = BestOf(runs, [&]() { for (size_t i{ 0 }; i < count; i++) { outPoints[i] = left * points[i]; } });
+	const double glmHierarchy = BestOf(runs, [&]() {
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			outMatrices[i] = parents[i] == InvalidParent ? matrices[i] : outMatrices[parents[i]] * matrices[i];
+		}
+	});
+	const double glmTree = BestOf(runs, [&]() {
+		for (size_t i{ 0 }; i < count; i++)
+		{
+			outMatrices[i] = treeParents[i] == InvalidParent ? matrices[i] : outMatrices[treeParents[i]] * matrices[i];
+		}
+	});
+	checksum += outMatrices[1][1][1] + outPoints[1].x;
+	printf("%zu transforms, ns each\n", count);
+	printf("  %-8s mat4*mat4 %6.2f  mat4*vec4 %6.2f  aabb   -    hierarchy %6.2f  tree %6.2f\n", "glm", glmMatrices * toNs,
+		glmPoints * toNs, glmHierarchy * toNs, glmTree * toNs);
+
+	const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512 };
+	for (SimdLevel level : levels)
+	{
+		if (level > GetCpuSimdLevel())
+		{
+			break;
+		}
+		SetSimdLevel(level);
+		const double multiply = BestOf(runs, [&]() {
+			for (size_t first{ 0 }; first < count; first += batch)
+			{
+				MultiplyMatrices(left, matrices.data() + first, outMatrices.data() + first, batch);
+			}
+		});
+		const double transform = BestOf(runs, [&]() {
+			for (size_t first{ 0 }; first < count; first += batch)
+			{
+				TransformPoints(left, points.data() + first, outPoints.data() + first, batch);
+			}
+		});
+		const double aabbs = BestOf(runs, [&]() {
+			for (size_t first{ 0 }; first < count; first += batch)
+			{
+				TransformAabbs(left, boxes.data() + first, outBoxes.data() + first, batch);
+			}
+		});
+		const double hierarchy = BestOf(runs, [&]() { ComposeHierarchy(matrices.data(), parents.data(), outMatrices.data(), count); });
+		const double tree = BestOf(runs, [&]() { ComposeHierarchy(matrices.data(), treeParents.data(), outMatrices.data(), count); });
+		checksum += outMatrices[1][1][1] + outPoints[1].x + outBoxes[1].min.x;
+		printf("  %-8s mat4*mat4 %6.2f  mat4*vec4 %6.2f  aabb %6.2f  hierarchy %6.2f  tree %6.2f\n",
+			GetSimdLevelName(GetTransformKernelLevel()), multiply * toNs, transform * toNs, aabbs * toNs, hierarchy * toNs, tree * toNs);
+	}
+	printf("checksum %g\n", checksum);
+	return 0;
+}
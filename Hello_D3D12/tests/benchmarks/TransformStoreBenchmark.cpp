@@ -0,0 +1,73 @@
+#include "Graphics/TransformStore.h"
+#include "Benchmark.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// groupSize 1 makes every node a root, otherwise chains of groupSize nodes under one root
+	void Build(TransformStore& store, uint32_t count, uint32_t groupSize) {
+		store.Clear();
+		store.Reserve(count);
+		const glm::quat rotation = glm::angleAxis(0.1f, glm::vec3(0.0f, 1.0f, 0.0f));
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			const uint32_t parent = i % groupSize == 0 ? InvalidParent : i - 1;
+			store.Add(parent, glm::vec3(static_cast<float>(i % 100), 0.0f, 1.0f), rotation, glm::vec3(1.0f));
+		}
+		store.UpdateWorld();
+	}
+}
+
+// 1% of the nodes moved per frame, UpdateWorld plus PackChanged against recomputing and copying every node with glm
+int main(int argc, char** argv) {
+	const bool smoke = IsSmokeRun(argc, argv);
+	const uint32_t count = smoke ? 10000 : 1000000;
+	const int frames = smoke ? 2 : 20;
+	const uint32_t moved = count / 100;
+
+	std::vector<glm::mat4> upload(count);
+	std::mt19937 random(1);
+	TransformStore store;
+	float checksum = 0.0f;
+	printf("%u nodes, %u moved per frame\n", count, moved);
+	for (uint32_t groupSize : { 1u, 64u })
+	{
+		Build(store, count, groupSize);
+		uint64_t changed = 0;
+		uint64_t bytes = 0;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int frame{ 0 }; frame < frames; frame++)
+		{
+			for (uint32_t i{ 0 }; i < moved; i++)
+			{
+				store.SetPosition(random() % count, glm::vec3(static_cast<float>(frame), 0.0f, 1.0f));
+			}
+			changed += store.UpdateWorld();
+			bytes += store.GetChangedSize();
+			store.PackChanged(upload.data());
+		}
+		checksum += upload[0][3][0];
+		printf("  %-16s %7.2f ms update + pack, %7llu changed, %5.1f MB\n", groupSize == 1 ? "flat" : "chains of 64",
+			MillisecondsSince(start) / frames, static_cast<unsigned long long>(changed / frames), bytes / frames / 1e6);
+	}
+
+	// The same chains of 64, but every node's world matrix rebuilt from scratch and all of them copied
+	std::vector<glm::mat4> world(count);
+	const double full = BestOf(smoke ? 1 : 5, [&]() {
+		for (uint32_t i{ 0 }; i < count; i++)
+		{
+			const glm::mat4 local = glm::translate(glm::mat4(1.0f), store.GetPosition(i)) * glm::mat4_cast(store.GetRotation(i)) *
+				glm::scale(glm::mat4(1.0f), store.GetScale(i));
+			world[i] = store.GetParent(i) == InvalidParent ? local : world[store.GetParent(i)] * local;
+		}
+		memcpy(upload.data(), world.data(), count * sizeof(glm::mat4));
+	});
+	checksum += upload[1][3][0];
+	printf("  %-16s %7.2f ms, %5.1f MB\n", "full glm + copy", full, count * sizeof(glm::mat4) / 1e6);
+	printf("checksum %g\n", checksum);
+	return 0;
+}